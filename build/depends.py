@@ -56,8 +56,20 @@ class PortMIDI(Dependence):
         if not conf.CheckLib(libs) or not conf.CheckHeader(headers):
             raise Exception("Did not find PortMidi or its development headers.")
 
+        # On Linux PortMidi reads from the ALSA sequencer. With ALSA the
+        # controller thread waits for input on a sequencer client of its own
+        # instead of polling PortMidi on a timer.
+        if build.platform_is_linux:
+            if (conf.CheckLib(['asound', 'libasound']) and
+                    conf.CheckHeader('alsa/asoundlib.h')):
+                build.env.Append(CPPDEFINES='__ALSASEQ__')
+
     def sources(self, build):
-        return ['controllers/midi/portmidienumerator.cpp', 'controllers/midi/portmidicontroller.cpp']
+        sources = ['controllers/midi/portmidienumerator.cpp',
+                   'controllers/midi/portmidicontroller.cpp']
+        if build.platform_is_linux:
+            sources.append('controllers/midi/alsaseqnotifier.cpp')
+        return sources
 
 
 class OpenGL(Dependence):
@@ -532,6 +544,7 @@ class MixxxCore(Feature):
                    "controllinpotmeter.cpp",
                    "controlpushbutton.cpp",
                    "controlindicator.cpp",
+                   "timelinecontrol.cpp",
                    "controlttrotary.cpp",
 
                    "preferences/dlgpreferencepage.cpp",
@@ -564,6 +577,7 @@ class MixxxCore(Feature):
 
                    "engine/engineworker.cpp",
                    "engine/engineworkerscheduler.cpp",
+                   "engine/channelprocessingpool.cpp",
                    "engine/enginebuffer.cpp",
                    "engine/enginebufferscale.cpp",
                    "engine/enginebufferscaledummy.cpp",
@@ -584,9 +598,11 @@ class MixxxCore(Feature):
                    "engine/enginesidechaincompressor.cpp",
                    "engine/sidechain/enginesidechain.cpp",
                    "engine/enginefilterbutterworth8.cpp",
+                   "engine/enginefiltercrossover.cpp",
                    "engine/enginexfader.cpp",
                    "engine/enginemicrophone.cpp",
                    "engine/enginedeck.cpp",
+                   "engine/controleventqueue.cpp",
                    "engine/engineaux.cpp",
                    "engine/channelmixer_autogen.cpp",
 
@@ -603,6 +619,7 @@ class MixxxCore(Feature):
                    "engine/enginetalkoverducking.cpp",
                    "cachingreader.cpp",
                    "cachingreaderworker.cpp",
+                   "decodedtrackcache.cpp",
 
                    "analyserrg.cpp",
                    "analyserqueue.cpp",
@@ -614,6 +631,7 @@ class MixxxCore(Feature):
                    "controllers/controllerenumerator.cpp",
                    "controllers/controllerlearningeventfilter.cpp",
                    "controllers/controllermanager.cpp",
+                   "controllers/controllerpollnotifiers.cpp",
                    "controllers/controllerpresetfilehandler.cpp",
                    "controllers/controllerpresetinfo.cpp",
                    "controllers/midi/midicontroller.cpp",
@@ -688,6 +706,7 @@ class MixxxCore(Feature):
                    "library/basesqltablemodel.cpp",
                    "library/basetrackcache.cpp",
                    "library/columncache.cpp",
+                   "library/columnartrackindex.cpp",
                    "library/librarytablemodel.cpp",
                    "library/searchquery.cpp",
                    "library/searchqueryparser.cpp",
@@ -733,6 +752,7 @@ class MixxxCore(Feature):
                    "library/sidebarmodel.cpp",
                    "library/libraryscanner.cpp",
                    "library/libraryscannerdlg.cpp",
+                   "library/librarywatcher.cpp",
                    "library/legacylibraryimporter.cpp",
                    "library/library.cpp",
 
@@ -767,6 +787,7 @@ class MixxxCore(Feature):
                    "library/parsercsv.cpp",
 
                    "soundsourceproxy.cpp",
+                   "mp3seektable.cpp",
 
                    "widget/wwaveformviewer.cpp",
 
@@ -856,6 +877,7 @@ class MixxxCore(Feature):
                    "util/sleepableqthread.cpp",
                    "util/statsmanager.cpp",
                    "util/stat.cpp",
+                   "util/timelinerecorder.cpp",
                    "util/time.cpp",
                    "util/timer.cpp",
                    "util/performancetimer.cpp",
@@ -870,6 +892,28 @@ class MixxxCore(Feature):
                    '#res/mixxx.qrc'
                    ]
 
+        # Vectorized SampleUtil kernels. Each file is built for its own
+        # instruction set and SampleUtil only calls into it if the CPU supports
+        # it, so the rest of Mixxx keeps running on older CPUs.
+        if build.architecture_is_x86:
+            if build.toolchain_is_msvs:
+                simd_flags = [('sse2', '' if build.machine_is_64bit else '/arch:SSE2'),
+                              ('avx2', '/arch:AVX2'),
+                              ('avx512', '/arch:AVX512')]
+            else:
+                simd_flags = [('sse2', '-msse2'),
+                              ('avx2', '-mavx2'),
+                              ('avx512', '-mavx512f')]
+            for isa, flag in simd_flags:
+                simd_env = build.env.Clone()
+                if flag:
+                    simd_env.Append(CCFLAGS=flag)
+                sources.append(simd_env.StaticObject('sampleutil_%s.cpp' % isa))
+        else:
+            sources.extend(['sampleutil_sse2.cpp',
+                            'sampleutil_avx2.cpp',
+                            'sampleutil_avx512.cpp'])
+
         proto_args = {
             'PROTOCPROTOPATH': ['src'],
             'PROTOCPYTHONOUTDIR': '',  # set to None to not generate python
@@ -407,11 +407,16 @@ class Vamp(Feature):
 
     def add_options(self, build, vars):
         vars.Add('vamp', 'Set to 1 to enable vamp analysers', 1)
+        vars.Add('vamp_legacy_fft',
+                 'Set to 1 to use the original FFT in the vamp analysers', 0)
 
     def configure(self, build, conf):
         if not self.enabled(build):
             return
 
+        if int(util.get_flags(build.env, 'vamp_legacy_fft', 0)):
+            build.env.Append(CPPDEFINES='QM_DSP_LEGACY_FFT')
+
         # If there is no system vamp-hostdk installed, then we'll directly link
         # the vamp-hostsdk.
         if not conf.CheckLib(['vamp-hostsdk']):
@@ -776,12 +781,16 @@ class TestSuite(Feature):
     def enabled(self, build):
         build.flags['test'] = util.get_flags(build.env, 'test', 0) or \
             'test' in SCons.BUILD_TARGETS
-        if int(build.flags['test']):
+        # The benchmarks are gtest fixtures too so they need gtest and gmock.
+        build.flags['bench'] = util.get_flags(build.env, 'bench', 0) or \
+            'mixxx-bench' in SCons.BUILD_TARGETS
+        if int(build.flags['test']) or int(build.flags['bench']):
             return True
         return False
 
     def add_options(self, build, vars):
         vars.Add('test', 'Set to 1 to build Mixxx test fixtures.', 0)
+        vars.Add('bench', 'Set to 1 to build the Mixxx benchmarks (mixxx-bench).', 0)
 
     def configure(self, build, conf):
         if not self.enabled(build):
@@ -22,7 +22,76 @@ def hanging_indent(base, groups, hanging_suffix, terminator, depth=0):
         groups,
         [hanging_suffix] * (len(groups) - 1) + [terminator])))
 
+MIX_BUSES_KERNEL_PATTERN = 'mixBuses%(i)d%(ramping)s'
+def mix_buses_kernel_name(i, ramping):
+    return MIX_BUSES_KERNEL_PATTERN % {'i': i,
+                                       'ramping': 'Ramping' if ramping else ''}
+
+def write_mix_buses_kernel(output, num_channels, ramping):
+    """Writes a kernel that reads each of num_channels channel buffers once
+    and accumulates them into the headphone output, the three crossfader
+    buses and the master output in the same pass."""
+    def write(data, depth=0):
+        output.append(' ' * (BASIC_INDENT * depth) + data)
+
+    header = 'inline void %s(' % mix_buses_kernel_name(num_channels, ramping)
+    args = ['const BusChannel* pChannels',
+            'CSAMPLE* pHeadphoneOutput',
+            'CSAMPLE* const* pBusOutputs',
+            'CSAMPLE* pMasterOutput',
+            'int iNumSamples']
+    output.extend(hanging_indent(header, args, ',', ') {'))
+
+    write('CSAMPLE* pLeft = pBusOutputs[EngineChannel::LEFT];', depth=1)
+    write('CSAMPLE* pCenter = pBusOutputs[EngineChannel::CENTER];', depth=1)
+    write('CSAMPLE* pRight = pBusOutputs[EngineChannel::RIGHT];', depth=1)
+    for j in xrange(num_channels):
+        values = {'j': j}
+        write('const CSAMPLE* pSrc%(j)d = pChannels[%(j)d].pBuffer;' % values, depth=1)
+        write('const CSAMPLE left%(j)d = pChannels[%(j)d].bus[EngineChannel::LEFT];' % values, depth=1)
+        write('const CSAMPLE center%(j)d = pChannels[%(j)d].bus[EngineChannel::CENTER];' % values, depth=1)
+        write('const CSAMPLE right%(j)d = pChannels[%(j)d].bus[EngineChannel::RIGHT];' % values, depth=1)
+        if ramping:
+            write('CSAMPLE headGain%(j)d = pChannels[%(j)d].headGainIn;' % values, depth=1)
+            write('const CSAMPLE headDelta%(j)d = 2.0 * (pChannels[%(j)d].headGainOut - headGain%(j)d) / iNumSamples;' % values, depth=1)
+            write('CSAMPLE masterGain%(j)d = pChannels[%(j)d].masterGainIn;' % values, depth=1)
+            write('const CSAMPLE masterDelta%(j)d = 2.0 * (pChannels[%(j)d].masterGainOut - masterGain%(j)d) / iNumSamples;' % values, depth=1)
+        else:
+            write('const CSAMPLE headGain%(j)d = pChannels[%(j)d].headGainOut;' % values, depth=1)
+            write('const CSAMPLE masterGain%(j)d = pChannels[%(j)d].masterGainOut;' % values, depth=1)
+
+    increments = ['i += 2']
+    if ramping:
+        for j in xrange(num_channels):
+            increments.append('headGain%(j)d += headDelta%(j)d' % {'j': j})
+            increments.append('masterGain%(j)d += masterDelta%(j)d' % {'j': j})
+    output.extend(hanging_indent('for (int i = 0; i < iNumSamples; ',
+                                 increments, ',', ') {', depth=1))
+
+    for side, index in (('L', 'i'), ('R', 'i + 1')):
+        for j in xrange(num_channels):
+            values = {'j': j, 'side': side, 'index': index}
+            write('const CSAMPLE sample%(j)d%(side)s = pSrc%(j)d[%(index)s];' % values, depth=2)
+            write('const CSAMPLE master%(j)d%(side)s = sample%(j)d%(side)s * masterGain%(j)d;' % values, depth=2)
+        output.extend(hanging_indent(
+            'pHeadphoneOutput[%s] = ' % index,
+            ['sample%(j)d%(side)s * headGain%(j)d' % {'j': j, 'side': side}
+             for j in xrange(num_channels)], ' +', ';', depth=2))
+        for bus, name in (('left', 'Left'), ('center', 'Center'), ('right', 'Right')):
+            output.extend(hanging_indent(
+                'const CSAMPLE %s%s = ' % (bus, side),
+                ['master%(j)d%(side)s * %(bus)s%(j)d' % {'j': j, 'side': side, 'bus': bus}
+                 for j in xrange(num_channels)], ' +', ';', depth=2))
+            write('p%s[%s] = %s%s;' % (name, index, bus, side), depth=2)
+        write('pMasterOutput[%(index)s] = left%(side)s + center%(side)s + right%(side)s;' %
+              {'index': index, 'side': side}, depth=2)
+    write('}', depth=1)
+    output.append('}')
+    output.append('')
+
 def write_channelmixer_autogen(output, num_channels):
+    output.append('#include <QVector>')
+    output.append('')
     output.append('#include "engine/channelmixer.h"')
     output.append('#include "util/timer.h"')
     output.append('#include "sampleutil.h"')
@@ -31,52 +100,77 @@ def write_channelmixer_autogen(output, num_channels):
     output.append('// SEE scripts/generate_sample_functions.py           //')
     output.append('////////////////////////////////////////////////////////')
     output.append('')
-    output.append('// static')
+    output.append('namespace {')
+    output.append('')
+    output.append('// The mixing functions run in the audio callback so their timer keys are')
+    output.append('// registered once at startup.')
+    output.append('QVector<StatKey> registerMixChannelsTimerKeys() {')
+    output.append(' ' * BASIC_INDENT + 'QVector<StatKey> keys;')
+    output.append(' ' * BASIC_INDENT + 'for (int i = 0; i <= %d; ++i) {' % num_channels)
+    output.append(' ' * BASIC_INDENT * 2 + 'keys.append(Stat::registerKey(')
+    output.append(' ' * BASIC_INDENT * 3 + 'QString("EngineMaster::mixChannels_%1active").arg(i)));')
+    output.append(' ' * BASIC_INDENT + '}')
+    output.append(' ' * BASIC_INDENT + 'return keys;')
+    output.append('}')
+    output.append('')
+    output.append('const QVector<StatKey> kMixChannelsTimerKeys =')
+    output.append(' ' * BASIC_INDENT * 2 + 'registerMixChannelsTimerKeys();')
+    output.append('')
+    output.append('QVector<StatKey> registerMixBusesTimerKeys() {')
+    output.append(' ' * BASIC_INDENT + 'QVector<StatKey> keys;')
+    output.append(' ' * BASIC_INDENT + 'for (int i = 0; i <= %d; ++i) {' % num_channels)
+    output.append(' ' * BASIC_INDENT * 2 + 'keys.append(Stat::registerKey(')
+    output.append(' ' * BASIC_INDENT * 3 + 'QString("EngineMaster::mixBuses_%1active").arg(i)));')
+    output.append(' ' * BASIC_INDENT + '}')
+    output.append(' ' * BASIC_INDENT + 'return keys;')
+    output.append('}')
+    output.append('')
+    output.append('const QVector<StatKey> kMixBusesTimerKeys =')
+    output.append(' ' * BASIC_INDENT * 2 + 'registerMixBusesTimerKeys();')
+    output.append('')
+    output.append('// A channel of the fused bus mix. bus is 1 for the crossfader bus the')
+    output.append('// channel is mixed into and 0 for the others.')
+    output.append('struct BusChannel {')
+    output.append(' ' * BASIC_INDENT + 'const CSAMPLE* pBuffer;')
+    output.append(' ' * BASIC_INDENT + 'CSAMPLE headGainIn;')
+    output.append(' ' * BASIC_INDENT + 'CSAMPLE headGainOut;')
+    output.append(' ' * BASIC_INDENT + 'CSAMPLE masterGainIn;')
+    output.append(' ' * BASIC_INDENT + 'CSAMPLE masterGainOut;')
+    output.append(' ' * BASIC_INDENT + 'CSAMPLE bus[3];')
+    output.append('};')
+    output.append('')
+    for ramping in (False, True):
+        for i in xrange(1, num_channels + 1):
+            write_mix_buses_kernel(output, i, ramping)
+    output.append('}  // anonymous namespace')
+    output.append('')
 
     def write_mixchannels(ramping, output):
         if ramping:
             header = 'void ChannelMixer::mixChannelsRamping('
         else:
             header = 'void ChannelMixer::mixChannels('
-        args = ['const QList<EngineMaster::ChannelInfo*>& channels',
+        args = ['const EngineMaster::ChannelList& activeChannels',
                 'const EngineMaster::GainCalculator& gainCalculator',
-                'unsigned int channelBitvector',
-                'unsigned int maxChannels',
                 'QList<CSAMPLE>* channelGainCache',
                 'CSAMPLE* pOutput',
                 'unsigned int iBufferSize']
+        output.append('// static')
         output.extend(hanging_indent(header, args, ',', ') {'))
 
         def write(data, depth=0):
             output.append(' ' * (BASIC_INDENT * depth) + data)
 
-        write('int activeChannels[%d] = {' % num_channels, depth=1)
-        for i in xrange(num_channels):
-            if i == num_channels - 1:
-                write('-1};', depth=2)
-            else:
-                write('-1,', depth=2)
-
-        write('unsigned int totalActive = 0;', depth=1)
-        write('for (unsigned int i = 0; i < maxChannels; ++i) {', depth=1)
-        write('if ((channelBitvector & (1 << i)) == 0) {', depth=2)
-        write('continue;', depth=3)
-        write('}', depth=2)
-        write('if (totalActive < %d) {' % num_channels, depth=2)
-        write('activeChannels[totalActive] = i;', depth=3)
-        write('}', depth=2)
-        write('++totalActive;', depth=2)
-        write('}', depth=1)
-
+        write('const int totalActive = activeChannels.size();', depth=1)
         write('if (totalActive == 0) {', depth=1)
-        write('ScopedTimer t("EngineMaster::mixChannels_0active");', depth=2)
+        write('ScopedTimer t(kMixChannelsTimerKeys[0]);', depth=2)
         write('SampleUtil::applyGain(pOutput, 0.0f, iBufferSize);', depth=2)
         for i in xrange(1, num_channels+1):
             write('} else if (totalActive == %d) {' % i, depth=1)
-            write('ScopedTimer t("EngineMaster::mixChannels_%(i)dactive");' % {'i': i}, depth=2)
+            write('ScopedTimer t(kMixChannelsTimerKeys[%(i)d]);' % {'i': i}, depth=2)
             for j in xrange(i):
-                write('const int pChannelIndex%(j)d = activeChannels[%(j)d];' % {'j': j}, depth=2)
-                write('EngineMaster::ChannelInfo* pChannel%(j)d = channels[pChannelIndex%(j)d];' % {'j': j}, depth=2)
+                write('EngineMaster::ChannelInfo* pChannel%(j)d = activeChannels[%(j)d];' % {'j': j}, depth=2)
+                write('const int pChannelIndex%(j)d = pChannel%(j)d->m_index;' % {'j': j}, depth=2)
                 if ramping:
                     write('CSAMPLE oldGain%(j)d = (*channelGainCache)[pChannelIndex%(j)d];' % {'j': j}, depth=2)
                 write('CSAMPLE newGain%(j)d = gainCalculator.getGain(pChannel%(j)d);' % {'j': j}, depth=2)
@@ -95,19 +189,118 @@ def write_channelmixer_autogen(output, num_channels):
         write('} else {', depth=1)
         write('// Set pOutput to all 0s', depth=2)
         write('SampleUtil::applyGain(pOutput, 0.0f, iBufferSize);', depth=2)
-        write('for (unsigned int i = 0; i < maxChannels; ++i) {', depth=2)
-        write('if (channelBitvector & (1 << i)) {', depth=3)
-        write('EngineMaster::ChannelInfo* pChannelInfo = channels[i];', depth=4)
-        write('CSAMPLE* pBuffer = pChannelInfo->m_pBuffer;', depth=4)
-        write('CSAMPLE gain = gainCalculator.getGain(pChannelInfo);', depth=4)
-        write('SampleUtil::addWithGain(pOutput, pBuffer, gain, iBufferSize);', depth=4)
-        write('}', depth=3)
+        write('for (int i = 0; i < totalActive; ++i) {', depth=2)
+        write('EngineMaster::ChannelInfo* pChannelInfo = activeChannels[i];', depth=3)
+        write('CSAMPLE* pBuffer = pChannelInfo->m_pBuffer;', depth=3)
+        write('CSAMPLE gain = gainCalculator.getGain(pChannelInfo);', depth=3)
+        write('(*channelGainCache)[pChannelInfo->m_index] = gain;', depth=3)
+        write('SampleUtil::addWithGain(pOutput, pBuffer, gain, iBufferSize);', depth=3)
         write('}', depth=2)
         write('}', depth=1)
         output.append('}')
+        output.append('')
     write_mixchannels(False, output)
     write_mixchannels(True, output)
 
+    def write_mixbuses(ramping, output):
+        if ramping:
+            header = 'void ChannelMixer::mixBusesRamping('
+            mix = 'mixChannelsRamping'
+        else:
+            header = 'void ChannelMixer::mixBuses('
+            mix = 'mixChannels'
+        args = ['const EngineMaster::ActiveChannels& activeChannels',
+                'const EngineMaster::GainCalculator& headphoneGainCalculator',
+                'const EngineMaster::GainCalculator& masterGainCalculator',
+                'QList<CSAMPLE>* headphoneGainCache',
+                'QList<CSAMPLE>* masterGainCache',
+                'CSAMPLE* pHeadphoneOutput',
+                'CSAMPLE* const* pBusOutputs',
+                'CSAMPLE* pMasterOutput',
+                'unsigned int iBufferSize']
+        output.append('// static')
+        output.extend(hanging_indent(header, args, ',', ') {'))
+
+        def write(data, depth=0):
+            output.append(' ' * (BASIC_INDENT * depth) + data)
+
+        write('const int totalActive = activeChannels.mixed.size();', depth=1)
+        write('if (totalActive > %d) {' % num_channels, depth=1)
+        write('// Too many channels for the kernels. Mix each output separately.', depth=2)
+        write('%s(activeChannels.headphone, headphoneGainCalculator,' % mix, depth=2)
+        write('headphoneGainCache, pHeadphoneOutput, iBufferSize);', depth=4)
+        write('for (int o = EngineChannel::LEFT; o <= EngineChannel::RIGHT; ++o) {', depth=2)
+        write('%s(activeChannels.bus[o], masterGainCalculator,' % mix, depth=3)
+        write('masterGainCache, pBusOutputs[o], iBufferSize);', depth=5)
+        write('}', depth=2)
+        write('SampleUtil::copy3WithGain(pMasterOutput,', depth=2)
+        write('pBusOutputs[EngineChannel::LEFT], 1.0,', depth=4)
+        write('pBusOutputs[EngineChannel::CENTER], 1.0,', depth=4)
+        write('pBusOutputs[EngineChannel::RIGHT], 1.0,', depth=4)
+        write('iBufferSize);', depth=4)
+        write('return;', depth=2)
+        write('}', depth=1)
+        output.append('')
+        write('// The headphone and bus lists are ordered like the mixed list, so one', depth=1)
+        write('// walk over it finds the mixes of every channel. The gains of a channel', depth=1)
+        write('// stay 0 in the mixes it is not in. Like mixChannels(), the caches are', depth=1)
+        write('// only updated for the mixes it is in.', depth=1)
+        write('BusChannel busChannels[%d];' % num_channels, depth=1)
+        write('int headphone = 0;', depth=1)
+        write('int bus[3] = { 0, 0, 0 };', depth=1)
+        write('for (int i = 0; i < totalActive; ++i) {', depth=1)
+        write('EngineMaster::ChannelInfo* pChannelInfo = activeChannels.mixed[i];', depth=2)
+        write('const int channelIndex = pChannelInfo->m_index;', depth=2)
+        write('BusChannel& channel = busChannels[i];', depth=2)
+        write('channel.pBuffer = pChannelInfo->m_pBuffer;', depth=2)
+        write('channel.headGainIn = channel.headGainOut = 0.0f;', depth=2)
+        write('if (headphone < activeChannels.headphone.size() &&', depth=2)
+        write('activeChannels.headphone[headphone] == pChannelInfo) {', depth=4)
+        write('++headphone;', depth=3)
+        write('channel.headGainOut = headphoneGainCalculator.getGain(pChannelInfo);', depth=3)
+        if ramping:
+            write('channel.headGainIn = (*headphoneGainCache)[channelIndex];', depth=3)
+        else:
+            write('channel.headGainIn = channel.headGainOut;', depth=3)
+        write('(*headphoneGainCache)[channelIndex] = channel.headGainOut;', depth=3)
+        write('}', depth=2)
+        write('channel.masterGainIn = channel.masterGainOut = 0.0f;', depth=2)
+        write('for (int o = EngineChannel::LEFT; o <= EngineChannel::RIGHT; ++o) {', depth=2)
+        write('channel.bus[o] = 0.0f;', depth=3)
+        write('if (bus[o] < activeChannels.bus[o].size() &&', depth=3)
+        write('activeChannels.bus[o][bus[o]] == pChannelInfo) {', depth=5)
+        write('++bus[o];', depth=4)
+        write('channel.bus[o] = 1.0f;', depth=4)
+        write('channel.masterGainOut = masterGainCalculator.getGain(pChannelInfo);', depth=4)
+        if ramping:
+            write('channel.masterGainIn = (*masterGainCache)[channelIndex];', depth=4)
+        else:
+            write('channel.masterGainIn = channel.masterGainOut;', depth=4)
+        write('(*masterGainCache)[channelIndex] = channel.masterGainOut;', depth=4)
+        write('}', depth=3)
+        write('}', depth=2)
+        write('}', depth=1)
+        output.append('')
+        write('if (totalActive == 0) {', depth=1)
+        write('ScopedTimer t(kMixBusesTimerKeys[0]);', depth=2)
+        write('SampleUtil::applyGain(pHeadphoneOutput, 0.0f, iBufferSize);', depth=2)
+        write('for (int o = EngineChannel::LEFT; o <= EngineChannel::RIGHT; ++o) {', depth=2)
+        write('SampleUtil::applyGain(pBusOutputs[o], 0.0f, iBufferSize);', depth=3)
+        write('}', depth=2)
+        write('SampleUtil::applyGain(pMasterOutput, 0.0f, iBufferSize);', depth=2)
+        for i in xrange(1, num_channels + 1):
+            write('} else if (totalActive == %d) {' % i, depth=1)
+            write('ScopedTimer t(kMixBusesTimerKeys[%d]);' % i, depth=2)
+            write('%s(busChannels, pHeadphoneOutput, pBusOutputs,' %
+                  mix_buses_kernel_name(i, ramping), depth=2)
+            write('pMasterOutput, iBufferSize);', depth=4)
+        write('}', depth=1)
+        output.append('}')
+
+    write_mixbuses(False, output)
+    output.append('')
+    write_mixbuses(True, output)
+
 def write_sampleutil_autogen(output, num_channels):
     output.append('#ifndef SAMPLEUTILAUTOGEN_H')
     output.append('#define SAMPLEUTILAUTOGEN_H')
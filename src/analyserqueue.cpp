@@ -30,16 +30,48 @@
 // 8192 seems to do fine.
 const int kAnalysisBlockSize = 8192;
 
-AnalyserQueue::AnalyserQueue(TrackCollection* pTrackCollection)
-        : m_aq(),
-          m_exit(false),
-          m_aiCheckPriorities(false),
-          m_pSamplesPCM(new SAMPLE[kAnalysisBlockSize]),
+// Numbers the pipeline threads of all queues, for debugging purposes.
+static QAtomicInt s_pipelineThreadCount;
+
+AnalyserQueue::Pipeline::Pipeline(AnalyserQueue* pQueue, int id)
+        : m_pQueue(pQueue),
+          m_iId(id),
           m_pSamples(new CSAMPLE[kAnalysisBlockSize]),
+          m_iProgress(-1) {
+}
+
+AnalyserQueue::Pipeline::~Pipeline() {
+    QListIterator<Analyser*> it(m_analysers);
+    while (it.hasNext()) {
+        Analyser* an = it.next();
+        //qDebug() << "AnalyserQueue: deleting " << typeid(an).name();
+        delete an;
+    }
+    delete [] m_pSamples;
+}
+
+void AnalyserQueue::Pipeline::run() {
+    m_pQueue->runPipeline(this);
+}
+
+AnalyserQueue::AnalyserQueue(TrackCollection* pTrackCollection, int pipelines)
+        : m_exit(false),
+          m_aiCheckPriorities(false),
+          m_iIdlePipelines(0),
+          m_iRunningPipelines(0),
           m_tioq(),
           m_qm(),
           m_qwait(),
           m_queue_size(0) {
+    for (int i = 0; i < math_max(1, pipelines); ++i) {
+        m_pipelines.append(new Pipeline(this, i));
+    }
+    m_progressInfo.current_track = TrackPointer();
+    m_progressInfo.track_progress = 0;
+    m_progressInfo.total_progress = 0;
+    m_progressInfo.queue_size = 0;
+    m_progressInfo.sema.release(); // Initalise with one
+
     connect(this, SIGNAL(updateProgress()),
             this, SLOT(slotUpdateProgress()));
     connect(this, SIGNAL(trackDone(TrackPointer)),
@@ -48,32 +80,48 @@ AnalyserQueue::AnalyserQueue(TrackCollection* pTrackCollection)
 
 AnalyserQueue::~AnalyserQueue() {
     stop();
-    m_progressInfo.sema.release();
-    wait(); //Wait until thread has actually stopped before proceeding.
-
-    QListIterator<Analyser*> it(m_aq);
-    while (it.hasNext()) {
-        Analyser* an = it.next();
-        //qDebug() << "AnalyserQueue: deleting " << typeid(an).name();
-        delete an;
+    // Every pipeline might be waiting to report progress.
+    m_progressInfo.sema.release(m_pipelines.size());
+    foreach (Pipeline* pPipeline, m_pipelines) {
+        pPipeline->wait(); //Wait until thread has actually stopped before proceeding.
     }
+    qDeleteAll(m_pipelines);
+    m_pipelines.clear();
     //qDebug() << "AnalyserQueue::~AnalyserQueue()";
+}
 
-    delete [] m_pSamplesPCM;
-    delete [] m_pSamples;
+void AnalyserQueue::start(QThread::Priority priority) {
+    m_iRunningPipelines = m_pipelines.size();
+    foreach (Pipeline* pPipeline, m_pipelines) {
+        pPipeline->start(priority);
+    }
+}
+
+void AnalyserQueue::addAnalyser(int pipeline, Analyser* an) {
+    m_pipelines[pipeline]->m_analysers.push_back(an);
 }
 
-void AnalyserQueue::addAnalyser(Analyser* an) {
-    m_aq.push_back(an);
+// static
+int AnalyserQueue::configuredPipelineCount(ConfigObject<ConfigValue>* pConfig) {
+    int pipelines = pConfig->getValueString(
+        ConfigKey("[Library]", "AnalyserPipelines")).toInt();
+    if (pipelines <= 0) {
+        pipelines = QThread::idealThreadCount() - 1;
+    }
+    return math_max(1, pipelines);
 }
 
 // This is called from the AnalyserQueue thread
-bool AnalyserQueue::isLoadedTrackWaiting(TrackPointer tio) {
+bool AnalyserQueue::isLoadedTrackWaiting(Pipeline* pPipeline, TrackPointer tio) {
     QMutexLocker queueLocker(&m_qm);
 
     const PlayerInfo& info = PlayerInfo::instance();
     TrackPointer pTrack;
     bool trackWaiting = false;
+    // Progress is reported after unlocking, since reporting waits for the
+    // GUI thread which might be waiting for m_qm.
+    QList<TrackPointer> storedTracks;
+    QList<TrackPointer> pendingTracks;
     QMutableListIterator<TrackPointer> it(m_tioq);
     while (it.hasNext()) {
         TrackPointer& pTrack = it.next();
@@ -81,8 +129,9 @@ bool AnalyserQueue::isLoadedTrackWaiting(TrackPointer tio) {
             it.remove();
             continue;
         }
-        if (!trackWaiting) {
-            trackWaiting = info.isTrackLoaded(pTrack);
+        // Queued again while another pipeline is analysing it.
+        if (isTrackInProgress(pTrack)) {
+            continue;
         }
         // try to load waveforms for all new tracks first
         // and remove them from queue if already analysed
@@ -90,7 +139,7 @@ bool AnalyserQueue::isLoadedTrackWaiting(TrackPointer tio) {
         int progress = pTrack->getAnalyserProgress();
         if (progress < 0) {
             // Load stored analysis
-            QListIterator<Analyser*> ita(m_aq);
+            QListIterator<Analyser*> ita(pPipeline->m_analysers);
             bool processTrack = false;
             while (ita.hasNext()) {
                 if (!ita.next()->loadStored(pTrack)) {
@@ -98,37 +147,64 @@ bool AnalyserQueue::isLoadedTrackWaiting(TrackPointer tio) {
                 }
             }
             if (!processTrack) {
-                emitUpdateProgress(pTrack, 1000);
+                storedTracks.append(pTrack);
                 it.remove();
-            } else {
-                emitUpdateProgress(pTrack, 0);
+                continue;
             }
+            pendingTracks.append(pTrack);
         } else if (progress == 1000) {
             it.remove();
+            continue;
         }
+        if (!trackWaiting) {
+            trackWaiting = info.isTrackLoaded(pTrack);
+        }
+    }
+    // An idle pipeline picks up the loaded track.
+    if (info.isTrackLoaded(tio) || m_iIdlePipelines > 0) {
+        trackWaiting = false;
     }
-    if (info.isTrackLoaded(tio)) {
-        return false;
+    queueLocker.unlock();
+
+    foreach (TrackPointer pStored, storedTracks) {
+        emitUpdateProgress(pStored, 1000);
+    }
+    foreach (TrackPointer pPending, pendingTracks) {
+        emitUpdateProgress(pPending, 0);
     }
     return trackWaiting;
 }
 
 // This is called from the AnalyserQueue thread
-TrackPointer AnalyserQueue::dequeueNextBlocking() {
+TrackPointer AnalyserQueue::dequeueNextBlocking(Pipeline* pPipeline) {
     m_qm.lock();
-    if (m_tioq.isEmpty()) {
+    TrackPointer pLoadTrack = takeNextTrack();
+    while (!pLoadTrack && !m_exit) {
+        // Wait for a new track, or for another pipeline to finish a track
+        // that was queued again while it was analysing it.
+        ++m_iIdlePipelines;
         Event::end("AnalyserQueue process");
         m_qwait.wait(&m_qm);
         Event::start("AnalyserQueue process");
+        --m_iIdlePipelines;
+        pLoadTrack = takeNextTrack();
+    }
+    if (m_exit) {
+        pLoadTrack = TrackPointer();
+    }
+    pPipeline->m_pCurrentTrack = pLoadTrack;
+    m_qm.unlock();
 
-        if (m_exit) {
-            m_qm.unlock();
-            return TrackPointer();
-        }
+    if (pLoadTrack) {
+        qDebug() << "Analyzing" << pLoadTrack->getTitle() << pLoadTrack->getLocation();
     }
+    // pTrack might be NULL, up to the caller to check.
+    return pLoadTrack;
+}
 
+TrackPointer AnalyserQueue::takeNextTrack() {
     const PlayerInfo& info = PlayerInfo::instance();
-    TrackPointer pLoadTrack;
+    TrackPointer pNextTrack;
     QMutableListIterator<TrackPointer> it(m_tioq);
     while (it.hasNext()) {
         TrackPointer& pTrack = it.next();
@@ -136,30 +212,49 @@ TrackPointer AnalyserQueue::dequeueNextBlocking() {
             it.remove();
             continue;
         }
+        // Another pipeline takes it once it is done with it.
+        if (isTrackInProgress(pTrack)) {
+            continue;
+        }
         // Prioritize tracks that are loaded.
         if (info.isTrackLoaded(pTrack)) {
             qDebug() << "Prioritizing" << pTrack->getTitle() << pTrack->getLocation();
-            pLoadTrack = pTrack;
+            pNextTrack = pTrack;
             it.remove();
-            break;
+            return pNextTrack;
+        }
+        if (!pNextTrack) {
+            pNextTrack = pTrack;
         }
     }
-
-    if (!pLoadTrack && !m_tioq.isEmpty()) {
-        pLoadTrack = m_tioq.dequeue();
+    if (pNextTrack) {
+        m_tioq.removeOne(pNextTrack);
     }
+    return pNextTrack;
+}
 
-    m_qm.unlock();
+bool AnalyserQueue::isTrackInProgress(TrackPointer tio) const {
+    foreach (const Pipeline* pPipeline, m_pipelines) {
+        if (pPipeline->m_pCurrentTrack == tio) {
+            return true;
+        }
+    }
+    return false;
+}
 
-    if (pLoadTrack) {
-        qDebug() << "Analyzing" << pLoadTrack->getTitle() << pLoadTrack->getLocation();
+int AnalyserQueue::remainingTracks() const {
+    int remaining = m_tioq.size();
+    foreach (const Pipeline* pPipeline, m_pipelines) {
+        if (pPipeline->m_pCurrentTrack) {
+            ++remaining;
+        }
     }
-    // pTrack might be NULL, up to the caller to check.
-    return pLoadTrack;
+    return remaining;
 }
 
 // This is called from the AnalyserQueue thread
-bool AnalyserQueue::doAnalysis(TrackPointer tio, SoundSourceProxy* pSoundSource) {
+bool AnalyserQueue::doAnalysis(Pipeline* pPipeline, TrackPointer tio,
+                               SoundSourceProxy* pSoundSource) {
     int totalSamples = pSoundSource->length();
     //qDebug() << tio->getFilename() << " has " << totalSamples << " samples.";
     int processedSamples = 0;
@@ -174,7 +269,8 @@ bool AnalyserQueue::doAnalysis(TrackPointer tio, SoundSourceProxy* pSoundSource)
 
     do {
         ScopedTimer t("AnalyserQueue::doAnalysis block");
-        read = pSoundSource->read(kAnalysisBlockSize, m_pSamplesPCM);
+        read = pSoundSource->readFloat(kAnalysisBlockSize,
+                                       pPipeline->m_pSamples);
 
         // To compare apples to apples, let's only look at blocks that are the
         // full block size.
@@ -197,18 +293,12 @@ bool AnalyserQueue::doAnalysis(TrackPointer tio, SoundSourceProxy* pSoundSource)
             dieflag = true;
         }
 
-        // Normalize the samples from [SHRT_MIN, SHRT_MAX] to [-1.0, 1.0].
-        // TODO(rryan): Change the SoundSource API to do this for us.
-        for (int i = 0; i < read; ++i) {
-            m_pSamples[i] = static_cast<CSAMPLE>(m_pSamplesPCM[i]) / SHRT_MAX;
-        }
-
-        QListIterator<Analyser*> it(m_aq);
+        QListIterator<Analyser*> it(pPipeline->m_analysers);
 
         while (it.hasNext()) {
             Analyser* an =  it.next();
             //qDebug() << typeid(*an).name() << ".process()";
-            an->process(m_pSamples, read);
+            an->process(pPipeline->m_pSamples, read);
             //qDebug() << "Done " << typeid(*an).name() << ".process()";
         }
 
@@ -220,10 +310,10 @@ bool AnalyserQueue::doAnalysis(TrackPointer tio, SoundSourceProxy* pSoundSource)
         progress = (int)(((float)processedSamples)/totalSamples *
                          (1000 - FINALIZE_PERCENT));
 
-        if (m_progressInfo.track_progress != progress) {
+        if (deref(pPipeline->m_iProgress) != progress) {
             if (progressUpdateInhibitTimer.elapsed() > 60) {
                 // Inhibit Updates for 60 milliseconds
-                emitUpdateProgress(tio, progress);
+                emitUpdateProgress(tio, progress, pPipeline);
                 progressUpdateInhibitTimer.start();
             }
         }
@@ -236,13 +326,10 @@ bool AnalyserQueue::doAnalysis(TrackPointer tio, SoundSourceProxy* pSoundSource)
         //QThread::usleep(10);
 
         //has something new entered the queue?
-        if (deref(m_aiCheckPriorities)) {
-            m_aiCheckPriorities = false;
-            if (isLoadedTrackWaiting(tio)) {
-                qDebug() << "Interrupting analysis to give preference to a loaded track.";
-                dieflag = true;
-                cancelled = true;
-            }
+        if (shouldYieldToLoadedTrack(pPipeline, tio)) {
+            qDebug() << "Interrupting analysis to give preference to a loaded track.";
+            dieflag = true;
+            cancelled = true;
         }
 
         if (m_exit) {
@@ -259,6 +346,67 @@ bool AnalyserQueue::doAnalysis(TrackPointer tio, SoundSourceProxy* pSoundSource)
     return !cancelled; //don't return !dieflag or we might reanalyze over and over
 }
 
+bool AnalyserQueue::shouldYieldToLoadedTrack(Pipeline* pPipeline,
+                                             TrackPointer tio) {
+    // Only one pipeline is interrupted for a loaded track, and pipelines
+    // that analyse a loaded track leave the check to the others.
+    return deref(m_aiCheckPriorities) &&
+            !PlayerInfo::instance().isTrackLoaded(tio) &&
+            m_aiCheckPriorities.testAndSetOrdered(1, 0) &&
+            isLoadedTrackWaiting(pPipeline, tio);
+}
+
+void AnalyserQueue::finishTrack(Pipeline* pPipeline) {
+    m_qm.lock();
+    pPipeline->m_pCurrentTrack = TrackPointer();
+    pPipeline->m_iProgress = -1;
+    // Only the last pipeline to finish sees an empty queue.
+    const int remaining = remainingTracks();
+    m_queue_size = remaining;
+    // Tracks that were queued again while this pipeline analysed them
+    // can be taken now.
+    m_qwait.wakeAll();
+    m_qm.unlock();
+    if (remaining == 0) {
+        emit(queueEmpty()); // emit asynchrony for no deadlock
+    }
+}
+
+TrackPointer AnalyserQueue::dequeueForTest(int pipeline) {
+    QMutexLocker locker(&m_qm);
+    TrackPointer pTrack = takeNextTrack();
+    m_pipelines[pipeline]->m_pCurrentTrack = pTrack;
+    return pTrack;
+}
+
+bool AnalyserQueue::shouldYieldToLoadedTrackForTest(int pipeline) {
+    Pipeline* pPipeline = m_pipelines[pipeline];
+    m_qm.lock();
+    TrackPointer pTrack = pPipeline->m_pCurrentTrack;
+    m_qm.unlock();
+    return shouldYieldToLoadedTrack(pPipeline, pTrack);
+}
+
+void AnalyserQueue::finishTrackForTest(int pipeline) {
+    finishTrack(m_pipelines[pipeline]);
+}
+
+bool AnalyserQueue::doAnalysisForTest(TrackPointer tio,
+                                      SoundSourceProxy* pSoundSource) {
+    Pipeline* pPipeline = m_pipelines.first();
+    QListIterator<Analyser*> it(pPipeline->m_analysers);
+    while (it.hasNext()) {
+        it.next()->initialise(tio, pSoundSource->getSampleRate(),
+                              pSoundSource->length());
+    }
+    bool completed = doAnalysis(pPipeline, tio, pSoundSource);
+    it.toFront();
+    while (it.hasNext()) {
+        it.next()->cleanup(tio);
+    }
+    return completed;
+}
+
 void AnalyserQueue::stop() {
     m_exit = true;
     m_qm.lock();
@@ -266,26 +414,21 @@ void AnalyserQueue::stop() {
     m_qm.unlock();
 }
 
-void AnalyserQueue::run() {
-    unsigned static id = 0; //the id of this thread, for debugging purposes
-    QThread::currentThread()->setObjectName(QString("AnalyserQueue %1").arg(++id));
+// This is called from the pipeline threads
+void AnalyserQueue::runPipeline(Pipeline* pPipeline) {
+    // The pipelines of all queues start concurrently.
+    const int id = s_pipelineThreadCount.fetchAndAddRelaxed(1) + 1;
+    QThread::currentThread()->setObjectName(
+        QString("AnalyserQueue %1 pipeline %2").arg(id).arg(pPipeline->m_iId));
 
     // If there are no analyzers, don't waste time running.
-    if (m_aq.size() == 0)
-        return;
-
-    m_progressInfo.current_track = TrackPointer();
-    m_progressInfo.track_progress = 0;
-    m_progressInfo.queue_size = 0;
-    m_progressInfo.sema.release(); // Initalise with one
-
-    while (!m_exit) {
-        TrackPointer nextTrack = dequeueNextBlocking();
+    while (!m_exit && pPipeline->m_analysers.size() > 0) {
+        TrackPointer nextTrack = dequeueNextBlocking(pPipeline);
 
         // It's important to check for m_exit here in case we decided to exit
         // while blocking for a new track.
         if (m_exit)
-            return;
+            break;
 
         // If the track is NULL, try to get the next one.
         // Could happen if the track was queued but then deleted.
@@ -304,10 +447,15 @@ void AnalyserQueue::run() {
 
         if (iNumSamples == 0 || iSampleRate == 0) {
             qDebug() << "Skipping invalid file:" << nextTrack->getLocation();
+            delete pSoundSource;
+            // Finishes the track like an analysed one, so that waiting
+            // pipelines wake up and the queue size and queueEmpty() are up
+            // to date.
+            finishTrack(pPipeline);
             continue;
         }
 
-        QListIterator<Analyser*> it(m_aq);
+        QListIterator<Analyser*> it(pPipeline->m_analysers);
         bool processTrack = false;
         while (it.hasNext()) {
             // Make sure not to short-circuit initialise(...)
@@ -317,50 +465,55 @@ void AnalyserQueue::run() {
         }
 
         m_qm.lock();
-        m_queue_size = m_tioq.size();
+        // Tracks left once this one is finished.
+        m_queue_size = remainingTracks() - 1;
         m_qm.unlock();
 
         if (processTrack) {
-            emitUpdateProgress(nextTrack, 0);
-            bool completed = doAnalysis(nextTrack, pSoundSource);
+            emitUpdateProgress(nextTrack, 0, pPipeline);
+            bool completed = doAnalysis(pPipeline, nextTrack, pSoundSource);
             if (!completed) {
                 //This track was cancelled
-                QListIterator<Analyser*> itf(m_aq);
+                QListIterator<Analyser*> itf(pPipeline->m_analysers);
                 while (itf.hasNext()) {
                     itf.next()->cleanup(nextTrack);
                 }
                 queueAnalyseTrack(nextTrack);
-                emitUpdateProgress(nextTrack, 0);
+                emitUpdateProgress(nextTrack, 0, pPipeline);
             } else {
                 // 100% - FINALIZE_PERCENT finished
-                emitUpdateProgress(nextTrack, 1000 - FINALIZE_PERCENT);
+                emitUpdateProgress(nextTrack, 1000 - FINALIZE_PERCENT, pPipeline);
                 // This takes around 3 sec on a Atom Netbook
-                QListIterator<Analyser*> itf(m_aq);
+                QListIterator<Analyser*> itf(pPipeline->m_analysers);
                 while (itf.hasNext()) {
                     itf.next()->finalise(nextTrack);
                 }
                 emit(trackDone(nextTrack));
-                emitUpdateProgress(nextTrack, 1000); // 100%
+                emitUpdateProgress(nextTrack, 1000, pPipeline); // 100%
             }
         } else {
-            emitUpdateProgress(nextTrack, 1000); // 100%
+            emitUpdateProgress(nextTrack, 1000, pPipeline); // 100%
             qDebug() << "Skipping track analysis because no analyzer initialized.";
         }
 
         delete pSoundSource;
+        finishTrack(pPipeline);
+    }
 
-        m_qm.lock();
-        m_queue_size = m_tioq.size();
-        m_qm.unlock();
-        if (m_queue_size == 0) {
-            emit(queueEmpty()); // emit asynchrony for no deadlock
-        }
+    m_qm.lock();
+    const bool lastPipeline = --m_iRunningPipelines == 0;
+    m_qm.unlock();
+    if (lastPipeline) {
+        emit(queueEmpty()); // emit in case of exit;
     }
-    emit(queueEmpty()); // emit in case of exit;
 }
 
 // This is called from the AnalyserQueue thread
-void AnalyserQueue::emitUpdateProgress(TrackPointer tio, int progress) {
+void AnalyserQueue::emitUpdateProgress(TrackPointer tio, int progress,
+                                       Pipeline* pPipeline) {
+    if (pPipeline != NULL) {
+        pPipeline->m_iProgress = progress;
+    }
     if (!m_exit) {
         // First tryAcqire will have always success because sema is initialized with on
         // The following tries will success if the previous signal was processed in the GUI Thread
@@ -374,9 +527,22 @@ void AnalyserQueue::emitUpdateProgress(TrackPointer tio, int progress) {
         } else {
             m_progressInfo.sema.acquire();
         }
+        // Average over the tracks being analysed, so that the progress
+        // doesn't jump between tracks if several are analysed in parallel.
+        int totalProgress = 0;
+        int busyPipelines = 0;
+        foreach (const Pipeline* pBusy, m_pipelines) {
+            const int pipelineProgress = deref(pBusy->m_iProgress);
+            if (pipelineProgress >= 0) {
+                totalProgress += pipelineProgress;
+                ++busyPipelines;
+            }
+        }
         m_progressInfo.current_track = tio;
         m_progressInfo.track_progress = progress;
-        m_progressInfo.queue_size = m_queue_size;
+        m_progressInfo.total_progress = busyPipelines > 0 ?
+                totalProgress / busyPipelines : progress;
+        m_progressInfo.queue_size = deref(m_queue_size);
         emit(updateProgress());
     }
 }
@@ -386,7 +552,7 @@ void AnalyserQueue::slotUpdateProgress() {
     if (m_progressInfo.current_track) {
         m_progressInfo.current_track->setAnalyserProgress(m_progressInfo.track_progress);
     }
-    emit(trackProgress(m_progressInfo.track_progress/10));
+    emit(trackProgress(m_progressInfo.total_progress/10));
     if (m_progressInfo.track_progress == 1000) {
         emit(trackFinished(m_progressInfo.queue_size));
     }
@@ -415,11 +581,11 @@ AnalyserQueue* AnalyserQueue::createDefaultAnalyserQueue(
         ConfigObject<ConfigValue>* pConfig, TrackCollection* pTrackCollection) {
     AnalyserQueue* ret = new AnalyserQueue(pTrackCollection);
 
-    ret->addAnalyser(new AnalyserWaveform(pConfig));
-    ret->addAnalyser(new AnalyserGain(pConfig));
+    ret->addAnalyser(0, new AnalyserWaveform(pConfig));
+    ret->addAnalyser(0, new AnalyserGain(pConfig));
     VampAnalyser::initializePluginPaths();
-    ret->addAnalyser(new AnalyserBeats(pConfig));
-    ret->addAnalyser(new AnalyserKey(pConfig));
+    ret->addAnalyser(0, new AnalyserBeats(pConfig));
+    ret->addAnalyser(0, new AnalyserKey(pConfig));
 
     ret->start(QThread::IdlePriority);
     return ret;
@@ -428,13 +594,17 @@ AnalyserQueue* AnalyserQueue::createDefaultAnalyserQueue(
 // static
 AnalyserQueue* AnalyserQueue::createAnalysisFeatureAnalyserQueue(
         ConfigObject<ConfigValue>* pConfig, TrackCollection* pTrackCollection) {
-    AnalyserQueue* ret = new AnalyserQueue(pTrackCollection);
+    AnalyserQueue* ret = new AnalyserQueue(pTrackCollection,
+                                           configuredPipelineCount(pConfig));
 
-    ret->addAnalyser(new AnalyserWaveform(pConfig));
-    ret->addAnalyser(new AnalyserGain(pConfig));
     VampAnalyser::initializePluginPaths();
-    ret->addAnalyser(new AnalyserBeats(pConfig));
-    ret->addAnalyser(new AnalyserKey(pConfig));
+    for (int i = 0; i < ret->pipelineCount(); ++i) {
+        ret->addAnalyser(i, new AnalyserWaveform(pConfig));
+        ret->addAnalyser(i, new AnalyserGain(pConfig));
+        ret->addAnalyser(i, new AnalyserBeats(pConfig));
+        ret->addAnalyser(i, new AnalyserKey(pConfig));
+    }
+    qDebug() << "Analysing tracks with" << ret->pipelineCount() << "pipelines";
 
     ret->start(QThread::IdlePriority);
     return ret;
@@ -1,6 +1,7 @@
 #ifndef ANALYSERQUEUE_H
 #define ANALYSERQUEUE_H
 
+#include <QAtomicInt>
 #include <QList>
 #include <QThread>
 #include <QQueue>
@@ -14,64 +15,131 @@
 class SoundSourceProxy;
 class TrackCollection;
 
-class AnalyserQueue : public QThread {
+// AnalyserQueue analyses the queued tracks with a number of pipelines. Each
+// pipeline has its own thread and set of analysers and analyses one track at
+// a time, so a queue with several pipelines analyses tracks in parallel.
+// Tracks that are loaded into a player are always analysed first.
+class AnalyserQueue : public QObject {
     Q_OBJECT
 
   public:
-    AnalyserQueue(TrackCollection* pTrackCollection);
+    AnalyserQueue(TrackCollection* pTrackCollection, int pipelines = 1);
     virtual ~AnalyserQueue();
     void stop();
     void queueAnalyseTrack(TrackPointer tio);
 
+    int pipelineCount() const {
+        return m_pipelines.size();
+    }
+
+    // The number of pipelines used for batch analysis, read from
+    // [Library],AnalyserPipelines. Defaults to one less than the number of
+    // cores so that one core is left for the engine and the GUI.
+    static int configuredPipelineCount(ConfigObject<ConfigValue>* pConfig);
+
     static AnalyserQueue* createDefaultAnalyserQueue(
             ConfigObject<ConfigValue>* pConfig, TrackCollection* pTrackCollection);
     static AnalyserQueue* createAnalysisFeatureAnalyserQueue(
             ConfigObject<ConfigValue>* pConfig, TrackCollection* pTrackCollection);
 
+    // Runs all analysers of the first pipeline over an opened sound source on
+    // the calling thread without finalising or saving the track. Used by the
+    // benchmarks.
+    bool doAnalysisForTest(TrackPointer tio, SoundSourceProxy* pSoundSource);
+
+    // Drive the scheduling of a queue whose pipelines were not started.
+    // dequeueForTest makes the next track the pipeline's current track
+    // without blocking, and finishTrackForTest finishes it.
+    void addAnalyserForTest(int pipeline, Analyser* pAnalyser) {
+        addAnalyser(pipeline, pAnalyser);
+    }
+    TrackPointer dequeueForTest(int pipeline);
+    bool shouldYieldToLoadedTrackForTest(int pipeline);
+    void finishTrackForTest(int pipeline);
+
   public slots:
     void slotAnalyseTrack(TrackPointer tio);
     void slotUpdateProgress();
 
   signals:
+    // The progress of the tracks that are being analysed, averaged over all
+    // pipelines.
     void trackProgress(int progress);
     void trackDone(TrackPointer track);
+    // size is the number of tracks that are queued or being analysed.
     void trackFinished(int size);
     // Signals from AnalyserQueue Thread:
     void queueEmpty();
     void updateProgress();
 
-  protected:
-    void run();
-
   private:
+    // A pipeline thread with its own analysers and buffers.
+    class Pipeline : public QThread {
+      public:
+        Pipeline(AnalyserQueue* pQueue, int id);
+        virtual ~Pipeline();
+
+        AnalyserQueue* m_pQueue;
+        const int m_iId;
+        QList<Analyser*> m_analysers;
+        CSAMPLE* m_pSamples;
+        // The track this pipeline is analysing. Guarded by m_qm.
+        TrackPointer m_pCurrentTrack;
+        // The progress of m_pCurrentTrack in 0.1 % or -1 while idle.
+        QAtomicInt m_iProgress;
+
+      protected:
+        void run();
+    };
 
     struct progress_info {
         TrackPointer current_track;
         int track_progress; // in 0.1 %
+        int total_progress; // in 0.1 %
         int queue_size;
         QSemaphore sema;
     };
 
-    void addAnalyser(Analyser* an);
-
-    QList<Analyser*> m_aq;
-
-    bool isLoadedTrackWaiting(TrackPointer tio);
-    TrackPointer dequeueNextBlocking();
-    bool doAnalysis(TrackPointer tio, SoundSourceProxy* pSoundSource);
-    void emitUpdateProgress(TrackPointer tio, int progress);
-
-    bool m_exit;
+    void start(QThread::Priority priority);
+    void addAnalyser(int pipeline, Analyser* an);
+
+    void runPipeline(Pipeline* pPipeline);
+    bool isLoadedTrackWaiting(Pipeline* pPipeline, TrackPointer tio);
+    TrackPointer dequeueNextBlocking(Pipeline* pPipeline);
+    // Removes and returns the next track that no pipeline is analysing yet.
+    // Must be called with m_qm locked.
+    TrackPointer takeNextTrack();
+    bool isTrackInProgress(TrackPointer tio) const;
+    // Whether pPipeline, which is analysing tio, should requeue it to make
+    // room for a loaded track.
+    bool shouldYieldToLoadedTrack(Pipeline* pPipeline, TrackPointer tio);
+    // Clears the current track of pPipeline and emits queueEmpty if no
+    // tracks are left.
+    void finishTrack(Pipeline* pPipeline);
+    // The number of queued tracks plus the tracks that are being analysed.
+    // Must be called with m_qm locked.
+    int remainingTracks() const;
+    bool doAnalysis(Pipeline* pPipeline, TrackPointer tio,
+                    SoundSourceProxy* pSoundSource);
+    // Reports the progress of tio. If pPipeline is not NULL tio is the track
+    // it is analysing.
+    void emitUpdateProgress(TrackPointer tio, int progress,
+                            Pipeline* pPipeline = NULL);
+
+    volatile bool m_exit;
     QAtomicInt m_aiCheckPriorities;
-    SAMPLE* m_pSamplesPCM;
-    CSAMPLE* m_pSamples;
+
+    QList<Pipeline*> m_pipelines;
+    // Guarded by m_qm.
+    int m_iIdlePipelines;
+    int m_iRunningPipelines;
 
     // The processing queue and associated mutex
     QQueue<TrackPointer> m_tioq;
     QMutex m_qm;
     QWaitCondition m_qwait;
     struct progress_info m_progressInfo;
-    int m_queue_size;
+    QAtomicInt m_queue_size;
 };
 
 #endif
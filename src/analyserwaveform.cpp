@@ -6,9 +6,7 @@
 #include <time.h>
 
 #include "analyserwaveform.h"
-#include "engine/engineobject.h"
-#include "engine/enginefilterbutterworth8.h"
-#include "engine/enginefilteriir.h"
+#include "engine/enginefiltercrossover.h"
 #include "library/trackcollection.h"
 #include "library/dao/analysisdao.h"
 #include "trackinfoobject.h"
@@ -23,13 +21,10 @@ AnalyserWaveform::AnalyserWaveform(ConfigObject<ConfigValue>* pConfig) :
         m_waveformData(NULL),
         m_waveformSummaryData(NULL),
         m_currentStride(0),
-        m_currentSummaryStride(0) {
+        m_currentSummaryStride(0),
+        m_pCrossover(NULL) {
     qDebug() << "AnalyserWaveform::AnalyserWaveform()";
 
-    m_filter[0] = 0;
-    m_filter[1] = 0;
-    m_filter[2] = 0;
-
     static int i = 0;
     m_database = QSqlDatabase::addDatabase("QSQLITE", "WAVEFORM_ANALYSIS" + QString::number(i++));
     if (!m_database.isOpen()) {
@@ -168,23 +163,16 @@ bool AnalyserWaveform::loadStored(TrackPointer tio) const {
 
 void AnalyserWaveform::resetFilters(TrackPointer tio, int sampleRate) {
     Q_UNUSED(tio);
-    Q_UNUSED(sampleRate);
-    //TODO: (vRince) bind this with *actual* filter values ...
-    // m_filter[Low] = new EngineFilterButterworth8(FILTER_LOWPASS, sampleRate, 200);
-    // m_filter[Mid] = new EngineFilterButterworth8(FILTER_BANDPASS, sampleRate, 200, 2000);
-    // m_filter[High] = new EngineFilterButterworth8(FILTER_HIGHPASS, sampleRate, 2000);
-    m_filter[Low] = new EngineFilterIIR(bessel_lowpass4, 4);
-    m_filter[Mid] = new EngineFilterIIR(bessel_bandpass, 8);
-    m_filter[High] = new EngineFilterIIR(bessel_highpass4, 4);
+    // The band corners of the waveform colors in Hz.
+    const double kLowMidCorner = 600.0;
+    const double kMidHighCorner = 4000.0;
+    m_pCrossover = new EngineFilterCrossover(sampleRate, kLowMidCorner,
+                                             kMidHighCorner);
 }
 
 void AnalyserWaveform::destroyFilters() {
-    for( int i = 0; i < FilterCount; i++) {
-        if( m_filter[i]) {
-            delete m_filter[i];
-            m_filter[i] = 0;
-        }
-    }
+    delete m_pCrossover;
+    m_pCrossover = NULL;
 }
 
 void AnalyserWaveform::process(const CSAMPLE* buffer, const int bufferLength) {
@@ -198,9 +186,8 @@ void AnalyserWaveform::process(const CSAMPLE* buffer, const int bufferLength) {
         m_buffers[High].resize(bufferLength);
     }
 
-    m_filter[Low]->process(buffer, &m_buffers[Low][0], bufferLength);
-    m_filter[Mid]->process(buffer, &m_buffers[Mid][0], bufferLength);
-    m_filter[High]->process(buffer, &m_buffers[High][0], bufferLength);
+    m_pCrossover->process(buffer, &m_buffers[Low][0], &m_buffers[Mid][0],
+                          &m_buffers[High][0], bufferLength);
 
 
     for( int i = 0; i < bufferLength; i+=2) {
@@ -14,9 +14,7 @@
 //NOTS vrince some test to segment sound, to apply color in the waveform
 //#define TEST_HEAT_MAP
 
-class EngineObject;
-class EngineFilterButterworth8;
-class EngineFilterIIR;
+class EngineFilterCrossover;
 class Waveform;
 class AnalysisDao;
 
@@ -178,7 +176,7 @@ class AnalyserWaveform : public Analyser {
     int m_currentStride;
     int m_currentSummaryStride;
 
-    EngineObject* m_filter[FilterCount];
+    EngineFilterCrossover* m_pCrossover;
     std::vector<float> m_buffers[FilterCount];
 
     QTime* m_timer;
@@ -8,15 +8,35 @@
 #include "controlobjectthread.h"
 
 #include "cachingreader.h"
+#include "controlpushbutton.h"
+#include "decodedtrackcache.h"
 #include "trackinfoobject.h"
 #include "soundsourceproxy.h"
 #include "sampleutil.h"
+#include "util/compatibility.h"
 #include "util/counter.h"
+#include "util/time.h"
 
 // currently CachingReaderWorker::kChunkLength is 65536 (0x10000);
 // For 80 chunks we need 5242880 (0x500000) bytes (5 MiB) of Memory
 //static
-const int CachingReader::maximumChunksInMemory = 80;
+const int CachingReader::kDefaultChunksInMemory = 80;
+// 1 MiB
+//static
+const int CachingReader::kMinimumChunksInMemory = 16;
+// 256 MiB
+//static
+const int CachingReader::kMaximumChunksInMemory = 4096;
+
+namespace {
+
+// Chunk index entries allocated up front. Covers a 20 minute stereo track at
+// 48 kHz so that the index is only resized on the engine thread for longer
+// tracks.
+const int kInitialChunkIndexSize =
+        48000 * 2 * 60 * 20 / CachingReaderWorker::kSamplesPerChunk + 1;
+
+} // anonymous namespace
 
 CachingReader::CachingReader(const char* group,
                              ConfigObject<ConfigValue>* config)
@@ -24,27 +44,58 @@ CachingReader::CachingReader(const char* group,
           m_chunkReadRequestFIFO(1024),
           m_readerStatusFIFO(1024),
           m_readerStatus(INVALID),
+          m_chunkIndex(kInitialChunkIndexSize, NULL),
+          m_iChunkIndexSize(0),
           m_mruChunk(NULL),
           m_lruChunk(NULL),
           m_pRawMemoryBuffer(NULL),
-          m_iTrackNumSamplesCallbackSafe(0) {
-    int rawMemoryBufferLength = CachingReaderWorker::kSamplesPerChunk * maximumChunksInMemory;
+          m_iTrackNumSamplesCallbackSafe(0),
+          m_pDecodedTrack(NULL),
+          m_hintGeneration(0),
+          m_cacheHitCounter(QString("CachingReader %1 cache hit").arg(group)),
+          m_cacheMissCounter(QString("CachingReader %1 cache miss").arg(group)),
+          m_cacheEvictionCounter(
+              QString("CachingReader %1 cache eviction").arg(group)),
+          m_lateChunkCounter(QString("CachingReader %1 late chunk").arg(group)),
+          m_canceledReadCounter(
+              QString("CachingReader %1 canceled read").arg(group)),
+          m_readLatencyKey(Stat::registerKey(
+              QString("CachingReader %1 read latency").arg(group))) {
+    int chunksInMemory = kDefaultChunksInMemory;
+    if (config != NULL) {
+        chunksInMemory = config->getValueString(
+            ConfigKey(group, "CachingReaderChunks"),
+            QString::number(kDefaultChunksInMemory)).toInt();
+        if (chunksInMemory <= 0) {
+            chunksInMemory = kDefaultChunksInMemory;
+        }
+        chunksInMemory = qBound(kMinimumChunksInMemory, chunksInMemory,
+                                kMaximumChunksInMemory);
+    }
+
+    int rawMemoryBufferLength = CachingReaderWorker::kSamplesPerChunk * chunksInMemory;
     m_pRawMemoryBuffer = new CSAMPLE[rawMemoryBufferLength];
 
-    m_allocatedChunks.reserve(maximumChunksInMemory);
+    m_chunks.reserve(chunksInMemory);
+    m_freeChunks.reserve(chunksInMemory);
 
     CSAMPLE* bufferStart = m_pRawMemoryBuffer;
 
     // Divide up the allocated raw memory buffer into total_chunks
     // chunks. Initialize each chunk to hold nothing and add it to the free
     // list.
-    for (int i=0; i < maximumChunksInMemory; i++) {
+    for (int i=0; i < chunksInMemory; i++) {
         Chunk* c = new Chunk;
         c->chunk_number = -1;
         c->length = 0;
         c->data = bufferStart;
+        c->ready = false;
         c->next_lru = NULL;
         c->prev_lru = NULL;
+        c->priority = 0;
+        c->hint_generation = 0;
+        c->request_time = 0;
+        c->late = false;
 
         m_chunks.push_back(c);
         m_freeChunks.push_back(c);
@@ -54,7 +105,8 @@ CachingReader::CachingReader(const char* group,
 
     m_pWorker = new CachingReaderWorker(group,
             &m_chunkReadRequestFIFO,
-            &m_readerStatusFIFO);
+            &m_readerStatusFIFO,
+            &m_hintGeneration);
 
     // Forward signals from worker
     connect(m_pWorker, SIGNAL(trackLoading()),
@@ -67,6 +119,14 @@ CachingReader::CachingReader(const char* group,
             this, SIGNAL(trackLoadFailed(TrackPointer, QString)),
             Qt::DirectConnection);
 
+    m_pDecodeToRam = new ControlPushButton(ConfigKey(group, "decode_to_ram"),
+                                           true);
+    m_pDecodeToRam->setButtonMode(ControlPushButton::TOGGLE);
+    m_pWorker->setDecodeToRam(m_pDecodeToRam->get() > 0.0);
+    connect(m_pDecodeToRam, SIGNAL(valueChanged(double)),
+            this, SLOT(slotDecodeToRam(double)),
+            Qt::DirectConnection);
+
     m_pWorker->start();
 }
 
@@ -75,8 +135,19 @@ CachingReader::~CachingReader() {
 
     m_pWorker->quitWait();
     delete m_pWorker;
+    delete m_pDecodeToRam;
+
+    // Release the decoded tracks the worker handed over.
+    ReaderStatusUpdate status;
+    while (m_readerStatusFIFO.read(&status, 1) == 1) {
+        DecodedTrackCache::release(status.decodedTrack);
+    }
+    DecodedTrackCache::release(m_pDecodedTrack);
+    m_pDecodedTrack = NULL;
+
     m_freeChunks.clear();
-    m_allocatedChunks.clear();
+    m_chunkIndex.clear();
+    m_iChunkIndexSize = 0;
     m_lruChunk = m_mruChunk = NULL;
 
     for (int i=0; i < m_chunks.size(); i++) {
@@ -140,12 +211,11 @@ Chunk* CachingReader::insertIntoLRUList(Chunk* chunk, Chunk* head) {
 
 
 void CachingReader::freeChunk(Chunk* pChunk) {
-    int removed = m_allocatedChunks.remove(pChunk->chunk_number);
-
-    // We'll tolerate not being in allocatedChunks because sometime you free a
-    // chunk right after you allocated it.
-    if (removed > 1) {
-        qDebug() << "ERROR: freeChunk free'd a chunk that was multiply-allocated.";
+    // Chunks with a read in progress may have been dropped from the index
+    // when a new track was loaded.
+    if (pChunk->chunk_number >= 0 &&
+            indexedChunk(pChunk->chunk_number) == pChunk) {
+        m_chunkIndex[pChunk->chunk_number] = NULL;
     }
 
     // If this is the LRU chunk then set its previous LRU chunk to the LRU
@@ -157,34 +227,74 @@ void CachingReader::freeChunk(Chunk* pChunk) {
 
     pChunk->chunk_number = -1;
     pChunk->length = 0;
+    pChunk->ready = false;
+    pChunk->late = false;
     m_freeChunks.push_back(pChunk);
 }
 
-void CachingReader::freeAllChunks() {
-    m_allocatedChunks.clear();
+void CachingReader::resetChunkIndex(int trackNumSamples) {
+    // Free all chunks that have been read and drop the ones being read from the
+    // index so that chunkReadFinished() frees them once the worker is done.
+    for (int i = 0; i < m_chunks.size(); ++i) {
+        Chunk* pChunk = m_chunks[i];
+        if (pChunk->ready) {
+            freeChunk(pChunk);
+        } else if (pChunk->chunk_number >= 0 &&
+                indexedChunk(pChunk->chunk_number) == pChunk) {
+            m_chunkIndex[pChunk->chunk_number] = NULL;
+        }
+    }
     m_mruChunk = NULL;
+    m_lruChunk = NULL;
 
-    QSet<Chunk*> reserved = QSet<Chunk*>::fromList(m_chunksBeingRead.values());
+    const int indexSize = trackNumSamples > 0 ?
+            chunkForSample(trackNumSamples - 1) + 1 : 0;
+    if (indexSize > m_chunkIndex.size()) {
+        // Only happens for very long tracks.
+        m_chunkIndex.resize(indexSize);
+    }
+    // All entries are NULL, either from construction or from the loop above.
+    m_iChunkIndexSize = indexSize;
+}
 
-    for (int i=0; i < m_chunks.size(); i++) {
-        Chunk* c = m_chunks[i];
-        if (reserved.contains(c)) {
-            continue;
-        }
-        if (!m_freeChunks.contains(c)) {
-            c->chunk_number = -1;
-            c->length = 0;
-            c->next_lru = NULL;
-            c->prev_lru = NULL;
-            m_freeChunks.push_back(c);
-        }
+void CachingReader::chunkReadFinished(Chunk* pChunk, bool success) {
+    if (pChunk->ready) {
+        qDebug() << "ERROR: CachingReader received a chunk that was already read"
+                 << pChunk->chunk_number;
+        return;
+    }
+    // The chunk was requested for a previous track or dropped from the cache.
+    if (!success || indexedChunk(pChunk->chunk_number) != pChunk) {
+        freeChunk(pChunk);
+        return;
+    }
+
+    //qDebug() << "Inserting chunk" << pChunk << pChunk->chunk_number;
+    pChunk->ready = true;
+    if (pChunk->late) {
+        m_lateChunkCounter.increment();
+    }
+    Stat::track(m_readLatencyKey, Stat::DURATION_NANOSEC,
+                Stat::COUNT | Stat::AVERAGE | Stat::SAMPLE_VARIANCE |
+                Stat::MIN | Stat::MAX,
+                Time::elapsed() - pChunk->request_time);
+
+    // Insert the chunk into the LRU list
+    m_mruChunk = insertIntoLRUList(pChunk, m_mruChunk);
+
+    // If this chunk has no next LRU then it is the LRU. This only
+    // happens if this is the first allocated chunk.
+    if (pChunk->next_lru == NULL) {
+        m_lruChunk = pChunk;
     }
 }
 
 Chunk* CachingReader::allocateChunk() {
-    if (m_freeChunks.count() == 0)
+    if (m_freeChunks.isEmpty())
         return NULL;
-    return m_freeChunks.takeFirst();
+    Chunk* pChunk = m_freeChunks.back();
+    m_freeChunks.pop_back();
+    return pChunk;
 }
 
 Chunk* CachingReader::allocateChunkExpireLRU() {
@@ -195,6 +305,7 @@ Chunk* CachingReader::allocateChunkExpireLRU() {
             return NULL;
         }
         //qDebug() << "Expiring LRU" << m_lruChunk << m_lruChunk->chunk_number;
+        m_cacheEvictionCounter.increment();
         freeChunk(m_lruChunk);
         chunk = allocateChunk();
     }
@@ -203,29 +314,27 @@ Chunk* CachingReader::allocateChunkExpireLRU() {
 }
 
 Chunk* CachingReader::lookupChunk(int chunk_number) {
-    // Defaults to NULL if it's not in the hash.
-    Chunk* chunk = NULL;
-
-    if (m_allocatedChunks.contains(chunk_number)) {
-        chunk = m_allocatedChunks.value(chunk_number);
-
-        // Make sure we're all in agreement here.
-        if (chunk_number != chunk->chunk_number) {
-            qDebug() << "ERROR: Inconsistent chunk has chunk_number that doesn't match allocated-chunks key.";
-        }
+    Chunk* chunk = indexedChunk(chunk_number);
+    if (chunk == NULL || !chunk->ready) {
+        return NULL;
+    }
 
-        // If this is the LRU chunk then set the previous LRU to the new LRU
-        if (chunk == m_lruChunk && chunk->prev_lru != NULL) {
-            m_lruChunk = chunk->prev_lru;
-        }
-        // Remove the chunk from the list and insert it at the head.
-        m_mruChunk = removeFromLRUList(chunk, m_mruChunk);
-        m_mruChunk = insertIntoLRUList(chunk, m_mruChunk);
+    // If this is the LRU chunk then set the previous LRU to the new LRU
+    if (chunk == m_lruChunk && chunk->prev_lru != NULL) {
+        m_lruChunk = chunk->prev_lru;
     }
+    // Remove the chunk from the list and insert it at the head.
+    m_mruChunk = removeFromLRUList(chunk, m_mruChunk);
+    m_mruChunk = insertIntoLRUList(chunk, m_mruChunk);
 
     return chunk;
 }
 
+void CachingReader::slotDecodeToRam(double value) {
+    m_pWorker->setDecodeToRam(value > 0.0);
+    m_pWorker->wake();
+}
+
 void CachingReader::newTrack(TrackPointer pTrack) {
     m_pWorker->newTrack(pTrack);
     m_pWorker->workReady();
@@ -237,64 +346,35 @@ void CachingReader::process() {
         // qDebug() << "Got ReaderStatusUpdate:" << status.status
         //          << (status.chunk ? status.chunk->chunk_number : -1);
         if (status.status == TRACK_NOT_LOADED) {
+            DecodedTrackCache::release(m_pDecodedTrack);
+            m_pDecodedTrack = NULL;
             m_readerStatus = status.status;
         } else if (status.status == TRACK_LOADED) {
-            freeAllChunks();
+            DecodedTrackCache::release(m_pDecodedTrack);
+            m_pDecodedTrack = NULL;
+            resetChunkIndex(status.trackNumSamples);
             m_readerStatus = status.status;
             m_iTrackNumSamplesCallbackSafe = status.trackNumSamples;
-        } else if (status.status == CHUNK_READ_SUCCESS) {
-            Chunk* pChunk = status.chunk;
-            if (pChunk == NULL) {
-                qDebug() << "ERROR: status.chunk is NULL in CHUNK_READ_SUCCESS ReaderStatusUpdate. Ignoring update.";
-                continue;
-            }
-            Chunk* pChunk2 = m_chunksBeingRead.take(pChunk->chunk_number);
-            if (pChunk2 != pChunk) {
-                qDebug() << "Mismatch in requested chunk to read!";
-            }
-
-            Chunk* pAlreadyExisting = lookupChunk(pChunk->chunk_number);
-            // If this chunk is already in the cache, then we just freshened
-            // it. Free this chunk.
-            if (pAlreadyExisting != NULL) {
-                qDebug() << "CHUNK" << pChunk->chunk_number << "ALREADY EXISTS!";
-                freeChunk(pChunk);
-            } else {
-                //qDebug() << "Inserting chunk" << pChunk << pChunk->chunk_number;
-                m_allocatedChunks.insert(pChunk->chunk_number, pChunk);
-
-                // Insert the chunk into the LRU list
-                m_mruChunk = insertIntoLRUList(pChunk, m_mruChunk);
-
-                // If this chunk has no next LRU then it is the LRU. This only
-                // happens if this is the first allocated chunk.
-                if (pChunk->next_lru == NULL) {
-                    m_lruChunk = pChunk;
-                }
-            }
-        } else if (status.status == CHUNK_READ_EOF) {
-            Chunk* pChunk = status.chunk;
-            if (pChunk == NULL) {
-                qDebug() << "ERROR: status.chunk is NULL in CHUNK_READ_EOF ReaderStatusUpdate. Ignoring update.";
-                continue;
-            }
-            Chunk* pChunk2 = m_chunksBeingRead.take(pChunk->chunk_number);
-            if (pChunk2 != pChunk) {
-                qDebug() << "Mismatch in requested chunk to read!";
-            }
-            freeChunk(pChunk);
-        } else if (status.status == CHUNK_READ_INVALID) {
-            qDebug() << "WARNING: READER THREAD RECEIVED INVALID CHUNK READ";
+        } else if (status.status == CHUNK_READ_SUCCESS ||
+                   status.status == CHUNK_READ_EOF ||
+                   status.status == CHUNK_READ_INVALID ||
+                   status.status == CHUNK_READ_CANCELED) {
             Chunk* pChunk = status.chunk;
             if (pChunk == NULL) {
-                qDebug() << "ERROR: status.chunk is NULL in CHUNK_READ_INVALID ReaderStatusUpdate. Ignoring update.";
+                qDebug() << "ERROR: status.chunk is NULL in ReaderStatusUpdate"
+                         << status.status << ". Ignoring update.";
                 continue;
             }
-            Chunk* pChunk2 = m_chunksBeingRead.take(pChunk->chunk_number);
-            if (pChunk2 != pChunk) {
-                qDebug() << "Mismatch in requested chunk to read!";
+            if (status.status == CHUNK_READ_INVALID) {
+                qDebug() << "WARNING: READER THREAD RECEIVED INVALID CHUNK READ";
+            } else if (status.status == CHUNK_READ_CANCELED) {
+                m_canceledReadCounter.increment();
             }
-            freeChunk(pChunk);
+            chunkReadFinished(pChunk, status.status == CHUNK_READ_SUCCESS);
+        } else if (status.status == DECODED_TRACK_AVAILABLE) {
+            // Only sent after TRACK_LOADED for the same track.
+            DecodedTrackCache::release(m_pDecodedTrack);
+            m_pDecodedTrack = status.decodedTrack;
         }
     }
 }
@@ -358,23 +438,44 @@ int CachingReader::read(int sample, int num_samples, CSAMPLE* buffer) {
     }
 
     for (int chunk_num = start_chunk; chunk_num <= end_chunk; chunk_num++) {
-        Chunk* current = lookupChunk(chunk_num);
+        // Chunks that have been decoded into memory don't go through the
+        // chunk cache.
+        const CSAMPLE* chunk_data = NULL;
+        int chunk_length = 0;
+        if (m_pDecodedTrack != NULL && m_pDecodedTrack->isChunkDecoded(chunk_num)) {
+            chunk_data = m_pDecodedTrack->chunkData(chunk_num);
+            chunk_length = m_pDecodedTrack->chunkLength(chunk_num);
+        } else {
+            Chunk* current = lookupChunk(chunk_num);
+            if (current != NULL) {
+                chunk_data = current->data;
+                chunk_length = current->length;
+            }
+        }
 
         // If the chunk is not in cache, then we must return an error.
-        if (current == NULL) {
+        if (chunk_data == NULL) {
             // qDebug() << "Couldn't get chunk " << chunk_num
             //          << " in read() of [" << sample << "," << sample + num_samples
             //          << "] chunks " << start_chunk << "-" << end_chunk;
 
             // Something is wrong. Break out of the loop, that should fill the
-            // samples requested with zeroes.
-            Counter("CachingReader::read cache miss")++;
+            // samples requested with zeroes. Reads past the end of the track
+            // are not cache misses.
+            if (chunk_num < m_iChunkIndexSize) {
+                m_cacheMissCounter.increment();
+                Chunk* pPending = indexedChunk(chunk_num);
+                if (pPending != NULL) {
+                    pPending->late = true;
+                }
+            }
             break;
         }
+        m_cacheHitCounter.increment();
 
         int chunk_start_sample = CachingReaderWorker::sampleForChunk(chunk_num);
         int chunk_offset = current_sample - chunk_start_sample;
-        int chunk_remaining_samples = current->length - chunk_offset;
+        int chunk_remaining_samples = chunk_length - chunk_offset;
 
         // More sanity checks
         if (current_sample < chunk_start_sample || current_sample % 2 != 0) {
@@ -422,7 +523,7 @@ int CachingReader::read(int sample, int num_samples, CSAMPLE* buffer) {
 
         // TODO(rryan) do a test and see if using memcpy is faster than gcc
         // optimizing the for loop
-        CSAMPLE *data = current->data + chunk_offset;
+        const CSAMPLE *data = chunk_data + chunk_offset;
         memcpy(buffer, data, sizeof(*buffer) * samples_to_read);
         // for (int i=0; i < samples_to_read; i++) {
         //     buffer[i] = data[i];
@@ -454,7 +555,47 @@ void CachingReader::hintAndMaybeWake(const QVector<Hint>& hintList) {
         return;
     }
 
-    QVectorIterator<Hint> iterator(hintList);
+    m_hintGeneration.ref();
+
+    // Request the chunks in order of priority, so that the most important
+    // ones get chunks first if the cache is full. Hint lists are short and use
+    // few distinct priorities, so make one pass per priority instead of
+    // sorting a copy.
+    bool shouldWake = false;
+    bool havePriority = false;
+    int priority = 0;
+    while (true) {
+        bool foundNext = false;
+        int nextPriority = 0;
+        for (int i = 0; i < hintList.size(); ++i) {
+            const int hintPriority = hintList[i].priority;
+            if ((!havePriority || hintPriority > priority) &&
+                    (!foundNext || hintPriority < nextPriority)) {
+                foundNext = true;
+                nextPriority = hintPriority;
+            }
+        }
+        if (!foundNext) {
+            break;
+        }
+        havePriority = true;
+        priority = nextPriority;
+        for (int i = 0; i < hintList.size(); ++i) {
+            if (hintList[i].priority == priority && hintChunks(hintList[i])) {
+                shouldWake = true;
+            }
+        }
+    }
+
+    // If there are chunks to be read, wake up.
+    if (shouldWake) {
+        m_pWorker->workReady();
+    }
+}
+
+bool CachingReader::hintChunks(const Hint& hintToRead) {
+    // Copy, don't use reference.
+    Hint hint = hintToRead;
 
     // To prevent every bit of code having to guess how many samples
     // forward it makes sense to keep in memory, the hinter can provide
@@ -466,69 +607,74 @@ void CachingReader::hintAndMaybeWake(const QVector<Hint>& hintList) {
     // that for stereo samples.
     const int default_samples = 2048;
 
-    QSet<int> chunksToFreshen;
-    while (iterator.hasNext()) {
-        // Copy, don't use reference.
-        Hint hint = iterator.next();
-
-        if (hint.length == 0) {
-            hint.length = default_samples;
-        } else if (hint.length == -1) {
-            hint.sample -= default_samples;
-            hint.length = default_samples;
-            if (hint.sample < 0) {
-                hint.length += hint.sample;
-                hint.sample = 0;
-            }
-        }
-        if (hint.length < 0) {
-            qDebug() << "ERROR: Negative hint length. Ignoring.";
-            continue;
-        }
-        int start_sample = math_max(0, math_min(
-                m_iTrackNumSamplesCallbackSafe, hint.sample));
-        int start_chunk = chunkForSample(start_sample);
-        int end_sample = math_max(0, math_min(
-                m_iTrackNumSamplesCallbackSafe, hint.sample + hint.length - 1));
-        int end_chunk = chunkForSample(end_sample);
-
-        for (int current = start_chunk; current <= end_chunk; ++current) {
-            chunksToFreshen.insert(current);
+    if (hint.length == 0) {
+        hint.length = default_samples;
+    } else if (hint.length == -1) {
+        hint.sample -= default_samples;
+        hint.length = default_samples;
+        if (hint.sample < 0) {
+            hint.length += hint.sample;
+            hint.sample = 0;
         }
     }
+    if (hint.length < 0) {
+        qDebug() << "ERROR: Negative hint length. Ignoring.";
+        return false;
+    }
+    int start_sample = math_max(0, math_min(
+            m_iTrackNumSamplesCallbackSafe, hint.sample));
+    int start_chunk = chunkForSample(start_sample);
+    int end_sample = math_max(0, math_min(
+            m_iTrackNumSamplesCallbackSafe, hint.sample + hint.length - 1));
+    int end_chunk = chunkForSample(end_sample);
 
-    // For every chunk that the hints indicated, check if it is in the cache. If
-    // any are not, then wake.
-    bool shouldWake = false;
-    QSetIterator<int> setIterator(chunksToFreshen);
-    while (setIterator.hasNext()) {
-        int chunk = setIterator.next();
-
+    const int generation = deref(m_hintGeneration);
+    bool requested = false;
+    for (int chunk = start_chunk; chunk <= end_chunk; ++chunk) {
+        if (chunk >= m_iChunkIndexSize) {
+            break;
+        }
+        if (m_pDecodedTrack != NULL && m_pDecodedTrack->isChunkDecoded(chunk)) {
+            continue;
+        }
         // This will cause the chunk to be 'freshened' in the cache. The
         // chunk will be moved to the end of the LRU list.
-        if (!m_chunksBeingRead.contains(chunk) && lookupChunk(chunk) == NULL) {
-            shouldWake = true;
-            Chunk* pChunk = allocateChunkExpireLRU();
-            if (pChunk == NULL) {
-                qDebug() << "ERROR: Couldn't allocate spare Chunk to make ChunkReadRequest.";
-                continue;
-            }
-            m_chunksBeingRead.insert(chunk, pChunk);
-            ChunkReadRequest request;
-            pChunk->chunk_number = chunk;
-            request.chunk = pChunk;
-            // qDebug() << "Requesting read of chunk" << chunk << "into" << pChunk;
-            // qDebug() << "Requesting read into " << request.chunk->data;
-            if (m_chunkReadRequestFIFO.write(&request, 1) != 1) {
-                qDebug() << "ERROR: Could not submit read request for "
-                         << chunk;
+        if (lookupChunk(chunk) != NULL) {
+            continue;
+        }
+        Chunk* pPending = indexedChunk(chunk);
+        if (pPending != NULL) {
+            // Keep the pending read alive. Hints are visited in order of
+            // priority, so the first hint in this generation is the most
+            // important one.
+            if (deref(pPending->hint_generation) != generation) {
+                pPending->priority = hint.priority;
+                pPending->hint_generation = generation;
             }
-            //qDebug() << "Checking chunk " << chunk << " shouldWake:" << shouldWake << " chunksToRead" << m_chunksToRead.size();
+            continue;
         }
-    }
 
-    // If there are chunks to be read, wake up.
-    if (shouldWake) {
-        m_pWorker->workReady();
+        Chunk* pChunk = allocateChunkExpireLRU();
+        if (pChunk == NULL) {
+            qDebug() << "ERROR: Couldn't allocate spare Chunk to make ChunkReadRequest.";
+            continue;
+        }
+        pChunk->chunk_number = chunk;
+        pChunk->priority = hint.priority;
+        pChunk->hint_generation = generation;
+        pChunk->request_time = Time::elapsed();
+        m_chunkIndex[chunk] = pChunk;
+        ChunkReadRequest request;
+        request.chunk = pChunk;
+        // qDebug() << "Requesting read of chunk" << chunk << "into" << pChunk;
+        // qDebug() << "Requesting read into " << request.chunk->data;
+        if (m_chunkReadRequestFIFO.write(&request, 1) != 1) {
+            qDebug() << "ERROR: Could not submit read request for "
+                     << chunk;
+            freeChunk(pChunk);
+            continue;
+        }
+        requested = true;
     }
+    return requested;
 }
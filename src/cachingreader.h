@@ -7,16 +7,17 @@
 #include <QtDebug>
 #include <QList>
 #include <QVector>
-#include <QLinkedList>
-#include <QHash>
 
 #include "defs.h"
 #include "configobject.h"
 #include "trackinfoobject.h"
 #include "engine/engineworker.h"
+#include "util/counter.h"
 #include "util/fifo.h"
 #include "cachingreaderworker.h"
 
+class ControlPushButton;
+
 // A Hint is an indication to the CachingReader that a certain section of a
 // SoundSource will be used 'soon' and so it should be brought into memory by
 // the reader work thread.
@@ -26,14 +27,23 @@ typedef struct Hint {
     // If a range of samples should be present, use length to indicate that the
     // range (sample, sample+length) should be present in memory.
     int length;
-    // Currently unused -- but in the future could be used to prioritize certain
-    // hints over others. A priority of 1 is the highest priority and should be
-    // used for samples that will be read imminently. Hints for samples that
-    // have the potential to be read (i.e. a cue point) should be issued with
-    // priority >10.
+    // Chunks are read in order of priority, lowest value first. One of the
+    // HintPriority values below.
     int priority;
 } Hint;
 
+enum HintPriority {
+    // Samples that are about to be played. Reads of imminent chunks are
+    // never canceled.
+    kHintPriorityImminent = 1,
+    // The loop in and out points of an enabled loop.
+    kHintPriorityLoop = 2,
+    // Cue points, hot cues and the loop in point of a disabled loop.
+    kHintPriorityCue = 10,
+    // Samples beyond the imminent ones in the direction of play.
+    kHintPriorityReadAhead = 20,
+};
+
 // CachingReader provides a layer on top of a SoundSource for reading samples
 // from a file. A cache is provided so that repeated reads to a certain section
 // of a song do not cause disk seeks or unnecessary SoundSource
@@ -45,7 +55,9 @@ class CachingReader : public QObject {
     Q_OBJECT
 
   public:
-    // Construct a CachingReader with the given group.
+    // Construct a CachingReader with the given group. The number of chunks
+    // cached in memory is read from the [<group>],CachingReaderChunks config
+    // key and defaults to kDefaultChunksInMemory.
     CachingReader(const char* _group,
                   ConfigObject<ConfigValue>* _config);
     virtual ~CachingReader();
@@ -58,8 +70,10 @@ class CachingReader : public QObject {
 
     // Issue a list of hints, but check whether any of the hints request a chunk
     // that is not in the cache. If any hints do request a chunk not in cache,
-    // then wake the reader so that it can process them. Must only be called
-    // from the engine callback.
+    // then wake the reader so that it can process them. Chunks are requested
+    // and read in order of hint priority. Pending reads of chunks that are no
+    // longer hinted are canceled. Must only be called from the engine
+    // callback.
     virtual void hintAndMaybeWake(const QVector<Hint>& hintList);
 
     // Request that the CachingReader load a new track. These requests are
@@ -71,7 +85,13 @@ class CachingReader : public QObject {
         m_pWorker->setScheduler(pScheduler);
     }
 
-    const static int maximumChunksInMemory;
+    int chunksInMemory() const {
+        return m_chunks.size();
+    }
+
+    const static int kDefaultChunksInMemory;
+    const static int kMinimumChunksInMemory;
+    const static int kMaximumChunksInMemory;
 
   signals:
     // Emitted once a new track is loaded and ready to be read from.
@@ -79,6 +99,9 @@ class CachingReader : public QObject {
     void trackLoaded(TrackPointer pTrack, int iSampleRate, int iNumSamples);
     void trackLoadFailed(TrackPointer pTrack, QString reason);
 
+  private slots:
+    void slotDecodeToRam(double value);
+
   private:
     // Removes a chunk from the LRU list
     static Chunk* removeFromLRUList(Chunk* chunk, Chunk* head);
@@ -97,16 +120,35 @@ class CachingReader : public QObject {
     FIFO<ChunkReadRequest> m_chunkReadRequestFIFO;
     FIFO<ReaderStatusUpdate> m_readerStatusFIFO;
 
-     // Looks for the provided chunk number in the index of in-memory chunks and
-    // returns it if it is present. If not, returns NULL.
+    // Looks for the provided chunk number in the index of in-memory chunks and
+    // returns it if it has been read. If not, returns NULL.
     Chunk* lookupChunk(int chunk_number);
 
+    // Returns the index entry of chunk_number, which is either a chunk that
+    // has been read, a chunk with a read in progress or NULL.
+    Chunk* indexedChunk(int chunk_number) const {
+        if (chunk_number < 0 || chunk_number >= m_iChunkIndexSize) {
+            return NULL;
+        }
+        return m_chunkIndex[chunk_number];
+    }
+
+    // Resizes the chunk index for a track of trackNumSamples samples and
+    // returns all chunks that have been read to the free list. Chunks with a
+    // read in progress stay reserved until the worker reports back.
+    void resetChunkIndex(int trackNumSamples);
+
+    // Handles a read finished by the worker. The chunk is only inserted into
+    // the cache if it still belongs to the loaded track.
+    void chunkReadFinished(Chunk* pChunk, bool success);
+
+    // Requests the chunks of hint that are not in memory. Returns true if
+    // any were requested.
+    bool hintChunks(const Hint& hint);
+
     // Returns a Chunk to the free list
     void freeChunk(Chunk* pChunk);
 
-    // Returns all allocated chunks to the free list
-    void freeAllChunks();
-
     // Gets a chunk from the free list. Returns NULL if none available.
     Chunk* allocateChunk();
 
@@ -117,14 +159,16 @@ class CachingReader : public QObject {
 
     // Keeps track of free Chunks we've allocated
     QVector<Chunk*> m_chunks;
-    // List of free chunks available for use.
-    QList<Chunk*> m_freeChunks;
-    // List of reserved chunks with reads in progress
-    QHash<int, Chunk*> m_chunksBeingRead;
+    // Stack of free chunks available for use. Reserved for all chunks so that
+    // it never allocates.
+    QVector<Chunk*> m_freeChunks;
 
-    // Keeps track of what Chunks we've allocated and indexes them based on what
-    // chunk number they are allocated to.
-    QHash<int, Chunk*> m_allocatedChunks;
+    // Maps chunk numbers of the loaded track to chunks that have been read or
+    // are being read. Only the first m_iChunkIndexSize entries are used. The
+    // index only grows, so it is only resized on the engine thread when a
+    // track is loaded that is longer than all previous ones.
+    QVector<Chunk*> m_chunkIndex;
+    int m_iChunkIndexSize;
 
     // The linked list of recently-used chunks.
     Chunk* m_mruChunk;
@@ -135,6 +179,27 @@ class CachingReader : public QObject {
 
     int m_iTrackNumSamplesCallbackSafe;
 
+    // The loaded track decoded into memory by the worker, pinned by the
+    // engine. Chunks that have been decoded are read from it directly.
+    DecodedTrack* m_pDecodedTrack;
+    // Toggles decoding whole tracks into memory for this deck.
+    ControlPushButton* m_pDecodeToRam;
+
+    // Incremented for every list of hints. Chunks that were not hinted for a
+    // while are stale.
+    QAtomicInt m_hintGeneration;
+
+    // Cache statistics per chunk, for sizing the cache.
+    Counter m_cacheHitCounter;
+    Counter m_cacheMissCounter;
+    Counter m_cacheEvictionCounter;
+    // Chunks that arrived after read() needed them and stale reads that were
+    // canceled.
+    Counter m_lateChunkCounter;
+    Counter m_canceledReadCounter;
+    // Time from requesting a chunk until it is read.
+    StatKey m_readLatencyKey;
+
     CachingReaderWorker* m_pWorker;
 };
 
@@ -4,14 +4,16 @@
 
 #include <QtDebug>
 #include <QFileInfo>
+#include <QThread>
 
 #include "controlobject.h"
 #include "controlobjectthread.h"
 
 #include "cachingreaderworker.h"
+#include "cachingreader.h"
+#include "decodedtrackcache.h"
 #include "trackinfoobject.h"
 #include "soundsourceproxy.h"
-#include "sampleutil.h"
 #include "util/compatibility.h"
 #include "util/event.h"
 
@@ -27,24 +29,33 @@
 
 const int CachingReaderWorker::kChunkLength = CHUNK_LENGTH;
 const int CachingReaderWorker::kSamplesPerChunk = CHUNK_LENGTH / sizeof(CSAMPLE);
+// Hints are given once per callback, so this is about 40 to 200 ms.
+const int CachingReaderWorker::kStaleHintGenerations = 8;
 
 
 CachingReaderWorker::CachingReaderWorker(const char* group,
         FIFO<ChunkReadRequest>* pChunkReadRequestFIFO,
-        FIFO<ReaderStatusUpdate>* pReaderStatusFIFO)
+        FIFO<ReaderStatusUpdate>* pReaderStatusFIFO,
+        const QAtomicInt* pHintGeneration)
         : m_pGroup(group),
           m_tag(QString("CachingReaderWorker %1").arg(m_pGroup)),
           m_pChunkReadRequestFIFO(pChunkReadRequestFIFO),
           m_pReaderStatusFIFO(pReaderStatusFIFO),
+          m_pHintGeneration(pHintGeneration),
           m_pCurrentSoundSource(NULL),
           m_iTrackNumSamples(0),
-          m_pSample(NULL),
+          m_iSourcePosition(-1),
+          m_decodeToRam(0),
+          m_pDecodedTrack(NULL),
+          m_bDecodingStarted(false),
+          m_iDecodeCursor(0),
           m_stop(0) {
-    m_pSample = new SAMPLE[kSamplesPerChunk];
+    // As deep as the request FIFO.
+    m_pendingReads.reserve(pChunkReadRequestFIFO->writeAvailable());
 }
 
 CachingReaderWorker::~CachingReaderWorker() {
-    delete [] m_pSample;
+    stopDecoding();
     delete m_pCurrentSoundSource;
 }
 
@@ -63,17 +74,35 @@ void CachingReaderWorker::processChunkReadRequest(ChunkReadRequest* request,
     // Stereo samples
     int sample_position = sampleForChunk(chunk_number);
     int samples_remaining = m_iTrackNumSamples - sample_position;
-    int samples_to_read = math_min(kSamplesPerChunk, samples_remaining);
 
     // Bogus chunk number
-    if (samples_to_read <= 0) {
+    if (samples_remaining <= 0) {
         update->status = CHUNK_READ_EOF;
         return;
     }
 
-    m_pCurrentSoundSource->seek(sample_position);
-    int samples_read = m_pCurrentSoundSource->read(samples_to_read,
-                                                   m_pSample);
+    // Decode the rest of the track into memory from where it is played.
+    m_iDecodeCursor = chunk_number + 1;
+
+    CSAMPLE* buffer = request->chunk->data;
+    //qDebug() << "Reading into " << buffer;
+    int samples_read = 0;
+    if (m_pDecodedTrack != NULL && m_pDecodedTrack->isChunkDecoded(chunk_number)) {
+        samples_read = m_pDecodedTrack->chunkLength(chunk_number);
+        memcpy(buffer, m_pDecodedTrack->chunkData(chunk_number),
+               sizeof(*buffer) * samples_read);
+    } else {
+        samples_read = readChunk(chunk_number, buffer);
+        // Don't read the chunk again when decoding the track into memory.
+        CSAMPLE* decoded = m_pDecodedTrack != NULL && samples_read > 0 ?
+                m_pDecodedTrack->claimChunk(chunk_number) : NULL;
+        if (decoded != NULL) {
+            memcpy(decoded, buffer, sizeof(*buffer) * samples_read);
+            finishDecodedChunk(chunk_number, samples_read);
+        } else if (samples_read <= 0) {
+            m_failedChunks.insert(chunk_number);
+        }
+    }
 
     // If we've run out of music, the SoundSource can return 0 samples.
     // Remember that SoundSourc->getLength() (which is m_iTrackNumSamples) can
@@ -83,20 +112,111 @@ void CachingReaderWorker::processChunkReadRequest(ChunkReadRequest* request,
         return;
     }
 
-    // TODO(XXX) This loop can't be done with a memcpy, but could be done with
-    // SSE.
-    CSAMPLE* buffer = request->chunk->data;
-    //qDebug() << "Reading into " << buffer;
-    SampleUtil::convert(buffer, m_pSample, samples_read);
+    update->status = CHUNK_READ_SUCCESS;
+    update->chunk->length = samples_read;
+}
 
-    // Normalize the samples from [SHRT_MIN, SHRT_MAX] to [-1.0, 1.0].
-    // TODO(rryan): Change the SoundSource API to do this for us.
-    for (int i = 0; i < samples_read; ++i) {
-        buffer[i] /= SHRT_MAX;
+int CachingReaderWorker::readChunk(int chunk_number, CSAMPLE* buffer) {
+    int sample_position = sampleForChunk(chunk_number);
+    int samples_to_read = math_min(kSamplesPerChunk,
+                                   m_iTrackNumSamples - sample_position);
+    if (samples_to_read <= 0) {
+        return 0;
     }
 
-    update->status = CHUNK_READ_SUCCESS;
-    update->chunk->length = samples_read;
+    if (sample_position != m_iSourcePosition) {
+        m_pCurrentSoundSource->seek(sample_position);
+    }
+    // The sound source decodes straight into the chunk.
+    int samples_read = m_pCurrentSoundSource->readFloat(samples_to_read,
+                                                        buffer);
+    if (samples_read <= 0) {
+        m_iSourcePosition = -1;
+        return 0;
+    }
+    m_iSourcePosition = sample_position + samples_read;
+    return samples_read;
+}
+
+void CachingReaderWorker::setDecodeToRam(bool decodeToRam) {
+    m_decodeToRam = decodeToRam ? 1 : 0;
+}
+
+void CachingReaderWorker::startDecoding() {
+    m_bDecodingStarted = true;
+    DecodedTrackCache* pCache = DecodedTrackCache::instance();
+    if (pCache == NULL || m_decodedTrackKey.isEmpty()) {
+        return;
+    }
+    m_pDecodedTrack = pCache->acquire(m_decodedTrackKey, m_iTrackNumSamples);
+    if (m_pDecodedTrack == NULL) {
+        return;
+    }
+    qDebug() << m_pGroup << "Decoding into memory:" << m_decodedTrackKey
+             << (m_pDecodedTrack->isComplete() ? "(already decoded)" : "");
+
+    ReaderStatusUpdate status;
+    status.status = DECODED_TRACK_AVAILABLE;
+    status.trackNumSamples = m_iTrackNumSamples;
+    status.decodedTrack = m_pDecodedTrack;
+    DecodedTrackCache::pin(m_pDecodedTrack);
+    m_pReaderStatusFIFO->writeBlocking(&status, 1);
+}
+
+void CachingReaderWorker::stopDecoding() {
+    DecodedTrackCache::release(m_pDecodedTrack);
+    m_pDecodedTrack = NULL;
+    m_bDecodingStarted = false;
+    m_iDecodeCursor = 0;
+    m_failedChunks.clear();
+}
+
+bool CachingReaderWorker::decodeNextChunk() {
+    if (m_pCurrentSoundSource == NULL || !deref(m_decodeToRam)) {
+        return false;
+    }
+    if (!m_bDecodingStarted) {
+        startDecoding();
+    }
+    if (m_pDecodedTrack == NULL || m_pDecodedTrack->isComplete()) {
+        return false;
+    }
+
+    // Continue after the chunk that was read last, so the region that is
+    // playing is decoded first, and wrap around to the start of the track.
+    const int numChunks = m_pDecodedTrack->numChunks();
+    for (int i = 0; i < numChunks; ++i) {
+        int chunk_number = (m_iDecodeCursor + i) % numChunks;
+        if (m_failedChunks.contains(chunk_number)) {
+            continue;
+        }
+        CSAMPLE* buffer = m_pDecodedTrack->claimChunk(chunk_number);
+        if (buffer == NULL) {
+            continue;
+        }
+        finishDecodedChunk(chunk_number, readChunk(chunk_number, buffer));
+        m_iDecodeCursor = chunk_number + 1;
+        return true;
+    }
+    // The remaining chunks are being decoded by the worker of another deck
+    // that has the same track loaded, or could not be read.
+    return false;
+}
+
+void CachingReaderWorker::finishDecodedChunk(int chunk_number,
+                                             int samples_read) {
+    // A chunk that starts past the end of the track is complete when empty.
+    // Otherwise reading nothing means that decoding failed, and publishing
+    // the chunk would make it silent until the track is evicted.
+    if (samples_read > 0 ||
+            sampleForChunk(chunk_number) >= m_iTrackNumSamples) {
+        m_pDecodedTrack->setChunkDecoded(chunk_number, samples_read);
+    } else {
+        qWarning() << m_pGroup << "Could not decode chunk" << chunk_number
+                   << "into memory";
+        m_pDecodedTrack->releaseChunk(chunk_number);
+        m_failedChunks.insert(chunk_number);
+    }
 }
 
 // WARNING: Always called from a different thread (GUI)
@@ -106,11 +226,55 @@ void CachingReaderWorker::newTrack(TrackPointer pTrack) {
     m_newTrackMutex.unlock();
 }
 
-void CachingReaderWorker::run() {
-    TrackPointer pLoadTrack;
+bool CachingReaderWorker::processPendingReads() {
     ChunkReadRequest request;
+    while (m_pChunkReadRequestFIFO->read(&request, 1) == 1) {
+        m_pendingReads.append(request.chunk);
+    }
+    if (m_pendingReads.isEmpty()) {
+        return false;
+    }
+
+    // Pick the pending read with the most important hint, oldest first, and
+    // cancel reads that are no longer hinted so that speculative reads don't
+    // hold up imminent ones after a seek.
     ReaderStatusUpdate status;
+    const uint generation = static_cast<uint>(deref(*m_pHintGeneration));
+    int next = -1;
+    int nextPriority = 0;
+    for (int i = 0; i < m_pendingReads.size(); ++i) {
+        Chunk* pChunk = m_pendingReads[i];
+        const int priority = deref(pChunk->priority);
+        const uint age = generation -
+                static_cast<uint>(deref(pChunk->hint_generation));
+        if (priority > kHintPriorityImminent &&
+                age > static_cast<uint>(kStaleHintGenerations)) {
+            status.status = CHUNK_READ_CANCELED;
+            status.chunk = pChunk;
+            m_pReaderStatusFIFO->writeBlocking(&status, 1);
+            m_pendingReads.remove(i--);
+            continue;
+        }
+        if (next < 0 || priority < nextPriority) {
+            next = i;
+            nextPriority = priority;
+        }
+    }
+    if (next < 0) {
+        return true;
+    }
+
+    request.chunk = m_pendingReads[next];
+    m_pendingReads.remove(next);
+    processChunkReadRequest(&request, &status);
+    m_pReaderStatusFIFO->writeBlocking(&status, 1);
+    return true;
+}
+
+void CachingReaderWorker::run() {
+    TrackPointer pLoadTrack;
 
+    QThread::currentThread()->setObjectName(m_tag);
     Event::start(m_tag);
     while (!deref(m_stop)) {
         if (m_newTrack) {
@@ -119,10 +283,11 @@ void CachingReaderWorker::run() {
             m_newTrack = TrackPointer();
             m_newTrackMutex.unlock();
             loadTrack(pLoadTrack);
-        } else if (m_pChunkReadRequestFIFO->read(&request, 1) == 1) {
-            // Read the requested chunks.
-            processChunkReadRequest(&request, &status);
-            m_pReaderStatusFIFO->writeBlocking(&status, 1);
+        } else if (processPendingReads()) {
+            // Read the requested chunks one at a time so that new requests
+            // are considered after every chunk.
+        } else if (decodeNextChunk()) {
+            // Keep decoding the track into memory until a read is requested.
         } else {
             Event::end(m_tag);
             m_semaRun.acquire();
@@ -142,11 +307,14 @@ void CachingReaderWorker::loadTrack(TrackPointer pTrack) {
     status.chunk = NULL;
     status.trackNumSamples = 0;
 
+    stopDecoding();
+    m_decodedTrackKey.clear();
     if (m_pCurrentSoundSource != NULL) {
         delete m_pCurrentSoundSource;
         m_pCurrentSoundSource = NULL;
     }
     m_iTrackNumSamples = 0;
+    m_iSourcePosition = -1;
 
     QString filename = pTrack->getLocation();
 
@@ -183,16 +351,41 @@ void CachingReaderWorker::loadTrack(TrackPointer pTrack) {
     // Clear the chunks to read list.
     ChunkReadRequest request;
     while (m_pChunkReadRequestFIFO->read(&request, 1) == 1) {
-        qDebug() << "Skipping read request for " << request.chunk->chunk_number;
+        m_pendingReads.append(request.chunk);
+    }
+    foreach (Chunk* pChunk, m_pendingReads) {
+        qDebug() << "Skipping read request for " << pChunk->chunk_number;
         status.status = CHUNK_READ_INVALID;
-        status.chunk = request.chunk;
+        status.chunk = pChunk;
         m_pReaderStatusFIFO->writeBlocking(&status, 1);
     }
+    m_pendingReads.resize(0);
+
+    // The modification time is part of the key so that a track that was
+    // changed on disk is decoded again.
+    m_decodedTrackKey = QString("%1 %2").arg(
+        QFileInfo(filename).lastModified().toString(Qt::ISODate), filename);
+    if (deref(m_decodeToRam)) {
+        startDecoding();
+    }
 
     // Emit that the track is loaded.
     emit(trackLoaded(pTrack, trackSampleRate, m_iTrackNumSamples));
 }
 
+void CachingReaderWorker::loadSoundSourceForTest(
+        Mixxx::SoundSource* pSoundSource, const QString& key) {
+    stopDecoding();
+    delete m_pCurrentSoundSource;
+    m_pCurrentSoundSource = pSoundSource;
+    m_iTrackNumSamples = pSoundSource->length();
+    m_iSourcePosition = -1;
+    m_decodedTrackKey = key;
+    if (deref(m_decodeToRam)) {
+        startDecoding();
+    }
+}
+
 void CachingReaderWorker::quitWait() {
     m_stop = 1;
     m_semaRun.release();
@@ -2,10 +2,13 @@
 #define CACHINGREADERWORKER_H
 
 #include <QtDebug>
+#include <QAtomicInt>
 #include <QMutex>
 #include <QSemaphore>
+#include <QSet>
 #include <QThread>
 #include <QString>
+#include <QVector>
 
 #include "trackinfoobject.h"
 #include "engine/engineworker.h"
@@ -14,6 +17,7 @@
 namespace Mixxx {
     class SoundSource;
 }
+class DecodedTrack;
 
 // A Chunk is a section of audio that is being cached. The chunk_number can be
 // used to figure out the sample number of the first sample in data by using
@@ -22,8 +26,20 @@ typedef struct Chunk {
     int chunk_number;
     int length;
     CSAMPLE* data;
+    // False while the chunk is being read by the worker. Only touched by the
+    // engine thread.
+    bool ready;
     Chunk* prev_lru;
     Chunk* next_lru;
+    // The priority of the most important hint for the chunk and the hint
+    // generation it was last hinted in. Written by the engine thread and read
+    // by the worker to order and cancel pending reads.
+    QAtomicInt priority;
+    QAtomicInt hint_generation;
+    // When the read was requested and whether the engine needed the chunk
+    // before it was read. Only touched by the engine thread.
+    qint64 request_time;
+    bool late;
 } Chunk;
 
 typedef struct ChunkReadRequest {
@@ -38,16 +54,23 @@ enum ReaderStatus {
     TRACK_LOADED,
     CHUNK_READ_SUCCESS,
     CHUNK_READ_EOF,
-    CHUNK_READ_INVALID
+    CHUNK_READ_INVALID,
+    // A pending read was dropped because the chunk is no longer hinted.
+    CHUNK_READ_CANCELED,
+    // The loaded track is being decoded into memory. Hands a pin on
+    // decodedTrack over to the CachingReader.
+    DECODED_TRACK_AVAILABLE
 };
 
 typedef struct ReaderStatusUpdate {
     ReaderStatus status;
     Chunk* chunk;
     int trackNumSamples;
+    DecodedTrack* decodedTrack;
     ReaderStatusUpdate() {
         status = INVALID;
         chunk = NULL;
+        decodedTrack = NULL;
     }
 } ReaderStatusUpdate;
 
@@ -56,24 +79,47 @@ class CachingReaderWorker : public EngineWorker {
 
   public:
     // Construct a CachingReader with the given group.
+    // pHintGeneration is incremented by the CachingReader every time it is
+    // given hints.
     CachingReaderWorker(const char* group,
             FIFO<ChunkReadRequest>* pChunkReadRequestFIFO,
-            FIFO<ReaderStatusUpdate>* pReaderStatusFIFO);
+            FIFO<ReaderStatusUpdate>* pReaderStatusFIFO,
+            const QAtomicInt* pHintGeneration);
     virtual ~CachingReaderWorker();
 
     // Request to load a new track. wake() must be called afer wards.
     virtual void newTrack(TrackPointer pTrack);
 
+    // Enables decoding the whole loaded track into memory in the background,
+    // starting around the most recently read chunk. Decoded chunks are served
+    // from memory and handed to the CachingReader so that it can read them
+    // directly. Safe to call from any thread, wake() must be called after
+    // wards.
+    void setDecodeToRam(bool decodeToRam);
+
     // Run upkeep operations like loading tracks and reading from file. Run by a
     // thread pool via the EngineWorkerScheduler.
     virtual void run();
 
     void quitWait();
 
+    // Makes pSoundSource the loaded track, decoded into memory under key if
+    // decoding is enabled. Takes ownership of pSoundSource. Only used by
+    // tests.
+    void loadSoundSourceForTest(Mixxx::SoundSource* pSoundSource,
+                                const QString& key);
+    bool decodeNextChunkForTest() {
+        return decodeNextChunk();
+    }
+
     // A Chunk is a memory-resident section of audio that has been cached. Each
     // chunk holds a fixed number of samples given by kSamplesPerChunk.
     const static int kChunkLength, kSamplesPerChunk;
 
+    // Pending reads of chunks that were not hinted for this many hint
+    // generations are canceled, unless they are imminent.
+    const static int kStaleHintGenerations;
+
     // Given a chunk number, return the start sample number for the chunk.
     inline static int sampleForChunk(int chunk_number) {
         return chunk_number * kSamplesPerChunk;
@@ -94,6 +140,10 @@ class CachingReaderWorker : public EngineWorker {
     // reader thread.
     FIFO<ChunkReadRequest>* m_pChunkReadRequestFIFO;
     FIFO<ReaderStatusUpdate>* m_pReaderStatusFIFO;
+    const QAtomicInt* m_pHintGeneration;
+
+    // Requested chunks that have not been read yet, in request order.
+    QVector<Chunk*> m_pendingReads;
 
     // Queue of Tracks to load, and the corresponding lock. Must acquire the
     // lock to touch.
@@ -103,17 +153,53 @@ class CachingReaderWorker : public EngineWorker {
     // Internal method to load a track. Emits trackLoaded when finished.
     void loadTrack(TrackPointer pTrack);
 
+    // Moves new requests from the FIFO to the pending reads, cancels stale
+    // ones and reads the most important pending chunk. Returns false if there
+    // was nothing to do.
+    bool processPendingReads();
+
     // Read the given chunk_number from the file into pChunk's data
     // buffer. Fills length/sample information about Chunk* as well.
     void processChunkReadRequest(ChunkReadRequest* request,
                                  ReaderStatusUpdate* update);
 
+    // Reads and normalizes the samples of chunk_number from the SoundSource
+    // into buffer. Returns the number of samples read, 0 at the end of the
+    // track.
+    int readChunk(int chunk_number, CSAMPLE* buffer);
+
+    // Acquires the decoded track for the loaded track from the
+    // DecodedTrackCache and hands it to the CachingReader.
+    void startDecoding();
+    // Releases the decoded track of the previous track.
+    void stopDecoding();
+    // Decodes the next chunk of the decoded track. Returns false if there is
+    // nothing left to decode.
+    bool decodeNextChunk();
+    // Publishes a chunk of the decoded track that was claimed and read into,
+    // or hands it back if the read failed so that it is decoded again later.
+    void finishDecodedChunk(int chunk_number, int samples_read);
+
     // The current sound source of the track loaded
     Mixxx::SoundSource* m_pCurrentSoundSource;
     int m_iTrackNumSamples;
+    // The sample the next read of m_pCurrentSoundSource starts at, so that
+    // sequential reads don't seek. -1 if unknown.
+    int m_iSourcePosition;
+
+    QAtomicInt m_decodeToRam;
+    // Key of the loaded track in the DecodedTrackCache.
+    QString m_decodedTrackKey;
+    // The decoded loaded track, pinned by the worker. NULL if decoding is
+    // disabled or the track doesn't fit into the memory budget.
+    DecodedTrack* m_pDecodedTrack;
+    bool m_bDecodingStarted;
+    // The chunk to continue decoding at.
+    int m_iDecodeCursor;
+    // Chunks of the loaded track that could not be read. They are not
+    // decoded again until the track is loaded again.
+    QSet<int> m_failedChunks;
 
-    // Temporary buffer for reading from SoundSources
-    SAMPLE* m_pSample;
     QAtomicInt m_stop;
 };
 
@@ -120,6 +120,7 @@ template <class ValueType> ConfigObject<ValueType>::ConfigObject(QString file)
 
 template <class ValueType> ConfigObject<ValueType>::~ConfigObject()
 {
+    m_hash.clear();
     while (m_list.size() > 0) {
         ConfigOption<ValueType>* pConfigOption = m_list.takeLast();
         delete pConfigOption;
@@ -129,23 +130,12 @@ template <class ValueType> ConfigObject<ValueType>::~ConfigObject()
 template <class ValueType>
 ConfigOption<ValueType> *ConfigObject<ValueType>::set(ConfigKey k, ValueType v)
 {
-    // Search for key in list, and set value if found
-    QListIterator<ConfigOption<ValueType>* > iterator(m_list);
-    ConfigOption<ValueType>* it;
-    while (iterator.hasNext())
+    // Look up the key, and set value if found
+    ConfigOption<ValueType>* it = m_hash.value(k, NULL);
+    if (it != NULL)
     {
-        it = iterator.next();
-//         if (QString::compare(it->val->value, v.value, Qt::CaseInsensitive) == 0)
-        if (it->key->group == k.group && it->key->item == k.item)
-        {
-            //qDebug() << "set found." << group << "," << item;
-            //cout << "1: " << v.value << "\n";
-            //qDebug() << "configobject " << it->val;
-            it->val->valCopy(v); // Should be done smarter using object copying
-            //qDebug() << "configobject " << it->val;
-            //cout << "2: " << it->val->value << "\n";
-            return it;
-        }
+        it->val->valCopy(v); // Should be done smarter using object copying
+        return it;
     }
 
     // If key is not found, insert it into the list of config objects
@@ -153,45 +143,30 @@ ConfigOption<ValueType> *ConfigObject<ValueType>::set(ConfigKey k, ValueType v)
     it = new ConfigOption<ValueType>(key, new ValueType(v));
     //qDebug() << "new configobject " << it->val;
     m_list.append(it);
+    m_hash.insert(*key, it);
     return it;
 }
 
 template <class ValueType>
 ConfigOption<ValueType> *ConfigObject<ValueType>::get(ConfigKey k)
 {
-    QListIterator<ConfigOption<ValueType>* > iterator(m_list);
-    ConfigOption<ValueType>* it;
-    while (iterator.hasNext())
+    ConfigOption<ValueType>* it = m_hash.value(k, NULL);
+    if (it != NULL)
     {
-        it = iterator.next();
-        //qDebug() << it->key->group << k->group << it->key->item << k->item;
-        if (it->key->group == k.group && it->key->item == k.item)
-        {
-            //cout << it->key->group << ":" << it->key->item << ", val: " << it->val->value << "\n";
-            return it;
-        }
+        return it;
     }
     // If key is not found, insert into list with null values
     ConfigKey * key = new ConfigKey(k.group, k.item);
     it = new ConfigOption<ValueType>(key, new ValueType(""));
     m_list.append(it);
+    m_hash.insert(*key, it);
     return it;
 }
 
 template <class ValueType>
 bool ConfigObject<ValueType>::exists(ConfigKey k)
 {
-    QListIterator<ConfigOption<ValueType>* > iterator(m_list);
-    ConfigOption<ValueType>* it;
-    while (iterator.hasNext())
-    {
-        it = iterator.next();
-        if (it->key->group == k.group && it->key->item == k.item)
-        {
-            return true;
-        }
-    }
-    return false;
+    return m_hash.contains(k);
 }
 
 template <class ValueType>
@@ -296,6 +271,7 @@ template <class ValueType> void ConfigObject<ValueType>::clear()
     // members of list. Instead all member values should be set to some
     // null value.
     m_list.clear();
+    m_hash.clear();
 
 }
 
@@ -125,7 +125,10 @@ template <class ValueType> class ConfigObject {
     QString getSettingsPath() const;
 
   protected:
+    // The options in the order they were read or added, which Save() keeps.
     QList< ConfigOption<ValueType>* > m_list;
+    // The options of m_list by key so that they are found in constant time.
+    QHash<ConfigKey, ConfigOption<ValueType>* > m_hash;
     QString m_filename;
 
     /** Loads and parses the configuration file. Returns false if the file could
@@ -10,6 +10,7 @@
 
 #include "controllers/controller.h"
 #include "controllers/defs_controllers.h"
+#include "util/time.h"
 
 Controller::Controller()
         : QObject(),
@@ -40,6 +41,13 @@ void Controller::startEngine()
         stopEngine();
     }
     m_pEngine = new ControllerEngine(this);
+
+    m_messagesStatKey = Stat::registerKey(
+            QString("Controller %1 messages").arg(m_sDeviceName));
+    m_coalescedStatKey = Stat::registerKey(
+            QString("Controller %1 coalesced messages").arg(m_sDeviceName));
+    m_latencyStatKey = Stat::registerKey(
+            QString("Controller %1 handling latency").arg(m_sDeviceName));
 }
 
 void Controller::stopEngine() {
@@ -98,6 +106,21 @@ void Controller::send(QList<int> data, unsigned int length) {
     send(msg);
 }
 
+void Controller::messageHandled(qint64 timestamp) {
+    Stat::track(m_messagesStatKey, Stat::COUNTER,
+                Stat::COUNT | Stat::REPORTS_PER_SECOND, 1.0);
+    if (timestamp >= 0) {
+        Stat::track(m_latencyStatKey, Stat::DURATION_NANOSEC,
+                    Stat::AVERAGE | Stat::SAMPLE_VARIANCE | Stat::MIN | Stat::MAX,
+                    Time::elapsed() - timestamp);
+    }
+}
+
+void Controller::messagesCoalesced(int count) {
+    Stat::track(m_coalescedStatKey, Stat::COUNTER,
+                Stat::COUNT | Stat::SUM, count);
+}
+
 void Controller::receive(const QByteArray data) {
     if (m_pEngine == NULL) {
         //qWarning() << "Controller::receive called with no active engine!";
@@ -131,5 +154,6 @@ void Controller::receive(const QByteArray data) {
             qWarning() << "Controller: Invalid script function" << function;
         }
     }
+    messageHandled(-1);
 }
 
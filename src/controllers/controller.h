@@ -18,6 +18,7 @@
 #include "controllers/controllerpresetvisitor.h"
 #include "controllers/controllerpresetfilehandler.h"
 #include "controllers/mixxxcontrol.h"
+#include "util/stat.h"
 
 class Controller : public QObject, ControllerPresetVisitor {
     Q_OBJECT
@@ -126,6 +127,14 @@ class Controller : public QObject, ControllerPresetVisitor {
         m_controlToLearn = control;
     }
 
+    // Reports a handled message to the stats of this controller. timestamp is
+    // the Time::elapsed() time the message was received at, or -1 if not
+    // known, in which case only the message rate is reported.
+    void messageHandled(qint64 timestamp);
+    // Reports messages that were dropped because a later message in the same
+    // burst superseded them.
+    void messagesCoalesced(int count);
+
 
   private slots:
     virtual int open() = 0;
@@ -133,6 +142,9 @@ class Controller : public QObject, ControllerPresetVisitor {
     // Requests that the device poll if it is a polling device. Returns true
     // if events were handled.
     virtual bool poll() { return false; }
+    // Returns a file descriptor that becomes readable when poll() has input to
+    // handle, or -1 if the device has to be polled on a timer.
+    virtual int pollDescriptor() const { return -1; }
 
   private:
     // This must be reimplemented by sub-classes desiring to send raw bytes to a
@@ -164,8 +176,12 @@ class Controller : public QObject, ControllerPresetVisitor {
     bool m_bDebug;
     bool m_bLearning;
     MixxxControl m_controlToLearn;
+    StatKey m_messagesStatKey;
+    StatKey m_coalescedStatKey;
+    StatKey m_latencyStatKey;
 
     friend class ControllerManager; // accesses lots of our stuff, but in the same thread
+    friend class ControllerPollNotifiers; // polls the device in the same thread
 };
 
 #endif
@@ -11,6 +11,7 @@
 #include "controllers/controller.h"
 #include "controlobject.h"
 #include "controlobjectthread.h"
+#include "engine/controleventqueue.h"
 #include "errordialoghandler.h"
 #include "mathstuff.h"
 #include "playermanager.h"
@@ -28,7 +29,8 @@ ControllerEngine::ControllerEngine(Controller* controller)
       m_pController(controller),
       m_bDebug(false),
       m_bPopups(false),
-      m_pBaClass(NULL) {
+      m_pBaClass(NULL),
+      m_eventTimestamp(-1) {
 
     // Handle error dialog buttons
     qRegisterMetaType<QMessageBox::StandardButton>("QMessageBox::StandardButton");
@@ -622,6 +624,13 @@ double ControllerEngine::getValue(QString group, QString name) {
         qWarning() << "ControllerEngine: Unknown control" << group << name << ", returning 0.0";
         return 0.0;
     }
+    // A script that reads back a control it changed expects the new value,
+    // even if the engine has not applied it yet.
+    double value = 0.0;
+    ControlObject* pControl = ControlObject::getControl(cot->getKey());
+    if (pControl && ControlEventQueue::pendingValue(pControl, &value)) {
+        return value;
+    }
     return cot->get();
 }
 
@@ -642,7 +651,14 @@ void ControllerEngine::setValue(QString group, QString name, double newValue) {
     if (cot != NULL) {
         ControlObject* pControl = ControlObject::getControl(cot->getKey());
         if (pControl && !m_st.ignore(pControl, newValue)) {
-            cot->slotSet(newValue);
+            if (m_eventTimestamp < 0) {
+                // E.g. from a timer. Changes that are still queued are older.
+                ControlEventQueue::setDirectly(pControl);
+                cot->slotSet(newValue);
+            } else if (!ControlEventQueue::schedule(
+                    pControl, newValue, m_eventTimestamp)) {
+                cot->slotSet(newValue);
+            }
         }
     }
 }
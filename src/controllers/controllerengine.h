@@ -81,6 +81,12 @@ class ControllerEngine : public QObject {
     QList<QString>& getScriptFunctionPrefixes() { return m_scriptFunctionPrefixes; };
     /** Disconnect a ControllerEngineConnection */
     void disconnectControl(const ControllerEngineConnection conn);
+    /** Set the time at which the event that the scripts are executed for was
+        received, or -1 if not known. While it is set, changes of controls that
+        the engine schedules are applied at that time. */
+    void setEventTimestamp(qint64 timestamp) {
+        m_eventTimestamp = timestamp;
+    }
 
   protected:
     Q_INVOKABLE double getValue(QString group, QString name);
@@ -170,6 +176,7 @@ class ControllerEngine : public QObject {
     QHash<int, TimerInfo> m_timers;
     SoftTakeover m_st;
     ByteArrayClass *m_pBaClass;
+    qint64 m_eventTimestamp;
     // 256 (default) available virtual decks is enough I would think.
     //  If more are needed at run-time, these will move to the heap automatically
     QVarLengthArray<int> m_intervalAccumulator, m_brakeKeylock;
@@ -9,6 +9,7 @@
 
 #include "util/trace.h"
 #include "controllers/controllermanager.h"
+#include "controllers/controllerpollnotifiers.h"
 #include "controllers/defs_controllers.h"
 #include "controllers/controllerlearningeventfilter.h"
 
@@ -27,7 +28,9 @@
 
 // http://developer.qt.nokia.com/wiki/Threads_Events_QObjects
 
-// Poll every 1ms (where possible) for good controller response
+// Poll every 1ms (where possible) for good controller response. Devices that
+// have a Controller::pollDescriptor() are not polled but handled when it
+// becomes readable.
 #ifdef __LINUX__
 // Many Linux distros ship with the system tick set to 250Hz so 1ms timer
 // reportedly causes CPU hosage. See Bug #990992 rryan 6/2012
@@ -59,7 +62,8 @@ ControllerManager::ControllerManager(ConfigObject<ConfigValue>* pConfig)
           // ControllerManager because the CM is moved to its own thread and runs
           // its own event loop.
           m_pControllerLearningEventFilter(new ControllerLearningEventFilter()),
-          m_pollTimer(this) {
+          m_pollTimer(this),
+          m_pPollNotifiers(new ControllerPollNotifiers(this)) {
     qRegisterMetaType<ControllerPresetPointer>("ControllerPresetPointer");
 
     // Create controller mapping paths in the user's home directory.
@@ -125,6 +129,7 @@ ControllerLearningEventFilter* ControllerManager::getControllerLearningEventFilt
 
 void ControllerManager::slotShutdown() {
     stopPolling();
+    m_pPollNotifiers->clear();
 
     // Clear m_enumerators before deleting the enumerators to prevent other code
     // paths from accessing them.
@@ -243,12 +248,9 @@ void ControllerManager::maybeStartOrStopPolling() {
     QList<Controller*> controllers = m_controllers;
     locker.unlock();
 
-    bool shouldPoll = false;
-    foreach (Controller* pController, controllers) {
-        if (pController->isOpen() && pController->isPolling()) {
-            shouldPoll = true;
-        }
-    }
+    // Devices that have a descriptor to wait on get a notifier, all others
+    // are polled on the timer.
+    const bool shouldPoll = m_pPollNotifiers->update(controllers);
     if (shouldPoll) {
         startPolling();
     } else {
@@ -276,7 +278,8 @@ void ControllerManager::pollDevices() {
     do {
         eventsProcessed = false;
         foreach (Controller* pDevice, m_controllers) {
-            if (pDevice->isOpen() && pDevice->isPolling()) {
+            if (pDevice->isOpen() && pDevice->isPolling() &&
+                    !m_pPollNotifiers->contains(pDevice)) {
                 eventsProcessed = pDevice->poll() || eventsProcessed;
             }
         }
@@ -15,6 +15,7 @@
 
 //Forward declaration(s)
 class Controller;
+class ControllerPollNotifiers;
 class ControllerLearningEventFilter;
 
 // Function to sort controllers by name
@@ -61,7 +62,8 @@ class ControllerManager : public QObject {
                     ControllerPresetPointer preset);
     bool loadPreset(Controller* pController, const QString &filename,
                     const bool force);
-    // Calls poll() on all devices that have isPolling() true.
+    // Calls poll() on all devices that have isPolling() true and no
+    // pollDescriptor().
     void pollDevices();
     void startPolling();
     void stopPolling();
@@ -77,6 +79,9 @@ class ControllerManager : public QObject {
     ConfigObject<ConfigValue> *m_pConfig;
     ControllerLearningEventFilter* m_pControllerLearningEventFilter;
     QTimer m_pollTimer;
+    // Notifiers for the open devices that have a pollDescriptor(). The
+    // controller thread only wakes up for them when they have input.
+    ControllerPollNotifiers* m_pPollNotifiers;
     mutable QMutex m_mutex;
     QList<ControllerEnumerator*> m_enumerators;
     QList<Controller*> m_controllers;
@@ -0,0 +1,72 @@
+/**
+  * @file controllerpollnotifiers.cpp
+  * @brief Wakes up the controller thread for the devices that have input.
+  */
+
+#include <QSocketNotifier>
+
+#include "controllers/controllerpollnotifiers.h"
+#include "controllers/controller.h"
+#include "util/trace.h"
+
+ControllerPollNotifiers::ControllerPollNotifiers(QObject* pParent)
+        : QObject(pParent) {
+}
+
+ControllerPollNotifiers::~ControllerPollNotifiers() {
+    clear();
+}
+
+bool ControllerPollNotifiers::update(const QList<Controller*>& controllers) {
+    QHash<Controller*, QSocketNotifier*> notifiers;
+    bool shouldPoll = false;
+    foreach (Controller* pController, controllers) {
+        if (!pController->isOpen() || !pController->isPolling()) {
+            continue;
+        }
+        const int descriptor = pController->pollDescriptor();
+        if (descriptor < 0) {
+            shouldPoll = true;
+            continue;
+        }
+        QSocketNotifier* pNotifier = m_notifiers.take(pController);
+        if (pNotifier != NULL && pNotifier->socket() != descriptor) {
+            delete pNotifier;
+            pNotifier = NULL;
+        }
+        if (pNotifier == NULL) {
+            pNotifier = new QSocketNotifier(descriptor, QSocketNotifier::Read,
+                                            this);
+            connect(pNotifier, SIGNAL(activated(int)),
+                    this, SLOT(pollNotifiedDevice(int)));
+        }
+        notifiers.insert(pController, pNotifier);
+    }
+    // The remaining notifiers belong to devices that were closed.
+    qDeleteAll(m_notifiers);
+    m_notifiers = notifiers;
+    return shouldPoll;
+}
+
+void ControllerPollNotifiers::clear() {
+    qDeleteAll(m_notifiers);
+    m_notifiers.clear();
+}
+
+void ControllerPollNotifiers::pollNotifiedDevice(int descriptor) {
+    Trace tracer("ControllerPollNotifiers::pollNotifiedDevice");
+    for (QHash<Controller*, QSocketNotifier*>::const_iterator it =
+                 m_notifiers.constBegin();
+         it != m_notifiers.constEnd(); ++it) {
+        if (it.value()->socket() != descriptor) {
+            continue;
+        }
+        Controller* pDevice = it.key();
+        if (pDevice->isOpen()) {
+            // Handle everything the device has buffered.
+            while (pDevice->poll()) {
+            }
+        }
+        return;
+    }
+}
@@ -0,0 +1,48 @@
+/**
+  * @file controllerpollnotifiers.h
+  * @brief Wakes up the controller thread for the devices that have input.
+  */
+
+#ifndef CONTROLLERPOLLNOTIFIERS_H
+#define CONTROLLERPOLLNOTIFIERS_H
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+
+class Controller;
+class QSocketNotifier;
+
+// Keeps a QSocketNotifier for each open polling controller that has a
+// Controller::pollDescriptor() and polls the controller when the descriptor
+// becomes readable. The controllers without a descriptor are left to the poll
+// timer of the ControllerManager.
+class ControllerPollNotifiers : public QObject {
+    Q_OBJECT
+  public:
+    explicit ControllerPollNotifiers(QObject* pParent = NULL);
+    virtual ~ControllerPollNotifiers();
+
+    // Creates the notifiers for the open polling controllers among
+    // controllers that have a descriptor and deletes the notifiers of all
+    // others. Returns true if any open polling controller has to be polled on
+    // a timer.
+    bool update(const QList<Controller*>& controllers);
+    // Deletes all notifiers.
+    void clear();
+
+    // Returns true if pController is polled when its descriptor is readable.
+    bool contains(Controller* pController) const {
+        return m_notifiers.contains(pController);
+    }
+
+  private slots:
+    // Calls poll() on the controller whose descriptor became readable until
+    // it has handled everything it has buffered.
+    void pollNotifiedDevice(int descriptor);
+
+  private:
+    QHash<Controller*, QSocketNotifier*> m_notifiers;
+};
+
+#endif  // CONTROLLERPOLLNOTIFIERS_H
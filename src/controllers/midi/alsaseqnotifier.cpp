@@ -0,0 +1,168 @@
+/**
+ * @file alsaseqnotifier.cpp
+ * @brief Wakes up the controller thread when an ALSA sequencer port sends
+ * MIDI input.
+ */
+
+#include "controllers/midi/alsaseqnotifier.h"
+
+#ifdef __ALSASEQ__
+
+#include <poll.h>
+
+#include <QtDebug>
+
+AlsaSeqNotifier::AlsaSeqNotifier()
+        : m_pSeq(NULL),
+          m_iPort(-1),
+          m_iDescriptor(-1) {
+}
+
+AlsaSeqNotifier::~AlsaSeqNotifier() {
+    close();
+}
+
+bool AlsaSeqNotifier::prepare(const QString& portName) {
+    close();
+
+    if (snd_seq_open(&m_pSeq, "default", SND_SEQ_OPEN_INPUT,
+                     SND_SEQ_NONBLOCK) < 0) {
+        qWarning() << "AlsaSeqNotifier: Could not open the ALSA sequencer";
+        m_pSeq = NULL;
+        return false;
+    }
+    snd_seq_set_client_name(m_pSeq, "Mixxx input notifier");
+    m_iPort = snd_seq_create_simple_port(
+            m_pSeq, qPrintable(portName),
+            SND_SEQ_PORT_CAP_WRITE | SND_SEQ_PORT_CAP_SUBS_WRITE,
+            SND_SEQ_PORT_TYPE_APPLICATION);
+    if (m_iPort < 0) {
+        qWarning() << "AlsaSeqNotifier: Could not create a port for" << portName;
+        close();
+        return false;
+    }
+
+    // Remember every port PortMidi might read from.
+    const int ownClient = snd_seq_client_id(m_pSeq);
+    const unsigned int readCaps =
+            SND_SEQ_PORT_CAP_READ | SND_SEQ_PORT_CAP_SUBS_READ;
+    snd_seq_client_info_t* pClientInfo;
+    snd_seq_port_info_t* pPortInfo;
+    snd_seq_client_info_alloca(&pClientInfo);
+    snd_seq_port_info_alloca(&pPortInfo);
+    snd_seq_client_info_set_client(pClientInfo, -1);
+    while (snd_seq_query_next_client(m_pSeq, pClientInfo) >= 0) {
+        const int client = snd_seq_client_info_get_client(pClientInfo);
+        if (client == ownClient) {
+            continue;
+        }
+        snd_seq_port_info_set_client(pPortInfo, client);
+        snd_seq_port_info_set_port(pPortInfo, -1);
+        while (snd_seq_query_next_port(m_pSeq, pPortInfo) >= 0) {
+            const unsigned int caps = snd_seq_port_info_get_capability(pPortInfo);
+            if ((caps & readCaps) == readCaps &&
+                    portName == QString::fromLocal8Bit(
+                            snd_seq_port_info_get_name(pPortInfo))) {
+                const snd_seq_addr_t port = *snd_seq_port_info_get_addr(pPortInfo);
+                m_candidates.append(port);
+                m_candidateSubscribers.append(subscribers(port));
+            }
+        }
+    }
+    if (m_candidates.isEmpty()) {
+        qWarning() << "AlsaSeqNotifier: No sequencer port named" << portName;
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool AlsaSeqNotifier::open() {
+    if (m_pSeq == NULL) {
+        return false;
+    }
+
+    QList<QSet<int> > currentSubscribers;
+    foreach (const snd_seq_addr_t& port, m_candidates) {
+        currentSubscribers.append(subscribers(port));
+    }
+    const int index = findOpenedPort(m_candidateSubscribers, currentSubscribers);
+    if (index < 0) {
+        qWarning() << "AlsaSeqNotifier: Could not tell which of"
+                   << m_candidates.size() << "ports was opened";
+        close();
+        return false;
+    }
+    const snd_seq_addr_t source = m_candidates.at(index);
+    m_candidates.clear();
+    m_candidateSubscribers.clear();
+
+    if (snd_seq_connect_from(m_pSeq, m_iPort, source.client, source.port) < 0) {
+        qWarning() << "AlsaSeqNotifier: Could not subscribe to port"
+                   << source.client << ":" << source.port;
+        close();
+        return false;
+    }
+
+    struct pollfd descriptor;
+    if (snd_seq_poll_descriptors(m_pSeq, &descriptor, 1, POLLIN) != 1) {
+        qWarning() << "AlsaSeqNotifier: No descriptor to wait on for port"
+                   << source.client << ":" << source.port;
+        close();
+        return false;
+    }
+    m_iDescriptor = descriptor.fd;
+    return true;
+}
+
+void AlsaSeqNotifier::close() {
+    if (m_pSeq != NULL) {
+        // Closing the client also removes its port and subscription.
+        snd_seq_close(m_pSeq);
+        m_pSeq = NULL;
+    }
+    m_iPort = -1;
+    m_iDescriptor = -1;
+    m_candidates.clear();
+    m_candidateSubscribers.clear();
+}
+
+void AlsaSeqNotifier::drain() {
+    if (m_pSeq != NULL) {
+        snd_seq_drop_input(m_pSeq);
+    }
+}
+
+// static
+int AlsaSeqNotifier::findOpenedPort(const QList<QSet<int> >& before,
+                                    const QList<QSet<int> >& after) {
+    int index = -1;
+    for (int i = 0; i < before.size() && i < after.size(); ++i) {
+        if (QSet<int>(after.at(i)).subtract(before.at(i)).isEmpty()) {
+            continue;
+        }
+        if (index >= 0) {
+            return -1;
+        }
+        index = i;
+    }
+    return index;
+}
+
+QSet<int> AlsaSeqNotifier::subscribers(const snd_seq_addr_t& port) const {
+    QSet<int> result;
+    snd_seq_query_subscribe_t* pQuery;
+    snd_seq_query_subscribe_alloca(&pQuery);
+    snd_seq_query_subscribe_set_root(pQuery, &port);
+    snd_seq_query_subscribe_set_type(pQuery, SND_SEQ_QUERY_SUBS_READ);
+    snd_seq_query_subscribe_set_index(pQuery, 0);
+    while (snd_seq_query_port_subscribers(m_pSeq, pQuery) >= 0) {
+        const snd_seq_addr_t* pSubscriber = snd_seq_query_subscribe_get_addr(pQuery);
+        result.insert(pSubscriber->client << 8 | pSubscriber->port);
+        snd_seq_query_subscribe_set_index(
+                pQuery, snd_seq_query_subscribe_get_index(pQuery) + 1);
+    }
+    return result;
+}
+
+#endif  // __ALSASEQ__
@@ -0,0 +1,75 @@
+/**
+ * @file alsaseqnotifier.h
+ * @brief Wakes up the controller thread when an ALSA sequencer port sends
+ * MIDI input.
+ */
+
+#ifndef ALSASEQNOTIFIER_H
+#define ALSASEQNOTIFIER_H
+
+#ifdef __ALSASEQ__
+
+#include <alsa/asoundlib.h>
+
+#include <QList>
+#include <QSet>
+#include <QString>
+
+#include "util.h"
+
+// On Linux PortMidi reads its input from the ALSA sequencer but does not expose
+// the file descriptor it reads from, so PortMidiControllers had to be polled on
+// a timer. AlsaSeqNotifier opens a sequencer client of its own and subscribes
+// it to the same port as PortMidi. Identical devices have ports with the same
+// name, so the port is told apart by the subscription PortMidi makes when it
+// opens the device. The file descriptor of that client becomes readable
+// whenever the port sends an event, which ControllerManager waits for instead
+// of polling. The events the notifier receives are discarded since PortMidi
+// delivers the same events to the controller.
+class AlsaSeqNotifier {
+  public:
+    AlsaSeqNotifier();
+    virtual ~AlsaSeqNotifier();
+
+    // Opens the sequencer client and remembers the subscribers of the readable
+    // ports named portName, which is the name PortMidi gives the device. Must
+    // be called before PortMidi opens the device. Returns false on failure.
+    bool prepare(const QString& portName);
+    // Subscribes to the port that PortMidi subscribed to since prepare(). If
+    // not exactly one of the ports gained a subscriber the notifier is closed
+    // and false is returned, so the device has to be polled on a timer.
+    bool open();
+    void close();
+
+    // Returns the descriptor that is readable while events are pending, or -1
+    // if the notifier is not open.
+    int descriptor() const {
+        return m_iDescriptor;
+    }
+
+    // Discards the pending events. Must be called before reading from
+    // PortMidi so that no event that arrives in between is missed.
+    void drain();
+
+    // Returns the index of the only port that has a subscriber in after which
+    // it did not have in before, or -1 if no port or more than one port has.
+    static int findOpenedPort(const QList<QSet<int> >& before,
+                              const QList<QSet<int> >& after);
+
+  private:
+    // Returns the subscribers of port as client << 8 | port.
+    QSet<int> subscribers(const snd_seq_addr_t& port) const;
+
+    snd_seq_t* m_pSeq;
+    int m_iPort;
+    int m_iDescriptor;
+    // The ports named like the device and their subscribers at prepare().
+    QList<snd_seq_addr_t> m_candidates;
+    QList<QSet<int> > m_candidateSubscribers;
+
+    DISALLOW_COPY_AND_ASSIGN(AlsaSeqNotifier);
+};
+
+#endif  // __ALSASEQ__
+
+#endif  // ALSASEQNOTIFIER_H
@@ -10,8 +10,10 @@
 
 #include "controllers/defs_controllers.h"
 #include "controlobject.h"
+#include "engine/controleventqueue.h"
 #include "errordialoghandler.h"
 #include "playermanager.h"
+#include "util/time.h"
 
 MidiController::MidiController() : Controller() {
 }
@@ -226,6 +228,71 @@ bool isMessageTwoBytes(unsigned char opCode) {
 
 void MidiController::receive(unsigned char status, unsigned char control,
                              unsigned char value) {
+    receive(status, control, value, Time::elapsed());
+}
+
+void MidiController::receive(unsigned char status, unsigned char control,
+                             unsigned char value, qint64 timestamp) {
+    processMessage(status, control, value, timestamp);
+    messageHandled(timestamp);
+}
+
+// static
+uint16_t MidiController::mappingKey(unsigned char status,
+                                    unsigned char control) {
+    unsigned char opCode = status & 0xF0;
+    if (opCode >= 0xF0) {
+        opCode = status;
+    }
+    MidiKey key;
+    key.status = status;
+    key.control = isMessageTwoBytes(opCode) ? control : 0xFF;
+    return key.key;
+}
+
+bool MidiController::isCoalesced(uint16_t mappingKey) const {
+    // Every message is needed while learning.
+    if (isLearning()) {
+        return false;
+    }
+    QHash<uint16_t, QPair<MixxxControl, MidiOptions> >::const_iterator it =
+            m_preset.mappings.find(mappingKey);
+    return it != m_preset.mappings.end() && it.value().second.coalesce;
+}
+
+int MidiController::coalesceBurst(
+        const QPair<unsigned char, unsigned char>* pMessages, int count,
+        bool* pSkip) {
+    bool canCoalesce = true;
+    for (int i = 0; i < count; ++i) {
+        canCoalesce = canCoalesce && pMessages[i].first != 0xF0;
+        pSkip[i] = false;
+    }
+    if (!canCoalesce) {
+        return 0;
+    }
+
+    int skipped = 0;
+    for (int i = 0; i < count; ++i) {
+        const uint16_t key = mappingKey(pMessages[i].first, pMessages[i].second);
+        for (int j = i + 1; j < count; ++j) {
+            if (mappingKey(pMessages[j].first, pMessages[j].second) == key) {
+                pSkip[i] = isCoalesced(key);
+                break;
+            }
+        }
+        if (pSkip[i]) {
+            ++skipped;
+        }
+    }
+    if (skipped > 0) {
+        messagesCoalesced(skipped);
+    }
+    return skipped;
+}
+
+void MidiController::processMessage(unsigned char status, unsigned char control,
+                                    unsigned char value, qint64 timestamp) {
     unsigned char channel = status & 0x0F;
     unsigned char opCode = status & 0xF0;
     if (opCode >= 0xF0) {
@@ -315,7 +382,9 @@ void MidiController::receive(unsigned char status, unsigned char control,
         args << QScriptValue(status);
         args << QScriptValue(mc.group());
         QScriptValue function = pEngine->resolveFunction(mc.item(), true);
+        pEngine->setEventTimestamp(timestamp);
         pEngine->execute(function, args);
+        pEngine->setEventTimestamp(-1);
         return;
     }
 
@@ -369,16 +438,26 @@ void MidiController::receive(unsigned char status, unsigned char control,
                 return;
             }
         }
-        // Use temporary cot for bypass own signal filter
-        ControlObjectThread cot(pCO->getKey());
-        cot.set(newValue);
+        if (!ControlEventQueue::schedule(pCO, newValue, timestamp)) {
+            // Use temporary cot for bypass own signal filter
+            ControlObjectThread cot(pCO->getKey());
+            cot.set(newValue);
+        }
     } else {
         if (options.soft_takeover) {
             if (m_st.ignore(pCO, newValue, true)) {
                 return;
             }
         }
-        pCO->setValueFromMidi(static_cast<MidiOpCode>(opCode), newValue);
+        // The current value a relative mapping starts from does not include
+        // changes that are still queued, so it is applied right away.
+        if (isRelative(options)) {
+            ControlEventQueue::setDirectly(pCO);
+            pCO->setValueFromMidi(static_cast<MidiOpCode>(opCode), newValue);
+        } else if (!ControlEventQueue::scheduleFromMidi(
+                pCO, static_cast<MidiOpCode>(opCode), newValue, timestamp)) {
+            pCO->setValueFromMidi(static_cast<MidiOpCode>(opCode), newValue);
+        }
     }
 }
 
@@ -472,6 +551,12 @@ double MidiController::computeValue(MidiOptions options, double _prevmidivalue,
     return _newmidivalue;
 }
 
+// static
+bool MidiController::isRelative(MidiOptions options) {
+    return options.rot64 || options.rot64_inv || options.rot64_fast ||
+            options.diff || options.herc_jog;
+}
+
 QString formatSysexMessage(QString controllerName, const QByteArray& data) {
     QString message = QString("%1: %2 bytes: [").arg(controllerName).arg(data.size());
     for (int i = 0; i < data.size(); ++i) {
@@ -61,7 +61,28 @@ class MidiController : public Controller {
         send(data, length);
     }
 
+    // Handles a message that was received at timestamp, in the
+    // Time::elapsed() time base. Changes of the controls a deck schedules on
+    // its ControlEventQueue are applied by the engine at that time.
+    void receive(unsigned char status, unsigned char control,
+                 unsigned char value, qint64 timestamp);
+
+    // Returns the key of the mapping that handles messages with this status
+    // and control.
+    static uint16_t mappingKey(unsigned char status, unsigned char control);
+    // Returns true if the mapping with this key asks for only the last message
+    // of a burst to be handled. Backends that read bursts of messages may then
+    // skip the earlier ones.
+    bool isCoalesced(uint16_t mappingKey) const;
+    // Marks in pSkip which of the count (status, data1) pairs of a burst a
+    // later message for the same mapping supersedes, if the mapping asks for
+    // it. Bursts that contain System Exclusive data are not coalesced.
+    // Returns the number of marked messages.
+    int coalesceBurst(const QPair<unsigned char, unsigned char>* pMessages,
+                      int count, bool* pSkip);
+
   protected slots:
+    // Handles a message that was received now.
     void receive(unsigned char status, unsigned char control = 0,
                  unsigned char value = 0);
     // For receiving System Exclusive messages
@@ -77,7 +98,11 @@ class MidiController : public Controller {
 
   private:
     virtual void sendWord(unsigned int word) = 0;
+    void processMessage(unsigned char status, unsigned char control,
+                        unsigned char value, qint64 timestamp);
     double computeValue(MidiOptions options, double _prevmidivalue, double _newmidivalue);
+    // Returns true if computeValue() adds the message to the current value.
+    static bool isRelative(MidiOptions options);
     void createOutputHandlers();
     void updateAllOutputs();
     void destroyOutputHandlers();
@@ -80,6 +80,7 @@ ControllerPresetPointer MidiControllerPresetFileHandler::load(const QDomElement
             if (strMidiOption == "selectknob")options.selectknob = true;
             if (strMidiOption == "soft-takeover") options.soft_takeover = true;
             if (strMidiOption == "script-binding") options.script = true;
+            if (strMidiOption == "coalesce") options.coalesce = true;
 
             optionsNode = optionsNode.nextSiblingElement();
         }
@@ -306,6 +307,10 @@ void MidiControllerPresetFileHandler::addControlsToDocument(const MidiController
                 QDomElement singleOption = nodeMaker.createElement("script-binding");
                 optionsNode.appendChild(singleOption);
             }
+            if (options.coalesce) {
+                QDomElement singleOption = nodeMaker.createElement("coalesce");
+                optionsNode.appendChild(singleOption);
+            }
         }
 
         controlNode.appendChild(optionsNode);
@@ -50,7 +50,8 @@ struct MidiOptions
             bool selectknob    : 1;    // relative knob which can be turned forever and outputs a signed value
             bool soft_takeover : 1;    // prevents sudden changes when hardware position differs from software value
             bool script        : 1;    // maps a MIDI control to a custom MixxxScript function
-            // 20 more available for future expansion
+            bool coalesce      : 1;    // of a burst of messages with the same status and control only the last one is handled
+            // 19 more available for future expansion
         };
     };
 };
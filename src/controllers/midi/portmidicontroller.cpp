@@ -7,7 +7,11 @@
  *
  */
 
+#include <porttime.h>
+#include <string.h>
+
 #include "controllers/midi/portmidicontroller.h"
+#include "util/time.h"
 
 PortMidiController::PortMidiController(const PmDeviceInfo* inputDeviceInfo,
                                        const PmDeviceInfo* outputDeviceInfo,
@@ -63,6 +67,18 @@ int PortMidiController::open() {
                          << m_iInputDeviceIndex << "for input";
             }
 
+            // Without a time_proc PortMidi timestamps the input with
+            // PortTime, which poll() maps to Time::elapsed().
+            if (!Pt_Started()) {
+                Pt_Start(1, NULL, NULL);
+            }
+#ifdef __ALSASEQ__
+            // The notifier finds the port by the subscription PortMidi makes.
+            const bool alsaInput = strcmp(m_pInputDeviceInfo->interf, "ALSA") == 0;
+            if (alsaInput) {
+                m_inputNotifier.prepare(m_pInputDeviceInfo->name);
+            }
+#endif
             err = Pm_OpenInput(&m_pInputStream,
                                m_iInputDeviceIndex,
                                NULL, //No drive hacks
@@ -72,8 +88,17 @@ int PortMidiController::open() {
 
             if (err != pmNoError) {
                 qDebug() << "PortMidi error:" << Pm_GetErrorText(err);
+#ifdef __ALSASEQ__
+                m_inputNotifier.close();
+#endif
                 return -2;
             }
+#ifdef __ALSASEQ__
+            if (alsaInput && !m_inputNotifier.open()) {
+                qDebug() << "PortMidiController:" << getName()
+                         << "is polled on a timer";
+            }
+#endif
         }
     }
     if (m_pOutputDeviceInfo) {
@@ -115,6 +140,10 @@ int PortMidiController::close() {
 
     int result = 0;
 
+#ifdef __ALSASEQ__
+    m_inputNotifier.close();
+#endif
+
     if (m_pInputStream) {
         PmError err = Pm_Close(m_pInputStream);
         m_pInputStream = NULL;
@@ -137,11 +166,25 @@ int PortMidiController::close() {
     return result;
 }
 
+int PortMidiController::pollDescriptor() const {
+#ifdef __ALSASEQ__
+    return m_inputNotifier.descriptor();
+#else
+    return -1;
+#endif
+}
+
 bool PortMidiController::poll() {
     // Poll the controller for new data if it's an input device
     if (!m_pInputStream)
         return false;
 
+#ifdef __ALSASEQ__
+    // Clear the notification before reading so that input which arrives while
+    // reading wakes up the controller thread again.
+    m_inputNotifier.drain();
+#endif
+
     PmError gotEvents = Pm_Poll(m_pInputStream);
     if (gotEvents == FALSE) {
         return false;
@@ -158,12 +201,40 @@ bool PortMidiController::poll() {
         return false;
     }
 
+    // PortMidi timestamps are in milliseconds of PortTime. Convert them to
+    // the Time::elapsed() time base so that the engine can apply the messages
+    // at the time they were received rather than the time they were polled.
+    const qint64 now = Time::elapsed();
+    const PmTimestamp portTimeNow = Pt_Time();
+
+    // Messages that a later message of the burst for the same mapping
+    // supersedes are skipped if the mapping asks for it. Messages that continue
+    // a System Exclusive message of the last burst carry no status, so such
+    // bursts are not coalesced.
+    bool coalesced[MIXXX_PORTMIDI_BUFFER_LEN];
+    QPair<unsigned char, unsigned char> messages[MIXXX_PORTMIDI_BUFFER_LEN];
+    for (int i = 0; i < numEvents; ++i) {
+        messages[i] = qMakePair<unsigned char, unsigned char>(
+                Pm_MessageStatus(m_midiBuffer[i].message),
+                Pm_MessageData1(m_midiBuffer[i].message));
+        coalesced[i] = false;
+    }
+    if (!m_bInSysex) {
+        coalesceBurst(messages, numEvents, coalesced);
+    }
+
     for (int i = 0; i < numEvents; i++) {
+        if (coalesced[i]) {
+            continue;
+        }
         unsigned char status = Pm_MessageStatus(m_midiBuffer[i].message);
+        const qint64 age = qMax<PmTimestamp>(
+                0, portTimeNow - m_midiBuffer[i].timestamp);
+        const qint64 timestamp = now - age * 1000000;
 
         if ((status & 0xF8) == 0xF8) {
             // Handle real-time MIDI messages at any time
-            receive(status, 0, 0);
+            receive(status, 0, 0, timestamp);
         }
 
         reprocessMessage:
@@ -176,7 +247,7 @@ bool PortMidiController::poll() {
                 //unsigned char channel = status & 0x0F;
                 unsigned char note = Pm_MessageData1(m_midiBuffer[i].message);
                 unsigned char velocity = Pm_MessageData2(m_midiBuffer[i].message);
-                receive(status, note, velocity);
+                receive(status, note, velocity, timestamp);
             }
         }
 
@@ -195,7 +266,7 @@ bool PortMidiController::poll() {
             for (int shift = 0; shift < 32 && (data != MIDI_EOX); shift += 8) {
                 if ((data & 0xF8) == 0xF8) {
                     // Handle real-time messages at any time
-                    receive(data, 0, 0);
+                    receive(data, 0, 0, timestamp);
                 } else {
                     m_cReceiveMsg[m_cReceiveMsg_index++] = data =
                         (m_midiBuffer[i].message >> shift) & 0xFF;
@@ -18,6 +18,7 @@
 #define PORTMIDICONTROLLER_H
 
 #include <portmidi.h>
+#include "controllers/midi/alsaseqnotifier.h"
 #include "controllers/midi/midicontroller.h"
 
 #define MIXXX_PORTMIDI_BUFFER_LEN 64 /**Number of MIDI messages to buffer*/
@@ -37,6 +38,7 @@ class PortMidiController : public MidiController {
     virtual int open();
     virtual int close();
     virtual bool poll();
+    virtual int pollDescriptor() const;
 
   private:
     void sendWord(unsigned int word);
@@ -55,6 +57,10 @@ class PortMidiController : public MidiController {
     PortMidiStream *m_pInputStream;
     PortMidiStream *m_pOutputStream;
     PmEvent m_midiBuffer[MIXXX_PORTMIDI_BUFFER_LEN];
+#ifdef __ALSASEQ__
+    // Lets ControllerManager wait for input instead of polling on a timer.
+    AlsaSeqNotifier m_inputNotifier;
+#endif
 
     // Storage for SysEx messages
     unsigned char m_cReceiveMsg[1024];
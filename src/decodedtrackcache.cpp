@@ -0,0 +1,168 @@
+#include <new>
+
+#include <QMutexLocker>
+#include <QtDebug>
+
+#include "decodedtrackcache.h"
+#include "cachingreaderworker.h"
+#include "util/compatibility.h"
+
+//static
+const int DecodedTrackCache::kDefaultMemoryBudgetMB = 1024;
+
+DecodedTrack::DecodedTrack(const QString& key, int numSamples,
+                           CSAMPLE* pSamples)
+        : m_key(key),
+          m_iNumSamples(numSamples),
+          m_iNumChunks((numSamples + CachingReaderWorker::kSamplesPerChunk - 1) /
+                       CachingReaderWorker::kSamplesPerChunk),
+          m_pSamples(pSamples),
+          m_pChunkLengths(new int[m_iNumChunks]),
+          m_pChunkStates(new QAtomicInt[m_iNumChunks]),
+          m_iDecodedChunks(0),
+          m_iPins(0) {
+    for (int i = 0; i < m_iNumChunks; ++i) {
+        m_pChunkLengths[i] = 0;
+    }
+}
+
+DecodedTrack::~DecodedTrack() {
+    delete [] m_pSamples;
+    delete [] m_pChunkLengths;
+    delete [] m_pChunkStates;
+}
+
+bool DecodedTrack::isComplete() const {
+    return deref(m_iDecodedChunks) == m_iNumChunks;
+}
+
+const CSAMPLE* DecodedTrack::chunkData(int chunk_number) const {
+    return m_pSamples + CachingReaderWorker::sampleForChunk(chunk_number);
+}
+
+CSAMPLE* DecodedTrack::claimChunk(int chunk_number) {
+    if (chunk_number < 0 || chunk_number >= m_iNumChunks ||
+            !m_pChunkStates[chunk_number].testAndSetAcquire(EMPTY, DECODING)) {
+        return NULL;
+    }
+    return m_pSamples + CachingReaderWorker::sampleForChunk(chunk_number);
+}
+
+void DecodedTrack::setChunkDecoded(int chunk_number, int length) {
+    m_pChunkLengths[chunk_number] = length;
+    // Publishes the samples and the length to readers.
+    m_pChunkStates[chunk_number].fetchAndStoreRelease(DECODED);
+    m_iDecodedChunks.ref();
+}
+
+void DecodedTrack::releaseChunk(int chunk_number) {
+    m_pChunkStates[chunk_number].fetchAndStoreRelease(EMPTY);
+}
+
+DecodedTrackCache::DecodedTrackCache()
+        : m_iMemoryBudget(static_cast<qint64>(kDefaultMemoryBudgetMB) << 20),
+          m_iBytesInUse(0) {
+}
+
+DecodedTrackCache::~DecodedTrackCache() {
+    QMutexLocker locker(&m_mutex);
+    foreach (DecodedTrack* pTrack, m_tracks) {
+        if (deref(pTrack->m_iPins) > 0) {
+            qWarning() << "DecodedTrackCache: deleting pinned track"
+                       << pTrack->key();
+        }
+        delete pTrack;
+    }
+    m_tracks.clear();
+}
+
+void DecodedTrackCache::setConfig(ConfigObject<ConfigValue>* pConfig) {
+    int budgetMB = pConfig->getValueString(
+        ConfigKey("[CachingReader]", "DecodedTrackCacheMB"),
+        QString::number(kDefaultMemoryBudgetMB)).toInt();
+    if (budgetMB < 0) {
+        budgetMB = kDefaultMemoryBudgetMB;
+    }
+    QMutexLocker locker(&m_mutex);
+    m_iMemoryBudget = static_cast<qint64>(budgetMB) << 20;
+    makeRoom(0);
+}
+
+DecodedTrack* DecodedTrackCache::acquire(const QString& key, int numSamples) {
+    if (numSamples <= 0) {
+        return NULL;
+    }
+    QMutexLocker locker(&m_mutex);
+    for (QLinkedList<DecodedTrack*>::iterator it = m_tracks.begin();
+         it != m_tracks.end(); ++it) {
+        DecodedTrack* pTrack = *it;
+        if (pTrack->key() == key && pTrack->numSamples() == numSamples) {
+            m_tracks.erase(it);
+            m_tracks.prepend(pTrack);
+            pTrack->m_iPins.ref();
+            return pTrack;
+        }
+    }
+
+    const qint64 bytes = static_cast<qint64>(numSamples) * sizeof(CSAMPLE);
+    if (!makeRoom(bytes)) {
+        qDebug() << "DecodedTrackCache: not enough memory budget to decode"
+                 << key;
+        return NULL;
+    }
+    CSAMPLE* pSamples = new (std::nothrow) CSAMPLE[numSamples];
+    if (pSamples == NULL) {
+        qWarning() << "DecodedTrackCache: could not allocate" << bytes
+                   << "bytes to decode" << key;
+        return NULL;
+    }
+    DecodedTrack* pTrack = new DecodedTrack(key, numSamples, pSamples);
+    pTrack->m_iPins.ref();
+    m_tracks.prepend(pTrack);
+    m_iBytesInUse += bytes;
+    return pTrack;
+}
+
+// static
+void DecodedTrackCache::pin(DecodedTrack* pTrack) {
+    if (pTrack != NULL) {
+        pTrack->m_iPins.ref();
+    }
+}
+
+// static
+void DecodedTrackCache::release(DecodedTrack* pTrack) {
+    if (pTrack != NULL) {
+        pTrack->m_iPins.deref();
+    }
+}
+
+qint64 DecodedTrackCache::memoryBudget() const {
+    QMutexLocker locker(&m_mutex);
+    return m_iMemoryBudget;
+}
+
+qint64 DecodedTrackCache::bytesInUse() const {
+    QMutexLocker locker(&m_mutex);
+    return m_iBytesInUse;
+}
+
+bool DecodedTrackCache::makeRoom(qint64 bytes) {
+    if (bytes > m_iMemoryBudget) {
+        return false;
+    }
+    // Walk from the least recently used track.
+    QLinkedList<DecodedTrack*>::iterator it = m_tracks.end();
+    while (m_iBytesInUse + bytes > m_iMemoryBudget && it != m_tracks.begin()) {
+        --it;
+        DecodedTrack* pTrack = *it;
+        if (deref(pTrack->m_iPins) > 0) {
+            continue;
+        }
+        qDebug() << "DecodedTrackCache: evicting" << pTrack->key();
+        m_iBytesInUse -= pTrack->bytes();
+        it = m_tracks.erase(it);
+        delete pTrack;
+    }
+    return m_iBytesInUse + bytes <= m_iMemoryBudget;
+}
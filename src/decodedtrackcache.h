@@ -0,0 +1,132 @@
+// decodedtrackcache.h
+// Whole tracks decoded into memory, shared by all CachingReaders.
+
+#ifndef DECODEDTRACKCACHE_H
+#define DECODEDTRACKCACHE_H
+
+#include <QAtomicInt>
+#include <QLinkedList>
+#include <QMutex>
+#include <QString>
+
+#include "defs.h"
+#include "configobject.h"
+#include "util/singleton.h"
+
+// A track that is decoded into memory chunk by chunk, using the same chunk
+// layout as the CachingReader. Chunks are written by CachingReaderWorkers and
+// can be read without locking by any thread once isChunkDecoded() returns
+// true for them.
+class DecodedTrack {
+  public:
+    DecodedTrack(const QString& key, int numSamples, CSAMPLE* pSamples);
+    virtual ~DecodedTrack();
+
+    const QString& key() const {
+        return m_key;
+    }
+    int numSamples() const {
+        return m_iNumSamples;
+    }
+    int numChunks() const {
+        return m_iNumChunks;
+    }
+    qint64 bytes() const {
+        return static_cast<qint64>(m_iNumSamples) * sizeof(CSAMPLE);
+    }
+
+    bool isChunkDecoded(int chunk_number) const {
+        return chunk_number >= 0 && chunk_number < m_iNumChunks &&
+                m_pChunkStates[chunk_number].fetchAndAddAcquire(0) == DECODED;
+    }
+    bool isComplete() const;
+
+    // Only valid for decoded chunks.
+    const CSAMPLE* chunkData(int chunk_number) const;
+    int chunkLength(int chunk_number) const {
+        return m_pChunkLengths[chunk_number];
+    }
+
+    // Reserves chunk_number for decoding by the calling thread and returns its
+    // buffer, or returns NULL if it is decoded or being decoded by another
+    // worker. A claimed chunk must be finished with setChunkDecoded() or
+    // handed back with releaseChunk().
+    CSAMPLE* claimChunk(int chunk_number);
+    // Publishes a claimed chunk. length is smaller than the chunk size for the
+    // last chunk.
+    void setChunkDecoded(int chunk_number, int length);
+    // Hands back a claimed chunk that could not be decoded, so that it is
+    // decoded again later.
+    void releaseChunk(int chunk_number);
+
+  private:
+    enum ChunkState {
+        EMPTY = 0,
+        DECODING,
+        DECODED,
+    };
+
+    const QString m_key;
+    const int m_iNumSamples;
+    const int m_iNumChunks;
+    CSAMPLE* m_pSamples;
+    int* m_pChunkLengths;
+    QAtomicInt* m_pChunkStates;
+    QAtomicInt m_iDecodedChunks;
+
+    // Number of CachingReaders and workers using the track. Tracks are only
+    // evicted while unpinned. Guarded by the DecodedTrackCache mutex except
+    // for DecodedTrackCache::release().
+    QAtomicInt m_iPins;
+
+    friend class DecodedTrackCache;
+};
+
+// DecodedTrackCache owns the tracks decoded by CachingReaderWorkers for decks
+// with the decode_to_ram option enabled. Decoded tracks are kept after they
+// are ejected, so that reloading a recently played track is instant, until
+// the [CachingReader],DecodedTrackCacheMB memory budget is exceeded and the
+// least recently used unpinned tracks are evicted.
+class DecodedTrackCache : public Singleton<DecodedTrackCache> {
+  public:
+    static const int kDefaultMemoryBudgetMB;
+
+    // Reads the memory budget from config.
+    void setConfig(ConfigObject<ConfigValue>* pConfig);
+
+    // Returns the decoded track for key, creating an empty one with
+    // numSamples samples if none exists. Returns NULL if the track does not
+    // fit into the memory budget. The returned track is pinned and must be
+    // released with release(). Allocates, so must not be called from the
+    // engine thread.
+    DecodedTrack* acquire(const QString& key, int numSamples);
+
+    // Pins a track that is already pinned by the caller for handing it over to
+    // another thread.
+    static void pin(DecodedTrack* pTrack);
+    // Unpins a track. Does not lock or free, so it is safe to call from the
+    // engine thread.
+    static void release(DecodedTrack* pTrack);
+
+    qint64 memoryBudget() const;
+    qint64 bytesInUse() const;
+
+  protected:
+    DecodedTrackCache();
+    virtual ~DecodedTrackCache();
+
+  private:
+    // Evicts unpinned tracks, least recently used first, until bytes more
+    // bytes fit into the budget. Returns false if they don't.
+    bool makeRoom(qint64 bytes);
+
+    mutable QMutex m_mutex;
+    qint64 m_iMemoryBudget;
+    qint64 m_iBytesInUse;
+    // Most recently used first.
+    QLinkedList<DecodedTrack*> m_tracks;
+
+    friend class Singleton<DecodedTrackCache>;
+};
+
+#endif /* DECODEDTRACKCACHE_H */
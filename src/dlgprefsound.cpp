@@ -101,6 +101,12 @@ DlgPrefSound::DlgPrefSound(QWidget* pParent, SoundManager* pSoundManager,
     connect(m_pMasterLatency, SIGNAL(valueChanged(double)),
             this, SLOT(masterLatencyChanged(double)));
 
+    m_pParallelProcessing =
+                    new ControlObjectThread("[Master]", "parallel_processing");
+    parallelProcessingCheckBox->setChecked(m_pParallelProcessing->get() > 0.0);
+    connect(parallelProcessingCheckBox, SIGNAL(toggled(bool)),
+            this, SLOT(parallelProcessingToggled(bool)));
+
 #ifdef __LINUX__
     qDebug() << "RLimit Cur " << RLimit::getCurRtPrio();
     qDebug() << "RLimit Max " << RLimit::getMaxRtPrio();
@@ -118,6 +124,7 @@ DlgPrefSound::DlgPrefSound(QWidget* pParent, SoundManager* pSoundManager,
 DlgPrefSound::~DlgPrefSound() {
     delete m_pMasterUnderflowCount;
     delete m_pMasterLatency;
+    delete m_pParallelProcessing;
 }
 
 /**
@@ -130,6 +137,7 @@ void DlgPrefSound::slotUpdate() {
     // every time. There's no real way around this, just anothe argument
     // for a prefs rewrite -- bkgood
     loadSettings();
+    parallelProcessingCheckBox->setChecked(m_pParallelProcessing->get() > 0.0);
     m_settingsModified = false;
     applyButton->setEnabled(false);
 }
@@ -138,7 +146,14 @@ void DlgPrefSound::slotUpdate() {
  * Slot called when the Apply or OK button is pressed.
  */
 void DlgPrefSound::slotApply() {
+    // Parallel channel processing takes effect without reopening the devices.
+    bool parallelProcessing = parallelProcessingCheckBox->isChecked();
+    m_pConfig->set(ConfigKey("[Soundcard]", "ParallelChannelProcessing"),
+                   ConfigValue(parallelProcessing ? 1 : 0));
+    m_pParallelProcessing->slotSet(parallelProcessing ? 1.0 : 0.0);
+
     if (!m_settingsModified && !m_forceApply) {
+        applyButton->setEnabled(false);
         return;
     }
     m_forceApply = false;
@@ -473,3 +488,12 @@ void DlgPrefSound::masterLatencyChanged(double latency) {
     currentLatency->setText(QString("%1 ms").arg(latency));
     update();
 }
+
+void DlgPrefSound::parallelProcessingToggled(bool enabled) {
+    Q_UNUSED(enabled);
+    // Applied by slotApply, which only reopens the devices if one of the
+    // other settings changed.
+    if (!applyButton->isEnabled()) {
+        applyButton->setEnabled(true);
+    }
+}
@@ -59,6 +59,7 @@ class DlgPrefSound : public DlgPreferencePage, public Ui::DlgPrefSoundDlg  {
     void forceApply(); // called by DlgPrefVinyl to make slotApply call setupDevices
     void bufferUnderflow(double count);
     void masterLatencyChanged(double latency);
+    void parallelProcessingToggled(bool enabled);
 
   private slots:
     void addPath(AudioOutput output);
@@ -85,6 +86,7 @@ class DlgPrefSound : public DlgPreferencePage, public Ui::DlgPrefSoundDlg  {
     ConfigObject<ConfigValue> *m_pConfig;
     ControlObjectThread* m_pMasterUnderflowCount;
     ControlObjectThread* m_pMasterLatency;
+    ControlObjectThread* m_pParallelProcessing;
     QList<SoundDevice*> m_inputDevices;
     QList<SoundDevice*> m_outputDevices;
     bool m_settingsModified;
@@ -6,22 +6,45 @@
 
 class ChannelMixer {
   public:
+    // Mixes activeChannels into pOutput. The gain caches are indexed by
+    // ChannelInfo::m_index.
     static void mixChannels(
-        const QList<EngineMaster::ChannelInfo*>& channels,
+        const EngineMaster::ChannelList& activeChannels,
         const EngineMaster::GainCalculator& gainCalculator,
-        unsigned int channelBitvector,
-        unsigned int maxChannels,
         QList<CSAMPLE>* channelGainCache,
         CSAMPLE* pOutput,
         unsigned int iBufferSize);
     static void mixChannelsRamping(
-        const QList<EngineMaster::ChannelInfo*>& channels,
+        const EngineMaster::ChannelList& activeChannels,
         const EngineMaster::GainCalculator& gainCalculator,
-        unsigned int channelBitvector,
-        unsigned int maxChannels,
         QList<CSAMPLE>* channelGainCache,
         CSAMPLE* pOutput,
         unsigned int iBufferSize);
+
+    // Mixes the headphone output, the three crossfader buses and their sum,
+    // the master output, in a single pass over the channel buffers.
+    // pBusOutputs is indexed by EngineChannel::ChannelOrientation. The gains
+    // of the channels in the buses are taken from masterGainCalculator.
+    static void mixBuses(
+        const EngineMaster::ActiveChannels& activeChannels,
+        const EngineMaster::GainCalculator& headphoneGainCalculator,
+        const EngineMaster::GainCalculator& masterGainCalculator,
+        QList<CSAMPLE>* headphoneGainCache,
+        QList<CSAMPLE>* masterGainCache,
+        CSAMPLE* pHeadphoneOutput,
+        CSAMPLE* const* pBusOutputs,
+        CSAMPLE* pMasterOutput,
+        unsigned int iBufferSize);
+    static void mixBusesRamping(
+        const EngineMaster::ActiveChannels& activeChannels,
+        const EngineMaster::GainCalculator& headphoneGainCalculator,
+        const EngineMaster::GainCalculator& masterGainCalculator,
+        QList<CSAMPLE>* headphoneGainCache,
+        QList<CSAMPLE>* masterGainCache,
+        CSAMPLE* pHeadphoneOutput,
+        CSAMPLE* const* pBusOutputs,
+        CSAMPLE* pMasterOutput,
+        unsigned int iBufferSize);
 };
 
 #endif /* CHANNELMIXER_H */
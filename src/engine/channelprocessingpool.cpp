@@ -0,0 +1,227 @@
+// channelprocessingpool.cpp
+// Parallel EngineChannel processing for the audio callback.
+
+#include <QtDebug>
+
+#ifdef __LINUX__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "engine/channelprocessingpool.h"
+#include "engine/enginechannel.h"
+#include "util/compatibility.h"
+
+namespace {
+
+inline void spinPause() {
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+    __asm__ __volatile__("pause");
+#endif
+}
+
+} // anonymous namespace
+
+ChannelProcessingWorker::ChannelProcessingWorker(ChannelProcessingPool* pPool,
+                                                 int cpu)
+        : m_pPool(pPool),
+          m_iCpu(cpu),
+          m_iSleeping(0),
+          m_iQuit(0) {
+}
+
+ChannelProcessingWorker::~ChannelProcessingWorker() {
+}
+
+void ChannelProcessingWorker::wake() {
+    // Only pay for a semaphore release if the worker actually went to sleep.
+    if (m_iSleeping.testAndSetOrdered(1, 0)) {
+        m_semaWake.release();
+    }
+}
+
+void ChannelProcessingWorker::quit() {
+    m_iQuit.fetchAndStoreOrdered(1);
+    wake();
+}
+
+void ChannelProcessingWorker::reset() {
+    m_iQuit.fetchAndStoreOrdered(0);
+    m_iSleeping.fetchAndStoreOrdered(0);
+}
+
+void ChannelProcessingWorker::run() {
+    QThread::currentThread()->setObjectName(
+        QString("ChannelProcessingWorker %1").arg(m_iCpu));
+
+#ifdef __LINUX__
+    if (m_iCpu >= 0 && m_iCpu < CPU_SETSIZE) {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        CPU_SET(m_iCpu, &cpuSet);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) != 0) {
+            qWarning() << "ChannelProcessingWorker: could not pin to CPU" << m_iCpu;
+        }
+    }
+#endif
+
+    int lastGeneration = m_pPool->generation();
+    while (true) {
+        // Announce that we are going to wait and check again so that a batch
+        // published in the meantime is not missed.
+        m_iSleeping.fetchAndStoreOrdered(1);
+        if (m_pPool->generation() == lastGeneration && !deref(m_iQuit)) {
+            m_semaWake.acquire();
+        } else if (!m_iSleeping.testAndSetOrdered(1, 0)) {
+            // wake() has claimed the flag and is about to release the
+            // semaphore. Consume that release.
+            m_semaWake.acquire();
+        }
+        if (deref(m_iQuit)) {
+            return;
+        }
+        lastGeneration = m_pPool->generation();
+        m_pPool->runJobs();
+    }
+}
+
+ChannelProcessingPool::ChannelProcessingPool(int numWorkers, int maxChannels)
+        : m_pJobs(new Job[maxChannels]),
+          m_iMaxJobs(maxChannels),
+          m_iPendingJobs(0),
+          m_iJobCount(0),
+          m_iCompleted(0),
+          m_iGeneration(0),
+          m_iRunning(0) {
+    for (int i = 0; i < m_iMaxJobs; ++i) {
+        m_pJobs[i].m_pChannel = NULL;
+        m_pJobs[i].m_pBuffer = NULL;
+        m_pJobs[i].m_iBufferSize = 0;
+        // Unused slots are marked as claimed so a worker never picks them up.
+        m_pJobs[i].m_iClaimed.fetchAndStoreRelease(1);
+    }
+
+    const int cores = QThread::idealThreadCount();
+    if (numWorkers < 0) {
+        // Leave one core for the callback thread which takes part in every
+        // batch anyway.
+        numWorkers = qMax(0, cores - 1);
+    }
+    for (int i = 0; i < numWorkers; ++i) {
+        // Pin the workers to all but the first core.
+        int cpu = cores > 1 ? 1 + i % (cores - 1) : -1;
+        m_workers.append(new ChannelProcessingWorker(this, cpu));
+    }
+}
+
+ChannelProcessingPool::~ChannelProcessingPool() {
+    stop();
+    foreach (ChannelProcessingWorker* pWorker, m_workers) {
+        delete pWorker;
+    }
+    delete [] m_pJobs;
+}
+
+void ChannelProcessingPool::start() {
+    if (isRunning()) {
+        return;
+    }
+    foreach (ChannelProcessingWorker* pWorker, m_workers) {
+        pWorker->reset();
+        // Below TimeCriticalPriority, which the audio callback may use, so a
+        // worker that is busy with a channel can't hold up the callback
+        // thread it is working for.
+        pWorker->start(QThread::HighestPriority);
+    }
+    m_iRunning.fetchAndStoreRelease(1);
+    qDebug() << "ChannelProcessingPool started" << m_workers.size()
+             << "workers";
+}
+
+void ChannelProcessingPool::stop() {
+    if (!isRunning()) {
+        return;
+    }
+    m_iRunning.fetchAndStoreRelease(0);
+    // A batch in progress is finished by the callback thread, which claims
+    // the jobs that the stopped workers leave behind. The worker objects stay
+    // around because processBatch() may still wake them.
+    foreach (ChannelProcessingWorker* pWorker, m_workers) {
+        pWorker->quit();
+    }
+    foreach (ChannelProcessingWorker* pWorker, m_workers) {
+        pWorker->wait();
+    }
+    qDebug() << "ChannelProcessingPool stopped";
+}
+
+bool ChannelProcessingPool::isRunning() const {
+    return deref(m_iRunning) != 0;
+}
+
+int ChannelProcessingPool::generation() const {
+    return deref(m_iGeneration);
+}
+
+bool ChannelProcessingPool::addChannel(EngineChannel* pChannel,
+                                       CSAMPLE* pBuffer) {
+    if (m_iPendingJobs >= m_iMaxJobs) {
+        return false;
+    }
+    Job& job = m_pJobs[m_iPendingJobs++];
+    job.m_pChannel = pChannel;
+    job.m_pBuffer = pBuffer;
+    return true;
+}
+
+void ChannelProcessingPool::processBatch(const int iBufferSize) {
+    const int jobCount = m_iPendingJobs;
+    m_iPendingJobs = 0;
+    if (jobCount == 0) {
+        return;
+    }
+
+    // Nothing to gain from a handoff with a single job or no workers.
+    if (jobCount == 1 || m_workers.isEmpty()) {
+        for (int i = 0; i < jobCount; ++i) {
+            m_pJobs[i].m_pChannel->process(NULL, m_pJobs[i].m_pBuffer,
+                                           iBufferSize);
+        }
+        return;
+    }
+
+    // All jobs of the previous batch are complete so no thread can touch
+    // m_iCompleted until the first job below is released.
+    m_iCompleted.fetchAndStoreRelease(0);
+    for (int i = 0; i < jobCount; ++i) {
+        m_pJobs[i].m_iBufferSize = iBufferSize;
+        // Publishes the job parameters written above.
+        m_pJobs[i].m_iClaimed.fetchAndStoreRelease(0);
+    }
+    m_iJobCount.fetchAndStoreRelease(jobCount);
+    m_iGeneration.fetchAndAddRelease(1);
+
+    // Wake at most as many workers as there are jobs left for them.
+    const int wakeCount = qMin(m_workers.size(), jobCount - 1);
+    for (int i = 0; i < wakeCount; ++i) {
+        m_workers[i]->wake();
+    }
+
+    // The callback thread works on the batch too.
+    runJobs();
+
+    while (deref(m_iCompleted) < jobCount) {
+        spinPause();
+    }
+}
+
+void ChannelProcessingPool::runJobs() {
+    const int jobCount = deref(m_iJobCount);
+    for (int i = 0; i < jobCount; ++i) {
+        Job& job = m_pJobs[i];
+        if (job.m_iClaimed.testAndSetAcquire(0, 1)) {
+            job.m_pChannel->process(NULL, job.m_pBuffer, job.m_iBufferSize);
+            m_iCompleted.fetchAndAddRelease(1);
+        }
+    }
+}
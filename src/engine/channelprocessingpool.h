@@ -0,0 +1,110 @@
+// channelprocessingpool.h
+// Parallel EngineChannel processing for the audio callback.
+
+#ifndef CHANNELPROCESSINGPOOL_H
+#define CHANNELPROCESSINGPOOL_H
+
+#include <QAtomicInt>
+#include <QSemaphore>
+#include <QThread>
+#include <QVector>
+
+#include "defs.h"
+#include "util.h"
+
+class EngineChannel;
+class ChannelProcessingPool;
+
+// A worker thread owned by ChannelProcessingPool. Workers are created with
+// the pool and only started and stopped by ChannelProcessingPool::start() and
+// stop(), never from the callback thread.
+class ChannelProcessingWorker : public QThread {
+    Q_OBJECT
+  public:
+    ChannelProcessingWorker(ChannelProcessingPool* pPool, int cpu);
+    virtual ~ChannelProcessingWorker();
+
+    // Called by the callback thread after a new batch has been published.
+    // Only touches the semaphore if the worker is waiting on it.
+    void wake();
+    void quit();
+    // Clears a previous quit() so the worker can be started again.
+    void reset();
+
+  protected:
+    void run();
+
+  private:
+    ChannelProcessingPool* m_pPool;
+    const int m_iCpu;
+    // 1 if the worker is (about to be) blocked on m_semaWake.
+    QAtomicInt m_iSleeping;
+    QSemaphore m_semaWake;
+    QAtomicInt m_iQuit;
+};
+
+// ChannelProcessingPool processes a batch of independent EngineChannels
+// concurrently. It is driven exclusively from the engine callback thread via
+// processBatch(), which blocks until every channel in the batch has been
+// processed. The callback thread takes part in the work itself, so a pool
+// with zero workers degrades to serial processing.
+//
+// processBatch() does not allocate, does not emit signals and does not take
+// locks: idle workers block on a semaphore (a futex on Linux) and the callback
+// thread only releases it for workers that are waiting.
+class ChannelProcessingPool {
+  public:
+    // Creates numWorkers worker threads that can process up to maxChannels
+    // channels per batch. If numWorkers is negative, one worker per spare core
+    // is created. The threads are not running until start() is called.
+    ChannelProcessingPool(int numWorkers, int maxChannels);
+    virtual ~ChannelProcessingPool();
+
+    int numWorkers() const {
+        return m_workers.size();
+    }
+
+    // Starts and stops the worker threads. Must not be called from the
+    // callback thread. A batch that is processed while the workers are
+    // stopped is processed by the callback thread alone.
+    void start();
+    void stop();
+    bool isRunning() const;
+
+    // Callback thread only. Call addChannel for every channel that should be
+    // processed and then processBatch to run them. Returns false if the batch
+    // is full, in which case the caller has to process the channel itself.
+    bool addChannel(EngineChannel* pChannel, CSAMPLE* pBuffer);
+    void processBatch(const int iBufferSize);
+
+  private:
+    struct Job {
+        EngineChannel* m_pChannel;
+        CSAMPLE* m_pBuffer;
+        int m_iBufferSize;
+        // 0 while the job is waiting to be claimed, 1 once a thread has
+        // claimed it (or the slot is unused).
+        QAtomicInt m_iClaimed;
+    };
+
+    // Claims and runs jobs of the current batch until none are left. Safe to
+    // call from any pool thread, including the callback thread.
+    void runJobs();
+    int generation() const;
+
+    Job* m_pJobs;
+    const int m_iMaxJobs;
+    // Number of jobs added since the last processBatch. Callback thread only.
+    int m_iPendingJobs;
+    // The published number of jobs of the current batch.
+    QAtomicInt m_iJobCount;
+    QAtomicInt m_iCompleted;
+    QAtomicInt m_iGeneration;
+    QAtomicInt m_iRunning;
+    QVector<ChannelProcessingWorker*> m_workers;
+
+    friend class ChannelProcessingWorker;
+    DISALLOW_COPY_AND_ASSIGN(ChannelProcessingPool);
+};
+
+#endif /* CHANNELPROCESSINGPOOL_H */
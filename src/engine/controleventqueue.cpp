@@ -0,0 +1,257 @@
+#include <QMutexLocker>
+#include <QtDebug>
+
+#include "engine/controleventqueue.h"
+
+#include "controlobject.h"
+#include "defs.h"
+#include "util/compatibility.h"
+
+namespace {
+
+// Must be a power of two for the FIFO.
+const int kEventQueueSize = 1024;
+
+// The controls of a deck whose changes are applied sample accurately.
+const char* kScheduledControls[] = { "play", "rate", "scratch2" };
+
+// Whether sequence number a is newer than b, allowing for wrap around.
+inline bool isNewer(int a, int b) {
+    return static_cast<int>(static_cast<unsigned int>(a) -
+                            static_cast<unsigned int>(b)) > 0;
+}
+
+}  // anonymous namespace
+
+// static
+QMutex ControlEventQueue::s_registryMutex;
+// static
+QHash<ControlObject*, ControlEventQueue*> ControlEventQueue::s_registry;
+// static
+unsigned int ControlEventQueue::s_iSequence = 0;
+
+ControlEventQueue::ControlEventQueue(const QString& group)
+        : m_iProcessed(0),
+          m_events(kEventQueueSize),
+          m_bHasPending(false),
+          m_periodStart(0),
+          m_periodEnd(0),
+          m_iBufferSize(0),
+          m_iNextOffset(0) {
+    QMutexLocker locker(&s_registryMutex);
+    for (unsigned int i = 0;
+         i < sizeof(kScheduledControls) / sizeof(kScheduledControls[0]); ++i) {
+        ControlObject* pControl = ControlObject::getControl(
+                ConfigKey(group, kScheduledControls[i]));
+        if (pControl == NULL) {
+            qWarning() << "ControlEventQueue: no control" << group
+                       << kScheduledControls[i];
+            continue;
+        }
+        ScheduledControl* pScheduled = new ScheduledControl;
+        pScheduled->pControl = pControl;
+        pScheduled->lastQueued = 0;
+        pScheduled->lastQueuedValue = 0.0;
+        pScheduled->bLastQueuedValueKnown = false;
+        m_controls.append(pScheduled);
+        s_registry.insert(pControl, this);
+    }
+}
+
+ControlEventQueue::~ControlEventQueue() {
+    QMutexLocker locker(&s_registryMutex);
+    foreach (ScheduledControl* pScheduled, m_controls) {
+        s_registry.remove(pScheduled->pControl);
+        delete pScheduled;
+    }
+}
+
+// static
+bool ControlEventQueue::schedule(ControlObject* pControl, double value,
+                                 qint64 timestamp) {
+    ControlEvent event;
+    event.pControl = pControl;
+    event.value = value;
+    event.fromMidi = false;
+    event.opCode = MIDI_NOTE_ON;
+    event.timestamp = timestamp;
+    return enqueue(event, true);
+}
+
+// static
+bool ControlEventQueue::scheduleFromMidi(ControlObject* pControl,
+                                         MidiOpCode opCode, double value,
+                                         qint64 timestamp) {
+    ControlEvent event;
+    event.pControl = pControl;
+    event.value = value;
+    event.fromMidi = true;
+    event.opCode = opCode;
+    event.timestamp = timestamp;
+    return enqueue(event, false);
+}
+
+// static
+void ControlEventQueue::setDirectly(ControlObject* pControl) {
+    QMutexLocker locker(&s_registryMutex);
+    ScheduledControl* pScheduled = lookup(pControl);
+    if (pScheduled != NULL) {
+        pScheduled->lastDirect.fetchAndStoreRelease(
+                static_cast<int>(++s_iSequence));
+    }
+}
+
+// static
+bool ControlEventQueue::pendingValue(ControlObject* pControl, double* pValue) {
+    QMutexLocker locker(&s_registryMutex);
+    ScheduledControl* pScheduled = lookup(pControl);
+    if (pScheduled == NULL || !pScheduled->bLastQueuedValueKnown ||
+            !isNewer(pScheduled->lastQueued, deref(pScheduled->lastDirect)) ||
+            !isNewer(pScheduled->lastQueued, deref(pScheduled->lastApplied))) {
+        return false;
+    }
+    *pValue = pScheduled->lastQueuedValue;
+    return true;
+}
+
+// static
+bool ControlEventQueue::enqueue(const ControlEvent& event, bool bValueKnown) {
+    // The mutex only guards the registry and the controller side state of the
+    // scheduled controls. The engine thread never takes it.
+    QMutexLocker locker(&s_registryMutex);
+    ScheduledControl* pScheduled = lookup(event.pControl);
+    if (pScheduled == NULL) {
+        return false;
+    }
+    ControlEventQueue* pQueue = s_registry.value(event.pControl);
+    ControlEvent sequenced = event;
+    sequenced.sequence = static_cast<int>(++s_iSequence);
+    // A deck that is not processed would never apply the event, and once it
+    // is processed again the event would overwrite any newer direct change.
+    if (deref(pQueue->m_iProcessed) == 0 ||
+            pQueue->m_events.write(&sequenced, 1) != 1) {
+        pScheduled->lastDirect.fetchAndStoreRelease(sequenced.sequence);
+        return false;
+    }
+    pScheduled->lastQueued = sequenced.sequence;
+    pScheduled->lastQueuedValue = sequenced.value;
+    pScheduled->bLastQueuedValueKnown = bValueKnown;
+    return true;
+}
+
+// static
+ControlEventQueue::ScheduledControl* ControlEventQueue::lookup(
+        ControlObject* pControl) {
+    ControlEventQueue* pQueue = s_registry.value(pControl, NULL);
+    if (pQueue == NULL) {
+        return NULL;
+    }
+    foreach (ScheduledControl* pScheduled, pQueue->m_controls) {
+        if (pScheduled->pControl == pControl) {
+            return pScheduled;
+        }
+    }
+    return NULL;
+}
+
+void ControlEventQueue::startCallback(qint64 periodStart, qint64 periodEnd,
+                                      int iBufferSize) {
+    m_iProcessed.fetchAndStoreRelease(1);
+    m_periodStart = periodStart;
+    m_periodEnd = periodEnd;
+    m_iBufferSize = iBufferSize;
+    if (!m_bHasPending) {
+        fetchNext();
+    }
+    // offsetOf() never returns an offset before m_iNextOffset.
+    m_iNextOffset = 0;
+    m_iNextOffset = m_bHasPending ? offsetOf(m_pending.timestamp) : iBufferSize;
+}
+
+void ControlEventQueue::skipCallback() {
+    m_iProcessed.fetchAndStoreRelease(0);
+    // Events that were queued before the controller thread saw the flag are
+    // applied right away, in order.
+    if (!m_bHasPending) {
+        fetchNext();
+    }
+    while (m_bHasPending) {
+        applyPending();
+        fetchNext();
+    }
+    m_iNextOffset = m_iBufferSize;
+}
+
+int ControlEventQueue::nextEventOffset() const {
+    return m_iNextOffset;
+}
+
+int ControlEventQueue::applyNextEvent() {
+    if (!m_bHasPending || m_iNextOffset >= m_iBufferSize) {
+        return m_iBufferSize;
+    }
+    const int offset = m_iNextOffset;
+    applyPending();
+    fetchNext();
+    m_iNextOffset = m_bHasPending ? offsetOf(m_pending.timestamp) : m_iBufferSize;
+    return offset;
+}
+
+void ControlEventQueue::applyAllEvents() {
+    while (m_iNextOffset < m_iBufferSize) {
+        applyNextEvent();
+    }
+}
+
+void ControlEventQueue::applyEventsUpTo(int offset) {
+    while (m_iNextOffset <= offset && m_iNextOffset < m_iBufferSize) {
+        applyNextEvent();
+    }
+}
+
+void ControlEventQueue::applyPending() {
+    m_bHasPending = false;
+    // m_controls does not change after construction.
+    ScheduledControl* pScheduled = NULL;
+    foreach (ScheduledControl* pCandidate, m_controls) {
+        if (pCandidate->pControl == m_pending.pControl) {
+            pScheduled = pCandidate;
+            break;
+        }
+    }
+    if (pScheduled == NULL) {
+        return;
+    }
+    // Drop the event if the control was set directly after it was queued.
+    if (isNewer(m_pending.sequence, deref(pScheduled->lastDirect))) {
+        if (m_pending.fromMidi) {
+            m_pending.pControl->setValueFromMidi(m_pending.opCode,
+                                                 m_pending.value);
+        } else {
+            m_pending.pControl->set(m_pending.value);
+        }
+    }
+    pScheduled->lastApplied.fetchAndStoreRelease(m_pending.sequence);
+}
+
+void ControlEventQueue::fetchNext() {
+    m_bHasPending = m_events.read(&m_pending, 1) == 1;
+}
+
+int ControlEventQueue::offsetOf(qint64 timestamp) const {
+    // Events from after the start of this callback wait for the next one.
+    if (timestamp >= m_periodEnd) {
+        return m_iBufferSize;
+    }
+    int offset = 0;
+    const qint64 period = m_periodEnd - m_periodStart;
+    if (period > 0 && timestamp > m_periodStart) {
+        offset = static_cast<int>(
+                (timestamp - m_periodStart) * m_iBufferSize / period);
+    }
+    // Events that arrive from several controllers may be slightly out of
+    // order. Never go back within the callback.
+    offset = math_max(offset, m_iNextOffset);
+    // Align to a stereo frame.
+    return math_min(offset, m_iBufferSize - 1) & ~1;
+}
@@ -0,0 +1,145 @@
+#ifndef CONTROLEVENTQUEUE_H
+#define CONTROLEVENTQUEUE_H
+
+#include <QAtomicInt>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+
+#include "controllers/midi/midimessage.h"
+#include "util/fifo.h"
+#include "util.h"
+
+class ControlObject;
+
+// A change of a control that was received at a known time. Timestamps are in
+// the Time::elapsed() time base, i.e. nanoseconds since startup.
+struct ControlEvent {
+    ControlObject* pControl;
+    double value;
+    // If true the value is applied with ControlObject::setValueFromMidi().
+    bool fromMidi;
+    MidiOpCode opCode;
+    qint64 timestamp;
+    // Increases with every change of a scheduled control, queued or not.
+    int sequence;
+};
+
+// ControlEventQueue applies changes of the deck controls that are sensitive to
+// timing (play, rate and scratch2) at the sample offset within the callback
+// that corresponds to the time the controller received them, rather than at
+// the start of whichever callback runs after the controller was polled.
+//
+// Events are delayed by one callback: an event received during the period
+// between the previous and the current callback start is applied at the same
+// relative position within the current callback. This trades one callback of
+// latency for removing the jitter of the controller poll timer.
+//
+// Each EngineDeck owns one queue. The controller thread schedules events with
+// the static schedule() methods, which are the only producer of all queues, and
+// the engine thread is their only consumer.
+//
+// A change that is not queued, because the deck is not processed by the engine
+// or the queue is full, is applied directly by the caller. Queued changes that
+// are older than such a direct change are dropped so that they can not
+// overwrite it later on.
+class ControlEventQueue {
+  public:
+    explicit ControlEventQueue(const QString& group);
+    virtual ~ControlEventQueue();
+
+    // Queues a change of pControl if it is scheduled by a deck. Returns false
+    // if the control is not scheduled, the deck is not processed or the queue
+    // is full, in which case the caller has to apply the change itself.
+    // Controller thread only.
+    static bool schedule(ControlObject* pControl, double value,
+                         qint64 timestamp);
+    static bool scheduleFromMidi(ControlObject* pControl, MidiOpCode opCode,
+                                 double value, qint64 timestamp);
+
+    // Tells the queue of pControl that the caller sets it directly, so that
+    // changes that are still queued are dropped. Used for changes that depend
+    // on the current value, e.g. relative MIDI mappings. Controller thread
+    // only.
+    static void setDirectly(ControlObject* pControl);
+
+    // Returns true and stores the value of the latest change of pControl in
+    // pValue if it is still queued. Lets scripts read back what they have
+    // scheduled. Controller thread only.
+    static bool pendingValue(ControlObject* pControl, double* pValue);
+
+    // The remaining methods are called by the engine thread only.
+
+    // Starts a callback of iBufferSize samples that covers the events received
+    // in [periodStart, periodEnd). Changes are queued from now on.
+    void startCallback(qint64 periodStart, qint64 periodEnd, int iBufferSize);
+
+    // Called instead of startCallback() in a callback in which the deck is not
+    // processed. Applies all queued changes and stops queueing new ones until
+    // the next startCallback().
+    void skipCallback();
+
+    // Returns the sample offset within the current callback at which the next
+    // event is due, or the buffer size if no more events are due.
+    int nextEventOffset() const;
+
+    // Applies the next event and returns its offset. Must only be called if
+    // nextEventOffset() is less than the buffer size.
+    int applyNextEvent();
+
+    // Applies all events that are due in the current callback.
+    void applyAllEvents();
+
+    // Applies the events that are due at or before offset.
+    void applyEventsUpTo(int offset);
+
+  private:
+    // The state of a control that is scheduled by the queue. The fields that
+    // are not atomic are guarded by s_registryMutex.
+    struct ScheduledControl {
+        ControlObject* pControl;
+        // The sequence number and value of the last queued change.
+        int lastQueued;
+        double lastQueuedValue;
+        // Whether lastQueuedValue is the value the control will be set to.
+        // Not the case for MIDI values that are mapped by the control.
+        bool bLastQueuedValueKnown;
+        // Written by the controller thread: the sequence number of the last
+        // change that was applied directly.
+        QAtomicInt lastDirect;
+        // Written by the engine thread: the sequence number of the last
+        // event that was applied or dropped.
+        QAtomicInt lastApplied;
+    };
+
+    static bool enqueue(const ControlEvent& event, bool bValueKnown);
+    // Returns the scheduled control for pControl or NULL. Must be called with
+    // s_registryMutex locked.
+    static ScheduledControl* lookup(ControlObject* pControl);
+    // Applies m_pending unless it was overridden by a direct change.
+    void applyPending();
+    // Reads the next event from the FIFO into m_pending.
+    void fetchNext();
+    int offsetOf(qint64 timestamp) const;
+
+    static QMutex s_registryMutex;
+    static QHash<ControlObject*, ControlEventQueue*> s_registry;
+    static unsigned int s_iSequence;
+
+    QList<ScheduledControl*> m_controls;
+    // 1 from startCallback() until skipCallback(). Changes are only queued
+    // while it is set.
+    QAtomicInt m_iProcessed;
+    FIFO<ControlEvent> m_events;
+    ControlEvent m_pending;
+    bool m_bHasPending;
+    qint64 m_periodStart;
+    qint64 m_periodEnd;
+    int m_iBufferSize;
+    int m_iNextOffset;
+
+    DISALLOW_COPY_AND_ASSIGN(ControlEventQueue);
+};
+
+#endif /* CONTROLEVENTQUEUE_H */
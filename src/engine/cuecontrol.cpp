@@ -558,7 +558,7 @@ void CueControl::hintReader(QVector<Hint>* pHintList) {
     if (cuePoint >= 0) {
         cue_hint.sample = m_pCuePoint->get();
         cue_hint.length = 0;
-        cue_hint.priority = 10;
+        cue_hint.priority = kHintPriorityCue;
         pHintList->append(cue_hint);
     }
 
@@ -572,7 +572,7 @@ void CueControl::hintReader(QVector<Hint>* pHintList) {
                 if (cue_hint.sample % 2 != 0)
                     cue_hint.sample--;
                 cue_hint.length = 0;
-                cue_hint.priority = 10;
+                cue_hint.priority = kHintPriorityCue;
                 pHintList->push_back(cue_hint);
             }
         }
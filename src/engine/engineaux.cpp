@@ -119,6 +119,7 @@ void EngineAux::receiveBuffer(AudioInput input, const CSAMPLE* pBuffer,
             // come in, right?
             qWarning() << "ERROR: Buffer overflow in EngineAux. Dropping samples on the floor.";
         }
+        wakeUp();
     }
 }
 
@@ -26,6 +26,7 @@
 #include "configobject.h"
 #include "controlpotmeter.h"
 #include "controllinpotmeter.h"
+#include "engine/controleventqueue.h"
 #include "engine/enginechannel.h"
 #include "engine/enginebufferscalest.h"
 #include "engine/enginebufferscalerubberband.h"
@@ -101,7 +102,10 @@ EngineBuffer::EngineBuffer(const char* _group, ConfigObject<ConfigValue>* _confi
           m_iDitherBufferReadIndex(0),
           m_pCrossFadeBuffer(SampleUtil::alloc(MAX_BUFFER_LEN)),
           m_iCrossFadeSamples(0),
-          m_iLastBufferSize(0) {
+          m_iLastBufferSize(0),
+          m_pControlEvents(NULL),
+          m_pauseLockTimerKey(
+                  Stat::registerKey("EngineBuffer::process_pauselock")) {
 
     // Generate dither values. When engine samples used to be within [SHRT_MIN,
     // SHRT_MAX] dithering values were in the range [-0.5, 0.5]. Now that we
@@ -633,6 +637,10 @@ void EngineBuffer::slotControlSlip(double v)
 }
 
 
+void EngineBuffer::setControlEventQueue(ControlEventQueue* pControlEvents) {
+    m_pControlEvents = pControlEvents;
+}
+
 void EngineBuffer::process(const CSAMPLE*, CSAMPLE* pOutput, const int iBufferSize)
 {
     Q_ASSERT(even(iBufferSize));
@@ -652,9 +660,15 @@ void EngineBuffer::process(const CSAMPLE*, CSAMPLE* pOutput, const int iBufferSi
 
     bool bTrackLoading = deref(m_iTrackLoading) != 0;
     if (!bTrackLoading && m_pause.tryLock()) {
-        ScopedTimer t("EngineBuffer::process_pauselock");
+        ScopedTimer t(m_pauseLockTimerKey);
         float sr = m_pSampleRate->get();
 
+        // Changes of scheduled controls that are due at the start of the
+        // callback are applied before the rate is calculated.
+        if (m_pControlEvents != NULL) {
+            m_pControlEvents->applyEventsUpTo(0);
+        }
+
         double baserate = 0.0;
         if (sr > 0) {
             baserate = ((double)m_file_srate_old / sr);
@@ -684,142 +698,62 @@ void EngineBuffer::process(const CSAMPLE*, CSAMPLE* pOutput, const int iBufferSi
 
         processSeek();
 
-        // If the baserate, speed, or pitch has changed, we need to update the
-        // scaler. Also, if we have changed scalers then we need to update the
-        // scaler.
-        if (baserate != m_baserate_old || speed != m_speed_old ||
-                pitch != m_pitch_old || m_bScalerChanged) {
-            // The rate returned by the scale object can be different from the
-            // wanted rate!  Make sure new scaler has proper position. This also
-            // crossfades between the old scaler and new scaler to prevent
-            // clicks.
-            if (m_bScalerChanged) {
-                clearScale();
-            } else if (m_pScale != m_pScaleLinear) { // linear scaler does this part for us now
-                //XXX: Trying to force RAMAN to read from correct
-                //     playpos when rate changes direction - Albert
-                if ((m_speed_old <= 0 && speed > 0) ||
-                    (m_speed_old >= 0 && speed < 0)) {
-                    clearScale();
+        // Whether or not the speed change calculated by RateControl should
+        // affect the pitch of the song (e.g. as a traditional style pitch
+        // fader does) or whether the pitch change should purely affect the
+        // tempo.
+        rate = updateScaler(baserate, speed, pitch,
+                            is_scratching || !keylock_enabled);
+
+        // The callback is processed in segments that are split at the offsets
+        // of the changes of scheduled controls, so that starting, stopping
+        // and speed changes take effect at the frame they are due. Without
+        // such changes the whole callback is one segment.
+        bool bPositionChecked = false;
+        int offset = 0;
+        while (true) {
+            const int segmentEnd = m_pControlEvents != NULL ?
+                    m_pControlEvents->nextEventOffset() : iBufferSize;
+
+            // If we're playing past the end, playing before the start, or
+            // standing still then by definition the segment is paused.
+            const bool at_end = m_filepos_play >= m_file_length_old;
+            const bool backwards = rate < 0;
+            bCurBufferPaused = (rate == 0 || (at_end && !backwards));
+
+            if (segmentEnd > offset) {
+                // If the segment is not paused, then scale the audio.
+                if (!bCurBufferPaused) {
+                    if (!bPositionChecked) {
+                        verifyPlayPosition();
+                        bPositionChecked = true;
+                    }
+                    scaleSegment(pOutput + offset, segmentEnd - offset);
                 }
+                // Crossfade if we just did a seek
+                crossFadeSegment(pOutput, offset, segmentEnd - offset,
+                                 iBufferSize);
+                rampSegment(pOutput + offset, segmentEnd - offset,
+                            bCurBufferPaused, rate);
+                offset = segmentEnd;
             }
-
-
-            // Now we need to update the scaler with the master sample rate, the
-            // base rate (ratio between sample rate of the source audio and the
-            // master samplerate), the deck speed, the pitch shift, and whether
-            // the deck speed should affect the pitch.
-
-            // The speed adjustment for the deck as calculated by
-            // RateControl. This is the ratio between track-time and real-time
-            // (1.0 being normal rate. 2.0 plays at 2x speed -- 2 track seconds
-            // pass for every 1 real second)
-            double speed_adjust = speed;
-
-            // The pitch adjustment in percentage of octaves (0.0 being normal
-            // pitch. 1.0 is a full octave shift up).
-            double pitch_adjust = pitch;
-
-            // Whether or not the speed change calculated by RateControl should
-            // affect the pitch of the song (e.g. as a traditional style pitch
-            // fader does) or whether the pitch change should purely affect the
-            // tempo.
-            bool speed_affects_pitch = is_scratching || !keylock_enabled;
-
-            m_pScale->setScaleParameters(m_pSampleRate->get(),
-                                         baserate, speed_affects_pitch,
-                                         &speed_adjust,
-                                         &pitch_adjust);
-
-            m_baserate_old = baserate;
-            m_speed_old = speed;
-            m_pitch_old = pitch;
-
-            // The way we treat rate inside of EngineBuffer is actually a
-            // description of "sample consumption rate" or percentage of samples
-            // consumed relative to playing back the track at its native sample
-            // rate and normal speed. pitch_adjust does not change the playback
-            // rate.
-            m_rate_old = rate = baserate * speed_adjust;
-
-            // Scaler is up to date now.
-            m_bScalerChanged = false;
-        } else {
-            // Scaler did not need updating. By definition this means we are at
-            // our old rate.
-            rate = m_rate_old;
-        }
-
-        bool at_start = m_filepos_play <= 0;
-        bool at_end = m_filepos_play >= m_file_length_old;
-        bool backwards = rate < 0;
-
-        // If we're playing past the end, playing before the start, or standing
-        // still then by definition the buffer is paused.
-        bCurBufferPaused = (rate == 0 || (at_end && !backwards));
-
-        // If the buffer is not paused, then scale the audio.
-        if (!bCurBufferPaused) {
-            // The fileposition should be: (why is this thing a double anyway!?
-            // Integer valued.
-            double filepos_play_rounded = round(m_filepos_play);
-            if (filepos_play_rounded != m_filepos_play) {
-                qWarning() << __FILE__ << __LINE__ << "ERROR: filepos_play is not round:" << m_filepos_play;
-                m_filepos_play = filepos_play_rounded;
-            }
-
-            // Even.
-            if (!even(m_filepos_play)) {
-                qWarning() << "ERROR: filepos_play is not even:" << m_filepos_play;
-                m_filepos_play--;
-            }
-
-            // Perform scaling of Reader buffer into buffer.
-            CSAMPLE* output = m_pScale->getScaled(iBufferSize);
-            double samplesRead = m_pScale->getSamplesRead();
-
-            // qDebug() << "sourceSamples used " << iSourceSamples
-            //          <<" samplesRead " << samplesRead
-            //          << ", buffer pos " << iBufferStartSample
-            //          << ", play " << filepos_play
-            //          << " bufferlen " << iBufferSize;
-
-            // Copy scaled audio into pOutput
-            memcpy(pOutput, output, sizeof(pOutput[0]) * iBufferSize);
-
-            if (m_bScalerOverride) {
-                // If testing, we don't have a real log so we fake the position.
-                m_filepos_play += samplesRead;
-            } else {
-                // Adjust filepos_play by the amount we processed. TODO(XXX) what
-                // happens if samplesRead is a fraction?
-                m_filepos_play =
-                        m_pReadAheadManager->getEffectiveVirtualPlaypositionFromLog(
-                                static_cast<int>(m_filepos_play), samplesRead);
-            }
-        }
-
-        //Crossfade if we just did a seek
-        if (m_iCrossFadeSamples > 0) {
-            int i = 0;
-            double cross_len = 0;
-            if (m_iCrossFadeSamples >= iBufferSize) {
-                i = m_iCrossFadeSamples - iBufferSize;
-                cross_len = static_cast<double>(iBufferSize) / 2.0;
-            } else {
-                cross_len = static_cast<double>(m_iCrossFadeSamples) / 2.0;
+            if (offset >= iBufferSize) {
+                break;
             }
-
-            double cross_mix = 0.0;
-            double cross_inc = 1.0 / cross_len;
-            // Do crossfade from old fadeout buffer to this new data
-            for (int j = 0; j + 1 < iBufferSize && i + 1 < m_iCrossFadeSamples; i += 2, j += 2) {
-                pOutput[j] = pOutput[j] * cross_mix + m_pCrossFadeBuffer[i] * (1.0 - cross_mix);
-                pOutput[j+1] = pOutput[j+1] * cross_mix + m_pCrossFadeBuffer[i+1] * (1.0 - cross_mix);
-                cross_mix += cross_inc;
-            }
-            m_iCrossFadeSamples = 0;
+            m_pControlEvents->applyEventsUpTo(offset);
+
+            // Recalculate the rate without advancing the per callback state
+            // of RateControl. A speed of zero pauses the rest of the callback.
+            is_scratching = false;
+            speed = m_pRateControl->recalculateRate(
+                    baserate, m_playButton->get() == 0.0, &is_scratching);
+            enablePitchAndTimeScaling(
+                    !is_scratching && (keylock_enabled || pitch != 0) &&
+                    fabs(speed) < 1.5);
+            rate = updateScaler(baserate, speed, pitch,
+                                is_scratching || !keylock_enabled);
         }
+        m_iCrossFadeSamples = 0;
 
         m_engineLock.lock();
         QListIterator<EngineControl*> it(m_engineControls);
@@ -839,8 +773,9 @@ void EngineBuffer::process(const CSAMPLE*, CSAMPLE* pOutput, const int iBufferSi
         updateIndicators(speed, iBufferSize);
 
         // Handle repeat mode
-        at_start = m_filepos_play <= 0;
-        at_end = m_filepos_play >= m_file_length_old;
+        bool at_start = m_filepos_play <= 0;
+        bool at_end = m_filepos_play >= m_file_length_old;
+        bool backwards = rate < 0;
 
         bool repeat_enabled = m_pRepeat->get() != 0.0;
 
@@ -863,6 +798,7 @@ void EngineBuffer::process(const CSAMPLE*, CSAMPLE* pOutput, const int iBufferSi
     } else { // if (!bTrackLoading && m_pause.tryLock()) {
         // If we can't get the pause lock then this buffer will be silence.
         bCurBufferPaused = true;
+        rampSegment(pOutput, iBufferSize, bCurBufferPaused, rate);
 
         // We are stopped. Report a speed of 0 to SyncControl.
         m_pSyncControl->reportPlayerSpeed(0.0, false);
@@ -874,12 +810,152 @@ void EngineBuffer::process(const CSAMPLE*, CSAMPLE* pOutput, const int iBufferSi
         hintReader(rate);
     }
 
+#ifdef __SCALER_DEBUG__
+    for (int i=0; i<iBufferSize; i+=2) {
+        writer << pOutput[i] <<  "\n";
+    }
+#endif
+
+    m_iLastBufferSize = iBufferSize;
+}
+
+double EngineBuffer::updateScaler(double baserate, double speed, double pitch,
+                                  bool speed_affects_pitch) {
+    // If the baserate, speed, or pitch has changed, we need to update the
+    // scaler. Also, if we have changed scalers then we need to update the
+    // scaler.
+    if (baserate != m_baserate_old || speed != m_speed_old ||
+            pitch != m_pitch_old || m_bScalerChanged) {
+        // The rate returned by the scale object can be different from the
+        // wanted rate!  Make sure new scaler has proper position. This also
+        // crossfades between the old scaler and new scaler to prevent
+        // clicks.
+        if (m_bScalerChanged) {
+            clearScale();
+        } else if (m_pScale != m_pScaleLinear) { // linear scaler does this part for us now
+            //XXX: Trying to force RAMAN to read from correct
+            //     playpos when rate changes direction - Albert
+            if ((m_speed_old <= 0 && speed > 0) ||
+                (m_speed_old >= 0 && speed < 0)) {
+                clearScale();
+            }
+        }
+
+
+        // Now we need to update the scaler with the master sample rate, the
+        // base rate (ratio between sample rate of the source audio and the
+        // master samplerate), the deck speed, the pitch shift, and whether
+        // the deck speed should affect the pitch.
+
+        // The speed adjustment for the deck as calculated by
+        // RateControl. This is the ratio between track-time and real-time
+        // (1.0 being normal rate. 2.0 plays at 2x speed -- 2 track seconds
+        // pass for every 1 real second)
+        double speed_adjust = speed;
+
+        // The pitch adjustment in percentage of octaves (0.0 being normal
+        // pitch. 1.0 is a full octave shift up).
+        double pitch_adjust = pitch;
+
+        m_pScale->setScaleParameters(m_pSampleRate->get(),
+                                     baserate, speed_affects_pitch,
+                                     &speed_adjust,
+                                     &pitch_adjust);
+
+        m_baserate_old = baserate;
+        m_speed_old = speed;
+        m_pitch_old = pitch;
+
+        // The way we treat rate inside of EngineBuffer is actually a
+        // description of "sample consumption rate" or percentage of samples
+        // consumed relative to playing back the track at its native sample
+        // rate and normal speed. pitch_adjust does not change the playback
+        // rate.
+        m_rate_old = baserate * speed_adjust;
+
+        // Scaler is up to date now.
+        m_bScalerChanged = false;
+    }
+    // If the scaler did not need updating, by definition this means we
+    // are at our old rate.
+    return m_rate_old;
+}
+
+void EngineBuffer::scaleSegment(CSAMPLE* pOutput, int iSamples) {
+    CSAMPLE* output = m_pScale->getScaled(iSamples);
+    double samplesRead = m_pScale->getSamplesRead();
+
+    // qDebug() << "sourceSamples used " << iSourceSamples
+    //          <<" samplesRead " << samplesRead
+    //          << ", buffer pos " << iBufferStartSample
+    //          << ", play " << filepos_play
+    //          << " bufferlen " << iSamples;
+
+    // Copy scaled audio into pOutput
+    memcpy(pOutput, output, sizeof(pOutput[0]) * iSamples);
+
+    if (m_bScalerOverride) {
+        // If testing, we don't have a real log so we fake the position.
+        m_filepos_play += samplesRead;
+    } else {
+        // Adjust filepos_play by the amount we processed. TODO(XXX) what
+        // happens if samplesRead is a fraction?
+        m_filepos_play =
+                m_pReadAheadManager->getEffectiveVirtualPlaypositionFromLog(
+                        static_cast<int>(m_filepos_play), samplesRead);
+    }
+}
+
+void EngineBuffer::verifyPlayPosition() {
+    // The fileposition should be: (why is this thing a double anyway!?
+    // Integer valued.
+    double filepos_play_rounded = round(m_filepos_play);
+    if (filepos_play_rounded != m_filepos_play) {
+        qWarning() << __FILE__ << __LINE__ << "ERROR: filepos_play is not round:" << m_filepos_play;
+        m_filepos_play = filepos_play_rounded;
+    }
+
+    // Even.
+    if (!even(m_filepos_play)) {
+        qWarning() << "ERROR: filepos_play is not even:" << m_filepos_play;
+        m_filepos_play--;
+    }
+}
+
+void EngineBuffer::crossFadeSegment(CSAMPLE* pOutput, int iOffset,
+                                    int iSamples, int iBufferSize) {
+    if (m_iCrossFadeSamples <= 0) {
+        return;
+    }
+    // The crossfade runs from the old fadeout buffer to the new data over the
+    // whole callback, or over the fadeout buffer if that is shorter.
+    int start = 0;
+    double cross_len = 0;
+    if (m_iCrossFadeSamples >= iBufferSize) {
+        start = m_iCrossFadeSamples - iBufferSize;
+        cross_len = static_cast<double>(iBufferSize) / 2.0;
+    } else {
+        cross_len = static_cast<double>(m_iCrossFadeSamples) / 2.0;
+    }
+
+    const double cross_inc = 1.0 / cross_len;
+    const int end = math_min(iOffset + iSamples, iBufferSize);
+    for (int j = iOffset, i = start + iOffset;
+         j + 1 < end && i + 1 < m_iCrossFadeSamples; i += 2, j += 2) {
+        const double cross_mix = (j / 2) * cross_inc;
+        pOutput[j] = pOutput[j] * cross_mix + m_pCrossFadeBuffer[i] * (1.0 - cross_mix);
+        pOutput[j+1] = pOutput[j+1] * cross_mix + m_pCrossFadeBuffer[i+1] * (1.0 - cross_mix);
+    }
+}
+
+void EngineBuffer::rampSegment(CSAMPLE* pOutput, int iSamples, bool bPaused,
+                               double rate) {
     const double kSmallRate = 0.005;
-    if (m_bLastBufferPaused && !bCurBufferPaused) {
+    if (m_bLastBufferPaused && !bPaused) {
         if (fabs(rate) > kSmallRate) { //at very slow forward rates, don't ramp up
             m_iRampState = ENGINE_RAMP_UP;
         }
-    } else if (!m_bLastBufferPaused && bCurBufferPaused) {
+    } else if (!m_bLastBufferPaused && bPaused) {
         m_iRampState = ENGINE_RAMP_DOWN;
     } else { //we are not changing state
         // Make sure we aren't accidentally ramping down. This is how we make
@@ -893,7 +969,7 @@ void EngineBuffer::process(const CSAMPLE*, CSAMPLE* pOutput, const int iBufferSi
         // if rate > 0 and bCurBufferPaused then basically you are at the end of
         // the track and trying to jog forward so this uniquely blocks that
         // situation.
-        if (fabs(rate) > kSmallRate && !bCurBufferPaused &&
+        if (fabs(rate) > kSmallRate && !bPaused &&
             m_iRampState != ENGINE_RAMP_UP && m_fRampValue < 1.0) {
             m_iRampState = ENGINE_RAMP_UP;
         }
@@ -907,8 +983,8 @@ void EngineBuffer::process(const CSAMPLE*, CSAMPLE* pOutput, const int iBufferSi
         // Ramp of 3.33 ms
         ramp_inc = m_iRampState * 300 / m_pSampleRate->get();
 
-        for (int i=0; i < iBufferSize; i += 2) {
-            if (bCurBufferPaused) {
+        for (int i=0; i < iSamples; i += 2) {
+            if (bPaused) {
                 CSAMPLE dither = m_pDitherBuffer[m_iDitherBufferReadIndex];
                 m_iDitherBufferReadIndex = (m_iDitherBufferReadIndex + 1) % MAX_BUFFER_LEN;
                 pOutput[i] = m_fLastSampleValue[0] * m_fRampValue + dither;
@@ -928,23 +1004,16 @@ void EngineBuffer::process(const CSAMPLE*, CSAMPLE* pOutput, const int iBufferSi
             }
         }
     } else if (m_fRampValue == 0.0) {
-        SampleUtil::applyGain(pOutput, 0.0, iBufferSize);
-    }
-
-    if ((!bCurBufferPaused && m_iRampState == ENGINE_RAMP_NONE) ||
-        (bCurBufferPaused && m_fRampValue == 0.0)) {
-        m_fLastSampleValue[0] = pOutput[iBufferSize-2];
-        m_fLastSampleValue[1] = pOutput[iBufferSize-1];
+        SampleUtil::applyGain(pOutput, 0.0, iSamples);
     }
 
-#ifdef __SCALER_DEBUG__
-    for (int i=0; i<iBufferSize; i+=2) {
-        writer << pOutput[i] <<  "\n";
+    if ((!bPaused && m_iRampState == ENGINE_RAMP_NONE) ||
+        (bPaused && m_fRampValue == 0.0)) {
+        m_fLastSampleValue[0] = pOutput[iSamples-2];
+        m_fLastSampleValue[1] = pOutput[iSamples-1];
     }
-#endif
 
-    m_bLastBufferPaused = bCurBufferPaused;
-    m_iLastBufferSize = iBufferSize;
+    m_bLastBufferPaused = bPaused;
 }
 
 void EngineBuffer::processSlip(int iBufferSize) {
@@ -1067,7 +1136,7 @@ void EngineBuffer::hintReader(const double dRate) {
         Hint hint;
         hint.length = 2048; //default length please
         hint.sample = m_dSlipRate >= 0 ? m_dSlipPosition : m_dSlipPosition - 2048;
-        hint.priority = 1;
+        hint.priority = kHintPriorityImminent;
         m_hintList.append(hint);
     }
 
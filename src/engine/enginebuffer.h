@@ -26,6 +26,7 @@
 #include "trackinfoobject.h"
 #include "configobject.h"
 #include "rotary.h"
+#include "util/stat.h"
 #include "control/controlvalue.h"
 
 //for the writer
@@ -63,6 +64,7 @@ class EngineSync;
 class EngineWorkerScheduler;
 class VisualPlayPosition;
 class EngineMaster;
+class ControlEventQueue;
 
 struct Hint;
 
@@ -125,6 +127,10 @@ class EngineBuffer : public EngineObject {
     void queueNewPlaypos(double newpos, enum SeekRequest seekType);
     void requestSyncPhase();
 
+    // Sets the queue of scheduled control changes that process() applies at
+    // their offset within the callback. The queue is not owned.
+    void setControlEventQueue(ControlEventQueue* pControlEvents);
+
     // The process methods all run in the audio callback.
     void process(const CSAMPLE* pIn, CSAMPLE* pOut, const int iBufferSize);
     void processSlip(int iBufferSize);
@@ -196,6 +202,24 @@ class EngineBuffer : public EngineObject {
 
     void processSeek();
 
+    // Updates the scaler if the baserate, speed or pitch changed and returns
+    // the rate at which track samples are consumed.
+    double updateScaler(double baserate, double speed, double pitch,
+                        bool speed_affects_pitch);
+
+    // Scales iSamples samples into pOutput and advances the play position.
+    void scaleSegment(CSAMPLE* pOutput, int iSamples);
+    // Rounds the play position to an even sample before scaling.
+    void verifyPlayPosition();
+    // Crossfades the samples [iOffset, iOffset + iSamples) of the callback
+    // output pOutput from the fadeout buffer of the last seek.
+    void crossFadeSegment(CSAMPLE* pOutput, int iOffset, int iSamples,
+                          int iBufferSize);
+    // Ramps iSamples samples of pOutput up or down if the deck started or
+    // stopped, and silences them while the deck is paused.
+    void rampSegment(CSAMPLE* pOutput, int iSamples, bool bPaused,
+                     double rate);
+
     double updateIndicatorsAndModifyPlay(double v);
     void verifyPlay();
 
@@ -335,6 +359,8 @@ class EngineBuffer : public EngineObject {
     CSAMPLE* m_pCrossFadeBuffer;
     int m_iCrossFadeSamples;
     int m_iLastBufferSize;
+    ControlEventQueue* m_pControlEvents;
+    StatKey m_pauseLockTimerKey;
 
     QSharedPointer<VisualPlayPosition> m_visualPlayPos;
 };
@@ -20,7 +20,9 @@ EngineBufferScaleRubberBand::EngineBufferScaleRubberBand(
         : m_bBackwards(false),
           m_buffer_back(SampleUtil::alloc(MAX_BUFFER_LEN)),
           m_pRubberBand(NULL),
-          m_pReadAheadManager(pReadAheadManager) {
+          m_pReadAheadManager(pReadAheadManager),
+          m_underflowCounterKey(Stat::registerKey(
+                  "EngineBufferScaleRubberBand::getScaled underflow")) {
     qDebug() << "RubberBand version" << RUBBERBAND_VERSION;
 
     m_retrieve_buffer[0] = SampleUtil::alloc(MAX_BUFFER_LEN);
@@ -240,7 +242,7 @@ CSAMPLE* EngineBufferScaleRubberBand::getScaled(unsigned long buf_size) {
 
     if (remaining_frames > 0) {
         SampleUtil::applyGain(read, 0.0f, remaining_frames * iNumChannels);
-        Counter counter("EngineBufferScaleRubberBand::getScaled underflow");
+        Counter counter(m_underflowCounterKey);
         counter.increment();
     }
 
@@ -2,6 +2,7 @@
 #define ENGINEBUFFERSCALERUBBERBAND_H
 
 #include "engine/enginebufferscale.h"
+#include "util/stat.h"
 
 namespace RubberBand {
 class RubberBandStretcher;
@@ -43,6 +44,8 @@ class EngineBufferScaleRubberBand : public EngineBufferScale {
 
     // The read-ahead manager that we use to fetch samples
     ReadAheadManager* m_pReadAheadManager;
+
+    StatKey m_underflowCounterKey;
 };
 
 
@@ -19,10 +19,13 @@
 
 #include "controlobject.h"
 #include "controlpushbutton.h"
+#include "engine/enginemaster.h"
 
 EngineChannel::EngineChannel(const char* pGroup,
                              EngineChannel::ChannelOrientation defaultOrientation)
-        : m_group(pGroup) {
+        : m_group(pGroup),
+          m_pEngineMaster(NULL),
+          m_iIndex(-1) {
     m_pPFL = new ControlPushButton(ConfigKey(m_group, "pfl"));
     m_pPFL->setButtonMode(ControlPushButton::TOGGLE);
     m_pMaster = new ControlPushButton(ConfigKey(m_group, "master"));
@@ -54,6 +57,17 @@ EngineChannel::~EngineChannel() {
     delete m_pTalkover;
 }
 
+void EngineChannel::setEngineMaster(EngineMaster* pEngineMaster, int index) {
+    m_pEngineMaster = pEngineMaster;
+    m_iIndex = index;
+}
+
+void EngineChannel::wakeUp() {
+    if (m_pEngineMaster != NULL) {
+        m_pEngineMaster->wakeUpChannel(m_iIndex);
+    }
+}
+
 const QString& EngineChannel::getGroup() const {
     return m_group;
 }
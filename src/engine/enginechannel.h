@@ -27,6 +27,7 @@ class EnginePregain;
 class EngineFilterBlock;
 class EngineClipping;
 class EngineFlanger;
+class EngineMaster;
 class EngineVuMeter;
 class EngineVinylSoundEmu;
 class ControlPushButton;
@@ -57,11 +58,31 @@ class EngineChannel : public EngineObject {
 
     virtual void process(const CSAMPLE* pIn, CSAMPLE* pOut, const int iBufferSize) = 0;
 
+    // Called by the EngineMaster instead of process() in a callback in which
+    // the channel is not processed because it falls asleep or is neither
+    // mixed to the master nor to the headphones.
+    virtual void skipProcess() {
+    }
+
+    // Called by EngineMaster::addChannel().
+    void setEngineMaster(EngineMaster* pEngineMaster, int index);
+
     // TODO(XXX) This hack needs to be removed.
     virtual EngineBuffer* getEngineBuffer() {
         return NULL;
     }
 
+  protected:
+    // The EngineMaster stops checking isActive() of a channel once it returned
+    // false. Subclasses call this from any thread when the channel may have
+    // become active again.
+    void wakeUp();
+
+    // The EngineMaster the channel was added to, or NULL.
+    EngineMaster* getEngineMaster() const {
+        return m_pEngineMaster;
+    }
+
   private slots:
     void slotOrientationLeft(double v);
     void slotOrientationRight(double v);
@@ -76,6 +97,8 @@ class EngineChannel : public EngineObject {
     ControlPushButton* m_pOrientationRight;
     ControlPushButton* m_pOrientationCenter;
     ControlPushButton* m_pTalkover;
+    EngineMaster* m_pEngineMaster;
+    int m_iIndex;
 };
 
 #endif
@@ -16,6 +16,7 @@
 ***************************************************************************/
 
 #include "controlpushbutton.h"
+#include "engine/controleventqueue.h"
 #include "engine/enginebuffer.h"
 #include "engine/enginevinylsoundemu.h"
 #include "engine/enginedeck.h"
@@ -26,6 +27,7 @@
 #include "engine/enginefilterblock.h"
 #include "engine/enginevumeter.h"
 #include "engine/enginefilteriir.h"
+#include "engine/enginemaster.h"
 
 #include "sampleutil.h"
 
@@ -58,11 +60,20 @@ EngineDeck::EngineDeck(const char* group,
     m_pFilterEffect = new EngineFilterEffect(group);
     m_pClipping = new EngineClipping(group);
     m_pBuffer = new EngineBuffer(group, pConfig, this, pMixingEngine);
+    // The deck becomes active when a track is loaded.
+    connect(m_pBuffer, SIGNAL(trackLoaded(TrackPointer)),
+            this, SLOT(slotTrackLoaded()),
+            Qt::DirectConnection);
     m_pVinylSoundEmu = new EngineVinylSoundEmu(pConfig, group);
     m_pVUMeter = new EngineVuMeter(group);
+    // Must be created after the EngineBuffer which creates the controls.
+    m_pControlEvents = new ControlEventQueue(group);
+    m_pBuffer->setControlEventQueue(m_pControlEvents);
 }
 
 EngineDeck::~EngineDeck() {
+    // Unregister the scheduled controls before they are deleted.
+    delete m_pControlEvents;
     SampleUtil::free(m_pConversionBuffer);
     delete m_pPassing;
 
@@ -77,8 +88,18 @@ EngineDeck::~EngineDeck() {
 }
 
 void EngineDeck::process(const CSAMPLE*, CSAMPLE* pOut, const int iBufferSize) {
+    qint64 periodStart = 0;
+    qint64 periodEnd = 0;
+    EngineMaster* pEngineMaster = getEngineMaster();
+    if (pEngineMaster != NULL) {
+        periodStart = pEngineMaster->getPreviousCallbackStartTime();
+        periodEnd = pEngineMaster->getCallbackStartTime();
+    }
+    m_pControlEvents->startCallback(periodStart, periodEnd, iBufferSize);
+
     // Feed the incoming audio through if passthrough is active
     if (isPassthroughActive()) {
+        m_pControlEvents->applyAllEvents();
         int samplesRead = m_sampleBuffer.read(pOut, iBufferSize);
         if (samplesRead < iBufferSize) {
             // Buffer underflow. There aren't getting samples fast enough. This
@@ -94,11 +115,16 @@ void EngineDeck::process(const CSAMPLE*, CSAMPLE* pOut, const int iBufferSize) {
             SampleUtil::applyGain(pOut, 0.0, iBufferSize);
             m_sampleBuffer.skip(iBufferSize);
             m_bPassthroughWasActive = false;
+            m_pControlEvents->applyAllEvents();
             return;
         }
 
-        // Process the raw audio
+        // Process the raw audio. EngineBuffer applies the scheduled control
+        // changes at their offsets, also while the deck is paused. The ones
+        // it did not get to, e.g. because the track is loading, take effect
+        // at the end of the callback.
         m_pBuffer->process(0, pOut, iBufferSize);
+        m_pControlEvents->applyAllEvents();
         // Emulate vinyl sounds
         m_pVinylSoundEmu->process(pOut, pOut, iBufferSize);
         m_bPassthroughWasActive = false;
@@ -116,6 +142,10 @@ void EngineDeck::process(const CSAMPLE*, CSAMPLE* pOut, const int iBufferSize) {
     m_pVUMeter->process(pOut, pOut, iBufferSize);
 }
 
+void EngineDeck::skipProcess() {
+    m_pControlEvents->skipCallback();
+}
+
 EngineBuffer* EngineDeck::getEngineBuffer() {
     return m_pBuffer;
 }
@@ -179,6 +209,7 @@ void EngineDeck::receiveBuffer(AudioInput input, const CSAMPLE* pBuffer, unsigne
             // they come in, right?
             qWarning() << "ERROR: Buffer overflow in EngineMicrophone. Dropping samples on the floor.";
         }
+        wakeUp();
     }
 }
 
@@ -206,4 +237,11 @@ bool EngineDeck::isPassthroughActive() const {
 
 void EngineDeck::slotPassingToggle(double v) {
     m_bPassthroughIsActive = v > 0;
+    if (m_bPassthroughIsActive) {
+        wakeUp();
+    }
+}
+
+void EngineDeck::slotTrackLoaded() {
+    wakeUp();
 }
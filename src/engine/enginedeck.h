@@ -37,6 +37,7 @@ class EngineMaster;
 class EngineVuMeter;
 class EngineVinylSoundEmu;
 class ControlPushButton;
+class ControlEventQueue;
 
 class EngineDeck : public EngineChannel, public AudioDestination {
     Q_OBJECT
@@ -46,6 +47,7 @@ class EngineDeck : public EngineChannel, public AudioDestination {
     virtual ~EngineDeck();
 
     virtual void process(const CSAMPLE* pInput, CSAMPLE* pOutput, const int iBufferSize);
+    virtual void skipProcess();
 
     // TODO(XXX) This hack needs to be removed.
     virtual EngineBuffer* getEngineBuffer();
@@ -71,6 +73,9 @@ class EngineDeck : public EngineChannel, public AudioDestination {
   public slots:
     void slotPassingToggle(double v);
 
+  private slots:
+    void slotTrackLoaded();
+
   private:
     ConfigObject<ConfigValue>* m_pConfig;
     EngineBuffer* m_pBuffer;
@@ -81,6 +86,9 @@ class EngineDeck : public EngineChannel, public AudioDestination {
     EnginePregain* m_pPregain;
     EngineVinylSoundEmu* m_pVinylSoundEmu;
     EngineVuMeter* m_pVUMeter;
+    // Changes of play, rate and scratch2 that are applied at their sample
+    // offset within the callback.
+    ControlEventQueue* m_pControlEvents;
 
     // Begin vinyl passthrough fields
     ControlPushButton* m_pPassing;
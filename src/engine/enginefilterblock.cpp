@@ -27,20 +27,26 @@
 #include "sampleutil.h"
 #include "util/timer.h"
 
+namespace {
+
+// Used until the sound device reports its sample rate.
+const int kDefaultSampleRate = 44100;
+
+}  // namespace
+
 ControlPotmeter* EngineFilterBlock::s_loEqFreq = NULL;
 ControlPotmeter* EngineFilterBlock::s_hiEqFreq = NULL;
 ControlPushButton* EngineFilterBlock::s_lofiEq = NULL;
 ControlPushButton* EngineFilterBlock::s_EnableEq = NULL;
 
 EngineFilterBlock::EngineFilterBlock(const char* group)
-{
-    ilowFreq = 0;
-    ihighFreq = 0;
-    blofi = false;
-
-    m_pSampleRate = new ControlObjectSlave("[Master]", "samplerate");
-    m_iOldSampleRate = 0;
-
+        : m_iActiveSet(BUTTERWORTH_B),
+          m_iLoadedVersion(0),
+          m_iDesignedSampleRate(0),
+          ilowFreq(0),
+          ihighFreq(0),
+          blofi(false),
+          m_processTimerKey(Stat::registerKey("EngineFilterBlock::process")) {
     //Setup Filter Controls
 
     if (s_loEqFreq == NULL) {
@@ -50,10 +56,39 @@ EngineFilterBlock::EngineFilterBlock(const char* group)
         s_EnableEq = new ControlPushButton(ConfigKey("[Mixer Profile]", "EnableEQs"));
     }
 
-    high = band = low = NULL;
+    // Redesign the filters in this thread when their parameters change.
+    m_pSampleRate = new ControlObjectSlave("[Master]", "samplerate");
+    m_pLoEqFreq = new ControlObjectSlave("[Mixer Profile]", "LoEQFrequency");
+    m_pHiEqFreq = new ControlObjectSlave("[Mixer Profile]", "HiEQFrequency");
+    m_pLofiEq = new ControlObjectSlave("[Mixer Profile]", "LoFiEQs");
+    m_pSampleRate->connectValueChanged(this, SLOT(slotDesignFilters()));
+    m_pLoEqFreq->connectValueChanged(this, SLOT(slotDesignFilters()));
+    m_pHiEqFreq->connectValueChanged(this, SLOT(slotDesignFilters()));
+    m_pLofiEq->connectValueChanged(this, SLOT(slotDesignFilters()));
+
+    // Allocate all filters up front. Their coefficients are replaced by
+    // loadCoefficients().
+    for (int i = 0; i < 2; ++i) {
+        m_pLow[i] = new EngineFilterButterworth8Low(kDefaultSampleRate, 246);
+        m_pBand[i] = new EngineFilterButterworth8Band(kDefaultSampleRate, 246, 2484);
+        m_pHigh[i] = new EngineFilterButterworth8High(kDefaultSampleRate, 2484);
+        m_filters[i][0] = m_pLow[i];
+        m_filters[i][1] = m_pBand[i];
+        m_filters[i][2] = m_pHigh[i];
+    }
+    // why is this DJM800 at line ~34 (LOFI ifdef) and just
+    // bessel_lowpass# here? bkgood
+    m_pLofiLow = new EngineFilterIIR(bessel_lowpass4,4);
+    m_pLofiBand = new EngineFilterIIR(bessel_bandpass,8);
+    m_pLofiHigh = new EngineFilterIIR(bessel_highpass4,4);
+    m_filters[LOFI][0] = m_pLofiLow;
+    m_filters[LOFI][1] = m_pLofiBand;
+    m_filters[LOFI][2] = m_pLofiHigh;
 
     //Load Defaults
-    setFilters(true);
+    slotDesignFilters();
+    m_iLoadedVersion = deref(m_iCoefficientsVersion);
+    m_iActiveSet = loadCoefficients(m_coefficients.getValue());
 
     /*
        lowrbj = new EngineFilterRBJ();
@@ -84,19 +119,27 @@ EngineFilterBlock::EngineFilterBlock(const char* group)
     m_pTemp1 = new CSAMPLE[MAX_BUFFER_LEN];
     m_pTemp2 = new CSAMPLE[MAX_BUFFER_LEN];
     m_pTemp3 = new CSAMPLE[MAX_BUFFER_LEN];
+    m_pCrossfade = new CSAMPLE[MAX_BUFFER_LEN];
 
     memset(m_pTemp1, 0, sizeof(CSAMPLE) * MAX_BUFFER_LEN);
     memset(m_pTemp2, 0, sizeof(CSAMPLE) * MAX_BUFFER_LEN);
     memset(m_pTemp3, 0, sizeof(CSAMPLE) * MAX_BUFFER_LEN);
+    memset(m_pCrossfade, 0, sizeof(CSAMPLE) * MAX_BUFFER_LEN);
 
     old_low = old_mid = old_high = 1.0;
 }
 
 EngineFilterBlock::~EngineFilterBlock()
 {
-    delete high;
-    delete band;
-    delete low;
+    for (int i = 0; i < 2; ++i) {
+        delete m_pHigh[i];
+        delete m_pBand[i];
+        delete m_pLow[i];
+    }
+    delete m_pLofiHigh;
+    delete m_pLofiBand;
+    delete m_pLofiLow;
+    delete [] m_pCrossfade;
     delete [] m_pTemp3;
     delete [] m_pTemp2;
     delete [] m_pTemp1;
@@ -106,6 +149,9 @@ EngineFilterBlock::~EngineFilterBlock()
     delete filterKillMid;
     delete filterpotHigh;
     delete filterKillHigh;
+    delete m_pLofiEq;
+    delete m_pHiEqFreq;
+    delete m_pLoEqFreq;
     delete m_pSampleRate;
 
     // Delete and clear these static controls. We need to clear them so that
@@ -120,37 +166,89 @@ EngineFilterBlock::~EngineFilterBlock()
     s_EnableEq = NULL;
 }
 
-void EngineFilterBlock::setFilters(bool forceSetting) {
+void EngineFilterBlock::slotDesignFilters() {
     int iSampleRate = static_cast<int>(m_pSampleRate->get());
-    if (m_iOldSampleRate != iSampleRate ||
-            (ilowFreq != (int)s_loEqFreq->get()) ||
-            (ihighFreq != (int)s_hiEqFreq->get()) ||
-            (blofi != (int)s_lofiEq->get()) ||
-            forceSetting) {
-        delete low;
-        delete band;
-        delete high;
-        ilowFreq = (int)s_loEqFreq->get();
-        ihighFreq = (int)s_hiEqFreq->get();
-        blofi = (int)s_lofiEq->get();
-        m_iOldSampleRate = iSampleRate;
-        if (blofi) {
-            // why is this DJM800 at line ~34 (LOFI ifdef) and just
-            // bessel_lowpass# here? bkgood
-            low = new EngineFilterIIR(bessel_lowpass4,4);
-            band = new EngineFilterIIR(bessel_bandpass,8);
-            high = new EngineFilterIIR(bessel_highpass4,4);
-        } else {
-            low = new EngineFilterButterworth8Low(iSampleRate, ilowFreq);
-            band = new EngineFilterButterworth8Band(iSampleRate, ilowFreq, ihighFreq);
-            high = new EngineFilterButterworth8High(iSampleRate, ihighFreq);
+    if (iSampleRate <= 0) {
+        iSampleRate = kDefaultSampleRate;
+    }
+    const int iLowFreq = static_cast<int>(m_pLoEqFreq->get());
+    const int iHighFreq = static_cast<int>(m_pHiEqFreq->get());
+    const bool bLofi = m_pLofiEq->get() != 0.0;
+    if (m_iDesignedSampleRate == iSampleRate && ilowFreq == iLowFreq &&
+            ihighFreq == iHighFreq && blofi == bLofi) {
+        return;
+    }
+    m_iDesignedSampleRate = iSampleRate;
+    ilowFreq = iLowFreq;
+    ihighFreq = iHighFreq;
+    blofi = bLofi;
+
+    EqFilterCoefficients coefficients;
+    coefficients.lofi = bLofi;
+    // fid_design_coef parses the filter spec and allocates, so this must not
+    // run in the engine.
+    EngineFilterButterworth8Low::designCoefficients(
+            iSampleRate, iLowFreq, coefficients.low);
+    EngineFilterButterworth8Band::designCoefficients(
+            iSampleRate, iLowFreq, iHighFreq, coefficients.band);
+    EngineFilterButterworth8High::designCoefficients(
+            iSampleRate, iHighFreq, coefficients.high);
+    m_coefficients.setValue(coefficients);
+    m_iCoefficientsVersion.fetchAndAddRelease(1);
+}
+
+int EngineFilterBlock::loadCoefficients(const EqFilterCoefficients& coefficients) {
+    if (coefficients.lofi) {
+        if (m_iActiveSet == LOFI) {
+            return -1;
         }
+        m_pLofiLow->initBuffers();
+        m_pLofiBand->initBuffers();
+        m_pLofiHigh->initBuffers();
+        return LOFI;
+    }
+
+    const int set = m_iActiveSet == BUTTERWORTH_A ? BUTTERWORTH_B : BUTTERWORTH_A;
+    m_pLow[set]->setCoefficients(coefficients.low);
+    m_pBand[set]->setCoefficients(coefficients.band);
+    m_pHigh[set]->setCoefficients(coefficients.high);
+    if (m_iActiveSet == LOFI) {
+        m_pLow[set]->initBuffers();
+        m_pBand[set]->initBuffers();
+        m_pHigh[set]->initBuffers();
+    } else {
+        // Continue where the active filters are, so the crossfade only has
+        // to cover the change of the response.
+        m_pLow[set]->assignState(m_pLow[m_iActiveSet]);
+        m_pBand[set]->assignState(m_pBand[m_iActiveSet]);
+        m_pHigh[set]->assignState(m_pHigh[m_iActiveSet]);
+    }
+    return set;
+}
+
+void EngineFilterBlock::processFilterSet(int set, const CSAMPLE* pIn,
+                                         CSAMPLE* pOutput, const int iBufferSize,
+                                         CSAMPLE fLow, CSAMPLE fMid, CSAMPLE fHigh) {
+    m_filters[set][0]->process(pIn, m_pTemp1, iBufferSize);
+    m_filters[set][1]->process(pIn, m_pTemp2, iBufferSize);
+    m_filters[set][2]->process(pIn, m_pTemp3, iBufferSize);
 
+    if (fLow != old_low || fMid != old_mid || fHigh != old_high) {
+        SampleUtil::copy3WithRampingGain(pOutput,
+                                         m_pTemp1, old_low, fLow,
+                                         m_pTemp2, old_mid, fMid,
+                                         m_pTemp3, old_high, fHigh,
+                                         iBufferSize);
+    } else {
+        SampleUtil::copy3WithGain(pOutput,
+                          m_pTemp1, fLow,
+                          m_pTemp2, fMid,
+                          m_pTemp3, fHigh, iBufferSize);
     }
 }
 
 void EngineFilterBlock::process(const CSAMPLE* pIn, CSAMPLE* pOutput, const int iBufferSize) {
-    ScopedTimer t("EngineFilterBlock::process");
+    ScopedTimer t(m_processTimerKey);
 
     // Check if EQ processing is disabled.
     if (!s_EnableEq->get()) {
@@ -166,23 +264,20 @@ void EngineFilterBlock::process(const CSAMPLE* pIn, CSAMPLE* pOutput, const int
     if (filterKillHigh->get()==0.)
         fHigh = filterpotHigh->get(); //*1.2;
 
-    setFilters();
+    int fadeSet = -1;
+    const int version = deref(m_iCoefficientsVersion);
+    if (version != m_iLoadedVersion) {
+        m_iLoadedVersion = version;
+        fadeSet = loadCoefficients(m_coefficients.getValue());
+    }
 
-    low->process(pIn, m_pTemp1, iBufferSize);
-    band->process(pIn, m_pTemp2, iBufferSize);
-    high->process(pIn, m_pTemp3, iBufferSize);
+    processFilterSet(m_iActiveSet, pIn, pOutput, iBufferSize, fLow, fMid, fHigh);
 
-    if (fLow != old_low || fMid != old_mid || fHigh != old_high) {
-        SampleUtil::copy3WithRampingGain(pOutput,
-                                         m_pTemp1, old_low, fLow,
-                                         m_pTemp2, old_mid, fMid,
-                                         m_pTemp3, old_high, fHigh,
-                                         iBufferSize);
-    } else {
-        SampleUtil::copy3WithGain(pOutput,
-                          m_pTemp1, fLow,
-                          m_pTemp2, fMid,
-                          m_pTemp3, fHigh, iBufferSize);
+    if (fadeSet >= 0) {
+        processFilterSet(fadeSet, pIn, m_pCrossfade, iBufferSize, fLow, fMid, fHigh);
+        SampleUtil::applyRampingGain(pOutput, 1.0, 0.0, iBufferSize);
+        SampleUtil::addWithRampingGain(pOutput, m_pCrossfade, 0.0, 1.0, iBufferSize);
+        m_iActiveSet = fadeSet;
     }
 
     old_low = fLow;
@@ -18,21 +18,43 @@
 #ifndef ENGINEFILTERBLOCK_H
 #define ENGINEFILTERBLOCK_H
 
+#include <QAtomicInt>
+
+#include "control/controlvalue.h"
 #include "engine/engineobject.h"
+#include "engine/enginefilterbutterworth8.h"
+#include "util/stat.h"
 
 class ControlObjectSlave;
 class ControlLogpotmeter;
 class ControlPotmeter;
 class ControlPushButton;
+class EngineFilterIIR;
 
 #define SIZE_NOISE_BUF 40
 //#define NOISE_FACTOR 116.415321827e-12 // 1/4 bit of noise (99db SNR)
 #define NOISE_FACTOR 0.25              // this is necessary to prevent denormals
 // from consuming too much CPU resources
 // and is well below being audible.
+
+// The coefficients of the EQ filters. Designed outside of the engine and
+// handed to it through a ControlValueAtomic.
+struct EqFilterCoefficients {
+    bool lofi;
+    CSAMPLE low[MAX_COEFS];
+    CSAMPLE band[MAX_COEFS];
+    CSAMPLE high[MAX_COEFS];
+};
+
 /**
   * Parallel processing of LP, BP and HP filters, and final mixing
   *
+  * The filters are designed in the thread the EngineFilterBlock lives in
+  * whenever the EQ frequencies, the LoFi setting or the sample rate change.
+  * process() picks up the newest coefficients, loads them into a spare set of
+  * preallocated filters that continues the state of the active set, and
+  * crossfades to it over one buffer, so it never allocates or clicks.
+  *
   *@author Tue and Ken Haste Andersen
   */
 
@@ -44,24 +66,63 @@ class EngineFilterBlock : public EngineObject {
 
     void process(const CSAMPLE* pIn, CSAMPLE* pOut, const int iBufferSize);
 
+  private slots:
+    // Designs and publishes new coefficients. Never called by the engine.
+    void slotDesignFilters();
+
   private:
-    void setFilters(bool forceSetting = false);
+    enum FilterSet {
+        BUTTERWORTH_A = 0,
+        BUTTERWORTH_B,
+        LOFI,
+        FILTER_SET_COUNT
+    };
+
+    // Loads coefficients into the filter set that is not active. Returns the
+    // set to crossfade to or -1 if the active set already has them.
+    int loadCoefficients(const EqFilterCoefficients& coefficients);
+    // Filters pIn with the filters of set and mixes the bands into pOutput
+    // with the gains ramping from the previous ones.
+    void processFilterSet(int set, const CSAMPLE* pIn, CSAMPLE* pOutput,
+                          const int iBufferSize,
+                          CSAMPLE fLow, CSAMPLE fMid, CSAMPLE fHigh);
 
     CSAMPLE *m_pTemp1, *m_pTemp2, *m_pTemp3;
-    EngineObject *low, *band, *high;
+    // The output of the filter set that is crossfaded to.
+    CSAMPLE* m_pCrossfade;
+    EngineFilterButterworth8Low* m_pLow[2];
+    EngineFilterButterworth8Band* m_pBand[2];
+    EngineFilterButterworth8High* m_pHigh[2];
+    EngineFilterIIR *m_pLofiLow, *m_pLofiBand, *m_pLofiHigh;
+    // The low, band and high filter of each FilterSet.
+    EngineObject* m_filters[FILTER_SET_COUNT][3];
+    int m_iActiveSet;
+
     ControlLogpotmeter *filterpotLow, *filterpotMid, *filterpotHigh;
     ControlPushButton *filterKillLow, *filterKillMid, *filterKillHigh;
     ControlObjectSlave* m_pSampleRate;
+    ControlObjectSlave* m_pLoEqFreq;
+    ControlObjectSlave* m_pHiEqFreq;
+    ControlObjectSlave* m_pLofiEq;
 
     static ControlPotmeter *s_loEqFreq, *s_hiEqFreq;
     static ControlPushButton *s_lofiEq;
     static ControlPushButton *s_EnableEq;
 
-    int m_iOldSampleRate;
+    // The newest coefficients. m_iCoefficientsVersion is incremented after
+    // they are published, m_iLoadedVersion is the version the engine loaded.
+    ControlValueAtomic<EqFilterCoefficients> m_coefficients;
+    QAtomicInt m_iCoefficientsVersion;
+    int m_iLoadedVersion;
+
     double old_low, old_mid, old_high;
 
+    // The parameters of the published coefficients.
+    int m_iDesignedSampleRate;
     int ilowFreq, ihighFreq;
     bool blofi;
+
+    StatKey m_processTimerKey;
 };
 
 #endif
@@ -39,6 +39,15 @@ void EngineFilterButterworth8::initBuffers() {
     }
 }
 
+void EngineFilterButterworth8::setCoefficients(const CSAMPLE* pCoef) {
+    memcpy(m_coef, pCoef, sizeof(m_coef));
+}
+
+void EngineFilterButterworth8::assignState(const EngineFilterButterworth8* pOther) {
+    memcpy(m_buf1, pOther->m_buf1, sizeof(m_buf1));
+    memcpy(m_buf2, pOther->m_buf2, sizeof(m_buf2));
+}
+
 inline CSAMPLE _processLowpass(CSAMPLE *coef, CSAMPLE *buf, register CSAMPLE val) {
    register CSAMPLE tmp, fir, iir;
    tmp= buf[0]; memmove(buf, buf+1, 7*sizeof(CSAMPLE));
@@ -148,13 +157,20 @@ EngineFilterButterworth8Low::EngineFilterButterworth8Low(int sampleRate,
 // if one or both corners are changed
 // https://bugs.launchpad.net/mixxx/+bug/1209294
 void EngineFilterButterworth8Low::setFrequencyCorners(double freqCorner1) {
+    designCoefficients(m_sampleRate, freqCorner1, m_coef);
+    initBuffers();
+}
+
+// static
+void EngineFilterButterworth8Low::designCoefficients(int sampleRate,
+                                                     double freqCorner1,
+                                                     CSAMPLE* pCoef) {
     double coef[MAX_COEFS];
-    coef[0] = fid_design_coef(coef + 1, 8, "LpBu8", m_sampleRate,
+    coef[0] = fid_design_coef(coef + 1, 8, "LpBu8", sampleRate,
                               freqCorner1, 0, 0);
     for (int i = 0; i < MAX_COEFS; ++i) {
-        m_coef[i] = coef[i];
+        pCoef[i] = coef[i];
     }
-    initBuffers();
 }
 
 void EngineFilterButterworth8Low::process(const CSAMPLE* pIn,
@@ -176,13 +192,21 @@ EngineFilterButterworth8Band::EngineFilterButterworth8Band(int sampleRate,
 
 void EngineFilterButterworth8Band::setFrequencyCorners(double freqCorner1,
         double freqCorner2) {
+    designCoefficients(m_sampleRate, freqCorner1, freqCorner2, m_coef);
+    initBuffers();
+}
+
+// static
+void EngineFilterButterworth8Band::designCoefficients(int sampleRate,
+                                                      double freqCorner1,
+                                                      double freqCorner2,
+                                                      CSAMPLE* pCoef) {
     double coef[MAX_COEFS];
-    coef[0] = fid_design_coef(coef + 1, 16, "BpBu8", m_sampleRate,
+    coef[0] = fid_design_coef(coef + 1, 16, "BpBu8", sampleRate,
                               freqCorner1, freqCorner2, 0);
     for (int i = 0; i < MAX_COEFS; ++i) {
-        m_coef[i] = coef[i];
+        pCoef[i] = coef[i];
     }
-    initBuffers();
 }
 
 void EngineFilterButterworth8Band::process(const CSAMPLE* pIn,
@@ -206,13 +230,20 @@ EngineFilterButterworth8High::EngineFilterButterworth8High(int sampleRate,
 }
 
 void EngineFilterButterworth8High::setFrequencyCorners(double freqCorner1) {
+    designCoefficients(m_sampleRate, freqCorner1, m_coef);
+    initBuffers();
+}
+
+// static
+void EngineFilterButterworth8High::designCoefficients(int sampleRate,
+                                                      double freqCorner1,
+                                                      CSAMPLE* pCoef) {
     double coef[MAX_COEFS];
-    coef[0] = fid_design_coef(coef + 1, 8, "HpBu8", m_sampleRate,
+    coef[0] = fid_design_coef(coef + 1, 8, "HpBu8", sampleRate,
                               freqCorner1, 0, 0);
     for (int i = 0; i < MAX_COEFS; ++i) {
-        m_coef[i] = coef[i];
+        pCoef[i] = coef[i];
     }
-    initBuffers();
 }
 
 void EngineFilterButterworth8High::process(const CSAMPLE* pIn,
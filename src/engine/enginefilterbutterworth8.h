@@ -1,3 +1,6 @@
+#ifndef ENGINEFILTERBUTTERWORTH8_H
+#define ENGINEFILTERBUTTERWORTH8_H
+
 #define MAX_COEFS 17
 #define MAX_INTERNAL_BUF 16
 
@@ -11,6 +14,11 @@ class EngineFilterButterworth8 : public EngineObject {
 
     // Update filter without recreating it
     void initBuffers();
+    // Replaces the coefficients but keeps the state, so that the filter
+    // continues without a click. Realtime-safe.
+    void setCoefficients(const CSAMPLE* pCoef);
+    // Copies the state of pOther, which must be of the same type.
+    void assignState(const EngineFilterButterworth8* pOther);
     virtual void process(const CSAMPLE* pIn, CSAMPLE* pOut,
                          const int iBufferSize) = 0;
 
@@ -32,6 +40,9 @@ class EngineFilterButterworth8Low : public EngineFilterButterworth8 {
   public:
     EngineFilterButterworth8Low(int sampleRate, double freqCorner1);
 
+    // Designs the MAX_COEFS coefficients into pCoef. Not realtime-safe.
+    static void designCoefficients(int sampleRate, double freqCorner1,
+                                   CSAMPLE* pCoef);
     void setFrequencyCorners(double freqCorner1);
     void process(const CSAMPLE* pIn, CSAMPLE* pOut, const int iBufferSize);
 };
@@ -42,6 +53,8 @@ class EngineFilterButterworth8Band : public EngineFilterButterworth8 {
     EngineFilterButterworth8Band(int sampleRate, double freqCorner1,
                                  double freqCorner2);
 
+    static void designCoefficients(int sampleRate, double freqCorner1,
+                                   double freqCorner2, CSAMPLE* pCoef);
     void setFrequencyCorners(double freqCorner1, double freqCorner2 = 0);
     void process(const CSAMPLE* pIn, CSAMPLE* pOut, const int iBufferSize);
 };
@@ -51,6 +64,10 @@ class EngineFilterButterworth8High : public EngineFilterButterworth8 {
   public:
     EngineFilterButterworth8High(int sampleRate, double freqCorner1);
 
+    static void designCoefficients(int sampleRate, double freqCorner1,
+                                   CSAMPLE* pCoef);
     void setFrequencyCorners(double freqCorner1);
     void process(const CSAMPLE* pIn, CSAMPLE* pOut, const int iBufferSize);
 };
+
+#endif // ENGINEFILTERBUTTERWORTH8_H
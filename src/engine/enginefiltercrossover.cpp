@@ -0,0 +1,157 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include <QtDebug>
+
+#include "engine/enginefiltercrossover.h"
+#include "../lib/fidlib-0.9.10/fidlib.h"
+#include "mathstuff.h"
+
+namespace {
+
+enum Band {
+    kLow = 0,
+    kMid = 1,
+    kHigh = 2,
+};
+
+// States below this are flushed to zero after each buffer so that silence
+// does not decay into denormals, which are very slow on x86.
+const float kDenormalLimit = 1e-30f;
+
+}  // namespace
+
+EngineFilterCrossover::EngineFilterCrossover(int sampleRate,
+                                             double lowMidCorner,
+                                             double midHighCorner)
+        : m_sampleRate(sampleRate),
+          m_lowMidCorner(lowMidCorner),
+          m_midHighCorner(midHighCorner) {
+    // fidlib refuses corners above the Nyquist frequency, and the band pass
+    // needs some room above its upper corner.
+    m_midHighCorner = math_min(m_midHighCorner, 0.45 * m_sampleRate);
+    m_lowMidCorner = math_min(m_lowMidCorner, 0.5 * m_midHighCorner);
+
+    for (int band = kLow; band <= kHigh; ++band) {
+        for (int stage = 0; stage < kStages; ++stage) {
+            setStage(band, stage, 1.0, 0.0, 0.0, 0.0, 0.0);
+        }
+    }
+    designBand(kLow, "LpBe4", m_lowMidCorner, 0);
+    designBand(kMid, "BpBe4", m_lowMidCorner, m_midHighCorner);
+    designBand(kHigh, "HpBe4", m_midHighCorner, 0);
+    reset();
+}
+
+EngineFilterCrossover::~EngineFilterCrossover() {
+}
+
+void EngineFilterCrossover::reset() {
+    for (int stage = 0; stage < kStages; ++stage) {
+        for (int lane = 0; lane < kLanes; ++lane) {
+            m_z1[stage][lane] = 0;
+            m_z2[stage][lane] = 0;
+        }
+    }
+}
+
+void EngineFilterCrossover::setStage(int band, int stage, double b0,
+                                     double b1, double b2, double a1,
+                                     double a2) {
+    for (int lane = band * 2; lane < band * 2 + 2; ++lane) {
+        m_b0[stage][lane] = b0;
+        m_b1[stage][lane] = b1;
+        m_b2[stage][lane] = b2;
+        m_a1[stage][lane] = a1;
+        m_a2[stage][lane] = a2;
+    }
+}
+
+void EngineFilterCrossover::designBand(int band, const char* spec,
+                                       double freq0, double freq1) {
+    FidFilter* pFilter = fid_design(spec, m_sampleRate, freq0, freq1, 0, NULL);
+
+    // The design is a list of IIR/FIR pairs of up to 3 coefficients each,
+    // most recent sample first, plus constant gain factors.
+    double gain = 1.0;
+    int stage = 0;
+    FidFilter* ff = pFilter;
+    while (ff->typ) {
+        if (ff->typ == 'F' && ff->len == 1) {
+            gain *= ff->val[0];
+            ff = FFNEXT(ff);
+            continue;
+        }
+        double a[3] = { 1.0, 0.0, 0.0 };
+        double b[3] = { 1.0, 0.0, 0.0 };
+        bool fits = true;
+        if (ff->typ == 'I') {
+            fits = fits && ff->len <= 3;
+            for (int i = 0; i < ff->len && i < 3; ++i) {
+                a[i] = ff->val[i];
+            }
+            ff = FFNEXT(ff);
+        }
+        if (ff->typ == 'F') {
+            fits = fits && ff->len <= 3;
+            for (int i = 0; i < ff->len && i < 3; ++i) {
+                b[i] = ff->val[i];
+            }
+            ff = FFNEXT(ff);
+        }
+        if (!fits || stage >= kStages) {
+            qWarning() << "EngineFilterCrossover: design of" << spec
+                       << "does not fit into" << kStages << "biquads";
+            break;
+        }
+        setStage(band, stage, b[0] / a[0], b[1] / a[0], b[2] / a[0],
+                 a[1] / a[0], a[2] / a[0]);
+        ++stage;
+    }
+    free(pFilter);
+
+    // Apply the gain in the first stage.
+    for (int lane = band * 2; lane < band * 2 + 2; ++lane) {
+        m_b0[0][lane] *= gain;
+        m_b1[0][lane] *= gain;
+        m_b2[0][lane] *= gain;
+    }
+}
+
+void EngineFilterCrossover::process(const CSAMPLE* pIn, CSAMPLE* pLow,
+                                    CSAMPLE* pMid, CSAMPLE* pHigh,
+                                    const int iBufferSize) {
+    float x[kLanes];
+    for (int i = 0; i < iBufferSize; i += 2) {
+        x[0] = x[2] = x[4] = pIn[i];
+        x[1] = x[3] = x[5] = pIn[i + 1];
+        for (int stage = 0; stage < kStages; ++stage) {
+            for (int lane = 0; lane < kLanes; ++lane) {
+                const float y = m_b0[stage][lane] * x[lane] +
+                        m_z1[stage][lane];
+                m_z1[stage][lane] = m_b1[stage][lane] * x[lane] -
+                        m_a1[stage][lane] * y + m_z2[stage][lane];
+                m_z2[stage][lane] = m_b2[stage][lane] * x[lane] -
+                        m_a2[stage][lane] * y;
+                x[lane] = y;
+            }
+        }
+        pLow[i] = x[0];
+        pLow[i + 1] = x[1];
+        pMid[i] = x[2];
+        pMid[i + 1] = x[3];
+        pHigh[i] = x[4];
+        pHigh[i + 1] = x[5];
+    }
+
+    for (int stage = 0; stage < kStages; ++stage) {
+        for (int lane = 0; lane < kLanes; ++lane) {
+            if (fabs(m_z1[stage][lane]) < kDenormalLimit) {
+                m_z1[stage][lane] = 0;
+            }
+            if (fabs(m_z2[stage][lane]) < kDenormalLimit) {
+                m_z2[stage][lane] = 0;
+            }
+        }
+    }
+}
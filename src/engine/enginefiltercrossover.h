@@ -0,0 +1,73 @@
+// enginefiltercrossover.h
+// A three band crossover for analysing stereo audio.
+
+#ifndef ENGINEFILTERCROSSOVER_H
+#define ENGINEFILTERCROSSOVER_H
+
+#include "defs.h"
+
+// EngineFilterCrossover splits interleaved stereo samples into a low, mid and
+// high band with 4th order Bessel low and high pass filters and an 8th order
+// Bessel band pass filter. The coefficients are designed with fidlib for the
+// sample rate of the track, so the bands are split at the same frequencies for
+// all sample rates.
+//
+// All bands and both channels are processed in a single pass. Each filter is
+// a cascade of biquads in transposed direct form II, and the biquads of one
+// stage of all bands and channels are stored next to each other so that the
+// compiler can vectorize over them.
+class EngineFilterCrossover {
+  public:
+    EngineFilterCrossover(int sampleRate, double lowMidCorner,
+                          double midHighCorner);
+    virtual ~EngineFilterCrossover();
+
+    // Clears the filter state, e.g. before processing another track.
+    void reset();
+
+    int sampleRate() const {
+        return m_sampleRate;
+    }
+    // The corner frequencies in Hz. They are lowered from the requested ones
+    // if they don't fit below the Nyquist frequency.
+    double lowMidCorner() const {
+        return m_lowMidCorner;
+    }
+    double midHighCorner() const {
+        return m_midHighCorner;
+    }
+
+    // Splits iBufferSize interleaved stereo samples of pIn into the three
+    // bands. The output buffers must hold iBufferSize samples each.
+    void process(const CSAMPLE* pIn, CSAMPLE* pLow, CSAMPLE* pMid,
+                 CSAMPLE* pHigh, const int iBufferSize);
+
+  private:
+    enum {
+        // The band pass filter has the most biquads. The other filters are
+        // padded with pass-through biquads.
+        kStages = 4,
+        // One lane per band and channel: low L/R, mid L/R, high L/R.
+        kLanes = 6,
+    };
+
+    // Designs the filter spec with fidlib and stores its biquads into the
+    // lanes of both channels of band.
+    void designBand(int band, const char* spec, double freq0, double freq1);
+    void setStage(int band, int stage, double b0, double b1, double b2,
+                  double a1, double a2);
+
+    const int m_sampleRate;
+    double m_lowMidCorner;
+    double m_midHighCorner;
+
+    float m_b0[kStages][kLanes];
+    float m_b1[kStages][kLanes];
+    float m_b2[kStages][kLanes];
+    float m_a1[kStages][kLanes];
+    float m_a2[kStages][kLanes];
+    float m_z1[kStages][kLanes];
+    float m_z2[kStages][kLanes];
+};
+
+#endif /* ENGINEFILTERCROSSOVER_H */
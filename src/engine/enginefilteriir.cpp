@@ -22,8 +22,17 @@ EngineFilterIIR::EngineFilterIIR(const double * pCoefs, int iOrder)
 {
     order = iOrder;
     coefs = pCoefs;
+    m_nanCounterKey1 = Stat::registerKey("EngineFilterIIR::process yv1[8] isnan");
+    m_nanCounterKey2 = Stat::registerKey("EngineFilterIIR::process yv2[8] isnan");
 
+    initBuffers();
+}
+
+EngineFilterIIR::~EngineFilterIIR()
+{
+}
 
+void EngineFilterIIR::initBuffers() {
     // Reset the yv's:
     memset(yv1, 0, sizeof(yv1));
     memset(yv2, 0, sizeof(yv2));
@@ -31,10 +40,6 @@ EngineFilterIIR::EngineFilterIIR(const double * pCoefs, int iOrder)
     memset(xv2, 0, sizeof(xv2));
 }
 
-EngineFilterIIR::~EngineFilterIIR()
-{
-}
-
 void EngineFilterIIR::process(const CSAMPLE* pIn, CSAMPLE* pOutput, const int iBufferSize)
 {
     double GAIN =  coefs[0];
@@ -59,7 +64,7 @@ void EngineFilterIIR::process(const CSAMPLE* pIn, CSAMPLE* pOutput, const int iB
                      (coefs[11] * yv1[6]) + ( coefs[12] * yv1[7]);
             // Guard against nan.
             if (isnan(yv1[8])) {
-                Counter count("EngineFilterIIR::process yv1[8] isnan");
+                Counter count(m_nanCounterKey1);
                 count.increment();
                 yv1[8] = 0;
             }
@@ -80,7 +85,7 @@ void EngineFilterIIR::process(const CSAMPLE* pIn, CSAMPLE* pOutput, const int iB
                      (coefs[11] * yv2[6]) + ( coefs[12] * yv2[7]);
             // Guard against nan.
             if (isnan(yv2[8])) {
-                Counter count("EngineFilterIIR::process yv2[8] isnan");
+                Counter count(m_nanCounterKey2);
                 count.increment();
                 yv2[8] = 0;
             }
@@ -19,12 +19,15 @@
 
 #include "engine/engineobject.h"
 #include "defs.h"
+#include "util/stat.h"
 
 class EngineFilterIIR : public EngineObject {
     Q_OBJECT
   public:
     EngineFilterIIR(const double* pCoefs, int iOrder);
     virtual ~EngineFilterIIR();
+    // Clears the state of the filter.
+    void initBuffers();
     void process(const CSAMPLE* pIn, CSAMPLE* pOut, const int iBufferSize);
 
   protected:
@@ -34,6 +37,10 @@ class EngineFilterIIR : public EngineObject {
     #define MAXNPOLES 8
     double xv1[MAXNZEROS+1], yv1[MAXNPOLES+1];
     double xv2[MAXNZEROS+1], yv2[MAXNPOLES+1];
+
+  private:
+    StatKey m_nanCounterKey1;
+    StatKey m_nanCounterKey2;
 };
 
 //
@@ -26,6 +26,7 @@
 #include "engine/enginebuffer.h"
 #include "engine/enginemaster.h"
 #include "engine/engineworkerscheduler.h"
+#include "engine/channelprocessingpool.h"
 #include "engine/enginebuffer.h"
 #include "engine/enginechannel.h"
 #include "engine/engineclipping.h"
@@ -35,6 +36,8 @@
 #include "engine/sidechain/enginesidechain.h"
 #include "engine/sync/enginesync.h"
 #include "sampleutil.h"
+#include "util/compatibility.h"
+#include "util/time.h"
 #include "util/timer.h"
 #include "util/trace.h"
 #include "playermanager.h"
@@ -44,7 +47,12 @@ EngineMaster::EngineMaster(ConfigObject<ConfigValue>* _config,
                            const char* group,
                            bool bEnableSidechain,
                            bool bRampingGain)
-        : m_bRampingGain(bRampingGain),
+        : m_processTraceKey("EngineMaster::process"),
+          m_processChannelsTimerKey(
+                  Stat::registerKey("EngineMaster::processChannels")),
+          m_bRampingGain(bRampingGain),
+          m_callbackStartTime(0),
+          m_previousCallbackStartTime(0),
           m_headphoneMasterGainOld(0.0),
           m_headphoneVolumeOld(1.0),
           m_bMasterOutputConnected(false),
@@ -55,6 +63,11 @@ EngineMaster::EngineMaster(ConfigObject<ConfigValue>* _config,
     m_pWorkerScheduler = new EngineWorkerScheduler(this);
     m_pWorkerScheduler->start();
 
+    // Worker threads for processing channels in parallel. They only run while
+    // parallel processing is enabled and are started and stopped outside of
+    // the callback.
+    m_pProcessingPool = new ChannelProcessingPool(-1, kMaxChannels);
+
     // Master sample rate
     m_pMasterSampleRate = new ControlObject(ConfigKey(group, "samplerate"), true, true);
     m_pMasterSampleRate->set(44100.);
@@ -103,6 +116,16 @@ EngineMaster::EngineMaster(ConfigObject<ConfigValue>* _config,
     m_pHeadSplitEnabled->setButtonMode(ControlPushButton::TOGGLE);
     m_pHeadSplitEnabled->set(0.0);
 
+    // Process the channels other than the sync master concurrently.
+    m_pParallelProcessing = new ControlPushButton(
+        ConfigKey(group, "parallel_processing"));
+    m_pParallelProcessing->setButtonMode(ControlPushButton::TOGGLE);
+    m_pParallelProcessing->set(_config->getValueString(
+        ConfigKey("[Soundcard]", "ParallelChannelProcessing"), "0").toInt() > 0);
+    connect(m_pParallelProcessing, SIGNAL(valueChanged(double)),
+            this, SLOT(slotParallelProcessing(double)));
+    slotParallelProcessing(m_pParallelProcessing->get());
+
     // Headphone Clipping
     m_pHeadClipping = new EngineClipping("");
 
@@ -140,6 +163,7 @@ EngineMaster::~EngineMaster() {
     delete m_pBalance;
     delete m_pHeadMix;
     delete m_pHeadSplitEnabled;
+    delete m_pParallelProcessing;
     delete m_pMasterVolume;
     delete m_pHeadVolume;
     delete m_pTalkoverDucking;
@@ -167,6 +191,7 @@ EngineMaster::~EngineMaster() {
     }
 
     delete m_pWorkerScheduler;
+    delete m_pProcessingPool;
 
     QMutableListIterator<ChannelInfo*> channel_it(m_channels);
     while (channel_it.hasNext()) {
@@ -187,87 +212,70 @@ const CSAMPLE* EngineMaster::getHeadphoneBuffer() const {
     return m_pHead;
 }
 
-void EngineMaster::processChannels(unsigned int* busChannelConnectionFlags,
-                                   unsigned int* headphoneOutput,
-                                   int iBufferSize) {
-    ScopedTimer timer("EngineMaster::processChannels");
-
-    QList<ChannelInfo*>::iterator it = m_channels.begin();
-    QList<ChannelInfo*>::iterator master_it = NULL;
-
-    // Clear talkover compressor for the next round of gain calculation.
-    m_pTalkoverDucking->clearKeys();
-
-    // Find the Sync Master and process it first then process all the slaves
-    // (and skip the master).
-
-    EngineChannel* pMasterChannel = m_pMasterSync->getMaster();
-    if (pMasterChannel != NULL) {
-        for (unsigned int channel_number = 0;
-             it != m_channels.end(); ++it, ++channel_number) {
-            ChannelInfo* pChannelInfo = *it;
-            EngineChannel* pChannel = pChannelInfo->m_pChannel;
-            if (!pChannel || !pChannel->isActive()) {
-               continue;
-            }
+void EngineMaster::wakeUpChannel(int index) {
+    if (index < 0 || index >= static_cast<int>(kMaxChannels)) {
+        return;
+    }
+    QAtomicInt& wakeUps = m_channelWakeUps[index / 32];
+    const int bit = static_cast<int>(1u << (index % 32));
+    int oldWakeUps = deref(wakeUps);
+    while ((oldWakeUps & bit) == 0 &&
+           !wakeUps.testAndSetOrdered(oldWakeUps, oldWakeUps | bit)) {
+        oldWakeUps = deref(wakeUps);
+    }
+}
 
-            if (pMasterChannel == pChannel) {
-                master_it = it;
-
-                // Proceed with the processing as below.
-                bool needsProcessing = false;
-                if (pChannel->isMaster()) {
-                    busChannelConnectionFlags[pChannel->getOrientation()] |= (1 << channel_number);
-                    needsProcessing = true;
-                }
-
-                // If the channel is enabled for previewing in headphones, copy it
-                // over to the headphone buffer
-                if (pChannel->isPFL()) {
-                    *headphoneOutput |= (1 << channel_number);
-                    needsProcessing = true;
-                }
-
-                if (m_pTalkoverDucking->getMode() != EngineTalkoverDucking::OFF &&
-                        pChannel->isTalkover()) {
-                    m_pTalkoverDucking->processKey(pChannelInfo->m_pBuffer, iBufferSize);
-                }
-
-                // Process the buffer if necessary, which it damn well better be
-                if (needsProcessing) {
-                    pChannel->process(NULL, pChannelInfo->m_pBuffer, iBufferSize);
-                }
-                break;
+void EngineMaster::wakeUpChannels() {
+    const int channelCount = math_min(m_channels.size(),
+                                      static_cast<int>(kMaxChannels));
+    for (int word = 0; word * 32 < channelCount; ++word) {
+        unsigned int wakeUps = static_cast<unsigned int>(
+            m_channelWakeUps[word].fetchAndStoreOrdered(0));
+        for (int index = word * 32; wakeUps != 0; ++index, wakeUps >>= 1) {
+            if ((wakeUps & 1) && !m_channelAwake[index]) {
+                m_channelAwake[index] = true;
+                m_awakeChannels.append(m_channels[index]);
             }
         }
     }
+}
 
-    it = m_channels.begin();
-    for (unsigned int channel_number = 0;
-         it != m_channels.end(); ++it, ++channel_number) {
-        ChannelInfo* pChannelInfo = *it;
-        EngineChannel* pChannel = pChannelInfo->m_pChannel;
+void EngineMaster::processChannels(int iBufferSize) {
+    ScopedTimer timer(m_processChannelsTimerKey);
 
-        // Skip the master since we already processed it.
-        if (it == master_it) {
-            continue;
-        }
+    m_activeChannels.clear();
+    wakeUpChannels();
 
-        // Skip inactive channels.
+    // Clear talkover compressor for the next round of gain calculation.
+    m_pTalkoverDucking->clearKeys();
+
+    // Collect the channels to mix. Channels that are not active fall asleep
+    // and are not checked again until they are woken up.
+    EngineChannel* pMasterChannel = m_pMasterSync->getMaster();
+    ChannelInfo* pMasterChannelInfo = NULL;
+    int awake = 0;
+    for (int i = 0; i < m_awakeChannels.size(); ++i) {
+        ChannelInfo* pChannelInfo = m_awakeChannels[i];
+        EngineChannel* pChannel = pChannelInfo->m_pChannel;
         if (!pChannel || !pChannel->isActive()) {
+            m_channelAwake[pChannelInfo->m_index] = false;
+            if (pChannel) {
+                pChannel->skipProcess();
+            }
             continue;
         }
+        m_awakeChannels[awake++] = pChannelInfo;
 
         bool needsProcessing = false;
         if (pChannel->isMaster()) {
-            busChannelConnectionFlags[pChannel->getOrientation()] |= (1 << channel_number);
+            m_activeChannels.bus[pChannel->getOrientation()].append(pChannelInfo);
             needsProcessing = true;
         }
 
         // If the channel is enabled for previewing in headphones, copy it
         // over to the headphone buffer
         if (pChannel->isPFL()) {
-            *headphoneOutput |= (1 << channel_number);
+            m_activeChannels.headphone.append(pChannelInfo);
             needsProcessing = true;
         }
 
@@ -276,11 +284,51 @@ void EngineMaster::processChannels(unsigned int* busChannelConnectionFlags,
             m_pTalkoverDucking->processKey(pChannelInfo->m_pBuffer, iBufferSize);
         }
 
-        // Process the buffer if necessary
         if (needsProcessing) {
+            m_activeChannels.mixed.append(pChannelInfo);
+            if (pChannel == pMasterChannel) {
+                pMasterChannelInfo = pChannelInfo;
+            }
+        } else {
+            pChannel->skipProcess();
+        }
+    }
+    m_awakeChannels.resize(awake);
+
+    // Process the Sync Master first since the others follow it.
+    if (pMasterChannelInfo != NULL) {
+        pMasterChannelInfo->m_pChannel->process(
+            NULL, pMasterChannelInfo->m_pBuffer, iBufferSize);
+    }
+
+    // Once the master has been processed the remaining channels are
+    // independent of each other and can be processed concurrently.
+    const bool bParallel = m_pProcessingPool->isRunning();
+
+    for (int i = 0; i < m_activeChannels.mixed.size(); ++i) {
+        ChannelInfo* pChannelInfo = m_activeChannels.mixed[i];
+        // Skip the master since we already processed it.
+        if (pChannelInfo == pMasterChannelInfo) {
+            continue;
+        }
+        EngineChannel* pChannel = pChannelInfo->m_pChannel;
+        if (!bParallel ||
+                !m_pProcessingPool->addChannel(pChannel, pChannelInfo->m_pBuffer)) {
             pChannel->process(NULL, pChannelInfo->m_pBuffer, iBufferSize);
         }
     }
+
+    if (bParallel) {
+        m_pProcessingPool->processBatch(iBufferSize);
+    }
+}
+
+void EngineMaster::slotParallelProcessing(double v) {
+    if (v > 0.0) {
+        m_pProcessingPool->start();
+    } else {
+        m_pProcessingPool->stop();
+    }
 }
 
 void EngineMaster::process(const int iBufferSize) {
@@ -289,19 +337,19 @@ void EngineMaster::process(const int iBufferSize) {
         QThread::currentThread()->setObjectName("Engine");
         haveSetName = true;
     }
-    Trace t("EngineMaster::process");
+    Trace t(m_processTraceKey);
+
+    const qint64 callbackStartTime = Time::elapsed();
+    m_previousCallbackStartTime = m_callbackStartTime > 0 ?
+            m_callbackStartTime : callbackStartTime;
+    m_callbackStartTime = callbackStartTime;
 
     int iSampleRate = static_cast<int>(m_pMasterSampleRate->get());
     // Update internal master sync.
     m_pMasterSync->onCallbackStart(iSampleRate, iBufferSize);
 
-    // Bitvector of enabled channels
-    const unsigned int maxChannels = 32;
-    unsigned int busChannelConnectionFlags[3] = { 0, 0, 0 };
-    unsigned int headphoneOutput = 0;
-
     // Prepare each channel for output
-    processChannels(busChannelConnectionFlags, &headphoneOutput, iBufferSize);
+    processChannels(iBufferSize);
 
     // Compute headphone mix
     // Head phone left/right mix
@@ -311,21 +359,8 @@ void EngineMaster::process(const int iBufferSize) {
     // qDebug() << "head val " << cf_val << ", head " << chead_gain
     //          << ", master " << cmaster_gain;
 
-    // Mix all the enabled headphone channels together.
     m_headphoneGain.setGain(chead_gain);
 
-    if (m_bRampingGain) {
-        ChannelMixer::mixChannelsRamping(
-            m_channels, m_headphoneGain, headphoneOutput,
-            maxChannels, &m_channelHeadphoneGainCache,
-            m_pHead, iBufferSize);
-    } else {
-        ChannelMixer::mixChannels(
-            m_channels, m_headphoneGain, headphoneOutput,
-            maxChannels, &m_channelHeadphoneGainCache,
-            m_pHead, iBufferSize);
-    }
-
     // Calculate the crossfader gains for left and right side of the crossfader
     double c1_gain, c2_gain;
     EngineXfader::getXfadeGains(m_pCrossfader->get(), m_pXFaderCurve->get(),
@@ -334,7 +369,6 @@ void EngineMaster::process(const int iBufferSize) {
                                 m_pXFaderReverse->get() == 1.0,
                                 &c1_gain, &c2_gain);
 
-    // And mix the 3 buses into the master.
     CSAMPLE master_gain = m_pMasterVolume->get();
 
     // Channels with the talkover flag should be mixed with the master signal at
@@ -342,32 +376,22 @@ void EngineMaster::process(const int iBufferSize) {
     m_masterGain.setGains(master_gain * m_pTalkoverDucking->getGain(iBufferSize / 2),
                           c1_gain, 1.0, c2_gain, master_gain);
 
-    // Make the mix for each output bus. m_masterGain takes care of applying the
-    // master volume, the channel volume, and the orientation gain.
-    for (int o = EngineChannel::LEFT; o <= EngineChannel::RIGHT; o++) {
-        if (m_bRampingGain) {
-            ChannelMixer::mixChannelsRamping(
-                m_channels, m_masterGain,
-                busChannelConnectionFlags[o], maxChannels,
-                &m_channelMasterGainCache,
-                m_pOutputBusBuffers[o], iBufferSize);
-        } else {
-            ChannelMixer::mixChannels(
-                m_channels, m_masterGain,
-                busChannelConnectionFlags[o], maxChannels,
-                &m_channelMasterGainCache,
-                m_pOutputBusBuffers[o], iBufferSize);
-        }
+    // Mix all the enabled headphone channels together, make the mix for each
+    // output bus and mix the 3 buses into the master, reading every channel
+    // buffer only once. m_masterGain takes care of applying the master volume,
+    // the channel volume, and the orientation gain.
+    if (m_bRampingGain) {
+        ChannelMixer::mixBusesRamping(
+            m_activeChannels, m_headphoneGain, m_masterGain,
+            &m_channelHeadphoneGainCache, &m_channelMasterGainCache,
+            m_pHead, m_pOutputBusBuffers, m_pMaster, iBufferSize);
+    } else {
+        ChannelMixer::mixBuses(
+            m_activeChannels, m_headphoneGain, m_masterGain,
+            &m_channelHeadphoneGainCache, &m_channelMasterGainCache,
+            m_pHead, m_pOutputBusBuffers, m_pMaster, iBufferSize);
     }
 
-    // Mix the three channels together. We already mixed the busses together
-    // with the channel gains and overall master gain.
-    SampleUtil::copy3WithGain(m_pMaster,
-                              m_pOutputBusBuffers[EngineChannel::LEFT], 1.0,
-                              m_pOutputBusBuffers[EngineChannel::CENTER], 1.0,
-                              m_pOutputBusBuffers[EngineChannel::RIGHT], 1.0,
-                              iBufferSize);
-
     // Clipping
     m_pClipping->process(m_pMaster, m_pMaster, iBufferSize);
 
@@ -443,10 +467,19 @@ void EngineMaster::addChannel(EngineChannel* pChannel) {
     pChannelInfo->m_pVolumeControl->set(1.0);
     pChannelInfo->m_pBuffer = SampleUtil::alloc(MAX_BUFFER_LEN);
     SampleUtil::applyGain(pChannelInfo->m_pBuffer, 0, MAX_BUFFER_LEN);
+    pChannelInfo->m_index = m_channels.size();
     m_channels.push_back(pChannelInfo);
     m_channelHeadphoneGainCache.push_back(0);
-    for (int o = EngineChannel::LEFT; o <= EngineChannel::RIGHT; o++) {
-        m_channelMasterGainCache.push_back(0);
+    m_channelMasterGainCache.push_back(0);
+
+    // Channels beyond kMaxChannels are never woken up, so they are not mixed.
+    if (pChannelInfo->m_index < static_cast<int>(kMaxChannels)) {
+        m_channelAwake.append(false);
+        pChannel->setEngineMaster(this, pChannelInfo->m_index);
+        wakeUpChannel(pChannelInfo->m_index);
+    } else {
+        qWarning() << "EngineMaster: not mixing" << pChannel->getGroup()
+                   << "since there are more than" << kMaxChannels << "channels";
     }
 
     EngineBuffer* pBuffer = pChannelInfo->m_pChannel->getEngineBuffer();
@@ -18,15 +18,19 @@
 #ifndef ENGINEMASTER_H
 #define ENGINEMASTER_H
 
+#include <QAtomicInt>
 #include <QObject>
+#include <QVarLengthArray>
 
 #include "controlobject.h"
 #include "engine/engineobject.h"
 #include "engine/enginechannel.h"
 #include "soundmanagerutil.h"
 #include "recording/recordingmanager.h"
+#include "util/trace.h"
 
 class EngineWorkerScheduler;
+class ChannelProcessingPool;
 class EngineBuffer;
 class EngineChannel;
 class EngineClipping;
@@ -44,6 +48,11 @@ class EngineTalkoverDucking;
 class EngineMaster : public QObject, public AudioSource {
     Q_OBJECT
   public:
+    // The maximum number of channels that can be mixed. The lists of active
+    // channels are preallocated for this many channels so that building them
+    // in process() never allocates.
+    static const unsigned int kMaxChannels = 256;
+
     EngineMaster(ConfigObject<ConfigValue>* pConfig,
                  const char* pGroup,
                  bool bEnableSidechain,
@@ -67,6 +76,10 @@ class EngineMaster : public QObject, public AudioSource {
     // Add an EngineChannel to the mixing engine. This is not thread safe --
     // only call it before the engine has started mixing.
     void addChannel(EngineChannel* pChannel);
+    // Makes process() check whether the channel with the given index is
+    // active again. Channels that were not active are skipped until they are
+    // woken up. Safe to call from any thread.
+    void wakeUpChannel(int index);
     EngineChannel* getChannel(QString group);
     static inline double gainForOrientation(EngineChannel::ChannelOrientation orientation,
                                             double leftGain,
@@ -99,10 +112,46 @@ class EngineMaster : public QObject, public AudioSource {
         return m_pSideChain;
     }
 
+    // The Time::elapsed() times at which the current and the previous callback
+    // started. Controls that are scheduled on a ControlEventQueue and were
+    // changed between the two are applied in the current callback.
+    qint64 getCallbackStartTime() const {
+        return m_callbackStartTime;
+    }
+    qint64 getPreviousCallbackStartTime() const {
+        return m_previousCallbackStartTime;
+    }
+    // For tests that process channels directly.
+    void setCallbackStartTimesForTest(qint64 previous, qint64 current) {
+        m_previousCallbackStartTime = previous;
+        m_callbackStartTime = current;
+    }
+
     struct ChannelInfo {
         EngineChannel* m_pChannel;
         CSAMPLE* m_pBuffer;
         ControlObject* m_pVolumeControl;
+        // The position of the channel in the engine and its gain caches.
+        int m_index;
+    };
+
+    typedef QVarLengthArray<ChannelInfo*, kMaxChannels> ChannelList;
+
+    // The channels that are mixed into each output in a callback. mixed holds
+    // every channel that is in any of the other lists, which are ordered like
+    // it.
+    struct ActiveChannels {
+        void clear() {
+            mixed.clear();
+            headphone.clear();
+            for (int o = EngineChannel::LEFT; o <= EngineChannel::RIGHT; ++o) {
+                bus[o].clear();
+            }
+        }
+
+        ChannelList mixed;
+        ChannelList headphone;
+        ChannelList bus[3];
     };
 
     class GainCalculator {
@@ -154,20 +203,35 @@ class EngineMaster : public QObject, public AudioSource {
         double m_dVolume, m_dLeftGain, m_dCenterGain, m_dRightGain, m_dTalkoverGain;
     };
 
+  private slots:
+    // Starts or stops the worker threads of the channel processing pool.
+    void slotParallelProcessing(double v);
+
   private:
-    void mixChannels(unsigned int channelBitvector, unsigned int maxChannels,
-                     CSAMPLE* pOutput, unsigned int iBufferSize, GainCalculator* pGainCalculator);
+    // Adds the channels that were woken up since the last callback to
+    // m_awakeChannels.
+    void wakeUpChannels();
 
     // Processes active channels. The master sync channel (if any) is processed
-    // first and all others are processed after. Sets the i'th bit of
-    // masterOutput and headphoneOutput if the i'th channel is enabled for the
-    // master output or headphone output, respectively.
-    void processChannels(unsigned int* busChannelConnectionFlags,
-                         unsigned int* headphoneOutput,
-                         int iBufferSize);
+    // first and all others are processed after, concurrently if parallel
+    // processing is enabled. Collects the channels that are enabled for the
+    // master output or the headphone output in m_activeChannels. Only the
+    // awake channels are checked, and the ones that are not active fall
+    // asleep.
+    void processChannels(int iBufferSize);
 
+    const TraceKey m_processTraceKey;
+    const StatKey m_processChannelsTimerKey;
     bool m_bRampingGain;
+    qint64 m_callbackStartTime;
+    qint64 m_previousCallbackStartTime;
     QList<ChannelInfo*> m_channels;
+    // The channels whose isActive() is checked in every callback.
+    ChannelList m_awakeChannels;
+    QVarLengthArray<bool, kMaxChannels> m_channelAwake;
+    // One bit per channel that was woken up since the last callback.
+    QAtomicInt m_channelWakeUps[kMaxChannels / 32];
+    ActiveChannels m_activeChannels;
     QList<CSAMPLE> m_channelMasterGainCache;
     QList<CSAMPLE> m_channelHeadphoneGainCache;
 
@@ -176,6 +240,7 @@ class EngineMaster : public QObject, public AudioSource {
     CSAMPLE* m_pHead;
 
     EngineWorkerScheduler* m_pWorkerScheduler;
+    ChannelProcessingPool* m_pProcessingPool;
     EngineSync* m_pMasterSync;
 
     ControlObject* m_pMasterVolume;
@@ -200,6 +265,7 @@ class EngineMaster : public QObject, public AudioSource {
     ControlPotmeter* m_pXFaderCalibration;
     ControlPotmeter* m_pXFaderReverse;
     ControlPushButton* m_pHeadSplitEnabled;
+    ControlPushButton* m_pParallelProcessing;
 
     ConstantGainCalculator m_headphoneGain;
     OrientationVolumeGainCalculator m_masterGain;
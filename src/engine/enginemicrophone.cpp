@@ -114,6 +114,7 @@ void EngineMicrophone::receiveBuffer(AudioInput input, const CSAMPLE* pBuffer,
             // come in, right?
             qWarning() << "ERROR: Buffer overflow in EngineMicrophone. Dropping samples on the floor.";
         }
+        wakeUp();
     }
 }
 
@@ -40,7 +40,9 @@ RateControl::RateControl(const char* _group,
       m_dTempRateChange(0.0),
       m_dRateTemp(0.0),
       m_eRampBackMode(RATERAMP_RAMPBACK_NONE),
-      m_dRateTempRampbackChange(0.0) {
+      m_dRateTempRampbackChange(0.0),
+      m_dJogFactor(0.0),
+      m_dSyncAdjustment(1.0) {
     m_pScratchController = new PositionScratchController(_group);
 
     m_pRateDir = new ControlObject(ConfigKey(_group, "rate_dir"));
@@ -404,6 +406,18 @@ SyncMode RateControl::getSyncMode() const {
 
 double RateControl::calculateRate(double baserate, bool paused,
                                   int iSamplesPerBuffer, bool* isScratching) {
+    return calculateRate(baserate, paused, iSamplesPerBuffer, true,
+                         isScratching);
+}
+
+double RateControl::recalculateRate(double baserate, bool paused,
+                                    bool* isScratching) {
+    return calculateRate(baserate, paused, 0, false, isScratching);
+}
+
+double RateControl::calculateRate(double baserate, bool paused,
+                                  int iSamplesPerBuffer, bool bAdvance,
+                                  bool* isScratching) {
     double rate = (paused ? 0 : 1.0);
 
     double searching = m_pRateSearch->get();
@@ -412,7 +426,11 @@ double RateControl::calculateRate(double baserate, bool paused,
         rate = searching;
     } else {
         double wheelFactor = getWheelFactor();
-        double jogFactor = getJogFactor();
+        // The jog filter is advanced once per callback.
+        if (bAdvance) {
+            m_dJogFactor = getJogFactor();
+        }
+        double jogFactor = m_dJogFactor;
         bool bVinylControlEnabled = m_pVCEnabled && m_pVCEnabled->get() > 0.0;
         bool scratchEnable = m_pScratchToggle->get() != 0 || bVinylControlEnabled;
 
@@ -473,8 +491,10 @@ double RateControl::calculateRate(double baserate, bool paused,
 
         }
 
-        double currentSample = getCurrentSample();
-        m_pScratchController->process(currentSample, rate, iSamplesPerBuffer, baserate);
+        if (bAdvance) {
+            double currentSample = getCurrentSample();
+            m_pScratchController->process(currentSample, rate, iSamplesPerBuffer, baserate);
+        }
 
         // If waveform scratch is enabled, override all other controls
         if (m_pScratchController->isEnabled()) {
@@ -495,7 +515,11 @@ double RateControl::calculateRate(double baserate, bool paused,
             bool userTweakingSync = userTweak != 0.0;
             rate += userTweak;
 
-            rate *= m_pBpmControl->getSyncAdjustment(userTweakingSync);
+            if (bAdvance) {
+                m_dSyncAdjustment =
+                        m_pBpmControl->getSyncAdjustment(userTweakingSync);
+            }
+            rate *= m_dSyncAdjustment;
         }
         // If we are reversing (and not scratching,) flip the rate.  This is ok even when syncing.
         // Reverse with vinyl is only ok if absolute mode isn't on.
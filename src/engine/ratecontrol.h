@@ -46,6 +46,10 @@ public:
                    const int bufferSamples);
     // Returns the current engine rate.
     double calculateRate(double baserate, bool paused, int iSamplesPerBuffer, bool* isScratching);
+    // Returns the engine rate after a control changed within the callback.
+    // Reuses the jog, scratch and sync state of the last calculateRate() call
+    // instead of advancing it a second time.
+    double recalculateRate(double baserate, bool paused, bool* isScratching);
     double getRawRate() const;
 
     // Set rate change when temp rate button is pressed
@@ -78,6 +82,8 @@ public:
     virtual void trackUnloaded(TrackPointer pTrack);
 
   private:
+    double calculateRate(double baserate, bool paused, int iSamplesPerBuffer,
+                         bool bAdvance, bool* isScratching);
     double getJogFactor() const;
     double getWheelFactor() const;
     SyncMode getSyncMode() const;
@@ -177,6 +183,9 @@ public:
     enum RATERAMP_RAMPBACK_MODE m_eRampBackMode;
     // Return speed for temporary rate change
     double m_dRateTempRampbackChange;
+    // The jog factor and sync adjustment of the last calculateRate() call.
+    double m_dJogFactor;
+    double m_dSyncAdjustment;
 };
 
 #endif /* RATECONTROL_H */
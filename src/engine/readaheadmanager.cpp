@@ -158,8 +158,9 @@ void ReadAheadManager::hintReader(double dRate, QVector<Hint>* pHintList) {
     Hint current_position;
 
     // SoundTouch can read up to 2 chunks ahead. Always keep 2 chunks ahead in
-    // cache.
-    int length_to_cache = 2 * CachingReaderWorker::kSamplesPerChunk;
+    // cache. Only the first chunk is needed immediately, the second one is
+    // read after more important hints such as loop points.
+    int length_to_cache = CachingReaderWorker::kSamplesPerChunk;
 
     current_position.length = length_to_cache;
     current_position.sample = in_reverse ?
@@ -173,8 +174,19 @@ void ReadAheadManager::hintReader(double dRate, QVector<Hint>* pHintList) {
         return;
 
     // top priority, we need to read this data immediately
-    current_position.priority = 1;
+    current_position.priority = kHintPriorityImminent;
     pHintList->append(current_position);
+
+    Hint read_ahead;
+    read_ahead.length = length_to_cache;
+    read_ahead.sample = in_reverse ?
+            current_position.sample - length_to_cache :
+            current_position.sample + length_to_cache;
+    if (read_ahead.sample + read_ahead.length < 0) {
+        return;
+    }
+    read_ahead.priority = kHintPriorityReadAhead;
+    pHintList->append(read_ahead);
 }
 
 void ReadAheadManager::addReadLogEntry(double virtualPlaypositionStart,
@@ -37,6 +37,12 @@
 
 EngineSideChain::EngineSideChain(ConfigObject<ConfigValue>* pConfig)
         : m_pConfig(pConfig),
+          m_writeSamplesTraceKey("EngineSideChain::writeSamples"),
+          m_wakeUpTraceKey("EngineSideChain::writeSamples wake up"),
+          m_processTraceKey("EngineSideChain::process"),
+          m_overrunCounterKey(Stat::registerKey(
+                  "EngineSideChain::writeSamples buffer overrun")),
+          m_threadEventKey(Stat::registerKey("EngineSideChain")),
           m_bStopThread(false),
           m_sampleFifo(SIDECHAIN_BUFFER_SIZE),
           m_pWorkBuffer(SampleUtil::alloc(SIDECHAIN_BUFFER_SIZE)) {
@@ -70,16 +76,16 @@ void EngineSideChain::addSideChainWorker(SideChainWorker* pWorker) {
 }
 
 void EngineSideChain::writeSamples(const CSAMPLE* newBuffer, int buffer_size) {
-    Trace sidechain("EngineSideChain::writeSamples");
+    Trace sidechain(m_writeSamplesTraceKey);
     int samples_written = m_sampleFifo.write(newBuffer, buffer_size);
 
     if (samples_written != buffer_size) {
-        Counter("EngineSideChain::writeSamples buffer overrun").increment();
+        Counter(m_overrunCounterKey).increment();
     }
 
     if (m_sampleFifo.writeAvailable() < SIDECHAIN_BUFFER_SIZE/5) {
         // Signal to the sidechain that samples are available.
-        Trace wakeup("EngineSideChain::writeSamples wake up");
+        Trace wakeup(m_wakeUpTraceKey);
         m_waitForSamples.wakeAll();
     }
 }
@@ -90,20 +96,20 @@ void EngineSideChain::run() {
     unsigned static id = 0;
     QThread::currentThread()->setObjectName(QString("EngineSideChain %1").arg(++id));
 
-    Event::start("EngineSideChain");
+    Event::start(m_threadEventKey);
     while (!m_bStopThread) {
         // Sleep until samples are available.
         m_waitLock.lock();
 
-        Event::end("EngineSideChain");
+        Event::end(m_threadEventKey);
         m_waitForSamples.wait(&m_waitLock);
         m_waitLock.unlock();
-        Event::start("EngineSideChain");
+        Event::start(m_threadEventKey);
 
         int samples_read;
         while ((samples_read = m_sampleFifo.read(m_pWorkBuffer,
                                                  SIDECHAIN_BUFFER_SIZE))) {
-            Trace process("EngineSideChain::process");
+            Trace process(m_processTraceKey);
             QMutexLocker locker(&m_workerLock);
             foreach (SideChainWorker* pWorker, m_workers) {
                 pWorker->process(m_pWorkBuffer, samples_read);
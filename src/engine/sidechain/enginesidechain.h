@@ -26,6 +26,7 @@
 #include "defs.h"
 #include "engine/sidechain/sidechainworker.h"
 #include "util/fifo.h"
+#include "util/trace.h"
 
 class EngineSideChain : public QThread {
     Q_OBJECT
@@ -45,6 +46,12 @@ class EngineSideChain : public QThread {
     void run();
 
     ConfigObject<ConfigValue>* m_pConfig;
+    // Registered up front since writeSamples() runs in the engine callback.
+    const TraceKey m_writeSamplesTraceKey;
+    const TraceKey m_wakeUpTraceKey;
+    const TraceKey m_processTraceKey;
+    const StatKey m_overrunCounterKey;
+    const StatKey m_threadEventKey;
     // Indicates that the thread should exit.
     volatile bool m_bStopThread;
 
@@ -20,6 +20,9 @@
 
 const bool sDebug = false;
 
+// static
+const int BaseSqlTableModel::kMaxIncrementalRanges = 64;
+
 BaseSqlTableModel::BaseSqlTableModel(QObject* pParent,
                                      TrackCollection* pTrackCollection,
                                      const char* settingsNamespace)
@@ -32,8 +35,20 @@ BaseSqlTableModel::BaseSqlTableModel(QObject* pParent,
           m_iPreviewDeckTrackId(-1),
           m_currentSearch("") {
     m_bInitialized = false;
+    m_bDirty = true;
+    m_bRowsOutdated = true;
     m_iSortColumn = 0;
     m_eSortOrder = Qt::AscendingOrder;
+    // The table may have changed if the DAOs report any change to the tracks,
+    // playlists or crates.
+    connect(&m_trackDAO, SIGNAL(tracksAdded(QSet<int>)),
+            this, SLOT(slotTableChanged()));
+    connect(&m_trackDAO, SIGNAL(tracksRemoved(QSet<int>)),
+            this, SLOT(slotTableChanged()));
+    connect(&pTrackCollection->getPlaylistDAO(), SIGNAL(changed(int)),
+            this, SLOT(slotTableChanged()));
+    connect(&pTrackCollection->getCrateDAO(), SIGNAL(changed(int)),
+            this, SLOT(slotTableChanged()));
     connect(&PlayerInfo::instance(), SIGNAL(trackLoaded(QString, TrackPointer)),
             this, SLOT(trackLoaded(QString, TrackPointer)));
     trackLoaded(m_previewDeckGroup, PlayerInfo::instance().getTrackInfo(m_previewDeckGroup));
@@ -163,16 +178,24 @@ void BaseSqlTableModel::select() {
     if (!m_bInitialized) {
         return;
     }
-    // We should be able to detect when a select() would be a no-op. The DAO's
-    // do not currently broadcast signals for when common things happen. In the
-    // future, we can turn this check on and avoid a lot of needless
-    // select()'s. rryan 9/2011
-    // if (!m_bDirty) {
-    //     if (sDebug) {
-    //         qDebug() << this << "Skipping non-dirty select()";
-    //     }
-    //     return;
-    // }
+    // Callers select() after they changed the table, so always query it.
+    m_bDirty = true;
+    reselect();
+}
+
+void BaseSqlTableModel::reselect() {
+    if (!m_bInitialized) {
+        return;
+    }
+
+    QString orderBy = orderByClause();
+    bool queryTable = m_bDirty || orderBy != m_tableOrderBy;
+    if (!queryTable && !m_bRowsOutdated) {
+        if (sDebug) {
+            qDebug() << this << "Skipping non-dirty select()";
+        }
+        return;
+    }
 
     if (sDebug) {
         qDebug() << this << "select()";
@@ -181,8 +204,67 @@ void BaseSqlTableModel::select() {
     QTime time;
     time.start();
 
+    if (queryTable && !queryTableRows(orderBy)) {
+        return;
+    }
+
+    QVector<RowInfo> rowInfo = m_tableRows;
+
+    // Adjust sort column to remove table columns and add 1 to add an id column.
+    int sortColumn = m_iSortColumn - m_tableColumns.size() + 1;
+
+    if (sortColumn < 0) {
+        sortColumn = 0;
+    }
+
+    if (m_trackSource) {
+        // If we were sorting a table column, then secondary sort by id. TODO(rryan)
+        // we should look into being able to drop the secondary sort to save time
+        // but going for correctness first.
+        m_trackSource->filterAndSort(m_tableTrackIds, m_currentSearch,
+                                     m_currentSearchFilter,
+                                     sortColumn, m_eSortOrder,
+                                     &m_trackSortOrder);
+
+        // Re-sort the track IDs since filterAndSort can change their order or mark
+        // them for removal (by setting their row to -1).
+        for (QVector<RowInfo>::iterator it = rowInfo.begin();
+             it != rowInfo.end(); ++it) {
+            // If the sort column is not a track column then we will sort only to
+            // separate removed tracks (order == -1) from present tracks (order ==
+            // 0). Otherwise we sort by the order that filterAndSort returned to us.
+            if (sortColumn == 0) {
+                it->order = m_trackSortOrder.contains(it->trackId) ? 0 : -1;
+            } else {
+                it->order = m_trackSortOrder.value(it->trackId, -1);
+            }
+        }
+    }
+
+    // RowInfo::operator< sorts by the order field, except -1 is placed at the
+    // end so we can easily slice off rows that are no longer present. Stable
+    // sort is necessary because the tracks may be in pre-sorted order so we
+    // should not disturb that if we are only removing tracks.
+    qStableSort(rowInfo.begin(), rowInfo.end());
+
+    for (int i = 0; i < rowInfo.size(); ++i) {
+        if (rowInfo[i].order == -1) {
+            // We've reached the end of valid rows. Resize rowInfo to cut off
+            // this and all further elements.
+            rowInfo.resize(i);
+            break;
+        }
+    }
+
+    updateRows(rowInfo);
+    m_bRowsOutdated = false;
+
+    int elapsed = time.elapsed();
+    qDebug() << this << "select() took" << elapsed << "ms" << rowInfo.size();
+}
+
+bool BaseSqlTableModel::queryTableRows(const QString& orderBy) {
     QString columns = m_tableColumnsJoined;
-    QString orderBy = orderByClause();
     QString queryString = QString("SELECT %1 FROM %2 %3")
             .arg(columns, m_tableName, orderBy);
 
@@ -196,19 +278,11 @@ void BaseSqlTableModel::select() {
     query.setForwardOnly(true);
     query.prepare(queryString);
 
+    // The rows are only replaced after the table query has succeeded. See Bug
+    // #1090888.
     if (!query.exec()) {
         LOG_FAILED_QUERY(query);
-        return;
-    }
-
-    // Remove all the rows from the table. We wait to do this until after the
-    // table query has succeeded. See Bug #1090888.
-    // TODO(rryan) we could edit the table in place instead of clearing it?
-    if (m_rowInfo.size() > 0) {
-        beginRemoveRows(QModelIndex(), 0, m_rowInfo.size()-1);
-        m_rowInfo.clear();
-        m_trackIdToRows.clear();
-        endRemoveRows();
+        return false;
     }
 
     QSqlRecord record = query.record();
@@ -220,20 +294,15 @@ void BaseSqlTableModel::select() {
         tableColumnIndices.push_back(record.indexOf(column));
     }
 
-    // sqlite does not set size and m_rowInfo was just cleared
-    //if (sDebug) {
-    //    qDebug() << "Rows returned" << rows << m_rowInfo.size();
-    //}
-
-    QVector<RowInfo> rowInfo;
-    QSet<int> trackIds;
+    m_tableRows.clear();
+    m_tableTrackIds.clear();
     while (query.next()) {
         int id = query.value(idColumn).toInt();
-        trackIds.insert(id);
+        m_tableTrackIds.insert(id);
 
         RowInfo thisRowInfo;
         thisRowInfo.trackId = id;
-        thisRowInfo.order = rowInfo.size(); // save rows where this currently track id is located
+        thisRowInfo.order = m_tableRows.size(); // save rows where this currently track id is located
         // Get all the table columns and store them in the hash for this
         // row-info section.
 
@@ -241,71 +310,174 @@ void BaseSqlTableModel::select() {
             thisRowInfo.metadata[tableColumnIndex] =
                     query.value(tableColumnIndex);
         }
-        rowInfo.push_back(thisRowInfo);
+        m_tableRows.push_back(thisRowInfo);
     }
 
     if (sDebug) {
-        qDebug() << "Rows actually received:" << rowInfo.size();
+        qDebug() << "Rows actually received:" << m_tableRows.size();
     }
 
-    // Adjust sort column to remove table columns and add 1 to add an id column.
-    int sortColumn = m_iSortColumn - m_tableColumns.size() + 1;
+    m_tableOrderBy = orderBy;
+    m_bDirty = false;
+    return true;
+}
 
-    if (sortColumn < 0) {
-        sortColumn = 0;
+void BaseSqlTableModel::updateRows(const QVector<RowInfo>& rowInfo) {
+    // Match the rows of the same track in order, so that a track that is in a
+    // playlist twice keeps both of its rows.
+    QHash<int, QList<int> > newRowsOfTrack;
+    for (int i = 0; i < rowInfo.size(); ++i) {
+        newRowsOfTrack[rowInfo[i].trackId].append(i);
+    }
+    QVector<int> newRowOfOldRow(m_rowInfo.size(), -1);
+    QVector<bool> isNewRowMatched(rowInfo.size(), false);
+    int removedRanges = 0;
+    for (int i = 0; i < m_rowInfo.size(); ++i) {
+        QHash<int, QList<int> >::iterator it =
+                newRowsOfTrack.find(m_rowInfo[i].trackId);
+        if (it != newRowsOfTrack.end() && !it.value().isEmpty()) {
+            newRowOfOldRow[i] = it.value().takeFirst();
+            isNewRowMatched[newRowOfOldRow[i]] = true;
+        } else if (i == 0 || newRowOfOldRow[i - 1] != -1) {
+            ++removedRanges;
+        }
+    }
+    int insertedRanges = 0;
+    for (int i = 0; i < rowInfo.size(); ++i) {
+        if (!isNewRowMatched[i] && (i == 0 || isNewRowMatched[i - 1])) {
+            ++insertedRanges;
+        }
     }
 
-    if (m_trackSource) {
-        // If we were sorting a table column, then secondary sort by id. TODO(rryan)
-        // we should look into being able to drop the secondary sort to save time
-        // but going for correctness first.
-        m_trackSource->filterAndSort(trackIds, m_currentSearch,
-                                     m_currentSearchFilter,
-                                     sortColumn, m_eSortOrder,
-                                     &m_trackSortOrder);
+    if (removedRanges + insertedRanges > kMaxIncrementalRanges) {
+        // Views handle each range separately, so it is cheaper to replace all
+        // rows, e.g. when a search narrows down the whole library.
+        if (m_rowInfo.size() > 0) {
+            beginRemoveRows(QModelIndex(), 0, m_rowInfo.size() - 1);
+            m_rowInfo.clear();
+            m_trackIdToRows.clear();
+            endRemoveRows();
+        }
+        if (rowInfo.size() > 0) {
+            beginInsertRows(QModelIndex(), 0, rowInfo.size() - 1);
+            m_rowInfo = rowInfo;
+            rebuildTrackIdToRows();
+            endInsertRows();
+        }
+        return;
+    }
 
-        // Re-sort the track IDs since filterAndSort can change their order or mark
-        // them for removal (by setting their row to -1).
-        for (QVector<RowInfo>::iterator it = rowInfo.begin();
-             it != rowInfo.end(); ++it) {
-            // If the sort column is not a track column then we will sort only to
-            // separate removed tracks (order == -1) from present tracks (order ==
-            // 0). Otherwise we sort by the order that filterAndSort returned to us.
-            if (sortColumn == 0) {
-                it->order = m_trackSortOrder.contains(it->trackId) ? 0 : -1;
-            } else {
-                it->order = m_trackSortOrder.value(it->trackId, -1);
-            }
+    // Remove the rows that are gone, from the bottom up so that the rows above
+    // keep their numbers.
+    int last = m_rowInfo.size() - 1;
+    while (last >= 0) {
+        if (newRowOfOldRow[last] != -1) {
+            --last;
+            continue;
         }
+        int first = last;
+        while (first > 0 && newRowOfOldRow[first - 1] == -1) {
+            --first;
+        }
+        beginRemoveRows(QModelIndex(), first, last);
+        m_rowInfo.remove(first, last - first + 1);
+        newRowOfOldRow.remove(first, last - first + 1);
+        endRemoveRows();
+        last = first - 1;
     }
 
-    // RowInfo::operator< sorts by the order field, except -1 is placed at the
-    // end so we can easily slice off rows that are no longer present. Stable
-    // sort is necessary because the tracks may be in pre-sorted order so we
-    // should not disturb that if we are only removing tracks.
-    qStableSort(rowInfo.begin(), rowInfo.end());
+    // Move the remaining rows into their new order. A layout change keeps the
+    // selection and the current index on the rows they belonged to.
+    bool moved = false;
+    for (int i = 1; i < newRowOfOldRow.size(); ++i) {
+        if (newRowOfOldRow[i] < newRowOfOldRow[i - 1]) {
+            moved = true;
+            break;
+        }
+    }
+    if (moved) {
+        emit(layoutAboutToBeChanged());
+        // Rows of the new order, ascending by their new rows.
+        QVector<int> sortedNewRows = newRowOfOldRow;
+        qSort(sortedNewRows);
+        QHash<int, int> rankOfNewRow;
+        for (int i = 0; i < sortedNewRows.size(); ++i) {
+            rankOfNewRow.insert(sortedNewRows[i], i);
+        }
+        QVector<RowInfo> movedRows(m_rowInfo.size());
+        QVector<int> rankOfOldRow(newRowOfOldRow.size());
+        for (int i = 0; i < newRowOfOldRow.size(); ++i) {
+            int rank = rankOfNewRow.value(newRowOfOldRow[i]);
+            rankOfOldRow[i] = rank;
+            movedRows[rank] = m_rowInfo[i];
+        }
+        QModelIndexList from = persistentIndexList();
+        QModelIndexList to;
+        foreach (const QModelIndex& index, from) {
+            to.append(this->index(rankOfOldRow[index.row()], index.column()));
+        }
+        changePersistentIndexList(from, to);
+        m_rowInfo = movedRows;
+        qSort(newRowOfOldRow);
+        emit(layoutChanged());
+    }
 
-    m_trackIdToRows.clear();
-    for (int i = 0; i < rowInfo.size(); ++i) {
-        const RowInfo& row = rowInfo[i];
+    // Insert the new rows. All rows above a new row are in place by the time
+    // it is inserted.
+    int first = 0;
+    while (first < rowInfo.size()) {
+        if (isNewRowMatched[first]) {
+            ++first;
+            continue;
+        }
+        int last = first;
+        while (last + 1 < rowInfo.size() && !isNewRowMatched[last + 1]) {
+            ++last;
+        }
+        beginInsertRows(QModelIndex(), first, last);
+        m_rowInfo.insert(first, last - first + 1, RowInfo());
+        for (int i = first; i <= last; ++i) {
+            m_rowInfo[i] = rowInfo[i];
+        }
+        endInsertRows();
+        first = last + 1;
+    }
 
-        if (row.order == -1) {
-            // We've reached the end of valid rows. Resize rowInfo to cut off
-            // this and all further elements.
-            rowInfo.resize(i);
-            break;
+    // Take over the table columns of the rows that stayed, e.g. playlist
+    // positions, and report the ones that changed.
+    const int numColumns = columnCount();
+    first = -1;
+    for (int i = 0; i <= rowInfo.size(); ++i) {
+        bool changed = i < rowInfo.size() &&
+                m_rowInfo[i].metadata != rowInfo[i].metadata;
+        if (i < rowInfo.size()) {
+            m_rowInfo[i] = rowInfo[i];
+        }
+        if (changed && first == -1) {
+            first = i;
+        } else if (!changed && first != -1) {
+            emit(dataChanged(index(first, 0), index(i - 1, numColumns - 1)));
+            first = -1;
         }
-        QLinkedList<int>& rows = m_trackIdToRows[row.trackId];
-        rows.push_back(i);
     }
+    rebuildTrackIdToRows();
+}
 
-    // We're done! Issue the update signals and replace the master maps.
-    beginInsertRows(QModelIndex(), 0, rowInfo.size()-1);
-    m_rowInfo = rowInfo;
-    endInsertRows();
+void BaseSqlTableModel::updateRowsForTest(const QList<int>& trackIds) {
+    QVector<RowInfo> rowInfo(trackIds.size());
+    for (int i = 0; i < trackIds.size(); ++i) {
+        rowInfo[i].trackId = trackIds[i];
+        rowInfo[i].order = i;
+    }
+    updateRows(rowInfo);
+}
 
-    int elapsed = time.elapsed();
-    qDebug() << this << "select() took" << elapsed << "ms" << rowInfo.size();
+void BaseSqlTableModel::rebuildTrackIdToRows() {
+    m_trackIdToRows.clear();
+    for (int i = 0; i < m_rowInfo.size(); ++i) {
+        QLinkedList<int>& rows = m_trackIdToRows[m_rowInfo[i].trackId];
+        rows.push_back(i);
+    }
 }
 
 void BaseSqlTableModel::setTable(const QString& tableName,
@@ -332,6 +504,7 @@ void BaseSqlTableModel::setTable(const QString& tableName,
 
     // Build a map from the column names to their indices, used by fieldIndex()
     m_tableColumnCache.setColumns(m_tableColumns);
+    m_bDirty = true;
 
     initHeaderData();
 
@@ -358,6 +531,7 @@ void BaseSqlTableModel::setSearch(const QString& searchText, const QString& extr
 
     m_currentSearch = searchText;
     m_currentSearchFilter = extraFilter;
+    m_bRowsOutdated = true;
 }
 
 void BaseSqlTableModel::search(const QString& searchText, const QString& extraFilter) {
@@ -365,7 +539,7 @@ void BaseSqlTableModel::search(const QString& searchText, const QString& extraFi
         qDebug() << this << "search" << searchText;
     }
     setSearch(searchText, extraFilter);
-    select();
+    reselect();
 }
 
 void BaseSqlTableModel::setSort(int column, Qt::SortOrder order) {
@@ -386,6 +560,7 @@ void BaseSqlTableModel::setSort(int column, Qt::SortOrder order) {
 
     m_iSortColumn = column;
     m_eSortOrder = order;
+    m_bRowsOutdated = true;
 }
 
 void BaseSqlTableModel::sort(int column, Qt::SortOrder order) {
@@ -393,7 +568,7 @@ void BaseSqlTableModel::sort(int column, Qt::SortOrder order) {
         qDebug() << this << "sort()" << column << order;
     }
     setSort(column, order);
-    select();
+    reselect();
 }
 
 int BaseSqlTableModel::rowCount(const QModelIndex& parent) const {
@@ -713,6 +888,10 @@ void BaseSqlTableModel::trackLoaded(QString group, TrackPointer pTrack) {
     }
 }
 
+void BaseSqlTableModel::slotTableChanged() {
+    m_bDirty = true;
+}
+
 void BaseSqlTableModel::tracksChanged(QSet<int> trackIds) {
     if (sDebug) {
         qDebug() << this << "trackChanged" << trackIds.size();
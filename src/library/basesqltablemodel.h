@@ -57,7 +57,13 @@ class BaseSqlTableModel : public QAbstractTableModel, public TrackModel {
     int fieldIndex(ColumnCache::Column column) const;
     int fieldIndex(const QString& fieldName) const;
 
+    // Queries the table and updates the rows. Views are notified of the rows
+    // that were removed, moved, inserted or changed, so that they keep their
+    // scroll position and selection.
     void select();
+    // Replaces the rows with one row per track in trackIds like select()
+    // does, without querying the table.
+    void updateRowsForTest(const QList<int>& trackIds);
     QString getTrackLocation(const QModelIndex& index) const;
     QAbstractItemDelegate* delegateForColumn(const int i, QObject* pParent);
 
@@ -97,6 +103,8 @@ class BaseSqlTableModel : public QAbstractTableModel, public TrackModel {
   private slots:
     virtual void tracksChanged(QSet<int> trackIds);
     virtual void trackLoaded(QString group, TrackPointer pTrack);
+    // Marks the table as changed so that the next search or sort queries it.
+    void slotTableChanged();
 
   private:
     inline void setTrackValueForColumn(TrackPointer pTrack, int column, QVariant value);
@@ -122,7 +130,31 @@ class BaseSqlTableModel : public QAbstractTableModel, public TrackModel {
             return order < other.order;
         }
     };
+    // Like select(), but only queries the table if it changed or is sorted
+    // differently, and does nothing if neither the table nor the search or
+    // sort changed.
+    void reselect();
+    // Queries the rows of the table in the order of orderBy into m_tableRows.
+    bool queryTableRows(const QString& orderBy);
+    // Replaces m_rowInfo with rowInfo and notifies the views of the changes.
+    void updateRows(const QVector<RowInfo>& rowInfo);
+    void rebuildTrackIdToRows();
+
+    // Beyond this many ranges of removed and inserted rows, all rows are
+    // replaced instead.
+    static const int kMaxIncrementalRanges;
+
     QVector<RowInfo> m_rowInfo;
+    // The rows of the table before they are filtered and sorted by the track
+    // source, and the tracks in them.
+    QVector<RowInfo> m_tableRows;
+    QSet<int> m_tableTrackIds;
+    // The ORDER BY clause m_tableRows was queried with.
+    QString m_tableOrderBy;
+    // Whether the table may have changed since it was last queried.
+    bool m_bDirty;
+    // Whether the search or sort changed since the rows were last updated.
+    bool m_bRowsOutdated;
 
     QString m_tableName;
     QString m_idColumn;
@@ -13,6 +13,26 @@ namespace {
 
 const bool sDebug = false;
 
+// The columns that search terms without a field are matched against.
+QStringList defaultSearchColumns() {
+    QStringList columns;
+    columns << "artist"
+            << "album"
+            << "album_artist"
+            << "location"
+            << "grouping"
+            << "comment"
+            << "title"
+            << "genre";
+    return columns;
+}
+
+// The columns that are searched as text, including the ones that can only be
+// searched with a field like "composer:".
+QStringList indexedTextColumns() {
+    return defaultSearchColumns() << "composer";
+}
+
 }  // namespace
 
 BaseTrackCache::BaseTrackCache(TrackCollection* pTrackCollection,
@@ -26,19 +46,16 @@ BaseTrackCache::BaseTrackCache(TrackCollection* pTrackCollection,
           m_columnCount(columns.size()),
           m_columnsJoined(columns.join(",")),
           m_columnCache(columns),
+          m_searchColumns(defaultSearchColumns()),
           m_bIndexBuilt(false),
           m_bIsCaching(isCaching),
+          m_index(columns, indexedTextColumns()),
           m_trackDAO(pTrackCollection->getTrackDAO()),
           m_database(pTrackCollection->getDatabase()),
           m_pQueryParser(new SearchQueryParser(pTrackCollection->getDatabase())) {
-    m_searchColumns << "artist"
-                    << "album"
-                    << "album_artist"
-                    << "location"
-                    << "grouping"
-                    << "comment"
-                    << "title"
-                    << "genre";
+    // Track numbers are text, but sorted like orderByClause() sorts them.
+    m_index.setSortAsInteger(
+        fieldIndex(ColumnCache::COLUMN_LIBRARYTABLE_TRACKNUMBER));
 
     // Convert all the search column names to their field indexes because we use
     // them a bunch.
@@ -52,6 +69,10 @@ BaseTrackCache::~BaseTrackCache() {
     delete m_pQueryParser;
 }
 
+void BaseTrackCache::setFullTextTable(const QString& ftsTable) {
+    m_pQueryParser->setFullTextTable(ftsTable, m_idColumn);
+}
+
 int BaseTrackCache::columnCount() const {
     return m_columnCount;
 }
@@ -83,7 +104,7 @@ void BaseTrackCache::slotTracksRemoved(QSet<int> trackIds) {
         qDebug() << this << "slotTracksRemoved" << trackIds.size();
     }
     foreach (int trackId, trackIds) {
-        m_trackInfo.remove(trackId);
+        m_index.removeTrack(trackId);
     }
 }
 
@@ -98,6 +119,12 @@ void BaseTrackCache::slotTrackChanged(int trackId) {
     if (sDebug) {
         qDebug() << this << "slotTrackChanged" << trackId;
     }
+    // Keep the index current so that searches see the change before the
+    // track is saved.
+    TrackPointer pTrack = lookupCachedTrack(trackId);
+    if (pTrack) {
+        updateIndexWithTrackpointer(pTrack);
+    }
     QSet<int> trackIds;
     trackIds.insert(trackId);
     emit(tracksChanged(trackIds));
@@ -112,7 +139,7 @@ void BaseTrackCache::slotTrackClean(int trackId) {
 }
 
 bool BaseTrackCache::isCached(int trackId) const {
-    return m_trackInfo.contains(trackId);
+    return m_index.contains(trackId);
 }
 
 void BaseTrackCache::ensureCached(int trackId) {
@@ -145,14 +172,13 @@ bool BaseTrackCache::updateIndexWithTrackpointer(TrackPointer pTrack) {
     int id = pTrack->getId();
 
     if (id > 0) {
-        // m_trackInfo[id] will insert a QVector<QVariant> into the
-        // m_trackInfo HashTable with the key "id"
-        QVector<QVariant>& record = m_trackInfo[id];
-        // prealocate memory for all columns at once
+        // Keep the values of the columns the track doesn't know about.
+        QVector<QVariant> record = m_index.trackValues(id);
         record.resize(numColumns);
         for (int i = 0; i < numColumns; ++i) {
             getTrackValueForColumn(pTrack, i, record[i]);
         }
+        m_index.updateTrack(id, record);
     }
     return true;
 }
@@ -179,17 +205,13 @@ bool BaseTrackCache::updateIndexWithQuery(const QString& queryString) {
     int numColumns = columnCount();
     int idColumn = query.record().indexOf(m_idColumn);
 
+    QVector<QVariant> record(numColumns);
     while (query.next()) {
         int id = query.value(idColumn).toInt();
-
-        //m_trackInfo[id] will insert a QVector<QVariant> into the
-        //m_trackInfo HashTable with the key "id"
-        QVector<QVariant>& record = m_trackInfo[id];
-        record.resize(numColumns);
-
         for (int i = 0; i < numColumns; ++i) {
             record[i] = query.value(i);
         }
+        m_index.updateTrack(id, record);
     }
 
     qDebug() << this << "updateIndexWithQuery took" << timer.elapsed() << "ms";
@@ -211,7 +233,7 @@ void BaseTrackCache::buildIndex() {
     // TODO(rryan) for very large tables, it probably makes more sense to NOT
     // clear the table, and keep track of what IDs we see, then delete the ones
     // we don't see.
-    m_trackInfo.clear();
+    m_index.clear();
 
     if (!updateIndexWithQuery(queryString)) {
         qDebug() << "buildIndex failed!";
@@ -231,6 +253,14 @@ void BaseTrackCache::updateTracksInIndex(QSet<int> trackIds) {
         return;
     }
 
+    if (!updateIndexWithTrackIds(trackIds)) {
+        qDebug() << "updateTracksInIndex failed!";
+        return;
+    }
+    emit(tracksChanged(trackIds));
+}
+
+bool BaseTrackCache::updateIndexWithTrackIds(const QSet<int>& trackIds) {
     QStringList idStrings;
     foreach (int trackId, trackIds) {
         idStrings << QVariant(trackId).toString();
@@ -240,14 +270,10 @@ void BaseTrackCache::updateTracksInIndex(QSet<int> trackIds) {
             .arg(m_columnsJoined, m_tableName, m_idColumn, idStrings.join(","));
 
     if (sDebug) {
-        qDebug() << this << "updateTracksInIndex update query:" << queryString;
+        qDebug() << this << "updateIndexWithTrackIds update query:" << queryString;
     }
 
-    if (!updateIndexWithQuery(queryString)) {
-        qDebug() << "updateTracksInIndex failed!";
-        return;
-    }
-    emit(tracksChanged(trackIds));
+    return updateIndexWithQuery(queryString);
 }
 
 void BaseTrackCache::getTrackValueForColumn(TrackPointer pTrack,
@@ -334,12 +360,10 @@ QVariant BaseTrackCache::data(int trackId, int column) const {
     // TODO(rryan) this code is flawed for columns that contains row-specific
     // metadata. Currently the upper-levels will not delegate row-specific
     // columns to this method, but there should still be a check here I think.
-    if (!result.isValid()) {
-        QHash<int, QVector<QVariant> >::const_iterator it =
-                m_trackInfo.find(trackId);
-        if (it != m_trackInfo.end()) {
-            const QVector<QVariant>& fields = it.value();
-            result = fields.value(column, result);
+    if (!result.isValid() && column >= 0 && column < columnCount()) {
+        int row = m_index.rowForTrackId(trackId);
+        if (row >= 0) {
+            result = m_index.value(row, column);
         }
     }
     return result;
@@ -355,12 +379,14 @@ void BaseTrackCache::filterAndSort(const QSet<int>& trackIds,
         return;
     }
 
+    // A query of only spaces parses to an empty AndNode, which matches
+    // nothing. Treat it like an empty search.
+    searchQuery = searchQuery.trimmed();
+
     if (!m_bIndexBuilt) {
         buildIndex();
     }
 
-    QStringList idStrings;
-
     if (sortColumn < 0 || sortColumn >= columnCount()) {
         qDebug() << "ERROR: Invalid sort column provided to BaseTrackCache::filterAndSort";
         return;
@@ -369,57 +395,45 @@ void BaseTrackCache::filterAndSort(const QSet<int>& trackIds,
     // TODO(rryan) consider making this the data passed in and a separate
     // QVector for output
     QSet<int> dirtyTracks;
+    QSet<int> uncachedTracks;
     foreach (int trackId, trackIds) {
-        idStrings << QVariant(trackId).toString();
         if (m_dirtyTracks.contains(trackId)) {
             dirtyTracks.insert(trackId);
         }
+        if (!m_index.contains(trackId)) {
+            uncachedTracks.insert(trackId);
+        }
     }
 
-    QScopedPointer<QueryNode> pQuery(parseQuery(
-        searchQuery, extraFilter, idStrings));
-
-    QString filter = pQuery->toSql();
-    if (!filter.isEmpty()) {
-        filter.prepend("WHERE ");
-    }
-
-    QString orderBy = orderByClause(sortColumn, sortOrder);
-    QString queryString = QString("SELECT %1 FROM %2 %3 %4")
-            .arg(m_idColumn, m_tableName, filter, orderBy);
-
-    if (sDebug) {
-        qDebug() << this << "select() executing:" << queryString;
-    }
-
-    QSqlQuery query(m_database);
-    // This causes a memory savings since QSqlCachedResult (what QtSQLite uses)
-    // won't allocate a giant in-memory table that we won't use at all.
-    query.setForwardOnly(true);
-    query.prepare(queryString);
-
-    if (!query.exec()) {
-        LOG_FAILED_QUERY(query);
+    QScopedPointer<QueryNode> pQuery;
+    if (extraFilter.isEmpty()) {
+        pQuery.reset(m_pQueryParser->parseQuery(searchQuery, m_searchColumns,
+                                                QString()));
     }
 
-    int idColumn = query.record().indexOf(m_idColumn);
-    int rows = query.size();
-
-    if (sDebug) {
-        qDebug() << "Rows returned:" << rows;
+    if (pQuery && pQuery->canMatchIndex()) {
+        // Tracks are normally added to the index as the DAO reports them, but
+        // make sure that none of them is missing from the results.
+        if (!uncachedTracks.isEmpty()) {
+            updateIndexWithTrackIds(uncachedTracks);
+        }
+        filterAndSortInIndex(trackIds,
+                             searchQuery.isEmpty() ? NULL : pQuery.data(),
+                             sortColumn, sortOrder, &m_trackOrder);
+    } else {
+        QStringList idStrings;
+        foreach (int trackId, trackIds) {
+            idStrings << QVariant(trackId).toString();
+        }
+        pQuery.reset(parseQuery(searchQuery, extraFilter, idStrings));
+        filterAndSortInDatabase(pQuery.data(), sortColumn, sortOrder,
+                                &m_trackOrder);
     }
 
-    m_trackOrder.resize(0);
     trackToIndex->clear();
-    if (rows > 0) {
-        trackToIndex->reserve(rows);
-        m_trackOrder.reserve(rows);
-    }
-
-    while (query.next()) {
-        int id = query.value(idColumn).toInt();
-        (*trackToIndex)[id] = m_trackOrder.size();
-        m_trackOrder.push_back(id);
+    trackToIndex->reserve(m_trackOrder.size());
+    for (int i = 0; i < m_trackOrder.size(); ++i) {
+        (*trackToIndex)[m_trackOrder[i]] = i;
     }
 
     // At this point, the original set of tracks have been divided into two
@@ -496,6 +510,101 @@ void BaseTrackCache::filterAndSort(const QSet<int>& trackIds,
     }
 }
 
+void BaseTrackCache::filterAndSortInIndex(const QSet<int>& trackIds,
+                                          const QueryNode* pQuery,
+                                          int sortColumn,
+                                          Qt::SortOrder sortOrder,
+                                          QVector<int>* pTrackOrder) {
+    QTime timer;
+    timer.start();
+
+    // Mark the rows that match, then collect them in the order of the sort
+    // column.
+    QVector<bool> matches(m_index.rowCount(), false);
+    QVector<int> candidates;
+    if (pQuery && pQuery->indexCandidates(&m_index, &candidates)) {
+        foreach (int row, candidates) {
+            if (trackIds.contains(m_index.trackIdForRow(row)) &&
+                    pQuery->match(m_index, row)) {
+                matches[row] = true;
+            }
+        }
+    } else {
+        foreach (int trackId, trackIds) {
+            int row = m_index.rowForTrackId(trackId);
+            if (row >= 0 && (!pQuery || pQuery->match(m_index, row))) {
+                matches[row] = true;
+            }
+        }
+    }
+
+    const QVector<int>& sortedRows = m_index.sortedRows(sortColumn);
+    pTrackOrder->resize(0);
+    if (sortOrder == Qt::AscendingOrder) {
+        for (int i = 0; i < sortedRows.size(); ++i) {
+            if (matches[sortedRows[i]]) {
+                pTrackOrder->push_back(m_index.trackIdForRow(sortedRows[i]));
+            }
+        }
+    } else {
+        for (int i = sortedRows.size() - 1; i >= 0; --i) {
+            if (matches[sortedRows[i]]) {
+                pTrackOrder->push_back(m_index.trackIdForRow(sortedRows[i]));
+            }
+        }
+    }
+
+    if (sDebug) {
+        qDebug() << this << "filterAndSortInIndex took" << timer.elapsed()
+                 << "ms for" << pTrackOrder->size() << "of" << trackIds.size()
+                 << "tracks";
+    }
+}
+
+void BaseTrackCache::filterAndSortInDatabase(const QueryNode* pQuery,
+                                             int sortColumn,
+                                             Qt::SortOrder sortOrder,
+                                             QVector<int>* pTrackOrder) const {
+    QString filter = pQuery->toSql();
+    if (!filter.isEmpty()) {
+        filter.prepend("WHERE ");
+    }
+
+    QString orderBy = orderByClause(sortColumn, sortOrder);
+    QString queryString = QString("SELECT %1 FROM %2 %3 %4")
+            .arg(m_idColumn, m_tableName, filter, orderBy);
+
+    if (sDebug) {
+        qDebug() << this << "select() executing:" << queryString;
+    }
+
+    QSqlQuery query(m_database);
+    // This causes a memory savings since QSqlCachedResult (what QtSQLite uses)
+    // won't allocate a giant in-memory table that we won't use at all.
+    query.setForwardOnly(true);
+    query.prepare(queryString);
+
+    if (!query.exec()) {
+        LOG_FAILED_QUERY(query);
+    }
+
+    int idColumn = query.record().indexOf(m_idColumn);
+    int rows = query.size();
+
+    if (sDebug) {
+        qDebug() << "Rows returned:" << rows;
+    }
+
+    pTrackOrder->resize(0);
+    if (rows > 0) {
+        pTrackOrder->reserve(rows);
+    }
+
+    while (query.next()) {
+        pTrackOrder->push_back(query.value(idColumn).toInt());
+    }
+}
+
 QueryNode* BaseTrackCache::parseQuery(QString query, QString extraFilter,
                                       QStringList idStrings) const {
     QStringList queryFragments;
@@ -578,7 +687,7 @@ int BaseTrackCache::findSortInsertionPoint(TrackPointer pTrack,
         int otherTrackId = trackIds[mid];
 
         // This should not happen, but it's a recoverable error so we should only log it.
-        if (!m_trackInfo.contains(otherTrackId)) {
+        if (!m_index.contains(otherTrackId)) {
             qDebug() << "WARNING: track" << otherTrackId << "was not in index";
             //updateTrackInIndex(otherTrackId);
         }
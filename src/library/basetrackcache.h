@@ -15,6 +15,7 @@
 
 #include "library/dao/trackdao.h"
 #include "library/columncache.h"
+#include "library/columnartrackindex.h"
 #include "trackinfoobject.h"
 #include "util.h"
 
@@ -28,6 +29,9 @@ class TrackCollection;
 // waste of memory because all the table-models were caching the same data
 // (track properties). Furthermore, the base SQL tables of these table-models
 // involve complicated joins, which are very slow.
+//
+// The values are kept in a ColumnarTrackIndex, which filterAndSort() searches
+// and sorts in memory unless the filter contains SQL.
 class BaseTrackCache : public QObject {
     Q_OBJECT
   public:
@@ -42,6 +46,11 @@ class BaseTrackCache : public QObject {
     // expensive on large tables.
     virtual void buildIndex();
 
+    // Searches the database through the full-text index ftsTable, whose docids
+    // are the track ids, instead of with LIKE. See
+    // SearchQueryParser::setFullTextTable().
+    void setFullTextTable(const QString& ftsTable);
+
     ////////////////////////////////////////////////////////////////////////////
     // Data access methods
     ////////////////////////////////////////////////////////////////////////////
@@ -72,6 +81,7 @@ class BaseTrackCache : public QObject {
   private:
     TrackPointer lookupCachedTrack(int trackId) const;
     bool updateIndexWithQuery(const QString& query);
+    bool updateIndexWithTrackIds(const QSet<int>& trackIds);
     bool updateIndexWithTrackpointer(TrackPointer pTrack);
     void updateTrackInIndex(int trackId);
     void updateTracksInIndex(QSet<int> trackIds);
@@ -80,6 +90,15 @@ class BaseTrackCache : public QObject {
 
     QueryNode* parseQuery(QString query, QString extraFilter,
                           QStringList idStrings) const;
+    // Fill pTrackOrder with the tracks that match pQuery in sort order. A
+    // NULL pQuery in filterAndSortInIndex() matches all tracks.
+    void filterAndSortInIndex(const QSet<int>& trackIds,
+                              const QueryNode* pQuery,
+                              int sortColumn, Qt::SortOrder sortOrder,
+                              QVector<int>* pTrackOrder);
+    void filterAndSortInDatabase(const QueryNode* pQuery,
+                                 int sortColumn, Qt::SortOrder sortOrder,
+                                 QVector<int>* pTrackOrder) const;
     QString orderByClause(int sortColumn, Qt::SortOrder sortOrder) const;
     int findSortInsertionPoint(TrackPointer pTrack,
                                const int sortColumn,
@@ -113,7 +132,7 @@ class BaseTrackCache : public QObject {
 
     bool m_bIndexBuilt;
     bool m_bIsCaching;
-    QHash<int, QVector<QVariant> > m_trackInfo;
+    ColumnarTrackIndex m_index;
     TrackDAO& m_trackDAO;
     QSqlDatabase m_database;
     SearchQueryParser* m_pQueryParser;
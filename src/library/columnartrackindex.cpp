@@ -0,0 +1,383 @@
+#include <algorithm>
+
+#include "library/columnartrackindex.h"
+
+namespace {
+
+struct SortKey {
+    // 0 for NULL, 1 for numbers and 2 for text, like SQLite.
+    int type;
+    double number;
+    QString text;
+};
+
+// Parses the leading integer of text like SQLite's cast(text as integer).
+int leadingInteger(const QString& text) {
+    int i = 0;
+    while (i < text.size() && text[i].isSpace()) {
+        ++i;
+    }
+    bool negative = false;
+    if (i < text.size() && (text[i] == '-' || text[i] == '+')) {
+        negative = text[i] == '-';
+        ++i;
+    }
+    int result = 0;
+    while (i < text.size() && text[i].isDigit()) {
+        result = result * 10 + text[i].digitValue();
+        ++i;
+    }
+    return negative ? -result : result;
+}
+
+void makeSortKey(const QVariant& value, bool sortAsInteger,
+                 const QString* pLowerText, SortKey* pKey) {
+    if (value.isNull()) {
+        pKey->type = 0;
+        return;
+    }
+    if (sortAsInteger) {
+        pKey->type = 1;
+        pKey->number = leadingInteger(value.toString());
+        return;
+    }
+    switch (value.userType()) {
+        case QMetaType::Bool:
+        case QMetaType::Int:
+        case QMetaType::UInt:
+        case QMetaType::LongLong:
+        case QMetaType::ULongLong:
+        case QMetaType::Double:
+        case QMetaType::Float:
+            pKey->type = 1;
+            pKey->number = value.toDouble();
+            break;
+        default:
+            pKey->type = 2;
+            pKey->text = pLowerText ? *pLowerText : value.toString().toLower();
+            break;
+    }
+}
+
+// Returns <0, 0 or >0 if key1 sorts before, like or after key2.
+int compareSortKeys(const SortKey& key1, const SortKey& key2) {
+    if (key1.type != key2.type) {
+        return key1.type - key2.type;
+    }
+    if (key1.type == 1) {
+        return key1.number < key2.number ? -1 :
+                (key1.number > key2.number ? 1 : 0);
+    }
+    if (key1.type == 2) {
+        return key1.text.compare(key2.text);
+    }
+    return 0;
+}
+
+// Orders rows by their precomputed keys. Rows with equal keys are kept in row
+// order so that the order is deterministic.
+class RowKeyLessThan {
+  public:
+    explicit RowKeyLessThan(const QVector<SortKey>& keys)
+            : m_keys(keys) {
+    }
+
+    bool operator()(int row1, int row2) const {
+        int result = compareSortKeys(m_keys[row1], m_keys[row2]);
+        return result < 0 || (result == 0 && row1 < row2);
+    }
+
+  private:
+    const QVector<SortKey>& m_keys;
+};
+
+}  // namespace
+
+ColumnarTrackIndex::ColumnarTrackIndex(const QStringList& columns,
+                                       const QStringList& textColumns)
+        : m_columns(columns),
+          m_textColumn(columns.size(), -1),
+          m_sortAsInteger(columns.size(), false),
+          m_values(columns.size()),
+          m_bTrigramsBuilt(false),
+          m_iOutdatedTrigramRows(0) {
+    for (int i = 0; i < columns.size(); ++i) {
+        m_columnIndices[columns[i]] = i;
+    }
+    foreach (const QString& textColumn, textColumns) {
+        int column = columnIndex(textColumn);
+        if (column >= 0 && m_textColumn[column] < 0) {
+            m_textColumn[column] = m_lowerText.size();
+            m_lowerText.append(QVector<QString>());
+        }
+    }
+}
+
+ColumnarTrackIndex::~ColumnarTrackIndex() {
+}
+
+void ColumnarTrackIndex::clear() {
+    for (int i = 0; i < m_values.size(); ++i) {
+        m_values[i].clear();
+    }
+    for (int i = 0; i < m_lowerText.size(); ++i) {
+        m_lowerText[i].clear();
+    }
+    m_trackIds.clear();
+    m_rowForTrackId.clear();
+    m_freeRows.clear();
+    m_trigrams.clear();
+    m_bTrigramsBuilt = false;
+    m_iOutdatedTrigramRows = 0;
+    m_sortedRows.clear();
+}
+
+void ColumnarTrackIndex::updateTrack(int trackId,
+                                     const QVector<QVariant>& values) {
+    int row = rowForTrackId(trackId);
+    if (row < 0) {
+        if (m_freeRows.isEmpty()) {
+            row = m_trackIds.size();
+            m_trackIds.append(trackId);
+            for (int i = 0; i < m_values.size(); ++i) {
+                m_values[i].append(QVariant());
+            }
+            for (int i = 0; i < m_lowerText.size(); ++i) {
+                m_lowerText[i].append(QString());
+            }
+        } else {
+            row = m_freeRows.last();
+            m_freeRows.remove(m_freeRows.size() - 1);
+            m_trackIds[row] = trackId;
+        }
+        m_rowForTrackId.insert(trackId, row);
+    } else if (m_bTrigramsBuilt) {
+        // The trigrams of the old values stay in the index.
+        ++m_iOutdatedTrigramRows;
+    }
+
+    setRowValues(row, values);
+    rowChanged(row);
+    if (m_bTrigramsBuilt) {
+        addTrigrams(row);
+    }
+}
+
+void ColumnarTrackIndex::removeTrack(int trackId) {
+    int row = rowForTrackId(trackId);
+    if (row < 0) {
+        return;
+    }
+    m_rowForTrackId.remove(trackId);
+    m_trackIds[row] = -1;
+    setRowValues(row, QVector<QVariant>());
+    m_freeRows.append(row);
+    rowChanged(row);
+    if (m_bTrigramsBuilt) {
+        ++m_iOutdatedTrigramRows;
+    }
+}
+
+QVector<QVariant> ColumnarTrackIndex::trackValues(int trackId) const {
+    QVector<QVariant> values;
+    int row = rowForTrackId(trackId);
+    if (row >= 0) {
+        values.resize(m_values.size());
+        for (int i = 0; i < m_values.size(); ++i) {
+            values[i] = m_values[i][row];
+        }
+    }
+    return values;
+}
+
+void ColumnarTrackIndex::setRowValues(int row,
+                                      const QVector<QVariant>& values) {
+    for (int i = 0; i < m_values.size(); ++i) {
+        const QVariant value = values.value(i);
+        m_values[i][row] = value;
+        if (m_textColumn[i] >= 0) {
+            m_lowerText[m_textColumn[i]][row] = value.toString().toLower();
+        }
+    }
+}
+
+bool ColumnarTrackIndex::textContains(int row, int column,
+                                      const QString& lowerText) const {
+    if (m_textColumn[column] >= 0) {
+        return m_lowerText[m_textColumn[column]][row].contains(lowerText);
+    }
+    const QVariant& value = m_values[column][row];
+    if (!value.isValid() || !qVariantCanConvert<QString>(value)) {
+        return false;
+    }
+    return value.toString().contains(lowerText, Qt::CaseInsensitive);
+}
+
+void ColumnarTrackIndex::addTrigrams(int row) {
+    QVector<quint64> trigrams;
+    for (int i = 0; i < m_lowerText.size(); ++i) {
+        const QString& text = m_lowerText[i][row];
+        for (int j = 0; j + kTrigramLength <= text.size(); ++j) {
+            trigrams.append(trigram(text.constData() + j));
+        }
+    }
+    std::sort(trigrams.begin(), trigrams.end());
+    QVector<quint64>::iterator end =
+            std::unique(trigrams.begin(), trigrams.end());
+    for (QVector<quint64>::iterator it = trigrams.begin(); it != end; ++it) {
+        m_trigrams[*it].append(row);
+    }
+}
+
+void ColumnarTrackIndex::buildTrigrams() {
+    m_trigrams.clear();
+    for (int row = 0; row < m_trackIds.size(); ++row) {
+        if (m_trackIds[row] >= 0) {
+            addTrigrams(row);
+        }
+    }
+    m_bTrigramsBuilt = true;
+    m_iOutdatedTrigramRows = 0;
+}
+
+bool ColumnarTrackIndex::textCandidates(const QString& lowerText,
+                                        QVector<int>* pRows) {
+    if (lowerText.size() < kTrigramLength) {
+        return false;
+    }
+    if (!m_bTrigramsBuilt || m_iOutdatedTrigramRows > size()) {
+        buildTrigrams();
+    }
+
+    pRows->clear();
+    const QVector<int>* pRarest = NULL;
+    for (int i = 0; i + kTrigramLength <= lowerText.size(); ++i) {
+        QHash<quint64, QVector<int> >::const_iterator it =
+                m_trigrams.constFind(trigram(lowerText.constData() + i));
+        if (it == m_trigrams.constEnd()) {
+            // No row contains this trigram.
+            return true;
+        }
+        if (pRarest == NULL || it.value().size() < pRarest->size()) {
+            pRarest = &it.value();
+        }
+    }
+
+    pRows->reserve(pRarest->size());
+    foreach (int row, *pRarest) {
+        if (m_trackIds[row] >= 0) {
+            pRows->append(row);
+        }
+    }
+    if (m_iOutdatedTrigramRows > 0) {
+        // Changed rows may have been appended more than once.
+        std::sort(pRows->begin(), pRows->end());
+        pRows->resize(std::unique(pRows->begin(), pRows->end()) -
+                      pRows->begin());
+    }
+    return true;
+}
+
+void ColumnarTrackIndex::setSortAsInteger(int column) {
+    if (column >= 0 && column < m_sortAsInteger.size()) {
+        m_sortAsInteger[column] = true;
+        m_sortedRows.remove(column);
+    }
+}
+
+void ColumnarTrackIndex::rowChanged(int row) {
+    QMutableHashIterator<int, SortedRows> it(m_sortedRows);
+    while (it.hasNext()) {
+        SortedRows& sorted = it.next().value();
+        if (sorted.changedRows.size() >= kMaxChangedSortedRows) {
+            // Sorting again is cheaper than updating this many rows.
+            it.remove();
+        } else {
+            sorted.changedRows.append(row);
+        }
+    }
+}
+
+bool ColumnarTrackIndex::rowLessThan(int column, int row1, int row2) const {
+    const int textColumn = m_textColumn[column];
+    SortKey key1;
+    SortKey key2;
+    makeSortKey(m_values[column][row1], m_sortAsInteger[column],
+                textColumn >= 0 ? &m_lowerText[textColumn][row1] : NULL,
+                &key1);
+    makeSortKey(m_values[column][row2], m_sortAsInteger[column],
+                textColumn >= 0 ? &m_lowerText[textColumn][row2] : NULL,
+                &key2);
+    int result = compareSortKeys(key1, key2);
+    return result < 0 || (result == 0 && row1 < row2);
+}
+
+void ColumnarTrackIndex::buildSortedRows(int column,
+                                         SortedRows* pSorted) const {
+    const int textColumn = m_textColumn[column];
+    QVector<SortKey> keys(m_trackIds.size());
+    pSorted->rows.clear();
+    pSorted->rows.reserve(size());
+    pSorted->changedRows.clear();
+    for (int row = 0; row < m_trackIds.size(); ++row) {
+        if (m_trackIds[row] < 0) {
+            continue;
+        }
+        makeSortKey(m_values[column][row], m_sortAsInteger[column],
+                    textColumn >= 0 ? &m_lowerText[textColumn][row] : NULL,
+                    &keys[row]);
+        pSorted->rows.append(row);
+    }
+    std::sort(pSorted->rows.begin(), pSorted->rows.end(),
+              RowKeyLessThan(keys));
+}
+
+void ColumnarTrackIndex::updateSortedRows(int column,
+                                          SortedRows* pSorted) const {
+    QVector<int>& rows = pSorted->rows;
+    QVector<bool> changed(m_trackIds.size(), false);
+    foreach (int row, pSorted->changedRows) {
+        changed[row] = true;
+    }
+
+    // Remove the changed rows in one pass, then insert the ones that are
+    // still live where they belong now.
+    int kept = 0;
+    for (int i = 0; i < rows.size(); ++i) {
+        if (!changed[rows[i]]) {
+            rows[kept++] = rows[i];
+        }
+    }
+    rows.resize(kept);
+
+    foreach (int row, pSorted->changedRows) {
+        if (!changed[row] || m_trackIds[row] < 0) {
+            continue;
+        }
+        // Insert each row only once even if it changed several times.
+        changed[row] = false;
+        int min = 0;
+        int max = rows.size();
+        while (min < max) {
+            int mid = min + (max - min) / 2;
+            if (rowLessThan(column, rows[mid], row)) {
+                min = mid + 1;
+            } else {
+                max = mid;
+            }
+        }
+        rows.insert(min, row);
+    }
+    pSorted->changedRows.clear();
+}
+
+const QVector<int>& ColumnarTrackIndex::sortedRows(int column) {
+    QHash<int, SortedRows>::iterator it = m_sortedRows.find(column);
+    if (it == m_sortedRows.end()) {
+        it = m_sortedRows.insert(column, SortedRows());
+        buildSortedRows(column, &it.value());
+    } else if (!it.value().changedRows.isEmpty()) {
+        updateSortedRows(column, &it.value());
+    }
+    return it.value().rows;
+}
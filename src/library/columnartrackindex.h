@@ -0,0 +1,155 @@
+#ifndef COLUMNARTRACKINDEX_H
+#define COLUMNARTRACKINDEX_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+
+#include "util.h"
+
+// ColumnarTrackIndex keeps the values of a table of tracks in memory so that
+// it can be searched and sorted without querying the database. The values are
+// stored column by column, one row per track. Rows of removed tracks are
+// reused for new tracks.
+//
+// The text columns are additionally kept in lowercase, and their trigrams are
+// indexed so that a substring search only has to look at the rows that contain
+// the rarest trigram of the search term. For every column that is sorted by, a
+// permutation of the rows in ascending order is kept and updated as tracks
+// change.
+class ColumnarTrackIndex {
+  public:
+    // textColumns are the columns that are searched as text. Columns that are
+    // not in columns are ignored.
+    ColumnarTrackIndex(const QStringList& columns,
+                       const QStringList& textColumns);
+    virtual ~ColumnarTrackIndex();
+
+    void clear();
+
+    // The number of tracks in the index.
+    int size() const {
+        return m_rowForTrackId.size();
+    }
+    // The number of rows, including the rows of removed tracks.
+    int rowCount() const {
+        return m_trackIds.size();
+    }
+    int columnCount() const {
+        return m_columns.size();
+    }
+    // Returns the index of the named column or -1 if there is no such column.
+    int columnIndex(const QString& column) const {
+        return m_columnIndices.value(column, -1);
+    }
+
+    bool contains(int trackId) const {
+        return m_rowForTrackId.contains(trackId);
+    }
+    // Returns the row of trackId or -1 if it is not in the index.
+    int rowForTrackId(int trackId) const {
+        return m_rowForTrackId.value(trackId, -1);
+    }
+    // Returns the track of row or -1 if its track was removed.
+    int trackIdForRow(int row) const {
+        return m_trackIds[row];
+    }
+
+    // Inserts trackId or replaces its values. values holds the values of all
+    // columns in order.
+    void updateTrack(int trackId, const QVector<QVariant>& values);
+    void removeTrack(int trackId);
+
+    QVariant value(int row, int column) const {
+        return m_values[column][row];
+    }
+    // Returns the values of all columns of trackId or an empty vector if it
+    // is not in the index.
+    QVector<QVariant> trackValues(int trackId) const;
+
+    // Returns whether column of row contains lowerText, which must be in
+    // lowercase.
+    bool textContains(int row, int column, const QString& lowerText) const;
+
+    // Returns whether column is a text column and indexed by trigrams.
+    bool isTextIndexed(int column) const {
+        return column >= 0 && column < m_textColumn.size() &&
+                m_textColumn[column] >= 0;
+    }
+
+    // Stores a superset of the rows whose text columns contain lowerText into
+    // pRows, without duplicates. Returns false if lowerText is too short to be
+    // looked up, in which case all rows have to be searched.
+    bool textCandidates(const QString& lowerText, QVector<int>* pRows);
+
+    // Sorts the values of column by their leading integer, like SQLite's
+    // cast(... as integer). Used for track numbers, which are stored as text.
+    void setSortAsInteger(int column);
+
+    // Returns all rows sorted ascending by column. Values are ordered like
+    // SQLite orders them: NULL first, then numbers and then text, which is
+    // compared case-insensitively.
+    const QVector<int>& sortedRows(int column);
+
+  private:
+    enum {
+        kTrigramLength = 3,
+        // Sorted rows are updated in place for up to this many changed rows.
+        // Beyond that they are sorted again.
+        kMaxChangedSortedRows = 64,
+    };
+
+    struct SortedRows {
+        // Live rows in ascending order, except for the rows in changedRows.
+        QVector<int> rows;
+        // Rows whose values changed since rows was last updated.
+        QVector<int> changedRows;
+    };
+
+    void setRowValues(int row, const QVector<QVariant>& values);
+    void rowChanged(int row);
+    void addTrigrams(int row);
+    void buildTrigrams();
+
+    bool rowLessThan(int column, int row1, int row2) const;
+    void buildSortedRows(int column, SortedRows* pSorted) const;
+    void updateSortedRows(int column, SortedRows* pSorted) const;
+
+    static quint64 trigram(const QChar* pText) {
+        return (static_cast<quint64>(pText[0].unicode()) << 32) |
+                (static_cast<quint64>(pText[1].unicode()) << 16) |
+                static_cast<quint64>(pText[2].unicode());
+    }
+
+    QStringList m_columns;
+    QHash<QString, int> m_columnIndices;
+    // For each column its index into m_lowerText or -1.
+    QVector<int> m_textColumn;
+    QVector<bool> m_sortAsInteger;
+
+    // The values, one vector per column and one entry per row.
+    QVector<QVector<QVariant> > m_values;
+    // The lowercased values of the text columns.
+    QVector<QVector<QString> > m_lowerText;
+
+    QVector<int> m_trackIds;
+    QHash<int, int> m_rowForTrackId;
+    QVector<int> m_freeRows;
+
+    // The rows that contain each trigram of the text columns. Built on the
+    // first search. Rows are appended when they change and never removed, so
+    // the lists may contain rows that no longer match and may be unsorted.
+    // They are rebuilt once there are more outdated entries than rows.
+    QHash<quint64, QVector<int> > m_trigrams;
+    bool m_bTrigramsBuilt;
+    int m_iOutdatedTrigramRows;
+
+    // The sorted rows of the columns that have been sorted by.
+    QHash<int, SortedRows> m_sortedRows;
+
+    DISALLOW_COPY_AND_ASSIGN(ColumnarTrackIndex);
+};
+
+#endif /* COLUMNARTRACKINDEX_H */
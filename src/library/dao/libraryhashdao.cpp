@@ -44,13 +44,15 @@ int LibraryHashDAO::getDirectoryHash(const QString& dirPath) {
     return hash;
 }
 
-void LibraryHashDAO::saveDirectoryHash(const QString& dirPath, const int hash) {
+void LibraryHashDAO::saveDirectoryHash(const QString& dirPath, const int hash,
+                                       const uint mtime) {
     //qDebug() << "LibraryHashDAO::saveDirectoryHash" << QThread::currentThread() << m_database.connectionName();
     QSqlQuery query(m_database);
-    query.prepare("INSERT INTO LibraryHashes (directory_path, hash, directory_deleted) "
-                    "VALUES (:directory_path, :hash, :directory_deleted)");
+    query.prepare("INSERT INTO LibraryHashes (directory_path, hash, directory_mtime, directory_deleted) "
+                    "VALUES (:directory_path, :hash, :directory_mtime, :directory_deleted)");
     query.bindValue(":directory_path", dirPath);
     query.bindValue(":hash", hash);
+    query.bindValue(":directory_mtime", mtime);
     query.bindValue(":directory_deleted", 0);
 
 
@@ -60,13 +62,16 @@ void LibraryHashDAO::saveDirectoryHash(const QString& dirPath, const int hash) {
     //qDebug() << "created new hash" << hash;
 }
 
-void LibraryHashDAO::updateDirectoryHash(const QString& dirPath, const int newHash, const int dir_deleted) {
+void LibraryHashDAO::updateDirectoryHash(const QString& dirPath, const int newHash,
+                                         const uint mtime, const int dir_deleted) {
     //qDebug() << "LibraryHashDAO::updateDirectoryHash" << QThread::currentThread() << m_database.connectionName();
     QSqlQuery query(m_database);
     query.prepare("UPDATE LibraryHashes "
-            "SET hash=:hash, directory_deleted=:directory_deleted "
+            "SET hash=:hash, directory_mtime=:directory_mtime, "
+            "directory_deleted=:directory_deleted "
             "WHERE directory_path=:directory_path");
     query.bindValue(":hash", newHash);
+    query.bindValue(":directory_mtime", mtime);
     query.bindValue(":directory_deleted", dir_deleted);
     query.bindValue(":directory_path", dirPath);
 
@@ -79,6 +84,71 @@ void LibraryHashDAO::updateDirectoryHash(const QString& dirPath, const int newHa
     //qDebug() << getDirectoryHash(dirPath);
 }
 
+void LibraryHashDAO::updateDirectoryMtime(const QString& dirPath, const uint mtime) {
+    QSqlQuery query(m_database);
+    query.prepare("UPDATE LibraryHashes "
+                  "SET directory_mtime=:directory_mtime "
+                  "WHERE directory_path=:directory_path");
+    query.bindValue(":directory_mtime", mtime);
+    query.bindValue(":directory_path", dirPath);
+    if (!query.exec()) {
+        LOG_FAILED_QUERY(query) << "Updating directory mtime failed.";
+    }
+}
+
+QHash<QString, LibraryHashDAO::DirectoryHash> LibraryHashDAO::getDirectoryHashes() {
+    QHash<QString, DirectoryHash> hashes;
+    QSqlQuery query(m_database);
+    query.prepare("SELECT directory_path, hash, directory_mtime FROM LibraryHashes "
+                  "WHERE directory_deleted=0");
+    if (!query.exec()) {
+        LOG_FAILED_QUERY(query) << "SELECT hashes failed:";
+        return hashes;
+    }
+    const int pathColumn = query.record().indexOf("directory_path");
+    const int hashColumn = query.record().indexOf("hash");
+    const int mtimeColumn = query.record().indexOf("directory_mtime");
+    while (query.next()) {
+        DirectoryHash directoryHash;
+        directoryHash.hash = query.value(hashColumn).toInt();
+        directoryHash.mtime = query.value(mtimeColumn).toUInt();
+        hashes.insert(query.value(pathColumn).toString(), directoryHash);
+    }
+    return hashes;
+}
+
+void LibraryHashDAO::invalidateDirectoryMtimes(QStringList dirPaths) {
+    if (dirPaths.isEmpty()) {
+        return;
+    }
+    FieldEscaper escaper(m_database);
+    QMutableStringListIterator it(dirPaths);
+    while (it.hasNext()) {
+        it.setValue(escaper.escapeString(it.next()));
+    }
+
+    QSqlQuery query(m_database);
+    query.prepare(
+        QString("UPDATE LibraryHashes "
+                "SET directory_mtime=0 "
+                "WHERE directory_path IN (%1)")
+        .arg(dirPaths.join(",")));
+    if (!query.exec()) {
+        LOG_FAILED_QUERY(query) << "Invalidating directory mtimes failed.";
+    }
+}
+
+bool LibraryHashDAO::hasInvalidatedDirectoryMtimes() {
+    QSqlQuery query(m_database);
+    query.prepare("SELECT 1 FROM LibraryHashes "
+                  "WHERE directory_mtime=0 AND directory_deleted=0 LIMIT 1");
+    if (!query.exec()) {
+        LOG_FAILED_QUERY(query);
+        return false;
+    }
+    return query.next();
+}
+
 void LibraryHashDAO::updateDirectoryStatuses(QStringList dirPaths, const bool deleted, const bool verified) {
     //qDebug() << "LibraryHashDAO::updateDirectoryStatus" << QThread::currentThread() << m_database.connectionName();
     FieldEscaper escaper(m_database);
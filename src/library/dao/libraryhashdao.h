@@ -1,20 +1,38 @@
 #ifndef LIBRARYHASHDAO_H
 #define LIBRARYHASHDAO_H
 
+#include <QHash>
 #include <QObject>
 #include <QSqlDatabase>
+#include <QStringList>
 #include "library/dao/dao.h"
 
 class LibraryHashDAO : public DAO {
   public:
+    // The stored hash of a directory and the modification time it had when it
+    // was hashed. An mtime of 0 means unknown, i.e. the directory has to be
+    // hashed again on the next incremental scan.
+    struct DirectoryHash {
+        int hash;
+        uint mtime;
+    };
+
     LibraryHashDAO(QSqlDatabase& database);
     virtual ~LibraryHashDAO();
     void setDatabase(QSqlDatabase& database) { m_database = database; };
 
     void initialize();
     int getDirectoryHash(const QString& dirPath);
-    void saveDirectoryHash(const QString& dirPath, const int hash);
-    void updateDirectoryHash(const QString& dirPath, const int newHash, const int dir_deleted);
+    void saveDirectoryHash(const QString& dirPath, const int hash, const uint mtime);
+    void updateDirectoryHash(const QString& dirPath, const int newHash, const uint mtime,
+                             const int dir_deleted);
+    void updateDirectoryMtime(const QString& dirPath, const uint mtime);
+    // Returns the hashes of all directories that are not deleted.
+    QHash<QString, DirectoryHash> getDirectoryHashes();
+    // Records that the directories changed, so that an incremental scan
+    // hashes them again.
+    void invalidateDirectoryMtimes(QStringList dirPaths);
+    bool hasInvalidatedDirectoryMtimes();
     void markAsExisting(const QString& dirPath);
     void markAsVerified(const QString& dirPath);
     //void markAllDirectoriesAsDeleted();
@@ -52,7 +52,8 @@ TrackDAO::TrackDAO(QSqlDatabase& database,
           m_pTransaction(NULL),
           m_trackLocationIdColumn(UndefinedRecordIndex),
           m_queryLibraryIdColumn(UndefinedRecordIndex),
-          m_queryLibraryMixxxDeletedColumn(UndefinedRecordIndex) {
+          m_queryLibraryMixxxDeletedColumn(UndefinedRecordIndex),
+          m_bFullTextIndex(false) {
 }
 
 TrackDAO::~TrackDAO() {
@@ -94,6 +95,18 @@ void TrackDAO::finish() {
 
 void TrackDAO::initialize() {
     qDebug() << "TrackDAO::initialize" << QThread::currentThread() << m_database.connectionName();
+
+    // The schema revision that creates the full-text index is skipped if the
+    // SQLite library lacks FTS4 or the unicode61 tokenizer.
+    QSqlQuery query(m_database);
+    query.prepare("SELECT name FROM sqlite_master WHERE name = :name");
+    query.bindValue(":name", LIBRARY_FTS_TABLE);
+    if (!query.exec()) {
+        LOG_FAILED_QUERY(query);
+    }
+    m_bFullTextIndex = query.next();
+    qDebug() << "TrackDAO::initialize full-text index"
+             << (m_bFullTextIndex ? "available" : "not available");
 }
 
 /** Retrieve the track id for the track that's located at "location" on disk.
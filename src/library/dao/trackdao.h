@@ -17,6 +17,9 @@
 #include "util.h"
 
 #define LIBRARY_TABLE "library"
+// The full-text index of the library's text columns, keyed by library.id. Only
+// exists if the SQLite Mixxx uses supports FTS4 with the unicode61 tokenizer.
+#define LIBRARY_FTS_TABLE "library_fts"
 
 const QString LIBRARYTABLE_ID = "id";
 const QString LIBRARYTABLE_ARTIST = "artist";
@@ -81,6 +84,10 @@ class TrackDAO : public QObject, public virtual DAO {
     void setDatabase(QSqlDatabase& database) { m_database = database; }
 
     void initialize();
+    // Returns whether the library has a full-text index in LIBRARY_FTS_TABLE.
+    bool hasFullTextIndex() const {
+        return m_bFullTextIndex;
+    }
     int getTrackId(const QString& absoluteFilePath);
     QList<int> getTrackIds(const QList<QFileInfo>& files);
     bool trackExistsInDatabase(const QString& absoluteFilePath);
@@ -173,6 +180,7 @@ class TrackDAO : public QObject, public virtual DAO {
     int m_trackLocationIdColumn;
     int m_queryLibraryIdColumn;
     int m_queryLibraryMixxxDeletedColumn;
+    bool m_bFullTextIndex;
 
     QSet<int> m_tracksAddedSet;
 
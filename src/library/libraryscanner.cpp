@@ -16,11 +16,12 @@
 ***************************************************************************/
 
 #include <QtDebug>
+#include <QDateTime>
 #include <QDesktopServices>
-#include <QLinkedList>
 
 #include "soundsourceproxy.h"
 #include "library/legacylibraryimporter.h"
+#include "library/librarywatcher.h"
 #include "libraryscanner.h"
 #include "libraryscannerdlg.h"
 #include "library/queryutil.h"
@@ -28,6 +29,49 @@
 #include "util/trace.h"
 #include "util/file.h"
 
+namespace {
+
+// The number of listed directories the DirectoryWalker may be ahead.
+const int kDirectoryQueueSize = 64;
+// The number of tracks that are requested but not added yet. The parsed
+// track queue has room for all of them, so the parsers never block on it.
+const int kMaxTracksInFlight = 256;
+
+// Directory modification times are stored in seconds. A directory that
+// changes within the second it was listed in would look unchanged, so more
+// recent modification times are not trusted.
+const uint kMtimeSettleSeconds = 2;
+
+int metadataParserCount() {
+    return qBound(2, QThread::idealThreadCount(), 8);
+}
+
+// Returns the modification time of the directory at path in seconds, or 0 if
+// it is unknown or too recent.
+uint directoryMtime(const QString& path) {
+    QFileInfo info(path);
+    if (!info.exists()) {
+        return 0;
+    }
+    const uint mtime = info.lastModified().toTime_t();
+    if (mtime == static_cast<uint>(-1) ||
+            mtime + kMtimeSettleSeconds >= QDateTime::currentDateTime().toTime_t()) {
+        return 0;
+    }
+    return mtime;
+}
+
+}  // namespace
+
+LibraryScanner::Pipeline::Pipeline()
+        : incremental(false),
+          directories(kDirectoryQueueSize),
+          parseRequests(kMaxTracksInFlight),
+          parsedTracks(kMaxTracksInFlight),
+          nextDirectoryId(0),
+          tracksInFlight(0) {
+}
+
 LibraryScanner::LibraryScanner(TrackCollection* collection)
               : m_pCollection(collection),
                 m_pProgress(NULL),
@@ -43,9 +87,14 @@ LibraryScanner::LibraryScanner(TrackCollection* collection)
                 // conn is in the right thread.
                 m_extensionFilter(SoundSourceProxy::supportedFileExtensionsRegex(),
                                   Qt::CaseInsensitive),
-                m_bCancelLibraryScan(false) {
+                m_bCancelLibraryScan(false),
+                m_bIncremental(false),
+                m_pWatcher(new LibraryWatcher(collection, this)) {
     qDebug() << "Constructed LibraryScanner";
 
+    connect(this, SIGNAL(scanFinished()),
+            m_pWatcher, SLOT(slotScanFinished()));
+
     // Force the GUI thread's TrackInfoObject cache to be cleared when a library
     // scan is finished, because we might have modified the database directly
     // when we detected moved files, and the TIOs corresponding to the moved
@@ -82,6 +131,10 @@ LibraryScanner::~LibraryScanner() {
         wait(); // Wait for thread to finish
     }
 
+    // Journal the directories that changed since the last scan, so that
+    // the next incremental scan hashes them.
+    m_pWatcher->flush();
+
     // Do housekeeping on the LibraryHashes table.
     ScopedTransaction transaction(m_pCollection->getDatabase());
 
@@ -221,23 +274,15 @@ void LibraryScanner::run() {
     m_trackDao.addTracksPrepare();
 
     QStringList verifiedDirectories;
+    QHash<QString, uint> directoryMtimes;
     QStringList dirs = m_directoryDao.getDirs();
-    bool bScanFinishedCleanly = false;
     // Recursivly scan each directory in the directories table.
-    foreach (const QString& dirPath, dirs) {
-        // Acquire a security bookmark for this directory if we are in a
-        // sandbox. For speed we avoid opening security bookmarks when recursive
-        // scanning so that relies on having an open bookmark for the containing
-        // directory.
-        MDir dir(dirPath);
-
-        bScanFinishedCleanly = recursiveScan(dirPath, verifiedDirectories,
-                                             dir.token());
-        if (bScanFinishedCleanly) {
-            qDebug() << "Recursive scanning (" << dirPath << ") finished cleanly.";
-        } else {
-            qDebug() << "Recursive scanning (" << dirPath << ") interrupted.";
-        }
+    bool bScanFinishedCleanly = scanDirectories(dirs, verifiedDirectories,
+                                                directoryMtimes, m_bIncremental);
+    if (bScanFinishedCleanly) {
+        qDebug() << "Recursive scanning finished cleanly.";
+    } else {
+        qDebug() << "Recursive scanning interrupted.";
     }
 
     // After the recursive scan of all watched library directories there are
@@ -269,6 +314,13 @@ void LibraryScanner::run() {
         m_libraryHashDao.updateDirectoryStatuses(verifiedDirectories, false, true);
         m_trackDao.markTracksInDirectoriesAsVerified(verifiedDirectories);
 
+        // Every sub-directory was scanned, so the next incremental scan can
+        // trust the stored sub-directories of the hashed directories.
+        QHash<QString, uint>::const_iterator it = directoryMtimes.constBegin();
+        for (; it != directoryMtimes.constEnd(); ++it) {
+            m_libraryHashDao.updateDirectoryMtime(it.key(), it.value());
+        }
+
         qDebug() << "Marking unverified tracks as deleted.";
         m_trackDao.markUnverifiedTracksAsDeleted();
         qDebug() << "Marking unverified directories as deleted.";
@@ -303,7 +355,8 @@ void LibraryScanner::run() {
     emit(scanFinished());
 }
 
-void LibraryScanner::scan(QWidget* parent) {
+void LibraryScanner::scan(QWidget* parent, bool incremental) {
+    m_bIncremental = incremental;
     m_pProgress = new LibraryScannerDlg(parent);
     m_pProgress->setAttribute(Qt::WA_DeleteOnClose);
 
@@ -326,9 +379,20 @@ void LibraryScanner::scan(QWidget* parent) {
             this, SLOT(cancel()));
     connect(&m_trackDao, SIGNAL(progressVerifyTracksOutside(QString)),
             m_pProgress, SLOT(slotUpdate(QString)));
+    m_pWatcher->scanStarted();
     start();
 }
 
+void LibraryScanner::scanForTest(bool incremental) {
+    m_bIncremental = incremental;
+    run();
+}
+
+bool LibraryScanner::hasJournaledChanges() {
+    LibraryHashDAO libraryHashDao(m_pCollection->getDatabase());
+    return libraryHashDao.hasInvalidatedDirectoryMtimes();
+}
+
 void LibraryScanner::cancel() {
     m_bCancelLibraryScan = true;
 }
@@ -337,97 +401,108 @@ void LibraryScanner::resetCancel() {
     m_bCancelLibraryScan = false;
 }
 
-bool LibraryScanner::recursiveScan(const QDir& dir, QStringList& verifiedDirectories,
-                                   SecurityTokenPointer pToken) {
-    QDirIterator it(dir.path(), QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot);
-    QString currentFile;
-    QFileInfo currentFileInfo;
-    QLinkedList<QFileInfo> filesToImport;
-    QLinkedList<QDir> dirsToScan;
-
-    QString newHashStr;
-    bool prevHashExists = false;
-    int newHash = -1;
-    int prevHash = -1;
-    // Note: A hash of "0" is a real hash if the directory contains no files!
-
-    while (it.hasNext()) {
-        currentFile = it.next();
-        currentFileInfo = it.fileInfo();
-
-        if (currentFileInfo.isFile()) {
-            if (m_extensionFilter.indexIn(currentFileInfo.fileName()) != -1) {
-                newHashStr += currentFile;
-                filesToImport.append(currentFileInfo);
-            }
-        } else {
-            // File is a directory. Add it to our list of directories to scan.
-            // Skip the iTunes Album Art Folder since it is probably a waste of
-            // time.
-            if (!m_directoriesBlacklist.contains(currentFile)) {
-                dirsToScan.append(QDir(currentFile));
+bool LibraryScanner::scanDirectories(const QStringList& dirs,
+                                     QStringList& verifiedDirectories,
+                                     QHash<QString, uint>& directoryMtimes,
+                                     bool incremental) {
+    Pipeline pipeline;
+    pipeline.knownDirectories = m_libraryHashDao.getDirectoryHashes();
+    pipeline.incremental = incremental;
+    if (incremental) {
+        QHash<QString, LibraryHashDAO::DirectoryHash>::const_iterator it =
+                pipeline.knownDirectories.constBegin();
+        for (; it != pipeline.knownDirectories.constEnd(); ++it) {
+            const int separator = it.key().lastIndexOf('/');
+            if (separator > 0) {
+                pipeline.knownSubdirectories[it.key().left(separator)]
+                        .append(it.key());
             }
         }
     }
-
-    // Calculate a hash of the directory's file list.
-    newHash = qHash(newHashStr);
-
-    QString dirPath = dir.path();
-    // Try to retrieve a hash from the last time that directory was scanned.
-    prevHash = m_libraryHashDao.getDirectoryHash(dirPath);
-    prevHashExists = prevHash != -1;
-
-    // Compare the hashes, and if they don't match, rescan the files in that directory!
-    if (prevHash != newHash) {
-        // Rescan that mofo! If importing fails then the scan was cancelled so
-        // we return immediately.
-        if (!importFiles(filesToImport, pToken)) {
-            return false;
+    DirectoryWalker walker(this, &pipeline, dirs);
+    QList<MetadataParser*> parsers;
+    for (int i = metadataParserCount(); i > 0; --i) {
+        parsers.append(new MetadataParser(this, &pipeline));
+        parsers.last()->start(QThread::LowPriority);
+    }
+    walker.start(QThread::LowPriority);
+
+    DirectoryListing listing;
+    ParsedTrack parsed;
+    while (!m_bCancelLibraryScan && pipeline.directories.pop(&listing)) {
+        importDirectory(&pipeline, listing, verifiedDirectories);
+        // Add the tracks that are ready without waiting for them.
+        while (!m_bCancelLibraryScan && pipeline.parsedTracks.tryPop(&parsed)) {
+            addParsedTrack(&pipeline, parsed);
         }
+    }
+    // Add the tracks of the last directories.
+    while (!m_bCancelLibraryScan && pipeline.tracksInFlight > 0 &&
+           pipeline.parsedTracks.pop(&parsed)) {
+        addParsedTrack(&pipeline, parsed);
+    }
 
-        // If we didn't know about this directory before...
-        // save the hash after we imported everything in it
-        if (!prevHashExists) {
-            m_libraryHashDao.saveDirectoryHash(dirPath, newHash);
-        } else {
-            // Contents of a known directory have changed. Just need to update
-            // the old hash in the database
-            qDebug() << "old hash was" << prevHash << "and new hash is" << newHash;
-            m_libraryHashDao.updateDirectoryHash(dirPath, newHash, 0);
-        }
-    } else { //prevHash == newHash
-        // Add the directory to the verifiedDirectories list, so that later they
-        // (and the tracks inside them) will be marked as verified
-        emit(progressHashing(dirPath));
-        verifiedDirectories.append(dirPath);
+    // Stop the walker and the parsers. They are already done unless the scan
+    // was cancelled.
+    pipeline.directories.close();
+    pipeline.parseRequests.close();
+    pipeline.parseRequests.clear();
+    pipeline.parsedTracks.close();
+    walker.wait();
+    foreach (MetadataParser* pParser, parsers) {
+        pParser->wait();
+        delete pParser;
     }
+    directoryMtimes = pipeline.directoryMtimes;
+    return !m_bCancelLibraryScan && walker.finished();
+}
 
-    // Let us break out of library directory hashing (the actual file scanning
-    // stuff is in TrackCollection::importDirectory)
-    if (m_bCancelLibraryScan) {
-        return false;
+void LibraryScanner::importDirectory(Pipeline* pPipeline,
+                                     const DirectoryListing& listing,
+                                     QStringList& verifiedDirectories) {
+    if (listing.unchanged) {
+        emit(progressHashing(listing.path));
+        verifiedDirectories.append(listing.path);
+        return;
     }
 
-    // Process all of the sub-directories.
-    foreach (const QDir& nextDir, dirsToScan) {
-        if (!recursiveScan(nextDir, verifiedDirectories, pToken)) {
-            return false;
+    // Try to retrieve a hash from the last time that directory was scanned.
+    // Note: A hash of "0" is a real hash if the directory contains no files!
+    const int prevHash = m_libraryHashDao.getDirectoryHash(listing.path);
+    if (prevHash == listing.hash) {
+        // Add the directory to the verifiedDirectories list, so that later they
+        // (and the tracks inside them) will be marked as verified
+        emit(progressHashing(listing.path));
+        verifiedDirectories.append(listing.path);
+        // Store the modification time the hash was verified for.
+        QHash<QString, LibraryHashDAO::DirectoryHash>::const_iterator known =
+                pPipeline->knownDirectories.constFind(listing.path);
+        if (known == pPipeline->knownDirectories.constEnd() ||
+                known->mtime != listing.mtime) {
+            pPipeline->directoryMtimes.insert(listing.path, listing.mtime);
         }
+        return;
     }
-    return true;
-}
 
-bool LibraryScanner::importFiles(const QLinkedList<QFileInfo>& files,
-                                 SecurityTokenPointer pToken) {
-    foreach (const QFileInfo& file, files) {
+    // Rescan that mofo!
+    const int id = pPipeline->nextDirectoryId++;
+    PendingDirectory pending;
+    pending.path = listing.path;
+    pending.hash = listing.hash;
+    pending.mtime = listing.mtime;
+    pending.prevHashExists = prevHash != -1;
+    pending.remainingTracks = 0;
+    pending.complete = false;
+    pPipeline->pendingDirectories.insert(id, pending);
+
+    foreach (const QFileInfo& file, listing.files) {
         // If a flag was raised telling us to cancel the library scan then stop.
+        // The hash of the directory isn't saved, so it is scanned again.
         if (m_bCancelLibraryScan) {
-            return false;
+            return;
         }
 
         QString filePath = file.filePath();
-        //qDebug() << "TrackCollection::importFiles" << filePath;
 
         // If the track is in the database, mark it as existing. This code gets
         // executed when other files in the same directory have changed (the
@@ -439,31 +514,213 @@ bool LibraryScanner::importFiles(const QLinkedList<QFileInfo>& files,
         // track via "Right-Click -> Remove". These tracks stay in the library,
         // but their mixxx_deleted column is 1.
         if (!m_trackDao.trackExistsInDatabase(filePath)) {
-            emit(progressLoading(file.fileName()));
+            // Make room by adding parsed tracks, which may complete the
+            // pending directories before this one.
+            ParsedTrack parsed;
+            while (pPipeline->tracksInFlight >= kMaxTracksInFlight &&
+                   pPipeline->parsedTracks.pop(&parsed)) {
+                addParsedTrack(pPipeline, parsed);
+            }
 
-            TrackPointer pTrack = TrackPointer(
-                    new TrackInfoObject(filePath, pToken),
-                    &QObject::deleteLater);
-            if (m_trackDao.addTracksAdd(pTrack.data(), false)) {
-                // Successfully added. Signal the main instance of TrackDAO,
-                // that there is a new track in the database.
-                m_pCollection->getTrackDAO().databaseTrackAdded(pTrack);
+            ParseRequest request;
+            request.filePath = filePath;
+            request.directory = id;
+            request.pToken = listing.pToken;
+            if (!pPipeline->parseRequests.push(request)) {
+                return;
+            }
+            ++pPipeline->tracksInFlight;
+            ++pPipeline->pendingDirectories[id].remainingTracks;
+        }
+    }
+
+    PendingDirectory& directory = pPipeline->pendingDirectories[id];
+    directory.complete = true;
+    if (directory.remainingTracks == 0) {
+        saveDirectoryHash(pPipeline, directory);
+        pPipeline->pendingDirectories.remove(id);
+    }
+}
+
+void LibraryScanner::addParsedTrack(Pipeline* pPipeline,
+                                    const ParsedTrack& parsed) {
+    --pPipeline->tracksInFlight;
+
+    const TrackPointer& pTrack = parsed.pTrack;
+    if (pTrack.isNull()) {
+        // The scan was cancelled.
+        return;
+    }
+    emit(progressLoading(pTrack->getFilename()));
+    if (m_trackDao.addTracksAdd(pTrack.data(), false)) {
+        // Successfully added. Signal the main instance of TrackDAO,
+        // that there is a new track in the database.
+        m_pCollection->getTrackDAO().databaseTrackAdded(pTrack);
+    } else {
+        qDebug() << "Track (" + pTrack->getLocation() + ") could not be added";
+    }
+
+    QHash<int, PendingDirectory>::iterator it =
+            pPipeline->pendingDirectories.find(parsed.directory);
+    if (it != pPipeline->pendingDirectories.end() &&
+            --it.value().remainingTracks == 0 && it.value().complete) {
+        saveDirectoryHash(pPipeline, it.value());
+        pPipeline->pendingDirectories.erase(it);
+    }
+}
+
+void LibraryScanner::saveDirectoryHash(Pipeline* pPipeline,
+                                       const PendingDirectory& directory) {
+    // If we didn't know about this directory before...
+    // save the hash after we imported everything in it
+    if (!directory.prevHashExists) {
+        m_libraryHashDao.saveDirectoryHash(directory.path, directory.hash, 0);
+    } else {
+        // Contents of a known directory have changed. Just need to update
+        // the old hash in the database
+        m_libraryHashDao.updateDirectoryHash(directory.path, directory.hash,
+                                             0, 0);
+    }
+    pPipeline->directoryMtimes.insert(directory.path, directory.mtime);
+}
+
+LibraryScanner::DirectoryWalker::DirectoryWalker(LibraryScanner* pScanner,
+                                                 Pipeline* pPipeline,
+                                                 const QStringList& dirs)
+        : m_pScanner(pScanner),
+          m_pPipeline(pPipeline),
+          m_dirs(dirs),
+          m_extensionFilter(pScanner->m_extensionFilter),
+          m_bFinished(false) {
+}
+
+void LibraryScanner::DirectoryWalker::run() {
+    QThread::currentThread()->setObjectName("LibraryScanner DirectoryWalker");
+    bool finished = true;
+    foreach (const QString& dirPath, m_dirs) {
+        // Acquire a security bookmark for this directory if we are in a
+        // sandbox. For speed we avoid opening security bookmarks when recursive
+        // scanning so that relies on having an open bookmark for the containing
+        // directory.
+        MDir dir(dirPath);
+        if (!walk(QDir(dirPath), dir.token())) {
+            finished = false;
+            break;
+        }
+    }
+    m_bFinished = finished;
+    // Let the scanner know that there are no more directories.
+    m_pPipeline->directories.close();
+}
+
+bool LibraryScanner::DirectoryWalker::walk(const QDir& dir,
+                                           SecurityTokenPointer pToken) {
+    DirectoryListing listing;
+    listing.path = dir.path();
+    listing.pToken = pToken;
+    // Take the modification time before listing, so that changes while
+    // listing make the directory look changed next time.
+    listing.mtime = directoryMtime(listing.path);
+    QList<QDir> dirsToScan;
+
+    QHash<QString, LibraryHashDAO::DirectoryHash>::const_iterator known =
+            m_pPipeline->knownDirectories.constFind(listing.path);
+    if (m_pPipeline->incremental && listing.mtime != 0 &&
+            known != m_pPipeline->knownDirectories.constEnd() &&
+            known->mtime == listing.mtime) {
+        // No entry of the directory was added, removed or renamed since it
+        // was hashed, so its sub-directories are the known ones.
+        listing.hash = known->hash;
+        listing.unchanged = true;
+        foreach (const QString& subdirectory,
+                 m_pPipeline->knownSubdirectories.value(listing.path)) {
+            dirsToScan.append(QDir(subdirectory));
+        }
+    } else {
+        QDirIterator it(listing.path,
+                        QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot);
+        QString currentFile;
+        QFileInfo currentFileInfo;
+        QString newHashStr;
+
+        while (it.hasNext()) {
+            currentFile = it.next();
+            currentFileInfo = it.fileInfo();
+
+            if (currentFileInfo.isFile()) {
+                if (m_extensionFilter.indexIn(currentFileInfo.fileName()) != -1) {
+                    newHashStr += currentFile;
+                    listing.files.append(currentFileInfo);
+                }
             } else {
-                qDebug() << "Track ("+filePath+") could not be added";
+                // File is a directory. Add it to our list of directories to
+                // scan. Skip the iTunes Album Art Folder since it is probably
+                // a waste of time.
+                if (!m_pScanner->m_directoriesBlacklist.contains(currentFile)) {
+                    dirsToScan.append(QDir(currentFile));
+                }
             }
         }
+
+        // Calculate a hash of the directory's file list.
+        listing.hash = qHash(newHashStr);
+        listing.unchanged = false;
+    }
+
+    if (m_pScanner->m_bCancelLibraryScan ||
+            !m_pPipeline->directories.push(listing)) {
+        return false;
     }
 
+    // Process all of the sub-directories.
+    foreach (const QDir& nextDir, dirsToScan) {
+        if (!walk(nextDir, pToken)) {
+            return false;
+        }
+    }
     return true;
 }
 
+LibraryScanner::MetadataParser::MetadataParser(LibraryScanner* pScanner,
+                                               Pipeline* pPipeline)
+        : m_pScanner(pScanner),
+          m_pPipeline(pPipeline) {
+}
+
+void LibraryScanner::MetadataParser::run() {
+    QThread::currentThread()->setObjectName("LibraryScanner MetadataParser");
+    ParseRequest request;
+    while (m_pPipeline->parseRequests.pop(&request)) {
+        ParsedTrack parsed;
+        parsed.directory = request.directory;
+        // Once the scan is cancelled the requests are answered without a
+        // track, so that a scanner waiting for them does not block.
+        if (!m_pScanner->m_bCancelLibraryScan) {
+            // Parsing the metadata is the slow part of importing a file.
+            parsed.pTrack = TrackPointer(
+                    new TrackInfoObject(request.filePath, request.pToken),
+                    &QObject::deleteLater);
+            // The track is added and released by the scanner thread.
+            parsed.pTrack->moveToThread(m_pScanner);
+        }
+        if (!m_pPipeline->parsedTracks.push(parsed)) {
+            break;
+        }
+    }
+}
+
 // Table: LibraryHashes
 // PRIMARY KEY string directory
 // string hash
 
-// Recursive Algorithm:
-// 1) QDirIterator, iterate over all _files_ in a directory to construct a giant string.
-// 2) newHash = Hash that string.
-// 3) prevHash = SELECT from LibraryHashes * WHERE directory == strDirectory
-// 4) if (prevHash != newHash) scanDirectory(strDirectory); //Do a NON-RECURSIVE scan of the files in that dir.
-// 5) For each directory in strDirectory, execute this algorithm.
+// Scanning Algorithm:
+// 1) DirectoryWalker: QDirIterator, iterate over all _files_ in a directory to
+//    construct a giant string and hash it. Queue the listing and continue
+//    with the sub-directories. Incremental scans skip listing directories
+//    whose mtime is the stored one and continue with the stored
+//    sub-directories.
+// 2) Scanner: prevHash = SELECT from LibraryHashes * WHERE directory == strDirectory
+// 3) if (prevHash != newHash) queue the new files of strDirectory for parsing.
+// 4) MetadataParsers: Create a TrackInfoObject for each queued file.
+// 5) Scanner: Add the parsed tracks to the database and save newHash once all
+//    tracks of strDirectory have been added.
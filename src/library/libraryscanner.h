@@ -27,8 +27,9 @@
 #include <QSqlDatabase>
 #include <QStringList>
 #include <QRegExp>
+#include <QDir>
 #include <QFileInfo>
-#include <QLinkedList>
+#include <QHash>
 
 #include "library/dao/cratedao.h"
 #include "library/dao/cuedao.h"
@@ -39,8 +40,10 @@
 #include "library/dao/analysisdao.h"
 #include "libraryscannerdlg.h"
 #include "trackcollection.h"
+#include "util/blockingqueue.h"
 #include "util/sandbox.h"
 
+class LibraryWatcher;
 class TrackInfoObject;
 
 class LibraryScanner : public QThread {
@@ -51,7 +54,16 @@ class LibraryScanner : public QThread {
     virtual ~LibraryScanner();
 
     void run();
-    void scan(QWidget *parent);
+    // An incremental scan only hashes the directories whose modification
+    // time changed since they were hashed. The others are verified by their
+    // modification time alone.
+    void scan(QWidget *parent, bool incremental = false);
+
+    // Whether directories changed while Mixxx ran and were not scanned yet.
+    bool hasJournaledChanges();
+
+    // Scans the library on the calling thread, without a progress dialog.
+    void scanForTest(bool incremental);
 
   public slots:
     void cancel();
@@ -63,17 +75,135 @@ class LibraryScanner : public QThread {
     void progressLoading(QString path);
 
   private:
-    // Recursively scan a music library. Doesn't import tracks for any
-    // directories that have already been scanned and have not changed. Changes
-    // are tracked by performing a hash of the directory's file list, and those
-    // hashes are stored in the database.
-    bool recursiveScan(const QDir& dirPath, QStringList& verifiedDirectories,
-                       SecurityTokenPointer pToken);
-
-    // Import the provided files. Returns true if the scan completed without
-    // being cancelled. False if the scan was cancelled part-way through.
-    bool importFiles(const QLinkedList<QFileInfo>& files,
-                     SecurityTokenPointer pToken);
+    // The files of a directory and the hash of their names.
+    struct DirectoryListing {
+        QString path;
+        int hash;
+        // The modification time before the directory was listed or 0.
+        uint mtime;
+        // Whether the directory was not listed because its modification time
+        // is the stored one. hash is the stored hash then.
+        bool unchanged;
+        QList<QFileInfo> files;
+        SecurityTokenPointer pToken;
+    };
+
+    // A new file whose metadata has to be parsed. directory is the id of the
+    // PendingDirectory the file belongs to.
+    struct ParseRequest {
+        QString filePath;
+        int directory;
+        SecurityTokenPointer pToken;
+    };
+
+    struct ParsedTrack {
+        TrackPointer pTrack;
+        int directory;
+    };
+
+    // A changed directory whose new hash is saved once all of its new tracks
+    // are in the database, so that an interrupted scan imports it again.
+    struct PendingDirectory {
+        QString path;
+        int hash;
+        uint mtime;
+        bool prevHashExists;
+        // The number of tracks that have not been added yet.
+        int remainingTracks;
+        // Whether all tracks of the directory have been requested.
+        bool complete;
+    };
+
+    // The queues that connect the DirectoryWalker, the MetadataParsers and
+    // the scanner thread, which is the only one that writes to the database.
+    struct Pipeline {
+        Pipeline();
+
+        // The stored hashes of the directories and, for incremental scans,
+        // the stored sub-directories of each directory. Read before the
+        // threads start.
+        QHash<QString, LibraryHashDAO::DirectoryHash> knownDirectories;
+        QHash<QString, QStringList> knownSubdirectories;
+        bool incremental;
+
+        BlockingQueue<DirectoryListing> directories;
+        BlockingQueue<ParseRequest> parseRequests;
+        BlockingQueue<ParsedTrack> parsedTracks;
+        // Only used by the scanner thread.
+        QHash<int, PendingDirectory> pendingDirectories;
+        // The modification times of the hashed directories. An incremental
+        // scan trusts the stored sub-directories of a directory with a stored
+        // mtime, so they are only stored once all directories were scanned.
+        QHash<QString, uint> directoryMtimes;
+        int nextDirectoryId;
+        int tracksInFlight;
+    };
+
+    // Walks the library directories depth first and lists the files of each
+    // directory. Only touches the file system.
+    class DirectoryWalker : public QThread {
+      public:
+        DirectoryWalker(LibraryScanner* pScanner, Pipeline* pPipeline,
+                        const QStringList& dirs);
+
+        // Whether all directories were listed.
+        bool finished() const {
+            return m_bFinished;
+        }
+
+      protected:
+        void run();
+
+      private:
+        bool walk(const QDir& dir, SecurityTokenPointer pToken);
+
+        LibraryScanner* m_pScanner;
+        Pipeline* m_pPipeline;
+        const QStringList m_dirs;
+        // A copy, since QRegExp::indexIn() is not reentrant.
+        QRegExp m_extensionFilter;
+        bool m_bFinished;
+    };
+
+    // Parses the metadata of new files into tracks. Several parsers run in
+    // parallel because parsing is dominated by file access latency.
+    class MetadataParser : public QThread {
+      public:
+        MetadataParser(LibraryScanner* pScanner, Pipeline* pPipeline);
+
+      protected:
+        void run();
+
+      private:
+        LibraryScanner* m_pScanner;
+        Pipeline* m_pPipeline;
+    };
+
+    // Scans the library directories with a DirectoryWalker and a pool of
+    // MetadataParsers, adding the new tracks on this thread. Doesn't import
+    // tracks for any directories that have already been scanned and have not
+    // changed. Changes are tracked by performing a hash of the directory's
+    // file list, and those hashes are stored in the database. Returns true if
+    // the scan completed without being cancelled. Stores the modification
+    // times of the hashed directories in directoryMtimes.
+    bool scanDirectories(const QStringList& dirs,
+                         QStringList& verifiedDirectories,
+                         QHash<QString, uint>& directoryMtimes,
+                         bool incremental);
+
+    // Compares the hash of a listed directory with the stored one and
+    // requests the metadata of its new files if it changed.
+    void importDirectory(Pipeline* pPipeline, const DirectoryListing& listing,
+                         QStringList& verifiedDirectories);
+
+    // Adds a parsed track to the database and saves the hash of its directory
+    // if it was the last track of it.
+    void addParsedTrack(Pipeline* pPipeline, const ParsedTrack& parsed);
+
+    // Saves the hash of directory without its modification time, which
+    // is kept in pPipeline until the scan is finished.
+    void saveDirectoryHash(Pipeline* pPipeline,
+                           const PendingDirectory& directory);
 
     // The library trackcollection
     TrackCollection* m_pCollection;
@@ -90,7 +220,9 @@ class LibraryScanner : public QThread {
     TrackDAO m_trackDao;
     QRegExp m_extensionFilter;
     volatile bool m_bCancelLibraryScan;
+    bool m_bIncremental;
     QStringList m_directoriesBlacklist;
+    LibraryWatcher* m_pWatcher;
 };
 
 #endif
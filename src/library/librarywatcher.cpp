@@ -0,0 +1,96 @@
+#include <QFileSystemWatcher>
+#include <QStringList>
+#include <QtDebug>
+
+#include "library/librarywatcher.h"
+#include "library/dao/libraryhashdao.h"
+#include "library/trackcollection.h"
+
+namespace {
+
+// Changes are written in batches, since copying an album changes its
+// directory many times.
+const int kFlushDelayMillis = 2000;
+// Every watched directory takes an inotify watch, which are limited per user
+// (fs.inotify.max_user_watches). Directories beyond this are not watched.
+const int kMaxWatchedDirectories = 4096;
+
+}  // namespace
+
+LibraryWatcher::LibraryWatcher(TrackCollection* pCollection, QObject* pParent)
+        : QObject(pParent),
+          m_pCollection(pCollection),
+          m_pWatcher(NULL),
+          m_bScanning(false) {
+#ifdef __LINUX__
+    m_pWatcher = new QFileSystemWatcher(this);
+    connect(m_pWatcher, SIGNAL(directoryChanged(const QString&)),
+            this, SLOT(slotDirectoryChanged(const QString&)));
+#endif
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(kFlushDelayMillis);
+    connect(&m_flushTimer, SIGNAL(timeout()),
+            this, SLOT(slotFlush()));
+    watchLibraryDirectories();
+}
+
+LibraryWatcher::~LibraryWatcher() {
+}
+
+void LibraryWatcher::scanStarted() {
+    m_bScanning = true;
+    m_flushTimer.stop();
+}
+
+void LibraryWatcher::flush() {
+    m_flushTimer.stop();
+    if (m_changedDirectories.isEmpty()) {
+        return;
+    }
+    qDebug() << "LibraryWatcher: Journaling" << m_changedDirectories.size()
+             << "changed directories";
+    LibraryHashDAO libraryHashDao(m_pCollection->getDatabase());
+    libraryHashDao.invalidateDirectoryMtimes(m_changedDirectories.toList());
+    m_changedDirectories.clear();
+}
+
+void LibraryWatcher::slotScanFinished() {
+    m_bScanning = false;
+    // Changes during the scan may or may not have been hashed.
+    flush();
+    watchLibraryDirectories();
+}
+
+void LibraryWatcher::slotDirectoryChanged(const QString& path) {
+    m_changedDirectories.insert(path);
+    if (!m_bScanning && !m_flushTimer.isActive()) {
+        m_flushTimer.start();
+    }
+}
+
+void LibraryWatcher::slotFlush() {
+    if (!m_bScanning) {
+        flush();
+    }
+}
+
+void LibraryWatcher::watchLibraryDirectories() {
+    if (m_pWatcher == NULL) {
+        return;
+    }
+    const QStringList watched = m_pWatcher->directories();
+    if (!watched.isEmpty()) {
+        m_pWatcher->removePaths(watched);
+    }
+
+    LibraryHashDAO libraryHashDao(m_pCollection->getDatabase());
+    QStringList directories = libraryHashDao.getDirectoryHashes().keys();
+    if (directories.size() > kMaxWatchedDirectories) {
+        qDebug() << "LibraryWatcher: Watching" << kMaxWatchedDirectories
+                 << "of" << directories.size() << "directories";
+        directories = directories.mid(0, kMaxWatchedDirectories);
+    }
+    if (!directories.isEmpty()) {
+        m_pWatcher->addPaths(directories);
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef LIBRARYWATCHER_H
+#define LIBRARYWATCHER_H
+
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QTimer>
+
+class QFileSystemWatcher;
+class TrackCollection;
+
+// LibraryWatcher watches the hashed library directories while Mixxx runs and
+// journals the ones that change by resetting their modification time in the
+// LibraryHashes table. The next incremental scan hashes them again, like every
+// directory whose modification time differs from the stored one.
+//
+// Directories are only watched on Linux, where QFileSystemWatcher uses
+// inotify. Elsewhere incremental scans rely on the modification times alone.
+class LibraryWatcher : public QObject {
+    Q_OBJECT
+  public:
+    LibraryWatcher(TrackCollection* pCollection, QObject* pParent = NULL);
+    virtual ~LibraryWatcher();
+
+    // Stops writing to the database while the library scanner does.
+    void scanStarted();
+    // Writes the changed directories to the database. Must not be called
+    // while the library scanner runs.
+    void flush();
+
+  public slots:
+    // Watches the directories that the scan hashed.
+    void slotScanFinished();
+
+  private slots:
+    void slotDirectoryChanged(const QString& path);
+    void slotFlush();
+
+  private:
+    void watchLibraryDirectories();
+
+    TrackCollection* m_pCollection;
+    QFileSystemWatcher* m_pWatcher;
+    // The changed directories that have not been written yet.
+    QSet<QString> m_changedDirectories;
+    QTimer m_flushTimer;
+    bool m_bScanning;
+};
+
+#endif /* LIBRARYWATCHER_H */
@@ -79,6 +79,9 @@ MixxxLibraryFeature::MixxxLibraryFeature(QObject* parent,
 
     BaseTrackCache* pBaseTrackCache = new BaseTrackCache(
         pTrackCollection, tableName, LIBRARYTABLE_ID, columns, true);
+    if (m_trackDao.hasFullTextIndex()) {
+        pBaseTrackCache->setFullTextTable(LIBRARY_FTS_TABLE);
+    }
     connect(&m_trackDao, SIGNAL(trackDirty(int)),
             pBaseTrackCache, SLOT(slotTrackDirty(int)));
     connect(&m_trackDao, SIGNAL(trackClean(int)),
@@ -9,6 +9,7 @@
 
 const QString SchemaManager::SETTINGS_VERSION_STRING = "mixxx.schema.version";
 const QString SchemaManager::SETTINGS_MINCOMPATIBLE_STRING = "mixxx.schema.min_compatible_version";
+const QString SchemaManager::SETTINGS_SKIPPED_STRING = "mixxx.schema.skipped_optional_versions";
 
 // static
 int SchemaManager::upgradeToSchemaVersion(const QString& schemaFilename,
@@ -18,6 +19,10 @@ int SchemaManager::upgradeToSchemaVersion(const QString& schemaFilename,
     int currentVersion = getCurrentSchemaVersion(settings);
     Q_ASSERT(currentVersion >= 0);
 
+    // Optional revisions that failed before might apply now, e.g. after an
+    // update of SQLite.
+    retrySkippedRevisions(schemaFilename, db, settings);
+
     if (currentVersion == targetVersion) {
         qDebug() << "SchemaManager::upgradeToSchemaVersion already at version"
                  << targetVersion;
@@ -83,6 +88,11 @@ int SchemaManager::upgradeToSchemaVersion(const QString& schemaFilename,
         QDomElement eDescription = revision.firstChildElement("description");
         QDomElement eSql = revision.firstChildElement("sql");
         QString minCompatibleVersion = revision.attribute("min_compatible");
+        // Optional revisions add features Mixxx can do without, e.g. ones
+        // that need SQLite extensions which may not be compiled in. If they
+        // fail the schema is still moved to their version so that later
+        // revisions apply, and they are retried on the next start.
+        bool optional = revision.attribute("optional") == "true";
 
         // Default the min-compatible version to the current version string if
         // it's not in the schema.xml
@@ -100,33 +110,26 @@ int SchemaManager::upgradeToSchemaVersion(const QString& schemaFilename,
                  << description.trimmed();
 
         ScopedTransaction transaction(db);
-
-        // TODO(XXX) We can't have semicolons in schema.xml for anything other
-        // than statement separators.
-        QStringList sqlStatements = sql.split(";");
-
-        QStringListIterator it(sqlStatements);
-
-        QSqlQuery query(db);
-        bool result = true;
-        while (result && it.hasNext()) {
-            QString statement = it.next().trimmed();
-            if (statement.isEmpty()) {
-                continue;
-            }
-            result = result && query.exec(statement);
-            if (!result) {
-                qDebug() << "Failed query:"
-                         << statement
-                         << query.lastError();
-            }
-        }
+        bool result = executeStatements(db, sql);
 
         if (result) {
             currentVersion = thisTarget;
             settings.setValue(SETTINGS_VERSION_STRING, thisTarget);
             settings.setValue(SETTINGS_MINCOMPATIBLE_STRING, minCompatibleVersion);
             transaction.commit();
+        } else if (optional) {
+            qDebug() << "Skipping optional version" << thisTarget
+                     << "because it failed to apply.";
+            transaction.rollback();
+            transaction.transaction();
+            currentVersion = thisTarget;
+            settings.setValue(SETTINGS_VERSION_STRING, thisTarget);
+            settings.setValue(SETTINGS_MINCOMPATIBLE_STRING, minCompatibleVersion);
+            QStringList skipped = settings.getValue(SETTINGS_SKIPPED_STRING)
+                    .split(",", QString::SkipEmptyParts);
+            skipped.append(QString::number(thisTarget));
+            settings.setValue(SETTINGS_SKIPPED_STRING, skipped.join(","));
+            transaction.commit();
         } else {
             success = -2;
             qDebug() << "Failed to move from version" << currentVersion
@@ -139,6 +142,138 @@ int SchemaManager::upgradeToSchemaVersion(const QString& schemaFilename,
     return success;
 }
 
+// static
+void SchemaManager::retrySkippedRevisions(const QString& schemaFilename,
+                                          QSqlDatabase& db,
+                                          SettingsDAO& settings) {
+    QStringList skipped = settings.getValue(SETTINGS_SKIPPED_STRING)
+            .split(",", QString::SkipEmptyParts);
+    if (skipped.isEmpty()) {
+        return;
+    }
+
+    QDomElement schemaRoot = XmlParse::openXMLFile(schemaFilename, "schema");
+    if (schemaRoot.isNull()) {
+        return;
+    }
+    QMap<int, QDomElement> revisionMap;
+    QDomNodeList revisions = schemaRoot.childNodes();
+    for (int i = 0; i < revisions.count(); i++) {
+        QDomElement revision = revisions.at(i).toElement();
+        revisionMap[revision.attribute("version").toInt()] = revision;
+    }
+
+    QMutableStringListIterator it(skipped);
+    while (it.hasNext()) {
+        const int version = it.next().toInt();
+        if (!revisionMap.contains(version)) {
+            continue;
+        }
+        ScopedTransaction transaction(db);
+        QString sql = revisionMap[version].firstChildElement("sql").text();
+        if (!executeStatements(db, sql)) {
+            qDebug() << "Optional version" << version << "still fails to apply.";
+            transaction.rollback();
+            continue;
+        }
+        qDebug() << "Applied optional version" << version
+                 << "that was skipped before.";
+        it.remove();
+        settings.setValue(SETTINGS_SKIPPED_STRING, skipped.join(","));
+        transaction.commit();
+    }
+}
+
+// static
+bool SchemaManager::executeStatements(QSqlDatabase& db, const QString& sql) {
+    QSqlQuery query(db);
+    foreach (const QString& statement, splitStatements(sql)) {
+        if (!query.exec(statement)) {
+            qDebug() << "Failed query:"
+                     << statement
+                     << query.lastError();
+            return false;
+        }
+    }
+    return true;
+}
+
+// static
+QStringList SchemaManager::splitStatements(const QString& sql) {
+    QStringList statements;
+    QString statement;
+    // The leading words of statement, to recognize CREATE TRIGGER.
+    QStringList leadingWords;
+    bool inTrigger = false;
+    // The number of BEGIN and CASE blocks of a trigger that are open. Their
+    // semicolons don't end the statement.
+    int openBlocks = 0;
+
+    int i = 0;
+    while (i < sql.size()) {
+        const QChar c = sql.at(i);
+        if (c == '\'' || c == '"') {
+            // A quoted string or name. Doubled quotes read as two literals.
+            int end = sql.indexOf(c, i + 1);
+            if (end == -1) {
+                end = sql.size() - 1;
+            }
+            statement += sql.mid(i, end - i + 1);
+            i = end + 1;
+        } else if (c == '-' && sql.mid(i, 2) == "--") {
+            int end = sql.indexOf('\n', i);
+            if (end == -1) {
+                end = sql.size() - 1;
+            }
+            statement += sql.mid(i, end - i + 1);
+            i = end + 1;
+        } else if (c.isLetter() || c == '_') {
+            int end = i + 1;
+            while (end < sql.size() &&
+                   (sql.at(end).isLetterOrNumber() || sql.at(end) == '_')) {
+                ++end;
+            }
+            const QString word = sql.mid(i, end - i).toUpper();
+            if (leadingWords.size() < 3) {
+                leadingWords.append(word);
+                inTrigger = leadingWords.size() >= 2 &&
+                        leadingWords[0] == "CREATE" &&
+                        (leadingWords[1] == "TRIGGER" ||
+                         (leadingWords.size() == 3 &&
+                          (leadingWords[1] == "TEMP" ||
+                           leadingWords[1] == "TEMPORARY") &&
+                          leadingWords[2] == "TRIGGER"));
+            }
+            if (inTrigger) {
+                if (word == "BEGIN" || (word == "CASE" && openBlocks > 0)) {
+                    ++openBlocks;
+                } else if (word == "END" && openBlocks > 0) {
+                    --openBlocks;
+                }
+            }
+            statement += sql.mid(i, end - i);
+            i = end;
+        } else if (c == ';' && openBlocks == 0) {
+            statement = statement.trimmed();
+            if (!statement.isEmpty()) {
+                statements.append(statement);
+            }
+            statement.clear();
+            leadingWords.clear();
+            inTrigger = false;
+            ++i;
+        } else {
+            statement += c;
+            ++i;
+        }
+    }
+    statement = statement.trimmed();
+    if (!statement.isEmpty()) {
+        statements.append(statement);
+    }
+    return statements;
+}
+
 // static
 int SchemaManager::getCurrentSchemaVersion(SettingsDAO& settings) {
     QString currentSchemaVersion = settings.getValue(SETTINGS_VERSION_STRING);
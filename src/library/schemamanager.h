@@ -13,14 +13,26 @@ class SchemaManager {
   public:
     static int upgradeToSchemaVersion(const QString& schemaFilename,
                                        QSqlDatabase& db, int targetVersion);
+    // Splits sql into its statements. Semicolons in quotes, comments and the
+    // BEGIN ... END body of a CREATE TRIGGER statement, including CASE ...
+    // END expressions in it, do not end the statement.
+    static QStringList splitStatements(const QString& sql);
+
   private:
     static bool isBackwardsCompatible(SettingsDAO& settings,
                                       int currentVersion,
                                       int targetVersion);
     static int getCurrentSchemaVersion(SettingsDAO& settings);
+    // Applies the optional revisions that were skipped because they failed.
+    static void retrySkippedRevisions(const QString& schemaFilename,
+                                      QSqlDatabase& db, SettingsDAO& settings);
+    // Executes the statements of sql. Returns false if one of them failed.
+    static bool executeStatements(QSqlDatabase& db, const QString& sql);
 
     static const QString SETTINGS_VERSION_STRING;
     static const QString SETTINGS_MINCOMPATIBLE_STRING;
+    // The comma-separated optional versions that failed to apply.
+    static const QString SETTINGS_SKIPPED_STRING;
 };
 
 #endif /* SCHEMAMANAGER_H */
@@ -1,7 +1,10 @@
+#include <algorithm>
+
 #include <QtDebug>
 
 #include "library/searchquery.h"
 
+#include "library/columnartrackindex.h"
 #include "library/queryutil.h"
 #include "track/keyutils.h"
 #include "library/dao/trackdao.h"
@@ -56,6 +59,31 @@ QVariant getTrackValueForColumn(const TrackPointer& pTrack, const QString& colum
     return QVariant();
 }
 
+const QVector<int>& IndexColumns::columns(const ColumnarTrackIndex& index,
+                                          const QStringList& names) const {
+    if (m_pIndex != &index) {
+        m_pIndex = &index;
+        m_columns.clear();
+        foreach (const QString& name, names) {
+            int column = index.columnIndex(name);
+            // Columns that the index doesn't have never match.
+            if (column >= 0) {
+                m_columns.append(column);
+            }
+        }
+    }
+    return m_columns;
+}
+
+bool GroupNode::canMatchIndex() const {
+    foreach (const QueryNode* pNode, m_nodes) {
+        if (!pNode->canMatchIndex()) {
+            return false;
+        }
+    }
+    return true;
+}
+
 bool AndNode::match(const TrackPointer& pTrack) const {
     if (m_nodes.isEmpty()) {
         return false;
@@ -69,6 +97,34 @@ bool AndNode::match(const TrackPointer& pTrack) const {
     return true;
 }
 
+bool AndNode::match(const ColumnarTrackIndex& index, int row) const {
+    if (m_nodes.isEmpty()) {
+        return false;
+    }
+
+    foreach (const QueryNode* pNode, m_nodes) {
+        if (!pNode->match(index, row)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool AndNode::indexCandidates(ColumnarTrackIndex* pIndex,
+                              QVector<int>* pRows) const {
+    // All nodes have to match, so the fewest candidates of any node will do.
+    bool found = false;
+    QVector<int> nodeRows;
+    foreach (const QueryNode* pNode, m_nodes) {
+        if (pNode->indexCandidates(pIndex, &nodeRows) &&
+                (!found || nodeRows.size() < pRows->size())) {
+            pRows->swap(nodeRows);
+            found = true;
+        }
+    }
+    return found;
+}
+
 QString AndNode::toSql() const {
     QStringList queryFragments;
     foreach (const QueryNode* pNode, m_nodes) {
@@ -89,6 +145,34 @@ bool OrNode::match(const TrackPointer& pTrack) const {
     return false;
 }
 
+bool OrNode::match(const ColumnarTrackIndex& index, int row) const {
+    foreach (const QueryNode* pNode, m_nodes) {
+        if (pNode->match(index, row)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool OrNode::indexCandidates(ColumnarTrackIndex* pIndex,
+                             QVector<int>* pRows) const {
+    // Any node may match, so all of them have to narrow down the rows.
+    if (m_nodes.isEmpty()) {
+        return false;
+    }
+    pRows->clear();
+    QVector<int> nodeRows;
+    foreach (const QueryNode* pNode, m_nodes) {
+        if (!pNode->indexCandidates(pIndex, &nodeRows)) {
+            return false;
+        }
+        *pRows += nodeRows;
+    }
+    std::sort(pRows->begin(), pRows->end());
+    pRows->resize(std::unique(pRows->begin(), pRows->end()) - pRows->begin());
+    return true;
+}
+
 QString OrNode::toSql() const {
     QStringList queryFragments;
     foreach (const QueryNode* pNode, m_nodes) {
@@ -114,6 +198,25 @@ bool TextFilterNode::match(const TrackPointer& pTrack) const {
     return false;
 }
 
+bool TextFilterNode::match(const ColumnarTrackIndex& index, int row) const {
+    foreach (int column, m_indexColumns.columns(index, m_sqlColumns)) {
+        if (index.textContains(row, column, m_lowerArgument)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TextFilterNode::indexCandidates(ColumnarTrackIndex* pIndex,
+                                     QVector<int>* pRows) const {
+    foreach (int column, m_indexColumns.columns(*pIndex, m_sqlColumns)) {
+        if (!pIndex->isTextIndexed(column)) {
+            return false;
+        }
+    }
+    return pIndex->textCandidates(m_lowerArgument, pRows);
+}
+
 QString TextFilterNode::toSql() const {
     FieldEscaper escaper(m_database);
     QString escapedArgument = escaper.escapeString("%" + m_argument + "%");
@@ -128,6 +231,92 @@ QString TextFilterNode::toSql() const {
             searchClauses.at(0);
 }
 
+QString FullTextFilterNode::toSql() const {
+    QStringList terms;
+    foreach (QString sqlColumn, m_sqlColumns) {
+        terms << QString("%1:%2*").arg(sqlColumn, m_lowerArgument);
+    }
+    FieldEscaper escaper(m_database);
+    return QString("(%1 IN (SELECT docid FROM %2 WHERE %2 MATCH %3))")
+            .arg(m_idColumn, m_ftsTable,
+                 escaper.escapeString(terms.join(" OR ")));
+}
+
+bool FullTextFilterNode::match(const TrackPointer& pTrack) const {
+    foreach (QString sqlColumn, m_sqlColumns) {
+        if (matchValue(getTrackValueForColumn(pTrack, sqlColumn))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FullTextFilterNode::match(const ColumnarTrackIndex& index, int row) const {
+    foreach (int column, m_indexColumns.columns(index, m_sqlColumns)) {
+        if (matchValue(index.value(row, column))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FullTextFilterNode::matchValue(const QVariant& value) const {
+    if (!value.isValid() || !qVariantCanConvert<QString>(value)) {
+        return false;
+    }
+    return containsWordPrefix(foldText(value.toString()), m_foldedArgument);
+}
+
+// static
+QString FullTextFilterNode::foldText(const QString& text) {
+    bool ascii = true;
+    foreach (QChar c, text) {
+        if (c.unicode() > 0x7f) {
+            ascii = false;
+            break;
+        }
+    }
+    if (ascii) {
+        return text.toLower();
+    }
+    // Decomposing separates the diacritics from their letters.
+    const QString decomposed = text.normalized(QString::NormalizationForm_KD);
+    QString folded;
+    folded.reserve(decomposed.size());
+    foreach (QChar c, decomposed) {
+        if (c.category() != QChar::Mark_NonSpacing) {
+            folded.append(c.toLower());
+        }
+    }
+    return folded;
+}
+
+// static
+bool FullTextFilterNode::containsWordPrefix(const QString& foldedText,
+                                            const QString& foldedPrefix) {
+    int from = 0;
+    while ((from = foldedText.indexOf(foldedPrefix, from)) != -1) {
+        if (from == 0 || !foldedText.at(from - 1).isLetterOrNumber()) {
+            return true;
+        }
+        ++from;
+    }
+    return false;
+}
+
+// static
+bool FullTextFilterNode::isSearchableArgument(const QString& argument) {
+    if (argument.isEmpty()) {
+        return false;
+    }
+    foreach (QChar c, argument) {
+        if (!c.isLetterOrNumber()) {
+            return false;
+        }
+    }
+    return true;
+}
+
 NumericFilterNode::NumericFilterNode(const QStringList& sqlColumns,
                                      QString argument)
         : m_sqlColumns(sqlColumns),
@@ -164,24 +353,35 @@ NumericFilterNode::NumericFilterNode(const QStringList& sqlColumns,
 
 }
 
-bool NumericFilterNode::match(const TrackPointer& pTrack) const {
-    foreach (QString sqlColumn, m_sqlColumns) {
-        QVariant value = getTrackValueForColumn(pTrack, sqlColumn);
-        if (!value.isValid() || !qVariantCanConvert<double>(value)) {
-            continue;
-        }
+bool NumericFilterNode::matchValue(const QVariant& value) const {
+    if (!value.isValid() || !qVariantCanConvert<double>(value)) {
+        return false;
+    }
 
-        double dValue = value.toDouble();
-        if (m_bOperatorQuery) {
-            if ((m_operator == "=" && dValue == m_dOperatorArgument) ||
+    double dValue = value.toDouble();
+    if (m_bOperatorQuery) {
+        return (m_operator == "=" && dValue == m_dOperatorArgument) ||
                 (m_operator == "<" && dValue < m_dOperatorArgument) ||
                 (m_operator == ">" && dValue > m_dOperatorArgument) ||
                 (m_operator == "<=" && dValue <= m_dOperatorArgument) ||
-                (m_operator == ">=" && dValue >= m_dOperatorArgument)) {
-                return true;
-            }
-        } else if (m_bRangeQuery && dValue >= m_dRangeLow &&
-                   dValue <= m_dRangeHigh) {
+                (m_operator == ">=" && dValue >= m_dOperatorArgument);
+    }
+    return m_bRangeQuery && dValue >= m_dRangeLow && dValue <= m_dRangeHigh;
+}
+
+bool NumericFilterNode::match(const TrackPointer& pTrack) const {
+    foreach (QString sqlColumn, m_sqlColumns) {
+        if (matchValue(getTrackValueForColumn(pTrack, sqlColumn))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool NumericFilterNode::match(const ColumnarTrackIndex& index,
+                              int row) const {
+    foreach (int column, m_indexColumns.columns(index, m_sqlColumns)) {
+        if (matchValue(index.value(row, column))) {
             return true;
         }
     }
@@ -229,6 +429,17 @@ bool KeyFilterNode::match(const TrackPointer& pTrack) const {
     return m_matchKeys.contains(pTrack->getKey());
 }
 
+bool KeyFilterNode::match(const ColumnarTrackIndex& index, int row) const {
+    const QVector<int>& columns = m_indexColumns.columns(
+        index, QStringList(LIBRARYTABLE_KEY_ID));
+    if (columns.isEmpty()) {
+        return false;
+    }
+    QVariant value = index.value(row, columns.first());
+    return !value.isNull() && m_matchKeys.contains(
+        static_cast<mixxx::track::io::key::ChromaticKey>(value.toInt()));
+}
+
 QString KeyFilterNode::toSql() const {
     QStringList searchClauses;
     foreach (mixxx::track::io::key::ChromaticKey match, m_matchKeys) {
@@ -6,19 +6,50 @@
 #include <QRegExp>
 #include <QString>
 #include <QStringList>
+#include <QVector>
 
 #include "trackinfoobject.h"
 #include "proto/keys.pb.h"
 
+class ColumnarTrackIndex;
+
 QVariant getTrackValueForColumn(const TrackPointer& pTrack, const QString& column);
 
+// Looks up the columns of a ColumnarTrackIndex by name once per index.
+class IndexColumns {
+  public:
+    IndexColumns() : m_pIndex(NULL) {}
+
+    const QVector<int>& columns(const ColumnarTrackIndex& index,
+                                const QStringList& names) const;
+
+  private:
+    mutable const ColumnarTrackIndex* m_pIndex;
+    mutable QVector<int> m_columns;
+};
+
 class QueryNode {
   public:
     QueryNode() {}
     virtual ~QueryNode() {}
 
     virtual bool match(const TrackPointer& pTrack) const = 0;
+    // Evaluates the node against row of index instead of a track.
+    virtual bool match(const ColumnarTrackIndex& index, int row) const = 0;
     virtual QString toSql() const = 0;
+
+    // Returns false if the node can only be evaluated in SQL.
+    virtual bool canMatchIndex() const {
+        return true;
+    }
+    // Stores a superset of the rows of pIndex that match into pRows and
+    // returns true, or returns false if all rows have to be matched.
+    virtual bool indexCandidates(ColumnarTrackIndex* pIndex,
+                                 QVector<int>* pRows) const {
+        Q_UNUSED(pIndex);
+        Q_UNUSED(pRows);
+        return false;
+    }
 };
 
 class GroupNode : public QueryNode {
@@ -34,6 +65,8 @@ class GroupNode : public QueryNode {
         m_nodes.append(pNode);
     }
 
+    bool canMatchIndex() const;
+
   protected:
     QList<QueryNode*> m_nodes;
 };
@@ -43,7 +76,10 @@ class OrNode : public GroupNode {
     OrNode() {}
 
     bool match(const TrackPointer& pTrack) const;
+    bool match(const ColumnarTrackIndex& index, int row) const;
     QString toSql() const;
+    bool indexCandidates(ColumnarTrackIndex* pIndex,
+                         QVector<int>* pRows) const;
 };
 
 class AndNode : public GroupNode {
@@ -51,7 +87,10 @@ class AndNode : public GroupNode {
     AndNode() {}
 
     bool match(const TrackPointer& pTrack) const;
+    bool match(const ColumnarTrackIndex& index, int row) const;
     QString toSql() const;
+    bool indexCandidates(ColumnarTrackIndex* pIndex,
+                         QVector<int>* pRows) const;
 };
 
 class TextFilterNode : public QueryNode {
@@ -61,26 +100,84 @@ class TextFilterNode : public QueryNode {
                    const QString& argument)
             : m_database(database),
               m_sqlColumns(sqlColumns),
-              m_argument(argument) {
+              m_argument(argument),
+              m_lowerArgument(argument.toLower()) {
     }
 
     bool match(const TrackPointer& pTrack) const;
+    bool match(const ColumnarTrackIndex& index, int row) const;
     QString toSql() const;
+    bool indexCandidates(ColumnarTrackIndex* pIndex,
+                         QVector<int>* pRows) const;
 
-  private:
+  protected:
     QSqlDatabase m_database;
     QStringList m_sqlColumns;
     QString m_argument;
+    QString m_lowerArgument;
+    IndexColumns m_indexColumns;
+};
+
+// Searches the SQL columns through the SQLite full-text index ftsTable, whose
+// docids are the values of idColumn. Unlike TextFilterNode's LIKE, this finds
+// the words that start with the argument rather than any substring, ignoring
+// case and diacritics like the unicode61 tokenizer. Tracks and index rows are
+// matched the same way, so the full-text index is only needed once a query
+// has to run in SQL, e.g. because of an extra filter.
+class FullTextFilterNode : public TextFilterNode {
+  public:
+    FullTextFilterNode(const QSqlDatabase& database,
+                       const QString& ftsTable,
+                       const QString& idColumn,
+                       const QStringList& sqlColumns,
+                       const QString& argument)
+            : TextFilterNode(database, sqlColumns, argument),
+              m_ftsTable(ftsTable),
+              m_idColumn(idColumn),
+              m_foldedArgument(foldText(argument)) {
+    }
+
+    bool match(const TrackPointer& pTrack) const;
+    bool match(const ColumnarTrackIndex& index, int row) const;
+    QString toSql() const;
+    // The trigrams of the argument don't find words with diacritics.
+    bool indexCandidates(ColumnarTrackIndex* pIndex,
+                         QVector<int>* pRows) const {
+        Q_UNUSED(pIndex);
+        Q_UNUSED(pRows);
+        return false;
+    }
+
+    // Returns whether argument can be looked up as a word prefix, which is
+    // the case if it only consists of letters and digits.
+    static bool isSearchableArgument(const QString& argument);
+    // Returns text in lowercase and without diacritics.
+    static QString foldText(const QString& text);
+    // Returns whether a word of foldedText starts with foldedPrefix. Words
+    // are separated by characters that are neither letters nor digits.
+    static bool containsWordPrefix(const QString& foldedText,
+                                   const QString& foldedPrefix);
+
+  private:
+    bool matchValue(const QVariant& value) const;
+
+    QString m_ftsTable;
+    QString m_idColumn;
+    QString m_foldedArgument;
 };
 
 class NumericFilterNode : public QueryNode {
   public:
     NumericFilterNode(const QStringList& sqlColumns, QString argument);
     bool match(const TrackPointer& pTrack) const;
+    bool match(const ColumnarTrackIndex& index, int row) const;
     QString toSql() const;
 
   private:
+    bool matchValue(const QVariant& value) const;
+
     QStringList m_sqlColumns;
+    IndexColumns m_indexColumns;
     bool m_bOperatorQuery;
     QString m_operator;
     double m_dOperatorArgument;
@@ -94,10 +191,12 @@ class KeyFilterNode : public QueryNode {
     KeyFilterNode(mixxx::track::io::key::ChromaticKey key, bool fuzzy);
 
     bool match(const TrackPointer& pTrack) const;
+    bool match(const ColumnarTrackIndex& index, int row) const;
     QString toSql() const;
 
   private:
     QList<mixxx::track::io::key::ChromaticKey> m_matchKeys;
+    IndexColumns m_indexColumns;
 };
 
 class SqlNode : public QueryNode {
@@ -115,10 +214,21 @@ class SqlNode : public QueryNode {
         return true;
     }
 
+    bool match(const ColumnarTrackIndex& index, int row) const {
+        Q_UNUSED(index);
+        Q_UNUSED(row);
+        return true;
+    }
+
     QString toSql() const {
         return m_sql;
     }
 
+    // The expression is arbitrary SQL.
+    bool canMatchIndex() const {
+        return false;
+    }
+
   private:
     QString m_sql;
 };
@@ -54,6 +54,26 @@ SearchQueryParser::SearchQueryParser(QSqlDatabase& database)
 SearchQueryParser::~SearchQueryParser() {
 }
 
+void SearchQueryParser::setFullTextTable(const QString& ftsTable,
+                                         const QString& idColumn) {
+    m_ftsTable = ftsTable;
+    m_ftsIdColumn = idColumn;
+}
+
+QueryNode* SearchQueryParser::newTextFilterNode(const QStringList& sqlColumns,
+                                                const QString& argument) const {
+    bool useFullText = !m_ftsTable.isEmpty() &&
+            FullTextFilterNode::isSearchableArgument(argument);
+    foreach (const QString& sqlColumn, sqlColumns) {
+        useFullText = useFullText && m_textFilters.contains(sqlColumn);
+    }
+    if (useFullText) {
+        return new FullTextFilterNode(m_database, m_ftsTable, m_ftsIdColumn,
+                                      sqlColumns, argument);
+    }
+    return new TextFilterNode(m_database, sqlColumns, argument);
+}
+
 QString SearchQueryParser::getTextArgument(QString argument,
                                            QStringList* tokens) const {
     // If the argument is empty, assume the user placed a space after an
@@ -150,8 +170,7 @@ void SearchQueryParser::parseTokens(QStringList tokens,
 
         // If no advanced search feature matched, treat it as a search term.
         if (!consumed) {
-            pQuery->addNode(new TextFilterNode(
-                m_database, searchColumns, token));
+            pQuery->addNode(newTextFilterNode(searchColumns, token));
             consumed = true;
         }
     }
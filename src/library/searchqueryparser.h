@@ -18,7 +18,15 @@ class SearchQueryParser {
                           const QStringList& searchColumns,
                           const QString& extraFilter) const;
 
+    // Looks up free-text search terms in the full-text index ftsTable, whose
+    // docids are the values of idColumn, instead of with LIKE. Only terms
+    // that consist of letters and digits and search columns that are all
+    // indexed use it.
+    void setFullTextTable(const QString& ftsTable, const QString& idColumn);
+
   private:
+    QueryNode* newTextFilterNode(const QStringList& sqlColumns,
+                                 const QString& argument) const;
     void parseTokens(QStringList tokens,
                      QStringList searchColumns,
                      AndNode* pQuery) const;
@@ -32,6 +40,9 @@ class SearchQueryParser {
     QStringList m_specialFilters;
     QStringList m_allFilters;
     QHash<QString, QStringList> m_fieldToSqlColumns;
+    // The full-text table indexes the columns of m_textFilters.
+    QString m_ftsTable;
+    QString m_ftsIdColumn;
 
     QRegExp m_fuzzyMatcher;
     QRegExp m_textFilterMatcher;
@@ -215,6 +215,10 @@ int main(int argc, char * argv[])
 \n\
     --developer             Enables developer-mode. Includes extra log info,\n\
                             stats on performance, and a Developer tools menu.\n\
+\n\
+    --chromeTracePath FILE  Records a timeline of the events of all threads\n\
+                            and writes it to FILE on exit in the Chrome\n\
+                            Trace Event format (chrome://tracing).\n\
 \n\
     --locale LOCALE         Use a custom locale for loading translations\n\
                             (e.g 'fr')\n\
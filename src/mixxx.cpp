@@ -28,6 +28,7 @@
 
 #include "analyserqueue.h"
 #include "controlpotmeter.h"
+#include "decodedtrackcache.h"
 #include "deck.h"
 #include "defs_urls.h"
 #include "dlgabout.h"
@@ -44,12 +45,14 @@
 #include "playermanager.h"
 #include "recording/defs_recording.h"
 #include "recording/recordingmanager.h"
+#include "sampleutil.h"
 #include "shoutcast/shoutcastmanager.h"
 #include "skin/legacyskinparser.h"
 #include "skin/skinloader.h"
 #include "soundmanager.h"
 #include "soundmanagerutil.h"
 #include "soundsourceproxy.h"
+#include "timelinecontrol.h"
 #include "trackinfoobject.h"
 #include "upgrade.h"
 #include "waveform/waveformwidgetfactory.h"
@@ -59,6 +62,7 @@
 #include "sharedglcontext.h"
 #include "util/debug.h"
 #include "util/statsmanager.h"
+#include "util/timelinerecorder.h"
 #include "util/timer.h"
 #include "util/time.h"
 #include "util/version.h"
@@ -109,6 +113,9 @@ MixxxMainWindow::MixxxMainWindow(QApplication* pApp, const CmdlineArgs& args)
     if (m_cmdLineArgs.getDeveloper()) {
         StatsManager::create();
     }
+    if (m_cmdLineArgs.getChromeTraceEnabled()) {
+        TimelineRecorder::setRecording(true);
+    }
 
     QString resourcePath = m_pConfig->getResourcePath();
     initializeTranslations(pApp);
@@ -123,6 +130,15 @@ MixxxMainWindow::MixxxMainWindow(QApplication* pApp, const CmdlineArgs& args)
 
     setAttribute(Qt::WA_AcceptTouchEvents);
     m_pTouchShift = new ControlPushButton(ConfigKey("[Controls]", "touch_shift"));
+    m_pTimelineControl = new TimelineControl(m_pConfig->getSettingsPath(),
+                                             args.getChromeTracePath());
+
+    // Pick the fastest sample processing kernels for this CPU before anything
+    // starts processing audio.
+    SampleUtil::initialize();
+
+    // Decks with decode_to_ram enabled decode their tracks into this cache.
+    DecodedTrackCache::create()->setConfig(m_pConfig);
 
     // Starting the master (mixing of the channels and effects):
     m_pEngine = new EngineMaster(m_pConfig, "[Master]", true);
@@ -392,9 +408,15 @@ MixxxMainWindow::MixxxMainWindow(QApplication* pApp, const CmdlineArgs& args)
         ConfigKey("[Library]", "SupportedFileExtensions")).split(",", QString::SkipEmptyParts));
     QSet<QString> curr_plugins = QSet<QString>::fromList(
         SoundSourceProxy::supportedFileExtensions());
-    rescan = rescan || (prev_plugins != curr_plugins);
+    bool pluginsChanged = prev_plugins != curr_plugins;
+    rescan = rescan || pluginsChanged;
     m_pConfig->set(ConfigKey("[Library]", "SupportedFileExtensions"),
         QStringList(SoundSourceProxy::supportedFileExtensions()).join(","));
+    // Incremental scans only list the directories that changed, so they can't
+    // find the files of new plugins in the others.
+    bool incremental = m_pConfig->getValueString(
+        ConfigKey("[Library]", "IncrementalRescan"), "1").toInt() &&
+            !pluginsChanged && !hasChanged_MusicDir;
 
     // Scan the library directory. Initialize this after the skinloader has
     // loaded a skin, see Bug #1047435
@@ -407,7 +429,10 @@ MixxxMainWindow::MixxxMainWindow(QApplication* pApp, const CmdlineArgs& args)
             m_pLibrary, SLOT(slotRefreshLibraryModels()));
 
     if (rescan || hasChanged_MusicDir) {
-        m_pLibraryScanner->scan(this);
+        m_pLibraryScanner->scan(this, incremental);
+    } else if (incremental && m_pLibraryScanner->hasJournaledChanges()) {
+        // Directories changed while Mixxx ran last time.
+        m_pLibraryScanner->scan(this, true);
     }
     slotNumDecksChanged(m_pNumDecks->get());
 }
@@ -477,6 +502,9 @@ MixxxMainWindow::~MixxxMainWindow() {
     qDebug() << "delete m_pEngine " << qTime.elapsed();
     delete m_pEngine;
 
+    // The CachingReaders of the engine's decks pin decoded tracks.
+    DecodedTrackCache::destroy();
+
     // HACK: Save config again. We saved it once before doing some dangerous
     // stuff. We only really want to save it here, but the first one was just
     // a precaution. The earlier one can be removed when stuff is more stable
@@ -493,6 +521,12 @@ MixxxMainWindow::~MixxxMainWindow() {
 
     delete m_pTouchShift;
 
+    if (m_cmdLineArgs.getChromeTraceEnabled()) {
+        TimelineRecorder::setRecording(false);
+        m_pTimelineControl->dump();
+    }
+    delete m_pTimelineControl;
+
     PlayerInfo::destroy();
     WaveformWidgetFactory::destroy();
 
@@ -37,6 +37,7 @@ class PlayerManager;
 class RecordingManager;
 class ShoutcastManager;
 class SkinLoader;
+class TimelineControl;
 class VinylControlManager;
 class GuiTick;
 
@@ -243,6 +244,7 @@ class MixxxMainWindow : public QMainWindow {
     const CmdlineArgs& m_cmdLineArgs;
 
     ControlPushButton* m_pTouchShift;
+    TimelineControl* m_pTimelineControl;
     QList<ControlObjectThread*> m_pVinylControlEnabled;
     ControlObjectThread* m_pNumDecks;
     int m_iNumConfiguredDecks;
@@ -0,0 +1,220 @@
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QMutexLocker>
+#include <QTemporaryFile>
+#include <QtDebug>
+
+#include "mp3seektable.h"
+#include "util/cmdlineargs.h"
+
+namespace {
+
+const quint32 kMagic = 0x4d334b53; // "M3KS"
+const quint32 kVersion = 1;
+
+QString s_cacheDirectoryForTest;
+
+// Whether fileName is a name cacheFileName() returns, i.e. a hex SHA-1 hash.
+bool isCacheFileName(const QString& fileName) {
+    if (fileName.size() != 40) {
+        return false;
+    }
+    for (int i = 0; i < fileName.size(); ++i) {
+        const char c = fileName.at(i).toLatin1();
+        if (!(c >= '0' && c <= '9') && !(c >= 'a' && c <= 'f')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+Mp3SeekTable::Mp3SeekTable()
+        : m_bComplete(false),
+          m_iLength(0),
+          m_iBitrate(0) {
+}
+
+Mp3SeekTable::~Mp3SeekTable() {
+}
+
+void Mp3SeekTable::clear() {
+    QMutexLocker locker(&m_mutex);
+    m_offsets.clear();
+    m_positions.clear();
+    m_bComplete = false;
+    m_iLength = 0;
+    m_iBitrate = 0;
+}
+
+void Mp3SeekTable::append(quint32 offset, qint64 position) {
+    QMutexLocker locker(&m_mutex);
+    m_offsets.append(offset);
+    m_positions.append(static_cast<quint32>(position / 2));
+}
+
+void Mp3SeekTable::finish(qint64 length, int bitrate) {
+    QMutexLocker locker(&m_mutex);
+    m_bComplete = true;
+    m_iLength = length;
+    m_iBitrate = bitrate;
+    m_offsets.squeeze();
+    m_positions.squeeze();
+}
+
+bool Mp3SeekTable::isComplete() const {
+    QMutexLocker locker(&m_mutex);
+    return m_bComplete;
+}
+
+int Mp3SeekTable::frameCount() const {
+    QMutexLocker locker(&m_mutex);
+    return m_offsets.size();
+}
+
+qint64 Mp3SeekTable::length() const {
+    QMutexLocker locker(&m_mutex);
+    return m_iLength;
+}
+
+int Mp3SeekTable::bitrate() const {
+    QMutexLocker locker(&m_mutex);
+    return m_iBitrate;
+}
+
+int Mp3SeekTable::findFrame(qint64 position) const {
+    QMutexLocker locker(&m_mutex);
+    const qint64 framePosition = position / 2;
+    // The first frame that starts after position.
+    QVector<quint32>::const_iterator it = qUpperBound(
+            m_positions.begin(), m_positions.end(), framePosition);
+    return (it - m_positions.begin()) - 1;
+}
+
+bool Mp3SeekTable::frame(int index, quint32* pOffset,
+                         qint64* pPosition) const {
+    QMutexLocker locker(&m_mutex);
+    if (index < 0 || index >= m_offsets.size()) {
+        return false;
+    }
+    *pOffset = m_offsets[index];
+    *pPosition = 2 * static_cast<qint64>(m_positions[index]);
+    return true;
+}
+
+bool Mp3SeekTable::save(const QString& fileName,
+                        const QFileInfo& audioFile) const {
+    QMutexLocker locker(&m_mutex);
+    if (!m_bComplete) {
+        return false;
+    }
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+    // Other instances may load or save the table of the same file at the same
+    // time, so it is written to a file of its own first.
+    QTemporaryFile file(fileName + ".XXXXXX");
+    if (!file.open()) {
+        qDebug() << "Mp3SeekTable: Could not write" << fileName;
+        return false;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_4_6);
+    stream << kMagic << kVersion
+           << static_cast<qint64>(audioFile.size())
+           << static_cast<qint64>(audioFile.lastModified().toTime_t())
+           << m_iLength << static_cast<qint32>(m_iBitrate)
+           << m_offsets << m_positions;
+    file.close();
+    if (stream.status() != QDataStream::Ok ||
+            file.error() != QFile::NoError) {
+        qDebug() << "Mp3SeekTable: Could not write" << fileName;
+        return false;
+    }
+    // QFile::rename() doesn't replace existing files.
+    QFile::remove(fileName);
+    if (!QFile::rename(file.fileName(), fileName)) {
+        qDebug() << "Mp3SeekTable: Could not replace" << fileName;
+        return false;
+    }
+    file.setAutoRemove(false);
+    return true;
+}
+
+bool Mp3SeekTable::load(const QString& fileName, const QFileInfo& audioFile) {
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_4_6);
+    quint32 magic = 0;
+    quint32 version = 0;
+    qint64 size = 0;
+    qint64 modified = 0;
+    stream >> magic >> version >> size >> modified;
+    if (magic != kMagic || version != kVersion ||
+            size != audioFile.size() ||
+            modified != audioFile.lastModified().toTime_t()) {
+        return false;
+    }
+
+    qint64 length = 0;
+    qint32 bitrate = 0;
+    QVector<quint32> offsets;
+    QVector<quint32> positions;
+    stream >> length >> bitrate >> offsets >> positions;
+    if (stream.status() != QDataStream::Ok || offsets.isEmpty() ||
+            offsets.size() != positions.size()) {
+        qDebug() << "Mp3SeekTable: Ignoring corrupt seek table" << fileName;
+        return false;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_offsets = offsets;
+    m_positions = positions;
+    m_bComplete = true;
+    m_iLength = length;
+    m_iBitrate = bitrate;
+    return true;
+}
+
+// static
+QString Mp3SeekTable::cacheDirectory() {
+    if (!s_cacheDirectoryForTest.isEmpty()) {
+        return s_cacheDirectoryForTest;
+    }
+    return QDir(CmdlineArgs::Instance().getSettingsPath())
+            .absoluteFilePath("analysis/mp3seek");
+}
+
+// static
+QString Mp3SeekTable::cacheFileName(const QFileInfo& audioFile) {
+    const QByteArray hash = QCryptographicHash::hash(
+            audioFile.absoluteFilePath().toUtf8(), QCryptographicHash::Sha1);
+    return QDir(cacheDirectory()).absoluteFilePath(QString(hash.toHex()));
+}
+
+// static
+void Mp3SeekTable::pruneCache(const QString& directory, int maxFiles) {
+    QDir dir(directory);
+    // Newest first.
+    const QFileInfoList files = dir.entryInfoList(QDir::Files, QDir::Time);
+    int tables = 0;
+    foreach (const QFileInfo& file, files) {
+        if (!isCacheFileName(file.fileName()) || ++tables <= maxFiles) {
+            continue;
+        }
+        if (!QFile::remove(file.absoluteFilePath())) {
+            qDebug() << "Mp3SeekTable: Could not remove"
+                     << file.absoluteFilePath();
+        }
+    }
+}
+
+// static
+void Mp3SeekTable::setCacheDirectoryForTest(const QString& directory) {
+    s_cacheDirectoryForTest = directory;
+}
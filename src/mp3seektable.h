@@ -0,0 +1,81 @@
+#ifndef MP3SEEKTABLE_H
+#define MP3SEEKTABLE_H
+
+#include <QFileInfo>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+#include "util.h"
+
+// Mp3SeekTable holds the byte offset and the sample position of every frame of
+// an MP3 file in two contiguous arrays. It is built once by scanning the frame
+// headers and persisted in the analysis directory, keyed by the size and the
+// modification time of the file, so that reopening the file skips the scan.
+//
+// One thread may append frames while other threads look them up. Lookups never
+// wait for the thread that appends, so readers of an incomplete table have to
+// scan the frames beyond its last one themselves.
+class Mp3SeekTable {
+  public:
+    Mp3SeekTable();
+    virtual ~Mp3SeekTable();
+
+    void clear();
+
+    // Appends a frame. position is the number of samples (both channels) in
+    // the file before the frame.
+    void append(quint32 offset, qint64 position);
+    // Marks the table as complete. length is the number of samples of the
+    // whole file and bitrate the average bitrate of its frames.
+    void finish(qint64 length, int bitrate);
+
+    bool isComplete() const;
+    int frameCount() const;
+    // The number of samples of the file, valid once the table is complete.
+    qint64 length() const;
+    int bitrate() const;
+
+    // Returns the index of the last frame that starts at or before position
+    // or -1 if there is none. If the table is not complete, the frame that
+    // contains position may not have been appended yet.
+    int findFrame(qint64 position) const;
+    // Returns false if index is out of range.
+    bool frame(int index, quint32* pOffset, qint64* pPosition) const;
+
+    // Stores the complete table in fileName, keyed by audioFile. The table is
+    // written to a temporary file that replaces fileName once it is complete,
+    // so readers never see a partially written table.
+    bool save(const QString& fileName, const QFileInfo& audioFile) const;
+    // Loads a table from fileName. Returns false if there is none or if it was
+    // stored for a different version of audioFile.
+    bool load(const QString& fileName, const QFileInfo& audioFile);
+
+    // The directory in the analysis directory that stores the tables.
+    static QString cacheDirectory();
+    // The file in cacheDirectory() that stores the table of audioFile.
+    static QString cacheFileName(const QFileInfo& audioFile);
+    // Removes the least recently written tables in directory until at most
+    // maxFiles are left. Files that are not named like a table, e.g. the
+    // temporary files of tables that are being saved, are left alone.
+    static void pruneCache(const QString& directory, int maxFiles);
+
+    // Makes cacheDirectory() return directory, or the analysis directory again
+    // if directory is empty.
+    static void setCacheDirectoryForTest(const QString& directory);
+
+  private:
+    mutable QMutex m_mutex;
+    // The byte offset of each frame in the file.
+    QVector<quint32> m_offsets;
+    // The position of each frame in sample frames, i.e. half the position in
+    // samples, so that 32 bits cover more than a day of audio.
+    QVector<quint32> m_positions;
+    bool m_bComplete;
+    qint64 m_iLength;
+    int m_iBitrate;
+
+    DISALLOW_COPY_AND_ASSIGN(Mp3SeekTable);
+};
+
+#endif /* MP3SEEKTABLE_H */
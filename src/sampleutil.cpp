@@ -9,16 +9,321 @@ typedef __int32 int32_t;
 
 #include <QtDebug>
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <malloc.h>
+#elif defined(__MINGW32__)
+#include <malloc.h>
+#endif
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#include <cpuid.h>
+#endif
+
 #include "sampleutil.h"
+#include "sampleutil_simd.h"
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+#define SAMPLEUTIL_X86
+#endif
+
+namespace {
+
+// Scalar reference kernels. These are used until SampleUtil::initialize() has
+// run and on CPUs without any of the supported instruction sets.
+
+void applyGainScalar(CSAMPLE* pBuffer, CSAMPLE gain, int iNumSamples) {
+    for (int i = 0; i < iNumSamples; ++i) {
+        pBuffer[i] *= gain;
+    }
+}
+
+void applyRampingGainScalar(CSAMPLE* pBuffer, CSAMPLE old_gain,
+                            CSAMPLE new_gain, int iNumSamples) {
+    const CSAMPLE delta = 2.0 * (new_gain - old_gain) / iNumSamples;
+    CSAMPLE gain = old_gain;
+    for (int i = 0; i < iNumSamples; i += 2, gain += delta) {
+        pBuffer[i] *= gain;
+        pBuffer[i + 1] *= gain;
+    }
+}
+
+void addWithGainScalar(CSAMPLE* pDest, const CSAMPLE* pSrc,
+                       CSAMPLE gain, int iNumSamples) {
+    for (int i = 0; i < iNumSamples; ++i) {
+        pDest[i] += pSrc[i] * gain;
+    }
+}
+
+void addWithRampingGainScalar(CSAMPLE* pDest, const CSAMPLE* pSrc,
+                              CSAMPLE old_gain, CSAMPLE new_gain,
+                              int iNumSamples) {
+    const CSAMPLE delta = 2.0 * (new_gain - old_gain) / iNumSamples;
+    CSAMPLE gain = old_gain;
+    for (int i = 0; i < iNumSamples; i += 2, gain += delta) {
+        pDest[i] += pSrc[i] * gain;
+        pDest[i + 1] += pSrc[i + 1] * gain;
+    }
+}
+
+void copyWithGainScalar(CSAMPLE* pDest, const CSAMPLE* pSrc,
+                        CSAMPLE gain, int iNumSamples) {
+    for (int i = 0; i < iNumSamples; ++i) {
+        pDest[i] = pSrc[i] * gain;
+    }
+}
+
+void copyWithRampingGainScalar(CSAMPLE* pDest, const CSAMPLE* pSrc,
+                               CSAMPLE old_gain, CSAMPLE new_gain,
+                               int iNumSamples) {
+    const CSAMPLE delta = 2.0 * (new_gain - old_gain) / iNumSamples;
+    CSAMPLE gain = old_gain;
+    for (int i = 0; i < iNumSamples; i += 2, gain += delta) {
+        pDest[i] = pSrc[i] * gain;
+        pDest[i + 1] = pSrc[i + 1] * gain;
+    }
+}
+
+void convertScalar(CSAMPLE* pDest, const SAMPLE* pSrc, int iNumSamples) {
+    for (int i = 0; i < iNumSamples; ++i) {
+        pDest[i] = pSrc[i];
+    }
+}
+
+void sumAbsPerChannelScalar(CSAMPLE* pfAbsL, CSAMPLE* pfAbsR,
+                            const CSAMPLE* pBuffer, int iNumSamples) {
+    CSAMPLE fAbsL = 0.0f;
+    CSAMPLE fAbsR = 0.0f;
+
+    for (int i = 0; i < iNumSamples; i += 2) {
+        fAbsL += fabs(pBuffer[i]);
+        fAbsR += fabs(pBuffer[i+1]);
+    }
+
+    *pfAbsL = fAbsL;
+    *pfAbsR = fAbsR;
+}
+
+bool copyClampBufferScalar(CSAMPLE fMax, CSAMPLE fMin,
+                           CSAMPLE* pDest, const CSAMPLE* pSrc,
+                           int iNumSamples) {
+    bool clamped = false;
+    if (pSrc == pDest) {
+        for (int i = 0; i < iNumSamples; ++i) {
+            CSAMPLE sample = pSrc[i];
+            if (sample > fMax) {
+                clamped = true;
+                pDest[i] = fMax;
+            } else if (sample < fMin) {
+                clamped = true;
+                pDest[i] = fMin;
+            }
+        }
+    } else {
+        for (int i = 0; i < iNumSamples; ++i) {
+            CSAMPLE sample = pSrc[i];
+            if (sample > fMax) {
+                sample = fMax;
+                clamped = true;
+            } else if (sample < fMin) {
+                sample = fMin;
+                clamped = true;
+            }
+            pDest[i] = sample;
+        }
+    }
+    return clamped;
+}
+
+void interleaveBufferScalar(CSAMPLE* pDest,
+                            const CSAMPLE* pSrc1, const CSAMPLE* pSrc2,
+                            int iNumSamples) {
+    for (int i = 0; i < iNumSamples; ++i) {
+        pDest[2*i] = pSrc1[i];
+        pDest[2*i+1] = pSrc2[i];
+    }
+}
+
+void deinterleaveBufferScalar(CSAMPLE* pDest1, CSAMPLE* pDest2,
+                              const CSAMPLE* pSrc, int iNumSamples) {
+    for (int i = 0; i < iNumSamples; ++i) {
+        pDest1[i] = pSrc[i*2];
+        pDest2[i] = pSrc[i*2+1];
+    }
+}
+
+const SampleUtilKernels kScalarKernels = {
+    &applyGainScalar,
+    &applyRampingGainScalar,
+    &addWithGainScalar,
+    &addWithRampingGainScalar,
+    &copyWithGainScalar,
+    &copyWithRampingGainScalar,
+    &convertScalar,
+    &sumAbsPerChannelScalar,
+    &copyClampBufferScalar,
+    &interleaveBufferScalar,
+    &deinterleaveBufferScalar,
+};
+
+// The kernels all SampleUtil methods dispatch to.
+SampleUtilKernels s_kernels = kScalarKernels;
+SampleUtil::InstructionSet s_instructionSet = SampleUtil::SCALAR;
+
+#ifdef SAMPLEUTIL_X86
+void cpuid(unsigned int leaf, unsigned int subleaf, unsigned int regs[4]) {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuidex(info, leaf, subleaf);
+    for (int i = 0; i < 4; ++i) {
+        regs[i] = info[i];
+    }
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// Returns the register state the OS saves on context switches (XCR0). The
+// CPU supporting AVX is worthless if the OS doesn't preserve the registers.
+unsigned long long xgetbv0() {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned int eax, edx;
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+}
+#endif
+
+bool cpuSupports(SampleUtil::InstructionSet instructionSet) {
+    if (instructionSet == SampleUtil::SCALAR) {
+        return true;
+    }
+#ifdef SAMPLEUTIL_X86
+    unsigned int regs[4];
+    cpuid(0, 0, regs);
+    const unsigned int maxLeaf = regs[0];
+    if (maxLeaf < 1) {
+        return false;
+    }
+    cpuid(1, 0, regs);
+    const bool sse2 = (regs[3] & (1 << 26)) != 0;
+    if (instructionSet == SampleUtil::SSE2) {
+        return sse2;
+    }
+
+    const bool osxsave = (regs[2] & (1 << 27)) != 0;
+    const bool avx = (regs[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || maxLeaf < 7) {
+        return false;
+    }
+    const unsigned long long xcr0 = xgetbv0();
+    cpuid(7, 0, regs);
+    if (instructionSet == SampleUtil::AVX2) {
+        // XMM and YMM state enabled.
+        return (xcr0 & 0x6) == 0x6 && (regs[1] & (1 << 5)) != 0;
+    }
+    if (instructionSet == SampleUtil::AVX512) {
+        // XMM, YMM, opmask and ZMM state enabled.
+        return (xcr0 & 0xE6) == 0xE6 && (regs[1] & (1 << 16)) != 0;
+    }
+#endif
+    return false;
+}
+
+bool getKernels(SampleUtil::InstructionSet instructionSet,
+                SampleUtilKernels* pKernels) {
+    switch (instructionSet) {
+        case SampleUtil::SCALAR:
+            *pKernels = kScalarKernels;
+            return true;
+        case SampleUtil::SSE2:
+            return SampleUtilKernels::getSse2(pKernels);
+        case SampleUtil::AVX2:
+            return SampleUtilKernels::getAvx2(pKernels);
+        case SampleUtil::AVX512:
+            return SampleUtilKernels::getAvx512(pKernels);
+        default:
+            return false;
+    }
+}
+
+} // anonymous namespace
+
+bool SampleUtil::m_sOptimizationsOn = false;
+
+// static
+void SampleUtil::initialize() {
+    for (int i = NUM_INSTRUCTION_SETS - 1; i > SCALAR; --i) {
+        InstructionSet instructionSet = static_cast<InstructionSet>(i);
+        if (setInstructionSet(instructionSet)) {
+            break;
+        }
+    }
+    qDebug() << "SampleUtil: using" << instructionSetName(s_instructionSet)
+             << "kernels";
+}
+
+// static
+bool SampleUtil::isSupported(InstructionSet instructionSet) {
+    SampleUtilKernels kernels;
+    return cpuSupports(instructionSet) && getKernels(instructionSet, &kernels);
+}
+
+// static
+bool SampleUtil::setInstructionSet(InstructionSet instructionSet) {
+    SampleUtilKernels kernels;
+    if (!cpuSupports(instructionSet) || !getKernels(instructionSet, &kernels)) {
+        return false;
+    }
+    s_kernels = kernels;
+    s_instructionSet = instructionSet;
+    m_sOptimizationsOn = instructionSet != SCALAR;
+    return true;
+}
+
+// static
+SampleUtil::InstructionSet SampleUtil::instructionSet() {
+    return s_instructionSet;
+}
+
+// static
+const char* SampleUtil::instructionSetName(InstructionSet instructionSet) {
+    switch (instructionSet) {
+        case SCALAR:
+            return "scalar";
+        case SSE2:
+            return "SSE2";
+        case AVX2:
+            return "AVX2";
+        case AVX512:
+            return "AVX-512";
+        default:
+            return "unknown";
+    }
+}
 
 // static
 CSAMPLE* SampleUtil::alloc(int size) {
-    // TODO(XXX) align the array
-    return new CSAMPLE[size];
+#if defined(_MSC_VER) || defined(__MINGW32__)
+    return static_cast<CSAMPLE*>(
+        _aligned_malloc(sizeof(CSAMPLE) * size, kAlignment));
+#else
+    void* pBuffer = NULL;
+    if (posix_memalign(&pBuffer, kAlignment, sizeof(CSAMPLE) * size) != 0) {
+        qWarning() << "SampleUtil::alloc failed to allocate" << size << "samples";
+        return NULL;
+    }
+    return static_cast<CSAMPLE*>(pBuffer);
+#endif
 }
 
 void SampleUtil::free(CSAMPLE* pBuffer) {
-    delete [] pBuffer;
+#if defined(_MSC_VER) || defined(__MINGW32__)
+    _aligned_free(pBuffer);
+#else
+    ::free(pBuffer);
+#endif
 }
 
 // static
@@ -31,9 +336,7 @@ void SampleUtil::applyGain(CSAMPLE* pBuffer,
         return;
     }
 
-    for (int i = 0; i < iNumSamples; ++i) {
-        pBuffer[i] *= gain;
-    }
+    s_kernels.applyGain(pBuffer, gain, iNumSamples);
 }
 
 // static
@@ -46,12 +349,7 @@ void SampleUtil::applyRampingGain(CSAMPLE* pBuffer,
         return;
     }
 
-    const CSAMPLE delta = 2.0 * (new_gain - old_gain) / iNumSamples;
-    CSAMPLE gain = old_gain;
-    for (int i = 0; i < iNumSamples; i += 2, gain += delta) {
-        pBuffer[i] *= gain;
-        pBuffer[i + 1] *= gain;
-    }
+    s_kernels.applyRampingGain(pBuffer, old_gain, new_gain, iNumSamples);
 }
 
 // static
@@ -75,9 +373,7 @@ void SampleUtil::addWithGain(CSAMPLE* pDest, const CSAMPLE* pSrc,
     if (gain == 0.0f)
         return;
 
-    for (int i = 0; i < iNumSamples; ++i) {
-        pDest[i] += pSrc[i] * gain;
-    }
+    s_kernels.addWithGain(pDest, pSrc, gain, iNumSamples);
 }
 
 void SampleUtil::addWithRampingGain(CSAMPLE* pDest, const CSAMPLE* pSrc,
@@ -86,12 +382,7 @@ void SampleUtil::addWithRampingGain(CSAMPLE* pDest, const CSAMPLE* pSrc,
         return;
     }
 
-    const CSAMPLE delta = 2.0 * (new_gain - old_gain) / iNumSamples;
-    CSAMPLE gain = old_gain;
-    for (int i = 0; i < iNumSamples; i += 2, gain += delta) {
-        pDest[i] += pSrc[i] * gain;
-        pDest[i + 1] += pSrc[i + 1] * gain;
-    }
+    s_kernels.addWithRampingGain(pDest, pSrc, old_gain, new_gain, iNumSamples);
 }
 
 // static
@@ -144,13 +435,7 @@ void SampleUtil::copyWithGain(CSAMPLE* pDest, const CSAMPLE* pSrc,
         return;
     }
 
-    for (int i = 0; i < iNumSamples; ++i) {
-        pDest[i] = pSrc[i] * gain;
-    }
-
-    // OR! need to test which fares better
-    // memcpy(pDest, pSrc, sizeof(pDest[0]) * iNumSamples);
-    // applyGain(pDest, gain);
+    s_kernels.copyWithGain(pDest, pSrc, gain, iNumSamples);
 }
 
 // static
@@ -168,39 +453,19 @@ void SampleUtil::copyWithRampingGain(CSAMPLE* pDest, const CSAMPLE* pSrc,
         return;
     }
 
-    const CSAMPLE delta = 2.0 * (new_gain - old_gain) / iNumSamples;
-    CSAMPLE gain = old_gain;
-    for (int i = 0; i < iNumSamples; i += 2, gain += delta) {
-        pDest[i] = pSrc[i] * gain;
-        pDest[i + 1] = pSrc[i + 1] * gain;
-    }
-
-    // OR! need to test which fares better
-    // memcpy(pDest, pSrc, sizeof(pDest[0]) * iNumSamples);
-    // applyGain(pDest, gain);
+    s_kernels.copyWithRampingGain(pDest, pSrc, old_gain, new_gain, iNumSamples);
 }
 
 // static
 void SampleUtil::convert(CSAMPLE* pDest, const SAMPLE* pSrc,
                          int iNumSamples) {
-    for (int i = 0; i < iNumSamples; ++i) {
-        pDest[i] = pSrc[i];
-    }
+    s_kernels.convert(pDest, pSrc, iNumSamples);
 }
 
 // static
 void SampleUtil::sumAbsPerChannel(CSAMPLE* pfAbsL, CSAMPLE* pfAbsR,
                                   const CSAMPLE* pBuffer, int iNumSamples) {
-    CSAMPLE fAbsL = 0.0f;
-    CSAMPLE fAbsR = 0.0f;
-
-    for (int i = 0; i < iNumSamples; i += 2) {
-        fAbsL += fabs(pBuffer[i]);
-        fAbsR += fabs(pBuffer[i+1]);
-    }
-
-    *pfAbsL = fAbsL;
-    *pfAbsR = fAbsR;
+    s_kernels.sumAbsPerChannel(pfAbsL, pfAbsR, pBuffer, iNumSamples);
 }
 
 // static
@@ -221,51 +486,20 @@ bool SampleUtil::isOutsideRange(CSAMPLE fMax, CSAMPLE fMin,
 bool SampleUtil::copyClampBuffer(CSAMPLE fMax, CSAMPLE fMin,
                                  CSAMPLE* pDest, const CSAMPLE* pSrc,
                                  int iNumSamples) {
-    bool clamped = false;
-    if (pSrc == pDest) {
-        for (int i = 0; i < iNumSamples; ++i) {
-            CSAMPLE sample = pSrc[i];
-            if (sample > fMax) {
-                clamped = true;
-                pDest[i] = fMax;
-            } else if (sample < fMin) {
-                clamped = true;
-                pDest[i] = fMin;
-            }
-        }
-    } else {
-        for (int i = 0; i < iNumSamples; ++i) {
-            CSAMPLE sample = pSrc[i];
-            if (sample > fMax) {
-                sample = fMax;
-                clamped = true;
-            } else if (sample < fMin) {
-                sample = fMin;
-                clamped = true;
-            }
-            pDest[i] = sample;
-        }
-    }
-    return clamped;
+    return s_kernels.copyClampBuffer(fMax, fMin, pDest, pSrc, iNumSamples);
 }
 
 // static
 void SampleUtil::interleaveBuffer(CSAMPLE* pDest,
                                   const CSAMPLE* pSrc1, const CSAMPLE* pSrc2,
                                   int iNumSamples) {
-    for (int i = 0; i < iNumSamples; ++i) {
-        pDest[2*i] = pSrc1[i];
-        pDest[2*i+1] = pSrc2[i];
-    }
+    s_kernels.interleaveBuffer(pDest, pSrc1, pSrc2, iNumSamples);
 }
 
 // static
 void SampleUtil::deinterleaveBuffer(CSAMPLE* pDest1, CSAMPLE* pDest2,
                                   const CSAMPLE* pSrc, int iNumSamples) {
-    for (int i = 0; i < iNumSamples; ++i) {
-        pDest1[i] = pSrc[i*2];
-        pDest2[i] = pSrc[i*2+1];
-    }
+    s_kernels.deinterleaveBuffer(pDest1, pDest2, pSrc, iNumSamples);
 }
 
 // static
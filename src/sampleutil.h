@@ -32,13 +32,43 @@
 // A group of utilities for working with samples.
 class SampleUtil {
   public:
+    // The instruction sets SampleUtil has explicitly vectorized kernels for.
+    enum InstructionSet {
+        SCALAR = 0,
+        SSE2,
+        AVX2,
+        AVX512,
+        NUM_INSTRUCTION_SETS
+    };
+
+    // Alignment in bytes of the buffers returned by alloc(). Enough for a
+    // full AVX-512 vector and a cache line.
+    static const int kAlignment = 64;
+
+    // True if vectorized kernels are in use.
     static bool m_sOptimizationsOn;
 
+    // Detects the instruction sets supported by the CPU and selects the
+    // fastest kernels. Call once at startup before the engine is running.
+    // Until then the scalar kernels are used.
+    static void initialize();
+
+    // Returns true if this build has kernels for instructionSet and the CPU
+    // (and OS) support it.
+    static bool isSupported(InstructionSet instructionSet);
+
+    // Selects the kernels for instructionSet. Returns false and keeps the
+    // current kernels if it is not supported. Not thread-safe, this is meant
+    // for tests and benchmarks.
+    static bool setInstructionSet(InstructionSet instructionSet);
+    static InstructionSet instructionSet();
+    static const char* instructionSetName(InstructionSet instructionSet);
+
     // Allocated a buffer of CSAMPLE's with length size. Ensures that the buffer
-    // is 16-byte aligned for SSE enhancement.
+    // is kAlignment-byte aligned for SIMD enhancement.
     static CSAMPLE* alloc(int size);
 
-    // Frees a 16-byte aligned buffer allocated by SampleUtil::alloc()
+    // Frees an aligned buffer allocated by SampleUtil::alloc()
     static void free(CSAMPLE* pBuffer);
 
     // Multiply every sample in pBuffer by gain
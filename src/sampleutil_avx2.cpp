@@ -0,0 +1,82 @@
+// sampleutil_avx2.cpp
+// AVX2 instantiation of the SampleUtil kernels. Compiled with AVX2 enabled;
+// only called once SampleUtil has verified that the CPU and OS support it.
+
+#include "sampleutil_simd.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+
+namespace {
+
+struct Avx2 {
+    typedef __m256 Vec;
+    enum { kWidth = 8 };
+
+    static inline Vec load(const CSAMPLE* p) {
+        return _mm256_loadu_ps(p);
+    }
+    static inline void store(CSAMPLE* p, Vec v) {
+        _mm256_storeu_ps(p, v);
+    }
+    static inline Vec set1(CSAMPLE v) {
+        return _mm256_set1_ps(v);
+    }
+    static inline Vec add(Vec a, Vec b) {
+        return _mm256_add_ps(a, b);
+    }
+    static inline Vec mul(Vec a, Vec b) {
+        return _mm256_mul_ps(a, b);
+    }
+    static inline Vec minimum(Vec a, Vec b) {
+        return _mm256_min_ps(a, b);
+    }
+    static inline Vec maximum(Vec a, Vec b) {
+        return _mm256_max_ps(a, b);
+    }
+    static inline Vec absolute(Vec a) {
+        return _mm256_and_ps(a, _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF)));
+    }
+    static inline Vec convert(const SAMPLE* p) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        return _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(v));
+    }
+    static inline void interleave(CSAMPLE* pDest, Vec a, Vec b) {
+        // unpack works within 128-bit lanes, so the halves need to be
+        // recombined afterwards.
+        const Vec lo = _mm256_unpacklo_ps(a, b);
+        const Vec hi = _mm256_unpackhi_ps(a, b);
+        _mm256_storeu_ps(pDest, _mm256_permute2f128_ps(lo, hi, 0x20));
+        _mm256_storeu_ps(pDest + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+    }
+    static inline void deinterleave(const CSAMPLE* pSrc, Vec* pA, Vec* pB) {
+        const Vec x = _mm256_loadu_ps(pSrc);
+        const Vec y = _mm256_loadu_ps(pSrc + 8);
+        // Within each 128-bit lane: [x0 x2 y0 y2], then reorder the 64-bit
+        // pairs to [x0 x2 x4 x6 y0 y2 y4 y6].
+        const Vec even = _mm256_shuffle_ps(x, y, _MM_SHUFFLE(2, 0, 2, 0));
+        const Vec odd = _mm256_shuffle_ps(x, y, _MM_SHUFFLE(3, 1, 3, 1));
+        *pA = _mm256_castpd_ps(_mm256_permute4x64_pd(
+            _mm256_castps_pd(even), _MM_SHUFFLE(3, 1, 2, 0)));
+        *pB = _mm256_castpd_ps(_mm256_permute4x64_pd(
+            _mm256_castps_pd(odd), _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+};
+
+}  // anonymous namespace
+
+// static
+bool SampleUtilKernels::getAvx2(SampleUtilKernels* pKernels) {
+    SampleUtilSimd::fillKernels<Avx2>(pKernels);
+    return true;
+}
+
+#else
+
+// static
+bool SampleUtilKernels::getAvx2(SampleUtilKernels* pKernels) {
+    (void)pKernels;
+    return false;
+}
+
+#endif
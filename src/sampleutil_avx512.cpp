@@ -0,0 +1,84 @@
+// sampleutil_avx512.cpp
+// AVX-512 instantiation of the SampleUtil kernels. Compiled with AVX-512F
+// enabled; only called once SampleUtil has verified that the CPU and OS
+// support it.
+
+#include "sampleutil_simd.h"
+
+#ifdef __AVX512F__
+#include <immintrin.h>
+
+namespace {
+
+const int kInterleaveLow[16] = {
+    0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23 };
+const int kInterleaveHigh[16] = {
+    8, 24, 9, 25, 10, 26, 11, 27, 12, 28, 13, 29, 14, 30, 15, 31 };
+const int kDeinterleaveEven[16] = {
+    0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30 };
+const int kDeinterleaveOdd[16] = {
+    1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31 };
+
+struct Avx512 {
+    typedef __m512 Vec;
+    enum { kWidth = 16 };
+
+    static inline Vec load(const CSAMPLE* p) {
+        return _mm512_loadu_ps(p);
+    }
+    static inline void store(CSAMPLE* p, Vec v) {
+        _mm512_storeu_ps(p, v);
+    }
+    static inline Vec set1(CSAMPLE v) {
+        return _mm512_set1_ps(v);
+    }
+    static inline Vec add(Vec a, Vec b) {
+        return _mm512_add_ps(a, b);
+    }
+    static inline Vec mul(Vec a, Vec b) {
+        return _mm512_mul_ps(a, b);
+    }
+    static inline Vec minimum(Vec a, Vec b) {
+        return _mm512_min_ps(a, b);
+    }
+    static inline Vec maximum(Vec a, Vec b) {
+        return _mm512_max_ps(a, b);
+    }
+    static inline Vec absolute(Vec a) {
+        return _mm512_abs_ps(a);
+    }
+    static inline Vec convert(const SAMPLE* p) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        return _mm512_cvtepi32_ps(_mm512_cvtepi16_epi32(v));
+    }
+    static inline void interleave(CSAMPLE* pDest, Vec a, Vec b) {
+        _mm512_storeu_ps(pDest, _mm512_permutex2var_ps(
+            a, _mm512_loadu_si512(kInterleaveLow), b));
+        _mm512_storeu_ps(pDest + 16, _mm512_permutex2var_ps(
+            a, _mm512_loadu_si512(kInterleaveHigh), b));
+    }
+    static inline void deinterleave(const CSAMPLE* pSrc, Vec* pA, Vec* pB) {
+        const Vec x = _mm512_loadu_ps(pSrc);
+        const Vec y = _mm512_loadu_ps(pSrc + 16);
+        *pA = _mm512_permutex2var_ps(x, _mm512_loadu_si512(kDeinterleaveEven), y);
+        *pB = _mm512_permutex2var_ps(x, _mm512_loadu_si512(kDeinterleaveOdd), y);
+    }
+};
+
+}  // anonymous namespace
+
+// static
+bool SampleUtilKernels::getAvx512(SampleUtilKernels* pKernels) {
+    SampleUtilSimd::fillKernels<Avx512>(pKernels);
+    return true;
+}
+
+#else
+
+// static
+bool SampleUtilKernels::getAvx512(SampleUtilKernels* pKernels) {
+    (void)pKernels;
+    return false;
+}
+
+#endif
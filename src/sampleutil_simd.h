@@ -0,0 +1,293 @@
+// sampleutil_simd.h
+// Explicitly vectorized SampleUtil kernels.
+//
+// The kernels are written once as templates over a small vector traits class
+// and instantiated in sampleutil_sse2.cpp, sampleutil_avx2.cpp and
+// sampleutil_avx512.cpp, each of which is compiled with the flags for its
+// instruction set. SampleUtil picks one of them at runtime based on the
+// features of the CPU. Only include this file from those translation units and
+// sampleutil.cpp.
+
+#ifndef SAMPLEUTIL_SIMD_H
+#define SAMPLEUTIL_SIMD_H
+
+#include "defs.h"
+
+// The dispatch table SampleUtil calls through. Every kernel implements the
+// inner loop of the SampleUtil method with the same name; the shortcuts for
+// gains of 0 and 1 stay in SampleUtil.
+struct SampleUtilKernels {
+    void (*applyGain)(CSAMPLE* pBuffer, CSAMPLE gain, int iNumSamples);
+    void (*applyRampingGain)(CSAMPLE* pBuffer, CSAMPLE old_gain,
+                             CSAMPLE new_gain, int iNumSamples);
+    void (*addWithGain)(CSAMPLE* pDest, const CSAMPLE* pSrc, CSAMPLE gain,
+                        int iNumSamples);
+    void (*addWithRampingGain)(CSAMPLE* pDest, const CSAMPLE* pSrc,
+                               CSAMPLE old_gain, CSAMPLE new_gain,
+                               int iNumSamples);
+    void (*copyWithGain)(CSAMPLE* pDest, const CSAMPLE* pSrc, CSAMPLE gain,
+                         int iNumSamples);
+    void (*copyWithRampingGain)(CSAMPLE* pDest, const CSAMPLE* pSrc,
+                                CSAMPLE old_gain, CSAMPLE new_gain,
+                                int iNumSamples);
+    void (*convert)(CSAMPLE* pDest, const SAMPLE* pSrc, int iNumSamples);
+    void (*sumAbsPerChannel)(CSAMPLE* pfAbsL, CSAMPLE* pfAbsR,
+                             const CSAMPLE* pBuffer, int iNumSamples);
+    bool (*copyClampBuffer)(CSAMPLE fMax, CSAMPLE fMin, CSAMPLE* pDest,
+                            const CSAMPLE* pSrc, int iNumSamples);
+    void (*interleaveBuffer)(CSAMPLE* pDest, const CSAMPLE* pSrc1,
+                             const CSAMPLE* pSrc2, int iNumSamples);
+    void (*deinterleaveBuffer)(CSAMPLE* pDest1, CSAMPLE* pDest2,
+                               const CSAMPLE* pSrc, int iNumSamples);
+
+    // Fill pKernels with the kernels for the respective instruction set.
+    // Return false if this build does not contain them.
+    static bool getSse2(SampleUtilKernels* pKernels);
+    static bool getAvx2(SampleUtilKernels* pKernels);
+    static bool getAvx512(SampleUtilKernels* pKernels);
+};
+
+// The traits class V provides:
+//   typedef ... Vec;                   a vector of kWidth CSAMPLEs
+//   enum { kWidth = ... };
+//   load, store, set1, add, mul, minimum, maximum, absolute
+//   convert(const SAMPLE*)             kWidth SAMPLEs to a Vec
+//   interleave(CSAMPLE*, Vec, Vec)     stores 2 * kWidth samples
+//   deinterleave(const CSAMPLE*, Vec*, Vec*)
+// All loads and stores are unaligned so the kernels accept any offset into a
+// buffer. Buffers from SampleUtil::alloc are aligned so they never straddle a
+// cache line.
+namespace SampleUtilSimd {
+
+// Per-lane gain offsets for ramping gains. Lanes 2k and 2k+1 belong to the
+// same stereo frame and get the same gain.
+template <typename V>
+inline typename V::Vec rampLaneDelta(CSAMPLE delta) {
+    CSAMPLE offsets[V::kWidth];
+    for (int i = 0; i < V::kWidth; ++i) {
+        offsets[i] = delta * (i / 2);
+    }
+    return V::load(offsets);
+}
+
+template <typename V>
+void applyGain(CSAMPLE* pBuffer, CSAMPLE gain, int iNumSamples) {
+    const typename V::Vec vGain = V::set1(gain);
+    int i = 0;
+    for (; i + V::kWidth <= iNumSamples; i += V::kWidth) {
+        V::store(pBuffer + i, V::mul(V::load(pBuffer + i), vGain));
+    }
+    for (; i < iNumSamples; ++i) {
+        pBuffer[i] *= gain;
+    }
+}
+
+template <typename V>
+void applyRampingGain(CSAMPLE* pBuffer, CSAMPLE old_gain, CSAMPLE new_gain,
+                      int iNumSamples) {
+    const CSAMPLE delta = 2.0 * (new_gain - old_gain) / iNumSamples;
+    const typename V::Vec vLaneDelta = rampLaneDelta<V>(delta);
+    int i = 0;
+    for (; i + V::kWidth <= iNumSamples; i += V::kWidth) {
+        const typename V::Vec vGain = V::add(
+            V::set1(old_gain + delta * (i / 2)), vLaneDelta);
+        V::store(pBuffer + i, V::mul(V::load(pBuffer + i), vGain));
+    }
+    for (; i < iNumSamples; i += 2) {
+        const CSAMPLE gain = old_gain + delta * (i / 2);
+        pBuffer[i] *= gain;
+        pBuffer[i + 1] *= gain;
+    }
+}
+
+template <typename V>
+void addWithGain(CSAMPLE* pDest, const CSAMPLE* pSrc, CSAMPLE gain,
+                 int iNumSamples) {
+    const typename V::Vec vGain = V::set1(gain);
+    int i = 0;
+    for (; i + V::kWidth <= iNumSamples; i += V::kWidth) {
+        V::store(pDest + i, V::add(V::load(pDest + i),
+                                   V::mul(V::load(pSrc + i), vGain)));
+    }
+    for (; i < iNumSamples; ++i) {
+        pDest[i] += pSrc[i] * gain;
+    }
+}
+
+template <typename V>
+void addWithRampingGain(CSAMPLE* pDest, const CSAMPLE* pSrc,
+                        CSAMPLE old_gain, CSAMPLE new_gain, int iNumSamples) {
+    const CSAMPLE delta = 2.0 * (new_gain - old_gain) / iNumSamples;
+    const typename V::Vec vLaneDelta = rampLaneDelta<V>(delta);
+    int i = 0;
+    for (; i + V::kWidth <= iNumSamples; i += V::kWidth) {
+        const typename V::Vec vGain = V::add(
+            V::set1(old_gain + delta * (i / 2)), vLaneDelta);
+        V::store(pDest + i, V::add(V::load(pDest + i),
+                                   V::mul(V::load(pSrc + i), vGain)));
+    }
+    for (; i < iNumSamples; i += 2) {
+        const CSAMPLE gain = old_gain + delta * (i / 2);
+        pDest[i] += pSrc[i] * gain;
+        pDest[i + 1] += pSrc[i + 1] * gain;
+    }
+}
+
+template <typename V>
+void copyWithGain(CSAMPLE* pDest, const CSAMPLE* pSrc, CSAMPLE gain,
+                  int iNumSamples) {
+    const typename V::Vec vGain = V::set1(gain);
+    int i = 0;
+    for (; i + V::kWidth <= iNumSamples; i += V::kWidth) {
+        V::store(pDest + i, V::mul(V::load(pSrc + i), vGain));
+    }
+    for (; i < iNumSamples; ++i) {
+        pDest[i] = pSrc[i] * gain;
+    }
+}
+
+template <typename V>
+void copyWithRampingGain(CSAMPLE* pDest, const CSAMPLE* pSrc,
+                         CSAMPLE old_gain, CSAMPLE new_gain, int iNumSamples) {
+    const CSAMPLE delta = 2.0 * (new_gain - old_gain) / iNumSamples;
+    const typename V::Vec vLaneDelta = rampLaneDelta<V>(delta);
+    int i = 0;
+    for (; i + V::kWidth <= iNumSamples; i += V::kWidth) {
+        const typename V::Vec vGain = V::add(
+            V::set1(old_gain + delta * (i / 2)), vLaneDelta);
+        V::store(pDest + i, V::mul(V::load(pSrc + i), vGain));
+    }
+    for (; i < iNumSamples; i += 2) {
+        const CSAMPLE gain = old_gain + delta * (i / 2);
+        pDest[i] = pSrc[i] * gain;
+        pDest[i + 1] = pSrc[i + 1] * gain;
+    }
+}
+
+template <typename V>
+void convert(CSAMPLE* pDest, const SAMPLE* pSrc, int iNumSamples) {
+    int i = 0;
+    for (; i + V::kWidth <= iNumSamples; i += V::kWidth) {
+        V::store(pDest + i, V::convert(pSrc + i));
+    }
+    for (; i < iNumSamples; ++i) {
+        pDest[i] = pSrc[i];
+    }
+}
+
+template <typename V>
+void sumAbsPerChannel(CSAMPLE* pfAbsL, CSAMPLE* pfAbsR,
+                      const CSAMPLE* pBuffer, int iNumSamples) {
+    typename V::Vec vSum = V::set1(0.0f);
+    int i = 0;
+    for (; i + V::kWidth <= iNumSamples; i += V::kWidth) {
+        vSum = V::add(vSum, V::absolute(V::load(pBuffer + i)));
+    }
+
+    // Even lanes hold the left channel, odd lanes the right channel.
+    CSAMPLE sums[V::kWidth];
+    V::store(sums, vSum);
+    CSAMPLE fAbsL = 0.0f;
+    CSAMPLE fAbsR = 0.0f;
+    for (int j = 0; j < V::kWidth; j += 2) {
+        fAbsL += sums[j];
+        fAbsR += sums[j + 1];
+    }
+    for (; i < iNumSamples; i += 2) {
+        fAbsL += fabs(pBuffer[i]);
+        fAbsR += fabs(pBuffer[i + 1]);
+    }
+
+    *pfAbsL = fAbsL;
+    *pfAbsR = fAbsR;
+}
+
+template <typename V>
+bool copyClampBuffer(CSAMPLE fMax, CSAMPLE fMin, CSAMPLE* pDest,
+                     const CSAMPLE* pSrc, int iNumSamples) {
+    const typename V::Vec vMax = V::set1(fMax);
+    const typename V::Vec vMin = V::set1(fMin);
+    // Track the extremes instead of comparing every sample so the loop stays
+    // branch-free.
+    typename V::Vec vHighest = vMin;
+    typename V::Vec vLowest = vMax;
+    int i = 0;
+    for (; i + V::kWidth <= iNumSamples; i += V::kWidth) {
+        const typename V::Vec vSample = V::load(pSrc + i);
+        vHighest = V::maximum(vHighest, vSample);
+        vLowest = V::minimum(vLowest, vSample);
+        V::store(pDest + i, V::minimum(V::maximum(vSample, vMin), vMax));
+    }
+
+    CSAMPLE highest[V::kWidth];
+    CSAMPLE lowest[V::kWidth];
+    V::store(highest, vHighest);
+    V::store(lowest, vLowest);
+    bool clamped = false;
+    for (int j = 0; j < V::kWidth; ++j) {
+        if (highest[j] > fMax || lowest[j] < fMin) {
+            clamped = true;
+        }
+    }
+    for (; i < iNumSamples; ++i) {
+        CSAMPLE sample = pSrc[i];
+        if (sample > fMax) {
+            sample = fMax;
+            clamped = true;
+        } else if (sample < fMin) {
+            sample = fMin;
+            clamped = true;
+        }
+        pDest[i] = sample;
+    }
+    return clamped;
+}
+
+template <typename V>
+void interleaveBuffer(CSAMPLE* pDest, const CSAMPLE* pSrc1,
+                      const CSAMPLE* pSrc2, int iNumSamples) {
+    int i = 0;
+    for (; i + V::kWidth <= iNumSamples; i += V::kWidth) {
+        V::interleave(pDest + 2 * i, V::load(pSrc1 + i), V::load(pSrc2 + i));
+    }
+    for (; i < iNumSamples; ++i) {
+        pDest[2 * i] = pSrc1[i];
+        pDest[2 * i + 1] = pSrc2[i];
+    }
+}
+
+template <typename V>
+void deinterleaveBuffer(CSAMPLE* pDest1, CSAMPLE* pDest2,
+                        const CSAMPLE* pSrc, int iNumSamples) {
+    int i = 0;
+    for (; i + V::kWidth <= iNumSamples; i += V::kWidth) {
+        typename V::Vec vFirst;
+        typename V::Vec vSecond;
+        V::deinterleave(pSrc + 2 * i, &vFirst, &vSecond);
+        V::store(pDest1 + i, vFirst);
+        V::store(pDest2 + i, vSecond);
+    }
+    for (; i < iNumSamples; ++i) {
+        pDest1[i] = pSrc[i * 2];
+        pDest2[i] = pSrc[i * 2 + 1];
+    }
+}
+
+template <typename V>
+void fillKernels(SampleUtilKernels* pKernels) {
+    pKernels->applyGain = &applyGain<V>;
+    pKernels->applyRampingGain = &applyRampingGain<V>;
+    pKernels->addWithGain = &addWithGain<V>;
+    pKernels->addWithRampingGain = &addWithRampingGain<V>;
+    pKernels->copyWithGain = &copyWithGain<V>;
+    pKernels->copyWithRampingGain = &copyWithRampingGain<V>;
+    pKernels->convert = &convert<V>;
+    pKernels->sumAbsPerChannel = &sumAbsPerChannel<V>;
+    pKernels->copyClampBuffer = &copyClampBuffer<V>;
+    pKernels->interleaveBuffer = &interleaveBuffer<V>;
+    pKernels->deinterleaveBuffer = &deinterleaveBuffer<V>;
+}
+
+}  // namespace SampleUtilSimd
+
+#endif /* SAMPLEUTIL_SIMD_H */
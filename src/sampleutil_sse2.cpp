@@ -0,0 +1,74 @@
+// sampleutil_sse2.cpp
+// SSE2 instantiation of the SampleUtil kernels. Compiled with SSE2 enabled;
+// only called once SampleUtil has verified that the CPU supports it.
+
+#include "sampleutil_simd.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+
+namespace {
+
+struct Sse2 {
+    typedef __m128 Vec;
+    enum { kWidth = 4 };
+
+    static inline Vec load(const CSAMPLE* p) {
+        return _mm_loadu_ps(p);
+    }
+    static inline void store(CSAMPLE* p, Vec v) {
+        _mm_storeu_ps(p, v);
+    }
+    static inline Vec set1(CSAMPLE v) {
+        return _mm_set1_ps(v);
+    }
+    static inline Vec add(Vec a, Vec b) {
+        return _mm_add_ps(a, b);
+    }
+    static inline Vec mul(Vec a, Vec b) {
+        return _mm_mul_ps(a, b);
+    }
+    static inline Vec minimum(Vec a, Vec b) {
+        return _mm_min_ps(a, b);
+    }
+    static inline Vec maximum(Vec a, Vec b) {
+        return _mm_max_ps(a, b);
+    }
+    static inline Vec absolute(Vec a) {
+        return _mm_and_ps(a, _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF)));
+    }
+    static inline Vec convert(const SAMPLE* p) {
+        const __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+        // Duplicate every 16-bit sample into a 32-bit lane and shift it back
+        // down arithmetically to sign-extend it.
+        return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+    }
+    static inline void interleave(CSAMPLE* pDest, Vec a, Vec b) {
+        _mm_storeu_ps(pDest, _mm_unpacklo_ps(a, b));
+        _mm_storeu_ps(pDest + 4, _mm_unpackhi_ps(a, b));
+    }
+    static inline void deinterleave(const CSAMPLE* pSrc, Vec* pA, Vec* pB) {
+        const Vec x = _mm_loadu_ps(pSrc);
+        const Vec y = _mm_loadu_ps(pSrc + 4);
+        *pA = _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 0, 2, 0));
+        *pB = _mm_shuffle_ps(x, y, _MM_SHUFFLE(3, 1, 3, 1));
+    }
+};
+
+}  // anonymous namespace
+
+// static
+bool SampleUtilKernels::getSse2(SampleUtilKernels* pKernels) {
+    SampleUtilSimd::fillKernels<Sse2>(pKernels);
+    return true;
+}
+
+#else
+
+// static
+bool SampleUtilKernels::getSse2(SampleUtilKernels* pKernels) {
+    (void)pKernels;
+    return false;
+}
+
+#endif
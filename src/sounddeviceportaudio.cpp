@@ -52,6 +52,13 @@ SoundDevicePortAudio::SoundDevicePortAudio(ConfigObject<ConfigValue> *config, So
     m_strDisplayName = QString(deviceInfo->name);
     m_iNumInputChannels = m_deviceInfo->maxInputChannels;
     m_iNumOutputChannels = m_deviceInfo->maxOutputChannels;
+
+    m_callbackTraceKey = TraceKey(
+        "SoundDevicePortAudio::callbackProcess " + m_strInternalName);
+    m_inputTimerKey = Stat::registerKey(
+        "SoundDevicePortAudio::callbackProcess input " + m_strInternalName);
+    m_outputTimerKey = Stat::registerKey(
+        "SoundDevicePortAudio::callbackProcess output " + m_strInternalName);
 }
 
 SoundDevicePortAudio::~SoundDevicePortAudio() {
@@ -280,7 +287,7 @@ int SoundDevicePortAudio::callbackProcess(unsigned long framesPerBuffer,
                                           float *output, float *in,
                                           const PaStreamCallbackTimeInfo *timeInfo,
                                           PaStreamCallbackFlags statusFlags) {
-    Trace trace("SoundDevicePortAudio::callbackProcess " + getInternalName());
+    Trace trace(m_callbackTraceKey);
 
     //qDebug() << "SoundDevicePortAudio::callbackProcess:" << getInternalName();
     // Turn on TimeCritical priority for the callback thread. If we are running
@@ -312,13 +319,13 @@ int SoundDevicePortAudio::callbackProcess(unsigned long framesPerBuffer,
 
     // Send audio from the soundcard's input off to the SoundManager...
     if (in && framesPerBuffer > 0) {
-        ScopedTimer t("SoundDevicePortAudio::callbackProcess input " + getInternalName());
+        ScopedTimer t(m_inputTimerKey);
         m_pSoundManager->pushBuffer(m_audioInputs, in, framesPerBuffer,
                                     m_inputParams.channelCount, this);
     }
 
     if (output && framesPerBuffer > 0) {
-        ScopedTimer t("SoundDevicePortAudio::callbackProcess output " + getInternalName());
+        ScopedTimer t(m_outputTimerKey);
 
         if (m_outputParams.channelCount <= 0) {
             qWarning() << "SoundDevicePortAudio::callbackProcess m_outputParams channel count is zero or less:" << m_outputParams.channelCount;
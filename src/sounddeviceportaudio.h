@@ -23,6 +23,7 @@
 #include <QString>
 
 #include "sounddevice.h"
+#include "util/trace.h"
 
 class SoundManager;
 
@@ -71,6 +72,11 @@ class SoundDevicePortAudio : public SoundDevice {
     bool m_bSetThreadPriority;
     ControlObject* m_pMasterUnderflowCount;
     int m_underflowUpdateCount;
+    // Stat keys for the callback, registered up front so that tracing the
+    // callback does not allocate.
+    TraceKey m_callbackTraceKey;
+    StatKey m_inputTimerKey;
+    StatKey m_outputTimerKey;
 };
 
 // Wrapper function to call SoundDevicePortAudio::callbackProcess. Used by
@@ -15,6 +15,8 @@
 *                                                                         *
 ***************************************************************************/
 
+#include <limits.h>
+
 #include <QtDebug>
 
 #include <taglib/tag.h>
@@ -61,6 +63,26 @@ SoundSource::SoundSource(QString qFilename)
 SoundSource::~SoundSource() {
 }
 
+unsigned SoundSource::readFloat(unsigned long size, CSAMPLE* destination) {
+    // Read in blocks so that no buffer has to be allocated.
+    const unsigned long kBlockSize = 2048;
+    SAMPLE block[kBlockSize];
+    const CSAMPLE kScale = 1.0f / SHRT_MAX;
+    unsigned long samplesRead = 0;
+    while (samplesRead < size) {
+        const unsigned long blockSize = math_min(kBlockSize, size - samplesRead);
+        const unsigned blockRead = read(blockSize, block);
+        for (unsigned i = 0; i < blockRead; ++i) {
+            destination[samplesRead + i] = block[i] * kScale;
+        }
+        samplesRead += blockRead;
+        if (blockRead < blockSize) {
+            break;
+        }
+    }
+    return samplesRead;
+}
+
 QList<long> *SoundSource::getCuePoints()
 {
     return 0;
@@ -28,13 +28,14 @@
 
 #include "defs.h"
 
-#define MIXXX_SOUNDSOURCE_API_VERSION 5
+#define MIXXX_SOUNDSOURCE_API_VERSION 6
 /** @note SoundSource API Version history:
            1 - Mixxx 1.8.0 Beta 2
            2 - Mixxx 1.9.0 Pre (added key code)
            3 - Mixxx 1.10.0 Pre (added freeing function for extensions)
            4 - Mixxx 1.11.0 Pre (added composer field to SoundSource)
            5 - Mixxx 1.12.0 Pre (added album artist and grouping fields to SoundSource)
+           6 - Mixxx 1.12.0 Pre (added readFloat to SoundSource)
   */
 
 /** Getter function to be declared by all SoundSource plugins */
@@ -61,6 +62,12 @@ public:
     virtual int open() = 0;
     virtual long seek(long) = 0;
     virtual unsigned read(unsigned long size, const SAMPLE*) = 0;
+    /** Reads size samples, scaled to [-1.0, 1.0], into destination and returns
+        the number of samples read. Decoders that produce floats or more than
+        16 bits per sample override this. The default implementation converts
+        the samples of read(), so sound sources that only implement read()
+        keep working. */
+    virtual unsigned readFloat(unsigned long size, CSAMPLE* destination);
     virtual long unsigned length() = 0;
     static float str2bpm( QString sBpm );
     virtual int parseHeader() = 0;
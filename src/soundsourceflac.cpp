@@ -25,6 +25,7 @@ SoundSourceFLAC::SoundSourceFLAC(QString filename)
     , m_decoder(NULL)
     , m_samples(0)
     , m_bps(0)
+    , m_sampleScale(0.0f)
     , m_minBlocksize(0)
     , m_maxBlocksize(0)
     , m_minFramesize(0)
@@ -77,10 +78,10 @@ int SoundSourceFLAC::open() {
     } // now number of samples etc. should be populated
     if (m_flacBuffer == NULL) {
         // we want 2 samples per frame, see ::flacWrite code -- bkgood
-        m_flacBuffer = new FLAC__int16[m_maxBlocksize * 2 /*m_iChannels*/];
+        m_flacBuffer = new FLAC__int32[m_maxBlocksize * 2 /*m_iChannels*/];
     }
     if (m_leftoverBuffer == NULL) {
-        m_leftoverBuffer = new FLAC__int16[m_maxBlocksize * 2 /*m_iChannels*/];
+        m_leftoverBuffer = new FLAC__int32[m_maxBlocksize * 2 /*m_iChannels*/];
     }
 //    qDebug() << "SSFLAC: Total samples: " << m_samples;
 //    qDebug() << "SSFLAC: Sampling rate: " << m_iSampleRate << " Hz";
@@ -110,8 +111,16 @@ long SoundSourceFLAC::seek(long filepos) {
 }
 
 unsigned int SoundSourceFLAC::read(unsigned long size, const SAMPLE *destination) {
+    return readSamples(size, const_cast<SAMPLE*>(destination));
+}
+
+unsigned int SoundSourceFLAC::readFloat(unsigned long size, CSAMPLE *destination) {
+    return readSamples(size, destination);
+}
+
+template <typename T>
+unsigned int SoundSourceFLAC::readSamples(unsigned long size, T *destBuffer) {
     if (!m_decoder) return 0;
-    SAMPLE *destBuffer(const_cast<SAMPLE*>(destination));
     unsigned int samplesWritten = 0;
     unsigned int i = 0;
     while (samplesWritten < size) {
@@ -127,7 +136,7 @@ unsigned int SoundSourceFLAC::read(unsigned long size, const SAMPLE *destination
                 break;
             }
         }
-        destBuffer[samplesWritten++] = m_flacBuffer[i++];
+        convertSample(m_flacBuffer[i++], &destBuffer[samplesWritten++]);
         --m_flacBufferLength;
     }
     if (m_flacBufferLength != 0) {
@@ -176,6 +185,17 @@ inline int SoundSourceFLAC::getShift() const {
 /**
  * Shift a sample from FLAC as necessary to get a 16-bit value.
  */
+inline void SoundSourceFLAC::convertSample(FLAC__int32 sample, SAMPLE *pDest) const {
+    *pDest = shift(sample);
+}
+
+/**
+ * Scale a sample from FLAC to [-1.0, 1.0], keeping all of its bits.
+ */
+inline void SoundSourceFLAC::convertSample(FLAC__int32 sample, CSAMPLE *pDest) const {
+    *pDest = sample * m_sampleScale;
+}
+
 inline FLAC__int16 SoundSourceFLAC::shift(FLAC__int32 sample) const {
     // this is how libsndfile does this operation and is wonderfully
     // straightforward. Just shift the sample left or right so that
@@ -249,14 +269,14 @@ FLAC__StreamDecoderWriteStatus SoundSourceFLAC::flacWrite(
     if (frame->header.channels > 1) {
         // stereo (or greater)
         for (i = 0; i < frame->header.blocksize; ++i) {
-            m_flacBuffer[m_flacBufferLength++] = shift(buffer[0][i]); // left channel
-            m_flacBuffer[m_flacBufferLength++] = shift(buffer[1][i]); // right channel
+            m_flacBuffer[m_flacBufferLength++] = buffer[0][i]; // left channel
+            m_flacBuffer[m_flacBufferLength++] = buffer[1][i]; // right channel
         }
     } else {
         // mono
         for (i = 0; i < frame->header.blocksize; ++i) {
-            m_flacBuffer[m_flacBufferLength++] = shift(buffer[0][i]); // left channel
-            m_flacBuffer[m_flacBufferLength++] = shift(buffer[0][i]); // mono channel
+            m_flacBuffer[m_flacBufferLength++] = buffer[0][i]; // left channel
+            m_flacBuffer[m_flacBufferLength++] = buffer[0][i]; // mono channel
         }
     }
     return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE; // can't anticipate any errors here
@@ -269,6 +289,8 @@ void SoundSourceFLAC::flacMetadata(const FLAC__StreamMetadata *metadata) {
         m_iChannels = metadata->data.stream_info.channels;
         m_iSampleRate = metadata->data.stream_info.sample_rate;
         m_bps = metadata->data.stream_info.bits_per_sample;
+        // 64 bits so that 32 bit samples don't shift into the sign bit.
+        m_sampleScale = 1.0f / (Q_INT64_C(1) << (m_bps - 1));
         m_minBlocksize = metadata->data.stream_info.min_blocksize;
         m_maxBlocksize = metadata->data.stream_info.max_blocksize;
         m_minFramesize = metadata->data.stream_info.min_framesize;
@@ -33,6 +33,7 @@ public:
     int open();
     long seek(long filepos);
     unsigned read(unsigned long size, const SAMPLE *buffer);
+    unsigned readFloat(unsigned long size, CSAMPLE *buffer);
     inline long unsigned length();
     int parseHeader();
     static QList<QString> supportedFileExtensions();
@@ -46,14 +47,20 @@ public:
     void flacMetadata(const FLAC__StreamMetadata *metadata);
     void flacError(FLAC__StreamDecoderErrorStatus status);
 private:
-    // these next two are inline but are defined in the cpp file because
+    // reads and converts the decoded samples for read() and readFloat()
+    template <typename T>
+    unsigned readSamples(unsigned long size, T *buffer);
+    // these are inline but are defined in the cpp file because
     // they should only be used there -- bkgood
     inline int getShift() const;
     inline FLAC__int16 shift(const FLAC__int32 sample) const;
+    inline void convertSample(const FLAC__int32 sample, SAMPLE *pDest) const;
+    inline void convertSample(const FLAC__int32 sample, CSAMPLE *pDest) const;
     QFile m_file;
     FLAC__StreamDecoder *m_decoder;
     unsigned int m_samples; // total number of samples
     unsigned int m_bps; // bits per sample
+    CSAMPLE m_sampleScale; // scales samples to [-1.0, 1.0]
     // misc bits about the flac format:
     // flac encodes from and decodes to LPCM in blocks, each block is made up of
     // subblocks (one for each chan)
@@ -63,9 +70,9 @@ private:
     unsigned int m_maxBlocksize;
     unsigned int m_minFramesize;
     unsigned int m_maxFramesize;
-    FLAC__int16 *m_flacBuffer; // buffer for the write callback to write a single frame's samples
+    FLAC__int32 *m_flacBuffer; // buffer for the write callback to write a single frame's samples
     unsigned int m_flacBufferLength;
-    FLAC__int16 *m_leftoverBuffer; // buffer to place any samples which haven't been used
+    FLAC__int32 *m_leftoverBuffer; // buffer to place any samples which haven't been used
                                    // at the end of a read call
     unsigned int m_leftoverBufferLength;
 };
@@ -19,6 +19,39 @@
 #include "soundsourcemp3.h"
 #include <QtDebug>
 
+namespace {
+
+const unsigned long kXingMagic = ('X' << 24) | ('i' << 16) | ('n' << 8) | 'g';
+const unsigned long kInfoMagic = ('I' << 24) | ('n' << 16) | ('f' << 8) | 'o';
+const unsigned long kXingFramesFlag = 0x0001;
+
+// The number of frames a seek decodes before the wanted frame to fill the
+// bit reservoir and the overlap of the synthesis.
+const int kSeekPrerollFrames = 4;
+// The number of seek tables kept in the analysis directory, about 100 kB each
+// for a five minute file.
+const int kMaxCachedSeekTables = 500;
+
+bool s_bDeferSeekTableBuilderForTest = false;
+
+/* Returns the frame count of the Xing or Info tag that encoders store in the
+   ancillary data of the first frame, or 0 if there is none. */
+unsigned long xingFrameCount(struct mad_bitptr ptr, unsigned int bitlen) {
+    if (bitlen < 64) {
+        return 0;
+    }
+    unsigned long magic = mad_bit_read(&ptr, 32);
+    if (magic != kXingMagic && magic != kInfoMagic) {
+        return 0;
+    }
+    unsigned long flags = mad_bit_read(&ptr, 32);
+    if (!(flags & kXingFramesFlag) || bitlen < 96) {
+        return 0;
+    }
+    return mad_bit_read(&ptr, 32);
+}
+
+}  // namespace
 
 SoundSourceMp3::SoundSourceMp3(QString qFilename) :
         Mixxx::SoundSource(qFilename),
@@ -32,14 +65,23 @@ SoundSourceMp3::SoundSourceMp3(QString qFilename) :
     Frame = new mad_frame;
     mad_frame_init(Frame);
 
-    m_currentSeekFrameIndex = 0;
-    m_iAvgFrameSize = 0;
+    m_pSeekTableBuilder = NULL;
+    m_iEstimatedLength = 0;
     m_iChannels = 0;
+    bitrate = 0;
+    framecount = 0;
     rest = 0;
 }
 
 SoundSourceMp3::~SoundSourceMp3()
 {
+    // The builder reads the mapped file, so stop it before unmapping.
+    if (m_pSeekTableBuilder != NULL) {
+        m_pSeekTableBuilder->stop();
+        m_pSeekTableBuilder->wait();
+        delete m_pSeekTableBuilder;
+    }
+
     mad_stream_finish(Stream);
     delete Stream;
 
@@ -53,13 +95,6 @@ SoundSourceMp3::~SoundSourceMp3()
     m_file.unmap(inputbuf);
     inputbuf = NULL;
     m_file.close();
-
-    //Free the pointers in our seek list, LIBERATE THEM!!!
-    for (int i = 0; i < m_qSeekList.count(); i++)
-    {
-        delete m_qSeekList[i];
-    }
-    m_qSeekList.clear();
 }
 
 QList<QString> SoundSourceMp3::supportedFileExtensions()
@@ -86,115 +121,353 @@ int SoundSourceMp3::open()
     mad_stream_options(Stream, MAD_OPTION_IGNORECRC);
     mad_stream_buffer(Stream, inputbuf, inputbuf_len);
 
+    bitrate = 0;
+    framecount = 0;
+    pos = mad_timer_zero;
+
+    unsigned long xingFrames = 0;
+    mad_timer_t frameDuration = mad_timer_zero;
+    if (!decodeFirstFrame(&xingFrames, &frameDuration)) {
+        qDebug() << "SSMP3: This is not a working MP3 file:" << m_qFilename;
+        return ERR;
+    }
+    const mad_units units = madUnits();
+
+    const QFileInfo fileInfo(m_qFilename);
+    const QString seekTableFile = Mp3SeekTable::cacheFileName(fileInfo);
+    if (m_seekTable.load(seekTableFile, fileInfo)) {
+        // The file has been opened before.
+        framecount = m_seekTable.frameCount();
+        bitrate = m_seekTable.bitrate();
+    } else if (xingFrames > 0) {
+        // The tag tells the length, so playback can start right away while the
+        // seek table is built in the background. The tag doesn't count its own
+        // frame, which the seek table does.
+        framecount = xingFrames + 1;
+        m_iEstimatedLength = (long unsigned) 2 * framecount *
+                mad_timer_count(frameDuration, units);
+        m_pSeekTableBuilder = new SeekTableBuilder(this, units);
+        if (!s_bDeferSeekTableBuilderForTest) {
+            m_pSeekTableBuilder->start(QThread::LowPriority);
+        }
+    } else {
+        // Decode all the headers to find the length.
+        scanSeekTable(units, NULL);
+        framecount = m_seekTable.frameCount();
+        bitrate = m_seekTable.bitrate();
+        saveSeekTable();
+    }
+    //qDebug() << "channels " << m_iChannels;
+
+    // This is not a working MP3 file.
+    if (framecount == 0) {
+        qDebug() << "SSMP3: This is not a working MP3 file:" << m_qFilename;
+        return ERR;
+    }
+
+    //Recalculate the duration by using the length of the frames. Our first
+    //guess at the duration of VBR MP3s in parseHeader() goes for speed over
+    //accuracy since it runs during a library scan. When we open() an MP3 for
+    //playback, we know the number of frames in it from the seek table or the
+    //Xing tag. We need that to better estimate the length of VBR MP3s.
+    if (getSampleRate() > 0 && m_iChannels > 0) //protect again divide by zero
+    {
+        //qDebug() << "SSMP3::open() - Setting duration to:" << length() / getSampleRate() / m_iChannels;
+        setDuration(length() / getSampleRate() / m_iChannels);
+    }
+
+    //TODO: Emit metadata updated signal?
+
+/*
+    qDebug() << "frames  = " << framecount;
+    qDebug() << "bitrate = " << bitrate/1000;
+    qDebug() << "Size    = " << length();
+ */
+
+    // Re-init buffer:
+    seek(0);
+
+    return OK;
+}
+
+bool SoundSourceMp3::decodeFirstFrame(unsigned long* pFrames,
+                                      mad_timer_t* pDuration) {
+    mad_stream stream;
+    mad_frame frame;
+    mad_stream_init(&stream);
+    mad_stream_options(&stream, MAD_OPTION_IGNORECRC);
+    mad_stream_buffer(&stream, inputbuf, inputbuf_len);
+    mad_frame_init(&frame);
+
+    bool found = false;
+    while ((stream.bufend - stream.this_frame) > 0) {
+        if (mad_frame_decode(&frame, &stream) == -1) {
+            if (!MAD_RECOVERABLE(stream.error))
+                break;
+            if (stream.error == MAD_ERROR_LOSTSYNC) {
+                // ignore LOSTSYNC due to ID3 tags
+                int tagsize = id3_tag_query(stream.this_frame, stream.bufend - stream.this_frame);
+                if (tagsize > 0) {
+                    mad_stream_skip(&stream, tagsize);
+                }
+            }
+            continue;
+        }
+        setSampleRate(frame.header.samplerate);
+        m_iChannels = MAD_NCHANNELS(&frame.header);
+        *pFrames = xingFrameCount(stream.anc_ptr, stream.anc_bitlen);
+        *pDuration = frame.header.duration;
+        found = true;
+        break;
+    }
+
+    mad_frame_finish(&frame);
+    mad_stream_finish(&stream);
+    return found;
+}
+
+void SoundSourceMp3::scanSeekTable(mad_units units,
+                                   const volatile bool* pStop) {
+    mad_stream stream;
+    mad_stream_init(&stream);
+    mad_stream_options(&stream, MAD_OPTION_IGNORECRC);
+    mad_stream_buffer(&stream, inputbuf, inputbuf_len);
+
     /*
        Decode all the headers, and fill in stats:
      */
     mad_header Header;
     mad_header_init(&Header);
-    filelength = mad_timer_zero;
-    bitrate = 0;
-    currentframe = 0;
-    pos = mad_timer_zero;
+    mad_timer_t filelength = mad_timer_zero;
+    int frames = 0;
+    int bitrateSum = 0;
 
-    while ((Stream->bufend - Stream->this_frame) > 0)
+    m_seekTable.clear();
+    while ((stream.bufend - stream.this_frame) > 0)
     {
-        if (mad_header_decode (&Header, Stream) == -1) {
-            if (!MAD_RECOVERABLE (Stream->error))
+        if (pStop != NULL && *pStop) {
+            break;
+        }
+        if (mad_header_decode (&Header, &stream) == -1) {
+            if (!MAD_RECOVERABLE (stream.error))
                 break;
-            if (Stream->error == MAD_ERROR_LOSTSYNC) {
+            if (stream.error == MAD_ERROR_LOSTSYNC) {
                 // ignore LOSTSYNC due to ID3 tags
-                int tagsize = id3_tag_query (Stream->this_frame,Stream->bufend - Stream->this_frame);
+                int tagsize = id3_tag_query (stream.this_frame,stream.bufend - stream.this_frame);
                 if (tagsize > 0) {
                     //qDebug() << "SSMP3::SSMP3() : skipping ID3 tag size " << tagsize;
-                    mad_stream_skip (Stream, tagsize);
+                    mad_stream_skip (&stream, tagsize);
                     continue;
                 }
             }
 
             // qDebug() << "MAD: ERR decoding header "
-            //          << currentframe << ": "
-            //          << mad_stream_errorstr(Stream)
+            //          << frames << ": "
+            //          << mad_stream_errorstr(&stream)
             //          << " (len=" << mad_timer_count(filelength,MAD_UNITS_MILLISECONDS)
             //          << ")";
             continue;
         }
 
-        // Grab data from Header
-
-        // This warns us only when the reported sample rate changes. (and when
-        // it is first set)
-        if (m_iSampleRate == 0 && Header.samplerate > 0) {
-            setSampleRate(Header.samplerate);
-        } else if (m_iSampleRate != Header.samplerate) {
+        // This warns us only when the reported sample rate changes.
+        if (m_iSampleRate != Header.samplerate) {
             qDebug() << "SSMP3: file has differing samplerate in some headers:"
                      << m_qFilename
                      << m_iSampleRate << "vs" << Header.samplerate;
         }
 
-        m_iChannels = MAD_NCHANNELS(&Header);
+        // Add frame to the seek table
+        m_seekTable.append(stream.this_frame - inputbuf,
+                           (qint64) 2 * mad_timer_count(filelength, units));
         mad_timer_add (&filelength, Header.duration);
-        bitrate += Header.bitrate;
-
-        // Add frame to list of frames
-        MadSeekFrameType * p = new MadSeekFrameType;
-        p->m_pStreamPos = (unsigned char *)Stream->this_frame;
-        p->pos = length();
-        m_qSeekList.append(p);
-        currentframe++;
+        bitrateSum += Header.bitrate;
+        frames++;
     }
-    //qDebug() << "channels " << m_iChannels;
 
     mad_header_finish (&Header); // This is a macro for nothing.
+    mad_stream_finish(&stream);
 
-    // This is not a working MP3 file.
-    if (currentframe == 0) {
-        qDebug() << "SSMP3: This is not a working MP3 file:" << m_qFilename;
-        return ERR;
+    if (pStop == NULL || !*pStop) {
+        m_seekTable.finish((qint64) 2 * mad_timer_count(filelength, units),
+                           frames == 0 ? 0 : bitrateSum / frames);
     }
+}
 
-    // Find average frame size
-    m_iAvgFrameSize = (currentframe == 0) ? 0 : length()/currentframe;
-    // And average bitrate
-    bitrate = (currentframe == 0) ? 0 : bitrate / currentframe;
-    framecount = currentframe;
-    currentframe = 0;
+void SoundSourceMp3::saveSeekTable() {
+    const QFileInfo fileInfo(m_qFilename);
+    if (m_seekTable.save(Mp3SeekTable::cacheFileName(fileInfo), fileInfo)) {
+        Mp3SeekTable::pruneCache(Mp3SeekTable::cacheDirectory(),
+                                 kMaxCachedSeekTables);
+    }
+}
 
-    //Recalculate the duration by using the average frame size. Our first guess at
-    //the duration of VBR MP3s in parseHeader() goes for speed over accuracy
-    //since it runs during a library scan. When we open() an MP3 for playback,
-    //we had to seek through the entire thing to build a seek table, so we've
-    //also counted the number of frames in it. We need that to better estimate
-    //the length of VBR MP3s.
-    if (getSampleRate() > 0 && m_iChannels > 0) //protect again divide by zero
-    {
-        //qDebug() << "SSMP3::open() - Setting duration to:" << framecount * m_iAvgFrameSize / getSampleRate() / m_iChannels;
-        setDuration(framecount * m_iAvgFrameSize / getSampleRate() / m_iChannels);
+bool SoundSourceMp3::findSeekFrames(long filepos, quint32* pStartOffset,
+                                    qint64* pFramePosition) {
+    // Read the state of the table before looking up the frame, so that
+    // frames the builder appends in between can't hide its end.
+    const bool complete = m_seekTable.isComplete();
+    const int frames = m_seekTable.frameCount();
+    int frameIndex = m_seekTable.findFrame(filepos);
+    if (complete || frameIndex < frames - 1) {
+        // The table reaches beyond filepos.
+        quint32 frameOffset = 0;
+        qint64 startPosition = 0;
+        return frameIndex > kSeekPrerollFrames &&
+                m_seekTable.frame(frameIndex - kSeekPrerollFrames,
+                                  pStartOffset, &startPosition) &&
+                m_seekTable.frame(frameIndex, &frameOffset, pFramePosition);
     }
 
-    //TODO: Emit metadata updated signal?
+    // The builder hasn't reached filepos yet. Waiting for it would stall the
+    // reader on a low priority thread, so scan the headers from the last
+    // frames of the table up to filepos here. Only the frame that contains
+    // filepos and the ones to start decoding from are kept.
+    QVector<quint32> offsets;
+    QVector<qint64> positions;
+    for (int i = math_max(0, frames - kSeekPrerollFrames - 1); i < frames; ++i) {
+        quint32 offset = 0;
+        qint64 position = 0;
+        if (m_seekTable.frame(i, &offset, &position)) {
+            offsets.append(offset);
+            positions.append(position);
+        }
+    }
+    frameIndex = frames - 1;
+
+    const quint32 scanOffset = offsets.isEmpty() ? 0 : offsets.last();
+    mad_stream stream;
+    mad_stream_init(&stream);
+    mad_stream_options(&stream, MAD_OPTION_IGNORECRC);
+    mad_stream_buffer(&stream, inputbuf + scanOffset, inputbuf_len - scanOffset);
+    mad_header header;
+    mad_header_init(&header);
+    const mad_units units = madUnits();
+    // The first header is the last frame of the table, if there is one.
+    bool known = !offsets.isEmpty();
+    qint64 position = known ? positions.last() : 0;
+    while ((stream.bufend - stream.this_frame) > 0) {
+        if (mad_header_decode(&header, &stream) == -1) {
+            if (!MAD_RECOVERABLE(stream.error))
+                break;
+            if (stream.error == MAD_ERROR_LOSTSYNC) {
+                // ignore LOSTSYNC due to ID3 tags
+                int tagsize = id3_tag_query(stream.this_frame, stream.bufend - stream.this_frame);
+                if (tagsize > 0) {
+                    mad_stream_skip(&stream, tagsize);
+                }
+            }
+            continue;
+        }
+        if (known) {
+            known = false;
+        } else {
+            if (position > filepos) {
+                break;
+            }
+            offsets.append(stream.this_frame - inputbuf);
+            positions.append(position);
+            ++frameIndex;
+            if (offsets.size() > kSeekPrerollFrames + 1) {
+                offsets.remove(0);
+                positions.remove(0);
+            }
+        }
+        // Frames last a whole number of samples, so adding up their durations
+        // gives the same positions as scanSeekTable().
+        position += 2 * mad_timer_count(header.duration, units);
+    }
+    mad_header_finish(&header);
+    mad_stream_finish(&stream);
 
-/*
-    qDebug() << "length  = " << filelength.seconds << "d sec.";
-    qDebug() << "frames  = " << framecount;
-    qDebug() << "bitrate = " << bitrate/1000;
-    qDebug() << "Size    = " << length();
- */
+    if (frameIndex <= kSeekPrerollFrames ||
+            offsets.size() <= kSeekPrerollFrames) {
+        return false;
+    }
+    *pStartOffset = offsets.first();
+    *pFramePosition = positions.last();
+    return true;
+}
 
-    // Re-init buffer:
-    seek(0);
+void SoundSourceMp3::truncateSeekTableForTest(int frames) {
+    QVector<quint32> offsets;
+    QVector<qint64> positions;
+    quint32 offset = 0;
+    qint64 position = 0;
+    for (int i = 0; i < frames && m_seekTable.frame(i, &offset, &position); ++i) {
+        offsets.append(offset);
+        positions.append(position);
+    }
+    m_seekTable.clear();
+    for (int i = 0; i < offsets.size(); ++i) {
+        m_seekTable.append(offsets[i], positions[i]);
+    }
+}
 
-    return OK;
+// static
+void SoundSourceMp3::setDeferSeekTableBuilderForTest(bool defer) {
+    s_bDeferSeekTableBuilderForTest = defer;
 }
 
-bool SoundSourceMp3::isValid() const {
-    return framecount > 0;
+void SoundSourceMp3::startSeekTableBuilderForTest() {
+    if (m_pSeekTableBuilder != NULL) {
+        m_pSeekTableBuilder->start(QThread::LowPriority);
+    }
+}
+
+bool SoundSourceMp3::waitForSeekTableBuilderForTest() {
+    return m_pSeekTableBuilder != NULL && m_pSeekTableBuilder->wait();
 }
 
-MadSeekFrameType* SoundSourceMp3::getSeekFrame(long frameIndex) const {
-    if (frameIndex < 0 || frameIndex >= m_qSeekList.size()) {
-        return NULL;
+mad_units SoundSourceMp3::madUnits() {
+    switch (m_iSampleRate)
+    {
+    case 8000:
+        return MAD_UNITS_8000_HZ;
+    case 11025:
+        return MAD_UNITS_11025_HZ;
+    case 12000:
+        return MAD_UNITS_12000_HZ;
+    case 16000:
+        return MAD_UNITS_16000_HZ;
+    case 22050:
+        return MAD_UNITS_22050_HZ;
+    case 24000:
+        return MAD_UNITS_24000_HZ;
+    case 32000:
+        return MAD_UNITS_32000_HZ;
+    case 44100:
+        return MAD_UNITS_44100_HZ;
+    case 48000:
+        return MAD_UNITS_48000_HZ;
+    default:             //By the MP3 specs, an MP3 _has_ to have one of the above samplerates...
+        qWarning() << "MP3 with corrupt samplerate (" << m_iSampleRate << "), defaulting to 44100";
+
+        m_iSampleRate = 44100; //Prevents division by zero errors.
+        return MAD_UNITS_44100_HZ;
     }
-    return m_qSeekList.at(frameIndex);
+}
+
+SoundSourceMp3::SeekTableBuilder::SeekTableBuilder(SoundSourceMp3* pSource,
+                                                   mad_units units)
+        : m_pSource(pSource),
+          m_units(units),
+          m_bStop(false) {
+}
+
+void SoundSourceMp3::SeekTableBuilder::stop() {
+    m_bStop = true;
+}
+
+void SoundSourceMp3::SeekTableBuilder::run() {
+    QThread::currentThread()->setObjectName("SoundSourceMp3 seek table");
+    m_pSource->scanSeekTable(m_units, &m_bStop);
+    if (!m_bStop) {
+        m_pSource->saveSeekTable();
+    }
+}
+
+bool SoundSourceMp3::isValid() const {
+    return framecount > 0;
 }
 
 long SoundSourceMp3::seek(long filepos) {
@@ -211,8 +484,6 @@ long SoundSourceMp3::seek(long filepos) {
 
     //qDebug() << "SEEK " << filepos;
 
-    MadSeekFrameType* cur = NULL;
-
     if (filepos == 0) {
         // Seek to beginning of file
 
@@ -224,28 +495,13 @@ long SoundSourceMp3::seek(long filepos) {
         mad_frame_init(Frame);
         mad_synth_init(Synth);
         rest=-1;
-
-        m_currentSeekFrameIndex = 0;
-        cur = getSeekFrame(0);
-        //frameIterator.toFront(); //Might not need to do this -- Albert June 19/2010 (during Qt3 purge)
     } else {
         //qDebug() << "seek precise";
-        // Perform precise seek accomplished by using a frame in the seek list
-
-        // Find the frame to seek to in the list
-        /*
-           MadSeekFrameType *cur = m_qSeekList.last();
-           int k=0;
-           while (cur!=0 && cur->pos>filepos)
-           {
-            cur = m_qSeekList.prev();
-         ++k;
-           }
-         */
-
-        int framePos = findFrame(filepos);
-        if (framePos == 0 || framePos > filepos || m_currentSeekFrameIndex < 5) {
-            //qDebug() << "Problem finding good seek frame (wanted " << filepos << ", got " << framePos << "), starting from 0";
+        // Perform precise seek accomplished by using a frame in the seek table.
+        quint32 startOffset = 0;
+        qint64 framePos = 0;
+        if (!findSeekFrames(filepos, &startOffset, &framePos)) {
+            //qDebug() << "Problem finding good seek frame (wanted " << filepos << "), starting from 0";
 
             // Re-init buffer:
             mad_stream_finish(Stream);
@@ -255,90 +511,38 @@ long SoundSourceMp3::seek(long filepos) {
             mad_frame_init(Frame);
             mad_synth_init(Synth);
             rest = -1;
-            m_currentSeekFrameIndex = 0;
-            cur = getSeekFrame(m_currentSeekFrameIndex);
+            // The first frame starts at the beginning of the file.
+            framePos = 0;
         } else {
-            //qDebug() << "frame pos " << cur->pos;
-
             // Start four frames before wanted frame to get in sync...
-            m_currentSeekFrameIndex -= 4;
-            cur = getSeekFrame(m_currentSeekFrameIndex);
-            if (cur != NULL) {
-                // Start from the new frame
-                mad_stream_finish(Stream);
-                mad_stream_init(Stream);
-                mad_stream_options(Stream, MAD_OPTION_IGNORECRC);
-                //        qDebug() << "mp3 restore " << cur->m_pStreamPos;
-                mad_stream_buffer(Stream, (const unsigned char *)cur->m_pStreamPos,
-                                  inputbuf_len-(long int)(cur->m_pStreamPos-(unsigned char *)inputbuf));
-
-                // Mute'ing is done here to eliminate potential pops/clicks from skipping
-                // Rob Leslie explains why here:
-                // http://www.mars.org/mailman/public/mad-dev/2001-August/000321.html
-                mad_synth_mute(Synth);
-                mad_frame_mute(Frame);
-
-                // Decode the three frames before
-                mad_frame_decode(Frame, Stream);
-                mad_frame_decode(Frame, Stream);
-                mad_frame_decode(Frame, Stream);
+            mad_stream_finish(Stream);
+            mad_stream_init(Stream);
+            mad_stream_options(Stream, MAD_OPTION_IGNORECRC);
+            //        qDebug() << "mp3 restore " << startOffset;
+            mad_stream_buffer(Stream, inputbuf + startOffset,
+                              inputbuf_len - startOffset);
+
+            // Mute'ing is done here to eliminate potential pops/clicks from skipping
+            // Rob Leslie explains why here:
+            // http://www.mars.org/mailman/public/mad-dev/2001-August/000321.html
+            mad_synth_mute(Synth);
+            mad_frame_mute(Frame);
+
+            // Decode the four frames before
+            for (int i = 0; i < kSeekPrerollFrames; ++i) {
                 mad_frame_decode(Frame, Stream);
-
-                // this is also explained in the above mad-dev post
-                mad_synth_frame(Synth, Frame);
-
-                // Set current position
-                rest = -1;
-                m_currentSeekFrameIndex += 4;
-                cur = getSeekFrame(m_currentSeekFrameIndex);
             }
-        }
-
-        // Synthesize the samples from the frame which should be discard to reach the requested position
-        if (cur != NULL) //the "if" prevents crashes on bad files.
-            discard(filepos-cur->pos);
-    }
-/*
-    else
-    {
-        qDebug() << "seek unprecise";
-        // Perform seek which is can not be done precise because no frames is in the seek list
 
-        int newpos = (int)(inputbuf_len * ((float)filepos/(float)length()));
-   //        qDebug() << "Seek to " << filepos << " " << inputbuf_len << " " << newpos;
+            // this is also explained in the above mad-dev post
+            mad_synth_frame(Synth, Frame);
 
-        // Go to an approximate position:
-        mad_stream_buffer(Stream, (unsigned char *) (inputbuf+newpos), inputbuf_len-newpos);
-        mad_synth_mute(Synth);
-        mad_frame_mute(Frame);
-
-        // Decode a few (possible wrong) buffers:
-        int no = 0;
-        int succesfull = 0;
-        while ((no<10) && (succesfull<2))
-        {
-            if (!mad_frame_decode(Frame, Stream))
-            succesfull ++;
-            no ++;
+            // Set current position
+            rest = -1;
         }
 
-        // Discard the first synth:
-        mad_synth_frame(Synth, Frame);
-
-        // Remaining samples in buffer are useless
-        rest = -1;
-
-        // Reset seek frame list
-        m_qSeekList.clear();
-        MadSeekFrameType *p = new MadSeekFrameType;
-        p->m_pStreamPos = (unsigned char*)Stream->this_frame;
-        p->pos = filepos;
-        m_qSeekList.append(p);
-        m_iSeekListMinPos = filepos;
-        m_iSeekListMaxPos = filepos;
-        m_iCurFramePos = filepos;
+        // Synthesize the samples from the frame which should be discard to reach the requested position
+        discard(filepos - framePos);
     }
- */
 
     // Unfortunately we don't know the exact fileposition. The returned position is thus an
     // approximation only:
@@ -346,45 +550,10 @@ long SoundSourceMp3::seek(long filepos) {
 }
 
 inline long unsigned SoundSourceMp3::length() {
-    enum mad_units units;
-
-    switch (m_iSampleRate)
-    {
-    case 8000:
-        units = MAD_UNITS_8000_HZ;
-        break;
-    case 11025:
-        units = MAD_UNITS_11025_HZ;
-        break;
-    case 12000:
-        units = MAD_UNITS_12000_HZ;
-        break;
-    case 16000:
-        units = MAD_UNITS_16000_HZ;
-        break;
-    case 22050:
-        units = MAD_UNITS_22050_HZ;
-        break;
-    case 24000:
-        units = MAD_UNITS_24000_HZ;
-        break;
-    case 32000:
-        units = MAD_UNITS_32000_HZ;
-        break;
-    case 44100:
-        units = MAD_UNITS_44100_HZ;
-        break;
-    case 48000:
-        units = MAD_UNITS_48000_HZ;
-        break;
-    default:             //By the MP3 specs, an MP3 _has_ to have one of the above samplerates...
-        units = MAD_UNITS_44100_HZ;
-        qWarning() << "MP3 with corrupt samplerate (" << m_iSampleRate << "), defaulting to 44100";
-
-        m_iSampleRate = 44100; //Prevents division by zero errors.
+    if (m_seekTable.isComplete()) {
+        return m_seekTable.length();
     }
-
-    return (long unsigned) 2 *mad_timer_count(filelength, units);
+    return m_iEstimatedLength;
 }
 
 /*
@@ -421,11 +590,46 @@ unsigned long SoundSourceMp3::discard(unsigned long samples_wanted) {
     return Total_samples_decoded;
 }
 
+// static
+inline void SoundSourceMp3::madScale(mad_fixed_t sample, SAMPLE* pDest)
+{
+    sample += (1L << (MAD_F_FRACBITS - 16));
+
+    if (sample >= MAD_F_ONE)
+        sample = MAD_F_ONE - 1;
+    else if (sample < -MAD_F_ONE)
+        sample = -MAD_F_ONE;
+
+    *pDest = sample >> (MAD_F_FRACBITS + 1 - 16);
+}
+
+// static
+inline void SoundSourceMp3::madScale(mad_fixed_t sample, CSAMPLE* pDest)
+{
+    if (sample >= MAD_F_ONE)
+        sample = MAD_F_ONE - 1;
+    else if (sample < -MAD_F_ONE)
+        sample = -MAD_F_ONE;
+
+    *pDest = sample * (1.0f / MAD_F_ONE);
+}
+
 /*
    read <size> samples into <destination>, and return the number of
    samples actually read.
  */
-unsigned SoundSourceMp3::read(unsigned long samples_wanted, const SAMPLE * _destination)
+unsigned SoundSourceMp3::read(unsigned long samples_wanted, const SAMPLE * destination)
+{
+    return decode(samples_wanted, const_cast<SAMPLE*>(destination));
+}
+
+unsigned SoundSourceMp3::readFloat(unsigned long samples_wanted, CSAMPLE* destination)
+{
+    return decode(samples_wanted, destination);
+}
+
+template <typename T>
+unsigned SoundSourceMp3::decode(unsigned long samples_wanted, T* destination)
 {
     if (!isValid()) {
         qDebug() << "SSMP3: Error while reading " << m_qFilename;
@@ -438,9 +642,6 @@ unsigned SoundSourceMp3::read(unsigned long samples_wanted, const SAMPLE * _dest
         qDebug() << "SoundSourceMp3 got non-even samples_wanted";
         samples_wanted--;
     }
-//     qDebug() << "frame list " << m_qSeekList.count();
-
-    SAMPLE * destination = (SAMPLE *)_destination;
     unsigned Total_samples_decoded = 0;
     int i;
 
@@ -452,14 +653,14 @@ unsigned SoundSourceMp3::read(unsigned long samples_wanted, const SAMPLE * _dest
         for (i=rest; i<Synth->pcm.length && Total_samples_decoded < samples_wanted; i++)
         {
             // Left channel
-            *(destination++) = madScale(Synth->pcm.samples[0][i]);
+            madScale(Synth->pcm.samples[0][i], destination++);
 
             /* Right channel. If the decoded stream is monophonic then
             * the right output channel is the same as the left one. */
             if (m_iChannels>1)
-                *(destination++) = madScale(Synth->pcm.samples[1][i]);
+                madScale(Synth->pcm.samples[1][i], destination++);
             else
-                *(destination++) = madScale(Synth->pcm.samples[0][i]);
+                madScale(Synth->pcm.samples[0][i], destination++);
 
             // This is safe because we have checked that samples_wanted is even.
             Total_samples_decoded += 2;
@@ -527,14 +728,14 @@ unsigned SoundSourceMp3::read(unsigned long samples_wanted, const SAMPLE * _dest
         for (i=0; i<no; i++)
         {
             // Left channel
-            *(destination++) = madScale(Synth->pcm.samples[0][i]);
+            madScale(Synth->pcm.samples[0][i], destination++);
 
             /* Right channel. If the decoded stream is monophonic then
             * the right output channel is the same as the left one. */
             if (m_iChannels==2)
-                *(destination++) = madScale(Synth->pcm.samples[1][i]);
+                madScale(Synth->pcm.samples[1][i], destination++);
             else
-                *(destination++) = madScale(Synth->pcm.samples[0][i]);
+                madScale(Synth->pcm.samples[0][i], destination++);
         }
         Total_samples_decoded += 2*no;
 
@@ -573,69 +774,3 @@ int SoundSourceMp3::parseHeader()
 
     return result ? OK : ERR;
 }
-
-int SoundSourceMp3::findFrame(int pos)
-{
-    // Guess position of frame in m_qSeekList based on average frame size
-    m_currentSeekFrameIndex = math_min(m_qSeekList.count()-1,
-                                       m_iAvgFrameSize ? (unsigned int)(pos/m_iAvgFrameSize) : 0);
-    MadSeekFrameType* temp = getSeekFrame(m_currentSeekFrameIndex);
-
-/*
-    if (temp!=0)
-        qDebug() << "find " << pos << ", got " << temp->pos;
-    else
-        qDebug() << "find " << pos << ", tried idx " << math_min(m_qSeekList.count()-1 << ", total " << pos/m_iAvgFrameSize);
- */
-
-    // Ensure that the list element is not at a greater position than pos
-    while (temp != NULL && temp->pos > pos)
-    {
-        m_currentSeekFrameIndex--;
-        temp = getSeekFrame(m_currentSeekFrameIndex);
-//        if (temp!=0) qDebug() << "backing " << pos << ", got " << temp->pos;
-    }
-
-    // Ensure that the following position is also not smaller than pos
-    if (temp != NULL)
-    {
-        temp = getSeekFrame(m_currentSeekFrameIndex);
-        while (temp != NULL && temp->pos < pos)
-        {
-            m_currentSeekFrameIndex++;
-            temp = getSeekFrame(m_currentSeekFrameIndex);
-//            if (temp!=0) qDebug() << "fwd'ing " << pos << ", got " << temp->pos;
-        }
-
-        if (temp == NULL)
-            m_currentSeekFrameIndex = m_qSeekList.count()-1;
-        else
-            m_currentSeekFrameIndex--;
-
-        temp = getSeekFrame(m_currentSeekFrameIndex);
-    }
-
-    if (temp != NULL)
-    {
-//        qDebug() << "ended at " << pos << ", got " << temp->pos;
-        return temp->pos;
-    }
-    else
-    {
-//        qDebug() << "ended at 0";
-        return 0;
-    }
-}
-
-inline signed int SoundSourceMp3::madScale(mad_fixed_t sample)
-{
-    sample += (1L << (MAD_F_FRACBITS - 16));
-
-    if (sample >= MAD_F_ONE)
-        sample = MAD_F_ONE - 1;
-    else if (sample < -MAD_F_ONE)
-        sample = -MAD_F_ONE;
-
-    return sample >> (MAD_F_FRACBITS + 1 - 16);
-}
-
@@ -30,19 +30,14 @@
 
 #include <QObject>
 #include <QFile>
+#include <QThread>
 
 #include "defs.h"
+#include "mp3seektable.h"
 #include "soundsource.h"
 
 #define READLENGTH 5000
 
-/** Struct used to store mad frames for seeking */
-typedef struct MadSeekFrameType {
-    unsigned char *m_pStreamPos;
-    long int pos;
-} MadSeekFrameType;
-
-
 /**
   *@author Tue and Ken Haste Andersen
   */
@@ -54,19 +49,67 @@ public:
     int open();
     long seek(long);
     unsigned read(unsigned long size, const SAMPLE*);
+    unsigned readFloat(unsigned long size, CSAMPLE* destination);
     unsigned long discard(unsigned long size);
     /** Return the length of the file in samples. */
     inline long unsigned length();
     int parseHeader();
     static QList<QString> supportedFileExtensions();
 
+    // Drops all but the first frames of the complete seek table, as if it
+    // was still being built.
+    void truncateSeekTableForTest(int frames);
+    // Makes open() leave the seek table builder of the files opened from now
+    // on waiting until startSeekTableBuilderForTest() is called.
+    static void setDeferSeekTableBuilderForTest(bool defer);
+    void startSeekTableBuilderForTest();
+    // Waits until the seek table builder has finished. Returns false if
+    // there is none.
+    bool waitForSeekTableBuilderForTest();
+
 private:
-    /** Returns the position of the frame which was found. The found frame is set to
-      * the current element in m_qSeekList */
-    int findFrame(int pos);
+    // Scans the frame headers into m_seekTable while the file is already
+    // being read, so that opening a file for the first time doesn't have to
+    // wait for the scan.
+    class SeekTableBuilder : public QThread {
+      public:
+        SeekTableBuilder(SoundSourceMp3* pSource, mad_units units);
+        void stop();
+
+      protected:
+        void run();
+
+      private:
+        SoundSourceMp3* m_pSource;
+        const mad_units m_units;
+        volatile bool m_bStop;
+    };
+
+    /** Decodes the first frame to find the sample rate and the number of
+      * channels. Stores the frame count of a Xing or Info tag into pFrames,
+      * or 0 if there is none, and the duration of the frame into pDuration.
+      * Returns false if there is no valid frame. */
+    bool decodeFirstFrame(unsigned long* pFrames, mad_timer_t* pDuration);
+    /** Scans all frame headers into m_seekTable and completes it. Stops
+      * early, leaving the table incomplete, once *pStop is true. */
+    void scanSeekTable(mad_units units, const volatile bool* pStop);
+    /** Stores the complete m_seekTable in the analysis directory. */
+    void saveSeekTable();
+    /** Finds the frame that contains filepos and the frame to start decoding
+      * from before it. If m_seekTable doesn't reach filepos yet, scans the
+      * frame headers after its last frame instead of waiting for the
+      * builder. Returns false if filepos is in one of the first frames. */
+    bool findSeekFrames(long filepos, quint32* pStartOffset,
+                        qint64* pFramePosition);
+    /** Returns the mad units of the sample rate, fixing up invalid ones. */
+    mad_units madUnits();
+    /** Decodes size samples into destination. Shared by read() and readFloat(). */
+    template <typename T>
+    unsigned decode(unsigned long size, T* destination);
     /** Scale the mad sample to be in 16 bit range. */
-    inline signed int madScale (mad_fixed_t sample);
-    MadSeekFrameType* getSeekFrame(long frameIndex) const;
+    static inline void madScale(mad_fixed_t sample, SAMPLE* pDest);
+    /** Scale the mad sample to be in [-1.0, 1.0]. */
+    static inline void madScale(mad_fixed_t sample, CSAMPLE* pDest);
 
     // Returns true if the loaded file is valid and usable to read audio.
     bool isValid() const;
@@ -74,10 +117,8 @@ private:
     QFile m_file;
     int bitrate;
     int framecount;
-    int currentframe;
     /** current play position. */
     mad_timer_t pos;
-    mad_timer_t filelength;
     mad_stream *Stream;
     mad_frame *Frame;
     mad_synth *Synth;
@@ -90,15 +131,17 @@ private:
     int m_iChannels;
 
     /** It is not possible to make a precise seek in an mp3 file without decoding the whole stream.
-      * To have precise seek within a limited range from the current decode position, we keep track
-      * of past decodeded frame, and their exact position. If a seek occours and it is within the
-      * range of frames we keep track of a precise seek occours, otherwise an unprecise seek is performed
+      * To have precise seek we keep the offset and the exact position of every frame in
+      * m_seekTable. A seek starts decoding a few frames before the wanted position and discards
+      * the samples up to it. The table is loaded from the analysis directory, or built when the
+      * file is opened for the first time.
       */
-    QList<MadSeekFrameType*> m_qSeekList;
-    /** Index iterator for m_qSeekList. Helps us keep track of where we are in the file. */
-    long m_currentSeekFrameIndex;
-    /** Average frame size used when searching for a frame*/
-    int m_iAvgFrameSize;
+    Mp3SeekTable m_seekTable;
+    /** Builds m_seekTable in the background when the file is opened for the first time. */
+    SeekTableBuilder* m_pSeekTableBuilder;
+    /** The length in samples until m_seekTable is complete, estimated from the Xing or Info
+      * tag. */
+    long unsigned m_iEstimatedLength;
 };
 
 
@@ -224,6 +224,44 @@ unsigned SoundSourceOggVorbis::read(volatile unsigned long size, const SAMPLE *
     return index / 2;
 }
 
+/*
+   read <size> samples into <destination> as floats, and return the number
+   of samples actually read. Reads the floats of the decoder directly instead
+   of rounding them to 16 bits.
+ */
+
+unsigned SoundSourceOggVorbis::readFloat(unsigned long size, CSAMPLE* destination) {
+    if (size % 2 != 0) {
+        qDebug() << "SoundSourceOggVorbis got non-even size in readFloat.";
+        size--;
+    }
+
+    // We pretend to the world that everything is stereo, so a frame is two
+    // samples in destination.
+    unsigned long framesRead = 0;
+    const unsigned long framesWanted = size / 2;
+    while (framesRead < framesWanted) {
+        float** pcm = NULL;
+        long ret = ov_read_float(&vf, &pcm, framesWanted - framesRead,
+                                 &current_section);
+        if (ret <= 0) {
+            // An error or EOF occured, break out and return what we have sofar.
+            break;
+        }
+
+        CSAMPLE* dest = destination + 2 * framesRead;
+        // Mono files are doubled into stereo, further channels are dropped.
+        const float* left = pcm[0];
+        const float* right = channels > 1 ? pcm[1] : pcm[0];
+        for (long i = 0; i < ret; ++i) {
+            *(dest++) = left[i];
+            *(dest++) = right[i];
+        }
+        framesRead += ret;
+    }
+    return framesRead * 2;
+}
+
 /*
    Parse the the file to get metadata
  */
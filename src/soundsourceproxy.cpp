@@ -317,6 +317,14 @@ unsigned SoundSourceProxy::read(unsigned long size, const SAMPLE * p)
     return m_pSoundSource->read(size, p);
 }
 
+unsigned SoundSourceProxy::readFloat(unsigned long size, CSAMPLE* destination)
+{
+    if (!m_pSoundSource) {
+        return 0;
+    }
+    return m_pSoundSource->readFloat(size, destination);
+}
+
 long unsigned SoundSourceProxy::length()
 {
     if (!m_pSoundSource) {
@@ -46,6 +46,7 @@ public:
     int open();
     long seek(long);
     unsigned read(unsigned long size, const SAMPLE*);
+    unsigned readFloat(unsigned long size, CSAMPLE* destination);
     long unsigned length();
     int parseHeader();
     unsigned int getSampleRate();
@@ -161,6 +161,42 @@ unsigned SoundSourceSndFile::read(unsigned long size, const SAMPLE * destination
     return 0;
 }
 
+/*
+   Like read(), but reads floats. libsndfile scales them to [-1.0, 1.0] and
+   keeps the full precision of 24 bit and float files.
+ */
+unsigned SoundSourceSndFile::readFloat(unsigned long size, CSAMPLE* destination)
+{
+    if (filelength > 0)
+    {
+        if (channels==2)
+        {
+            unsigned long no = sf_read_float(fh, destination, size);
+            for (unsigned long i=no; i<size; ++i)
+                destination[i] = 0;
+            return no;
+        }
+        else if(channels==1)
+        {
+            // Read fewer samples than requested and double them because we
+            // pretend to every reader that all files are in stereo.
+            int readNo = sf_read_float(fh, destination, size/2);
+            for(int i=(readNo-1); i>=0; i--) {
+                destination[i*2]     = destination[i];
+                destination[(i*2)+1] = destination[i];
+            }
+            return readNo * 2;
+        } else {
+            // We do not support music with more than 2 channels.
+            return 0;
+        }
+    }
+
+    // The file has errors or is not open. Tell the truth and return 0.
+    qDebug() << "The file has errors or is not open: " << m_qFilename;
+    return 0;
+}
+
 int SoundSourceSndFile::parseHeader()
 {
     QString location = getFilename();
@@ -36,6 +36,7 @@ public:
     int open();
     long seek(long);
     unsigned read(unsigned long size, const SAMPLE*);
+    unsigned readFloat(unsigned long size, CSAMPLE* destination);
     inline long unsigned length();
     int parseHeader();
     static QList<QString> supportedFileExtensions();
@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+
+#include "controllers/midi/alsaseqnotifier.h"
+
+#ifdef __ALSASEQ__
+
+#include <QList>
+#include <QSet>
+
+namespace {
+
+// Returns a set of the subscribers given as client << 8 | port.
+QSet<int> subscribers(int first = -1, int second = -1) {
+    QSet<int> result;
+    if (first >= 0) {
+        result.insert(first);
+    }
+    if (second >= 0) {
+        result.insert(second);
+    }
+    return result;
+}
+
+class AlsaSeqNotifierTest : public testing::Test {
+};
+
+TEST_F(AlsaSeqNotifierTest, FindsThePortThatGainedASubscriber) {
+    // Two identical devices, the first of which is already opened.
+    QList<QSet<int> > before;
+    before << subscribers(128 << 8) << subscribers();
+    QList<QSet<int> > after;
+    after << subscribers(128 << 8) << subscribers(128 << 8 | 1);
+    EXPECT_EQ(1, AlsaSeqNotifier::findOpenedPort(before, after));
+}
+
+TEST_F(AlsaSeqNotifierTest, NewSubscriberAmongOldOnesCounts) {
+    QList<QSet<int> > before;
+    before << subscribers(129 << 8) << subscribers(130 << 8);
+    QList<QSet<int> > after;
+    after << subscribers(129 << 8, 128 << 8) << subscribers(130 << 8);
+    EXPECT_EQ(0, AlsaSeqNotifier::findOpenedPort(before, after));
+}
+
+TEST_F(AlsaSeqNotifierTest, NoPortWithoutNewSubscriber) {
+    QList<QSet<int> > before;
+    before << subscribers(128 << 8) << subscribers();
+    // A subscriber that went away does not open a port.
+    QList<QSet<int> > after;
+    after << subscribers() << subscribers();
+    EXPECT_EQ(-1, AlsaSeqNotifier::findOpenedPort(before, after));
+}
+
+TEST_F(AlsaSeqNotifierTest, NoPortIfSeveralGainedSubscribers) {
+    // Another application opened the other device at the same time.
+    QList<QSet<int> > before;
+    before << subscribers() << subscribers();
+    QList<QSet<int> > after;
+    after << subscribers(128 << 8) << subscribers(131 << 8);
+    EXPECT_EQ(-1, AlsaSeqNotifier::findOpenedPort(before, after));
+}
+
+}  // namespace
+
+#endif  // __ALSASEQ__
@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+
+#include <QDir>
+#include <QSignalSpy>
+#include <QtDebug>
+
+#include "analyser.h"
+#include "analyserqueue.h"
+#include "library/trackcollection.h"
+#include "playerinfo.h"
+#include "test/mixxxtest.h"
+#include "trackinfoobject.h"
+
+namespace {
+
+// An analyser without stored results, so queued tracks always need analysis.
+class FakeAnalyser : public Analyser {
+  public:
+    bool initialise(TrackPointer tio, int sampleRate, int totalSamples) {
+        Q_UNUSED(tio);
+        Q_UNUSED(sampleRate);
+        Q_UNUSED(totalSamples);
+        return true;
+    }
+    bool loadStored(TrackPointer tio) const {
+        Q_UNUSED(tio);
+        return false;
+    }
+    void process(const CSAMPLE* pIn, const int iLen) {
+        Q_UNUSED(pIn);
+        Q_UNUSED(iLen);
+    }
+    void cleanup(TrackPointer tio) {
+        Q_UNUSED(tio);
+    }
+    void finalise(TrackPointer tio) {
+        Q_UNUSED(tio);
+    }
+};
+
+// The pipelines are not started, the tests take tracks for them instead.
+class AnalyserQueueTest : public MixxxTest {
+  protected:
+    virtual void SetUp() {
+        config()->set(ConfigKey("[Config]","Path"),
+                      QDir::currentPath().append("/res"));
+        m_pTrackCollection = new TrackCollection(config());
+        m_pQueue = new AnalyserQueue(m_pTrackCollection, 2);
+        for (int i = 0; i < m_pQueue->pipelineCount(); ++i) {
+            m_pQueue->addAnalyserForTest(i, new FakeAnalyser());
+        }
+        m_trackA = TrackPointer(new TrackInfoObject("a"));
+        m_trackB = TrackPointer(new TrackInfoObject("b"));
+        m_trackC = TrackPointer(new TrackInfoObject("c"));
+    }
+
+    virtual void TearDown() {
+        PlayerInfo::instance().setTrackInfo("[Channel1]", TrackPointer());
+        delete m_pQueue;
+        delete m_pTrackCollection;
+    }
+
+    void loadTrack(TrackPointer pTrack) {
+        PlayerInfo::instance().setTrackInfo("[Channel1]", pTrack);
+        m_pQueue->slotAnalyseTrack(pTrack);
+    }
+
+    TrackCollection* m_pTrackCollection;
+    AnalyserQueue* m_pQueue;
+    TrackPointer m_trackA;
+    TrackPointer m_trackB;
+    TrackPointer m_trackC;
+};
+
+TEST_F(AnalyserQueueTest, TracksInProgressAreSkipped) {
+    m_pQueue->queueAnalyseTrack(m_trackA);
+    EXPECT_EQ(m_trackA, m_pQueue->dequeueForTest(0));
+
+    // A is queued again while pipeline 0 analyses it.
+    m_pQueue->queueAnalyseTrack(m_trackA);
+    m_pQueue->queueAnalyseTrack(m_trackB);
+    EXPECT_EQ(m_trackB, m_pQueue->dequeueForTest(1));
+
+    // Nothing else can be taken until pipeline 0 is done with A.
+    m_pQueue->finishTrackForTest(1);
+    EXPECT_FALSE(m_pQueue->dequeueForTest(1));
+    m_pQueue->finishTrackForTest(0);
+    EXPECT_EQ(m_trackA, m_pQueue->dequeueForTest(1));
+}
+
+TEST_F(AnalyserQueueTest, LoadedTracksGoFirst) {
+    m_pQueue->queueAnalyseTrack(m_trackA);
+    m_pQueue->queueAnalyseTrack(m_trackB);
+    m_pQueue->queueAnalyseTrack(m_trackC);
+    PlayerInfo::instance().setTrackInfo("[Channel1]", m_trackC);
+
+    EXPECT_EQ(m_trackC, m_pQueue->dequeueForTest(0));
+    EXPECT_EQ(m_trackA, m_pQueue->dequeueForTest(1));
+}
+
+TEST_F(AnalyserQueueTest, OnlyOnePipelineIsInterrupted) {
+    m_pQueue->queueAnalyseTrack(m_trackA);
+    m_pQueue->queueAnalyseTrack(m_trackB);
+    ASSERT_EQ(m_trackA, m_pQueue->dequeueForTest(0));
+    ASSERT_EQ(m_trackB, m_pQueue->dequeueForTest(1));
+
+    loadTrack(m_trackC);
+    EXPECT_TRUE(m_pQueue->shouldYieldToLoadedTrackForTest(0));
+    EXPECT_FALSE(m_pQueue->shouldYieldToLoadedTrackForTest(1));
+    // Pipeline 0 requeues A and takes the loaded track.
+    m_pQueue->finishTrackForTest(0);
+    m_pQueue->queueAnalyseTrack(m_trackA);
+    EXPECT_EQ(m_trackC, m_pQueue->dequeueForTest(0));
+}
+
+TEST_F(AnalyserQueueTest, PipelinesAnalysingLoadedTracksAreNotInterrupted) {
+    m_pQueue->queueAnalyseTrack(m_trackA);
+    m_pQueue->queueAnalyseTrack(m_trackB);
+    ASSERT_EQ(m_trackA, m_pQueue->dequeueForTest(0));
+    ASSERT_EQ(m_trackB, m_pQueue->dequeueForTest(1));
+
+    // Pipeline 0 is analysing the loaded track, so pipeline 1 makes room
+    // for the next one.
+    PlayerInfo::instance().setTrackInfo("[Channel2]", m_trackA);
+    loadTrack(m_trackC);
+    EXPECT_FALSE(m_pQueue->shouldYieldToLoadedTrackForTest(0));
+    EXPECT_TRUE(m_pQueue->shouldYieldToLoadedTrackForTest(1));
+    PlayerInfo::instance().setTrackInfo("[Channel2]", TrackPointer());
+}
+
+TEST_F(AnalyserQueueTest, QueueEmptyIsEmittedOnce) {
+    QSignalSpy queueEmpty(m_pQueue, SIGNAL(queueEmpty()));
+    m_pQueue->queueAnalyseTrack(m_trackA);
+    m_pQueue->queueAnalyseTrack(m_trackB);
+    ASSERT_EQ(m_trackA, m_pQueue->dequeueForTest(0));
+    ASSERT_EQ(m_trackB, m_pQueue->dequeueForTest(1));
+
+    m_pQueue->finishTrackForTest(0);
+    EXPECT_EQ(0, queueEmpty.count());
+    m_pQueue->finishTrackForTest(1);
+    EXPECT_EQ(1, queueEmpty.count());
+}
+
+}  // namespace
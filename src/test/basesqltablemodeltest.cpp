@@ -0,0 +1,182 @@
+#include <gtest/gtest.h>
+
+#include <QDir>
+#include <QPersistentModelIndex>
+#include <QSignalSpy>
+#include <QtDebug>
+
+#include "library/basesqltablemodel.h"
+#include "library/trackcollection.h"
+#include "test/mixxxtest.h"
+
+namespace {
+
+// A model with an id and a position column and no track source.
+class TestTableModel : public BaseSqlTableModel {
+  public:
+    explicit TestTableModel(TrackCollection* pTrackCollection)
+            : BaseSqlTableModel(NULL, pTrackCollection,
+                                "mixxx.db.model.test") {
+        setTable("test", "id", QStringList() << "id" << "position",
+                 QSharedPointer<BaseTrackCache>());
+    }
+
+    bool isColumnInternal(int column) {
+        Q_UNUSED(column);
+        return false;
+    }
+    bool isColumnHiddenByDefault(int column) {
+        Q_UNUSED(column);
+        return false;
+    }
+    TrackModel::CapabilitiesFlags getCapabilities() const {
+        return TRACKMODELCAPS_NONE;
+    }
+
+    // The row of the only occurrence of trackId, or -1.
+    int rowOfTrack(int trackId) const {
+        const QLinkedList<int> rows = getTrackRows(trackId);
+        return rows.size() == 1 ? rows.first() : -1;
+    }
+};
+
+class BaseSqlTableModelTest : public MixxxTest {
+  protected:
+    virtual void SetUp() {
+        // QSignalSpy stores the arguments of the row signals.
+        qRegisterMetaType<QModelIndex>("QModelIndex");
+        // make sure to use the current schema.xml file in the repo
+        config()->set(ConfigKey("[Config]","Path"),
+                      QDir::currentPath().append("/res"));
+        m_pTrackCollection = new TrackCollection(config());
+        m_pModel = new TestTableModel(m_pTrackCollection);
+    }
+
+    virtual void TearDown() {
+        delete m_pModel;
+        delete m_pTrackCollection;
+    }
+
+    void setRows(const QList<int>& trackIds) {
+        m_pModel->updateRowsForTest(trackIds);
+    }
+
+    // A persistent index on the row of trackId.
+    QPersistentModelIndex persistentIndex(int trackId) {
+        return QPersistentModelIndex(
+            m_pModel->index(m_pModel->rowOfTrack(trackId), 1));
+    }
+
+    void expectRows(const QList<int>& trackIds) {
+        ASSERT_EQ(trackIds.size(), m_pModel->rowCount());
+        for (int i = 0; i < trackIds.size(); ++i) {
+            EXPECT_EQ(i, m_pModel->rowOfTrack(trackIds[i]));
+        }
+    }
+
+    TrackCollection* m_pTrackCollection;
+    TestTableModel* m_pModel;
+};
+
+TEST_F(BaseSqlTableModelTest, InsertedRowsKeepPersistentIndexes) {
+    setRows(QList<int>() << 1 << 2 << 3);
+    QPersistentModelIndex index2 = persistentIndex(2);
+    QPersistentModelIndex index3 = persistentIndex(3);
+    QSignalSpy inserted(m_pModel, SIGNAL(rowsInserted(QModelIndex, int, int)));
+    QSignalSpy removed(m_pModel, SIGNAL(rowsRemoved(QModelIndex, int, int)));
+    QSignalSpy layoutChanged(m_pModel, SIGNAL(layoutChanged()));
+
+    setRows(QList<int>() << 1 << 4 << 2 << 3 << 5);
+
+    expectRows(QList<int>() << 1 << 4 << 2 << 3 << 5);
+    ASSERT_EQ(2, inserted.count());
+    EXPECT_EQ(1, inserted.at(0).at(1).toInt());
+    EXPECT_EQ(1, inserted.at(0).at(2).toInt());
+    EXPECT_EQ(4, inserted.at(1).at(1).toInt());
+    EXPECT_EQ(0, removed.count());
+    EXPECT_EQ(0, layoutChanged.count());
+    EXPECT_EQ(2, index2.row());
+    EXPECT_EQ(1, index2.column());
+    EXPECT_EQ(3, index3.row());
+}
+
+TEST_F(BaseSqlTableModelTest, RemovedRowsKeepPersistentIndexes) {
+    setRows(QList<int>() << 1 << 2 << 3 << 4 << 5);
+    QPersistentModelIndex index2 = persistentIndex(2);
+    QPersistentModelIndex index3 = persistentIndex(3);
+    QPersistentModelIndex index5 = persistentIndex(5);
+    QSignalSpy inserted(m_pModel, SIGNAL(rowsInserted(QModelIndex, int, int)));
+    QSignalSpy removed(m_pModel, SIGNAL(rowsRemoved(QModelIndex, int, int)));
+    QSignalSpy layoutChanged(m_pModel, SIGNAL(layoutChanged()));
+
+    setRows(QList<int>() << 1 << 3 << 5);
+
+    expectRows(QList<int>() << 1 << 3 << 5);
+    // Removed from the bottom up.
+    ASSERT_EQ(2, removed.count());
+    EXPECT_EQ(3, removed.at(0).at(1).toInt());
+    EXPECT_EQ(1, removed.at(1).at(1).toInt());
+    EXPECT_EQ(0, inserted.count());
+    EXPECT_EQ(0, layoutChanged.count());
+    EXPECT_FALSE(index2.isValid());
+    EXPECT_EQ(1, index3.row());
+    EXPECT_EQ(2, index5.row());
+}
+
+TEST_F(BaseSqlTableModelTest, MovedRowsKeepPersistentIndexes) {
+    setRows(QList<int>() << 1 << 2 << 3);
+    QPersistentModelIndex index1 = persistentIndex(1);
+    QPersistentModelIndex index3 = persistentIndex(3);
+    QSignalSpy inserted(m_pModel, SIGNAL(rowsInserted(QModelIndex, int, int)));
+    QSignalSpy removed(m_pModel, SIGNAL(rowsRemoved(QModelIndex, int, int)));
+    QSignalSpy layoutChanged(m_pModel, SIGNAL(layoutChanged()));
+
+    setRows(QList<int>() << 3 << 1 << 2);
+
+    expectRows(QList<int>() << 3 << 1 << 2);
+    EXPECT_EQ(1, layoutChanged.count());
+    EXPECT_EQ(0, inserted.count());
+    EXPECT_EQ(0, removed.count());
+    EXPECT_EQ(1, index1.row());
+    EXPECT_EQ(1, index1.column());
+    EXPECT_EQ(0, index3.row());
+}
+
+TEST_F(BaseSqlTableModelTest, MixedChangesKeepPersistentIndexes) {
+    setRows(QList<int>() << 1 << 2 << 3 << 4);
+    QPersistentModelIndex index1 = persistentIndex(1);
+    QPersistentModelIndex index2 = persistentIndex(2);
+    QPersistentModelIndex index3 = persistentIndex(3);
+    QPersistentModelIndex index4 = persistentIndex(4);
+    QSignalSpy inserted(m_pModel, SIGNAL(rowsInserted(QModelIndex, int, int)));
+    QSignalSpy removed(m_pModel, SIGNAL(rowsRemoved(QModelIndex, int, int)));
+    QSignalSpy layoutChanged(m_pModel, SIGNAL(layoutChanged()));
+
+    setRows(QList<int>() << 4 << 5 << 2 << 1);
+
+    expectRows(QList<int>() << 4 << 5 << 2 << 1);
+    ASSERT_EQ(1, removed.count());
+    EXPECT_EQ(2, removed.at(0).at(1).toInt());
+    ASSERT_EQ(1, inserted.count());
+    EXPECT_EQ(1, inserted.at(0).at(1).toInt());
+    EXPECT_EQ(1, layoutChanged.count());
+    EXPECT_EQ(3, index1.row());
+    EXPECT_EQ(2, index2.row());
+    EXPECT_FALSE(index3.isValid());
+    EXPECT_EQ(0, index4.row());
+}
+
+TEST_F(BaseSqlTableModelTest, DuplicateTracksKeepTheirRows) {
+    setRows(QList<int>() << 1 << 2 << 1);
+    QPersistentModelIndex first = QPersistentModelIndex(m_pModel->index(0, 1));
+    QSignalSpy removed(m_pModel, SIGNAL(rowsRemoved(QModelIndex, int, int)));
+
+    setRows(QList<int>() << 1 << 1);
+
+    ASSERT_EQ(2, m_pModel->rowCount());
+    ASSERT_EQ(1, removed.count());
+    EXPECT_EQ(1, removed.at(0).at(1).toInt());
+    EXPECT_EQ(0, first.row());
+}
+
+}  // namespace
@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+
+#include <QDir>
+#include <QSqlQuery>
+#include <QStringList>
+#include <QtDebug>
+
+#include "library/basetrackcache.h"
+#include "library/queryutil.h"
+#include "library/trackcollection.h"
+#include "test/mixxxtest.h"
+
+namespace {
+
+const char* kTitles[] = { "love song", "night drive", "dance floor" };
+const int kNumTracks = sizeof(kTitles) / sizeof(kTitles[0]);
+
+class BaseTrackCacheTest : public MixxxTest {
+  protected:
+    virtual void SetUp() {
+        // make sure to use the current schema.xml file in the repo
+        config()->set(ConfigKey("[Config]","Path"),
+                      QDir::currentPath().append("/res"));
+        m_pTrackCollection = new TrackCollection(config());
+        QSqlDatabase database = m_pTrackCollection->getDatabase();
+
+        QSqlQuery locationQuery(database);
+        locationQuery.prepare(
+            "INSERT INTO track_locations "
+            "(location, filename, directory, filesize, fs_deleted, needs_verification) "
+            "VALUES (:location, :filename, '/music', 0, 0, 0)");
+        QSqlQuery trackQuery(database);
+        trackQuery.prepare(
+            "INSERT INTO library (artist, title, location, mixxx_deleted) "
+            "VALUES ('Artist', :title, :location, 0)");
+        for (int i = 0; i < kNumTracks; ++i) {
+            const QString filename = QString("%1.mp3").arg(kTitles[i]);
+            locationQuery.bindValue(":location", "/music/" + filename);
+            locationQuery.bindValue(":filename", filename);
+            ASSERT_TRUE(locationQuery.exec());
+            trackQuery.bindValue(":title", kTitles[i]);
+            trackQuery.bindValue(":location", locationQuery.lastInsertId());
+            ASSERT_TRUE(trackQuery.exec());
+            m_trackIds.insert(trackQuery.lastInsertId().toInt());
+        }
+
+        // The columns MixxxLibraryFeature caches.
+        QStringList columns;
+        columns << "library." + LIBRARYTABLE_ID
+                << "library." + LIBRARYTABLE_PLAYED
+                << "library." + LIBRARYTABLE_TIMESPLAYED
+                << "library." + LIBRARYTABLE_ARTIST
+                << "library." + LIBRARYTABLE_TITLE
+                << "library." + LIBRARYTABLE_ALBUM
+                << "library." + LIBRARYTABLE_ALBUMARTIST
+                << "library." + LIBRARYTABLE_YEAR
+                << "library." + LIBRARYTABLE_DURATION
+                << "library." + LIBRARYTABLE_RATING
+                << "library." + LIBRARYTABLE_GENRE
+                << "library." + LIBRARYTABLE_COMPOSER
+                << "library." + LIBRARYTABLE_GROUPING
+                << "library." + LIBRARYTABLE_FILETYPE
+                << "library." + LIBRARYTABLE_TRACKNUMBER
+                << "library." + LIBRARYTABLE_KEY
+                << "library." + LIBRARYTABLE_KEY_ID
+                << "library." + LIBRARYTABLE_DATETIMEADDED
+                << "library." + LIBRARYTABLE_BPM
+                << "library." + LIBRARYTABLE_BPM_LOCK
+                << "library." + LIBRARYTABLE_BITRATE
+                << "track_locations.location"
+                << "track_locations.fs_deleted"
+                << "library." + LIBRARYTABLE_COMMENT
+                << "library." + LIBRARYTABLE_MIXXXDELETED;
+        QSqlQuery viewQuery(database);
+        viewQuery.prepare(QString(
+            "CREATE TEMPORARY VIEW IF NOT EXISTS library_cache_test_view AS "
+            "SELECT %1 FROM library "
+            "INNER JOIN track_locations ON library.location = track_locations.id")
+                .arg(columns.join(",")));
+        ASSERT_TRUE(viewQuery.exec());
+        for (QStringList::iterator it = columns.begin(); it != columns.end(); ++it) {
+            *it = it->replace("library.", "").replace("track_locations.", "");
+        }
+
+        m_pCache = new BaseTrackCache(m_pTrackCollection,
+                                      "library_cache_test_view",
+                                      LIBRARYTABLE_ID, columns, true);
+        m_pCache->buildIndex();
+    }
+
+    virtual void TearDown() {
+        delete m_pCache;
+        // make sure we clean up the db
+        QSqlQuery query(m_pTrackCollection->getDatabase());
+        query.exec("DROP VIEW IF EXISTS library_cache_test_view");
+        query.exec("DELETE FROM library");
+        query.exec("DELETE FROM track_locations");
+        delete m_pTrackCollection;
+    }
+
+    QHash<int, int> filter(const QString& searchQuery) {
+        QHash<int, int> trackToIndex;
+        m_pCache->filterAndSort(m_trackIds, searchQuery, QString(),
+                                m_pCache->fieldIndex(LIBRARYTABLE_TITLE),
+                                Qt::AscendingOrder, &trackToIndex);
+        return trackToIndex;
+    }
+
+    TrackCollection* m_pTrackCollection;
+    BaseTrackCache* m_pCache;
+    QSet<int> m_trackIds;
+};
+
+TEST_F(BaseTrackCacheTest, EmptyQueryMatchesAllTracks) {
+    EXPECT_EQ(kNumTracks, filter("").size());
+}
+
+TEST_F(BaseTrackCacheTest, WhitespaceOnlyQueryMatchesAllTracks) {
+    EXPECT_EQ(kNumTracks, filter(" ").size());
+    EXPECT_EQ(kNumTracks, filter("   \t ").size());
+}
+
+TEST_F(BaseTrackCacheTest, SurroundingWhitespaceIsIgnored) {
+    QHash<int, int> trackToIndex = filter("  night  ");
+    EXPECT_EQ(1, trackToIndex.size());
+}
+
+}  // namespace
@@ -123,4 +123,40 @@ TEST_F(BeatMapTest, TestNthBeatWhenNotOnBeat) {
     }
 }
 
+TEST_F(BeatMapTest, TestSequentialAndRandomQueries) {
+    const double bpm = 60.0;
+    m_pTrack->setBpm(bpm);
+    m_pTrack->setSampleRate(m_iSampleRate);
+    double beatLengthFrames = getBeatLengthFrames(bpm);
+    double startOffsetFrames = 7;
+    double beatLengthSamples = getBeatLengthSamples(bpm);
+    double startOffsetSamples = startOffsetFrames * 2;
+    const int numBeats = 100;
+    QVector<double> beats = createBeatVector(startOffsetFrames, numBeats, beatLengthFrames);
+    BeatMap map(m_pTrack, beats);
+
+    // Play forward in small steps, like the engine does, then jump around.
+    for (double position = startOffsetSamples + 2;
+         position < startOffsetSamples + beatLengthSamples * (numBeats - 1);
+         position += beatLengthSamples / 8) {
+        int beat = static_cast<int>(
+            (position - startOffsetSamples) / beatLengthSamples);
+        EXPECT_DOUBLE_EQ(startOffsetSamples + beatLengthSamples * (beat + 1),
+                         map.findNextBeat(position));
+        EXPECT_DOUBLE_EQ(startOffsetSamples + beatLengthSamples * beat,
+                         map.findPrevBeat(position));
+    }
+    const int jumps[] = { 90, 3, 50, 51, 2, 99, 0 };
+    for (unsigned int i = 0; i < sizeof(jumps) / sizeof(jumps[0]); ++i) {
+        double beat = startOffsetSamples + beatLengthSamples * jumps[i];
+        EXPECT_DOUBLE_EQ(beat, map.findNextBeat(beat));
+        EXPECT_DOUBLE_EQ(beat, map.findPrevBeat(beat));
+    }
+
+    // Queries see the beats after they change.
+    map.translate(beatLengthSamples / 2);
+    EXPECT_DOUBLE_EQ(startOffsetSamples + beatLengthSamples * 1.5,
+                     map.findNextBeat(startOffsetSamples + beatLengthSamples));
+}
+
 }  // namespace
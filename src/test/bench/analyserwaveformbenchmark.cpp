@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+
+#include <QtDebug>
+#include <QVector>
+
+#include "analyserwaveform.h"
+#include "defs.h"
+#include "engine/enginefiltercrossover.h"
+#include "engine/enginefilteriir.h"
+#include "mathstuff.h"
+#include "test/bench/benchmark.h"
+#include "test/mixxxtest.h"
+#include "trackinfoobject.h"
+
+namespace {
+
+// The block size of AnalyserQueue.
+const int kBlockSize = 8192;
+
+// Runs the waveform band filters over a synthetic track of
+// --bench_track_seconds seconds, e.g. 3600 for an hour-long file. The track
+// is a block of noise with a few tones that is processed repeatedly, so that
+// long tracks don't need to fit into memory.
+class AnalyserWaveformBenchmark : public MixxxTest {
+  protected:
+    virtual void SetUp() {
+        m_input.resize(kBlockSize);
+        unsigned int seed = 1;
+        for (int i = 0; i < kBlockSize; i += 2) {
+            seed = seed * 1103515245 + 12345;
+            const CSAMPLE noise = (seed >> 16) / 65536.0f - 0.5f;
+            const int frame = i / 2;
+            m_input[i] = 0.2 * sin(two_pi * 100.0 * frame / 44100) +
+                    0.2 * sin(two_pi * 1500.0 * frame / 44100) + 0.1 * noise;
+            m_input[i + 1] = 0.2 * sin(two_pi * 10000.0 * frame / 44100) +
+                    0.1 * noise;
+        }
+        for (int band = 0; band < FilterCount; ++band) {
+            m_bands[band].resize(kBlockSize);
+        }
+    }
+
+    int trackSamples(int sampleRate) const {
+        return Benchmark::options().trackSeconds * sampleRate * 2;
+    }
+
+    // Analysing a whole track takes long enough that fewer iterations still
+    // give a stable distribution.
+    static int trackIterations() {
+        return qMax(1, Benchmark::options().iterations / 100);
+    }
+
+    void addTrackParameters(Benchmark* pBench, int sampleRate) const {
+        pBench->addParameter("track_seconds", Benchmark::options().trackSeconds);
+        pBench->addParameter("sample_rate", sampleRate);
+    }
+
+    QVector<CSAMPLE> m_input;
+    QVector<CSAMPLE> m_bands[FilterCount];
+};
+
+// The filters AnalyserWaveform used before EngineFilterCrossover: three
+// separate passes with coefficients for 44.1 kHz.
+TEST_F(AnalyserWaveformBenchmark, EngineFilterIIRBands) {
+    Benchmark bench("AnalyserWaveform EngineFilterIIR bands", 1,
+                    trackIterations());
+    addTrackParameters(&bench, 44100);
+    const int samples = trackSamples(44100);
+    while (bench.keepRunning()) {
+        EngineFilterIIR low(bessel_lowpass4, 4);
+        EngineFilterIIR mid(bessel_bandpass, 8);
+        EngineFilterIIR high(bessel_highpass4, 4);
+        for (int i = 0; i < samples; i += kBlockSize) {
+            low.process(m_input.constData(), m_bands[Low].data(), kBlockSize);
+            mid.process(m_input.constData(), m_bands[Mid].data(), kBlockSize);
+            high.process(m_input.constData(), m_bands[High].data(), kBlockSize);
+        }
+    }
+}
+
+TEST_F(AnalyserWaveformBenchmark, EngineFilterCrossover) {
+    const int sampleRates[] = { 44100, 96000 };
+    for (unsigned int r = 0; r < sizeof(sampleRates) / sizeof(int); ++r) {
+        const int sampleRate = sampleRates[r];
+        Benchmark bench("EngineFilterCrossover::process", 1,
+                        trackIterations());
+        addTrackParameters(&bench, sampleRate);
+        const int samples = trackSamples(sampleRate);
+        while (bench.keepRunning()) {
+            EngineFilterCrossover crossover(sampleRate, 600.0, 4000.0);
+            for (int i = 0; i < samples; i += kBlockSize) {
+                crossover.process(m_input.constData(), m_bands[Low].data(),
+                                  m_bands[Mid].data(), m_bands[High].data(),
+                                  kBlockSize);
+            }
+        }
+    }
+}
+
+// The whole analyser, including the waveform strides.
+TEST_F(AnalyserWaveformBenchmark, Process) {
+    AnalyserWaveform analyser(config());
+    const int sampleRate = 44100;
+    Benchmark bench("AnalyserWaveform::process", 1, trackIterations());
+    addTrackParameters(&bench, sampleRate);
+    const int samples = trackSamples(sampleRate);
+    while (bench.keepRunning()) {
+        bench.pauseTiming();
+        TrackPointer pTrack(new TrackInfoObject("benchmark"));
+        pTrack->setSampleRate(sampleRate);
+        analyser.initialise(pTrack, sampleRate, samples);
+        bench.resumeTiming();
+        for (int i = 0; i < samples; i += kBlockSize) {
+            analyser.process(m_input.constData(), kBlockSize);
+        }
+        bench.pauseTiming();
+        analyser.cleanup(pTrack);
+        bench.resumeTiming();
+    }
+}
+
+}  // namespace
@@ -0,0 +1,294 @@
+// benchmark.cpp
+// A small microbenchmark framework for the mixxx-bench target.
+
+#include <QFile>
+#include <QStringList>
+#include <QTextStream>
+#include <QtDebug>
+#include <QtAlgorithms>
+
+#include <cmath>
+#include <cstdio>
+
+#include "test/bench/benchmark.h"
+
+namespace {
+
+BenchmarkOptions s_options;
+QList<BenchmarkResult> s_results;
+
+// Nearest-rank percentile of a sorted, non-empty vector.
+qint64 percentile(const QVector<qint64>& sorted, double fraction) {
+    int index = static_cast<int>(ceil(fraction * sorted.size())) - 1;
+    index = qBound(0, index, sorted.size() - 1);
+    return sorted[index];
+}
+
+QString jsonString(const QString& string) {
+    QString escaped = string;
+    escaped.replace("\\", "\\\\");
+    escaped.replace("\"", "\\\"");
+    return QString("\"%1\"").arg(escaped);
+}
+
+bool parseInt(const QString& value, int minimum, int* pResult) {
+    bool ok = false;
+    int result = value.toInt(&ok);
+    if (!ok || result < minimum) {
+        return false;
+    }
+    *pResult = result;
+    return true;
+}
+
+} // anonymous namespace
+
+BenchmarkOptions::BenchmarkOptions()
+        : warmupIterations(100),
+          iterations(1000),
+          decks(4),
+          samplers(4),
+          parallelProcessing(false),
+          trackSeconds(30),
+          libraryTracks(10000),
+          configKeys(5000) {
+    bufferFrames << 64 << 256 << 1024;
+}
+
+bool BenchmarkOptions::parse(int* argc, char** argv) {
+    int kept = 1;
+    for (int i = 1; i < *argc; ++i) {
+        const QString arg = QString::fromLocal8Bit(argv[i]);
+        if (!arg.startsWith("--bench_")) {
+            argv[kept++] = argv[i];
+            continue;
+        }
+
+        const int equals = arg.indexOf('=');
+        const QString key = arg.mid(8, equals < 0 ? -1 : equals - 8);
+        const QString value = equals < 0 ? QString() : arg.mid(equals + 1);
+        bool ok = true;
+        if (key == "warmup") {
+            ok = parseInt(value, 0, &warmupIterations);
+        } else if (key == "iterations") {
+            ok = parseInt(value, 1, &iterations);
+        } else if (key == "decks") {
+            ok = parseInt(value, 0, &decks);
+        } else if (key == "samplers") {
+            ok = parseInt(value, 0, &samplers);
+        } else if (key == "buffer_frames") {
+            bufferFrames.clear();
+            foreach (const QString& frames, value.split(',')) {
+                int parsed = 0;
+                ok = ok && parseInt(frames, 1, &parsed);
+                bufferFrames.append(parsed);
+            }
+        } else if (key == "parallel") {
+            int parallel = 0;
+            ok = parseInt(value, 0, &parallel);
+            parallelProcessing = parallel != 0;
+        } else if (key == "track_seconds") {
+            ok = parseInt(value, 1, &trackSeconds);
+        } else if (key == "library_tracks") {
+            ok = parseInt(value, 1, &libraryTracks);
+        } else if (key == "config_keys") {
+            ok = parseInt(value, 1, &configKeys);
+        } else if (key == "midi_stream") {
+            midiStreamPath = value;
+        } else if (key == "json") {
+            jsonPath = value;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            fprintf(stderr, "Invalid benchmark argument: %s\n", argv[i]);
+            return false;
+        }
+    }
+    *argc = kept;
+    argv[kept] = NULL;
+    return true;
+}
+
+// static
+void BenchmarkOptions::printUsage() {
+    BenchmarkOptions defaults;
+    QStringList frames;
+    foreach (int size, defaults.bufferFrames) {
+        frames.append(QString::number(size));
+    }
+    fprintf(stderr,
+            "Benchmark options:\n"
+            "  --bench_warmup=N          untimed iterations (default %d)\n"
+            "  --bench_iterations=N      timed iterations (default %d)\n"
+            "  --bench_decks=N           decks in the engine (default %d)\n"
+            "  --bench_samplers=N        samplers in the engine (default %d)\n"
+            "  --bench_buffer_frames=N,M buffer sizes in frames (default %s)\n"
+            "  --bench_parallel=0|1      parallel channel processing (default 0)\n"
+            "  --bench_track_seconds=N   length of synthetic tracks (default %d)\n"
+            "  --bench_library_tracks=N  tracks in the library (default %d)\n"
+            "  --bench_config_keys=N     keys in the configuration (default %d)\n"
+            "  --bench_midi_stream=FILE  MIDI stream the jitter benchmark replays\n"
+            "  --bench_json=FILE         write results as JSON to FILE\n"
+            "Use --gtest_filter to select benchmarks.\n",
+            defaults.warmupIterations, defaults.iterations, defaults.decks,
+            defaults.samplers, qPrintable(frames.join(",")),
+            defaults.trackSeconds, defaults.libraryTracks,
+            defaults.configKeys);
+}
+
+Benchmark::Benchmark(const QString& name)
+        : m_iWarmupIterations(s_options.warmupIterations),
+          m_iIterations(s_options.iterations),
+          m_iIteration(-1),
+          m_bRunning(false),
+          m_iPausedNanos(0) {
+    init(name);
+}
+
+Benchmark::Benchmark(const QString& name, int warmupIterations, int iterations)
+        : m_iWarmupIterations(warmupIterations),
+          m_iIterations(iterations),
+          m_iIteration(-1),
+          m_bRunning(false),
+          m_iPausedNanos(0) {
+    init(name);
+}
+
+Benchmark::~Benchmark() {
+}
+
+void Benchmark::init(const QString& name) {
+    m_result.name = name;
+    m_samples.reserve(m_iIterations);
+}
+
+void Benchmark::addParameter(const QString& key, const QString& value) {
+    m_result.parameters.append(qMakePair(key, value));
+}
+
+void Benchmark::addParameter(const QString& key, int value) {
+    addParameter(key, QString::number(value));
+}
+
+bool Benchmark::keepRunning() {
+    if (m_bRunning) {
+        const qint64 elapsed = m_timer.elapsed() - m_iPausedNanos;
+        if (m_iIteration >= m_iWarmupIterations) {
+            m_samples.append(elapsed);
+        }
+    }
+    if (++m_iIteration >= m_iWarmupIterations + m_iIterations) {
+        m_bRunning = false;
+        finish();
+        return false;
+    }
+    m_bRunning = true;
+    m_iPausedNanos = 0;
+    m_timer.start();
+    return true;
+}
+
+void Benchmark::pauseTiming() {
+    m_pauseTimer.start();
+}
+
+void Benchmark::resumeTiming() {
+    m_iPausedNanos += m_pauseTimer.elapsed();
+}
+
+void Benchmark::report(const QVector<qint64>& samples) {
+    m_samples = samples;
+    m_bRunning = false;
+    finish();
+}
+
+void Benchmark::finish() {
+    QVector<qint64> sorted = m_samples;
+    qSort(sorted);
+
+    double sum = 0.0;
+    foreach (qint64 sample, sorted) {
+        sum += sample;
+    }
+    const int n = sorted.size();
+    m_result.iterations = n;
+    m_result.mean = n > 0 ? sum / n : 0.0;
+    double squares = 0.0;
+    foreach (qint64 sample, sorted) {
+        const double delta = sample - m_result.mean;
+        squares += delta * delta;
+    }
+    m_result.stddev = n > 1 ? sqrt(squares / (n - 1)) : 0.0;
+    m_result.min = n > 0 ? sorted.first() : 0;
+    m_result.max = n > 0 ? sorted.last() : 0;
+    m_result.p50 = n > 0 ? percentile(sorted, 0.5) : 0;
+    m_result.p90 = n > 0 ? percentile(sorted, 0.9) : 0;
+    m_result.p99 = n > 0 ? percentile(sorted, 0.99) : 0;
+    m_result.p999 = n > 0 ? percentile(sorted, 0.999) : 0;
+    s_results.append(m_result);
+
+    QStringList parameters;
+    for (int i = 0; i < m_result.parameters.size(); ++i) {
+        parameters.append(QString("%1=%2").arg(m_result.parameters[i].first,
+                                               m_result.parameters[i].second));
+    }
+    printf("%-40s %-44s mean %10.0f ns  p50 %10lld  p99 %10lld  max %10lld\n",
+           qPrintable(m_result.name), qPrintable(parameters.join(" ")),
+           m_result.mean, static_cast<long long>(m_result.p50),
+           static_cast<long long>(m_result.p99),
+           static_cast<long long>(m_result.max));
+    fflush(stdout);
+}
+
+// static
+const BenchmarkOptions& Benchmark::options() {
+    return s_options;
+}
+
+// static
+BenchmarkOptions* Benchmark::mutableOptions() {
+    return &s_options;
+}
+
+// static
+const QList<BenchmarkResult>& Benchmark::results() {
+    return s_results;
+}
+
+// static
+bool Benchmark::writeJson(const QString& path) {
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        qWarning() << "Could not open" << path << "for writing.";
+        return false;
+    }
+
+    QTextStream out(&file);
+    out << "{\n  \"warmup_iterations\": " << s_options.warmupIterations
+        << ",\n  \"benchmarks\": [";
+    for (int i = 0; i < s_results.size(); ++i) {
+        const BenchmarkResult& result = s_results[i];
+        out << (i == 0 ? "\n" : ",\n")
+            << "    {\n      \"name\": " << jsonString(result.name)
+            << ",\n      \"parameters\": {";
+        for (int j = 0; j < result.parameters.size(); ++j) {
+            out << (j == 0 ? "" : ", ")
+                << jsonString(result.parameters[j].first) << ": "
+                << jsonString(result.parameters[j].second);
+        }
+        out << "},\n      \"iterations\": " << result.iterations
+            << ",\n      \"unit\": \"ns\""
+            << ",\n      \"mean\": " << QString::number(result.mean, 'f', 1)
+            << ",\n      \"stddev\": " << QString::number(result.stddev, 'f', 1)
+            << ",\n      \"min\": " << result.min
+            << ",\n      \"p50\": " << result.p50
+            << ",\n      \"p90\": " << result.p90
+            << ",\n      \"p99\": " << result.p99
+            << ",\n      \"p999\": " << result.p999
+            << ",\n      \"max\": " << result.max
+            << "\n    }";
+    }
+    out << "\n  ]\n}\n";
+    return out.status() == QTextStream::Ok;
+}
@@ -0,0 +1,121 @@
+// benchmark.h
+// A small microbenchmark framework for the mixxx-bench target.
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+#include "util/performancetimer.h"
+
+// Global options for all benchmarks. Parsed from the command line by
+// bench/main.cpp before any benchmark runs.
+struct BenchmarkOptions {
+    BenchmarkOptions();
+
+    // Parses and removes all --bench_* arguments from argv. Returns false and
+    // prints a message if an argument could not be parsed.
+    bool parse(int* argc, char** argv);
+    static void printUsage();
+
+    // Untimed iterations run before measuring.
+    int warmupIterations;
+    // Timed iterations.
+    int iterations;
+    // Number of decks and samplers the engine benchmarks are run with.
+    int decks;
+    int samplers;
+    // Buffer sizes in frames the engine benchmarks are run with.
+    QList<int> bufferFrames;
+    // Whether the engine benchmarks use parallel channel processing.
+    bool parallelProcessing;
+    // Length of the synthetic tracks the analysis benchmarks decode.
+    int trackSeconds;
+    // Number of tracks the library benchmarks populate the database with.
+    int libraryTracks;
+    // Number of keys in the configuration the startup benchmarks load.
+    int configKeys;
+    // If not empty, the MIDI jitter benchmark replays this recorded stream
+    // instead of a synthetic one.
+    QString midiStreamPath;
+    // If not empty, all results are written to this file as JSON.
+    QString jsonPath;
+};
+
+// The distribution of the timed iterations of one benchmark run.
+struct BenchmarkResult {
+    QString name;
+    QList<QPair<QString, QString> > parameters;
+    int iterations;
+    // All times in nanoseconds.
+    double mean;
+    double stddev;
+    qint64 min;
+    qint64 p50;
+    qint64 p90;
+    qint64 p99;
+    qint64 p999;
+    qint64 max;
+};
+
+// Benchmark times the body of a loop like this:
+//
+//   Benchmark bench("EngineMaster::process");
+//   bench.addParameter("buffer_frames", frames);
+//   while (bench.keepRunning()) {
+//       m_pEngineMaster->process(frames * 2);
+//   }
+//
+// Every pass through the loop is timed individually so that the result is a
+// latency distribution rather than an average. The first
+// BenchmarkOptions::warmupIterations passes are not recorded. When the loop
+// ends the result is printed and stored for the JSON report.
+class Benchmark {
+  public:
+    explicit Benchmark(const QString& name);
+    // For benchmarks whose iterations are too expensive to run the default
+    // number of times.
+    Benchmark(const QString& name, int warmupIterations, int iterations);
+    virtual ~Benchmark();
+
+    void addParameter(const QString& key, const QString& value);
+    void addParameter(const QString& key, int value);
+
+    // Starts the next iteration and returns true, or finishes the benchmark
+    // and returns false once all iterations have run.
+    bool keepRunning();
+
+    // Excludes per-iteration setup from the measurement.
+    void pauseTiming();
+    void resumeTiming();
+
+    // Finishes a benchmark that is not timed by keepRunning() with samples in
+    // nanoseconds that it measured itself, e.g. simulated latencies.
+    void report(const QVector<qint64>& samples);
+
+    static const BenchmarkOptions& options();
+    static BenchmarkOptions* mutableOptions();
+    static const QList<BenchmarkResult>& results();
+
+    // Writes all results collected so far to path. Returns false on error.
+    static bool writeJson(const QString& path);
+
+  private:
+    void init(const QString& name);
+    void finish();
+
+    BenchmarkResult m_result;
+    const int m_iWarmupIterations;
+    const int m_iIterations;
+    int m_iIteration;
+    bool m_bRunning;
+    qint64 m_iPausedNanos;
+    PerformanceTimer m_timer;
+    PerformanceTimer m_pauseTimer;
+    QVector<qint64> m_samples;
+};
+
+#endif /* BENCHMARK_H */
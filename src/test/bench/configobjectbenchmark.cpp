@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+
+#include <QFile>
+#include <QTemporaryFile>
+#include <QTextStream>
+#include <QtDebug>
+
+#include "configobject.h"
+#include "test/bench/benchmark.h"
+#include "test/mixxxtest.h"
+
+namespace {
+
+// The number of items per group, roughly what a channel's group has.
+const int kItemsPerGroup = 50;
+
+// Loads and probes a mixxx.cfg with --bench_config_keys keys, like the
+// controls and skin elements created at startup do.
+class ConfigObjectBenchmark : public MixxxTest {
+  protected:
+    virtual void SetUp() {
+        ASSERT_TRUE(m_file.open());
+        QTextStream stream(&m_file);
+        const int keys = Benchmark::options().configKeys;
+        for (int i = 0; i < keys; ++i) {
+            const ConfigKey key = configKey(i);
+            if (i % kItemsPerGroup == 0) {
+                stream << "\n" << key.group << "\n";
+            }
+            stream << key.item << " " << i << "\n";
+        }
+        stream.flush();
+        m_file.close();
+    }
+
+    static ConfigKey configKey(int i) {
+        return ConfigKey(QString("[Group%1]").arg(i / kItemsPerGroup),
+                         QString("item_%1").arg(i % kItemsPerGroup));
+    }
+
+    QTemporaryFile m_file;
+};
+
+TEST_F(ConfigObjectBenchmark, Load) {
+    const BenchmarkOptions& options = Benchmark::options();
+    const int keys = options.configKeys;
+    Benchmark bench("ConfigObject::ConfigObject",
+                    qMin(options.warmupIterations, 10),
+                    qMax(1, options.iterations / 10));
+    bench.addParameter("keys", keys);
+    while (bench.keepRunning()) {
+        ConfigObject<ConfigValue> config(m_file.fileName());
+    }
+}
+
+TEST_F(ConfigObjectBenchmark, GetValueString) {
+    const int keys = Benchmark::options().configKeys;
+    ConfigObject<ConfigValue> config(m_file.fileName());
+    QList<ConfigKey> configKeys;
+    for (int i = 0; i < keys; ++i) {
+        configKeys.append(configKey(i));
+    }
+
+    // One iteration probes every key once.
+    Benchmark bench("ConfigObject::getValueString");
+    bench.addParameter("keys", keys);
+    while (bench.keepRunning()) {
+        foreach (const ConfigKey& key, configKeys) {
+            config.getValueString(key);
+        }
+    }
+}
+
+}  // namespace
@@ -0,0 +1,267 @@
+#include <gtest/gtest.h>
+
+#include <QByteArray>
+#include <QList>
+#include <QtDebug>
+
+#include "engine/channelmixer.h"
+#include "test/bench/benchmark.h"
+#include "test/mockedenginebackendtest.h"
+
+namespace {
+
+// Extends MockedEngineBackendTest, which provides three playing decks, with
+// the number of decks and samplers requested on the command line. Every
+// channel plays a looping fake track through a MockScaler so that the
+// benchmarks measure the mixing engine rather than the readers.
+class EngineBenchmark : public MockedEngineBackendTest {
+  protected:
+    virtual void SetUp() {
+        const BenchmarkOptions& options = Benchmark::options();
+        config()->set(ConfigKey("[Soundcard]", "ParallelChannelProcessing"),
+                      ConfigValue(options.parallelProcessing ? 1 : 0));
+        MockedEngineBackendTest::SetUp();
+
+        m_channels << m_pChannel1 << m_pChannel2 << m_pChannel3;
+        for (int i = m_channels.size() + 1; i <= options.decks; ++i) {
+            addChannel(QString("[Test%1]").arg(i), true);
+        }
+        for (int i = 1; i <= options.samplers; ++i) {
+            addChannel(QString("[Sampler%1]").arg(i), false);
+        }
+
+        // Decks of the fixture that were not asked for are stopped and idle.
+        const int fixtureDecks = 3;
+        for (int i = 0; i < m_channels.size(); ++i) {
+            const bool play = i >= fixtureDecks || i < options.decks;
+            setChannelValue(m_channels[i], "repeat", 1.0);
+            setChannelValue(m_channels[i], "play", play ? 1.0 : 0.0);
+        }
+    }
+
+    virtual void TearDown() {
+        m_channels.clear();
+        MockedEngineBackendTest::TearDown();
+        qDeleteAll(m_extraScalers);
+        m_extraScalers.clear();
+        m_groups.clear();
+    }
+
+    void addChannel(const QString& group, bool isDeck) {
+        // EngineDeck keeps the group pointer so the string has to outlive it.
+        m_groups.append(group.toAscii());
+        EngineDeck* pDeck = new EngineDeck(m_groups.last().constData(),
+                                           config(), m_pEngineMaster,
+                                           EngineChannel::CENTER);
+        if (isDeck) {
+            addDeck(pDeck);
+        } else {
+            m_pEngineMaster->addChannel(pDeck);
+            setChannelValue(pDeck, "master", 1.0);
+        }
+        MockScaler* pScaler = new MockScaler();
+        m_extraScalers.append(pScaler);
+        pDeck->getEngineBuffer()->setScalerForTest(pScaler);
+        pDeck->getEngineBuffer()->loadFakeTrack();
+        m_channels.append(pDeck);
+    }
+
+    void setChannelValue(EngineDeck* pDeck, const char* item, double value) {
+        ControlObject::getControl(ConfigKey(pDeck->getGroup(), item))->set(value);
+    }
+
+    void addChannelParameters(Benchmark* pBench) {
+        const BenchmarkOptions& options = Benchmark::options();
+        pBench->addParameter("decks", options.decks);
+        pBench->addParameter("samplers", options.samplers);
+    }
+
+    QList<EngineDeck*> m_channels;
+    QList<MockScaler*> m_extraScalers;
+    QList<QByteArray> m_groups;
+};
+
+TEST_F(EngineBenchmark, EngineMasterProcess) {
+    const BenchmarkOptions& options = Benchmark::options();
+    foreach (int frames, options.bufferFrames) {
+        Benchmark bench("EngineMaster::process");
+        addChannelParameters(&bench);
+        bench.addParameter("parallel", options.parallelProcessing ? 1 : 0);
+        bench.addParameter("buffer_frames", frames);
+        while (bench.keepRunning()) {
+            m_pEngineMaster->process(frames * 2);
+        }
+    }
+}
+
+// Adds samplers without a track, which are not active, to show that the cost
+// of a callback depends on the active channels rather than on all channels.
+TEST_F(EngineBenchmark, EngineMasterProcessIdleChannels) {
+    const BenchmarkOptions& options = Benchmark::options();
+    const int kIdleChannelCounts[] = { 0, 32, 64, 128 };
+    int idleChannels = 0;
+    for (unsigned int c = 0; c < sizeof(kIdleChannelCounts) / sizeof(kIdleChannelCounts[0]); ++c) {
+        if (m_channels.size() + kIdleChannelCounts[c] >
+                static_cast<int>(EngineMaster::kMaxChannels)) {
+            break;
+        }
+        for (; idleChannels < kIdleChannelCounts[c]; ++idleChannels) {
+            m_groups.append(QString("[IdleSampler%1]").arg(idleChannels + 1).toAscii());
+            EngineDeck* pDeck = new EngineDeck(m_groups.last().constData(),
+                                               config(), m_pEngineMaster,
+                                               EngineChannel::CENTER);
+            m_pEngineMaster->addChannel(pDeck);
+            setChannelValue(pDeck, "master", 1.0);
+        }
+        foreach (int frames, options.bufferFrames) {
+            Benchmark bench("EngineMaster::process");
+            addChannelParameters(&bench);
+            bench.addParameter("idle_channels", idleChannels);
+            bench.addParameter("buffer_frames", frames);
+            while (bench.keepRunning()) {
+                m_pEngineMaster->process(frames * 2);
+            }
+        }
+    }
+}
+
+TEST_F(EngineBenchmark, ChannelMixerMixChannelsRamping) {
+    const BenchmarkOptions& options = Benchmark::options();
+    const unsigned int maxChannels = EngineMaster::kMaxChannels;
+
+    EngineMaster::ChannelList channels;
+    QList<CSAMPLE> gainCache;
+    for (int i = 0; i < m_channels.size() &&
+                 i < static_cast<int>(maxChannels); ++i) {
+        EngineMaster::ChannelInfo* pChannelInfo = new EngineMaster::ChannelInfo;
+        pChannelInfo->m_pChannel = m_channels[i];
+        pChannelInfo->m_pBuffer = SampleUtil::alloc(MAX_BUFFER_LEN);
+        SampleUtil::applyGain(pChannelInfo->m_pBuffer, 0, MAX_BUFFER_LEN);
+        pChannelInfo->m_pVolumeControl = ControlObject::getControl(
+                ConfigKey(m_channels[i]->getGroup(), "volume"));
+        pChannelInfo->m_index = i;
+        channels.append(pChannelInfo);
+    }
+    for (unsigned int i = 0; i < maxChannels; ++i) {
+        gainCache.append(0);
+    }
+
+    EngineMaster::OrientationVolumeGainCalculator gainCalculator;
+    CSAMPLE* pOutput = SampleUtil::alloc(MAX_BUFFER_LEN);
+    foreach (int frames, options.bufferFrames) {
+        Benchmark bench("ChannelMixer::mixChannelsRamping");
+        bench.addParameter("channels", channels.size());
+        bench.addParameter("buffer_frames", frames);
+        while (bench.keepRunning()) {
+            ChannelMixer::mixChannelsRamping(
+                channels, gainCalculator, &gainCache, pOutput, frames * 2);
+        }
+    }
+
+    SampleUtil::free(pOutput);
+    for (int i = 0; i < channels.size(); ++i) {
+        SampleUtil::free(channels[i]->m_pBuffer);
+        delete channels[i];
+    }
+}
+
+// Compares the separate headphone and bus mixes followed by the master sum with
+// the fused ChannelMixer::mixBusesRamping(). Channels beyond the ones of the
+// fixture reuse their decks with buffers of their own, every other channel is
+// in the headphone mix and each channel is in the bus of its orientation.
+TEST_F(EngineBenchmark, ChannelMixerMixBusesRamping) {
+    const BenchmarkOptions& options = Benchmark::options();
+    const unsigned int maxChannels = EngineMaster::kMaxChannels;
+    const int kChannelCounts[] = { 4, 8, 16 };
+
+    EngineMaster::ChannelList channels;
+    QList<CSAMPLE> headphoneGainCache;
+    QList<CSAMPLE> masterGainCache;
+    for (unsigned int i = 0; i < maxChannels; ++i) {
+        headphoneGainCache.append(0);
+        masterGainCache.append(0);
+    }
+
+    EngineMaster::ConstantGainCalculator headphoneGain;
+    headphoneGain.setGain(0.5);
+    headphoneGain.setTalkoverGain(0.5);
+    EngineMaster::OrientationVolumeGainCalculator masterGain;
+    CSAMPLE* pHeadphoneOutput = SampleUtil::alloc(MAX_BUFFER_LEN);
+    CSAMPLE* pMasterOutput = SampleUtil::alloc(MAX_BUFFER_LEN);
+    CSAMPLE* pBusOutputs[3];
+    for (int o = EngineChannel::LEFT; o <= EngineChannel::RIGHT; ++o) {
+        pBusOutputs[o] = SampleUtil::alloc(MAX_BUFFER_LEN);
+    }
+
+    for (unsigned int c = 0; c < sizeof(kChannelCounts) / sizeof(kChannelCounts[0]); ++c) {
+        const int channelCount = kChannelCounts[c];
+        while (channels.size() < channelCount) {
+            const int i = channels.size();
+            EngineDeck* pDeck = m_channels[i % m_channels.size()];
+            EngineMaster::ChannelInfo* pChannelInfo = new EngineMaster::ChannelInfo;
+            pChannelInfo->m_pChannel = pDeck;
+            pChannelInfo->m_pBuffer = SampleUtil::alloc(MAX_BUFFER_LEN);
+            for (int j = 0; j < MAX_BUFFER_LEN; ++j) {
+                pChannelInfo->m_pBuffer[j] = 0.001 * ((i + j) % 100);
+            }
+            pChannelInfo->m_pVolumeControl = ControlObject::getControl(
+                    ConfigKey(pDeck->getGroup(), "volume"));
+            pChannelInfo->m_index = i;
+            channels.append(pChannelInfo);
+        }
+        EngineMaster::ActiveChannels activeChannels;
+        for (int i = 0; i < channelCount; ++i) {
+            EngineMaster::ChannelInfo* pChannelInfo = channels[i];
+            activeChannels.mixed.append(pChannelInfo);
+            if (i % 2 == 0) {
+                activeChannels.headphone.append(pChannelInfo);
+            }
+            activeChannels.bus[pChannelInfo->m_pChannel->getOrientation()]
+                    .append(pChannelInfo);
+        }
+
+        foreach (int frames, options.bufferFrames) {
+            Benchmark separate("ChannelMixer::mixChannelsRamping+copy3WithGain");
+            separate.addParameter("channels", channelCount);
+            separate.addParameter("buffer_frames", frames);
+            while (separate.keepRunning()) {
+                ChannelMixer::mixChannelsRamping(
+                    activeChannels.headphone, headphoneGain,
+                    &headphoneGainCache, pHeadphoneOutput, frames * 2);
+                for (int o = EngineChannel::LEFT; o <= EngineChannel::RIGHT; ++o) {
+                    ChannelMixer::mixChannelsRamping(
+                        activeChannels.bus[o], masterGain, &masterGainCache,
+                        pBusOutputs[o], frames * 2);
+                }
+                SampleUtil::copy3WithGain(
+                    pMasterOutput,
+                    pBusOutputs[EngineChannel::LEFT], 1.0,
+                    pBusOutputs[EngineChannel::CENTER], 1.0,
+                    pBusOutputs[EngineChannel::RIGHT], 1.0,
+                    frames * 2);
+            }
+
+            Benchmark fused("ChannelMixer::mixBusesRamping");
+            fused.addParameter("channels", channelCount);
+            fused.addParameter("buffer_frames", frames);
+            while (fused.keepRunning()) {
+                ChannelMixer::mixBusesRamping(
+                    activeChannels, headphoneGain, masterGain,
+                    &headphoneGainCache, &masterGainCache, pHeadphoneOutput,
+                    pBusOutputs, pMasterOutput, frames * 2);
+            }
+        }
+    }
+
+    for (int o = EngineChannel::LEFT; o <= EngineChannel::RIGHT; ++o) {
+        SampleUtil::free(pBusOutputs[o]);
+    }
+    SampleUtil::free(pMasterOutput);
+    SampleUtil::free(pHeadphoneOutput);
+    for (int i = 0; i < channels.size(); ++i) {
+        SampleUtil::free(channels[i]->m_pBuffer);
+        delete channels[i];
+    }
+}
+
+}  // namespace
@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+
+#include <QtDebug>
+#include <QVector>
+
+#include "defs.h"
+#include "engine/enginebufferscalelinear.h"
+#include "engine/enginebufferscalerubberband.h"
+#include "engine/enginebufferscalest.h"
+#include "engine/readaheadmanager.h"
+#include "mathstuff.h"
+#include "test/bench/benchmark.h"
+#include "test/mixxxtest.h"
+
+namespace {
+
+// Feeds the scalers an endless synthetic track without a CachingReader.
+class SyntheticReadAheadManager : public ReadAheadManager {
+  public:
+    SyntheticReadAheadManager()
+            : ReadAheadManager(NULL),
+              m_iReadPosition(0) {
+        // One second of a stereo 440 Hz / 660 Hz tone.
+        const int kFrames = 44100;
+        m_track.resize(kFrames * 2);
+        for (int i = 0; i < kFrames; ++i) {
+            m_track[i * 2] = 0.5 * sin(two_pi * 440.0 * i / kFrames);
+            m_track[i * 2 + 1] = 0.5 * sin(two_pi * 660.0 * i / kFrames);
+        }
+    }
+
+    virtual int getNextSamples(double dRate, CSAMPLE* buffer,
+                               int requested_samples) {
+        Q_UNUSED(dRate);
+        for (int i = 0; i < requested_samples; ++i) {
+            buffer[i] = m_track[m_iReadPosition];
+            m_iReadPosition = (m_iReadPosition + 1) % m_track.size();
+        }
+        return requested_samples;
+    }
+
+  private:
+    QVector<CSAMPLE> m_track;
+    int m_iReadPosition;
+};
+
+class EngineBufferScaleBenchmark : public MixxxTest {
+  protected:
+    // Times getScaled() at a tempo of +4% for every configured buffer size.
+    void runScaler(const QString& name, EngineBufferScale* pScaler,
+                   bool speedAffectsPitch) {
+        double speedAdjust = 1.04;
+        double pitchAdjust = 0.0;
+        pScaler->setScaleParameters(44100, 1.0, speedAffectsPitch,
+                                    &speedAdjust, &pitchAdjust);
+        foreach (int frames, Benchmark::options().bufferFrames) {
+            Benchmark bench(name);
+            bench.addParameter("buffer_frames", frames);
+            bench.addParameter("keylock", speedAffectsPitch ? 0 : 1);
+            while (bench.keepRunning()) {
+                pScaler->getScaled(frames * 2);
+            }
+        }
+    }
+
+    SyntheticReadAheadManager m_readAheadManager;
+};
+
+TEST_F(EngineBufferScaleBenchmark, Linear) {
+    EngineBufferScaleLinear scaler(&m_readAheadManager);
+    runScaler("EngineBufferScaleLinear::getScaled", &scaler, true);
+}
+
+TEST_F(EngineBufferScaleBenchmark, SoundTouch) {
+    EngineBufferScaleST scaler(&m_readAheadManager);
+    runScaler("EngineBufferScaleST::getScaled", &scaler, false);
+}
+
+TEST_F(EngineBufferScaleBenchmark, RubberBand) {
+    EngineBufferScaleRubberBand scaler(&m_readAheadManager);
+    runScaler("EngineBufferScaleRubberBand::getScaled", &scaler, false);
+}
+
+}  // namespace
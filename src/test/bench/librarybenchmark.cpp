@@ -0,0 +1,311 @@
+#include <gtest/gtest.h>
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QSqlQuery>
+#include <QStringList>
+#include <QtDebug>
+
+#include <climits>
+#include <cmath>
+
+#include "analyserqueue.h"
+#include "library/basetrackcache.h"
+#include "library/queryutil.h"
+#include "library/searchquery.h"
+#include "library/trackcollection.h"
+#include "mathstuff.h"
+#include "soundsourceproxy.h"
+#include "test/bench/benchmark.h"
+#include "test/mixxxtest.h"
+
+namespace {
+
+const char* kGenres[] = {
+    "House", "Techno", "Drum & Bass", "Hip-Hop", "Disco", "Funk", "Ambient",
+    "Dubstep", "Jazz", "Trance",
+};
+const int kNumGenres = sizeof(kGenres) / sizeof(kGenres[0]);
+
+const char* kWords[] = {
+    "love", "night", "dance", "dream", "fire", "city", "sun", "heart", "bass",
+    "light", "groove", "soul", "machine", "summer", "echo", "gold",
+};
+const int kNumWords = sizeof(kWords) / sizeof(kWords[0]);
+
+// Runs the library benchmarks against a fresh database in a temporary
+// settings directory so that the user's library is never touched.
+class LibraryBenchmark : public MixxxTest {
+  protected:
+    virtual void SetUp() {
+        m_settingsPath = QDir::temp().filePath(
+            QString("mixxx-bench-%1").arg(QCoreApplication::applicationPid()));
+        QDir().mkpath(m_settingsPath);
+        m_pBenchConfig = new ConfigObject<ConfigValue>(
+            QDir(m_settingsPath).filePath("mixxx.cfg"));
+        // The benchmarks are run from the source root like mixxx-test.
+        m_pBenchConfig->set(ConfigKey("[Config]", "Path"),
+                            ConfigValue(QDir::current().filePath("res/")));
+        m_pTrackCollection = new TrackCollection(m_pBenchConfig);
+    }
+
+    virtual void TearDown() {
+        delete m_pTrackCollection;
+        delete m_pBenchConfig;
+        QDir settingsDir(m_settingsPath);
+        foreach (const QString& file, settingsDir.entryList(QDir::Files)) {
+            settingsDir.remove(file);
+        }
+        QDir().rmdir(m_settingsPath);
+    }
+
+    // Inserts numTracks tracks with synthetic metadata into the library,
+    // numbered from firstTrack.
+    void populateLibrary(int numTracks, int firstTrack = 0) {
+        QSqlDatabase database = m_pTrackCollection->getDatabase();
+        ScopedTransaction transaction(database);
+        QSqlQuery locationQuery(database);
+        locationQuery.prepare(
+            "INSERT INTO track_locations "
+            "(location, filename, directory, filesize, fs_deleted, needs_verification) "
+            "VALUES (:location, :filename, :directory, 0, 0, 0)");
+        QSqlQuery trackQuery(database);
+        trackQuery.prepare(
+            "INSERT INTO library "
+            "(artist, title, album, album_artist, year, genre, tracknumber, "
+            "location, comment, duration, bitrate, samplerate, bpm, channels, "
+            "mixxx_deleted, played, timesplayed, rating, filetype) "
+            "VALUES (:artist, :title, :album, :album_artist, :year, :genre, "
+            ":tracknumber, :location, '', :duration, 320, 44100, :bpm, 2, 0, "
+            "0, 0, 0, 'mp3')");
+
+        for (int i = firstTrack; i < firstTrack + numTracks; ++i) {
+            const QString artist = QString("Artist %1").arg(i % 997);
+            const QString album = QString("Album %1").arg(i % 2003);
+            const QString title = QString("%1 %2 %3")
+                    .arg(kWords[i % kNumWords])
+                    .arg(kWords[(i / kNumWords) % kNumWords])
+                    .arg(i);
+            const QString directory = QString("/music/%1/%2").arg(artist, album);
+            const QString filename = QString("%1.mp3").arg(title);
+            const QString location = QString("%1/%2").arg(directory, filename);
+
+            locationQuery.bindValue(":location", location);
+            locationQuery.bindValue(":filename", filename);
+            locationQuery.bindValue(":directory", directory);
+            if (!locationQuery.exec()) {
+                LOG_FAILED_QUERY(locationQuery);
+                continue;
+            }
+
+            trackQuery.bindValue(":artist", artist);
+            trackQuery.bindValue(":title", title);
+            trackQuery.bindValue(":album", album);
+            trackQuery.bindValue(":album_artist", artist);
+            trackQuery.bindValue(":year", QString::number(1970 + i % 45));
+            trackQuery.bindValue(":genre", kGenres[i % kNumGenres]);
+            trackQuery.bindValue(":tracknumber", QString::number(1 + i % 12));
+            trackQuery.bindValue(":location", locationQuery.lastInsertId());
+            trackQuery.bindValue(":duration", 120 + i % 360);
+            trackQuery.bindValue(":bpm", 80.0 + (i % 900) / 10.0);
+            if (!trackQuery.exec()) {
+                LOG_FAILED_QUERY(trackQuery);
+            }
+        }
+        transaction.commit();
+    }
+
+    // Writes a stereo 16-bit WAV file with a 120 BPM pulse over two tones.
+    void writeSyntheticTrack(const QString& path, int seconds) {
+        const int sampleRate = 44100;
+        const int frames = sampleRate * seconds;
+        const int dataBytes = frames * 2 * sizeof(qint16);
+
+        QFile file(path);
+        ASSERT_TRUE(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+        QDataStream stream(&file);
+        stream.setByteOrder(QDataStream::LittleEndian);
+        stream.writeRawData("RIFF", 4);
+        stream << static_cast<quint32>(36 + dataBytes);
+        stream.writeRawData("WAVEfmt ", 8);
+        stream << static_cast<quint32>(16) << static_cast<quint16>(1)
+               << static_cast<quint16>(2) << static_cast<quint32>(sampleRate)
+               << static_cast<quint32>(sampleRate * 2 * sizeof(qint16))
+               << static_cast<quint16>(2 * sizeof(qint16))
+               << static_cast<quint16>(16);
+        stream.writeRawData("data", 4);
+        stream << static_cast<quint32>(dataBytes);
+
+        const int beatLength = sampleRate / 2;
+        for (int i = 0; i < frames; ++i) {
+            const double t = static_cast<double>(i) / sampleRate;
+            const double envelope = exp(-30.0 * (i % beatLength) / sampleRate);
+            const double kick = envelope * sin(two_pi * 60.0 * t);
+            const double left = 0.6 * kick + 0.2 * sin(two_pi * 440.0 * t);
+            const double right = 0.6 * kick + 0.2 * sin(two_pi * 660.0 * t);
+            stream << static_cast<qint16>(left * SHRT_MAX)
+                   << static_cast<qint16>(right * SHRT_MAX);
+        }
+    }
+
+    QString m_settingsPath;
+    ConfigObject<ConfigValue>* m_pBenchConfig;
+    TrackCollection* m_pTrackCollection;
+};
+
+TEST_F(LibraryBenchmark, AnalyserQueueDoAnalysis) {
+    const BenchmarkOptions& options = Benchmark::options();
+    const QString path = QDir(m_settingsPath).filePath("synthetic.wav");
+    writeSyntheticTrack(path, options.trackSeconds);
+
+    AnalyserQueue* pQueue = AnalyserQueue::createDefaultAnalyserQueue(
+        m_pBenchConfig, m_pTrackCollection);
+
+    // Analysing a whole track takes long enough that fewer iterations still
+    // give a stable distribution.
+    Benchmark bench("AnalyserQueue::doAnalysis", 1,
+                    qMax(1, options.iterations / 100));
+    bench.addParameter("track_seconds", options.trackSeconds);
+    while (bench.keepRunning()) {
+        bench.pauseTiming();
+        TrackPointer pTrack(new TrackInfoObject(path), &QObject::deleteLater);
+        SoundSourceProxy soundSource(pTrack);
+        soundSource.open();
+        bench.resumeTiming();
+        EXPECT_TRUE(pQueue->doAnalysisForTest(pTrack, &soundSource));
+    }
+
+    delete pQueue;
+}
+
+TEST_F(LibraryBenchmark, BaseTrackCacheFilterAndSort) {
+    const BenchmarkOptions& options = Benchmark::options();
+    populateLibrary(options.libraryTracks);
+
+    // The same view MixxxLibraryFeature caches.
+    QStringList columns;
+    columns << "library." + LIBRARYTABLE_ID
+            << "library." + LIBRARYTABLE_PLAYED
+            << "library." + LIBRARYTABLE_TIMESPLAYED
+            << "library." + LIBRARYTABLE_ARTIST
+            << "library." + LIBRARYTABLE_TITLE
+            << "library." + LIBRARYTABLE_ALBUM
+            << "library." + LIBRARYTABLE_ALBUMARTIST
+            << "library." + LIBRARYTABLE_YEAR
+            << "library." + LIBRARYTABLE_DURATION
+            << "library." + LIBRARYTABLE_RATING
+            << "library." + LIBRARYTABLE_GENRE
+            << "library." + LIBRARYTABLE_COMPOSER
+            << "library." + LIBRARYTABLE_GROUPING
+            << "library." + LIBRARYTABLE_FILETYPE
+            << "library." + LIBRARYTABLE_TRACKNUMBER
+            << "library." + LIBRARYTABLE_KEY
+            << "library." + LIBRARYTABLE_KEY_ID
+            << "library." + LIBRARYTABLE_DATETIMEADDED
+            << "library." + LIBRARYTABLE_BPM
+            << "library." + LIBRARYTABLE_BPM_LOCK
+            << "library." + LIBRARYTABLE_BITRATE
+            << "track_locations.location"
+            << "track_locations.fs_deleted"
+            << "library." + LIBRARYTABLE_COMMENT
+            << "library." + LIBRARYTABLE_MIXXXDELETED;
+    const QString tableName = "library_cache_view";
+    QSqlQuery query(m_pTrackCollection->getDatabase());
+    query.prepare(QString(
+        "CREATE TEMPORARY VIEW IF NOT EXISTS %1 AS "
+        "SELECT %2 FROM library "
+        "INNER JOIN track_locations ON library.location = track_locations.id")
+            .arg(tableName, columns.join(",")));
+    ASSERT_TRUE(query.exec());
+    for (QStringList::iterator it = columns.begin(); it != columns.end(); ++it) {
+        *it = it->replace("library.", "").replace("track_locations.", "");
+    }
+
+    BaseTrackCache cache(m_pTrackCollection, tableName, LIBRARYTABLE_ID,
+                         columns, true);
+    cache.buildIndex();
+
+    QSet<int> trackIds;
+    query.prepare(QString("SELECT %1 FROM %2").arg(LIBRARYTABLE_ID, tableName));
+    ASSERT_TRUE(query.exec());
+    while (query.next()) {
+        trackIds.insert(query.value(0).toInt());
+    }
+
+    QStringList searches;
+    searches << "" << "love" << "dance night" << "bpm:>120"
+             << "genre:house year:1990";
+    const int sortColumn = cache.fieldIndex(LIBRARYTABLE_ARTIST);
+    QHash<int, int> trackToIndex;
+    foreach (const QString& search, searches) {
+        Benchmark bench("BaseTrackCache::filterAndSort",
+                        qMin(options.warmupIterations, 10),
+                        qMax(1, options.iterations / 10));
+        bench.addParameter("tracks", trackIds.size());
+        bench.addParameter("query", search);
+        while (bench.keepRunning()) {
+            cache.filterAndSort(trackIds, search, "mixxx_deleted=0",
+                                sortColumn, Qt::AscendingOrder, &trackToIndex);
+        }
+    }
+}
+
+// Compares searching the library with LIKE and through the full-text index
+// at growing library sizes.
+TEST_F(LibraryBenchmark, FullTextSearch) {
+    const BenchmarkOptions& options = Benchmark::options();
+    QSqlDatabase database = m_pTrackCollection->getDatabase();
+    const bool hasFullTextIndex =
+            m_pTrackCollection->getTrackDAO().hasFullTextIndex();
+    if (!hasFullTextIndex) {
+        qDebug() << "SQLite has no FTS4 with unicode61, only benchmarking LIKE";
+    }
+
+    QStringList searchColumns;
+    searchColumns << LIBRARYTABLE_ARTIST << LIBRARYTABLE_ALBUM
+                  << LIBRARYTABLE_TITLE << LIBRARYTABLE_GENRE;
+    QStringList terms;
+    terms << "love" << "machine" << "artist";
+
+    const int divisors[] = { 16, 4, 1 };
+    int tracks = 0;
+    for (unsigned int d = 0; d < sizeof(divisors) / sizeof(int); ++d) {
+        const int size = qMax(1, options.libraryTracks / divisors[d]);
+        populateLibrary(size - tracks, tracks);
+        tracks = size;
+
+        foreach (const QString& term, terms) {
+            TextFilterNode like(database, searchColumns, term);
+            FullTextFilterNode fullText(database, LIBRARY_FTS_TABLE,
+                                        LIBRARYTABLE_ID, searchColumns, term);
+            QList<const QueryNode*> nodes;
+            nodes << &like;
+            if (hasFullTextIndex) {
+                nodes << &fullText;
+            }
+            foreach (const QueryNode* pNode, nodes) {
+                QSqlQuery query(database);
+                ASSERT_TRUE(query.prepare(
+                    QString("SELECT %1 FROM %2 WHERE %3")
+                            .arg(LIBRARYTABLE_ID, LIBRARY_TABLE,
+                                 pNode->toSql())));
+                Benchmark bench("Library text search",
+                                qMin(options.warmupIterations, 10),
+                                qMax(1, options.iterations / 10));
+                bench.addParameter("tracks", tracks);
+                bench.addParameter("query", term);
+                bench.addParameter("method",
+                                   pNode == &like ? "LIKE" : "MATCH");
+                while (bench.keepRunning()) {
+                    EXPECT_TRUE(query.exec());
+                    while (query.next()) {
+                    }
+                }
+            }
+        }
+    }
+}
+
+}  // namespace
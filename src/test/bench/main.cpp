@@ -0,0 +1,26 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+#include "test/bench/benchmark.h"
+
+int main(int argc, char **argv) {
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            BenchmarkOptions::printUsage();
+        }
+    }
+    if (!Benchmark::mutableOptions()->parse(&argc, argv)) {
+        BenchmarkOptions::printUsage();
+        return 1;
+    }
+
+    testing::InitGoogleTest(&argc, argv);
+    int ret = RUN_ALL_TESTS();
+
+    const QString jsonPath = Benchmark::options().jsonPath;
+    if (!jsonPath.isEmpty() && !Benchmark::writeJson(jsonPath)) {
+        ret = 1;
+    }
+    return ret;
+}
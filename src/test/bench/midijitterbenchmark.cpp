@@ -0,0 +1,197 @@
+#include <gtest/gtest.h>
+
+#include <QFile>
+#include <QStringList>
+#include <QTextStream>
+#include <QVector>
+#include <QtDebug>
+
+#include "controlobject.h"
+#include "engine/controleventqueue.h"
+#include "test/bench/benchmark.h"
+
+namespace {
+
+const int kSampleRate = 44100;
+const qint64 kNanosPerMilli = 1000000;
+const qint64 kNanosPerSecond = 1000000000;
+
+// A MIDI message and the time it was received at.
+struct MidiEvent {
+    qint64 timestamp;
+    unsigned char status;
+    unsigned char data1;
+    unsigned char data2;
+};
+
+// Replays a MIDI stream through the two ways a controller message can reach a
+// deck and reports the distribution of the time from receiving each message to
+// the sample at which the engine applies it. The spread of the distribution,
+// e.g. p99 - p50, is the jitter the message sees:
+//
+//  - polled: the message is applied at the start of the first callback after
+//    the controller poll that picked it up.
+//  - scheduled: the message is queued with its timestamp on a
+//    ControlEventQueue and applied at its offset within the next callback.
+//
+// Both sides are simulated: controllers are polled every poll_millis and
+// callbacks of buffer_frames run at exactly the sample rate, so only the
+// quantisation of the delivery is measured.
+//
+// The stream is read from --bench_midi_stream if given. It has one message per
+// line as "<milliseconds> <status> <data1> <data2>", where the bytes may be
+// decimal or hex with a 0x prefix and lines starting with # are ignored. The
+// timestamps only need to be relative to each other. Without a stream, a jog
+// wheel that is turned for ten seconds is synthesized.
+class MidiJitterBenchmark : public testing::Test {
+  protected:
+    virtual void SetUp() {
+        m_pPlay = new ControlObject(ConfigKey("[JitterTest]", "play"));
+        m_pRate = new ControlObject(ConfigKey("[JitterTest]", "rate"));
+        m_pScratch = new ControlObject(ConfigKey("[JitterTest]", "scratch2"));
+        m_pQueue = new ControlEventQueue("[JitterTest]");
+        // Changes are only queued for decks that the engine processes.
+        m_pQueue->startCallback(0, 0, 0);
+    }
+
+    virtual void TearDown() {
+        delete m_pQueue;
+        delete m_pScratch;
+        delete m_pRate;
+        delete m_pPlay;
+    }
+
+    static bool readStream(const QString& path, QVector<MidiEvent>* pEvents) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            qWarning() << "Could not open" << path;
+            return false;
+        }
+        QTextStream in(&file);
+        while (!in.atEnd()) {
+            const QString line = in.readLine().trimmed();
+            if (line.isEmpty() || line.startsWith('#')) {
+                continue;
+            }
+            const QStringList fields = line.split(QRegExp("\\s+"));
+            bool ok = fields.size() == 4;
+            MidiEvent event;
+            event.timestamp = ok ? static_cast<qint64>(
+                    fields[0].toDouble(&ok) * kNanosPerMilli) : 0;
+            event.status = ok ? fields[1].toUInt(&ok, 0) : 0;
+            event.data1 = ok ? fields[2].toUInt(&ok, 0) : 0;
+            event.data2 = ok ? fields[3].toUInt(&ok, 0) : 0;
+            if (!ok) {
+                qWarning() << "Invalid MIDI stream line:" << line;
+                return false;
+            }
+            pEvents->append(event);
+        }
+        return true;
+    }
+
+    // A jog wheel that sends relative ticks every 0.5 to 2 ms.
+    static void synthesizeStream(QVector<MidiEvent>* pEvents) {
+        unsigned int seed = 1;
+        qint64 timestamp = 0;
+        while (timestamp < 10 * kNanosPerSecond) {
+            seed = seed * 1103515245 + 12345;
+            const qint64 micros = 500 + (seed >> 16) % 1501;
+            timestamp += micros * 1000;
+            MidiEvent event;
+            event.timestamp = timestamp;
+            event.status = 0xB0;
+            event.data1 = 0x22;
+            event.data2 = 65;
+            pEvents->append(event);
+        }
+    }
+
+    // Returns the time from receiving each event to the engine applying it.
+    QVector<qint64> replay(const QVector<MidiEvent>& events, int frames,
+                           int pollMillis, bool scheduled) {
+        QVector<qint64> latencies;
+        latencies.reserve(events.size());
+        const qint64 period = frames * kNanosPerSecond / kSampleRate;
+        const qint64 pollInterval = pollMillis * kNanosPerMilli;
+        const qint64 end = events.isEmpty() ? 0 :
+                events.last().timestamp + 2 * (period + pollInterval);
+
+        int polled = 0;
+        int applied = 0;
+        qint64 nextPoll = pollInterval;
+        for (qint64 callbackStart = period; callbackStart < end;
+             callbackStart += period) {
+            // Poll the controller until the callback starts.
+            for (; nextPoll <= callbackStart; nextPoll += pollInterval) {
+                while (polled < events.size() &&
+                       events[polled].timestamp <= nextPoll) {
+                    const MidiEvent& event = events[polled++];
+                    if (scheduled) {
+                        EXPECT_TRUE(ControlEventQueue::schedule(
+                                m_pScratch, event.data2 - 64.0, event.timestamp));
+                    }
+                }
+            }
+
+            if (!scheduled) {
+                for (; applied < polled; ++applied) {
+                    latencies.append(callbackStart - events[applied].timestamp);
+                }
+                continue;
+            }
+            m_pQueue->startCallback(callbackStart - period, callbackStart,
+                                    frames * 2);
+            while (m_pQueue->nextEventOffset() < frames * 2) {
+                const int offset = m_pQueue->applyNextEvent();
+                const qint64 appliedAt = callbackStart +
+                        (offset / 2) * kNanosPerSecond / kSampleRate;
+                latencies.append(appliedAt - events[applied++].timestamp);
+            }
+        }
+        return latencies;
+    }
+
+    ControlObject* m_pPlay;
+    ControlObject* m_pRate;
+    ControlObject* m_pScratch;
+    ControlEventQueue* m_pQueue;
+};
+
+TEST_F(MidiJitterBenchmark, ReplayMidiStream) {
+    const BenchmarkOptions& options = Benchmark::options();
+    QVector<MidiEvent> events;
+    if (options.midiStreamPath.isEmpty()) {
+        synthesizeStream(&events);
+    } else {
+        ASSERT_TRUE(readStream(options.midiStreamPath, &events));
+    }
+    if (events.isEmpty()) {
+        return;
+    }
+    // Both the stream and the simulation start at 0.
+    const qint64 start = events.first().timestamp;
+    for (int i = 0; i < events.size(); ++i) {
+        events[i].timestamp -= start;
+    }
+
+    // The poll intervals of ControllerManager elsewhere and on Linux.
+    const int kPollMillis[] = { 1, 5 };
+    for (unsigned int p = 0; p < sizeof(kPollMillis) / sizeof(kPollMillis[0]); ++p) {
+        foreach (int frames, options.bufferFrames) {
+            Benchmark polled("MidiJitter::polled");
+            polled.addParameter("events", events.size());
+            polled.addParameter("poll_millis", kPollMillis[p]);
+            polled.addParameter("buffer_frames", frames);
+            polled.report(replay(events, frames, kPollMillis[p], false));
+
+            Benchmark scheduled("MidiJitter::scheduled");
+            scheduled.addParameter("events", events.size());
+            scheduled.addParameter("poll_millis", kPollMillis[p]);
+            scheduled.addParameter("buffer_frames", frames);
+            scheduled.report(replay(events, frames, kPollMillis[p], true));
+        }
+    }
+}
+
+}  // namespace
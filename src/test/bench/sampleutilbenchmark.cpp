@@ -0,0 +1,177 @@
+#include <gtest/gtest.h>
+
+#include <QtDebug>
+
+#include "defs.h"
+#include "sampleutil.h"
+#include "test/bench/benchmark.h"
+
+namespace {
+
+// Times each dispatched SampleUtil kernel with every instruction set this
+// machine supports, for every configured buffer size. The SCALAR results are
+// the baseline the vectorized kernels are compared against.
+class SampleUtilBenchmark : public testing::Test {
+  protected:
+    virtual void SetUp() {
+        m_previous = SampleUtil::instructionSet();
+        int maxFrames = 0;
+        foreach (int frames, Benchmark::options().bufferFrames) {
+            maxFrames = math_max(maxFrames, frames);
+        }
+        m_iMaxSamples = maxFrames * 2;
+        m_pDest = SampleUtil::alloc(m_iMaxSamples);
+        m_pDest2 = SampleUtil::alloc(m_iMaxSamples);
+        m_pSrc = SampleUtil::alloc(m_iMaxSamples);
+        m_pSrc2 = SampleUtil::alloc(m_iMaxSamples);
+        m_pS16 = new SAMPLE[m_iMaxSamples];
+        for (int i = 0; i < m_iMaxSamples; ++i) {
+            m_pSrc[i] = static_cast<CSAMPLE>((i % 37) - 18) / 9.0f;
+            m_pSrc2[i] = static_cast<CSAMPLE>((i % 23) - 11) / 7.0f;
+            m_pDest[i] = 0.0f;
+            m_pS16[i] = static_cast<SAMPLE>((i * 97) % 65536 - 32768);
+        }
+    }
+
+    virtual void TearDown() {
+        SampleUtil::setInstructionSet(m_previous);
+        delete [] m_pS16;
+        SampleUtil::free(m_pSrc2);
+        SampleUtil::free(m_pSrc);
+        SampleUtil::free(m_pDest2);
+        SampleUtil::free(m_pDest);
+    }
+
+    enum Kernel {
+        APPLY_GAIN,
+        APPLY_RAMPING_GAIN,
+        ADD_WITH_GAIN,
+        ADD_WITH_RAMPING_GAIN,
+        COPY_WITH_GAIN,
+        COPY_WITH_RAMPING_GAIN,
+        CONVERT,
+        SUM_ABS_PER_CHANNEL,
+        COPY_CLAMP_BUFFER,
+        INTERLEAVE_BUFFER,
+        DEINTERLEAVE_BUFFER
+    };
+
+    void runKernel(const QString& name, Kernel kernel) {
+        for (int set = SampleUtil::SCALAR;
+             set < SampleUtil::NUM_INSTRUCTION_SETS; ++set) {
+            SampleUtil::InstructionSet instructionSet =
+                    static_cast<SampleUtil::InstructionSet>(set);
+            if (!SampleUtil::setInstructionSet(instructionSet)) {
+                continue;
+            }
+            foreach (int frames, Benchmark::options().bufferFrames) {
+                const int samples = frames * 2;
+                Benchmark bench(name);
+                bench.addParameter("instruction_set",
+                                   SampleUtil::instructionSetName(instructionSet));
+                bench.addParameter("buffer_frames", frames);
+                while (bench.keepRunning()) {
+                    runOnce(kernel, samples);
+                }
+            }
+        }
+    }
+
+    void runOnce(Kernel kernel, int samples) {
+        CSAMPLE left, right;
+        switch (kernel) {
+            case APPLY_GAIN:
+                SampleUtil::applyGain(m_pDest, 0.999f, samples);
+                break;
+            case APPLY_RAMPING_GAIN:
+                SampleUtil::applyRampingGain(m_pDest, 0.999f, 1.001f, samples);
+                break;
+            case ADD_WITH_GAIN:
+                SampleUtil::addWithGain(m_pDest, m_pSrc, 0.5f, samples);
+                break;
+            case ADD_WITH_RAMPING_GAIN:
+                SampleUtil::addWithRampingGain(m_pDest, m_pSrc, 0.4f, 0.6f,
+                                               samples);
+                break;
+            case COPY_WITH_GAIN:
+                SampleUtil::copyWithGain(m_pDest, m_pSrc, 0.5f, samples);
+                break;
+            case COPY_WITH_RAMPING_GAIN:
+                SampleUtil::copyWithRampingGain(m_pDest, m_pSrc, 0.4f, 0.6f,
+                                                samples);
+                break;
+            case CONVERT:
+                SampleUtil::convert(m_pDest, m_pS16, samples);
+                break;
+            case SUM_ABS_PER_CHANNEL:
+                SampleUtil::sumAbsPerChannel(&left, &right, m_pSrc, samples);
+                break;
+            case COPY_CLAMP_BUFFER:
+                SampleUtil::copyClampBuffer(1.0f, -1.0f, m_pDest, m_pSrc,
+                                            samples);
+                break;
+            case INTERLEAVE_BUFFER:
+                SampleUtil::interleaveBuffer(m_pDest, m_pSrc, m_pSrc2,
+                                             samples / 2);
+                break;
+            case DEINTERLEAVE_BUFFER:
+                SampleUtil::deinterleaveBuffer(m_pDest, m_pDest2, m_pSrc,
+                                               samples / 2);
+                break;
+        }
+    }
+
+    SampleUtil::InstructionSet m_previous;
+    int m_iMaxSamples;
+    CSAMPLE* m_pDest;
+    CSAMPLE* m_pDest2;
+    CSAMPLE* m_pSrc;
+    CSAMPLE* m_pSrc2;
+    SAMPLE* m_pS16;
+};
+
+TEST_F(SampleUtilBenchmark, ApplyGain) {
+    runKernel("SampleUtil::applyGain", APPLY_GAIN);
+}
+
+TEST_F(SampleUtilBenchmark, ApplyRampingGain) {
+    runKernel("SampleUtil::applyRampingGain", APPLY_RAMPING_GAIN);
+}
+
+TEST_F(SampleUtilBenchmark, AddWithGain) {
+    runKernel("SampleUtil::addWithGain", ADD_WITH_GAIN);
+}
+
+TEST_F(SampleUtilBenchmark, AddWithRampingGain) {
+    runKernel("SampleUtil::addWithRampingGain", ADD_WITH_RAMPING_GAIN);
+}
+
+TEST_F(SampleUtilBenchmark, CopyWithGain) {
+    runKernel("SampleUtil::copyWithGain", COPY_WITH_GAIN);
+}
+
+TEST_F(SampleUtilBenchmark, CopyWithRampingGain) {
+    runKernel("SampleUtil::copyWithRampingGain", COPY_WITH_RAMPING_GAIN);
+}
+
+TEST_F(SampleUtilBenchmark, Convert) {
+    runKernel("SampleUtil::convert", CONVERT);
+}
+
+TEST_F(SampleUtilBenchmark, SumAbsPerChannel) {
+    runKernel("SampleUtil::sumAbsPerChannel", SUM_ABS_PER_CHANNEL);
+}
+
+TEST_F(SampleUtilBenchmark, CopyClampBuffer) {
+    runKernel("SampleUtil::copyClampBuffer", COPY_CLAMP_BUFFER);
+}
+
+TEST_F(SampleUtilBenchmark, InterleaveBuffer) {
+    runKernel("SampleUtil::interleaveBuffer", INTERLEAVE_BUFFER);
+}
+
+TEST_F(SampleUtilBenchmark, DeinterleaveBuffer) {
+    runKernel("SampleUtil::deinterleaveBuffer", DEINTERLEAVE_BUFFER);
+}
+
+}  // namespace
@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include <QThread>
+
+#include "util/blockingqueue.h"
+
+namespace {
+
+class Producer : public QThread {
+  public:
+    Producer(BlockingQueue<int>* pQueue, int count)
+            : m_pQueue(pQueue),
+              m_count(count),
+              m_pushed(0) {
+    }
+
+    int pushed() const {
+        return m_pushed;
+    }
+
+  protected:
+    void run() {
+        for (int i = 0; i < m_count; ++i) {
+            if (!m_pQueue->push(i)) {
+                return;
+            }
+            ++m_pushed;
+        }
+    }
+
+  private:
+    BlockingQueue<int>* m_pQueue;
+    const int m_count;
+    int m_pushed;
+};
+
+TEST(BlockingQueueTest, PushAndPop) {
+    BlockingQueue<int> queue(4);
+    EXPECT_TRUE(queue.push(1));
+    EXPECT_TRUE(queue.push(2));
+    EXPECT_EQ(2, queue.size());
+
+    int value = 0;
+    EXPECT_TRUE(queue.pop(&value));
+    EXPECT_EQ(1, value);
+    EXPECT_TRUE(queue.tryPop(&value));
+    EXPECT_EQ(2, value);
+    EXPECT_FALSE(queue.tryPop(&value));
+}
+
+TEST(BlockingQueueTest, ProducerWaitsForRoom) {
+    BlockingQueue<int> queue(2);
+    Producer producer(&queue, 100);
+    producer.start();
+
+    int value = 0;
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_TRUE(queue.pop(&value));
+        EXPECT_EQ(i, value);
+        EXPECT_LE(queue.size(), queue.capacity());
+    }
+    producer.wait();
+    EXPECT_EQ(100, producer.pushed());
+}
+
+TEST(BlockingQueueTest, CloseStopsProducerAndDrains) {
+    BlockingQueue<int> queue(2);
+    Producer producer(&queue, 100);
+    producer.start();
+    while (queue.size() < queue.capacity()) {
+        QThread::yieldCurrentThread();
+    }
+    // The producer is blocked on the full queue until it is closed.
+    queue.close();
+    producer.wait();
+    EXPECT_EQ(2, producer.pushed());
+    EXPECT_FALSE(queue.push(3));
+
+    int value = 0;
+    EXPECT_TRUE(queue.pop(&value));
+    EXPECT_EQ(0, value);
+    EXPECT_TRUE(queue.pop(&value));
+    EXPECT_EQ(1, value);
+    EXPECT_FALSE(queue.pop(&value));
+}
+
+}  // namespace
@@ -0,0 +1,195 @@
+#include <gtest/gtest.h>
+
+#include <QtDebug>
+
+#include "library/columnartrackindex.h"
+#include "library/searchquery.h"
+
+namespace {
+
+class ColumnarTrackIndexTest : public testing::Test {
+  protected:
+    ColumnarTrackIndexTest()
+            : m_index(QStringList() << "id" << "artist" << "title"
+                      << "tracknumber" << "bpm" << "key_id",
+                      QStringList() << "artist" << "title") {
+        m_index.setSortAsInteger(m_index.columnIndex("tracknumber"));
+    }
+
+    void addTrack(int trackId, const QString& artist, const QString& title,
+                  const QString& trackNumber, const QVariant& bpm,
+                  int key = 0) {
+        QVector<QVariant> values;
+        values << trackId << artist << title << trackNumber << bpm << key;
+        m_index.updateTrack(trackId, values);
+    }
+
+    void addTracks() {
+        addTrack(1, "Daft Punk", "Around The World", "2", 121.0);
+        addTrack(2, "daft punk", "One More Time", "10", 122.0, 1);
+        addTrack(3, "Aphex Twin", "Windowlicker", "1", 125.0);
+        addTrack(4, "Burial", "Archangel", "", QVariant());
+    }
+
+    // The tracks sorted ascending by column.
+    QList<int> sortedTracks(const QString& column) {
+        QList<int> tracks;
+        foreach (int row, m_index.sortedRows(m_index.columnIndex(column))) {
+            tracks << m_index.trackIdForRow(row);
+        }
+        return tracks;
+    }
+
+    // The tracks that match pQuery, found through the trigram index if the
+    // query supports it.
+    QList<int> matchingTracks(const QueryNode* pQuery) {
+        QList<int> tracks;
+        QVector<int> rows;
+        if (!pQuery->indexCandidates(&m_index, &rows)) {
+            rows.clear();
+            for (int row = 0; row < m_index.rowCount(); ++row) {
+                if (m_index.trackIdForRow(row) >= 0) {
+                    rows << row;
+                }
+            }
+        }
+        foreach (int row, rows) {
+            if (pQuery->match(m_index, row)) {
+                tracks << m_index.trackIdForRow(row);
+            }
+        }
+        qSort(tracks);
+        return tracks;
+    }
+
+    ColumnarTrackIndex m_index;
+};
+
+TEST_F(ColumnarTrackIndexTest, UpdateAndRemove) {
+    addTracks();
+    EXPECT_EQ(4, m_index.size());
+    EXPECT_TRUE(m_index.contains(3));
+    EXPECT_EQ(QString("Windowlicker"),
+              m_index.value(m_index.rowForTrackId(3),
+                            m_index.columnIndex("title")).toString());
+
+    addTrack(3, "Aphex Twin", "Xtal", "1", 125.0);
+    EXPECT_EQ(4, m_index.size());
+    EXPECT_EQ(QString("Xtal"), m_index.trackValues(3)[2].toString());
+
+    m_index.removeTrack(3);
+    EXPECT_EQ(3, m_index.size());
+    EXPECT_FALSE(m_index.contains(3));
+    EXPECT_TRUE(m_index.trackValues(3).isEmpty());
+
+    // The row of the removed track is reused.
+    addTrack(5, "Boards of Canada", "Roygbiv", "3", 100.0);
+    EXPECT_EQ(4, m_index.rowCount());
+}
+
+TEST_F(ColumnarTrackIndexTest, TextCandidates) {
+    addTracks();
+    QVector<int> rows;
+    EXPECT_FALSE(m_index.textCandidates("da", &rows));
+
+    ASSERT_TRUE(m_index.textCandidates("punk", &rows));
+    EXPECT_EQ(2, rows.size());
+
+    ASSERT_TRUE(m_index.textCandidates("zzz", &rows));
+    EXPECT_TRUE(rows.isEmpty());
+
+    // Changed and removed tracks are found by their new values only.
+    addTrack(1, "Justice", "Genesis", "1", 120.0);
+    m_index.removeTrack(2);
+    addTrack(6, "Punk Band", "Song", "1", 120.0);
+    ASSERT_TRUE(m_index.textCandidates("punk", &rows));
+    QList<int> tracks;
+    foreach (int row, rows) {
+        if (m_index.textContains(row, m_index.columnIndex("artist"), "punk")) {
+            tracks << m_index.trackIdForRow(row);
+        }
+    }
+    EXPECT_EQ(QList<int>() << 6, tracks);
+}
+
+TEST_F(ColumnarTrackIndexTest, SortedRows) {
+    addTracks();
+    // Case-insensitive, equal values in row order.
+    EXPECT_EQ(QList<int>() << 3 << 4 << 1 << 2, sortedTracks("artist"));
+    EXPECT_EQ(QList<int>() << 4 << 1 << 2 << 3, sortedTracks("bpm"));
+    // Track numbers sort as integers, empty ones as 0.
+    EXPECT_EQ(QList<int>() << 4 << 3 << 1 << 2, sortedTracks("tracknumber"));
+
+    // The sorted rows follow changes.
+    addTrack(3, "Zomby", "Windowlicker", "1", 90.0);
+    m_index.removeTrack(1);
+    addTrack(7, "Autechre", "Gantz Graf", "4", 130.0);
+    EXPECT_EQ(QList<int>() << 7 << 4 << 2 << 3, sortedTracks("artist"));
+    EXPECT_EQ(QList<int>() << 4 << 3 << 2 << 7, sortedTracks("bpm"));
+}
+
+TEST_F(ColumnarTrackIndexTest, MatchQuery) {
+    addTracks();
+    QSqlDatabase database;
+    QStringList searchColumns;
+    searchColumns << "artist" << "title";
+
+    TextFilterNode text(database, searchColumns, "PUNK");
+    EXPECT_EQ(QList<int>() << 1 << 2, matchingTracks(&text));
+
+    TextFilterNode shortText(database, searchColumns, "w");
+    EXPECT_EQ(QList<int>() << 1 << 3, matchingTracks(&shortText));
+
+    NumericFilterNode bpm(QStringList() << "bpm", ">121");
+    EXPECT_EQ(QList<int>() << 2 << 3, matchingTracks(&bpm));
+
+    KeyFilterNode key(mixxx::track::io::key::C_MAJOR, false);
+    EXPECT_EQ(QList<int>() << 2, matchingTracks(&key));
+
+    AndNode andNode;
+    andNode.addNode(new TextFilterNode(database, searchColumns, "punk"));
+    andNode.addNode(new NumericFilterNode(QStringList() << "bpm", "122"));
+    EXPECT_EQ(QList<int>() << 2, matchingTracks(&andNode));
+
+    OrNode orNode;
+    orNode.addNode(new TextFilterNode(database, searchColumns, "burial"));
+    orNode.addNode(new TextFilterNode(database, searchColumns, "aphex"));
+    EXPECT_EQ(QList<int>() << 3 << 4, matchingTracks(&orNode));
+
+    SqlNode sql("bpm > 100");
+    EXPECT_FALSE(sql.canMatchIndex());
+    AndNode withSql;
+    withSql.addNode(new SqlNode("bpm > 100"));
+    EXPECT_FALSE(withSql.canMatchIndex());
+    EXPECT_TRUE(andNode.canMatchIndex());
+}
+
+TEST_F(ColumnarTrackIndexTest, MatchFullTextQuery) {
+    addTracks();
+    addTrack(5, QString::fromUtf8("Beyonc\xc3\xa9"), "Halo", "3", 80.0);
+    QSqlDatabase database;
+    QStringList searchColumns;
+    searchColumns << "artist" << "title";
+
+    // Like the full-text index, only word prefixes match, regardless of case
+    // and diacritics.
+    FullTextFilterNode prefix(database, "library_fts", "id", searchColumns,
+                              "PUN");
+    EXPECT_EQ(QList<int>() << 1 << 2, matchingTracks(&prefix));
+    FullTextFilterNode infix(database, "library_fts", "id", searchColumns,
+                             "unk");
+    EXPECT_EQ(QList<int>(), matchingTracks(&infix));
+    FullTextFilterNode folded(database, "library_fts", "id", searchColumns,
+                              "beyonce");
+    EXPECT_EQ(QList<int>() << 5, matchingTracks(&folded));
+
+    // Tracks are matched the same way as index rows.
+    TrackPointer pTrack(new TrackInfoObject());
+    pTrack->setArtist(QString::fromUtf8("Beyonc\xc3\xa9"));
+    EXPECT_TRUE(folded.match(pTrack));
+    pTrack->setArtist("Daft Punk");
+    EXPECT_TRUE(prefix.match(pTrack));
+    EXPECT_FALSE(infix.match(pTrack));
+}
+
+}  // namespace
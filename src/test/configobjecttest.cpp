@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+
+#include <QFile>
+#include <QScopedPointer>
+#include <QTemporaryFile>
+#include <QtDebug>
+
+#include "configobject.h"
+#include "test/mixxxtest.h"
+
+namespace {
+
+class ConfigObjectTest : public MixxxTest {
+  protected:
+    virtual void SetUp() {
+        m_pFile.reset(makeTemporaryFile(
+            "[Master]\n"
+            "num_decks 4\n"
+            "volume 0.5\n"
+            "\n"
+            "[Channel1]\n"
+            "rate 0.1\n"
+            "[Master]\n"
+            "balance 0\n"));
+        m_pFileConfig.reset(new ConfigObject<ConfigValue>(m_pFile->fileName()));
+    }
+
+    QString savedContents() {
+        m_pFileConfig->Save();
+        QFile file(m_pFile->fileName());
+        if (!file.open(QIODevice::ReadOnly)) {
+            return QString();
+        }
+        return QString::fromUtf8(file.readAll());
+    }
+
+    ScopedTemporaryFile m_pFile;
+    QScopedPointer<ConfigObject<ConfigValue> > m_pFileConfig;
+};
+
+TEST_F(ConfigObjectTest, GetAndSet) {
+    EXPECT_QSTRING_EQ("4", m_pFileConfig->getValueString(
+        ConfigKey("[Master]", "num_decks")));
+    EXPECT_QSTRING_EQ("0", m_pFileConfig->getValueString(
+        ConfigKey("[Master]", "balance")));
+    EXPECT_TRUE(m_pFileConfig->exists(ConfigKey("[Channel1]", "rate")));
+    EXPECT_FALSE(m_pFileConfig->exists(ConfigKey("[Channel1]", "volume")));
+
+    ConfigOption<ConfigValue>* pOption =
+            m_pFileConfig->set(ConfigKey("[Channel1]", "rate"), ConfigValue("0.2"));
+    EXPECT_EQ(pOption, m_pFileConfig->get(ConfigKey("[Channel1]", "rate")));
+    EXPECT_QSTRING_EQ("0.2", pOption->val->value);
+
+    // Getting a missing key adds it with an empty value.
+    EXPECT_QSTRING_EQ("default", m_pFileConfig->getValueString(
+        ConfigKey("[Channel1]", "volume"), "default"));
+    EXPECT_TRUE(m_pFileConfig->exists(ConfigKey("[Channel1]", "volume")));
+
+    m_pFileConfig->clear();
+    EXPECT_FALSE(m_pFileConfig->exists(ConfigKey("[Master]", "num_decks")));
+}
+
+TEST_F(ConfigObjectTest, SaveKeepsOrder) {
+    m_pFileConfig->set(ConfigKey("[Master]", "volume"), ConfigValue("1"));
+    m_pFileConfig->set(ConfigKey("[Channel2]", "rate"), ConfigValue("0"));
+    EXPECT_QSTRING_EQ(
+        "\n[Master]\n"
+        "num_decks 4\n"
+        "volume 1\n"
+        "\n[Channel1]\n"
+        "rate 0.1\n"
+        "\n[Master]\n"
+        "balance 0\n"
+        "\n[Channel2]\n"
+        "rate 0\n",
+        savedContents());
+}
+
+}  // namespace
@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+#include <QtDebug>
+
+#include "controlobject.h"
+#include "controlpushbutton.h"
+#include "engine/controleventqueue.h"
+
+namespace {
+
+class ControlEventQueueTest : public testing::Test {
+  protected:
+    virtual void SetUp() {
+        m_pPlay = new ControlPushButton(ConfigKey("[Test]", "play"));
+        m_pPlay->setButtonMode(ControlPushButton::TOGGLE);
+        m_pRate = new ControlObject(ConfigKey("[Test]", "rate"));
+        m_pScratch = new ControlObject(ConfigKey("[Test]", "scratch2"));
+        m_pVolume = new ControlObject(ConfigKey("[Test]", "volume"));
+        m_pQueue = new ControlEventQueue("[Test]");
+        // Changes are only queued for decks that the engine processes.
+        m_pQueue->startCallback(0, 0, 0);
+    }
+
+    virtual void TearDown() {
+        delete m_pQueue;
+        delete m_pVolume;
+        delete m_pScratch;
+        delete m_pRate;
+        delete m_pPlay;
+    }
+
+    ControlPushButton* m_pPlay;
+    ControlObject* m_pRate;
+    ControlObject* m_pScratch;
+    ControlObject* m_pVolume;
+    ControlEventQueue* m_pQueue;
+};
+
+TEST_F(ControlEventQueueTest, OnlyDeckControlsAreScheduled) {
+    EXPECT_FALSE(ControlEventQueue::schedule(m_pVolume, 0.5, 1000));
+    EXPECT_TRUE(ControlEventQueue::schedule(m_pScratch, 0.5, 1000));
+
+    delete m_pQueue;
+    m_pQueue = NULL;
+    EXPECT_FALSE(ControlEventQueue::schedule(m_pScratch, 0.5, 1000));
+}
+
+TEST_F(ControlEventQueueTest, EventsAreAppliedAtTheirOffset) {
+    ASSERT_TRUE(ControlEventQueue::schedule(m_pScratch, 1.0, 1250));
+    ASSERT_TRUE(ControlEventQueue::schedule(m_pScratch, 2.0, 1500));
+
+    m_pQueue->startCallback(1000, 2000, 128);
+    EXPECT_EQ(32, m_pQueue->nextEventOffset());
+    EXPECT_DOUBLE_EQ(0.0, m_pScratch->get());
+    EXPECT_EQ(32, m_pQueue->applyNextEvent());
+    EXPECT_DOUBLE_EQ(1.0, m_pScratch->get());
+    EXPECT_EQ(64, m_pQueue->nextEventOffset());
+    EXPECT_EQ(64, m_pQueue->applyNextEvent());
+    EXPECT_DOUBLE_EQ(2.0, m_pScratch->get());
+    EXPECT_EQ(128, m_pQueue->nextEventOffset());
+}
+
+TEST_F(ControlEventQueueTest, EventsAfterTheCallbackStartWait) {
+    ASSERT_TRUE(ControlEventQueue::schedule(m_pRate, 0.25, 2500));
+
+    m_pQueue->startCallback(1000, 2000, 128);
+    EXPECT_EQ(128, m_pQueue->nextEventOffset());
+    m_pQueue->applyAllEvents();
+    EXPECT_DOUBLE_EQ(0.0, m_pRate->get());
+
+    m_pQueue->startCallback(2000, 3000, 128);
+    EXPECT_EQ(64, m_pQueue->nextEventOffset());
+    m_pQueue->applyAllEvents();
+    EXPECT_DOUBLE_EQ(0.25, m_pRate->get());
+}
+
+TEST_F(ControlEventQueueTest, LateEventsAreAppliedFirst) {
+    ASSERT_TRUE(ControlEventQueue::schedule(m_pPlay, 1.0, 500));
+
+    m_pQueue->startCallback(1000, 2000, 128);
+    EXPECT_EQ(0, m_pQueue->nextEventOffset());
+    m_pQueue->applyAllEvents();
+    EXPECT_DOUBLE_EQ(1.0, m_pPlay->get());
+}
+
+TEST_F(ControlEventQueueTest, OffsetsAreFramesThatNeverGoBack) {
+    // 3 samples into the callback, which rounds down to the frame at 2.
+    ASSERT_TRUE(ControlEventQueue::schedule(m_pScratch, 1.0, 1024));
+    ASSERT_TRUE(ControlEventQueue::schedule(m_pScratch, 2.0, 1500));
+    // Received earlier than the previous event from another controller.
+    ASSERT_TRUE(ControlEventQueue::schedule(m_pScratch, 3.0, 1250));
+
+    m_pQueue->startCallback(1000, 2000, 128);
+    EXPECT_EQ(2, m_pQueue->applyNextEvent());
+    EXPECT_EQ(64, m_pQueue->applyNextEvent());
+    EXPECT_EQ(64, m_pQueue->applyNextEvent());
+    EXPECT_DOUBLE_EQ(3.0, m_pScratch->get());
+    EXPECT_EQ(128, m_pQueue->nextEventOffset());
+}
+
+TEST_F(ControlEventQueueTest, MidiEventsUseTheControlBehavior) {
+    // A toggle button toggles on press and ignores the release.
+    ASSERT_TRUE(ControlEventQueue::scheduleFromMidi(
+            m_pPlay, MIDI_NOTE_ON, 127.0, 1250));
+    ASSERT_TRUE(ControlEventQueue::scheduleFromMidi(
+            m_pPlay, MIDI_NOTE_OFF, 0.0, 1500));
+
+    m_pQueue->startCallback(1000, 2000, 128);
+    m_pQueue->applyAllEvents();
+    EXPECT_DOUBLE_EQ(1.0, m_pPlay->get());
+}
+
+TEST_F(ControlEventQueueTest, SkippedDecksAreNotScheduled) {
+    ASSERT_TRUE(ControlEventQueue::schedule(m_pRate, 0.25, 1250));
+
+    // The queued change is applied when the deck is skipped.
+    m_pQueue->skipCallback();
+    EXPECT_DOUBLE_EQ(0.25, m_pRate->get());
+    EXPECT_FALSE(ControlEventQueue::schedule(m_pRate, 0.5, 1500));
+
+    m_pQueue->startCallback(1000, 2000, 128);
+    EXPECT_TRUE(ControlEventQueue::schedule(m_pRate, 0.5, 2500));
+}
+
+TEST_F(ControlEventQueueTest, DirectChangesDropOlderEvents) {
+    ASSERT_TRUE(ControlEventQueue::schedule(m_pRate, 0.25, 1250));
+    ControlEventQueue::setDirectly(m_pRate);
+    m_pRate->set(0.5);
+    ASSERT_TRUE(ControlEventQueue::schedule(m_pScratch, 1.0, 1500));
+
+    m_pQueue->startCallback(1000, 2000, 128);
+    m_pQueue->applyAllEvents();
+    EXPECT_DOUBLE_EQ(0.5, m_pRate->get());
+    EXPECT_DOUBLE_EQ(1.0, m_pScratch->get());
+}
+
+TEST_F(ControlEventQueueTest, FullQueueDoesNotReorderChanges) {
+    int queued = 0;
+    while (queued < 4096 &&
+           ControlEventQueue::schedule(m_pRate, 0.25, 1250)) {
+        ++queued;
+    }
+    ASSERT_LT(queued, 4096);
+    // The caller sets the change that did not fit directly.
+    m_pRate->set(0.5);
+
+    m_pQueue->startCallback(1000, 2000, 128);
+    m_pQueue->applyAllEvents();
+    EXPECT_DOUBLE_EQ(0.5, m_pRate->get());
+}
+
+TEST_F(ControlEventQueueTest, PendingValueIsTheLastQueuedChange) {
+    double value = 0.0;
+    EXPECT_FALSE(ControlEventQueue::pendingValue(m_pRate, &value));
+    ASSERT_TRUE(ControlEventQueue::schedule(m_pRate, 0.25, 1250));
+    ASSERT_TRUE(ControlEventQueue::schedule(m_pRate, 0.5, 1500));
+    EXPECT_TRUE(ControlEventQueue::pendingValue(m_pRate, &value));
+    EXPECT_DOUBLE_EQ(0.5, value);
+
+    m_pQueue->startCallback(1000, 2000, 128);
+    m_pQueue->applyAllEvents();
+    EXPECT_FALSE(ControlEventQueue::pendingValue(m_pRate, &value));
+
+    // The value a MIDI change maps to is not known in advance.
+    ASSERT_TRUE(ControlEventQueue::scheduleFromMidi(
+            m_pPlay, MIDI_NOTE_ON, 127.0, 2500));
+    EXPECT_FALSE(ControlEventQueue::pendingValue(m_pPlay, &value));
+}
+
+}  // namespace
@@ -9,6 +9,7 @@
 #include "controlpotmeter.h"
 #include "configobject.h"
 #include "controllers/controllerengine.h"
+#include "engine/controleventqueue.h"
 #include "test/mixxxtest.h"
 
 namespace {
@@ -68,6 +69,32 @@ TEST_F(ControllerEngineTest, scriptGetSetValue) {
     EXPECT_DOUBLE_EQ(co->get(), 1.0);
 }
 
+TEST_F(ControllerEngineTest, scriptGetSetScheduledValue) {
+    ScopedTemporaryFile script(makeTemporaryFile(
+        "nudge = function() { var val = engine.getValue('[Channel1]', 'rate'); engine.setValue('[Channel1]', 'rate', val + 0.1); }\n"));
+
+    cEngine->evaluate(script->fileName());
+    EXPECT_FALSE(cEngine->hasErrors(script->fileName()));
+
+    ScopedControl play(new ControlObject(ConfigKey("[Channel1]", "play")));
+    ScopedControl rate(new ControlObject(ConfigKey("[Channel1]", "rate")));
+    ScopedControl scratch(new ControlObject(ConfigKey("[Channel1]", "scratch2")));
+    ControlEventQueue queue("[Channel1]");
+    queue.startCallback(0, 0, 0);
+
+    // Two messages that are handled before the engine applies either.
+    cEngine->setEventTimestamp(1250);
+    cEngine->execute("nudge");
+    cEngine->setEventTimestamp(1500);
+    cEngine->execute("nudge");
+    cEngine->setEventTimestamp(-1);
+    EXPECT_DOUBLE_EQ(0.0, rate->get());
+
+    queue.startCallback(1000, 2000, 128);
+    queue.applyAllEvents();
+    EXPECT_DOUBLE_EQ(0.2, rate->get());
+}
+
 TEST_F(ControllerEngineTest, scriptConnectDisconnectControlNamedFunction) {
     ScopedTemporaryFile script(makeTemporaryFile(
         "var executed = false;\n"
@@ -0,0 +1,156 @@
+#include <gtest/gtest.h>
+
+// QSocketNotifier only supports sockets on Windows.
+#ifndef __WINDOWS__
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <QList>
+#include <QtDebug>
+
+#include "controllers/controllerpollnotifiers.h"
+#include "controllers/midi/midicontroller.h"
+#include "test/mixxxtest.h"
+
+namespace {
+
+// Has input while a byte can be read from the pipe it waits on.
+class PipeController : public MidiController {
+  public:
+    PipeController()
+            : m_iPollCount(0),
+              m_iReadCount(0) {
+        m_descriptors[0] = -1;
+        m_descriptors[1] = -1;
+    }
+    virtual ~PipeController() {
+        for (int i = 0; i < 2; ++i) {
+            if (m_descriptors[i] >= 0) {
+                ::close(m_descriptors[i]);
+            }
+        }
+    }
+
+    virtual int open() {
+        setOpen(true);
+        return 0;
+    }
+    virtual int close() {
+        setOpen(false);
+        return 0;
+    }
+
+    bool openPipe() {
+        if (pipe(m_descriptors) != 0) {
+            return false;
+        }
+        fcntl(m_descriptors[0], F_SETFL, O_NONBLOCK);
+        return true;
+    }
+    void sendInput(int bytes) {
+        const char input[] = "input";
+        ASSERT_EQ(bytes,
+                  static_cast<int>(write(m_descriptors[1], input, bytes)));
+    }
+
+    int m_iPollCount;
+    int m_iReadCount;
+
+  private:
+    virtual bool poll() {
+        ++m_iPollCount;
+        char input;
+        if (read(m_descriptors[0], &input, 1) != 1) {
+            return false;
+        }
+        ++m_iReadCount;
+        return true;
+    }
+    virtual int pollDescriptor() const {
+        return m_descriptors[0];
+    }
+    virtual void sendWord(unsigned int) {
+    }
+    virtual void send(QByteArray) {
+    }
+    virtual bool isPolling() const {
+        return true;
+    }
+
+    int m_descriptors[2];
+};
+
+class ControllerPollNotifiersTest : public MixxxTest {
+  protected:
+    virtual void SetUp() {
+        ASSERT_TRUE(m_controller.openPipe());
+        m_controller.open();
+        m_controllers.append(&m_controller);
+    }
+
+    // Processes events until the controller was polled or a few rounds
+    // passed without it.
+    void processEvents() {
+        for (int i = 0; i < 10 && m_controller.m_iPollCount == 0; ++i) {
+            application()->processEvents();
+        }
+    }
+
+    PipeController m_controller;
+    QList<Controller*> m_controllers;
+    ControllerPollNotifiers m_notifiers;
+};
+
+TEST_F(ControllerPollNotifiersTest, ControllersWithDescriptorAreNotPolledOnTimer) {
+    EXPECT_FALSE(m_notifiers.update(m_controllers));
+    EXPECT_TRUE(m_notifiers.contains(&m_controller));
+}
+
+TEST_F(ControllerPollNotifiersTest, ControllersWithoutDescriptorArePolledOnTimer) {
+    PipeController timerController;
+    // Has no pipe to wait on.
+    timerController.open();
+    m_controllers.append(&timerController);
+
+    EXPECT_TRUE(m_notifiers.update(m_controllers));
+    EXPECT_TRUE(m_notifiers.contains(&m_controller));
+    EXPECT_FALSE(m_notifiers.contains(&timerController));
+}
+
+TEST_F(ControllerPollNotifiersTest, InputPollsUntilAllIsHandled) {
+    m_notifiers.update(m_controllers);
+    processEvents();
+    EXPECT_EQ(0, m_controller.m_iPollCount);
+
+    m_controller.sendInput(3);
+    processEvents();
+    EXPECT_EQ(3, m_controller.m_iReadCount);
+    // The last poll found nothing left.
+    EXPECT_EQ(4, m_controller.m_iPollCount);
+}
+
+TEST_F(ControllerPollNotifiersTest, ClosedControllersLoseTheirNotifier) {
+    m_notifiers.update(m_controllers);
+    ASSERT_TRUE(m_notifiers.contains(&m_controller));
+
+    m_controller.sendInput(1);
+    m_controller.close();
+    EXPECT_FALSE(m_notifiers.update(m_controllers));
+    EXPECT_FALSE(m_notifiers.contains(&m_controller));
+    processEvents();
+    EXPECT_EQ(0, m_controller.m_iPollCount);
+}
+
+TEST_F(ControllerPollNotifiersTest, ClearDeletesAllNotifiers) {
+    m_notifiers.update(m_controllers);
+    m_notifiers.clear();
+    EXPECT_FALSE(m_notifiers.contains(&m_controller));
+
+    m_controller.sendInput(1);
+    processEvents();
+    EXPECT_EQ(0, m_controller.m_iPollCount);
+}
+
+}  // namespace
+
+#endif  // __WINDOWS__
@@ -0,0 +1,216 @@
+#include <gtest/gtest.h>
+
+#include <QtDebug>
+
+#include "cachingreaderworker.h"
+#include "decodedtrackcache.h"
+#include "soundsource.h"
+#include "test/mixxxtest.h"
+#include "util/fifo.h"
+
+namespace {
+
+// Six chunks per track, two tracks fit into 1 MiB.
+const int kTrackChunks = 6;
+const int kTrackSamples = CachingReaderWorker::kSamplesPerChunk * kTrackChunks;
+const qint64 kTrackBytes = kTrackSamples * sizeof(CSAMPLE);
+
+class DecodedTrackCacheTest : public MixxxTest {
+  protected:
+    virtual void SetUp() {
+        // Room for two tracks.
+        config()->set(ConfigKey("[CachingReader]", "DecodedTrackCacheMB"),
+                      ConfigValue(1));
+        m_pCache = DecodedTrackCache::create();
+        m_pCache->setConfig(config());
+        ASSERT_LE(2 * kTrackBytes, m_pCache->memoryBudget());
+        ASSERT_GT(3 * kTrackBytes, m_pCache->memoryBudget());
+    }
+
+    virtual void TearDown() {
+        DecodedTrackCache::destroy();
+    }
+
+    DecodedTrackCache* m_pCache;
+};
+
+// A track whose samples are the number of the chunk they are in, plus one.
+// Reading at failAtSample fails once, like a decoder that hits a corrupt
+// frame.
+class FakeSoundSource : public Mixxx::SoundSource {
+  public:
+    FakeSoundSource(int numSamples, int failAtSample)
+            : Mixxx::SoundSource("fake"),
+              m_iNumSamples(numSamples),
+              m_iFailAtSample(failAtSample),
+              m_iPosition(0) {
+    }
+
+    int open() {
+        return OK;
+    }
+    long seek(long position) {
+        m_iPosition = position;
+        return position;
+    }
+    unsigned read(unsigned long size, const SAMPLE* destination) {
+        Q_UNUSED(size);
+        Q_UNUSED(destination);
+        return 0;
+    }
+    unsigned readFloat(unsigned long size, CSAMPLE* destination) {
+        if (m_iPosition == m_iFailAtSample) {
+            m_iFailAtSample = -1;
+            return 0;
+        }
+        unsigned long samples = math_min(
+                size, static_cast<unsigned long>(m_iNumSamples - m_iPosition));
+        for (unsigned long i = 0; i < samples; ++i) {
+            destination[i] = 1 + (m_iPosition + i) /
+                    CachingReaderWorker::kSamplesPerChunk;
+        }
+        m_iPosition += samples;
+        return samples;
+    }
+    long unsigned length() {
+        return m_iNumSamples;
+    }
+    int parseHeader() {
+        return OK;
+    }
+
+  private:
+    const int m_iNumSamples;
+    int m_iFailAtSample;
+    long m_iPosition;
+};
+
+class DecodingWorkerTest : public DecodedTrackCacheTest {
+  protected:
+    DecodingWorkerTest()
+            : m_chunkReadRequests(16),
+              m_readerStatus(16),
+              m_pWorker(NULL) {
+    }
+
+    virtual void SetUp() {
+        DecodedTrackCacheTest::SetUp();
+        m_pWorker = new CachingReaderWorker("[Test]", &m_chunkReadRequests,
+                                            &m_readerStatus, &m_hintGeneration);
+        m_pWorker->setDecodeToRam(true);
+    }
+
+    virtual void TearDown() {
+        // Releases the worker's pin before the cache is destroyed.
+        delete m_pWorker;
+        DecodedTrackCacheTest::TearDown();
+    }
+
+    // Loads pSoundSource and decodes as much of it as possible. Returns the
+    // decoded track, which must be released.
+    DecodedTrack* loadAndDecode(FakeSoundSource* pSoundSource) {
+        m_pWorker->loadSoundSourceForTest(pSoundSource, "track");
+        ReaderStatusUpdate status;
+        EXPECT_EQ(1, m_readerStatus.read(&status, 1));
+        EXPECT_EQ(DECODED_TRACK_AVAILABLE, status.status);
+        while (m_pWorker->decodeNextChunkForTest()) {
+        }
+        return status.decodedTrack;
+    }
+
+    FIFO<ChunkReadRequest> m_chunkReadRequests;
+    FIFO<ReaderStatusUpdate> m_readerStatus;
+    QAtomicInt m_hintGeneration;
+    CachingReaderWorker* m_pWorker;
+};
+
+TEST_F(DecodedTrackCacheTest, ChunksArePublishedOnce) {
+    DecodedTrack* pTrack = m_pCache->acquire("a", kTrackSamples);
+    ASSERT_TRUE(pTrack != NULL);
+    EXPECT_EQ(kTrackChunks, pTrack->numChunks());
+    EXPECT_FALSE(pTrack->isChunkDecoded(0));
+
+    CSAMPLE* pBuffer = pTrack->claimChunk(0);
+    ASSERT_TRUE(pBuffer != NULL);
+    // Another worker can't claim a chunk that is being decoded.
+    EXPECT_TRUE(pTrack->claimChunk(0) == NULL);
+    pBuffer[0] = 0.5;
+    pTrack->setChunkDecoded(0, CachingReaderWorker::kSamplesPerChunk);
+
+    EXPECT_TRUE(pTrack->isChunkDecoded(0));
+    EXPECT_FLOAT_EQ(0.5, pTrack->chunkData(0)[0]);
+    EXPECT_FALSE(pTrack->isComplete());
+    EXPECT_TRUE(pTrack->claimChunk(0) == NULL);
+
+    for (int i = 1; i < kTrackChunks; ++i) {
+        ASSERT_TRUE(pTrack->claimChunk(i) != NULL);
+        pTrack->setChunkDecoded(i, CachingReaderWorker::kSamplesPerChunk);
+    }
+    EXPECT_TRUE(pTrack->isComplete());
+    DecodedTrackCache::release(pTrack);
+}
+
+TEST_F(DecodedTrackCacheTest, ReacquireReturnsDecodedTrack) {
+    DecodedTrack* pTrack = m_pCache->acquire("a", kTrackSamples);
+    ASSERT_TRUE(pTrack != NULL);
+    DecodedTrackCache::release(pTrack);
+    EXPECT_EQ(pTrack, m_pCache->acquire("a", kTrackSamples));
+    DecodedTrackCache::release(pTrack);
+}
+
+TEST_F(DecodedTrackCacheTest, EvictsLeastRecentlyUsed) {
+    DecodedTrack* pA = m_pCache->acquire("a", kTrackSamples);
+    DecodedTrack* pB = m_pCache->acquire("b", kTrackSamples);
+    ASSERT_TRUE(pA != NULL);
+    ASSERT_TRUE(pB != NULL);
+    DecodedTrackCache::release(pB);
+    DecodedTrackCache::release(pA);
+    // a was used more recently than b.
+    DecodedTrackCache::release(m_pCache->acquire("a", kTrackSamples));
+
+    DecodedTrack* pC = m_pCache->acquire("c", kTrackSamples);
+    ASSERT_TRUE(pC != NULL);
+    EXPECT_EQ(2 * kTrackBytes, m_pCache->bytesInUse());
+    // b was evicted, so it is decoded again into a new track.
+    DecodedTrack* pB2 = m_pCache->acquire("b", kTrackSamples);
+    ASSERT_TRUE(pB2 != NULL);
+    EXPECT_EQ(2 * kTrackBytes, m_pCache->bytesInUse());
+    DecodedTrackCache::release(pB2);
+    DecodedTrackCache::release(pC);
+}
+
+TEST_F(DecodedTrackCacheTest, PinnedTracksAreNotEvicted) {
+    DecodedTrack* pA = m_pCache->acquire("a", kTrackSamples);
+    DecodedTrack* pB = m_pCache->acquire("b", kTrackSamples);
+    ASSERT_TRUE(pA != NULL);
+    ASSERT_TRUE(pB != NULL);
+    EXPECT_TRUE(m_pCache->acquire("c", kTrackSamples) == NULL);
+    DecodedTrackCache::release(pA);
+    DecodedTrackCache::release(pB);
+}
+
+TEST_F(DecodingWorkerTest, FailedChunksAreDecodedAgainOnReload) {
+    const int failingChunk = 2;
+    DecodedTrack* pTrack = loadAndDecode(new FakeSoundSource(
+            kTrackSamples,
+            CachingReaderWorker::sampleForChunk(failingChunk)));
+    ASSERT_TRUE(pTrack != NULL);
+    for (int i = 0; i < kTrackChunks; ++i) {
+        EXPECT_EQ(i != failingChunk, pTrack->isChunkDecoded(i));
+    }
+    EXPECT_FALSE(pTrack->isComplete());
+    DecodedTrackCache::release(pTrack);
+
+    // The chunk is still empty in the cache, so loading the track again
+    // decodes it instead of playing silence.
+    pTrack = loadAndDecode(new FakeSoundSource(kTrackSamples, -1));
+    ASSERT_TRUE(pTrack != NULL);
+    EXPECT_TRUE(pTrack->isComplete());
+    ASSERT_TRUE(pTrack->isChunkDecoded(failingChunk));
+    EXPECT_EQ(CachingReaderWorker::kSamplesPerChunk,
+              pTrack->chunkLength(failingChunk));
+    EXPECT_FLOAT_EQ(failingChunk + 1, pTrack->chunkData(failingChunk)[0]);
+    DecodedTrackCache::release(pTrack);
+}
+
+}  // namespace
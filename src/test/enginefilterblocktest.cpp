@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include <new>
+
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QThread>
+#include <QtDebug>
+
+#include "controlobject.h"
+#include "engine/enginefilterblock.h"
+#include "mathstuff.h"
+#include "sampleutil.h"
+#include "test/mixxxtest.h"
+#include "util/compatibility.h"
+
+namespace {
+
+// Counts the allocations that the thread in s_countingThread makes. Other
+// threads of the test binary, and the test thread outside of
+// processBuffer(), allocate without being counted.
+QAtomicPointer<void> s_countingThread(NULL);
+QAtomicInt s_iAllocations(0);
+
+bool isCountingThread() {
+#if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
+    void* pCountingThread = s_countingThread;
+#else
+    void* pCountingThread = s_countingThread.load();
+#endif
+    return pCountingThread != NULL &&
+            pCountingThread == QThread::currentThreadId();
+}
+
+void* countedAlloc(size_t size) {
+    if (isCountingThread()) {
+        s_iAllocations.ref();
+    }
+    void* p = malloc(size > 0 ? size : 1);
+    if (p == NULL) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+}  // namespace
+
+void* operator new(size_t size) {
+    return countedAlloc(size);
+}
+
+void* operator new[](size_t size) {
+    return countedAlloc(size);
+}
+
+void operator delete(void* p) {
+    free(p);
+}
+
+void operator delete[](void* p) {
+    free(p);
+}
+
+namespace {
+
+class EngineFilterBlockTest : public MixxxTest {
+  protected:
+    virtual void SetUp() {
+        m_pSampleRate.reset(new ControlObject(ConfigKey("[Master]", "samplerate")));
+        m_pSampleRate->set(44100);
+        m_pFilterBlock = new EngineFilterBlock("[Channel1]");
+        ControlObject::set(ConfigKey("[Mixer Profile]", "EnableEQs"), 1.0);
+        ControlObject::set(ConfigKey("[Mixer Profile]", "LoEQFrequency"), 246.0);
+        ControlObject::set(ConfigKey("[Mixer Profile]", "HiEQFrequency"), 2484.0);
+
+        m_pInput = SampleUtil::alloc(kBufferSize);
+        m_pOutput = SampleUtil::alloc(kBufferSize);
+    }
+
+    virtual void TearDown() {
+        SampleUtil::free(m_pInput);
+        SampleUtil::free(m_pOutput);
+        delete m_pFilterBlock;
+    }
+
+    // Processes the next buffer of a 1 kHz sine and returns the number of
+    // allocations process() made.
+    int processBuffer() {
+        for (int i = 0; i < kBufferSize; i += 2) {
+            m_pInput[i] = m_pInput[i + 1] =
+                    sin(two_pi * 1000.0 * (m_iFrame++) / 44100.0);
+        }
+        s_iAllocations.fetchAndStoreRelaxed(0);
+        s_countingThread.fetchAndStoreOrdered(QThread::currentThreadId());
+        m_pFilterBlock->process(m_pInput, m_pOutput, kBufferSize);
+        s_countingThread.fetchAndStoreOrdered(NULL);
+        return deref(s_iAllocations);
+    }
+
+    static const int kBufferSize = 1024;
+
+    ScopedControl m_pSampleRate;
+    EngineFilterBlock* m_pFilterBlock;
+    CSAMPLE* m_pInput;
+    CSAMPLE* m_pOutput;
+    int m_iFrame;
+};
+
+TEST_F(EngineFilterBlockTest, NoAllocationsDuringEqSweep) {
+    m_iFrame = 0;
+    for (int i = 0; i < 200; ++i) {
+        // The coefficients are designed in this thread when the controls
+        // change, and picked up by the next process().
+        ControlObject::set(ConfigKey("[Mixer Profile]", "LoEQFrequency"),
+                           100.0 + 2.0 * i);
+        ControlObject::set(ConfigKey("[Mixer Profile]", "HiEQFrequency"),
+                           2000.0 + 20.0 * i);
+        if (i == 100 || i == 150) {
+            ControlObject::set(ConfigKey("[Mixer Profile]", "LoFiEQs"),
+                               i == 100 ? 1.0 : 0.0);
+        }
+        if (i == 120) {
+            m_pSampleRate->set(48000);
+        }
+        EXPECT_EQ(0, processBuffer()) << "buffer " << i;
+        EXPECT_FALSE(SampleUtil::isOutsideRange(4.0, -4.0, m_pOutput, kBufferSize))
+                << "buffer " << i;
+    }
+}
+
+}  // namespace
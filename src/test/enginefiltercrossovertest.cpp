@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include <math.h>
+
+#include <QtDebug>
+#include <QVector>
+
+#include "engine/enginefiltercrossover.h"
+#include "mathstuff.h"
+
+namespace {
+
+class EngineFilterCrossoverTest : public testing::Test {
+  protected:
+    // Plays one second of a stereo sine at freq through a new crossover and
+    // returns the RMS of each band over the second half, after the filters
+    // have settled.
+    void measureBands(int sampleRate, double freq, double rms[3]) {
+        EngineFilterCrossover crossover(sampleRate, 600.0, 4000.0);
+        const int samples = sampleRate * 2;
+        QVector<CSAMPLE> input(samples);
+        QVector<CSAMPLE> bands[3];
+        for (int band = 0; band < 3; ++band) {
+            bands[band].resize(samples);
+        }
+        for (int i = 0; i < samples; i += 2) {
+            input[i] = input[i + 1] = sin(two_pi * freq * (i / 2) / sampleRate);
+        }
+        crossover.process(input.constData(), bands[0].data(), bands[1].data(),
+                          bands[2].data(), samples);
+        for (int band = 0; band < 3; ++band) {
+            double sum = 0;
+            for (int i = samples / 2; i < samples; ++i) {
+                sum += bands[band][i] * bands[band][i];
+            }
+            rms[band] = sqrt(sum / (samples / 2));
+        }
+    }
+};
+
+TEST_F(EngineFilterCrossoverTest, BandsAtAllSampleRates) {
+    const int sampleRates[] = { 22050, 44100, 48000, 96000, 192000 };
+    // The RMS of a full scale sine.
+    const double kFull = sqrt(0.5);
+    for (unsigned int i = 0; i < sizeof(sampleRates) / sizeof(int); ++i) {
+        const int sampleRate = sampleRates[i];
+        double rms[3];
+
+        measureBands(sampleRate, 100.0, rms);
+        EXPECT_NEAR(kFull, rms[0], 0.05) << sampleRate;
+        EXPECT_GT(0.01, rms[1]) << sampleRate;
+        EXPECT_GT(0.01, rms[2]) << sampleRate;
+
+        measureBands(sampleRate, 1500.0, rms);
+        EXPECT_GT(0.1, rms[0]) << sampleRate;
+        EXPECT_NEAR(kFull, rms[1], 0.05) << sampleRate;
+        EXPECT_GT(0.1, rms[2]) << sampleRate;
+
+        measureBands(sampleRate, 10000.0, rms);
+        EXPECT_GT(0.01, rms[0]) << sampleRate;
+        EXPECT_GT(0.06, rms[1]) << sampleRate;
+        EXPECT_NEAR(kFull, rms[2], 0.05) << sampleRate;
+    }
+}
+
+TEST_F(EngineFilterCrossoverTest, CornersBelowNyquist) {
+    EngineFilterCrossover crossover(8000, 600.0, 4000.0);
+    EXPECT_GT(4000.0, crossover.midHighCorner());
+    EXPECT_GT(crossover.midHighCorner(), crossover.lowMidCorner());
+
+    const int samples = 1024;
+    QVector<CSAMPLE> input(samples, 0.5);
+    QVector<CSAMPLE> low(samples), mid(samples), high(samples);
+    crossover.process(input.constData(), low.data(), mid.data(), high.data(),
+                      samples);
+    for (int i = 0; i < samples; ++i) {
+        EXPECT_FALSE(isnan(low[i]) || isnan(mid[i]) || isnan(high[i]));
+    }
+}
+
+TEST_F(EngineFilterCrossoverTest, ResetClearsState) {
+    EngineFilterCrossover crossover(44100, 600.0, 4000.0);
+    const int samples = 1024;
+    QVector<CSAMPLE> input(samples, 0.5);
+    QVector<CSAMPLE> low(samples), mid(samples), high(samples);
+    crossover.process(input.constData(), low.data(), mid.data(), high.data(),
+                      samples);
+
+    crossover.reset();
+    QVector<CSAMPLE> silence(samples, 0.0);
+    crossover.process(silence.constData(), low.data(), mid.data(), high.data(),
+                      samples);
+    for (int i = 0; i < samples; ++i) {
+        EXPECT_EQ(0.0, low[i]);
+        EXPECT_EQ(0.0, mid[i]);
+        EXPECT_EQ(0.0, high[i]);
+    }
+}
+
+}  // namespace
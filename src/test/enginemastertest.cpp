@@ -1,7 +1,9 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
+#include <QByteArray>
 #include <QtDebug>
+#include <QVector>
 
 #include "defs.h"
 #include "engine/enginemaster.h"
@@ -30,6 +32,39 @@ class EngineChannelMock : public EngineChannel {
     MOCK_METHOD3(process, void(const CSAMPLE* pIn, CSAMPLE* pOut, const int iBufferSize));
 };
 
+// A channel that produces a deterministic signal that changes with every
+// callback so that the mixed output depends on each channel being processed
+// exactly once per callback.
+class EngineChannelSignal : public EngineChannel {
+  public:
+    EngineChannelSignal(const char* group, ChannelOrientation defaultOrientation,
+                        CSAMPLE amplitude)
+            : EngineChannel(group, defaultOrientation),
+              m_amplitude(amplitude),
+              m_iCallback(0) {
+    }
+
+    bool isActive() {
+        return true;
+    }
+
+    void process(const CSAMPLE* pIn, CSAMPLE* pOut, const int iBufferSize) {
+        Q_UNUSED(pIn);
+        for (int i = 0; i < iBufferSize; ++i) {
+            pOut[i] = m_amplitude * ((m_iCallback * iBufferSize + i) % 97) / 97.0f;
+        }
+        ++m_iCallback;
+    }
+
+    void reset() {
+        m_iCallback = 0;
+    }
+
+  private:
+    const CSAMPLE m_amplitude;
+    int m_iCallback;
+};
+
 class EngineMasterTest : public MixxxTest {
   protected:
     virtual void SetUp() {
@@ -393,4 +428,118 @@ TEST_F(EngineMasterTest, SingleChannelPFLOutputWorks) {
     AssertWholeBufferEquals(pHeadphoneBuffer, 0.1f, MAX_BUFFER_LEN);
 }
 
+TEST_F(EngineMasterTest, InactiveChannelSleepsUntilWokenUp) {
+    EngineChannelMock* pChannel = new EngineChannelMock("[Test1]", EngineChannel::CENTER);
+    m_pMaster->addChannel(pChannel);
+
+    // The channel is only asked whether it is active in the first callback
+    // and once it was woken up.
+    EXPECT_CALL(*pChannel, isActive())
+            .Times(2)
+            .WillRepeatedly(Return(false));
+    EXPECT_CALL(*pChannel, process(_, _, _))
+            .Times(0);
+
+    m_pMaster->process(MAX_BUFFER_LEN);
+    m_pMaster->process(MAX_BUFFER_LEN);
+    m_pMaster->wakeUpChannel(0);
+    m_pMaster->process(MAX_BUFFER_LEN);
+}
+
+TEST_F(EngineMasterTest, ManyChannelOutputWorks) {
+    // More channels than the generated mixing functions handle.
+    const int kChannels = 40;
+    QList<QByteArray> groups;
+    for (int i = 0; i < kChannels; ++i) {
+        groups.append(QString("[Test%1]").arg(i + 1).toAscii());
+    }
+
+    for (int i = 0; i < kChannels; ++i) {
+        EngineChannelMock* pChannel = new EngineChannelMock(
+            groups[i].constData(), EngineChannel::CENTER);
+        m_pMaster->addChannel(pChannel);
+        CSAMPLE* pChannelBuffer = const_cast<CSAMPLE*>(
+            m_pMaster->getChannelBuffer(groups[i]));
+        FillBuffer(pChannelBuffer, 0.01f, MAX_BUFFER_LEN);
+
+        EXPECT_CALL(*pChannel, isActive())
+                .Times(1)
+                .WillOnce(Return(true));
+        EXPECT_CALL(*pChannel, isMaster())
+                .Times(1)
+                .WillOnce(Return(true));
+        EXPECT_CALL(*pChannel, isPFL())
+                .Times(1)
+                .WillOnce(Return(i % 2 == 0));
+        EXPECT_CALL(*pChannel, process(_, _, MAX_BUFFER_LEN))
+                .Times(1)
+                .WillOnce(Return());
+    }
+
+    m_pMaster->process(MAX_BUFFER_LEN);
+
+    // Check that the master output contains the sum of all channels and the
+    // headphone output the sum of every other channel.
+    const CSAMPLE* pMasterBuffer = m_pMaster->getMasterBuffer();
+    const CSAMPLE* pHeadphoneBuffer = m_pMaster->getHeadphoneBuffer();
+    for (int i = 0; i < MAX_BUFFER_LEN; ++i) {
+        EXPECT_NEAR(0.4f, pMasterBuffer[i], 1e-5);
+        EXPECT_NEAR(0.2f, pHeadphoneBuffer[i], 1e-5);
+    }
+}
+
+TEST_F(EngineMasterTest, ParallelProcessingMatchesSerial) {
+    const int kChannels = 8;
+    const int kCallbacks = 16;
+    const int kBufferSize = 1024;
+    const char* groups[kChannels] = {
+        "[Test1]", "[Test2]", "[Test3]", "[Test4]",
+        "[Test5]", "[Test6]", "[Test7]", "[Test8]" };
+    const EngineChannel::ChannelOrientation orientations[3] = {
+        EngineChannel::LEFT, EngineChannel::CENTER, EngineChannel::RIGHT };
+
+    QList<EngineChannelSignal*> channels;
+    for (int i = 0; i < kChannels; ++i) {
+        EngineChannelSignal* pChannel = new EngineChannelSignal(
+            groups[i], orientations[i % 3], 0.05f * (i + 1));
+        pChannel->setMaster(true);
+        pChannel->setPFL(i % 2 == 0);
+        m_pMaster->addChannel(pChannel);
+        channels.append(pChannel);
+    }
+    ControlObject::set(ConfigKey("[Master]", "crossfader"), 0.3);
+
+    QVector<CSAMPLE> serialMaster, serialHeadphone;
+    QVector<CSAMPLE> parallelMaster, parallelHeadphone;
+
+    ControlObject::set(ConfigKey("[Master]", "parallel_processing"), 0.0);
+    for (int i = 0; i < kCallbacks; ++i) {
+        m_pMaster->process(kBufferSize);
+        for (int j = 0; j < kBufferSize; ++j) {
+            serialMaster.append(m_pMaster->getMasterBuffer()[j]);
+            serialHeadphone.append(m_pMaster->getHeadphoneBuffer()[j]);
+        }
+    }
+
+    foreach (EngineChannelSignal* pChannel, channels) {
+        pChannel->reset();
+    }
+
+    ControlObject::set(ConfigKey("[Master]", "parallel_processing"), 1.0);
+    for (int i = 0; i < kCallbacks; ++i) {
+        m_pMaster->process(kBufferSize);
+        for (int j = 0; j < kBufferSize; ++j) {
+            parallelMaster.append(m_pMaster->getMasterBuffer()[j]);
+            parallelHeadphone.append(m_pMaster->getHeadphoneBuffer()[j]);
+        }
+    }
+
+    // The output has to be bit-identical, not just close.
+    ASSERT_EQ(serialMaster.size(), parallelMaster.size());
+    EXPECT_EQ(0, memcmp(serialMaster.constData(), parallelMaster.constData(),
+                        sizeof(CSAMPLE) * serialMaster.size()));
+    EXPECT_EQ(0, memcmp(serialHeadphone.constData(), parallelHeadphone.constData(),
+                        sizeof(CSAMPLE) * serialHeadphone.size()));
+}
+
 }  // namespace
@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "dsp/Chromagram.h"
+#include "dsp/DetectionFunction.h"
+#include "dsp/FFT.h"
+
+namespace {
+
+// The tolerance relative to the largest value of an output.
+const double kTolerance = 1e-9;
+
+class FFTTest : public testing::Test {
+  protected:
+    FFTTest()
+            : m_defaultBackend(FFT::defaultBackend()) {
+    }
+
+    virtual void SetUp() {
+        srand(1);
+    }
+
+    virtual void TearDown() {
+        FFT::setDefaultBackend(m_defaultBackend);
+    }
+
+    static std::vector<double> noise(unsigned int size) {
+        std::vector<double> values(size);
+        for (unsigned int i = 0; i < size; ++i) {
+            values[i] = static_cast<double>(rand()) / RAND_MAX - 0.5;
+        }
+        return values;
+    }
+
+    // Tones over noise, sampled at sampleRate. The same for every call so
+    // that the backends analyse the same input.
+    static std::vector<double> signal(unsigned int size, double sampleRate) {
+        srand(2);
+        std::vector<double> values = noise(size);
+        for (unsigned int i = 0; i < size; ++i) {
+            const double t = i / sampleRate;
+            values[i] = 0.1 * values[i] +
+                    0.5 * sin(2 * M_PI * 220.0 * t) +
+                    0.3 * sin(2 * M_PI * 329.6 * t) +
+                    0.2 * sin(2 * M_PI * 440.0 * t);
+        }
+        return values;
+    }
+
+    static void expectNear(const std::vector<double>& expected,
+                           const std::vector<double>& actual) {
+        ASSERT_EQ(expected.size(), actual.size());
+        double max = 1.0;
+        for (unsigned int i = 0; i < expected.size(); ++i) {
+            max = std::max(max, fabs(expected[i]));
+        }
+        for (unsigned int i = 0; i < expected.size(); ++i) {
+            EXPECT_NEAR(expected[i], actual[i], kTolerance * max)
+                    << "at " << i;
+        }
+    }
+
+    // The chroma vectors of a signal, like the key detection computes them.
+    static std::vector<double> chroma(FFTBackend backend) {
+        FFT::setDefaultBackend(backend);
+        ChromaConfig config;
+        config.FS = 44100 / 8;
+        config.min = 130.81;
+        config.max = 1046.5;
+        config.BPO = 36;
+        config.CQThresh = 0.0054;
+        config.normalise = MathUtilities::NormaliseUnitMax;
+        Chromagram chromagram(config);
+
+        const unsigned int frameSize = chromagram.getFrameSize();
+        const unsigned int hopSize = chromagram.getHopSize();
+        std::vector<double> input = signal(frameSize + 8 * hopSize, config.FS);
+        std::vector<double> output;
+        for (unsigned int i = 0; i + frameSize <= input.size(); i += hopSize) {
+            double* pChroma = chromagram.process(&input[i]);
+            output.insert(output.end(), pChroma, pChroma + config.BPO);
+        }
+        return output;
+    }
+
+    // The detection function the beat tracking computes.
+    static std::vector<double> detectionFunction(FFTBackend backend) {
+        FFT::setDefaultBackend(backend);
+        DFConfig config;
+        config.DFType = DF_COMPLEXSD;
+        config.stepSize = 512;
+        config.frameLength = 1024;
+        config.dbRise = 3;
+        config.adaptiveWhitening = false;
+        config.whiteningRelaxCoeff = -1;
+        config.whiteningFloor = -1;
+        DetectionFunction df(config);
+
+        std::vector<double> input = signal(64 * config.stepSize, 44100);
+        std::vector<double> output;
+        for (unsigned int i = 0; i + config.frameLength <= input.size();
+             i += config.stepSize) {
+            output.push_back(df.process(&input[i]));
+        }
+        return output;
+    }
+
+    const FFTBackend m_defaultBackend;
+};
+
+// Both backends only support powers of two from 2 on. MathUtilities
+// doesn't consider 1 a power of two.
+TEST_F(FFTTest, ComplexMatchesLegacy) {
+    for (unsigned int size = 2; size <= 16384; size *= 2) {
+        std::vector<double> realIn = noise(size);
+        std::vector<double> imagIn = noise(size);
+        for (int inverse = 0; inverse < 2; ++inverse) {
+            std::vector<double> legacyRe(size), legacyIm(size);
+            std::vector<double> fastRe(size), fastIm(size);
+            FFT legacy(size, FFTBackendLegacy);
+            legacy.process(inverse, &realIn[0], &imagIn[0],
+                           &legacyRe[0], &legacyIm[0]);
+            FFT fast(size, FFTBackendFast);
+            fast.process(inverse, &realIn[0], &imagIn[0],
+                         &fastRe[0], &fastIm[0]);
+            expectNear(legacyRe, fastRe);
+            expectNear(legacyIm, fastIm);
+        }
+    }
+}
+
+TEST_F(FFTTest, RealMatchesLegacy) {
+    for (unsigned int size = 2; size <= 16384; size *= 2) {
+        std::vector<double> realIn = noise(size);
+        std::vector<double> legacyRe(size), legacyIm(size);
+        std::vector<double> fastRe(size), fastIm(size);
+        FFTReal legacy(size, FFTBackendLegacy);
+        legacy.process(false, &realIn[0], &legacyRe[0], &legacyIm[0]);
+        FFTReal fast(size, FFTBackendFast);
+        fast.process(false, &realIn[0], &fastRe[0], &fastIm[0]);
+        expectNear(legacyRe, fastRe);
+        expectNear(legacyIm, fastIm);
+    }
+}
+
+TEST_F(FFTTest, KeyDetectionChromaMatchesLegacy) {
+    std::vector<double> legacy = chroma(FFTBackendLegacy);
+    std::vector<double> fast = chroma(FFTBackendFast);
+    ASSERT_FALSE(legacy.empty());
+    expectNear(legacy, fast);
+}
+
+TEST_F(FFTTest, BeatDetectionFunctionMatchesLegacy) {
+    std::vector<double> legacy = detectionFunction(FFTBackendLegacy);
+    std::vector<double> fast = detectionFunction(FFTBackendFast);
+    ASSERT_FALSE(legacy.empty());
+    expectNear(legacy, fast);
+}
+
+}  // namespace
@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+
+#include <QtDebug>
+#include <QtSql>
+#include <QDir>
+
+#include "configobject.h"
+#include "library/dao/libraryhashdao.h"
+#include "library/trackcollection.h"
+#include "test/mixxxtest.h"
+
+namespace {
+
+class LibraryHashDAOTest : public MixxxTest {
+  protected:
+    virtual void SetUp() {
+        // make sure to use the current schema.xml file in the repo
+        config()->set(ConfigKey("[Config]","Path"),
+                      QDir::currentPath().append("/res"));
+        m_pTrackCollection = new TrackCollection(config());
+    }
+
+    virtual void TearDown() {
+        // make sure we clean up the db
+        QSqlQuery query(m_pTrackCollection->getDatabase());
+        query.prepare("DELETE FROM LibraryHashes");
+        query.exec();
+
+        delete m_pTrackCollection;
+    }
+
+    TrackCollection* m_pTrackCollection;
+};
+
+TEST_F(LibraryHashDAOTest, mtimeJournalTest) {
+    LibraryHashDAO libraryHashDao(m_pTrackCollection->getDatabase());
+    const QString dirA("/music/a");
+    const QString dirB("/music/b");
+    libraryHashDao.saveDirectoryHash(dirA, 1, 1000);
+    libraryHashDao.saveDirectoryHash(dirB, 2, 2000);
+    EXPECT_FALSE(libraryHashDao.hasInvalidatedDirectoryMtimes());
+
+    QHash<QString, LibraryHashDAO::DirectoryHash> hashes =
+            libraryHashDao.getDirectoryHashes();
+    ASSERT_EQ(2, hashes.size());
+    EXPECT_EQ(1, hashes[dirA].hash);
+    EXPECT_EQ(1000u, hashes[dirA].mtime);
+    EXPECT_EQ(2000u, hashes[dirB].mtime);
+
+    // A changed directory is journaled by resetting its mtime.
+    libraryHashDao.invalidateDirectoryMtimes(QStringList() << dirB);
+    EXPECT_TRUE(libraryHashDao.hasInvalidatedDirectoryMtimes());
+    hashes = libraryHashDao.getDirectoryHashes();
+    EXPECT_EQ(1000u, hashes[dirA].mtime);
+    EXPECT_EQ(0u, hashes[dirB].mtime);
+
+    // Hashing it again stores the new mtime.
+    libraryHashDao.updateDirectoryHash(dirB, 3, 3000, 0);
+    EXPECT_FALSE(libraryHashDao.hasInvalidatedDirectoryMtimes());
+    hashes = libraryHashDao.getDirectoryHashes();
+    EXPECT_EQ(3, hashes[dirB].hash);
+    EXPECT_EQ(3000u, hashes[dirB].mtime);
+
+    libraryHashDao.updateDirectoryMtime(dirA, 4000);
+    EXPECT_EQ(4000u, libraryHashDao.getDirectoryHashes()[dirA].mtime);
+}
+
+}  // namespace
@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+
+#ifdef __WINDOWS__
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QSqlQuery>
+#include <QtDebug>
+
+#include "library/dao/libraryhashdao.h"
+#include "library/libraryscanner.h"
+#include "library/trackcollection.h"
+#include "test/mixxxtest.h"
+
+namespace {
+
+class LibraryScannerTest : public MixxxTest {
+  protected:
+    virtual void SetUp() {
+        // make sure to use the current schema.xml file in the repo
+        config()->set(ConfigKey("[Config]","Path"),
+                      QDir::currentPath().append("/res"));
+        m_pTrackCollection = new TrackCollection(config());
+
+        // Modification times the scanner trusts, i.e. not too recent.
+        m_firstMtime = QDateTime::currentDateTime().toTime_t() - 3600;
+        m_secondMtime = m_firstMtime + 1800;
+
+        m_root = QDir::cleanPath(QDir::temp().absoluteFilePath(
+            QString("libraryscannertest-%1")
+                    .arg(QCoreApplication::applicationPid())));
+        ASSERT_TRUE(QDir(m_root).mkpath("a"));
+        ASSERT_TRUE(QDir(m_root).mkpath("b"));
+        setMtime(m_root + "/a", m_firstMtime);
+        setMtime(m_root + "/b", m_firstMtime);
+        setMtime(m_root, m_firstMtime);
+        m_pTrackCollection->getDirectoryDAO().addDirectory(m_root);
+
+        m_pScanner = new LibraryScanner(m_pTrackCollection);
+    }
+
+    virtual void TearDown() {
+        delete m_pScanner;
+        m_pTrackCollection->getDirectoryDAO().removeDirectory(m_root);
+        // make sure we clean up the db
+        QSqlQuery query(m_pTrackCollection->getDatabase());
+        query.exec("DELETE FROM LibraryHashes");
+        QDir root(m_root);
+        root.rmdir("a");
+        root.rmdir("b");
+        root.rmdir("c");
+        root.rmdir(m_root);
+        delete m_pTrackCollection;
+    }
+
+    void setMtime(const QString& path, uint mtime) {
+        struct utimbuf times;
+        times.actime = mtime;
+        times.modtime = mtime;
+        ASSERT_EQ(0, utime(QFile::encodeName(path).constData(), &times));
+    }
+
+    QHash<QString, LibraryHashDAO::DirectoryHash> directoryHashes() {
+        LibraryHashDAO libraryHashDao(m_pTrackCollection->getDatabase());
+        return libraryHashDao.getDirectoryHashes();
+    }
+
+    TrackCollection* m_pTrackCollection;
+    LibraryScanner* m_pScanner;
+    QString m_root;
+    uint m_firstMtime;
+    uint m_secondMtime;
+};
+
+TEST_F(LibraryScannerTest, InterruptedScanDoesNotStoreMtimes) {
+    m_pScanner->scanForTest(false);
+    QHash<QString, LibraryHashDAO::DirectoryHash> hashes = directoryHashes();
+    ASSERT_TRUE(hashes.contains(m_root));
+    EXPECT_EQ(m_firstMtime, hashes[m_root].mtime);
+    ASSERT_TRUE(hashes.contains(m_root + "/a"));
+    EXPECT_EQ(m_firstMtime, hashes[m_root + "/a"].mtime);
+    ASSERT_TRUE(hashes.contains(m_root + "/b"));
+
+    // A new sub-directory changes the mtime of the root but not its hash,
+    // which only covers files.
+    ASSERT_TRUE(QDir(m_root).mkdir("c"));
+    setMtime(m_root + "/c", m_firstMtime);
+    setMtime(m_root, m_secondMtime);
+
+    // Cancel the incremental scan once the root is verified, before its
+    // sub-directories are imported.
+    QObject::connect(m_pScanner, SIGNAL(progressHashing(QString)),
+                     m_pScanner, SLOT(cancel()));
+    m_pScanner->scanForTest(true);
+    QObject::disconnect(m_pScanner, SIGNAL(progressHashing(QString)),
+                        m_pScanner, SLOT(cancel()));
+    hashes = directoryHashes();
+    EXPECT_FALSE(hashes.contains(m_root + "/c"));
+    // Otherwise the next incremental scan would only walk a and b.
+    EXPECT_EQ(m_firstMtime, hashes[m_root].mtime);
+
+    m_pScanner->scanForTest(true);
+    hashes = directoryHashes();
+    ASSERT_TRUE(hashes.contains(m_root + "/c"));
+    EXPECT_EQ(m_firstMtime, hashes[m_root + "/c"].mtime);
+    EXPECT_EQ(m_secondMtime, hashes[m_root].mtime);
+}
+
+}  // namespace
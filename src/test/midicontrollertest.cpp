@@ -0,0 +1,186 @@
+#include <gtest/gtest.h>
+#include <QtDebug>
+
+#include "controllers/midi/midicontroller.h"
+#include "engine/controleventqueue.h"
+#include "test/mixxxtest.h"
+
+namespace {
+
+class FakeMidiController : public MidiController {
+  public:
+    using MidiController::coalesceBurst;
+    using MidiController::isCoalesced;
+    using MidiController::mappingKey;
+    using MidiController::receive;
+
+  private:
+    virtual int open() {
+        setOpen(true);
+        return 0;
+    }
+    virtual int close() {
+        setOpen(false);
+        return 0;
+    }
+    virtual void sendWord(unsigned int) {
+    }
+    virtual void send(QByteArray) {
+    }
+    virtual bool isPolling() const {
+        return false;
+    }
+};
+
+class MidiControllerTest : public MixxxTest {
+  protected:
+    virtual void SetUp() {
+        m_pFader = new ControlObject(ConfigKey("[Test]", "fader"));
+        m_pKnob = new ControlObject(ConfigKey("[Test]", "knob"));
+        m_pController = new FakeMidiController();
+    }
+
+    virtual void TearDown() {
+        delete m_pController;
+        delete m_pKnob;
+        delete m_pFader;
+    }
+
+    void addMapping(MidiControllerPreset* pPreset, unsigned char status,
+                    unsigned char control, const QString& item,
+                    bool coalesce) {
+        MidiOptions options;
+        options.all = 0;
+        options.coalesce = coalesce;
+        pPreset->mappings.insert(FakeMidiController::mappingKey(status, control),
+                                 qMakePair(MixxxControl("[Test]", item), options));
+    }
+
+    ControlObject* m_pFader;
+    ControlObject* m_pKnob;
+    FakeMidiController* m_pController;
+};
+
+TEST_F(MidiControllerTest, CoalesceIsAnOptionOfTheMapping) {
+    MidiControllerPreset preset;
+    addMapping(&preset, MIDI_CC, 0x10, "fader", true);
+    addMapping(&preset, MIDI_CC, 0x11, "knob", false);
+    m_pController->setPreset(preset);
+
+    EXPECT_TRUE(m_pController->isCoalesced(
+            FakeMidiController::mappingKey(MIDI_CC, 0x10)));
+    EXPECT_FALSE(m_pController->isCoalesced(
+            FakeMidiController::mappingKey(MIDI_CC, 0x11)));
+    EXPECT_FALSE(m_pController->isCoalesced(
+            FakeMidiController::mappingKey(MIDI_CC, 0x12)));
+}
+
+TEST_F(MidiControllerTest, MappingKeyOfPitchBendIgnoresTheValue) {
+    EXPECT_EQ(FakeMidiController::mappingKey(MIDI_PITCH_BEND, 0x01),
+              FakeMidiController::mappingKey(MIDI_PITCH_BEND, 0x7F));
+    EXPECT_NE(FakeMidiController::mappingKey(MIDI_CC, 0x01),
+              FakeMidiController::mappingKey(MIDI_CC, 0x7F));
+}
+
+TEST_F(MidiControllerTest, CoalesceBurstSkipsSupersededMessages) {
+    MidiControllerPreset preset;
+    addMapping(&preset, MIDI_CC, 0x10, "fader", true);
+    addMapping(&preset, MIDI_CC, 0x11, "knob", false);
+    m_pController->setPreset(preset);
+
+    const QPair<unsigned char, unsigned char> burst[] = {
+        qMakePair<unsigned char, unsigned char>(MIDI_CC, 0x10),
+        qMakePair<unsigned char, unsigned char>(MIDI_CC, 0x11),
+        qMakePair<unsigned char, unsigned char>(MIDI_CC, 0x10),
+        qMakePair<unsigned char, unsigned char>(MIDI_CC, 0x11),
+        qMakePair<unsigned char, unsigned char>(MIDI_CC | 0x01, 0x10),
+        qMakePair<unsigned char, unsigned char>(MIDI_CC, 0x10),
+    };
+    bool skip[6];
+    EXPECT_EQ(2, m_pController->coalesceBurst(burst, 6, skip));
+    // Only the last message for the coalesced mapping is handled, while the
+    // mapping that does not coalesce and other channels see every message.
+    EXPECT_TRUE(skip[0]);
+    EXPECT_FALSE(skip[1]);
+    EXPECT_TRUE(skip[2]);
+    EXPECT_FALSE(skip[3]);
+    EXPECT_FALSE(skip[4]);
+    EXPECT_FALSE(skip[5]);
+}
+
+TEST_F(MidiControllerTest, CoalesceBurstKeepsBurstsWithSysex) {
+    MidiControllerPreset preset;
+    addMapping(&preset, MIDI_CC, 0x10, "fader", true);
+    m_pController->setPreset(preset);
+
+    const QPair<unsigned char, unsigned char> burst[] = {
+        qMakePair<unsigned char, unsigned char>(MIDI_CC, 0x10),
+        qMakePair<unsigned char, unsigned char>(MIDI_CC, 0x10),
+        qMakePair<unsigned char, unsigned char>(0xF0, 0x7E),
+        qMakePair<unsigned char, unsigned char>(MIDI_CC, 0x10),
+    };
+    bool skip[4];
+    EXPECT_EQ(0, m_pController->coalesceBurst(burst, 4, skip));
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_FALSE(skip[i]);
+    }
+}
+
+TEST_F(MidiControllerTest, CoalescedMappingsHandleValuesAsAbsolute) {
+    MidiControllerPreset preset;
+    addMapping(&preset, MIDI_CC, 0x10, "fader", true);
+    m_pController->setPreset(preset);
+
+    // A burst that moves the fader up and back down ends where its last
+    // message put it, no matter which messages were skipped.
+    const unsigned char values[] = { 100, 120, 20 };
+    const QPair<unsigned char, unsigned char> burst[] = {
+        qMakePair<unsigned char, unsigned char>(MIDI_CC, 0x10),
+        qMakePair<unsigned char, unsigned char>(MIDI_CC, 0x10),
+        qMakePair<unsigned char, unsigned char>(MIDI_CC, 0x10),
+    };
+    bool skip[3];
+    EXPECT_EQ(2, m_pController->coalesceBurst(burst, 3, skip));
+    int handled = 0;
+    for (int i = 0; i < 3; ++i) {
+        if (!skip[i]) {
+            m_pController->receive(burst[i].first, burst[i].second, values[i]);
+            ++handled;
+        }
+    }
+    EXPECT_EQ(1, handled);
+    EXPECT_DOUBLE_EQ(20.0, m_pFader->get());
+}
+
+TEST_F(MidiControllerTest, RelativeMappingsAreNotScheduled) {
+    ControlObject play(ConfigKey("[Channel1]", "play"));
+    ControlObject rate(ConfigKey("[Channel1]", "rate"));
+    ControlObject scratch(ConfigKey("[Channel1]", "scratch2"));
+    ControlEventQueue queue("[Channel1]");
+    queue.startCallback(0, 0, 0);
+
+    MidiControllerPreset preset;
+    MidiOptions options;
+    options.all = 0;
+    options.diff = true;
+    preset.mappings.insert(FakeMidiController::mappingKey(MIDI_CC, 0x20),
+                           qMakePair(MixxxControl("[Channel1]", "rate"), options));
+    options.all = 0;
+    preset.mappings.insert(FakeMidiController::mappingKey(MIDI_CC, 0x21),
+                           qMakePair(MixxxControl("[Channel1]", "rate"), options));
+    m_pController->setPreset(preset);
+
+    // An absolute change that is queued and two relative ones that are
+    // handled in the same callback.
+    m_pController->receive(MIDI_CC, 0x21, 10, 1100);
+    m_pController->receive(MIDI_CC, 0x20, 1, 1250);
+    m_pController->receive(MIDI_CC, 0x20, 1, 1500);
+    EXPECT_DOUBLE_EQ(2.0, rate.get());
+
+    // The older queued change does not overwrite them.
+    queue.startCallback(1000, 2000, 128);
+    queue.applyAllEvents();
+    EXPECT_DOUBLE_EQ(2.0, rate.get());
+}
+
+}  // namespace
@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QtDebug>
+#include <QTemporaryFile>
+
+#include "mp3seektable.h"
+
+namespace {
+
+class Mp3SeekTableTest : public testing::Test {
+  protected:
+    virtual void SetUp() {
+        ASSERT_TRUE(m_audioFile.open());
+        m_audioFile.write(QByteArray(4096, 'x'));
+        m_audioFile.flush();
+        ASSERT_TRUE(m_tableFile.open());
+        m_tableFile.close();
+    }
+
+    // Appends frames of 1152 sample frames starting every 418 bytes, like a
+    // 128 kbps file at 44.1 kHz.
+    void appendFrames(Mp3SeekTable* pTable, int frames) {
+        for (int i = 0; i < frames; ++i) {
+            pTable->append(100 + 418 * i, 2 * 1152 * i);
+        }
+    }
+
+    QTemporaryFile m_audioFile;
+    QTemporaryFile m_tableFile;
+};
+
+TEST_F(Mp3SeekTableTest, FindFrame) {
+    Mp3SeekTable table;
+    appendFrames(&table, 10);
+    table.finish(2 * 1152 * 10, 128000);
+    EXPECT_TRUE(table.isComplete());
+    EXPECT_EQ(10, table.frameCount());
+
+    EXPECT_EQ(-1, table.findFrame(-2));
+    EXPECT_EQ(0, table.findFrame(0));
+    EXPECT_EQ(0, table.findFrame(2 * 1152 - 2));
+    EXPECT_EQ(1, table.findFrame(2 * 1152));
+    EXPECT_EQ(9, table.findFrame(2 * 1152 * 20));
+
+    quint32 offset = 0;
+    qint64 position = 0;
+    ASSERT_TRUE(table.frame(3, &offset, &position));
+    EXPECT_EQ(100u + 418 * 3, offset);
+    EXPECT_EQ(2 * 1152 * 3, position);
+    EXPECT_FALSE(table.frame(10, &offset, &position));
+}
+
+TEST_F(Mp3SeekTableTest, SaveAndLoad) {
+    const QFileInfo audioFile(m_audioFile.fileName());
+    Mp3SeekTable table;
+    appendFrames(&table, 1000);
+    // Incomplete tables are not saved.
+    EXPECT_FALSE(table.save(m_tableFile.fileName(), audioFile));
+    table.finish(2 * 1152 * 1000, 128000);
+    ASSERT_TRUE(table.save(m_tableFile.fileName(), audioFile));
+
+    Mp3SeekTable loaded;
+    ASSERT_TRUE(loaded.load(m_tableFile.fileName(), audioFile));
+    EXPECT_TRUE(loaded.isComplete());
+    EXPECT_EQ(1000, loaded.frameCount());
+    EXPECT_EQ(2 * 1152 * 1000, loaded.length());
+    EXPECT_EQ(128000, loaded.bitrate());
+    quint32 offset = 0;
+    qint64 position = 0;
+    ASSERT_TRUE(loaded.frame(999, &offset, &position));
+    EXPECT_EQ(100u + 418 * 999, offset);
+    EXPECT_EQ(2 * 1152 * 999, position);
+}
+
+TEST_F(Mp3SeekTableTest, LoadRejectsChangedFile) {
+    Mp3SeekTable table;
+    appendFrames(&table, 10);
+    table.finish(2 * 1152 * 10, 128000);
+    ASSERT_TRUE(table.save(m_tableFile.fileName(),
+                           QFileInfo(m_audioFile.fileName())));
+
+    m_audioFile.write(QByteArray(16, 'y'));
+    m_audioFile.flush();
+    Mp3SeekTable loaded;
+    EXPECT_FALSE(loaded.load(m_tableFile.fileName(),
+                             QFileInfo(m_audioFile.fileName())));
+    EXPECT_FALSE(loaded.isComplete());
+    EXPECT_FALSE(loaded.load("no such file",
+                             QFileInfo(m_audioFile.fileName())));
+}
+
+TEST_F(Mp3SeekTableTest, SaveReplacesExistingTable) {
+    const QFileInfo audioFile(m_audioFile.fileName());
+    Mp3SeekTable table;
+    appendFrames(&table, 10);
+    table.finish(2 * 1152 * 10, 128000);
+    ASSERT_TRUE(table.save(m_tableFile.fileName(), audioFile));
+
+    Mp3SeekTable longer;
+    appendFrames(&longer, 20);
+    longer.finish(2 * 1152 * 20, 128000);
+    ASSERT_TRUE(longer.save(m_tableFile.fileName(), audioFile));
+
+    Mp3SeekTable loaded;
+    ASSERT_TRUE(loaded.load(m_tableFile.fileName(), audioFile));
+    EXPECT_EQ(20, loaded.frameCount());
+    // No temporary files are left behind.
+    const QFileInfo tableFile(m_tableFile.fileName());
+    EXPECT_EQ(1, tableFile.dir().entryList(
+        QStringList() << tableFile.fileName() + "*", QDir::Files).size());
+}
+
+TEST_F(Mp3SeekTableTest, PruneCache) {
+    QDir dir(QDir::temp().absoluteFilePath(
+        QString("mp3seektabletest-%1").arg(QCoreApplication::applicationPid())));
+    ASSERT_TRUE(dir.mkpath("."));
+    for (int i = 0; i < 5; ++i) {
+        QFile file(dir.absoluteFilePath(QString(40, QChar('a' + i))));
+        ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    }
+    // A table that another thread is still saving.
+    const QString savingFile = dir.absoluteFilePath(QString(40, QChar('0')) + ".AbC123");
+    {
+        QFile file(savingFile);
+        ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    }
+
+    Mp3SeekTable::pruneCache(dir.absolutePath(), 3);
+    EXPECT_EQ(4, dir.entryList(QDir::Files).size());
+    Mp3SeekTable::pruneCache(dir.absolutePath(), 3);
+    EXPECT_EQ(4, dir.entryList(QDir::Files).size());
+
+    Mp3SeekTable::pruneCache(dir.absolutePath(), 0);
+    EXPECT_EQ(QStringList(QFileInfo(savingFile).fileName()),
+              dir.entryList(QDir::Files));
+    QFile::remove(savingFile);
+    dir.rmdir(dir.absolutePath());
+}
+
+}  // namespace
@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+
+#include <QtDebug>
+#include <QVector>
+
+#include "controlobject.h"
+#include "engine/sync/syncable.h"
+#include "test/mockedenginebackendtest.h"
+
+namespace {
+
+class ParallelChannelProcessingTest : public MockedEngineBackendTest {
+  protected:
+    // Plays all decks for a while, deck 1 as the sync master, deck 2 following
+    // it and deck 3 on its own with a changing rate. Returns the play
+    // position, rate and bpm of every deck after each callback.
+    QVector<double> play(bool parallel) {
+        ControlObject::set(ConfigKey(m_sMasterGroup, "parallel_processing"),
+                           parallel ? 1.0 : 0.0);
+
+        ControlObject::set(ConfigKey(m_sGroup1, "file_bpm"), 120.0);
+        ControlObject::set(ConfigKey(m_sGroup2, "file_bpm"), 124.0);
+        ControlObject::set(ConfigKey(m_sGroup3, "file_bpm"), 128.0);
+        ControlObject::set(ConfigKey(m_sGroup1, "rate"), getRateSliderValue(1.05));
+
+        QScopedPointer<ControlObjectThread> pSyncMode1(getControlObjectThread(
+                ConfigKey(m_sGroup1, "sync_mode")));
+        pSyncMode1->slotSet(SYNC_MASTER);
+        QScopedPointer<ControlObjectThread> pSyncMode2(getControlObjectThread(
+                ConfigKey(m_sGroup2, "sync_mode")));
+        pSyncMode2->slotSet(SYNC_FOLLOWER);
+
+        ControlObject::set(ConfigKey(m_sGroup1, "play"), 1.0);
+        ControlObject::set(ConfigKey(m_sGroup2, "play"), 1.0);
+        ControlObject::set(ConfigKey(m_sGroup3, "play"), 1.0);
+
+        const char* groups[] = { m_sGroup1, m_sGroup2, m_sGroup3 };
+        QVector<double> state;
+        for (int callback = 0; callback < 32; ++callback) {
+            ControlObject::set(ConfigKey(m_sGroup3, "rate"),
+                               getRateSliderValue(1.0 + 0.01 * callback));
+            ProcessBuffer();
+            for (int i = 0; i < 3; ++i) {
+                state.append(ControlObject::get(ConfigKey(groups[i], "playposition")));
+                state.append(ControlObject::get(ConfigKey(groups[i], "rate")));
+                state.append(ControlObject::get(ConfigKey(groups[i], "bpm")));
+            }
+        }
+        return state;
+    }
+};
+
+TEST_F(ParallelChannelProcessingTest, DecksMatchSerialProcessing) {
+    const QVector<double> serial = play(false);
+
+    // Start over with fresh decks.
+    TearDown();
+    SetUp();
+    const QVector<double> parallel = play(true);
+
+    ASSERT_EQ(serial.size(), parallel.size());
+    for (int i = 0; i < serial.size(); ++i) {
+        EXPECT_DOUBLE_EQ(serial[i], parallel[i]) << "at index " << i;
+    }
+    // The decks have moved and deck 2 follows deck 1.
+    EXPECT_GT(parallel[parallel.size() - 9], 0.0);
+    EXPECT_DOUBLE_EQ(parallel[parallel.size() - 7], parallel[parallel.size() - 4]);
+}
+
+}  // namespace
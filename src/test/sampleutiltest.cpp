@@ -419,4 +419,142 @@ TEST_F(SampleUtilTest, testBitwiseFabs) {
     }
 }
 
+TEST_F(SampleUtilTest, allocIsAligned) {
+    for (int i = 0; i < sizes.size(); ++i) {
+        CSAMPLE* buffer = SampleUtil::alloc(sizes[i]);
+        ASSERT_TRUE(buffer != NULL);
+        EXPECT_EQ(0u, reinterpret_cast<size_t>(buffer) % SampleUtil::kAlignment);
+        SampleUtil::free(buffer);
+    }
+}
+
+// Runs every dispatched kernel with the scalar implementation and with each
+// supported instruction set and compares the results. The ramping kernels
+// compute the gain per frame instead of accumulating it, so they are only
+// compared within a tolerance.
+TEST_F(SampleUtilTest, instructionSetsMatchScalar) {
+    const SampleUtil::InstructionSet previous = SampleUtil::instructionSet();
+    const int kMaxSize = 1028;
+    CSAMPLE* src = SampleUtil::alloc(kMaxSize);
+    CSAMPLE* reference = SampleUtil::alloc(kMaxSize);
+    CSAMPLE* result = SampleUtil::alloc(kMaxSize);
+    CSAMPLE* reference2 = SampleUtil::alloc(kMaxSize);
+    CSAMPLE* result2 = SampleUtil::alloc(kMaxSize);
+    SAMPLE* s16 = new SAMPLE[kMaxSize];
+    for (int j = 0; j < kMaxSize; ++j) {
+        src[j] = static_cast<CSAMPLE>((j % 37) - 18) / 9.0f;
+        s16[j] = static_cast<SAMPLE>((j * 97) % 65536 - 32768);
+    }
+
+    for (int set = SampleUtil::SSE2; set < SampleUtil::NUM_INSTRUCTION_SETS; ++set) {
+        SampleUtil::InstructionSet instructionSet =
+                static_cast<SampleUtil::InstructionSet>(set);
+        if (!SampleUtil::isSupported(instructionSet)) {
+            continue;
+        }
+        SCOPED_TRACE(SampleUtil::instructionSetName(instructionSet));
+
+        for (int i = 0; i < sizes.size(); ++i) {
+            const int size = sizes[i];
+
+            SampleUtil::setInstructionSet(SampleUtil::SCALAR);
+            memcpy(reference, src, sizeof(src[0]) * size);
+            SampleUtil::applyRampingGain(reference, 0.25, 0.75, size);
+            SampleUtil::addWithGain(reference, src, 0.5, size);
+            SampleUtil::addWithRampingGain(reference, src, 1.0, 0.1, size);
+            SampleUtil::setInstructionSet(instructionSet);
+            memcpy(result, src, sizeof(src[0]) * size);
+            SampleUtil::applyRampingGain(result, 0.25, 0.75, size);
+            SampleUtil::addWithGain(result, src, 0.5, size);
+            SampleUtil::addWithRampingGain(result, src, 1.0, 0.1, size);
+            for (int j = 0; j < size; ++j) {
+                EXPECT_NEAR(reference[j], result[j], 1e-4);
+            }
+
+            SampleUtil::setInstructionSet(SampleUtil::SCALAR);
+            memcpy(reference, src, sizeof(src[0]) * size);
+            SampleUtil::applyGain(reference, 0.7, size);
+            SampleUtil::setInstructionSet(instructionSet);
+            memcpy(result, src, sizeof(src[0]) * size);
+            SampleUtil::applyGain(result, 0.7, size);
+            for (int j = 0; j < size; ++j) {
+                EXPECT_FLOAT_EQ(reference[j], result[j]);
+            }
+
+            SampleUtil::setInstructionSet(SampleUtil::SCALAR);
+            SampleUtil::copyWithGain(reference, src, 1.3, size);
+            SampleUtil::setInstructionSet(instructionSet);
+            SampleUtil::copyWithGain(result, src, 1.3, size);
+            for (int j = 0; j < size; ++j) {
+                EXPECT_FLOAT_EQ(reference[j], result[j]);
+            }
+
+            SampleUtil::setInstructionSet(SampleUtil::SCALAR);
+            SampleUtil::copyWithRampingGain(reference, src, 0.3, 0.9, size);
+            SampleUtil::setInstructionSet(instructionSet);
+            SampleUtil::copyWithRampingGain(result, src, 0.3, 0.9, size);
+            for (int j = 0; j < size; ++j) {
+                EXPECT_NEAR(reference[j], result[j], 1e-4);
+            }
+
+            SampleUtil::setInstructionSet(SampleUtil::SCALAR);
+            SampleUtil::convert(reference, s16, size);
+            SampleUtil::setInstructionSet(instructionSet);
+            SampleUtil::convert(result, s16, size);
+            for (int j = 0; j < size; ++j) {
+                EXPECT_FLOAT_EQ(reference[j], result[j]);
+            }
+
+            SampleUtil::setInstructionSet(SampleUtil::SCALAR);
+            bool referenceClamped = SampleUtil::copyClampBuffer(
+                    1.0, -1.0, reference, src, size);
+            SampleUtil::setInstructionSet(instructionSet);
+            bool clamped = SampleUtil::copyClampBuffer(
+                    1.0, -1.0, result, src, size);
+            EXPECT_EQ(referenceClamped, clamped);
+            for (int j = 0; j < size; ++j) {
+                EXPECT_FLOAT_EQ(reference[j], result[j]);
+            }
+
+            if (size % 2 != 0) {
+                continue;
+            }
+            const int half = size / 2;
+
+            CSAMPLE referenceL = 0, referenceR = 0, sumL = 0, sumR = 0;
+            SampleUtil::setInstructionSet(SampleUtil::SCALAR);
+            SampleUtil::sumAbsPerChannel(&referenceL, &referenceR, src, size);
+            SampleUtil::setInstructionSet(instructionSet);
+            SampleUtil::sumAbsPerChannel(&sumL, &sumR, src, size);
+            EXPECT_NEAR(referenceL, sumL, 1e-2);
+            EXPECT_NEAR(referenceR, sumR, 1e-2);
+
+            SampleUtil::setInstructionSet(SampleUtil::SCALAR);
+            SampleUtil::interleaveBuffer(reference, src, src + half, half);
+            SampleUtil::setInstructionSet(instructionSet);
+            SampleUtil::interleaveBuffer(result, src, src + half, half);
+            for (int j = 0; j < size; ++j) {
+                EXPECT_FLOAT_EQ(reference[j], result[j]);
+            }
+
+            SampleUtil::setInstructionSet(SampleUtil::SCALAR);
+            SampleUtil::deinterleaveBuffer(reference, reference2, src, half);
+            SampleUtil::setInstructionSet(instructionSet);
+            SampleUtil::deinterleaveBuffer(result, result2, src, half);
+            for (int j = 0; j < half; ++j) {
+                EXPECT_FLOAT_EQ(reference[j], result[j]);
+                EXPECT_FLOAT_EQ(reference2[j], result2[j]);
+            }
+        }
+    }
+
+    SampleUtil::setInstructionSet(previous);
+    delete [] s16;
+    SampleUtil::free(result2);
+    SampleUtil::free(reference2);
+    SampleUtil::free(result);
+    SampleUtil::free(reference);
+    SampleUtil::free(src);
+}
+
 }
@@ -0,0 +1,188 @@
+#include <gtest/gtest.h>
+#include <QtDebug>
+
+#include "controlobject.h"
+#include "engine/controleventqueue.h"
+#include "engine/ratecontrol.h"
+#include "test/mockedenginebackendtest.h"
+#include "util/time.h"
+
+namespace {
+
+// Consumes track samples at the speed it was set to and outputs a constant.
+class RateScaler : public EngineBufferScale {
+  public:
+    RateScaler() : EngineBufferScale() {
+        for (int i = 0; i < MAX_BUFFER_LEN; ++i) {
+            m_buffer[i] = 0.5;
+        }
+    }
+    void clear() { }
+    CSAMPLE* getScaled(unsigned long buf_size) {
+        m_samplesRead = buf_size * m_dBaseRate * m_dSpeedAdjust;
+        return m_buffer;
+    }
+};
+
+class ScheduledControlsTest : public MockedEngineBackendTest {
+  protected:
+    // Large enough that the playposition is updated in every callback.
+    static const int kBufferSize = 8192;
+    static const qint64 kPeriod = 1000000;
+    static const int kTrackSamples = 44100 * 10;
+
+    virtual void SetUp() {
+        MockedEngineBackendTest::SetUp();
+        m_pChannel1->getEngineBuffer()->setScalerForTest(&m_scaler1);
+        m_pChannel2->getEngineBuffer()->setScalerForTest(&m_scaler2);
+        m_pBuffer = SampleUtil::alloc(kBufferSize);
+        m_callbackStart = kPeriod;
+    }
+
+    virtual void TearDown() {
+        MockedEngineBackendTest::TearDown();
+        SampleUtil::free(m_pBuffer);
+    }
+
+    // Processes decks 1 and 2 in a callback that covers the changes received
+    // between m_callbackStart and m_callbackStart + kPeriod.
+    void processDecks() {
+        m_pEngineMaster->setCallbackStartTimesForTest(
+                m_callbackStart, m_callbackStart + kPeriod);
+        m_pChannel1->process(NULL, m_pBuffer, kBufferSize);
+        m_pChannel2->process(NULL, m_pBuffer, kBufferSize);
+        m_callbackStart += kPeriod;
+    }
+
+    double playposSamples(const char* group) const {
+        return ControlObject::get(ConfigKey(group, "playposition")) *
+                kTrackSamples;
+    }
+
+    RateScaler m_scaler1;
+    RateScaler m_scaler2;
+    CSAMPLE* m_pBuffer;
+    qint64 m_callbackStart;
+};
+
+TEST_F(ScheduledControlsTest, RateChangeTakesEffectAtItsOffset) {
+    ControlObject::set(ConfigKey(m_sGroup1, "play"), 1.0);
+    processDecks();
+    const double start = playposSamples(m_sGroup1);
+
+    ControlObject* pRate = ControlObject::getControl(
+            ConfigKey(m_sGroup1, "rate"));
+    ASSERT_TRUE(ControlEventQueue::schedule(
+            pRate, getRateSliderValue(1.5), m_callbackStart + kPeriod / 2));
+    processDecks();
+
+    EXPECT_NEAR(start + kBufferSize / 2 + 1.5 * kBufferSize / 2,
+                playposSamples(m_sGroup1), 1e-6);
+    EXPECT_DOUBLE_EQ(getRateSliderValue(1.5), pRate->get());
+}
+
+TEST_F(ScheduledControlsTest, PlayStartsAtItsOffset) {
+    processDecks();
+    const double start = playposSamples(m_sGroup1);
+
+    ControlObject* pPlay = ControlObject::getControl(
+            ConfigKey(m_sGroup1, "play"));
+    ASSERT_TRUE(ControlEventQueue::schedule(
+            pPlay, 1.0, m_callbackStart + kPeriod / 2));
+    processDecks();
+
+    EXPECT_NEAR(start + kBufferSize / 2, playposSamples(m_sGroup1), 1e-6);
+    // Silence up to the offset, then the ramped up track.
+    for (int i = 0; i < kBufferSize / 2; ++i) {
+        ASSERT_EQ(0.0, m_pBuffer[i]) << "at sample " << i;
+    }
+    EXPECT_NE(0.0, m_pBuffer[kBufferSize - 1]);
+}
+
+TEST_F(ScheduledControlsTest, StopTakesEffectAtItsOffset) {
+    ControlObject* pPlay = ControlObject::getControl(
+            ConfigKey(m_sGroup1, "play"));
+    pPlay->set(1.0);
+    processDecks();
+    const double start = playposSamples(m_sGroup1);
+
+    ASSERT_TRUE(ControlEventQueue::schedule(
+            pPlay, 0.0, m_callbackStart + kPeriod / 4));
+    processDecks();
+
+    EXPECT_NEAR(start + kBufferSize / 4, playposSamples(m_sGroup1), 1e-6);
+    EXPECT_DOUBLE_EQ(0.0, pPlay->get());
+}
+
+TEST_F(ScheduledControlsTest, ScratchStartsFromStandstillAtItsOffset) {
+    processDecks();
+    const double start = playposSamples(m_sGroup1);
+
+    ControlObject::set(ConfigKey(m_sGroup1, "scratch2_enable"), 1.0);
+    ControlObject* pScratch = ControlObject::getControl(
+            ConfigKey(m_sGroup1, "scratch2"));
+    ASSERT_TRUE(ControlEventQueue::schedule(
+            pScratch, 2.0, m_callbackStart + kPeriod / 2));
+    processDecks();
+
+    EXPECT_NEAR(start + 2.0 * kBufferSize / 2, playposSamples(m_sGroup1),
+                1e-6);
+}
+
+TEST_F(ScheduledControlsTest, SplitCallbackMatchesUnsplitCallback) {
+    // The temporary rate ramps once per callback.
+    RateControl::setRateRamp(true);
+    RateControl::setRateRampSensitivity(250);
+    ControlObject::set(ConfigKey(m_sGroup1, "play"), 1.0);
+    ControlObject::set(ConfigKey(m_sGroup2, "play"), 1.0);
+    ControlObject::set(ConfigKey(m_sGroup1, "rate_temp_up"), 1.0);
+    ControlObject::set(ConfigKey(m_sGroup2, "rate_temp_up"), 1.0);
+
+    ControlObject* pScratch = ControlObject::getControl(
+            ConfigKey(m_sGroup1, "scratch2"));
+    double position = 0.0;
+    double advance = 0.0;
+    for (int callback = 0; callback < 8; ++callback) {
+        // Splits the scaling of deck 1 without changing its speed.
+        if (callback > 0) {
+            ASSERT_TRUE(ControlEventQueue::schedule(
+                    pScratch, 0.0, m_callbackStart + kPeriod / 4));
+            ASSERT_TRUE(ControlEventQueue::schedule(
+                    pScratch, 0.0, m_callbackStart + kPeriod / 2));
+        }
+        processDecks();
+        EXPECT_DOUBLE_EQ(playposSamples(m_sGroup2), playposSamples(m_sGroup1));
+        advance = playposSamples(m_sGroup1) - position;
+        position = playposSamples(m_sGroup1);
+    }
+    // The ramp did speed up the decks.
+    EXPECT_GT(advance, 1.0 * kBufferSize);
+    RateControl::setRateRamp(false);
+}
+
+TEST_F(ScheduledControlsTest, EmptyDecksAreNotScheduled) {
+    EngineDeck* pDeck = new EngineDeck("[Test4]", m_pConfig.data(),
+                                       m_pEngineMaster, EngineChannel::CENTER);
+    addDeck(pDeck);
+    ProcessBuffer();
+
+    // The caller has to set the change directly.
+    ControlObject* pRate = ControlObject::getControl(
+            ConfigKey("[Test4]", "rate"));
+    EXPECT_FALSE(ControlEventQueue::schedule(pRate, 0.5, m_callbackStart));
+}
+
+TEST_F(ScheduledControlsTest, SkippedDecksApplyQueuedChanges) {
+    ProcessBuffer();
+    ControlObject* pRate = ControlObject::getControl(
+            ConfigKey(m_sGroup1, "rate"));
+    // Queued while the deck was mixed.
+    ASSERT_TRUE(ControlEventQueue::schedule(pRate, 0.5, Time::elapsed()));
+
+    ControlObject::set(ConfigKey(m_sGroup1, "master"), 0.0);
+    ProcessBuffer();
+    EXPECT_DOUBLE_EQ(0.5, pRate->get());
+    EXPECT_FALSE(ControlEventQueue::schedule(pRate, 0.25, Time::elapsed()));
+}
+
+}  // namespace
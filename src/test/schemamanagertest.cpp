@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+
+#include <QSqlQuery>
+#include <QTemporaryFile>
+#include <QtDebug>
+#include <QtSql>
+
+#include "library/dao/settingsdao.h"
+#include "library/schemamanager.h"
+
+namespace {
+
+const char* kConnectionName = "SchemaManagerTest";
+
+// Revision 2 is optional and fails until the table it copies from exists.
+const char* kSchema =
+        "<schema>"
+        "  <revision version=\"1\">"
+        "    <description>Base</description>"
+        "    <sql>"
+        "      CREATE TABLE settings (name TEXT UNIQUE NOT NULL, value TEXT,"
+        "        locked INTEGER DEFAULT 0, hidden INTEGER DEFAULT 0);"
+        "      CREATE TABLE tracks (id INTEGER);"
+        "    </sql>"
+        "  </revision>"
+        "  <revision version=\"2\" optional=\"true\">"
+        "    <description>Optional</description>"
+        "    <sql>"
+        "      CREATE TABLE copies (id INTEGER);"
+        "      INSERT INTO copies SELECT id FROM source;"
+        "    </sql>"
+        "  </revision>"
+        "  <revision version=\"3\">"
+        "    <description>After the optional one</description>"
+        "    <sql>"
+        "      ALTER TABLE tracks ADD COLUMN title TEXT;"
+        "    </sql>"
+        "  </revision>"
+        "</schema>";
+
+class SchemaManagerTest : public testing::Test {
+  protected:
+    virtual void SetUp() {
+        ASSERT_TRUE(m_schemaFile.open());
+        m_schemaFile.write(kSchema);
+        m_schemaFile.close();
+
+        m_database = QSqlDatabase::addDatabase("QSQLITE", kConnectionName);
+        m_database.setDatabaseName(":memory:");
+        ASSERT_TRUE(m_database.open());
+    }
+
+    virtual void TearDown() {
+        m_database.close();
+        m_database = QSqlDatabase();
+        QSqlDatabase::removeDatabase(kConnectionName);
+    }
+
+    bool tableExists(const QString& table) {
+        QSqlQuery query(m_database);
+        query.prepare("SELECT name FROM sqlite_master WHERE name = :name");
+        query.bindValue(":name", table);
+        return query.exec() && query.next();
+    }
+
+    QTemporaryFile m_schemaFile;
+    QSqlDatabase m_database;
+};
+
+TEST_F(SchemaManagerTest, SplitStatements) {
+    QStringList statements = SchemaManager::splitStatements(
+        "CREATE TABLE a (x TEXT DEFAULT ';');\n"
+        "-- a comment; with a semicolon\n"
+        "INSERT INTO a VALUES ('b;c');;\n"
+        "DROP TABLE a");
+    ASSERT_EQ(3, statements.size());
+    EXPECT_EQ(QString("CREATE TABLE a (x TEXT DEFAULT ';')"), statements[0]);
+    EXPECT_EQ(QString("-- a comment; with a semicolon\n"
+                      "INSERT INTO a VALUES ('b;c')"), statements[1]);
+    EXPECT_EQ(QString("DROP TABLE a"), statements[2]);
+}
+
+TEST_F(SchemaManagerTest, SplitStatementsKeepsTriggerBodies) {
+    const QString trigger =
+            "CREATE TRIGGER t AFTER INSERT ON a\n"
+            "BEGIN\n"
+            "  UPDATE b SET y = CASE WHEN new.x > 0 THEN 1 ELSE 0 END;\n"
+            "  DELETE FROM c WHERE z = (CASE new.x WHEN 1 THEN 'end;' END);\n"
+            "END";
+    const QString tempTrigger =
+            "CREATE TEMP TRIGGER u AFTER DELETE ON a\n"
+            "BEGIN\n"
+            "  DELETE FROM b;\n"
+            "END";
+    QStringList statements = SchemaManager::splitStatements(
+        trigger + ";\n" + tempTrigger + ";\nSELECT CASE WHEN 1 THEN 2 END;");
+    ASSERT_EQ(3, statements.size());
+    EXPECT_EQ(trigger, statements[0]);
+    EXPECT_EQ(tempTrigger, statements[1]);
+    EXPECT_EQ(QString("SELECT CASE WHEN 1 THEN 2 END"), statements[2]);
+}
+
+TEST_F(SchemaManagerTest, FailedOptionalRevisionIsRetried) {
+    EXPECT_EQ(0, SchemaManager::upgradeToSchemaVersion(
+        m_schemaFile.fileName(), m_database, 3));
+    // The revisions after the optional one are applied, but it isn't.
+    SettingsDAO settings(m_database);
+    EXPECT_EQ(QString("3"), settings.getValue("mixxx.schema.version"));
+    EXPECT_FALSE(tableExists("copies"));
+
+    QSqlQuery query(m_database);
+    ASSERT_TRUE(query.exec("CREATE TABLE source (id INTEGER)"));
+    EXPECT_EQ(0, SchemaManager::upgradeToSchemaVersion(
+        m_schemaFile.fileName(), m_database, 3));
+    EXPECT_TRUE(tableExists("copies"));
+    EXPECT_EQ(QString("3"), settings.getValue("mixxx.schema.version"));
+
+    // It is not applied again.
+    ASSERT_TRUE(query.exec("DROP TABLE copies"));
+    EXPECT_EQ(0, SchemaManager::upgradeToSchemaVersion(
+        m_schemaFile.fileName(), m_database, 3));
+    EXPECT_FALSE(tableExists("copies"));
+}
+
+}  // namespace
@@ -346,3 +346,42 @@ TEST_F(SearchQueryParserTest, ExtraFilterAppended) {
         qPrintable(QString("(1 > 2) AND (artist LIKE '%asdf%')")),
         qPrintable(pQuery->toSql()));
 }
+
+TEST_F(SearchQueryParserTest, FullTextTable) {
+    QStringList searchColumns;
+    searchColumns << "artist"
+                  << "title";
+    m_parser.setFullTextTable("library_fts", "id");
+
+    // Words are looked up as prefixes in the full-text index. Terms with
+    // other characters are still searched with LIKE.
+    QScopedPointer<QueryNode> pQuery(
+        m_parser.parseQuery("Daft ac/dc", searchColumns, ""));
+
+    TrackPointer pTrack(new TrackInfoObject());
+    pTrack->setArtist("Daft Punk");
+    EXPECT_FALSE(pQuery->match(pTrack));
+    pTrack->setTitle("ac/dc cover");
+    EXPECT_TRUE(pQuery->match(pTrack));
+
+    EXPECT_STREQ(
+        qPrintable(QString("(id IN (SELECT docid FROM library_fts WHERE "
+                           "library_fts MATCH 'artist:daft* OR title:daft*')) AND "
+                           "((artist LIKE '%ac/dc%') OR (title LIKE '%ac/dc%'))")),
+        qPrintable(pQuery->toSql()));
+
+    // Tracks are matched by word prefix like the full-text index matches
+    // them, not by substring.
+    pQuery.reset(m_parser.parseQuery("unk", searchColumns, ""));
+    EXPECT_FALSE(pQuery->match(pTrack));
+    pQuery.reset(m_parser.parseQuery("PUN", searchColumns, ""));
+    EXPECT_TRUE(pQuery->match(pTrack));
+
+    // Columns that are not in the full-text index are searched with LIKE.
+    searchColumns << "key";
+    pQuery.reset(m_parser.parseQuery("daft", searchColumns, ""));
+    EXPECT_STREQ(
+        qPrintable(QString("((artist LIKE '%daft%') OR (title LIKE '%daft%') OR "
+                           "(key LIKE '%daft%'))")),
+        qPrintable(pQuery->toSql()));
+}
@@ -0,0 +1,194 @@
+#include <gtest/gtest.h>
+
+#include <QDir>
+#include <QTemporaryFile>
+#include <QVector>
+#include <QtDebug>
+
+#include "soundsourceflac.h"
+
+namespace {
+
+const int kBlockSize = 256;
+const int kBlocks = 4;
+const int kFrames = kBlockSize * kBlocks;
+
+// Packs values of any width into bytes, most significant bit first, like
+// FLAC streams.
+class BitWriter {
+  public:
+    BitWriter()
+            : m_byte(0),
+              m_bits(0) {
+    }
+
+    void write(quint64 value, int bits) {
+        for (int i = bits - 1; i >= 0; --i) {
+            m_byte = (m_byte << 1) | ((value >> i) & 1);
+            if (++m_bits == 8) {
+                m_bytes.append(static_cast<char>(m_byte));
+                m_byte = 0;
+                m_bits = 0;
+            }
+        }
+    }
+
+    const QByteArray& bytes() const {
+        return m_bytes;
+    }
+
+  private:
+    QByteArray m_bytes;
+    quint8 m_byte;
+    int m_bits;
+};
+
+quint8 crc8(const QByteArray& bytes) {
+    quint8 crc = 0;
+    for (int i = 0; i < bytes.size(); ++i) {
+        crc ^= static_cast<quint8>(bytes[i]);
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+quint16 crc16(const QByteArray& bytes) {
+    quint16 crc = 0;
+    for (int i = 0; i < bytes.size(); ++i) {
+        crc ^= static_cast<quint16>(static_cast<quint8>(bytes[i])) << 8;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x8005 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+// The sample of channel at frame, starting with the extremes of the range.
+qint32 sample(int bitsPerSample, int frame, int channel) {
+    const qint64 max = (Q_INT64_C(1) << (bitsPerSample - 1)) - 1;
+    if (frame == 0) {
+        return static_cast<qint32>(channel == 0 ? -max - 1 : max);
+    } else if (frame == 1) {
+        return static_cast<qint32>(channel == 0 ? max : -max - 1);
+    }
+    return static_cast<qint32>(
+        (frame * Q_INT64_C(7919) + channel * Q_INT64_C(104729)) % (2 * max + 1)
+        - max);
+}
+
+// A 44.1 kHz stereo FLAC stream of sample() in frames of verbatim, i.e.
+// uncompressed, subframes.
+QByteArray encodeFlac(int bitsPerSample) {
+    BitWriter stream;
+    stream.write(0x664C6143, 32); // "fLaC"
+    // The last metadata block, STREAMINFO.
+    stream.write(1, 1);
+    stream.write(0, 7);
+    stream.write(34, 24);
+    stream.write(kBlockSize, 16);
+    stream.write(kBlockSize, 16);
+    stream.write(0, 24); // Unknown frame sizes.
+    stream.write(0, 24);
+    stream.write(44100, 20);
+    stream.write(2 - 1, 3);
+    stream.write(bitsPerSample - 1, 5);
+    stream.write(kFrames, 36);
+    stream.write(0, 64); // No MD5 signature.
+    stream.write(0, 64);
+    QByteArray bytes = stream.bytes();
+
+    for (int block = 0; block < kBlocks; ++block) {
+        BitWriter header;
+        header.write(0x3FFE, 14); // Sync code.
+        header.write(0, 1);
+        header.write(0, 1); // Fixed block size.
+        header.write(8, 4); // 256 frames.
+        header.write(9, 4); // 44.1 kHz.
+        header.write(1, 4); // Left and right.
+        header.write(0, 3); // Bits per sample of STREAMINFO.
+        header.write(0, 1);
+        header.write(block, 8); // The block number, in UTF-8.
+        QByteArray frameBytes = header.bytes();
+        frameBytes.append(static_cast<char>(crc8(frameBytes)));
+
+        BitWriter subframes;
+        for (int channel = 0; channel < 2; ++channel) {
+            subframes.write(0, 1);
+            subframes.write(1, 6); // Verbatim.
+            subframes.write(0, 1); // No wasted bits.
+            for (int i = 0; i < kBlockSize; ++i) {
+                subframes.write(static_cast<quint64>(sample(
+                    bitsPerSample, block * kBlockSize + i, channel)),
+                    bitsPerSample);
+            }
+        }
+        frameBytes.append(subframes.bytes());
+        const quint16 crc = crc16(frameBytes);
+        frameBytes.append(static_cast<char>(crc >> 8));
+        frameBytes.append(static_cast<char>(crc & 0xFF));
+        bytes.append(frameBytes);
+    }
+    return bytes;
+}
+
+class SoundSourceFLACTest : public testing::Test {
+  protected:
+    // Decodes a stream of bitsPerSample and compares the samples to the ones
+    // it was encoded from.
+    void expectDecodes(int bitsPerSample) {
+        QTemporaryFile file(QDir::tempPath() + "/soundsourceflactest.XXXXXX.flac");
+        ASSERT_TRUE(file.open());
+        file.write(encodeFlac(bitsPerSample));
+        file.close();
+
+        const CSAMPLE scale = 1.0f / (Q_INT64_C(1) << (bitsPerSample - 1));
+        {
+            SoundSourceFLAC source(file.fileName());
+            ASSERT_EQ(OK, source.open());
+            EXPECT_EQ(2u * kFrames, source.length());
+            QVector<CSAMPLE> buffer(2 * kFrames + 10);
+            ASSERT_EQ(2u * kFrames,
+                      source.readFloat(buffer.size(), buffer.data()));
+            for (int i = 0; i < kFrames; ++i) {
+                for (int channel = 0; channel < 2; ++channel) {
+                    const CSAMPLE expected =
+                            sample(bitsPerSample, i, channel) * scale;
+                    ASSERT_FLOAT_EQ(expected, buffer[2 * i + channel])
+                            << "frame " << i << " channel " << channel;
+                    ASSERT_LE(-1.0f, buffer[2 * i + channel]);
+                    ASSERT_GE(1.0f, buffer[2 * i + channel]);
+                }
+            }
+        }
+        {
+            SoundSourceFLAC source(file.fileName());
+            ASSERT_EQ(OK, source.open());
+            QVector<SAMPLE> buffer(2 * kFrames);
+            ASSERT_EQ(2u * kFrames, source.read(buffer.size(), buffer.data()));
+            const int shift = bitsPerSample - 16;
+            for (int i = 0; i < kFrames; ++i) {
+                for (int channel = 0; channel < 2; ++channel) {
+                    ASSERT_EQ(sample(bitsPerSample, i, channel) >> shift,
+                              buffer[2 * i + channel])
+                            << "frame " << i << " channel " << channel;
+                }
+            }
+        }
+    }
+};
+
+TEST_F(SoundSourceFLACTest, Decode16Bit) {
+    expectDecodes(16);
+}
+
+TEST_F(SoundSourceFLACTest, Decode24Bit) {
+    expectDecodes(24);
+}
+
+TEST_F(SoundSourceFLACTest, Decode32Bit) {
+    expectDecodes(32);
+}
+
+}  // namespace
@@ -0,0 +1,209 @@
+#include <gtest/gtest.h>
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryFile>
+#include <QVector>
+#include <QtDebug>
+
+// MAD is an optional dependency.
+#ifdef __MAD__
+
+#include "mp3seektable.h"
+#include "soundsourcemp3.h"
+
+namespace {
+
+// MPEG-1 layer III, 128 kbps, 44.1 kHz, stereo, without CRC or padding.
+const unsigned char kFrameHeader[] = { 0xFF, 0xFB, 0x90, 0x00 };
+const int kFrameBytes = 417;
+const int kFrameSamples = 2 * 1152;
+const int kFrames = 200;
+// Where the ancillary data of the first frame, and so a Xing tag, starts: after
+// the header and the 32 bytes of stereo side information.
+const int kXingOffset = 4 + 32;
+
+class SoundSourceMp3Test : public testing::Test {
+  protected:
+    virtual void SetUp() {
+        m_cacheDir = QDir(QDir::temp().absoluteFilePath(
+            QString("soundsourcemp3test-%1").arg(QCoreApplication::applicationPid())));
+        ASSERT_TRUE(m_cacheDir.mkpath("."));
+        Mp3SeekTable::setCacheDirectoryForTest(m_cacheDir.absolutePath());
+        writeFrames(&m_file, 0);
+    }
+
+    virtual void TearDown() {
+        SoundSourceMp3::setDeferSeekTableBuilderForTest(false);
+        Mp3SeekTable::setCacheDirectoryForTest(QString());
+        foreach (const QString& fileName, m_cacheDir.entryList(QDir::Files)) {
+            m_cacheDir.remove(fileName);
+        }
+        m_cacheDir.rmdir(m_cacheDir.absolutePath());
+    }
+
+    // Writes kFrames silent frames into pFile: all the side information is
+    // zero, so they have no main data. Tags the first frame with xingFrames
+    // unless it is 0.
+    void writeFrames(QTemporaryFile* pFile, unsigned long xingFrames) {
+        QByteArray frame(kFrameBytes, '\0');
+        for (unsigned int i = 0; i < sizeof(kFrameHeader); ++i) {
+            frame[i] = kFrameHeader[i];
+        }
+        pFile->setFileTemplate(QDir::tempPath() + "/soundsourcemp3test.XXXXXX.mp3");
+        ASSERT_TRUE(pFile->open());
+        for (int i = 0; i < kFrames; ++i) {
+            if (i == 0 && xingFrames > 0) {
+                // The magic, the flags that say only the frame count follows
+                // and the frame count, big endian.
+                QByteArray tag("Xing");
+                tag.append(QByteArray(3, '\0')).append('\x01');
+                for (int shift = 24; shift >= 0; shift -= 8) {
+                    tag.append(static_cast<char>((xingFrames >> shift) & 0xFF));
+                }
+                pFile->write(QByteArray(frame).replace(kXingOffset, tag.size(), tag));
+            } else {
+                pFile->write(frame);
+            }
+        }
+        pFile->close();
+    }
+
+    // Reads from the current position to the end of the file and returns
+    // the number of samples read.
+    unsigned long readToEnd(SoundSourceMp3* pSource) {
+        QVector<SAMPLE> buffer(4096);
+        unsigned long samples = 0;
+        unsigned read = 0;
+        while ((read = pSource->read(buffer.size(), buffer.data())) > 0) {
+            samples += read;
+        }
+        return samples;
+    }
+
+    QDir m_cacheDir;
+    QTemporaryFile m_file;
+};
+
+TEST_F(SoundSourceMp3Test, SeekIsSampleAccurate) {
+    SoundSourceMp3 source(m_file.fileName());
+    ASSERT_EQ(OK, source.open());
+    const long length = source.length();
+    ASSERT_LT(kFrameSamples * (kFrames - 2), length);
+    ASSERT_EQ(0, length % kFrameSamples);
+    EXPECT_EQ(static_cast<unsigned long>(length), readToEnd(&source));
+
+    // In the first frames, inside and on the boundaries of later frames.
+    const long positions[] = { 2, kFrameSamples + 100, 10 * kFrameSamples,
+                               10 * kFrameSamples + 2, 57 * kFrameSamples - 2,
+                               length - 2 };
+    for (unsigned int i = 0; i < sizeof(positions) / sizeof(positions[0]); ++i) {
+        source.seek(positions[i]);
+        EXPECT_EQ(static_cast<unsigned long>(length - positions[i]),
+                  readToEnd(&source)) << "seeking to " << positions[i];
+    }
+}
+
+TEST_F(SoundSourceMp3Test, SeekBeyondIncompleteSeekTable) {
+    SoundSourceMp3 source(m_file.fileName());
+    ASSERT_EQ(OK, source.open());
+    const long length = source.length();
+    // As if the builder had only scanned the first 20 frames.
+    source.truncateSeekTableForTest(20);
+
+    const long positions[] = { 5 * kFrameSamples + 2, 19 * kFrameSamples + 100,
+                               20 * kFrameSamples, 150 * kFrameSamples + 2,
+                               length - 2 };
+    for (unsigned int i = 0; i < sizeof(positions) / sizeof(positions[0]); ++i) {
+        source.seek(positions[i]);
+        EXPECT_EQ(static_cast<unsigned long>(length - positions[i]),
+                  readToEnd(&source)) << "seeking to " << positions[i];
+    }
+
+    // Seeks beyond the first frames work from an empty table too.
+    source.truncateSeekTableForTest(0);
+    source.seek(100 * kFrameSamples + 2);
+    EXPECT_EQ(static_cast<unsigned long>(length - 100 * kFrameSamples - 2),
+              readToEnd(&source));
+}
+
+TEST_F(SoundSourceMp3Test, SeekTableIsSavedToCache) {
+    const QString cacheFile = Mp3SeekTable::cacheFileName(QFileInfo(m_file.fileName()));
+    EXPECT_TRUE(cacheFile.startsWith(m_cacheDir.absolutePath()));
+    {
+        SoundSourceMp3 source(m_file.fileName());
+        ASSERT_EQ(OK, source.open());
+    }
+    EXPECT_TRUE(QFile::exists(cacheFile));
+}
+
+TEST_F(SoundSourceMp3Test, XingLengthIsReplacedByExactLength) {
+    // The tag overstates the length, so the estimate can be told apart.
+    QTemporaryFile xingFile;
+    writeFrames(&xingFile, kFrames + 49);
+    const long estimatedLength = (kFrames + 50) * kFrameSamples;
+    const QString cacheFile = Mp3SeekTable::cacheFileName(QFileInfo(xingFile.fileName()));
+
+    long length = 0;
+    {
+        SoundSourceMp3::setDeferSeekTableBuilderForTest(true);
+        SoundSourceMp3 source(xingFile.fileName());
+        ASSERT_EQ(OK, source.open());
+        EXPECT_EQ(estimatedLength, static_cast<long>(source.length()));
+        EXPECT_FALSE(QFile::exists(cacheFile));
+
+        source.startSeekTableBuilderForTest();
+        ASSERT_TRUE(source.waitForSeekTableBuilderForTest());
+        length = source.length();
+        EXPECT_GT(estimatedLength, length);
+        EXPECT_LT(kFrameSamples * (kFrames - 2), length);
+        EXPECT_EQ(static_cast<unsigned long>(length), readToEnd(&source));
+    }
+
+    // The builder saved the table, so the next open knows the exact length
+    // without building it again.
+    EXPECT_TRUE(QFile::exists(cacheFile));
+    SoundSourceMp3 source(xingFile.fileName());
+    ASSERT_EQ(OK, source.open());
+    EXPECT_FALSE(source.waitForSeekTableBuilderForTest());
+    EXPECT_EQ(length, static_cast<long>(source.length()));
+}
+
+TEST_F(SoundSourceMp3Test, SeekWhileSeekTableIsBuilt) {
+    QTemporaryFile xingFile;
+    writeFrames(&xingFile, kFrames - 1);
+    SoundSourceMp3::setDeferSeekTableBuilderForTest(true);
+    SoundSourceMp3 source(xingFile.fileName());
+    ASSERT_EQ(OK, source.open());
+
+    const long positions[] = { 2, 5 * kFrameSamples + 2, 57 * kFrameSamples - 2,
+                               150 * kFrameSamples + 100 };
+    const int kPositions = sizeof(positions) / sizeof(positions[0]);
+    // Before the builder has scanned any frame, and while it is running.
+    QVector<unsigned long> beforeBuild;
+    for (int i = 0; i < kPositions; ++i) {
+        source.seek(positions[i]);
+        beforeBuild.append(readToEnd(&source));
+    }
+    source.startSeekTableBuilderForTest();
+    QVector<unsigned long> duringBuild;
+    for (int i = 0; i < kPositions; ++i) {
+        source.seek(positions[i]);
+        duringBuild.append(readToEnd(&source));
+    }
+
+    ASSERT_TRUE(source.waitForSeekTableBuilderForTest());
+    const long length = source.length();
+    for (int i = 0; i < kPositions; ++i) {
+        EXPECT_EQ(static_cast<unsigned long>(length - positions[i]), beforeBuild[i])
+                << "seeking to " << positions[i] << " before the build";
+        EXPECT_EQ(static_cast<unsigned long>(length - positions[i]), duringBuild[i])
+                << "seeking to " << positions[i] << " during the build";
+    }
+}
+
+}  // namespace
+
+#endif  // __MAD__
@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+
+#include <limits.h>
+
+#include <QtDebug>
+#include <QVector>
+
+#include "soundsource.h"
+
+namespace {
+
+// A sound source that only implements read(), like the sound sources of
+// plugins, and returns a ramp of samples.
+class RampSoundSource : public Mixxx::SoundSource {
+  public:
+    explicit RampSoundSource(unsigned long length)
+            : Mixxx::SoundSource("ramp"),
+              m_length(length),
+              m_position(0) {
+    }
+
+    int open() {
+        return OK;
+    }
+    long seek(long position) {
+        m_position = position;
+        return position;
+    }
+    unsigned read(unsigned long size, const SAMPLE* destination) {
+        SAMPLE* dest = const_cast<SAMPLE*>(destination);
+        unsigned samples = 0;
+        while (samples < size && m_position < m_length) {
+            dest[samples++] = sample(m_position++);
+        }
+        return samples;
+    }
+    long unsigned length() {
+        return m_length;
+    }
+    int parseHeader() {
+        return OK;
+    }
+
+    static SAMPLE sample(unsigned long position) {
+        return static_cast<SAMPLE>(position % 65536 - 32768);
+    }
+
+  private:
+    const unsigned long m_length;
+    unsigned long m_position;
+};
+
+TEST(SoundSourceTest, ReadFloatConvertsRead) {
+    const unsigned long length = 10000;
+    RampSoundSource source(length);
+    QVector<CSAMPLE> buffer(length + 100, 2.0f);
+    EXPECT_EQ(length, source.readFloat(length + 100, buffer.data()));
+    for (unsigned long i = 0; i < length; ++i) {
+        ASSERT_FLOAT_EQ(RampSoundSource::sample(i) / CSAMPLE(SHRT_MAX),
+                        buffer[i]);
+    }
+    // Samples beyond the end are not touched.
+    EXPECT_FLOAT_EQ(2.0f, buffer[length]);
+
+    source.seek(length - 10);
+    EXPECT_EQ(10u, source.readFloat(100, buffer.data()));
+    EXPECT_EQ(0u, source.readFloat(100, buffer.data()));
+}
+
+}  // namespace
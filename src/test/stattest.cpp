@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+#include <QtDebug>
+
+#include "util/stat.h"
+
+namespace {
+
+class StatTest : public testing::Test {
+  protected:
+    virtual void SetUp() {
+        m_stat.m_type = Stat::COUNTER;
+        m_stat.m_compute = Stat::COUNT | Stat::REPORTS_PER_SECOND;
+    }
+
+    void report(qint64 time) {
+        StatReport report;
+        report.time = time;
+        report.type = m_stat.m_type;
+        report.compute = m_stat.m_compute;
+        report.value = 1.0;
+        m_stat.processReport(report);
+    }
+
+    Stat m_stat;
+};
+
+TEST_F(StatTest, ReportsPerSecondNeedsTwoReports) {
+    EXPECT_DOUBLE_EQ(0.0, m_stat.reportsPerSecond());
+    report(1000000000LL);
+    EXPECT_DOUBLE_EQ(0.0, m_stat.reportsPerSecond());
+    // Reports at the same time span no time.
+    report(1000000000LL);
+    EXPECT_DOUBLE_EQ(0.0, m_stat.reportsPerSecond());
+}
+
+TEST_F(StatTest, ReportsPerSecondIsTheAverageRate) {
+    // Five reports in the second from the first to the last one.
+    report(2000000000LL);
+    report(2100000000LL);
+    report(2200000000LL);
+    report(2900000000LL);
+    report(3000000000LL);
+    EXPECT_DOUBLE_EQ(4.0, m_stat.reportsPerSecond());
+
+    // Later reports lower the rate.
+    report(4000000000LL);
+    EXPECT_DOUBLE_EQ(2.5, m_stat.reportsPerSecond());
+}
+
+}  // namespace
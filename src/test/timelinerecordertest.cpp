@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+
+#include <QFile>
+#include <QTemporaryFile>
+#include <QThread>
+#include <QtDebug>
+
+#include "util/event.h"
+#include "util/timelinerecorder.h"
+#include "util/trace.h"
+
+namespace {
+
+class TimelineRecorderTest : public testing::Test {
+  protected:
+    virtual void SetUp() {
+        TimelineRecorder::setRecording(true);
+    }
+
+    virtual void TearDown() {
+        TimelineRecorder::setRecording(false);
+    }
+
+    QString writeTrace() {
+        QTemporaryFile file;
+        EXPECT_TRUE(file.open());
+        EXPECT_TRUE(TimelineRecorder::writeChromeTrace(file.fileName()));
+        QFile trace(file.fileName());
+        EXPECT_TRUE(trace.open(QIODevice::ReadOnly | QIODevice::Text));
+        return QString::fromUtf8(trace.readAll());
+    }
+};
+
+class TracingThread : public QThread {
+  public:
+    explicit TracingThread(const TraceKey& key)
+            : m_key(key) {
+    }
+
+  protected:
+    virtual void run() {
+        QThread::currentThread()->setObjectName("TimelineRecorderTest worker");
+        Trace trace(m_key);
+    }
+
+  private:
+    const TraceKey m_key;
+};
+
+TEST_F(TimelineRecorderTest, WritesBeginAndEndEvents) {
+    {
+        Trace trace(TraceKey("TimelineRecorderTest outer"));
+        Event::event(Stat::registerKey("TimelineRecorderTest instant"));
+    }
+
+    const QString json = writeTrace();
+    EXPECT_TRUE(json.startsWith("{"));
+    EXPECT_TRUE(json.contains(
+        "{\"name\":\"TimelineRecorderTest outer\",\"ph\":\"B\""));
+    EXPECT_TRUE(json.contains(
+        "{\"name\":\"TimelineRecorderTest outer\",\"ph\":\"E\""));
+    EXPECT_TRUE(json.contains(
+        "{\"name\":\"TimelineRecorderTest instant\",\"ph\":\"i\""));
+}
+
+TEST_F(TimelineRecorderTest, EachThreadGetsANamedTrack) {
+    TracingThread thread(TraceKey("TimelineRecorderTest thread"));
+    thread.start();
+    ASSERT_TRUE(thread.wait());
+
+    // The thread has exited but its events are kept.
+    const QString json = writeTrace();
+    EXPECT_TRUE(json.contains("\"args\":{\"name\":\"TimelineRecorderTest worker\"}"));
+    EXPECT_TRUE(json.contains(
+        "{\"name\":\"TimelineRecorderTest thread\",\"ph\":\"B\""));
+}
+
+TEST_F(TimelineRecorderTest, ExitedThreadsHandTheirRingToTheNextThread) {
+    TracingThread first(TraceKey("TimelineRecorderTest first"));
+    first.start();
+    ASSERT_TRUE(first.wait());
+    const int rings = TimelineRecorder::threadRingCount();
+
+    for (int i = 0; i < 8; ++i) {
+        TracingThread thread(TraceKey("TimelineRecorderTest reused"));
+        thread.start();
+        ASSERT_TRUE(thread.wait());
+    }
+    EXPECT_EQ(rings, TimelineRecorder::threadRingCount());
+
+    // The last thread's events are still exported after it has exited.
+    EXPECT_TRUE(writeTrace().contains(
+        "{\"name\":\"TimelineRecorderTest reused\",\"ph\":\"B\""));
+}
+
+TEST_F(TimelineRecorderTest, RingsArePreallocatedWhenRecordingStarts) {
+    const int rings = TimelineRecorder::threadRingCount();
+    EXPECT_LE(TimelineRecorder::kPreallocatedRings, rings);
+
+    // A new thread takes a preallocated ring instead of allocating one on its
+    // first event.
+    TracingThread thread(TraceKey("TimelineRecorderTest preallocated"));
+    thread.start();
+    ASSERT_TRUE(thread.wait());
+    EXPECT_EQ(rings, TimelineRecorder::threadRingCount());
+    EXPECT_TRUE(writeTrace().contains("\"args\":{\"name\":\"TimelineRecorderTest worker\"}"));
+}
+
+TEST_F(TimelineRecorderTest, NothingIsRecordedWhenDisabled) {
+    TimelineRecorder::setRecording(false);
+    Event::event(Stat::registerKey("TimelineRecorderTest disabled"));
+    EXPECT_FALSE(writeTrace().contains("TimelineRecorderTest disabled"));
+}
+
+TEST_F(TimelineRecorderTest, RingKeepsMostRecentEvents) {
+    const StatKey oldKey = Stat::registerKey("TimelineRecorderTest old");
+    const StatKey newKey = Stat::registerKey("TimelineRecorderTest new");
+    Event::event(oldKey);
+    for (int i = 0; i < TimelineRecorder::kEventsPerThread; ++i) {
+        Event::event(newKey);
+    }
+
+    const QString json = writeTrace();
+    EXPECT_FALSE(json.contains("TimelineRecorderTest old"));
+    EXPECT_TRUE(json.contains("TimelineRecorderTest new"));
+}
+
+}  // namespace
@@ -0,0 +1,48 @@
+#include <QDateTime>
+#include <QDir>
+#include <QtDebug>
+
+#include "timelinecontrol.h"
+#include "controlpushbutton.h"
+#include "util/timelinerecorder.h"
+
+TimelineControl::TimelineControl(const QString& settingsPath,
+                                 const QString& tracePath)
+        : m_settingsPath(settingsPath),
+          m_tracePath(tracePath) {
+    m_pRecording = new ControlPushButton(
+        ConfigKey("[Master]", "timeline_recording"));
+    m_pRecording->setButtonMode(ControlPushButton::TOGGLE);
+    m_pRecording->set(TimelineRecorder::isRecording() ? 1.0 : 0.0);
+    connect(m_pRecording, SIGNAL(valueChanged(double)),
+            this, SLOT(slotRecording(double)));
+
+    m_pDump = new ControlPushButton(ConfigKey("[Master]", "timeline_dump"));
+    connect(m_pDump, SIGNAL(valueChanged(double)),
+            this, SLOT(slotDump(double)));
+}
+
+TimelineControl::~TimelineControl() {
+    delete m_pRecording;
+    delete m_pDump;
+}
+
+QString TimelineControl::dump() {
+    QString filename = m_tracePath;
+    if (filename.isEmpty()) {
+        filename = QDir(m_settingsPath).filePath(
+            QString("timeline-%1.json").arg(
+                QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss")));
+    }
+    return TimelineRecorder::writeChromeTrace(filename) ? filename : QString();
+}
+
+void TimelineControl::slotRecording(double value) {
+    TimelineRecorder::setRecording(value > 0.0);
+}
+
+void TimelineControl::slotDump(double value) {
+    if (value > 0.0) {
+        dump();
+    }
+}
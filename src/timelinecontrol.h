@@ -0,0 +1,39 @@
+#ifndef TIMELINECONTROL_H
+#define TIMELINECONTROL_H
+
+#include <QObject>
+#include <QString>
+
+class ControlPushButton;
+
+// Exposes the TimelineRecorder as controls so that recording can be toggled
+// and the timeline written from a skin or a controller mapping, e.g. right
+// after hearing an xrun during a live set.
+//
+//   [Master],timeline_recording  toggles recording of per-thread events.
+//   [Master],timeline_dump       writes the recorded events as Chrome Trace
+//                                Event JSON.
+class TimelineControl : public QObject {
+    Q_OBJECT
+  public:
+    // Dumps are written to tracePath, or to a time-stamped file in
+    // settingsPath if tracePath is empty.
+    TimelineControl(const QString& settingsPath, const QString& tracePath);
+    virtual ~TimelineControl();
+
+    // Writes the recorded events and returns the file name, or an empty string
+    // if the file could not be written.
+    QString dump();
+
+  private slots:
+    void slotRecording(double value);
+    void slotDump(double value);
+
+  private:
+    const QString m_settingsPath;
+    const QString m_tracePath;
+    ControlPushButton* m_pRecording;
+    ControlPushButton* m_pDump;
+};
+
+#endif /* TIMELINECONTROL_H */
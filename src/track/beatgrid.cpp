@@ -37,13 +37,13 @@ class BeatGridIterator : public BeatIterator {
 
 BeatGrid::BeatGrid(TrackInfoObject* pTrack, const QByteArray* pByteArray)
         : QObject(),
-          m_mutex(QMutex::Recursive),
           m_iSampleRate(pTrack->getSampleRate()),
           m_dBeatLength(0.0) {
     qDebug() << "New BeatGrid";
     if (pByteArray != NULL) {
         readByteArray(pByteArray);
     }
+    publishSnapshot();
 }
 
 BeatGrid::~BeatGrid() {
@@ -59,6 +59,7 @@ void BeatGrid::setGrid(double dBpm, double dFirstBeatSample) {
     m_grid.mutable_first_beat()->set_frame_position(dFirstBeatSample / kFrameSize);
     // Calculate beat length as sample offsets
     m_dBeatLength = (60.0 * m_iSampleRate / dBpm) * kFrameSize;
+    publishSnapshot();
 }
 
 QByteArray* BeatGrid::toByteArray() const {
@@ -114,36 +115,50 @@ bool BeatGrid::isValid() const {
     return m_iSampleRate > 0 && bpm() > 0;
 }
 
+void BeatGrid::publishSnapshot() {
+    Snapshot* pSnapshot = new Snapshot();
+    pSnapshot->valid = isValid();
+    pSnapshot->bpm = bpm();
+    pSnapshot->firstBeatSample = firstBeatSample();
+    pSnapshot->beatLength = m_dBeatLength;
+    m_snapshot.setValue(SnapshotPointer(pSnapshot));
+}
+
 // This could be implemented in the Beats Class itself.
 // If necessary, the child class can redefine it.
 double BeatGrid::findNextBeat(double dSamples) const {
-    return findNthBeat(dSamples, +1);
+    return findNthBeat(*snapshot(), dSamples, +1);
 }
 
 // This could be implemented in the Beats Class itself.
 // If necessary, the child class can redefine it.
 double BeatGrid::findPrevBeat(double dSamples) const {
-    return findNthBeat(dSamples, -1);
+    return findNthBeat(*snapshot(), dSamples, -1);
 }
 
 // This is an internal call. This could be implemented in the Beats Class itself.
 double BeatGrid::findClosestBeat(double dSamples) const {
-    QMutexLocker locker(&m_mutex);
-    if (!isValid()) {
+    SnapshotPointer pSnapshot = snapshot();
+    if (!pSnapshot->valid) {
         return -1;
     }
-    double nextBeat = findNextBeat(dSamples);
-    double prevBeat = findPrevBeat(dSamples);
+    double nextBeat = findNthBeat(*pSnapshot, dSamples, +1);
+    double prevBeat = findNthBeat(*pSnapshot, dSamples, -1);
     return (nextBeat - dSamples > dSamples - prevBeat) ? prevBeat : nextBeat;
 }
 
 double BeatGrid::findNthBeat(double dSamples, int n) const {
-    QMutexLocker locker(&m_mutex);
-    if (!isValid() || n == 0) {
+    return findNthBeat(*snapshot(), dSamples, n);
+}
+
+double BeatGrid::findNthBeat(const Snapshot& snapshot, double dSamples,
+                             int n) const {
+    if (!snapshot.valid || n == 0) {
         return -1;
     }
 
-    double beatFraction = (dSamples - firstBeatSample()) / m_dBeatLength;
+    double beatFraction = (dSamples - snapshot.firstBeatSample) /
+            snapshot.beatLength;
     const double prevBeat = floorf(beatFraction);
     const double nextBeat = ceilf(beatFraction);
 
@@ -160,17 +175,17 @@ double BeatGrid::findNthBeat(double dSamples, int n) const {
     double dClosestBeat;
     if (n > 0) {
         // We're going forward, so use ceilf to round up to the next multiple of
-        // m_dBeatLength
-        dClosestBeat = nextBeat * m_dBeatLength + firstBeatSample();
+        // the beat length
+        dClosestBeat = nextBeat * snapshot.beatLength + snapshot.firstBeatSample;
         n = n - 1;
     } else {
         // We're going backward, so use floorf to round down to the next multiple
-        // of m_dBeatLength
-        dClosestBeat = prevBeat * m_dBeatLength + firstBeatSample();
+        // of the beat length
+        dClosestBeat = prevBeat * snapshot.beatLength + snapshot.firstBeatSample;
         n = n + 1;
     }
 
-    double dResult = dClosestBeat + n * m_dBeatLength;
+    double dResult = dClosestBeat + n * snapshot.beatLength;
     if (!even(dResult)) {
         dResult--;
     }
@@ -178,25 +193,25 @@ double BeatGrid::findNthBeat(double dSamples, int n) const {
 }
 
 BeatIterator* BeatGrid::findBeats(double startSample, double stopSample) const {
-    QMutexLocker locker(&m_mutex);
-    if (!isValid() || startSample > stopSample) {
+    SnapshotPointer pSnapshot = snapshot();
+    if (!pSnapshot->valid || startSample > stopSample) {
         return NULL;
     }
     // qDebug() << "BeatGrid::findBeats startSample" << startSample << "stopSample"
     //          << stopSample << "beatlength" << m_dBeatLength << "BPM" << bpm();
-    double curBeat = findNextBeat(startSample);
+    double curBeat = findNthBeat(*pSnapshot, startSample, +1);
     if (curBeat == -1.0) {
         return NULL;
     }
-    return new BeatGridIterator(m_dBeatLength, curBeat, stopSample);
+    return new BeatGridIterator(pSnapshot->beatLength, curBeat, stopSample);
 }
 
 bool BeatGrid::hasBeatInRange(double startSample, double stopSample) const {
-    QMutexLocker locker(&m_mutex);
-    if (!isValid() || startSample > stopSample) {
+    SnapshotPointer pSnapshot = snapshot();
+    if (!pSnapshot->valid || startSample > stopSample) {
         return false;
     }
-    double curBeat = findNextBeat(startSample);
+    double curBeat = findNthBeat(*pSnapshot, startSample, +1);
     if (curBeat != -1.0 && curBeat <= stopSample) {
         return true;
     }
@@ -204,19 +219,19 @@ bool BeatGrid::hasBeatInRange(double startSample, double stopSample) const {
 }
 
 double BeatGrid::getBpm() const {
-    QMutexLocker locker(&m_mutex);
-    if (!isValid()) {
+    SnapshotPointer pSnapshot = snapshot();
+    if (!pSnapshot->valid) {
         return 0;
     }
-    return bpm();
+    return pSnapshot->bpm;
 }
 
 double BeatGrid::getBpmRange(double startSample, double stopSample) const {
-    QMutexLocker locker(&m_mutex);
-    if (!isValid() || startSample > stopSample) {
+    SnapshotPointer pSnapshot = snapshot();
+    if (!pSnapshot->valid || startSample > stopSample) {
         return -1;
     }
-    return bpm();
+    return pSnapshot->bpm;
 }
 
 void BeatGrid::addBeat(double dBeatSample) {
@@ -245,6 +260,7 @@ void BeatGrid::translate(double dNumSamples) {
     }
     double newFirstBeatFrames = (firstBeatSample() + dNumSamples) / kFrameSize;
     m_grid.mutable_first_beat()->set_frame_position(newFirstBeatFrames);
+    publishSnapshot();
     locker.unlock();
     emit(updated());
 }
@@ -257,6 +273,7 @@ void BeatGrid::scale(double dScalePercentage) {
     double newBpm = bpm() * dScalePercentage;
     m_grid.mutable_bpm()->set_bpm(newBpm);
     m_dBeatLength = (60.0 * m_iSampleRate / newBpm) * kFrameSize;
+    publishSnapshot();
     locker.unlock();
     emit(updated());
 }
@@ -265,6 +282,7 @@ void BeatGrid::setBpm(double dBpm) {
     QMutexLocker locker(&m_mutex);
     m_grid.mutable_bpm()->set_bpm(dBpm);
     m_dBeatLength = (60.0 * m_iSampleRate / dBpm) * kFrameSize;
+    publishSnapshot();
     locker.unlock();
     emit(updated());
 }
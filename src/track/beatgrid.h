@@ -3,7 +3,9 @@
 
 #include <QMutex>
 #include <QObject>
+#include <QSharedPointer>
 
+#include "control/controlvalue.h"
 #include "trackinfoobject.h"
 #include "track/beats.h"
 #include "proto/beats.pb.h"
@@ -13,7 +15,8 @@
 
 // BeatGrid is an implementation of the Beats interface that implements an
 // infinite grid of beats, aligned to a song simply by a starting offset of the
-// first beat and the song's average beats-per-minute.
+// first beat and the song's average beats-per-minute. Like BeatMap, the queries
+// read an immutable snapshot of the grid without locking.
 class BeatGrid : public QObject, public virtual Beats {
     Q_OBJECT
   public:
@@ -65,13 +68,38 @@ class BeatGrid : public QObject, public virtual Beats {
     void updated();
 
   private:
+    // The state the queries read. Never changed once published.
+    struct Snapshot {
+        Snapshot()
+                : valid(false),
+                  bpm(0.0),
+                  firstBeatSample(0.0),
+                  beatLength(0.0) {
+        }
+        bool valid;
+        double bpm;
+        double firstBeatSample;
+        // The length of a beat in samples
+        double beatLength;
+    };
+    typedef QSharedPointer<const Snapshot> SnapshotPointer;
+
     double firstBeatSample() const;
     double bpm() const;
 
     void readByteArray(const QByteArray* pByteArray);
     // For internal use only.
     bool isValid() const;
+    // Publishes a new snapshot of m_grid. Must be called with m_mutex locked
+    // or from the constructor.
+    void publishSnapshot();
+
+    SnapshotPointer snapshot() const {
+        return m_snapshot.getValue();
+    }
+    double findNthBeat(const Snapshot& snapshot, double dSamples, int n) const;
 
+    // Serializes the mutations. Queries don't lock it.
     mutable QMutex m_mutex;
     // The sub-version of this beatgrid.
     QString m_subVersion;
@@ -81,6 +109,7 @@ class BeatGrid : public QObject, public virtual Beats {
     mixxx::track::io::BeatGrid m_grid;
     // The length of a beat in samples
     double m_dBeatLength;
+    ControlValueAtomic<SnapshotPointer> m_snapshot;
 };
 
 
@@ -10,6 +10,7 @@
 
 #include "track/beatmap.h"
 #include "track/beatutils.h"
+#include "util/compatibility.h"
 
 using mixxx::track::io::Beat;
 
@@ -29,36 +30,31 @@ bool BeatLessThan(const Beat& beat1, const Beat& beat2) {
 
 class BeatMapIterator : public BeatIterator {
   public:
-    BeatMapIterator(BeatList::const_iterator start, BeatList::const_iterator end)
-            : m_currentBeat(start),
-              m_endBeat(end) {
-        // Advance to the first enabled beat.
-        while (m_currentBeat != m_endBeat && !m_currentBeat->enabled()) {
-            ++m_currentBeat;
-        }
+    BeatMapIterator(const QVector<double>& frames, int start, int end)
+            : m_frames(frames),
+              m_iCurrentBeat(start),
+              m_iEndBeat(end) {
     }
 
     virtual bool hasNext() const {
-        return m_currentBeat != m_endBeat;
+        return m_iCurrentBeat < m_iEndBeat;
     }
 
     virtual double next() {
-        double beat = framesToSamples(m_currentBeat->frame_position());
-        ++m_currentBeat;
-        while (m_currentBeat != m_endBeat && !m_currentBeat->enabled()) {
-            ++m_currentBeat;
-        }
-        return beat;
+        return framesToSamples(m_frames.at(m_iCurrentBeat++));
     }
 
   private:
-    BeatList::const_iterator m_currentBeat;
-    BeatList::const_iterator m_endBeat;
+    // Shares the frames of the snapshot it iterates, so it stays valid when
+    // the beats change.
+    const QVector<double> m_frames;
+    int m_iCurrentBeat;
+    const int m_iEndBeat;
 };
 
 BeatMap::BeatMap(TrackPointer pTrack, const QByteArray* pByteArray)
         : QObject(),
-          m_mutex(QMutex::Recursive) {
+          m_iCursor(0) {
     initialize(pTrack);
     if (pByteArray != NULL) {
         readByteArray(pByteArray);
@@ -67,7 +63,7 @@ BeatMap::BeatMap(TrackPointer pTrack, const QByteArray* pByteArray)
 
 BeatMap::BeatMap(TrackPointer pTrack, const QVector<double> beats)
         : QObject(),
-          m_mutex(QMutex::Recursive) {
+          m_iCursor(0) {
     initialize(pTrack);
     if (beats.size() > 0) {
         createFromBeatVector(beats);
@@ -76,8 +72,7 @@ BeatMap::BeatMap(TrackPointer pTrack, const QVector<double> beats)
 
 void BeatMap::initialize(TrackPointer pTrack) {
     m_iSampleRate = pTrack->getSampleRate();
-    m_dCachedBpm = 0;
-    m_dLastFrame = 0;
+    onBeatlistChanged();
 }
 
 BeatMap::~BeatMap() {
@@ -154,109 +149,105 @@ bool BeatMap::isValid() const {
 }
 
 double BeatMap::findNextBeat(double dSamples) const {
-    return findNthBeat(dSamples, 1);
+    return findNthBeat(*snapshot(), dSamples, 1);
 }
 
 double BeatMap::findPrevBeat(double dSamples) const {
-    return findNthBeat(dSamples, -1);
+    return findNthBeat(*snapshot(), dSamples, -1);
 }
 
 double BeatMap::findClosestBeat(double dSamples) const {
-    QMutexLocker locker(&m_mutex);
-    if (!isValid()) {
+    SnapshotPointer pSnapshot = snapshot();
+    if (!pSnapshot->valid) {
         return -1;
     }
-    double nextBeat = findNextBeat(dSamples);
-    double prevBeat = findPrevBeat(dSamples);
+    double nextBeat = findNthBeat(*pSnapshot, dSamples, 1);
+    double prevBeat = findNthBeat(*pSnapshot, dSamples, -1);
     return (nextBeat - dSamples > dSamples - prevBeat) ? prevBeat : nextBeat;
 }
 
 double BeatMap::findNthBeat(double dSamples, int n) const {
-    QMutexLocker locker(&m_mutex);
+    return findNthBeat(*snapshot(), dSamples, n);
+}
 
-    if (!isValid() || n == 0) {
+double BeatMap::findNthBeat(const Snapshot& snapshot, double dSamples,
+                            int n) const {
+    if (!snapshot.valid || n == 0) {
         return -1;
     }
 
-    Beat beat;
     // Reduce sample offset to a frame offset.
-    beat.set_frame_position(samplesToFrames(dSamples));
+    const double frame = samplesToFrames(dSamples);
+    const QVector<double>& frames = snapshot.frames;
 
+    int index;
     if (n > 0) {
-        BeatList::const_iterator it =
-                qLowerBound(m_beats.begin(), m_beats.end(), beat, BeatLessThan);
-
-        // Count down until n=1
-        while (it != m_beats.end()) {
-            if (!it->enabled()) {
-                ++it;
-                continue;
-            }
-            if (n == 1) {
-                // Return a sample offset
-                return framesToSamples(it->frame_position());
-            }
-            ++it;
-            --n;
+        // The first beat at or after frame is the 1st beat.
+        index = findBeatIndex(frames, frame, false) + n - 1;
+    } else {
+        // The last beat at or before frame is the -1st beat.
+        index = findBeatIndex(frames, frame, true) + n;
+    }
+    if (index < 0 || index >= frames.size()) {
+        return -1;
+    }
+    // Return a sample offset
+    return framesToSamples(frames.at(index));
+}
+
+int BeatMap::findBeatIndex(const QVector<double>& frames, double frame,
+                           bool after) const {
+    const int size = frames.size();
+    int index = deref(m_iCursor);
+    for (int i = 0; i < 2; ++i, ++index) {
+        if (index < 0 || index > size) {
+            break;
         }
-    } else if (n < 0) {
-        BeatList::const_iterator it =
-                qUpperBound(m_beats.begin(), m_beats.end(), beat, BeatLessThan);
-
-
-        // Count up until n=-1
-        while (it != m_beats.begin()) {
-            // qUpperBound starts us off at the position just-one-past the last
-            // occurence of dSamples-or-smaller in the list. In order to get the
-            // last instance of dSamples-or-smaller, we decrement it by 1 before
-            // touching it. The guard of this while loop guarantees this does
-            // not put us before the start of the loop.
-            --it;
-            if (!it->enabled()) {
-                continue;
-            }
-            if (n == -1) {
-                // Return a Sample Offset
-                return framesToSamples(it->frame_position());
-            }
-            n++;
+        // The beat before index is not past frame and the beat at index is.
+        bool beforeOk = index == 0 || (after ? frames.at(index - 1) <= frame
+                                             : frames.at(index - 1) < frame);
+        bool atOk = index == size || (after ? frames.at(index) > frame
+                                            : frames.at(index) >= frame);
+        if (beforeOk && atOk) {
+            m_iCursor = index;
+            return index;
         }
     }
-    return -1;
+
+    QVector<double>::const_iterator it = after ?
+            qUpperBound(frames.constBegin(), frames.constEnd(), frame) :
+            qLowerBound(frames.constBegin(), frames.constEnd(), frame);
+    index = it - frames.constBegin();
+    m_iCursor = index;
+    return index;
 }
 
 BeatIterator* BeatMap::findBeats(double startSample, double stopSample) const {
-    QMutexLocker locker(&m_mutex);
+    SnapshotPointer pSnapshot = snapshot();
     //startSample and stopSample are sample offsets, converting them to
     //frames
-    if (!isValid() || startSample > stopSample) {
+    if (!pSnapshot->valid || startSample > stopSample) {
         return NULL;
     }
 
-    Beat startBeat, stopBeat;
-    startBeat.set_frame_position(samplesToFrames(startSample));
-    stopBeat.set_frame_position(samplesToFrames(stopSample));
-
-    BeatList::const_iterator curBeat =
-            qLowerBound(m_beats.begin(), m_beats.end(),
-                        startBeat, BeatLessThan);
-
-    BeatList::const_iterator lastBeat =
-            qUpperBound(m_beats.begin(), m_beats.end(),
-                        stopBeat, BeatLessThan);
+    const QVector<double>& frames = pSnapshot->frames;
+    int curBeat = findBeatIndex(frames, samplesToFrames(startSample), false);
+    int lastBeat = qUpperBound(frames.constBegin(), frames.constEnd(),
+                               samplesToFrames(stopSample)) -
+            frames.constBegin();
 
     if (curBeat >= lastBeat) {
         return NULL;
     }
-    return new BeatMapIterator(curBeat, lastBeat);
+    return new BeatMapIterator(frames, curBeat, lastBeat);
 }
 
 bool BeatMap::hasBeatInRange(double startSample, double stopSample) const {
-    QMutexLocker locker(&m_mutex);
-    if (!isValid() || startSample > stopSample) {
+    SnapshotPointer pSnapshot = snapshot();
+    if (!pSnapshot->valid || startSample > stopSample) {
         return false;
     }
-    double curBeat = findNextBeat(startSample);
+    double curBeat = findNthBeat(*pSnapshot, startSample, 1);
     if (curBeat <= stopSample) {
         return true;
     }
@@ -264,20 +255,18 @@ bool BeatMap::hasBeatInRange(double startSample, double stopSample) const {
 }
 
 double BeatMap::getBpm() const {
-    QMutexLocker locker(&m_mutex);
-    if (!isValid())
+    SnapshotPointer pSnapshot = snapshot();
+    if (!pSnapshot->valid)
         return -1;
-    return m_dCachedBpm;
+    return pSnapshot->bpm;
 }
 
 double BeatMap::getBpmRange(double startSample, double stopSample) const {
-    QMutexLocker locker(&m_mutex);
-    if (!isValid())
+    SnapshotPointer pSnapshot = snapshot();
+    if (!pSnapshot->valid)
         return -1;
-    Beat startBeat, stopBeat;
-    startBeat.set_frame_position(samplesToFrames(startSample));
-    stopBeat.set_frame_position(samplesToFrames(stopSample));
-    return calculateBpm(startBeat, stopBeat);
+    return calculateBpm(pSnapshot->frames, samplesToFrames(startSample),
+                        samplesToFrames(stopSample));
 }
 
 void BeatMap::addBeat(double dBeatSample) {
@@ -415,52 +404,54 @@ void BeatMap::setBpm(double dBpm) {
     QMutexLocker locker(&m_mutex);
 
     // Ignore sets of 0 since we can't scale by that.
-    if (!isValid() || dBpm <= 0.0)
+    SnapshotPointer pSnapshot = snapshot();
+    if (!pSnapshot->valid || dBpm <= 0.0)
         return;
 
     // This problem is so complicated that for now we are just going to bail and
     // scale the beatgrid exactly by the ratio indicated by the desired
     // BPM. This is a downside of using a BeatMap over a BeatGrid. rryan 4/2012
-    double ratio = m_dCachedBpm / dBpm;
+    double ratio = pSnapshot->bpm / dBpm;
     locker.unlock();
     scale(ratio);
 }
 
 void BeatMap::onBeatlistChanged() {
-    if (!isValid()) {
-        m_dLastFrame = 0;
-        m_dCachedBpm = 0;
-        return;
+    Snapshot* pSnapshot = new Snapshot();
+    pSnapshot->valid = isValid();
+    pSnapshot->frames.reserve(m_beats.size());
+    foreach (const Beat& beat, m_beats) {
+        if (beat.enabled()) {
+            pSnapshot->frames.append(beat.frame_position());
+        }
+    }
+    if (pSnapshot->valid) {
+        pSnapshot->bpm = calculateBpm(pSnapshot->frames,
+                                      m_beats.first().frame_position(),
+                                      m_beats.last().frame_position());
     }
-    m_dLastFrame = m_beats.last().frame_position();
-    Beat startBeat = m_beats.first();
-    Beat stopBeat =  m_beats.last();
-    m_dCachedBpm = calculateBpm(startBeat, stopBeat);
+    m_snapshot.setValue(SnapshotPointer(pSnapshot));
 }
 
-double BeatMap::calculateBpm(const Beat& startBeat, const Beat& stopBeat) const {
-    if (startBeat.frame_position() > stopBeat.frame_position()) {
+double BeatMap::calculateBpm(const QVector<double>& frames,
+                             double startFrame, double stopFrame) const {
+    if (startFrame > stopFrame) {
         return -1;
     }
 
-    BeatList::const_iterator curBeat =
-            qLowerBound(m_beats.begin(), m_beats.end(), startBeat, BeatLessThan);
+    QVector<double>::const_iterator curBeat =
+            qLowerBound(frames.constBegin(), frames.constEnd(), startFrame);
 
-    BeatList::const_iterator lastBeat =
-            qUpperBound(m_beats.begin(), m_beats.end(), stopBeat, BeatLessThan);
-
-    QVector<double> beatvect;
-    for (; curBeat != lastBeat; ++curBeat) {
-        const Beat& beat = *curBeat;
-        if (beat.enabled()) {
-            beatvect.append(beat.frame_position());
-        }
-    }
+    QVector<double>::const_iterator lastBeat =
+            qUpperBound(frames.constBegin(), frames.constEnd(), stopFrame);
 
-    if (beatvect.size() == 0) {
+    if (curBeat >= lastBeat) {
         return -1;
     }
 
+    QVector<double> beatvect;
+    for (; curBeat != lastBeat; ++curBeat) {
+        beatvect.append(*curBeat);
+    }
     return BeatUtils::calculateBpm(beatvect, m_iSampleRate, 0, 9999);
 }
-
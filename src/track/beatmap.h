@@ -8,9 +8,13 @@
 #ifndef BEATMAP_H_
 #define BEATMAP_H_
 
+#include <QAtomicInt>
 #include <QObject>
 #include <QMutex>
+#include <QSharedPointer>
+#include <QVector>
 
+#include "control/controlvalue.h"
 #include "trackinfoobject.h"
 #include "track/beats.h"
 #include "proto/beats.pb.h"
@@ -19,6 +23,9 @@
 
 typedef QList<mixxx::track::io::Beat> BeatList;
 
+// BeatMap stores the position of every beat. The queries read an immutable
+// snapshot of the enabled beats that the mutations replace, so the engine can
+// query the beats without locking while the GUI or the analyser edit them.
 class BeatMap : public QObject, public Beats {
     Q_OBJECT
   public:
@@ -69,22 +76,50 @@ class BeatMap : public QObject, public Beats {
     void updated();
 
   private:
+    // The state the queries read. Never changed once published.
+    struct Snapshot {
+        Snapshot()
+                : valid(false),
+                  bpm(0.0) {
+        }
+        bool valid;
+        double bpm;
+        // The frame positions of the enabled beats in ascending order.
+        QVector<double> frames;
+    };
+    typedef QSharedPointer<const Snapshot> SnapshotPointer;
+
     void initialize(TrackPointer pTrack);
     void readByteArray(const QByteArray* pByteArray);
     void createFromBeatVector(QVector<double> beats);
+    // Publishes a new snapshot of m_beats. Must be called with m_mutex locked
+    // or from the constructor.
     void onBeatlistChanged();
-
-    double calculateBpm(const mixxx::track::io::Beat& startBeat,
-                        const mixxx::track::io::Beat& stopBeat) const;
-    // For internal use only.
+    // For internal use only. Must be called with m_mutex locked.
     bool isValid() const;
 
+    SnapshotPointer snapshot() const {
+        return m_snapshot.getValue();
+    }
+    double findNthBeat(const Snapshot& snapshot, double dSamples, int n) const;
+    // Returns the index of the first beat in frames that lies after frame, or
+    // at or after frame if after is false. Tries the index the last lookup
+    // found and the one after it before searching, so that sequential lookups
+    // take constant time.
+    int findBeatIndex(const QVector<double>& frames, double frame,
+                      bool after) const;
+    double calculateBpm(const QVector<double>& frames,
+                        double startFrame, double stopFrame) const;
+
+    // Serializes the mutations. Queries don't lock it.
     mutable QMutex m_mutex;
     QString m_subVersion;
-    double m_dCachedBpm;
     int m_iSampleRate;
-    double m_dLastFrame;
     BeatList m_beats;
+    ControlValueAtomic<SnapshotPointer> m_snapshot;
+    // The result of the last findBeatIndex(). Only a hint, so it is fine if
+    // it belongs to an older snapshot or another thread.
+    mutable QAtomicInt m_iCursor;
 };
 
 #endif /* BEATMAP_H_ */
@@ -0,0 +1,102 @@
+#ifndef BLOCKINGQUEUE_H
+#define BLOCKINGQUEUE_H
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QQueue>
+#include <QWaitCondition>
+
+#include "util.h"
+
+// A bounded queue that connects producer and consumer threads. push() blocks
+// while the queue is full and pop() while it is empty. Once the queue is
+// closed, push() fails and pop() returns the remaining items and then fails,
+// which tells the consumers to stop.
+template <class DataType>
+class BlockingQueue {
+  public:
+    explicit BlockingQueue(int capacity)
+            : m_capacity(capacity),
+              m_bClosed(false) {
+    }
+    virtual ~BlockingQueue() {
+    }
+
+    // Appends data, waiting for room if the queue is full. Returns false if
+    // the queue is closed.
+    bool push(const DataType& data) {
+        QMutexLocker locker(&m_mutex);
+        while (!m_bClosed && m_queue.size() >= m_capacity) {
+            m_notFull.wait(&m_mutex);
+        }
+        if (m_bClosed) {
+            return false;
+        }
+        m_queue.enqueue(data);
+        m_notEmpty.wakeOne();
+        return true;
+    }
+
+    // Removes the first item into pData, waiting for one if the queue is
+    // empty. Returns false if the queue is closed and empty.
+    bool pop(DataType* pData) {
+        QMutexLocker locker(&m_mutex);
+        while (!m_bClosed && m_queue.isEmpty()) {
+            m_notEmpty.wait(&m_mutex);
+        }
+        return dequeue(pData);
+    }
+
+    // Like pop(), but returns false instead of waiting if the queue is empty.
+    bool tryPop(DataType* pData) {
+        QMutexLocker locker(&m_mutex);
+        return dequeue(pData);
+    }
+
+    // Wakes all waiting threads. Items that are already queued can still be
+    // popped.
+    void close() {
+        QMutexLocker locker(&m_mutex);
+        m_bClosed = true;
+        m_notEmpty.wakeAll();
+        m_notFull.wakeAll();
+    }
+
+    // Drops all queued items.
+    void clear() {
+        QMutexLocker locker(&m_mutex);
+        m_queue.clear();
+        m_notFull.wakeAll();
+    }
+
+    int size() const {
+        QMutexLocker locker(&m_mutex);
+        return m_queue.size();
+    }
+
+    int capacity() const {
+        return m_capacity;
+    }
+
+  private:
+    // Must be called with m_mutex locked.
+    bool dequeue(DataType* pData) {
+        if (m_queue.isEmpty()) {
+            return false;
+        }
+        *pData = m_queue.dequeue();
+        m_notFull.wakeOne();
+        return true;
+    }
+
+    const int m_capacity;
+    mutable QMutex m_mutex;
+    QWaitCondition m_notEmpty;
+    QWaitCondition m_notFull;
+    QQueue<DataType> m_queue;
+    bool m_bClosed;
+
+    DISALLOW_COPY_AND_ASSIGN(BlockingQueue);
+};
+
+#endif /* BLOCKINGQUEUE_H */
@@ -39,6 +39,9 @@ class CmdlineArgs {
             } else if (argv[i] == QString("--timelinePath") && i+1 < argc) {
                 m_timelinePath = QString::fromLocal8Bit(argv[i+1]);
                 i++;
+            } else if (argv[i] == QString("--chromeTracePath") && i+1 < argc) {
+                m_chromeTracePath = QString::fromLocal8Bit(argv[i+1]);
+                i++;
             } else if (QString::fromLocal8Bit(argv[i]).contains("--midiDebug", Qt::CaseInsensitive) ||
                        QString::fromLocal8Bit(argv[i]).contains("--controllerDebug", Qt::CaseInsensitive)) {
                 m_midiDebug = true;
@@ -60,6 +63,8 @@ class CmdlineArgs {
     const QString& getResourcePath() const { return m_resourcePath; }
     const QString& getPluginPath() const { return m_pluginPath; }
     const QString& getTimelinePath() const { return m_timelinePath; }
+    bool getChromeTraceEnabled() const { return !m_chromeTracePath.isEmpty(); }
+    const QString& getChromeTracePath() const { return m_chromeTracePath; }
 
   private:
     CmdlineArgs() :
@@ -79,6 +84,7 @@ class CmdlineArgs {
     QString m_resourcePath;
     QString m_pluginPath;
     QString m_timelinePath;
+    QString m_chromeTracePath;
 };
 
 #endif /* CMDLINEARGS_H */
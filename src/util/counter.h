@@ -3,13 +3,19 @@
 
 #include "util/stat.h"
 
+// Construct with a pre-registered StatKey to count without allocating. A
+// Counter constructed with a string while stats are disabled does not register
+// it and never reports.
 class Counter {
   public:
     Counter(const QString& tag)
-    : m_tag(tag) {
+    : m_key(Stat::isTracking() ? Stat::registerKey(tag) : StatKey()) {
+    }
+    Counter(StatKey key)
+    : m_key(key) {
     }
     void increment(int by=1) {
-        Stat::track(m_tag, Stat::COUNTER,
+        Stat::track(m_key, Stat::COUNTER,
                     Stat::COUNT | Stat::SUM | Stat::AVERAGE | Stat::SAMPLE_VARIANCE | Stat::MIN | Stat::MAX,
                     by);
     }
@@ -23,7 +29,7 @@ class Counter {
         return result;
     }
   private:
-    QString m_tag;
+    StatKey m_key;
 };
 
 #endif /* COUNTER_H */
@@ -29,6 +29,17 @@ class Event {
     static bool end(const QString& tag) {
         return event(tag, Stat::EVENT_END);
     }
+
+    // Allocation-free variants for pre-registered keys.
+    static bool event(StatKey key, Event::EventType type = Stat::EVENT) {
+        return Stat::track(key, type, Stat::COUNT, 0.0);
+    }
+    static bool start(StatKey key) {
+        return event(key, Stat::EVENT_START);
+    }
+    static bool end(StatKey key) {
+        return event(key, Stat::EVENT_END);
+    }
 };
 
 #endif /* EVENT_H */
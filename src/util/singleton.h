@@ -19,8 +19,10 @@ public:
 
     static void destroy()
     {
-        if( m_instance)
+        if( m_instance) {
             delete m_instance;
+            m_instance = 0;
+        }
     }
 
 protected:
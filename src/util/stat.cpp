@@ -1,12 +1,33 @@
 #include <limits>
 #include <cmath>
 
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QStringList>
 #include <QtDebug>
 
 #include "util/stat.h"
 #include "util/time.h"
 #include "util/statsmanager.h"
+#include "util/timelinerecorder.h"
+
+namespace {
+
+struct StatKeyRegistry {
+    QMutex mutex;
+    QHash<QString, int> ids;
+    QVector<QString> tags;
+};
+
+// Constructed on first use so that keys can be registered during static
+// initialization.
+StatKeyRegistry& statKeyRegistry() {
+    static StatKeyRegistry registry;
+    return registry;
+}
+
+} // anonymous namespace
 
 Stat::Stat()
         : m_type(UNSPECIFIED),
@@ -16,7 +37,9 @@ Stat::Stat()
           m_min(std::numeric_limits<double>::max()),
           m_max(std::numeric_limits<double>::min()),
           m_variance_mk(0),
-          m_variance_sk(0) {
+          m_variance_sk(0),
+          m_first_report_time(0),
+          m_last_report_time(0) {
 }
 
 QString Stat::valueUnits() const {
@@ -38,6 +61,10 @@ QString Stat::valueUnits() const {
 
 void Stat::processReport(const StatReport& report) {
     m_report_count++;
+    if (m_report_count == 1) {
+        m_first_report_time = report.time;
+    }
+    m_last_report_time = report.time;
     if (m_compute & (Stat::SUM | Stat::AVERAGE)) {
         m_sum += report.value;
     }
@@ -118,6 +145,10 @@ QDebug operator<<(QDebug dbg, const Stat &stat) {
         }
     }
 
+    if (stat.m_compute & Stat::REPORTS_PER_SECOND) {
+        stats << "rate=" + QString::number(stat.reportsPerSecond()) + "/s";
+    }
+
     if (stat.m_compute & Stat::SAMPLE_MEDIAN) {
         // TODO(rryan): implement
     }
@@ -136,19 +167,74 @@ QDebug operator<<(QDebug dbg, const Stat &stat) {
     return dbg.maybeSpace();
 }
 
+// static
+StatKey Stat::registerKey(const QString& tag) {
+    StatKeyRegistry& registry = statKeyRegistry();
+    QMutexLocker locker(&registry.mutex);
+    QHash<QString, int>::const_iterator it = registry.ids.find(tag);
+    if (it != registry.ids.end()) {
+        return StatKey(it.value());
+    }
+    const int id = registry.tags.size();
+    registry.tags.append(tag);
+    registry.ids.insert(tag, id);
+    return StatKey(id);
+}
+
+// static
+QString Stat::tagForKey(StatKey key) {
+    StatKeyRegistry& registry = statKeyRegistry();
+    QMutexLocker locker(&registry.mutex);
+    return registry.tags.value(key.id());
+}
+
 // static
 bool Stat::track(const QString& tag,
                  Stat::StatType type,
                  Stat::ComputeFlags compute,
                  double value) {
-    if (!StatsManager::s_bStatsManagerEnabled) {
+    if (!isTracking()) {
+        return false;
+    }
+    return track(registerKey(tag), type, compute, value);
+}
+
+// static
+bool Stat::isEnabled() {
+    return StatsManager::s_bStatsManagerEnabled;
+}
+
+// static
+bool Stat::isTracking() {
+    return StatsManager::s_bStatsManagerEnabled ||
+            TimelineRecorder::isRecording();
+}
+
+// static
+bool Stat::track(StatKey key,
+                 Stat::StatType type,
+                 Stat::ComputeFlags compute,
+                 double value) {
+    if (!key.isValid()) {
+        return false;
+    }
+    const bool recordTimeline = TimelineRecorder::isRecording() &&
+            (type == EVENT || type == EVENT_START || type == EVENT_END);
+    if (!StatsManager::s_bStatsManagerEnabled && !recordTimeline) {
         return false;
     }
+    const qint64 time = Time::elapsed();
+    if (recordTimeline) {
+        TimelineRecorder::record(key, type, time);
+    }
+    if (!StatsManager::s_bStatsManagerEnabled) {
+        return true;
+    }
     StatReport report;
-    report.tag = strdup(tag.toAscii().constData());
+    report.key = key;
     report.type = type;
     report.compute = compute;
-    report.time = Time::elapsed();
+    report.time = time;
     report.value = value;
     StatsManager* pManager = StatsManager::instance();
     return pManager && pManager->maybeWriteReport(report);
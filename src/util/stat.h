@@ -7,6 +7,29 @@
 
 struct StatReport;
 
+// A handle for a stat tag that has been registered with Stat::registerKey().
+// Reporting with a StatKey instead of a tag string does not allocate, so code
+// on the audio callback thread should register its keys up front and only
+// report with those.
+class StatKey {
+  public:
+    StatKey() : m_id(-1) {
+    }
+    bool isValid() const {
+        return m_id >= 0;
+    }
+    int id() const {
+        return m_id;
+    }
+
+  private:
+    explicit StatKey(int id) : m_id(id) {
+    }
+    int m_id;
+
+    friend class Stat;
+};
+
 class Stat {
   public:
     enum StatType {
@@ -64,7 +87,7 @@ class Stat {
         // O(1) in time, O(n) in space where n is the # of reports.
         // Use carefully!
         VALUES          = 0x0100,
-        // TODO, track average reports per second
+        // Average reports per second between the first and the last report.
         REPORTS_PER_SECOND = 0x0200,
         // TODO, track the time in between received reports.
         REPORT_TIME_DELTA = 0x0400,
@@ -79,6 +102,11 @@ class Stat {
         return m_report_count > 1 ? m_variance_sk / (m_report_count - 1) : 0.0;
     }
 
+    double reportsPerSecond() const {
+        const qint64 elapsed = m_last_report_time - m_first_report_time;
+        return elapsed > 0 ? (m_report_count - 1) * 1e9 / elapsed : 0.0;
+    }
+
     QString m_tag;
     StatType m_type;
     ComputeFlags m_compute;
@@ -89,8 +117,31 @@ class Stat {
     double m_max;
     double m_variance_mk;
     double m_variance_sk;
+    qint64 m_first_report_time;
+    qint64 m_last_report_time;
     QMap<double, double> m_histogram;
 
+    // Interns tag and returns its key. Registering the same tag twice returns
+    // the same key. Thread-safe, but takes a lock and may allocate.
+    static StatKey registerKey(const QString& tag);
+    // Returns the tag key was registered with.
+    static QString tagForKey(StatKey key);
+
+    // Returns true if reports are collected. Realtime-safe, so callers can
+    // skip measuring what would only be reported.
+    static bool isEnabled();
+    // Returns true if reports are collected or events are recorded to the
+    // timeline. Realtime-safe. The string-keyed conveniences check this
+    // before they register their tag, which takes a lock.
+    static bool isTracking();
+
+    // Realtime-safe: pushes a fixed-size report into the calling thread's
+    // StatsPipe without allocating.
+    static bool track(StatKey key,
+                      Stat::StatType type,
+                      Stat::ComputeFlags compute,
+                      double value);
+    // Convenience for non-realtime code. Registers tag on every call.
     static bool track(const QString& tag,
                       Stat::StatType type,
                       Stat::ComputeFlags compute,
@@ -100,7 +151,7 @@ class Stat {
 QDebug operator<<(QDebug dbg, const Stat &stat);
 
 struct StatReport {
-    char* tag;
+    StatKey key;
     qint64 time;
     Stat::StatType type;
     Stat::ComputeFlags compute;
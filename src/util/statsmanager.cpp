@@ -170,7 +170,7 @@ void StatsManager::processIncomingStatReports() {
     StatReport report;
     foreach (StatsPipe* pStatsPipe, m_statsPipes) {
         while (pStatsPipe->read(&report, 1) == 1) {
-            QString tag = QString::fromUtf8(report.tag);
+            QString tag = Stat::tagForKey(report.key);
             Stat& info = m_stats[tag];
             info.m_tag = tag;
             info.m_type = report.type;
@@ -187,7 +187,6 @@ void StatsManager::processIncomingStatReports() {
                 event.m_time = report.time;
                 m_events.append(event);
             }
-            free(report.tag);
         }
     }
 }
@@ -0,0 +1,260 @@
+#include <QFile>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadStorage>
+#include <QVector>
+#include <QtDebug>
+
+#include "util/timelinerecorder.h"
+#include "util/compatibility.h"
+
+namespace {
+
+const uint kIndexMask = TimelineRecorder::kEventsPerThread - 1;
+
+struct TimelineEvent {
+    qint64 time;
+    StatKey key;
+    Stat::StatType type;
+};
+
+// A single-writer ring of the most recent events of one thread. The owning
+// thread writes without locking; writeChromeTrace() copies it from another
+// thread and discards any events that were overwritten while copying.
+class TimelineRing {
+  public:
+    TimelineRing()
+            : m_id(-1),
+              m_events(TimelineRecorder::kEventsPerThread),
+              m_iWritten(0) {
+    }
+
+    // Hands the ring to the current thread. Called with s_ringsMutex held,
+    // before the thread writes to it. Threads name themselves when they start,
+    // before their first event, so the name is looked up only here.
+    void takeOver(int id) {
+        m_id = id;
+        m_iWritten.fetchAndStoreRelease(0);
+        m_name = QThread::currentThread()->objectName();
+        if (m_name.isEmpty()) {
+            m_name = QString("Thread %1").arg(m_id);
+        }
+    }
+
+    int id() const {
+        return m_id;
+    }
+
+    // Called with s_ringsMutex held.
+    const QString& name() const {
+        return m_name;
+    }
+
+    // Owning thread only.
+    void write(StatKey key, Stat::StatType type, qint64 time) {
+        // The count is used as unsigned so that it wraps around cleanly
+        // during very long sessions.
+        const uint written = static_cast<uint>(deref(m_iWritten));
+        TimelineEvent& event = m_events[written & kIndexMask];
+        event.time = time;
+        event.key = key;
+        event.type = type;
+        m_iWritten.fetchAndStoreRelease(static_cast<int>(written + 1));
+    }
+
+    // Any thread. Appends the events still in the ring, oldest first.
+    void snapshot(QVector<TimelineEvent>* pEvents) const {
+        const uint capacity = TimelineRecorder::kEventsPerThread;
+        const uint end = static_cast<uint>(m_iWritten.fetchAndAddAcquire(0));
+        const uint count = qMin(end, capacity);
+        QVector<TimelineEvent> events;
+        events.reserve(count);
+        for (uint i = end - count; i != end; ++i) {
+            events.append(m_events[i & kIndexMask]);
+        }
+        // The writer may have lapped the oldest events while we were copying.
+        // Event i is overwritten by event i + capacity, which is in progress
+        // once the count has reached i + capacity.
+        const uint endAfter =
+                static_cast<uint>(m_iWritten.fetchAndAddAcquire(0));
+        const uint reach = count + (endAfter - end) + 1;
+        const uint overwritten = reach > capacity ?
+                qMin(count, reach - capacity) : 0;
+        for (uint i = overwritten; i < count; ++i) {
+            pEvents->append(events[i]);
+        }
+    }
+
+  private:
+    int m_id;
+    QVector<TimelineEvent> m_events;
+    mutable QAtomicInt m_iWritten;
+    QString m_name;
+};
+
+QMutex s_ringsMutex;
+// Every ring ever allocated, in use or not.
+QList<TimelineRing*> s_rings;
+// The preallocated rings no thread has taken yet.
+QList<TimelineRing*> s_unusedRings;
+// The rings of threads that have exited. Their events are exported until a
+// new thread takes the ring over.
+QList<TimelineRing*> s_freeRings;
+int s_iNextRingId = 0;
+
+// QThreadStorage deletes its data when the thread exits. The handle then
+// hands the ring back so that threads that come and go don't leave a ring
+// behind each.
+struct TimelineRingHandle {
+    explicit TimelineRingHandle(TimelineRing* pRing)
+            : pRing(pRing) {
+    }
+    ~TimelineRingHandle() {
+        QMutexLocker locker(&s_ringsMutex);
+        s_freeRings.append(pRing);
+    }
+    TimelineRing* const pRing;
+};
+
+QThreadStorage<TimelineRingHandle*> s_threadRings;
+
+TimelineRing* ringForCurrentThread() {
+    if (s_threadRings.hasLocalData()) {
+        return s_threadRings.localData()->pRing;
+    }
+    QMutexLocker locker(&s_ringsMutex);
+    TimelineRing* pRing;
+    // Keep the events of exited threads as long as there are unused rings.
+    if (!s_unusedRings.isEmpty()) {
+        pRing = s_unusedRings.takeFirst();
+    } else if (!s_freeRings.isEmpty()) {
+        pRing = s_freeRings.takeFirst();
+    } else {
+        // More threads record than were expected.
+        pRing = new TimelineRing();
+        s_rings.append(pRing);
+    }
+    pRing->takeOver(s_iNextRingId++);
+    s_threadRings.setLocalData(new TimelineRingHandle(pRing));
+    return pRing;
+}
+
+void preallocateRings() {
+    QMutexLocker locker(&s_ringsMutex);
+    while (s_rings.size() < TimelineRecorder::kPreallocatedRings) {
+        TimelineRing* pRing = new TimelineRing();
+        s_rings.append(pRing);
+        s_unusedRings.append(pRing);
+    }
+}
+
+// The events of one ring as writeChromeTrace() exports them.
+struct TimelineTrack {
+    int id;
+    QString name;
+    QVector<TimelineEvent> events;
+};
+
+QString jsonString(const QString& string) {
+    QString escaped = string;
+    escaped.replace("\\", "\\\\");
+    escaped.replace("\"", "\\\"");
+    return QString("\"%1\"").arg(escaped);
+}
+
+} // anonymous namespace
+
+// static
+QAtomicInt TimelineRecorder::s_recording(0);
+
+// static
+void TimelineRecorder::setRecording(bool recording) {
+    if (recording) {
+        preallocateRings();
+    }
+    s_recording.fetchAndStoreOrdered(recording ? 1 : 0);
+}
+
+// static
+bool TimelineRecorder::isRecording() {
+    return deref(s_recording) != 0;
+}
+
+// static
+void TimelineRecorder::record(StatKey key, Stat::StatType type, qint64 time) {
+    ringForCurrentThread()->write(key, type, time);
+}
+
+// static
+int TimelineRecorder::threadRingCount() {
+    QMutexLocker locker(&s_ringsMutex);
+    return s_rings.size();
+}
+
+// static
+bool TimelineRecorder::writeChromeTrace(const QString& filename) {
+    // Copy the rings while no ring can be handed to a new thread.
+    QList<TimelineTrack> tracks;
+    {
+        QMutexLocker locker(&s_ringsMutex);
+        foreach (TimelineRing* pRing, s_rings) {
+            if (s_unusedRings.contains(pRing)) {
+                continue;
+            }
+            TimelineTrack track;
+            track.id = pRing->id();
+            track.name = pRing->name();
+            pRing->snapshot(&track.events);
+            tracks.append(track);
+        }
+    }
+
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        qWarning() << "Could not open timeline file for writing:" << filename;
+        return false;
+    }
+
+    QTextStream out(&file);
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    foreach (const TimelineTrack& track, tracks) {
+        out << (first ? "\n" : ",\n")
+            << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+            << track.id << ",\"args\":{\"name\":"
+            << jsonString(track.name) << "}}";
+        first = false;
+
+        // The ring may start in the middle of a trace. Skip end events
+        // without a matching begin so that the viewer doesn't complain.
+        int depth = 0;
+        foreach (const TimelineEvent& event, track.events) {
+            const char* phase = "i";
+            if (event.type == Stat::EVENT_START) {
+                phase = "B";
+                ++depth;
+            } else if (event.type == Stat::EVENT_END) {
+                if (depth == 0) {
+                    continue;
+                }
+                phase = "E";
+                --depth;
+            }
+            out << ",\n{\"name\":" << jsonString(Stat::tagForKey(event.key))
+                << ",\"ph\":\"" << phase << "\""
+                << ",\"ts\":" << QString::number(event.time / 1000.0, 'f', 3)
+                << ",\"pid\":1,\"tid\":" << track.id;
+            if (event.type == Stat::EVENT) {
+                out << ",\"s\":\"t\"";
+            }
+            out << "}";
+        }
+    }
+    out << "\n]}\n";
+    file.close();
+    qDebug() << "Wrote timeline to" << filename;
+    return true;
+}
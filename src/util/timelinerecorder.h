@@ -0,0 +1,52 @@
+#ifndef TIMELINERECORDER_H
+#define TIMELINERECORDER_H
+
+#include <QAtomicInt>
+#include <QString>
+
+#include "util/stat.h"
+
+// TimelineRecorder keeps the most recent Event start/end/instant reports of
+// every thread in a bounded per-thread ring so that the timeline leading up
+// to an xrun can be exported after the fact. Recording is cheap enough to be
+// left on during a live set: record() does not lock or allocate (apart from
+// taking a ring the first time a thread records an event) and old events are
+// overwritten once a thread's ring is full.
+//
+// The rings of the threads Mixxx always runs, including the engine callback,
+// are allocated when recording is switched on, so that the first event of a
+// thread only takes a ring from the pool. A thread's ring is handed back when
+// the thread exits and taken over by the next thread that records an event,
+// so memory use is bounded by the number of threads that record at the same
+// time. Until then the events of the exited thread are still exported.
+//
+// The rings are exported in the Chrome Trace Event format, which can be
+// loaded in chrome://tracing or https://ui.perfetto.dev. Every thread gets its
+// own track named after the QThread objectName it had when it took its ring.
+class TimelineRecorder {
+  public:
+    // Number of events kept per thread.
+    static const int kEventsPerThread = 1 << 16;
+    // Number of rings allocated when recording is switched on: the main,
+    // engine, side chain, analyser, controller and caching reader threads.
+    static const int kPreallocatedRings = 8;
+
+    static void setRecording(bool recording);
+    static bool isRecording();
+
+    // Called by Stat::track for event reports.
+    static void record(StatKey key, Stat::StatType type, qint64 time);
+
+    // Writes the recorded events of all threads to filename as Chrome Trace
+    // Event JSON. Safe to call while other threads keep recording. Returns
+    // false if the file could not be written.
+    static bool writeChromeTrace(const QString& filename);
+
+    // The number of rings allocated so far. Only used by tests.
+    static int threadRingCount();
+
+  private:
+    static QAtomicInt s_recording;
+};
+
+#endif /* TIMELINERECORDER_H */
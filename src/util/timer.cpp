@@ -1,6 +1,12 @@
 #include "util/timer.h"
 
 Timer::Timer(const QString& key, Stat::ComputeFlags compute)
+        : m_key(Stat::isTracking() ? Stat::registerKey(key) : StatKey()),
+          m_compute(compute),
+          m_running(false) {
+}
+
+Timer::Timer(StatKey key, Stat::ComputeFlags compute)
         : m_key(key),
           m_compute(compute),
           m_running(false) {
@@ -39,6 +45,12 @@ SuspendableTimer::SuspendableTimer(const QString& key,
           m_leapTime(0) {
 }
 
+SuspendableTimer::SuspendableTimer(StatKey key,
+                                   Stat::ComputeFlags compute)
+        : Timer(key, compute),
+          m_leapTime(0) {
+}
+
 void SuspendableTimer::start() {
     m_leapTime = 0;
     Timer::start();
@@ -9,11 +9,15 @@ const Stat::ComputeFlags kDefaultComputeFlags = Stat::COUNT | Stat::SUM | Stat::
 
 // A Timer that is instrumented for reporting elapsed times to StatsManager
 // under a certain key. Construct with custom compute flags to get custom values
-// computed for the times.
+// computed for the times. Construct with a pre-registered StatKey to report
+// without allocating. A Timer constructed with a string while stats are
+// disabled does not register it and never reports.
 class Timer {
   public:
     Timer(const QString& key,
           Stat::ComputeFlags compute = kDefaultComputeFlags);
+    Timer(StatKey key,
+          Stat::ComputeFlags compute = kDefaultComputeFlags);
     void start();
 
     // Restart the timer returning the nanoseconds since it was last
@@ -26,7 +30,7 @@ class Timer {
     int elapsed(bool report);
 
   protected:
-    QString m_key;
+    StatKey m_key;
     Stat::ComputeFlags m_compute;
     bool m_running;
     PerformanceTimer m_time;
@@ -36,6 +40,8 @@ class SuspendableTimer : public Timer {
   public:
     SuspendableTimer(const QString& key,
             Stat::ComputeFlags compute = kDefaultComputeFlags);
+    SuspendableTimer(StatKey key,
+            Stat::ComputeFlags compute = kDefaultComputeFlags);
     void start();
     int suspend();
     void go();
@@ -50,8 +56,19 @@ class ScopedTimer : public Timer {
     ScopedTimer(const QString& key,
                 Stat::ComputeFlags compute = kDefaultComputeFlags)
             : Timer(key, compute),
-              m_cancel(false) {
-        start();
+              m_cancel(!Stat::isEnabled()) {
+        if (!m_cancel) {
+            start();
+        }
+    }
+    // Does not time anything while stats are disabled.
+    ScopedTimer(StatKey key,
+                Stat::ComputeFlags compute = kDefaultComputeFlags)
+            : Timer(key, compute),
+              m_cancel(!Stat::isEnabled()) {
+        if (!m_cancel) {
+            start();
+        }
     }
     virtual ~ScopedTimer() {
         if (!m_cancel) {
@@ -9,34 +9,50 @@
 #include "util/event.h"
 #include "util/performancetimer.h"
 
+// The pre-registered stat keys of a Trace. Construct it once, outside of the
+// audio callback, and pass it to Trace to trace without allocating.
+struct TraceKey {
+    TraceKey() {
+    }
+    explicit TraceKey(const QString& tag)
+            : event(Stat::registerKey(tag)),
+              duration(Stat::registerKey(tag + "_duration")) {
+    }
+    StatKey event;
+    StatKey duration;
+};
+
 class Trace {
   public:
+    explicit Trace(const TraceKey& key, bool writeToStdout=false, bool time=true)
+            : m_key(key),
+              m_writeToStdout(writeToStdout),
+              m_time(time) {
+        start();
+    }
+    // Only registers tag if it is tracked or written out.
     explicit Trace(const QString& tag, bool writeToStdout=false, bool time=true)
-            : m_tag(tag),
+            : m_key(writeToStdout || Stat::isTracking() ? TraceKey(tag)
+                                                         : TraceKey()),
               m_writeToStdout(writeToStdout),
               m_time(time) {
-        Event::start(m_tag);
-        if (m_time) {
-            m_timer.start();
-        }
-        if (m_writeToStdout) {
-            qDebug() << "START [" << m_tag << "]";
-        }
+        start();
     }
     virtual ~Trace() {
-        Event::end(m_tag);
+        Event::end(m_key.event);
         qint64 elapsed = m_time ? m_timer.elapsed() : 0;
         if (m_writeToStdout) {
+            const QString tag = Stat::tagForKey(m_key.event);
             if (m_time) {
-                qDebug() << "END [" << m_tag << "]"
+                qDebug() << "END [" << tag << "]"
                          << QString("elapsed: %1ns").arg(elapsed);
             } else {
-                qDebug() << "END [" << m_tag << "]";
+                qDebug() << "END [" << tag << "]";
             }
         }
         if (m_time) {
             Stat::track(
-                m_tag + "_duration",
+                m_key.duration,
                 Stat::DURATION_NANOSEC,
                 Stat::COUNT | Stat::AVERAGE | Stat::SAMPLE_VARIANCE | Stat::MAX | Stat::MIN,
                 elapsed);
@@ -44,7 +60,17 @@ class Trace {
     }
 
   private:
-    const QString m_tag;
+    void start() {
+        Event::start(m_key.event);
+        if (m_time) {
+            m_timer.start();
+        }
+        if (m_writeToStdout) {
+            qDebug() << "START [" << Stat::tagForKey(m_key.event) << "]";
+        }
+    }
+
+    const TraceKey m_key;
     const bool m_writeToStdout, m_time;
     PerformanceTimer m_timer;
 
@@ -24,7 +24,9 @@ VinylControlProcessor::VinylControlProcessor(QObject* pParent, ConfigObject<Conf
           m_signalQualityFifo(SIGNAL_QUALITY_FIFO_SIZE),
           m_bReportSignalQuality(false),
           m_bQuit(false),
-          m_bReloadConfig(false) {
+          m_bReloadConfig(false),
+          m_receiveBufferTimerKey(Stat::registerKey(
+                  "VinylControlProcessor::receiveBuffer")) {
     connect(m_pToggle, SIGNAL(valueChanged(double)),
             this, SLOT(toggleDeck(double)),
             Qt::DirectConnection);
@@ -203,7 +205,7 @@ void VinylControlProcessor::onInputUnconfigured(AudioInput input) {
 void VinylControlProcessor::receiveBuffer(AudioInput input,
                                           const CSAMPLE* pBuffer,
                                           unsigned int nFrames) {
-    ScopedTimer t("VinylControlProcessor::receiveBuffer");
+    ScopedTimer t(m_receiveBufferTimerKey);
     if (input.getType() != AudioInput::VINYLCONTROL) {
         qDebug() << "WARNING: AudioInput type is not VINYLCONTROL. Ignoring incoming buffer.";
         return;
@@ -9,6 +9,7 @@
 
 #include "configobject.h"
 #include "util/fifo.h"
+#include "util/stat.h"
 #include "vinylcontrol/vinylsignalquality.h"
 #include "soundmanagerutil.h"
 
@@ -71,6 +72,7 @@ class VinylControlProcessor : public QThread, public AudioDestination {
     volatile bool m_bReportSignalQuality;
     volatile bool m_bQuit;
     volatile bool m_bReloadConfig;
+    StatKey m_receiveBufferTimerKey;
 };
 
 
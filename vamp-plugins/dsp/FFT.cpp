@@ -4,7 +4,8 @@
     QM DSP Library
 
     Centre for Digital Music, Queen Mary, University of London.
-    This file is based on Don Cross's public domain FFT implementation.
+    The legacy backend is based on Don Cross's public domain FFT
+    implementation.
 */
 
 #include "FFT.h"
@@ -18,44 +19,7 @@
 #endif
 
 #include <iostream>
-
-FFT::FFT(unsigned int n) :
-    m_n(n),
-    m_private(0)
-{
-    if( !MathUtilities::isPowerOfTwo(m_n) )
-    {
-        std::cerr << "ERROR: FFT: Non-power-of-two FFT size "
-                  << m_n << " not supported in this implementation"
-                  << std::endl;
-	return;
-    }
-}
-
-FFT::~FFT()
-{
-
-}
-
-FFTReal::FFTReal(unsigned int n) :
-    m_n(n),
-    m_private(0)
-{
-    m_private = new FFT(m_n);
-}
-
-FFTReal::~FFTReal()
-{
-    delete (FFT *)m_private;
-}
-
-void
-FFTReal::process(bool inverse,
-                 const double *realIn,
-                 double *realOut, double *imagOut)
-{
-    ((FFT *)m_private)->process(inverse, realIn, 0, realOut, imagOut);
-}
+#include <vector>
 
 static unsigned int numberOfBitsNeeded(unsigned int p_nSamples)
 {	
@@ -85,14 +49,13 @@ static unsigned int reverseBits(unsigned int p_nIndex, unsigned int p_nBits)
     return rev;
 }
 
-void
-FFT::process(bool p_bInverseTransform,
-             const double *p_lpRealIn, const double *p_lpImagIn,
-             double *p_lpRealOut, double *p_lpImagOut)
+// Don Cross's FFT, which computes the bit reversal and the twiddle factors on
+// every call.
+static void
+legacyProcess(unsigned int nsamples, bool p_bInverseTransform,
+              const double *p_lpRealIn, const double *p_lpImagIn,
+              double *p_lpRealOut, double *p_lpImagOut)
 {
-    if (!p_lpRealIn || !p_lpRealOut || !p_lpImagOut) return;
-
-//    std::cerr << "FFT::process(" << m_n << "," << p_bInverseTransform << ")" << std::endl;
 
     unsigned int NumBits;
     unsigned int i, j, k, n;
@@ -101,20 +64,12 @@ FFT::process(bool p_bInverseTransform,
     double angle_numerator = 2.0 * M_PI;
     double tr, ti;
 
-    if( !MathUtilities::isPowerOfTwo(m_n) )
-    {
-        std::cerr << "ERROR: FFT::process: Non-power-of-two FFT size "
-                  << m_n << " not supported in this implementation"
-                  << std::endl;
-	return;
-    }
-
     if( p_bInverseTransform ) angle_numerator = -angle_numerator;
 
-    NumBits = numberOfBitsNeeded ( m_n );
+    NumBits = numberOfBitsNeeded ( nsamples );
 
 
-    for( i=0; i < m_n; i++ )
+    for( i=0; i < nsamples; i++ )
     {
 	j = reverseBits ( i, NumBits );
 	p_lpRealOut[j] = p_lpRealIn[i];
@@ -123,7 +78,7 @@ FFT::process(bool p_bInverseTransform,
 
 
     BlockEnd = 1;
-    for( BlockSize = 2; BlockSize <= m_n; BlockSize <<= 1 )
+    for( BlockSize = 2; BlockSize <= nsamples; BlockSize <<= 1 )
     {
 	double delta_angle = angle_numerator / (double)BlockSize;
 	double sm2 = -sin ( -2 * delta_angle );
@@ -133,7 +88,7 @@ FFT::process(bool p_bInverseTransform,
 	double w = 2 * cm1;
 	double ar[3], ai[3];
 
-	for( i=0; i < m_n; i += BlockSize )
+	for( i=0; i < nsamples; i += BlockSize )
 	{
 
 	    ar[2] = cm2;
@@ -173,9 +128,9 @@ FFT::process(bool p_bInverseTransform,
 
     if( p_bInverseTransform )
     {
-	double denom = (double)m_n;
+	double denom = (double)nsamples;
 
-	for ( i=0; i < m_n; i++ )
+	for ( i=0; i < nsamples; i++ )
 	{
 	    p_lpRealOut[i] /= denom;
 	    p_lpImagOut[i] /= denom;
@@ -183,3 +138,271 @@ FFT::process(bool p_bInverseTransform,
     }
 }
 
+
+// A complex radix-2 FFT with a precomputed bit reversal table and twiddle
+// factors.
+class FastFFT
+{
+public:
+    FastFFT(unsigned int n) :
+        m_n(n),
+        m_bitReversed(n),
+        m_cos(n / 2),
+        m_sin(n / 2)
+    {
+        unsigned int bits = numberOfBitsNeeded(n);
+        for (unsigned int i = 0; i < n; ++i) {
+            m_bitReversed[i] = reverseBits(i, bits);
+        }
+        for (unsigned int i = 0; i < n / 2; ++i) {
+            m_cos[i] = cos(2.0 * M_PI * i / n);
+            m_sin[i] = sin(2.0 * M_PI * i / n);
+        }
+    }
+
+    unsigned int size() const { return m_n; }
+
+    // Stores the input into the output arrays in bit reversed order.
+    // imagIn may be 0. stride is the distance between the input values.
+    void permute(const double *realIn, const double *imagIn,
+                 unsigned int stride,
+                 double *realOut, double *imagOut) const
+    {
+        for (unsigned int i = 0; i < m_n; ++i) {
+            unsigned int j = m_bitReversed[i];
+            realOut[j] = realIn[i * stride];
+            imagOut[j] = imagIn ? imagIn[i * stride] : 0.0;
+        }
+    }
+
+    // Transforms the permuted data in place.
+    void butterflies(bool inverse, double *re, double *im) const
+    {
+        // The first pass has no non-trivial twiddle factors.
+        for (unsigned int i = 0; i + 1 < m_n; i += 2) {
+            double tr = re[i + 1];
+            double ti = im[i + 1];
+            re[i + 1] = re[i] - tr;
+            im[i + 1] = im[i] - ti;
+            re[i] += tr;
+            im[i] += ti;
+        }
+
+        const double sign = inverse ? 1.0 : -1.0;
+        for (unsigned int blockSize = 4; blockSize <= m_n; blockSize <<= 1) {
+            const unsigned int half = blockSize / 2;
+            const unsigned int step = m_n / blockSize;
+            for (unsigned int k = 0; k < half; ++k) {
+                const double wr = m_cos[k * step];
+                const double wi = sign * m_sin[k * step];
+                for (unsigned int j = k; j < m_n; j += blockSize) {
+                    const unsigned int l = j + half;
+                    double tr = wr * re[l] - wi * im[l];
+                    double ti = wr * im[l] + wi * re[l];
+                    re[l] = re[j] - tr;
+                    im[l] = im[j] - ti;
+                    re[j] += tr;
+                    im[j] += ti;
+                }
+            }
+        }
+
+        if (inverse) {
+            const double scale = 1.0 / m_n;
+            for (unsigned int i = 0; i < m_n; ++i) {
+                re[i] *= scale;
+                im[i] *= scale;
+            }
+        }
+    }
+
+private:
+    unsigned int m_n;
+    std::vector<unsigned int> m_bitReversed;
+    // cos and sin of 2 pi i / n for i < n / 2.
+    std::vector<double> m_cos;
+    std::vector<double> m_sin;
+};
+
+// Transforms n real values with a complex FFT of n / 2 values: the even
+// values are the real parts, the odd ones the imaginary parts, and the
+// spectrum of the real input is split out of the result.
+class FastFFTReal
+{
+public:
+    FastFFTReal(unsigned int n) :
+        m_n(n),
+        m_half(n / 2),
+        m_cos(n / 2 + 1),
+        m_sin(n / 2 + 1),
+        m_re(n / 2),
+        m_im(n / 2)
+    {
+        for (unsigned int k = 0; k <= n / 2; ++k) {
+            m_cos[k] = cos(2.0 * M_PI * k / n);
+            m_sin[k] = sin(2.0 * M_PI * k / n);
+        }
+    }
+
+    void forward(const double *realIn, double *realOut, double *imagOut)
+    {
+        const unsigned int h = m_n / 2;
+        double *re = &m_re[0];
+        double *im = &m_im[0];
+        m_half.permute(realIn, realIn + 1, 2, re, im);
+        m_half.butterflies(false, re, im);
+
+        // X[k] = E[k] + W^k O[k] with E[k] = (Z[k] + conj(Z[h - k])) / 2
+        // and O[k] = (Z[k] - conj(Z[h - k])) / 2i, where Z[h] = Z[0].
+        for (unsigned int k = 0; k <= h; ++k) {
+            const unsigned int a = (k == h) ? 0 : k;
+            const unsigned int b = (k == 0) ? 0 : h - k;
+            const double er = (re[a] + re[b]) * 0.5;
+            const double ei = (im[a] - im[b]) * 0.5;
+            const double or_ = (im[a] + im[b]) * 0.5;
+            const double oi = (re[b] - re[a]) * 0.5;
+            realOut[k] = er + m_cos[k] * or_ + m_sin[k] * oi;
+            imagOut[k] = ei + m_cos[k] * oi - m_sin[k] * or_;
+        }
+        for (unsigned int k = h + 1; k < m_n; ++k) {
+            realOut[k] = realOut[m_n - k];
+            imagOut[k] = -imagOut[m_n - k];
+        }
+    }
+
+private:
+    unsigned int m_n;
+    FastFFT m_half;
+    // cos and sin of 2 pi k / n for k <= n / 2.
+    std::vector<double> m_cos;
+    std::vector<double> m_sin;
+    // The spectrum of the complex FFT.
+    std::vector<double> m_re;
+    std::vector<double> m_im;
+};
+
+#ifdef QM_DSP_LEGACY_FFT
+static FFTBackend s_defaultBackend = FFTBackendLegacy;
+#else
+static FFTBackend s_defaultBackend = FFTBackendFast;
+#endif
+
+FFTBackend
+FFT::defaultBackend()
+{
+    return s_defaultBackend;
+}
+
+void
+FFT::setDefaultBackend(FFTBackend backend)
+{
+    s_defaultBackend = backend;
+}
+
+FFT::FFT(unsigned int n) :
+    m_n(n),
+    m_backend(s_defaultBackend),
+    m_private(0)
+{
+    initialise();
+}
+
+FFT::FFT(unsigned int n, FFTBackend backend) :
+    m_n(n),
+    m_backend(backend),
+    m_private(0)
+{
+    initialise();
+}
+
+void
+FFT::initialise()
+{
+    if( !MathUtilities::isPowerOfTwo(m_n) )
+    {
+        std::cerr << "ERROR: FFT: Non-power-of-two FFT size "
+                  << m_n << " not supported in this implementation"
+                  << std::endl;
+	return;
+    }
+    if (m_backend == FFTBackendFast) {
+        m_private = new FastFFT(m_n);
+    }
+}
+
+FFT::~FFT()
+{
+    delete (FastFFT *)m_private;
+}
+
+void
+FFT::process(bool inverse,
+             const double *realIn, const double *imagIn,
+             double *realOut, double *imagOut)
+{
+    if (!realIn || !realOut || !imagOut) return;
+
+    if( !MathUtilities::isPowerOfTwo(m_n) )
+    {
+        std::cerr << "ERROR: FFT::process: Non-power-of-two FFT size "
+                  << m_n << " not supported in this implementation"
+                  << std::endl;
+	return;
+    }
+
+    if (m_backend == FFTBackendFast) {
+        FastFFT *fft = (FastFFT *)m_private;
+        fft->permute(realIn, imagIn, 1, realOut, imagOut);
+        fft->butterflies(inverse, realOut, imagOut);
+    } else {
+        legacyProcess(m_n, inverse, realIn, imagIn, realOut, imagOut);
+    }
+}
+
+FFTReal::FFTReal(unsigned int n) :
+    m_n(n),
+    m_backend(FFT::defaultBackend()),
+    m_private(0),
+    m_complex(0)
+{
+    initialise();
+}
+
+FFTReal::FFTReal(unsigned int n, FFTBackend backend) :
+    m_n(n),
+    m_backend(backend),
+    m_private(0),
+    m_complex(0)
+{
+    initialise();
+}
+
+void
+FFTReal::initialise()
+{
+    // The fast real FFT needs at least two values to split into a complex
+    // one. Inverse transforms always use the complex FFT.
+    if (m_backend == FFTBackendFast && m_n >= 2 &&
+        MathUtilities::isPowerOfTwo(m_n)) {
+        m_private = new FastFFTReal(m_n);
+    }
+    m_complex = new FFT(m_n, m_backend);
+}
+
+FFTReal::~FFTReal()
+{
+    delete (FastFFTReal *)m_private;
+    delete m_complex;
+}
+
+void
+FFTReal::process(bool inverse,
+                 const double *realIn,
+                 double *realOut, double *imagOut)
+{
+    if (m_private && !inverse && realIn && realOut && imagOut) {
+        ((FastFFTReal *)m_private)->forward(realIn, realOut, imagOut);
+    } else {
+        m_complex->process(inverse, realIn, 0, realOut, imagOut);
+    }
+}
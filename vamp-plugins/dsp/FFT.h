@@ -9,18 +9,37 @@
 #ifndef FFT_H
 #define FFT_H
 
+// The FFT implementations. FFTBackendFast precomputes its twiddle factors and
+// bit reversal table per instance and transforms real input with a complex FFT
+// of half the size. FFTBackendLegacy is Don Cross's FFT that computes both on
+// every call. The fast one is used unless QM_DSP_LEGACY_FFT is defined at
+// build time.
+enum FFTBackend {
+    FFTBackendLegacy,
+    FFTBackendFast
+};
+
 class FFT  
 {
 public:
     FFT(unsigned int nsamples);
+    FFT(unsigned int nsamples, FFTBackend backend);
     ~FFT();
 
     void process(bool inverse,
                  const double *realIn, const double *imagIn,
                  double *realOut, double *imagOut);
+
+    // The backend of instances that are created without one. Only tests
+    // should change it, to compare the analysers' output between backends.
+    static FFTBackend defaultBackend();
+    static void setDefaultBackend(FFTBackend backend);
     
 private:
+    void initialise();
+
     unsigned int m_n;
+    FFTBackend m_backend;
     void *m_private;
 };
 
@@ -28,6 +47,7 @@ class FFTReal
 {
 public:
     FFTReal(unsigned int nsamples);
+    FFTReal(unsigned int nsamples, FFTBackend backend);
     ~FFTReal();
 
     void process(bool inverse,
@@ -35,8 +55,14 @@ public:
                  double *realOut, double *imagOut);
 
 private:
+    void initialise();
+
     unsigned int m_n;
+    FFTBackend m_backend;
+    // The fast real FFT, if used.
     void *m_private;
+    // Used for inverse transforms and by the legacy backend.
+    FFT *m_complex;
 };    
 
 #endif